@@ -0,0 +1,115 @@
+/**
+ * @file bench.h
+ * @brief Shared timing and reporting helpers for the benchmarks
+ *
+ * Every benchmark runs for a time budget rather than a fixed iteration
+ * count, so the same binaries give stable numbers on a host and under
+ * QEMU on the MIPS target. The budget per measurement is 200 ms, or
+ * DEVPROTO_BENCH_MS from the environment.
+ *
+ * Results are printed one per line as "name  value unit" so runs can be
+ * diffed or grepped for regressions.
+ */
+
+#ifndef DEVPROTO_BENCH_H
+#define DEVPROTO_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Nanoseconds on the monotonic clock
+ */
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Time budget per measurement in nanoseconds
+ */
+static inline uint64_t bench_budget_ns(void)
+{
+    const char *env = getenv("DEVPROTO_BENCH_MS");
+    long ms = env ? atol(env) : 0;
+    if (ms <= 0) ms = 200;
+    return (uint64_t)ms * 1000000u;
+}
+
+/* Keeps results alive so the compiler cannot drop the work */
+static volatile uint32_t bench_sink __attribute__((unused));
+
+typedef void (*bench_fn)(void *ctx, size_t iterations);
+
+/**
+ * Run fn in growing batches until the budget is spent
+ * Returns nanoseconds per iteration.
+ */
+static inline double bench_run(bench_fn fn, void *ctx)
+{
+    uint64_t budget = bench_budget_ns();
+    size_t batch = 1;
+    uint64_t total_ns = 0;
+    uint64_t total_iter = 0;
+
+    fn(ctx, 1);  /* Warm caches and lazy kernel selection */
+
+    while (total_ns < budget) {
+        uint64_t start = bench_now_ns();
+        fn(ctx, batch);
+        uint64_t took = bench_now_ns() - start;
+
+        total_ns += took;
+        total_iter += batch;
+        if (took < budget / 16 && batch < ((size_t)1 << 30)) batch *= 2;
+    }
+
+    return (double)total_ns / (double)total_iter;
+}
+
+/**
+ * Print one result
+ */
+static inline void bench_report(const char *name, double value, const char *unit)
+{
+    printf("  %-44s %12.3f %s\n", name, value, unit);
+}
+
+static inline int bench_cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Sort samples and return the value at quantile q (0.0 .. 1.0)
+ */
+static inline uint64_t bench_quantile(uint64_t *samples, size_t n, double q)
+{
+    if (n == 0) return 0;
+    qsort(samples, n, sizeof(*samples), bench_cmp_u64);
+
+    size_t idx = (size_t)(q * (double)(n - 1) + 0.5);
+    return samples[idx < n ? idx : n - 1];
+}
+
+/**
+ * Deterministic xorshift generator for test data
+ */
+static inline uint32_t bench_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+#endif /* DEVPROTO_BENCH_H */
@@ -0,0 +1,71 @@
+/**
+ * @file bench_crc16.c
+ * @brief CRC-16 throughput: devproto_crc16 against devproto_crc16_fast and
+ *        every kernel available on this CPU
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "devproto/crc16.h"
+#include "bench.h"
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    int kernel;                         /* -1 = devproto_crc16, -2 = _fast */
+} crc_ctx_t;
+
+static void crc_loop(void *arg, size_t iterations)
+{
+    crc_ctx_t *c = arg;
+    uint32_t acc = 0;
+
+    for (size_t i = 0; i < iterations; i++) {
+        if (c->kernel == -1) {
+            acc += devproto_crc16(c->data, c->len);
+        } else if (c->kernel == -2) {
+            acc += devproto_crc16_fast(c->data, c->len);
+        } else {
+            acc += devproto_crc16_kernel_update((devproto_crc16_kernel_t)c->kernel,
+                                                DEVPROTO_CRC_INITIAL, c->data, c->len);
+        }
+    }
+    bench_sink = acc;
+}
+
+int main(void)
+{
+    static const size_t sizes[] = { 8, 64, 256, 1024, 4096, 65536 };
+    static uint8_t data[65536];
+    uint32_t seed = 0xC0FFEEu;
+
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)bench_rand(&seed);
+
+    printf("=== CRC-16 Benchmarks (fast = %s) ===\n",
+           devproto_crc16_kernel_name(devproto_crc16_active_kernel()));
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t len = sizes[s];
+        char name[64];
+        printf("\n");
+
+        crc_ctx_t ctx = { data, len, -1 };
+        snprintf(name, sizeof(name), "crc16 %zu B", len);
+        bench_report(name, bench_run(crc_loop, &ctx) / (double)len, "ns/byte");
+
+        ctx.kernel = -2;
+        snprintf(name, sizeof(name), "crc16_fast %zu B", len);
+        bench_report(name, bench_run(crc_loop, &ctx) / (double)len, "ns/byte");
+
+        for (int k = DEVPROTO_CRC16_KERNEL_BITWISE; k <= DEVPROTO_CRC16_KERNEL_CLMUL; k++) {
+            if (!devproto_crc16_kernel_available((devproto_crc16_kernel_t)k)) continue;
+
+            ctx.kernel = k;
+            snprintf(name, sizeof(name), "kernel %s %zu B",
+                     devproto_crc16_kernel_name((devproto_crc16_kernel_t)k), len);
+            bench_report(name, bench_run(crc_loop, &ctx) / (double)len, "ns/byte");
+        }
+    }
+
+    return 0;
+}
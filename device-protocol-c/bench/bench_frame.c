@@ -0,0 +1,238 @@
+/**
+ * @file bench_frame.c
+ * @brief Frame parser and builder throughput on a realistic mixed stream
+ *
+ * The stream mixes empty pings, metric responses, command output, status
+ * blobs and the odd firmware-sized frame, with bursts of line noise
+ * between frames that force the parser to resync. It is fed in TCP-sized
+ * chunks, in small torn chunks as a UART delivers them, and through the
+ * slab path that sessions and reactors use.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "devproto/frame.h"
+#include "devproto/frame_pool.h"
+#include "devproto/protocol.h"
+#include "bench.h"
+
+#define STREAM_SIZE     (1024 * 1024)
+#define CHUNKS_MAX      (STREAM_SIZE / 8)
+
+static uint8_t stream[STREAM_SIZE];
+static size_t  stream_len;
+static size_t  stream_frames;           /* Frames written into the stream */
+
+static uint8_t chunk_len[CHUNKS_MAX];   /* Torn chunk sizes, in order */
+static size_t  chunk_count;
+
+static devproto_message_t messages[512];
+
+/**
+ * Pick the next message of the mix
+ */
+static void mix_message(devproto_message_t *msg, uint8_t *payload, uint32_t *seed, uint8_t seq)
+{
+    uint32_t r = bench_rand(seed) % 100;
+    uint16_t len;
+    uint8_t type;
+
+    if (r < 40) {
+        type = DEVPROTO_MSG_PING, len = 0;
+    } else if (r < 70) {
+        type = DEVPROTO_MSG_METRICS_RESPONSE, len = 40;
+    } else if (r < 90) {
+        type = DEVPROTO_MSG_COMMAND_RESULT, len = 200;
+    } else if (r < 98) {
+        type = DEVPROTO_MSG_STATUS_RESPONSE, len = 1024;
+    } else {
+        type = DEVPROTO_MSG_UPDATE_FIRMWARE, len = DEVPROTO_MAX_PAYLOAD_SIZE;
+    }
+
+    for (uint16_t i = 0; i < len; i++) {
+        payload[i] = type == DEVPROTO_MSG_COMMAND_RESULT ? (uint8_t)(' ' + (i * 7 + seq) % 90)
+                                                         : (uint8_t)bench_rand(seed);
+    }
+    msg->msg_type = type;
+    msg->sequence = seq;
+    msg->payload_len = len;
+    msg->payload = len ? payload : NULL;
+}
+
+/**
+ * Build the stream and its torn chunk schedule
+ */
+static void stream_init(void)
+{
+    static uint8_t payload[DEVPROTO_MAX_PAYLOAD_SIZE];
+    uint32_t seed = 0x5EED1234u;
+    uint8_t seq = 0;
+
+    while (stream_len + DEVPROTO_MAX_FRAME_SIZE + 16 < sizeof(stream)) {
+        /* Line noise every ~50 frames, sometimes with a false header byte */
+        if (bench_rand(&seed) % 50 == 0) {
+            size_t noise = 1 + bench_rand(&seed) % 16;
+            for (size_t i = 0; i < noise; i++) stream[stream_len++] = (uint8_t)bench_rand(&seed);
+            if (bench_rand(&seed) % 2) stream[stream_len - 1] = DEVPROTO_HEADER_BYTE0;
+        }
+
+        devproto_message_t msg;
+        mix_message(&msg, payload, &seed, seq++);
+        int n = devproto_frame_build(&msg, stream + stream_len, sizeof(stream) - stream_len);
+        if (n < 0) break;
+        stream_len += (size_t)n;
+        stream_frames++;
+    }
+
+    /* UART-like reads: mostly a FIFO's worth, sometimes a single byte */
+    size_t covered = 0;
+    while (covered < stream_len && chunk_count < CHUNKS_MAX) {
+        size_t len = bench_rand(&seed) % 8 == 0 ? 1 : 1 + bench_rand(&seed) % 64;
+        if (len > stream_len - covered) len = stream_len - covered;
+        chunk_len[chunk_count++] = (uint8_t)len;
+        covered += len;
+    }
+}
+
+typedef struct {
+    devproto_frame_parser_t *parser;
+    devproto_frame_pooled_parser_t *pooled;     /* Used instead of parser when set */
+    size_t chunk;                       /* Fixed chunk size, 0 = torn schedule */
+    devproto_frame_slab_t *slab;        /* Slab path when set */
+    size_t frames;                      /* Frames seen by the last pass */
+} parse_ctx_t;
+
+/**
+ * Feed one chunk through the slab path, draining as a session does
+ */
+static size_t parse_slab_chunk(parse_ctx_t *c, const uint8_t *data, size_t len)
+{
+    size_t frames = 0;
+    size_t off = 0;
+
+    while (off < len) {
+        size_t consumed = 0;
+        devproto_frame_slab_reset(c->slab);
+        int n = c->pooled
+            ? devproto_frame_pooled_parse_slab(c->pooled, data + off, len - off, c->slab,
+                                               messages, 16, &consumed)
+            : devproto_frame_parse_slab(c->parser, data + off, len - off, c->slab,
+                                        messages, 16, &consumed);
+        if (n < 0) break;
+        off += consumed;
+        frames += (size_t)n;
+        if (n == 0 && consumed == 0) break;
+    }
+    return frames;
+}
+
+static void parse_loop(void *arg, size_t iterations)
+{
+    parse_ctx_t *c = arg;
+
+    for (size_t it = 0; it < iterations; it++) {
+        size_t frames = 0;
+        size_t off = 0;
+        size_t next = 0;
+
+        if (c->pooled) {
+            devproto_frame_pooled_reset(c->pooled);
+        } else {
+            devproto_frame_parser_reset(c->parser);
+        }
+        while (off < stream_len) {
+            size_t len = c->chunk ? c->chunk : next < chunk_count ? chunk_len[next++] : 64;
+            if (len > stream_len - off) len = stream_len - off;
+
+            if (c->slab) {
+                frames += parse_slab_chunk(c, stream + off, len);
+            } else if (c->pooled) {
+                int n = devproto_frame_pooled_parse(c->pooled, stream + off, len, messages,
+                                                    sizeof(messages) / sizeof(messages[0]));
+                if (n > 0) frames += (size_t)n;
+            } else {
+                int n = devproto_frame_parse(c->parser, stream + off, len, messages,
+                                             sizeof(messages) / sizeof(messages[0]));
+                if (n > 0) frames += (size_t)n;
+            }
+            off += len;
+        }
+        c->frames = frames;
+    }
+}
+
+typedef struct {
+    devproto_message_t msgs[64];
+    uint8_t payloads[64][DEVPROTO_MAX_PAYLOAD_SIZE];
+} build_ctx_t;
+
+static void build_loop(void *arg, size_t iterations)
+{
+    build_ctx_t *c = arg;
+    static uint8_t out[DEVPROTO_MAX_FRAME_SIZE];
+    uint32_t acc = 0;
+
+    for (size_t it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < 64; i++) {
+            acc += (uint32_t)devproto_frame_build(&c->msgs[i], out, sizeof(out));
+        }
+    }
+    bench_sink = acc;
+}
+
+/**
+ * Report a parse configuration
+ */
+static void report_parse(const char *name, parse_ctx_t *ctx)
+{
+    double ns = bench_run(parse_loop, ctx);
+
+    bench_report(name, ns / (double)stream_len, "ns/byte");
+    bench_report(name, (double)ctx->frames * 1e9 / ns, "frames/s");
+    if (ctx->frames + stream_frames / 100 < stream_frames) {
+        printf("  WARNING: %s parsed %zu of %zu frames\n", name, ctx->frames, stream_frames);
+    }
+}
+
+int main(void)
+{
+    stream_init();
+
+    printf("=== Frame Benchmarks (%zu frames, %zu bytes, %zu torn chunks) ===\n",
+           stream_frames, stream_len, chunk_count);
+    printf("\n");
+
+    static devproto_frame_parser_t parser;
+    devproto_frame_parser_init(&parser);
+
+    parse_ctx_t ctx = { &parser, NULL, 1460, NULL, 0 };
+    report_parse("parse 1460 B chunks", &ctx);
+
+    ctx.chunk = 0;
+    report_parse("parse torn 1..64 B chunks", &ctx);
+
+    static uint8_t slab_storage[16 * 1024];
+    devproto_frame_slab_t slab;
+    devproto_frame_slab_init(&slab, slab_storage, sizeof(slab_storage));
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+    devproto_frame_pooled_parser_t *pooled = devproto_frame_pooled_create(pool);
+
+    parse_ctx_t slab_ctx = { NULL, pooled, 1460, &slab, 0 };
+    report_parse("parse_slab pooled 1460 B chunks", &slab_ctx);
+
+    slab_ctx.chunk = 0;
+    report_parse("parse_slab pooled torn chunks", &slab_ctx);
+
+    devproto_frame_pooled_destroy(pooled);
+    devproto_frame_pool_destroy(pool);
+
+    static build_ctx_t build;
+    uint32_t seed = 0xB111Du;
+    for (size_t i = 0; i < 64; i++) {
+        mix_message(&build.msgs[i], build.payloads[i], &seed, (uint8_t)i);
+    }
+    printf("\n");
+    bench_report("frame_build mixed", bench_run(build_loop, &build) / 64.0, "ns/frame");
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file bench_metrics.c
+ * @brief Metrics payload encode/decode rate (legacy, SoA kernels, compact)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "devproto/metrics.h"
+#include "devproto/protocol.h"
+#include "bench.h"
+
+#define BATCH   64                      /* Metrics per payload */
+
+typedef struct {
+    devproto_metric_t metrics[BATCH];
+    uint8_t payload[DEVPROTO_MAX_PAYLOAD_SIZE];
+    int payload_len;
+    devproto_metric_t out[BATCH];
+    uint8_t types[BATCH];
+    float values[BATCH];
+    int kernel;
+    devproto_metrics_encoder_t enc;
+    devproto_metrics_decoder_t dec;
+} metrics_ctx_t;
+
+static void build_loop(void *arg, size_t iterations)
+{
+    metrics_ctx_t *c = arg;
+    uint32_t acc = 0;
+
+    for (size_t i = 0; i < iterations; i++) {
+        acc += (uint32_t)devproto_metrics_build(c->metrics, BATCH, c->payload, sizeof(c->payload));
+    }
+    bench_sink = acc;
+}
+
+static void parse_loop(void *arg, size_t iterations)
+{
+    metrics_ctx_t *c = arg;
+    uint32_t acc = 0;
+
+    for (size_t i = 0; i < iterations; i++) {
+        acc += (uint32_t)devproto_metrics_parse(c->payload, (size_t)c->payload_len, c->out, BATCH);
+    }
+    bench_sink = acc;
+}
+
+static void parse_soa_loop(void *arg, size_t iterations)
+{
+    metrics_ctx_t *c = arg;
+    uint32_t acc = 0;
+
+    for (size_t i = 0; i < iterations; i++) {
+        acc += (uint32_t)devproto_metrics_parse_soa_kernel((devproto_metrics_kernel_t)c->kernel,
+                                                           c->payload, (size_t)c->payload_len,
+                                                           c->types, c->values, BATCH);
+    }
+    bench_sink = acc;
+}
+
+/**
+ * Steady-state compact exchange: delta payload, decode, acknowledge
+ */
+static void compact_loop(void *arg, size_t iterations)
+{
+    metrics_ctx_t *c = arg;
+    uint32_t acc = 0;
+
+    for (size_t i = 0; i < iterations; i++) {
+        /* One reading changes per round, as on a quiet device */
+        c->metrics[i % BATCH].value += 1.0f;
+
+        int n = devproto_metrics_build_compact(&c->enc, c->metrics, BATCH,
+                                               c->payload, sizeof(c->payload));
+        int m = devproto_metrics_parse_compact(&c->dec, c->payload, n > 0 ? (size_t)n : 0,
+                                               c->out, BATCH);
+        devproto_metrics_encoder_ack(&c->enc, devproto_metrics_decoder_ack(&c->dec));
+        acc += (uint32_t)(n + m);
+    }
+    bench_sink = acc;
+}
+
+int main(void)
+{
+    static metrics_ctx_t ctx;
+    static const devproto_metric_type_t types[] = {
+        DEVPROTO_METRIC_CPU_USAGE, DEVPROTO_METRIC_MEMORY_USAGE, DEVPROTO_METRIC_TEMPERATURE,
+        DEVPROTO_METRIC_SIGNAL_STRENGTH, DEVPROTO_METRIC_THROUGHPUT, DEVPROTO_METRIC_LATENCY,
+        DEVPROTO_METRIC_VOLTAGE, DEVPROTO_METRIC_UPTIME
+    };
+    uint32_t seed = 0x3E7121C5u;
+
+    /* Distinct types, as a real response carries each type once */
+    for (size_t i = 0; i < BATCH; i++) {
+        ctx.metrics[i].type = i < sizeof(types) / sizeof(types[0])
+                              ? types[i] : (devproto_metric_type_t)(0x60 + i);
+        ctx.metrics[i].value = (float)(bench_rand(&seed) % 10000) / 100.0f;
+    }
+    ctx.payload_len = devproto_metrics_build(ctx.metrics, BATCH, ctx.payload, sizeof(ctx.payload));
+
+    printf("=== Metrics Benchmarks (%d metrics per payload) ===\n", BATCH);
+    printf("\n");
+
+    bench_report("metrics_build", bench_run(build_loop, &ctx) / BATCH, "ns/metric");
+    ctx.payload_len = devproto_metrics_build(ctx.metrics, BATCH, ctx.payload, sizeof(ctx.payload));
+    bench_report("metrics_parse", bench_run(parse_loop, &ctx) / BATCH, "ns/metric");
+
+    for (int k = DEVPROTO_METRICS_KERNEL_SCALAR; k <= DEVPROTO_METRICS_KERNEL_SIMD; k++) {
+        if (!devproto_metrics_kernel_available((devproto_metrics_kernel_t)k)) continue;
+
+        char name[64];
+        ctx.kernel = k;
+        snprintf(name, sizeof(name), "metrics_parse_soa %s",
+                 devproto_metrics_kernel_name((devproto_metrics_kernel_t)k));
+        bench_report(name, bench_run(parse_soa_loop, &ctx) / BATCH, "ns/metric");
+    }
+
+    devproto_metrics_encoder_init(&ctx.enc);
+    devproto_metrics_decoder_init(&ctx.dec);
+    double ns = bench_run(compact_loop, &ctx);
+    bench_report("metrics compact delta round", ns, "ns/payload");
+    bench_report("metrics compact delta round", 1e9 / ns, "payloads/s");
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file bench_replay.c
+ * @brief Parser and metrics decoder throughput on recorded field traffic
+ *
+ * Reads the capture named by DEVPROTO_BENCH_CAPTURE (skipped when unset).
+ * Received records of every connection are fed in place from the mapped
+ * file, each connection through its own pooled parser, with the chunk
+ * boundaries the field link produced. The busiest connection is also
+ * replayed through the replay transport as fast as it goes, which adds
+ * the copy a socket read would make.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "devproto/capture.h"
+#include "devproto/transport.h"
+#include "devproto/frame.h"
+#include "devproto/frame_pool.h"
+#include "devproto/metrics.h"
+#include "devproto/protocol.h"
+#include "bench.h"
+
+#define METRICS_MAX     1024
+
+typedef struct {
+    const devproto_capture_reader_t *reader;
+    size_t conn_count;
+    devproto_frame_pooled_parser_t **parsers; /* One per connection, by index */
+    uint16_t *conn_index;               /* Connection id -> parser index */
+    devproto_frame_slab_t *slab;
+    int decode;                         /* Decode METRICS_RESPONSE payloads */
+    size_t frames;                      /* Frames seen by the last pass */
+    size_t metrics;                     /* Metrics decoded by the last pass */
+    uint64_t bytes;                     /* Received bytes per pass */
+} replay_ctx_t;
+
+static devproto_message_t messages[64];
+static devproto_metric_t  metrics[METRICS_MAX];
+
+/**
+ * Parse one record, draining the slab as a session does
+ */
+static void parse_record(replay_ctx_t *c, devproto_frame_pooled_parser_t *parser,
+                         const uint8_t *data, size_t len)
+{
+    size_t off = 0;
+
+    while (off < len) {
+        size_t consumed = 0;
+        devproto_frame_slab_reset(c->slab);
+        int n = devproto_frame_pooled_parse_slab(parser, data + off, len - off, c->slab,
+                                                 messages, 64, &consumed);
+        if (n < 0) break;
+        off += consumed;
+        c->frames += (size_t)n;
+
+        for (int i = 0; c->decode && i < n; i++) {
+            const devproto_message_t *m = &messages[i];
+            if (m->msg_type != DEVPROTO_MSG_METRICS_RESPONSE ||
+                devproto_metrics_is_compact(m->payload, m->payload_len)) {
+                continue;
+            }
+            int count = devproto_metrics_parse(m->payload, m->payload_len, metrics, METRICS_MAX);
+            if (count > 0) c->metrics += (size_t)count;
+        }
+        if (n == 0 && consumed == 0) break;
+    }
+}
+
+static void replay_loop(void *arg, size_t iterations)
+{
+    replay_ctx_t *c = arg;
+
+    for (size_t it = 0; it < iterations; it++) {
+        size_t cursor = 0;
+        devproto_capture_entry_t e;
+
+        c->frames = 0;
+        c->metrics = 0;
+        for (size_t i = 0; i < c->conn_count; i++) devproto_frame_pooled_reset(c->parsers[i]);
+
+        while (devproto_capture_reader_next(c->reader, &cursor, &e) == 1) {
+            if (e.dir != DEVPROTO_CAPTURE_IN) continue;
+            parse_record(c, c->parsers[c->conn_index[e.conn]], e.data, e.len);
+        }
+    }
+}
+
+typedef struct {
+    devproto_transport_t *t;
+    devproto_frame_pooled_parser_t *parser;
+    size_t frames;
+} transport_ctx_t;
+
+static void transport_loop(void *arg, size_t iterations)
+{
+    transport_ctx_t *c = arg;
+    static uint8_t buf[4096];
+
+    for (size_t it = 0; it < iterations; it++) {
+        int n;
+
+        c->frames = 0;
+        devproto_frame_pooled_reset(c->parser);
+        devproto_transport_open(c->t);
+        while ((n = devproto_transport_recv(c->t, buf, sizeof(buf), 0)) > 0) {
+            int count = devproto_frame_pooled_parse(c->parser, buf, (size_t)n, messages, 64);
+            if (count > 0) c->frames += (size_t)count;
+        }
+    }
+}
+
+int main(void)
+{
+    const char *path = getenv("DEVPROTO_BENCH_CAPTURE");
+
+    printf("=== Replay Benchmarks ===\n");
+    printf("\n");
+    if (!path) {
+        printf("  skipped: set DEVPROTO_BENCH_CAPTURE to a capture file\n");
+        return 0;
+    }
+
+    devproto_capture_reader_t *r = devproto_capture_reader_open(path);
+    if (!r) {
+        printf("  %s: not a capture file\n", path);
+        return 1;
+    }
+
+    devproto_capture_info_t info;
+    devproto_capture_reader_info(r, &info);
+
+    static uint16_t conn_index[65536];
+    static uint8_t slab_storage[64 * 1024];
+    devproto_frame_slab_t slab;
+    devproto_frame_slab_init(&slab, slab_storage, sizeof(slab_storage));
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+
+    replay_ctx_t ctx = {
+        .reader = r,
+        .conn_count = info.conn_count,
+        .parsers = calloc(info.conn_count ? info.conn_count : 1, sizeof(*ctx.parsers)),
+        .conn_index = conn_index,
+        .slab = &slab
+    };
+
+    /* Accept whatever the field links negotiated */
+    size_t busiest = 0;
+    for (size_t i = 0; i < info.conn_count; i++) {
+        const devproto_capture_conn_t *c = devproto_capture_reader_conn(r, i);
+        conn_index[c->conn] = (uint16_t)i;
+        ctx.bytes += c->bytes_in;
+        if (c->bytes_in > devproto_capture_reader_conn(r, busiest)->bytes_in) busiest = i;
+
+        ctx.parsers[i] = devproto_frame_pooled_create(pool);
+        devproto_frame_pooled_set_max_payload(ctx.parsers[i], DEVPROTO_JUMBO_MAX_PAYLOAD);
+        devproto_frame_pooled_set_decompress(ctx.parsers[i], 1);
+    }
+
+    printf("  %s: %llu records, %zu connections, %.3f s%s\n", path,
+           (unsigned long long)info.records, info.conn_count,
+           (double)info.duration_us / 1e6, info.indexed ? "" : " (unfinished)");
+    printf("\n");
+
+    if (ctx.bytes == 0) {
+        printf("  no received traffic\n");
+    } else {
+        double ns = bench_run(replay_loop, &ctx);
+        bench_report("parse_slab in place", ns / (double)ctx.bytes, "ns/byte");
+        bench_report("parse_slab in place", (double)ctx.frames * 1e9 / ns, "frames/s");
+
+        ctx.decode = 1;
+        ns = bench_run(replay_loop, &ctx);
+        bench_report("parse_slab + metrics decode", ns / (double)ctx.bytes, "ns/byte");
+        if (ctx.metrics > 0) {
+            bench_report("parse_slab + metrics decode", (double)ctx.metrics * 1e9 / ns,
+                         "metrics/s");
+        }
+
+        const devproto_capture_conn_t *c = devproto_capture_reader_conn(r, busiest);
+        devproto_replay_config_t cfg = { .conn = c->conn, .dir = DEVPROTO_CAPTURE_IN };
+        transport_ctx_t tctx = {
+            .t = devproto_transport_replay_create(r, &cfg),
+            .parser = ctx.parsers[busiest]
+        };
+
+        char label[80];
+        snprintf(label, sizeof(label), "replay transport conn %u", c->conn);
+        ns = bench_run(transport_loop, &tctx);
+        printf("\n");
+        bench_report(label, ns / (double)c->bytes_in, "ns/byte");
+        bench_report(label, (double)tctx.frames * 1e9 / ns, "frames/s");
+        devproto_transport_destroy(tctx.t);
+    }
+
+    for (size_t i = 0; i < info.conn_count; i++) devproto_frame_pooled_destroy(ctx.parsers[i]);
+    free(ctx.parsers);
+    devproto_frame_pool_destroy(pool);
+    devproto_capture_reader_destroy(r);
+    return 0;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file bench_transport.c
+ * @brief Request round-trip latency and pipelined throughput over loopback
+ *
+ * A peer thread answers every request with its response type, like a
+ * device would. The host side is a session on the TCP transport over
+ * 127.0.0.1, and on a minimal fd transport over a socketpair, which
+ * shows the protocol stack cost without the TCP stack.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "devproto/session.h"
+#include "devproto/transport.h"
+#include "devproto/frame.h"
+#include "devproto/error.h"
+#include "bench.h"
+
+#define RTT_SAMPLES_MAX     200000
+#define PIPELINE_WINDOW     32
+
+/**
+ * Write all bytes to a blocking fd
+ */
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Peer: answer each request with an empty response of the matching type
+ */
+static void *peer_main(void *arg)
+{
+    int fd = *(int *)arg;
+    static devproto_frame_parser_t parser;
+    static devproto_message_t msgs[512];
+    static uint8_t rx[4096];
+    static uint8_t tx[512 * (DEVPROTO_HEADER_SIZE + DEVPROTO_CRC_SIZE)];
+
+    devproto_frame_parser_init(&parser);
+    for (;;) {
+        ssize_t n = read(fd, rx, sizeof(rx));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        int count = devproto_frame_parse(&parser, rx, (size_t)n, msgs, 512);
+        size_t len = 0;
+        for (int i = 0; i < count; i++) {
+            devproto_message_t reply = {
+                .msg_type = devproto_response_type(msgs[i].msg_type),
+                .sequence = msgs[i].sequence
+            };
+            int m = devproto_frame_build(&reply, tx + len, sizeof(tx) - len);
+            if (m > 0) len += (size_t)m;
+        }
+        if (len > 0 && write_all(fd, tx, len) != 0) break;
+    }
+
+    close(fd);
+    return NULL;
+}
+
+/* ---- Minimal fd transport for the socketpair ---- */
+
+static int fd_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+{
+    ssize_t n;
+    do {
+        n = write(t->fd, data, len);
+    } while (n < 0 && errno == EINTR);
+    return (int)n;
+}
+
+static int fd_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = t->fd, .events = POLLIN };
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready <= 0) return ready < 0 && errno != EINTR ? -1 : 0;
+
+    ssize_t n = read(t->fd, data, len);
+    if (n == 0) return -1;  /* Peer closed */
+    if (n < 0) return errno == EINTR || errno == EAGAIN ? 0 : -1;
+    return (int)n;
+}
+
+static const devproto_transport_ops_t fd_ops = {
+    .send = fd_send,
+    .recv = fd_recv
+};
+
+/* ---- Measurements ---- */
+
+static void on_done(devproto_session_t *s, int status,
+                    const devproto_message_t *resp, void *user)
+{
+    (void)s;
+    (void)resp;
+    if (status == DEVPROTO_OK) (*(int *)user)++;
+}
+
+/**
+ * One request at a time: latency distribution
+ */
+static void bench_rtt(const char *name, devproto_transport_t *t)
+{
+    static uint64_t samples[RTT_SAMPLES_MAX];
+    devproto_session_t *s = devproto_session_create(t, 1);
+    uint64_t budget = bench_budget_ns();
+    uint64_t start = bench_now_ns();
+    size_t n = 0;
+
+    while (n < RTT_SAMPLES_MAX && bench_now_ns() - start < budget) {
+        devproto_message_t ping;
+        devproto_create_ping(&ping, 0);
+
+        int done = 0;
+        uint64_t t0 = bench_now_ns();
+        if (devproto_session_request(s, &ping, 1000, on_done, &done) < 0) break;
+        while (devproto_session_inflight(s) > 0) {
+            if (devproto_session_process(s, 100) < 0) goto out;
+        }
+        if (!done) break;
+        samples[n++] = bench_now_ns() - t0;
+    }
+
+out:
+    devproto_session_destroy(s);
+    if (n == 0) {
+        printf("  %s: no replies\n", name);
+        return;
+    }
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) total += samples[i];
+
+    char label[80];
+    snprintf(label, sizeof(label), "%s rtt mean", name);
+    bench_report(label, (double)total / (double)n / 1000.0, "us");
+    snprintf(label, sizeof(label), "%s rtt p50", name);
+    bench_report(label, (double)bench_quantile(samples, n, 0.50) / 1000.0, "us");
+    snprintf(label, sizeof(label), "%s rtt p99", name);
+    bench_report(label, (double)bench_quantile(samples, n, 0.99) / 1000.0, "us");
+}
+
+/**
+ * Keep PIPELINE_WINDOW requests in flight: request throughput
+ */
+static void bench_pipelined(const char *name, devproto_transport_t *t)
+{
+    devproto_session_t *s = devproto_session_create(t, PIPELINE_WINDOW);
+    uint64_t budget = bench_budget_ns();
+    uint64_t start = bench_now_ns();
+    int done = 0;
+
+    while (bench_now_ns() - start < budget) {
+        while (devproto_session_inflight(s) < PIPELINE_WINDOW) {
+            devproto_message_t ping;
+            devproto_create_ping(&ping, 0);
+            if (devproto_session_request(s, &ping, 1000, on_done, &done) < 0) break;
+        }
+        if (devproto_session_process(s, 100) < 0) break;
+    }
+    while (devproto_session_inflight(s) > 0 && devproto_session_process(s, 100) >= 0) {
+    }
+    uint64_t took = bench_now_ns() - start;
+    devproto_session_destroy(s);
+
+    char label[80];
+    snprintf(label, sizeof(label), "%s pipelined x%d", name, PIPELINE_WINDOW);
+    bench_report(label, (double)done * 1e9 / (double)took, "requests/s");
+}
+
+/**
+ * Listen on an ephemeral loopback port
+ */
+static int listen_loopback(int *port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 1) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void run_tcp(void)
+{
+    int port;
+    int lfd = listen_loopback(&port);
+    if (lfd < 0) {
+        printf("  tcp: loopback unavailable\n");
+        return;
+    }
+
+    devproto_transport_t *t = devproto_transport_tcp_create("127.0.0.1", port);
+    if (!t || devproto_transport_open(t) != 0) {
+        printf("  tcp: connect failed\n");
+        devproto_transport_destroy(t);
+        close(lfd);
+        return;
+    }
+
+    int peer = accept(lfd, NULL, NULL);
+    close(lfd);
+    int flag = 1;
+    setsockopt(peer, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, peer_main, &peer);
+    bench_rtt("tcp", t);
+    bench_pipelined("tcp", t);
+
+    devproto_transport_destroy(t);
+    pthread_join(tid, NULL);
+}
+
+static void run_socketpair(void)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        printf("  socketpair: unavailable\n");
+        return;
+    }
+
+    devproto_transport_t t = { .ops = &fd_ops, .fd = sv[0], .is_open = 1 };
+    pthread_t tid;
+    pthread_create(&tid, NULL, peer_main, &sv[1]);
+    bench_rtt("socketpair", &t);
+    bench_pipelined("socketpair", &t);
+
+    close(sv[0]);
+    pthread_join(tid, NULL);
+}
+
+int main(void)
+{
+    printf("=== Transport Benchmarks (loopback) ===\n");
+    printf("\n");
+
+    run_socketpair();
+    printf("\n");
+    run_tcp();
+
+    return 0;
+}
@@ -5,6 +5,7 @@
  * Usage:
  *   ./host_client --host 127.0.0.1 --port 9999
  *   ./host_client --serial /dev/ttyUSB0
+ *   ./host_client --serial /dev/ttyUSB0 --firmware image.bin
  */
 
 #include <stdio.h>
@@ -18,6 +19,9 @@
 #include "devproto/transport.h"
 #include "devproto/metrics.h"
 #include "devproto/crc16.h"
+#include "devproto/error.h"
+#include "devproto/session.h"
+#include "devproto/firmware.h"
 
 /* Global state */
 static devproto_transport_t *transport = NULL;
@@ -51,6 +55,9 @@ static int send_and_receive(devproto_message_t *request, devproto_message_t *res
     int elapsed = 0;
 
     while (elapsed < timeout_ms) {
+        /* Serial: let the driver collect the rest of the frame per wakeup */
+        devproto_transport_serial_set_read_hint(transport, devproto_frame_remaining(&parser));
+
         int n = devproto_transport_recv(transport, rx_buffer, sizeof(rx_buffer), 100);
 
         if (n < 0) {
@@ -178,6 +185,45 @@ static int test_status(void)
     return 0;
 }
 
+/**
+ * Send a firmware image to the device
+ */
+static int flash_firmware(const char *path)
+{
+    printf("Flashing %s... ", path);
+    fflush(stdout);
+
+    devproto_fw_sender_t *fw = devproto_fw_sender_open(path, NULL);
+    if (!fw) {
+        printf("FAILED (cannot map image)\n");
+        return -1;
+    }
+
+    devproto_session_t *s = devproto_session_create(transport, DEVPROTO_FW_WINDOW_DEFAULT);
+    if (!s) {
+        printf("FAILED (no session)\n");
+        devproto_fw_sender_destroy(fw);
+        return -1;
+    }
+
+    int rc = devproto_fw_sender_run(fw, s);
+
+    devproto_fw_stats_t stats;
+    devproto_fw_sender_get_stats(fw, &stats);
+    if (rc == DEVPROTO_OK) {
+        printf("OK\n");
+    } else {
+        printf("FAILED (%d)\n", rc);
+    }
+    printf("  Acked: %u / %u bytes (resumed from %u)\n",
+           stats.acked_bytes, stats.image_size, stats.resumed_from);
+    printf("  Chunks: %u sent, %u retransmitted\n", stats.chunks_sent, stats.retransmits);
+
+    devproto_session_destroy(s);
+    devproto_fw_sender_destroy(fw);
+    return rc == DEVPROTO_OK ? 0 : -1;
+}
+
 /**
  * Print usage
  */
@@ -190,6 +236,7 @@ static void usage(const char *prog)
     printf("  --port PORT    TCP port (default: 9999)\n");
     printf("  --serial DEV   Serial device (e.g., /dev/ttyUSB0)\n");
     printf("  --baud RATE    Serial baud rate (default: 115200)\n");
+    printf("  --firmware F   Send firmware image F after the tests\n");
     printf("  --help         Show this help\n");
     printf("\n");
     printf("Examples:\n");
@@ -203,18 +250,20 @@ int main(int argc, char *argv[])
     int port = 9999;
     char *serial_device = NULL;
     int baudrate = 115200;
+    char *firmware = NULL;
 
     static struct option long_options[] = {
         {"host",   required_argument, 0, 'h'},
         {"port",   required_argument, 0, 'p'},
         {"serial", required_argument, 0, 's'},
         {"baud",   required_argument, 0, 'b'},
+        {"firmware", required_argument, 0, 'f'},
         {"help",   no_argument,       0, '?'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "h:p:s:b:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "h:p:s:b:f:", long_options, NULL)) != -1) {
         switch (opt) {
         case 'h':
             host = optarg;
@@ -228,6 +277,9 @@ int main(int argc, char *argv[])
         case 'b':
             baudrate = atoi(optarg);
             break;
+        case 'f':
+            firmware = optarg;
+            break;
         case '?':
         default:
             usage(argv[0]);
@@ -238,7 +290,10 @@ int main(int argc, char *argv[])
     /* Create transport */
     if (serial_device) {
         printf("Connecting to serial: %s @ %d baud\n", serial_device, baudrate);
-        transport = devproto_transport_serial_create(serial_device, baudrate);
+        devproto_serial_config_t serial_cfg;
+        devproto_serial_config_init(&serial_cfg, serial_device);
+        serial_cfg.baudrate = baudrate;
+        transport = devproto_transport_serial_create_ex(&serial_cfg);
     } else {
         printf("Connecting to TCP: %s:%d\n", host, port);
         transport = devproto_transport_tcp_create(host, port);
@@ -267,6 +322,7 @@ int main(int argc, char *argv[])
     if (test_ping() != 0) failures++;
     if (test_metrics() != 0) failures++;
     if (test_status() != 0) failures++;
+    if (firmware && flash_firmware(firmware) != 0) failures++;
 
     printf("\n");
     if (failures == 0) {
@@ -17,17 +17,25 @@
 #include <unistd.h>
 #include <signal.h>
 #include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
 
 #include "devproto/protocol.h"
 #include "devproto/frame.h"
 #include "devproto/transport.h"
 #include "devproto/metrics.h"
 #include "devproto/crc16.h"
+#include "devproto/subscription.h"
+#include "devproto/sampler.h"
+#include "devproto/frame_queue.h"
+#include "devproto/firmware.h"
 
 /* Configuration */
 #define DEFAULT_SERIAL_PORT "/dev/ttyS0"
 #define DEFAULT_TCP_PORT 9999
 #define ALERT_CHECK_INTERVAL 5  /* seconds */
+#define COMMAND_QUEUE_SIZE   16     /* Commands waiting for the worker */
+#define DEFAULT_FIRMWARE_PATH "/tmp/firmware.bin"   /* Stand-in for the update partition */
 
 /* Simulated device state */
 static struct {
@@ -53,8 +61,19 @@ static struct {
 /* Global state */
 static devproto_transport_t *transport = NULL;
 static devproto_frame_parser_t parser;
+static devproto_sub_manager_t *subscriptions = NULL;
+static devproto_sampler_t *sampler = NULL;
 static volatile int running = 1;
 
+/* Slow commands run on a worker so reception (and PING) never stalls */
+static devproto_frame_queue_t *command_queue = NULL;
+static pthread_mutex_t tx_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Firmware updates are written chunk by chunk to the staging image */
+static devproto_fw_receiver_t *firmware = NULL;
+static const char *firmware_path = DEFAULT_FIRMWARE_PATH;
+static int firmware_fd = -1;
+
 /**
  * Signal handler for graceful shutdown
  */
@@ -95,28 +114,49 @@ static float read_signal_strength(void)
 }
 
 /**
- * Collect all metrics
+ * Sampler reader: dispatch to the matching hardware read
  */
-static int collect_metrics(devproto_metric_t *metrics, size_t max_metrics)
+static int sample_metric(devproto_metric_type_t type, float *value, void *user)
 {
-    if (max_metrics < 5) return -1;
-
-    metrics[0].type = DEVPROTO_METRIC_TEMPERATURE;
-    metrics[0].value = read_cpu_temperature();
-
-    metrics[1].type = DEVPROTO_METRIC_CPU_USAGE;
-    metrics[1].value = read_cpu_usage();
-
-    metrics[2].type = DEVPROTO_METRIC_MEMORY_USAGE;
-    metrics[2].value = read_memory_usage();
+    (void)user;
+
+    switch (type) {
+    case DEVPROTO_METRIC_TEMPERATURE:     *value = read_cpu_temperature(); break;
+    case DEVPROTO_METRIC_CPU_USAGE:       *value = read_cpu_usage(); break;
+    case DEVPROTO_METRIC_MEMORY_USAGE:    *value = read_memory_usage(); break;
+    case DEVPROTO_METRIC_FAN_SPEED:       *value = read_fan_speed(); break;
+    case DEVPROTO_METRIC_SIGNAL_STRENGTH: *value = read_signal_strength(); break;
+    default: return -1;
+    }
+    return 0;
+}
 
-    metrics[3].type = DEVPROTO_METRIC_FAN_SPEED;
-    metrics[3].value = read_fan_speed();
+/**
+ * Register metrics with per-sensor refresh intervals
+ * Slow-moving sensors are read less often so a request never waits on them.
+ */
+static int setup_sampler(void)
+{
+    static const struct {
+        devproto_metric_type_t type;
+        uint32_t interval_ms;
+    } sensors[] = {
+        { DEVPROTO_METRIC_TEMPERATURE,     1000 },
+        { DEVPROTO_METRIC_CPU_USAGE,        250 },
+        { DEVPROTO_METRIC_MEMORY_USAGE,    1000 },
+        { DEVPROTO_METRIC_FAN_SPEED,        500 },
+        { DEVPROTO_METRIC_SIGNAL_STRENGTH, 2000 },
+    };
 
-    metrics[4].type = DEVPROTO_METRIC_SIGNAL_STRENGTH;
-    metrics[4].value = read_signal_strength();
+    for (size_t i = 0; i < sizeof(sensors) / sizeof(sensors[0]); i++) {
+        if (devproto_sampler_add(sampler, sensors[i].type, sensors[i].interval_ms,
+                                 sample_metric, NULL) != 0) {
+            return -1;
+        }
+    }
 
-    return 5;
+    /* Prime the snapshot so the first request has data */
+    return devproto_sampler_refresh(sampler) < 0 ? -1 : 0;
 }
 
 /**
@@ -132,7 +172,12 @@ static int send_response(devproto_message_t *msg)
         return -1;
     }
 
-    if (devproto_transport_send(transport, buffer, len) != len) {
+    /* Responses come from the main loop and the command worker */
+    pthread_mutex_lock(&tx_lock);
+    int sent = devproto_transport_send(transport, buffer, len);
+    pthread_mutex_unlock(&tx_lock);
+
+    if (sent != len) {
         fprintf(stderr, "Failed to send response\n");
         return -1;
     }
@@ -159,11 +204,9 @@ static void handle_metrics_request(uint8_t sequence)
 {
     printf("  -> Received METRICS request\n");
 
-    devproto_metric_t metrics[16];
-    int count = collect_metrics(metrics, 16);
-
+    /* Serve the cached snapshot; sensors are read from the main loop */
     uint8_t payload[256];
-    int payload_len = devproto_metrics_build(metrics, count, payload, sizeof(payload));
+    int payload_len = devproto_sampler_build(sampler, payload, sizeof(payload));
 
     if (payload_len < 0) {
         fprintf(stderr, "Failed to build metrics payload\n");
@@ -178,7 +221,74 @@ static void handle_metrics_request(uint8_t sequence)
     };
 
     send_response(&response);
-    printf("  -> Sent %d metrics\n", count);
+    printf("  -> Sent %d metrics\n", payload_len / 5);
+}
+
+/**
+ * Handle SUBSCRIBE request (metrics are then pushed from the main loop)
+ */
+static void handle_subscribe(const devproto_message_t *msg)
+{
+    devproto_message_t ack;
+    uint8_t ack_buf[DEVPROTO_SUB_ACK_SIZE];
+
+    int rc = devproto_sub_handle(subscriptions, msg, &ack, ack_buf);
+    printf("  -> Received SUBSCRIBE (%s, %zu active)\n",
+           rc == 0 ? "accepted" : "rejected", devproto_sub_count(subscriptions));
+
+    send_response(&ack);
+}
+
+/**
+ * Firmware sink: (re)create the staging image
+ */
+static int firmware_begin(void *user, uint32_t image_size)
+{
+    (void)user;
+    if (firmware_fd >= 0) close(firmware_fd);
+
+    firmware_fd = open(firmware_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (firmware_fd < 0 || ftruncate(firmware_fd, image_size) != 0) return -1;
+
+    printf("  -> Firmware update started (%u bytes)\n", image_size);
+    return 0;
+}
+
+/**
+ * Firmware sink: write one verified chunk in place
+ */
+static int firmware_write(void *user, uint32_t offset, const uint8_t *data, size_t len)
+{
+    (void)user;
+    if (firmware_fd < 0) return -1;
+    return pwrite(firmware_fd, data, len, offset) == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * Firmware sink: image complete and CRC-checked
+ */
+static int firmware_finish(void *user, uint32_t image_size)
+{
+    (void)user;
+    if (firmware_fd < 0 || fsync(firmware_fd) != 0) return -1;
+
+    printf("  -> Firmware image ready: %s (%u bytes)\n", firmware_path, image_size);
+    return 0;
+}
+
+/**
+ * Handle UPDATE_FIRMWARE request
+ */
+static void handle_firmware(const devproto_message_t *msg)
+{
+    devproto_message_t ack;
+    uint8_t ack_buf[DEVPROTO_FW_ACK_SIZE];
+
+    if (devproto_fw_receiver_handle(firmware, msg, &ack, ack_buf) < 0) {
+        printf("  -> Malformed UPDATE_FIRMWARE\n");
+        return;
+    }
+    send_response(&ack);
 }
 
 /**
@@ -270,7 +380,18 @@ static void handle_message(devproto_message_t *msg)
         break;
 
     case DEVPROTO_MSG_EXECUTE_COMMAND:
-        handle_command(msg->sequence, msg->payload, msg->payload_len);
+        /* Queued for the worker; the parser buffer is copied */
+        if (devproto_frame_queue_push(command_queue, msg) != 0) {
+            printf("  -> Command queue full, dropping command\n");
+        }
+        break;
+
+    case DEVPROTO_MSG_SUBSCRIBE:
+        handle_subscribe(msg);
+        break;
+
+    case DEVPROTO_MSG_UPDATE_FIRMWARE:
+        handle_firmware(msg);
         break;
 
     default:
@@ -279,6 +400,24 @@ static void handle_message(devproto_message_t *msg)
     }
 }
 
+/**
+ * Command worker: runs queued commands off the receive path
+ */
+static void *command_worker(void *arg)
+{
+    (void)arg;
+
+    while (running) {
+        devproto_frame_queue_item_t item;
+        if (devproto_frame_queue_pop(command_queue, &item, -1) != 1) continue;
+
+        handle_command(item.msg.sequence, item.msg.payload, item.msg.payload_len);
+        devproto_frame_queue_release(command_queue, &item);
+    }
+
+    return NULL;
+}
+
 /**
  * Check thresholds and send alerts if needed
  */
@@ -298,27 +437,62 @@ static void check_thresholds(void)
 static void main_loop(void)
 {
     uint8_t rx_buffer[1024];
+    static uint8_t rx_storage[DEVPROTO_MAX_FRAME_SIZE];
+    devproto_frame_slab_t rx_slab;
     time_t last_check = time(NULL);
 
+    devproto_frame_slab_init(&rx_slab, rx_storage, sizeof(rx_storage));
     printf("Device ready, waiting for commands...\n\n");
 
     while (running) {
-        /* Receive data */
-        int n = devproto_transport_recv(transport, rx_buffer, sizeof(rx_buffer), 100);
-
-        if (n > 0) {
+        /* Receive data, waking up in time for the next sample or push */
+        int timeout = devproto_sub_next_timeout(subscriptions);
+        int sample_due = devproto_sampler_next_timeout(sampler);
+        if (timeout < 0 || (sample_due >= 0 && sample_due < timeout)) timeout = sample_due;
+        if (timeout < 0 || timeout > 100) timeout = 100;
+
+        int n = devproto_transport_recv(transport, rx_buffer, sizeof(rx_buffer), timeout);
+
+        /* Frames may span reads: keep parser state, and hand out payloads
+         * from a slab so back-to-back frames in one read stay intact */
+        size_t off = 0;
+        while (n > 0 && off < (size_t)n) {
             devproto_message_t msgs[4];
-            int count = devproto_frame_parse(&parser, rx_buffer, n, msgs, 4);
+            size_t used = 0;
 
+            devproto_frame_slab_reset(&rx_slab);
+            int count = devproto_frame_parse_slab(&parser, rx_buffer + off, (size_t)n - off,
+                                                  &rx_slab, msgs, 4, &used);
             for (int i = 0; i < count; i++) {
                 handle_message(&msgs[i]);
             }
-            devproto_frame_parser_reset(&parser);
-        } else if (n < 0) {
+            if (count <= 0 || used == 0) break;
+            off += used;
+        }
+
+        if (n < 0) {
             fprintf(stderr, "Receive error, reconnecting...\n");
             break;
         }
 
+        /* Refresh sensors that are due */
+        devproto_sampler_refresh(sampler);
+
+        /* Push subscribed metrics */
+        if (devproto_sub_count(subscriptions) > 0) {
+            devproto_metric_t metrics[DEVPROTO_SAMPLER_MAX_METRICS];
+            int count = devproto_sampler_snapshot(sampler, metrics, DEVPROTO_SAMPLER_MAX_METRICS);
+            if (count > 0) {
+                devproto_sub_update(subscriptions, metrics, (size_t)count);
+            }
+            pthread_mutex_lock(&tx_lock);
+            int pushed = devproto_sub_poll(subscriptions, transport);
+            pthread_mutex_unlock(&tx_lock);
+            if (pushed < 0) {
+                fprintf(stderr, "Failed to push metrics\n");
+            }
+        }
+
         /* Periodic tasks */
         time_t now = time(NULL);
         if (now - last_check >= ALERT_CHECK_INTERVAL) {
@@ -340,6 +514,8 @@ static void usage(const char *prog)
     printf("  --serial DEV   Serial device (default: %s)\n", DEFAULT_SERIAL_PORT);
     printf("  --baud RATE    Serial baud rate (default: 115200)\n");
     printf("  --tcp PORT     Run as TCP server on PORT (for testing)\n");
+    printf("  --firmware F   Staging file for firmware updates (default: %s)\n",
+           DEFAULT_FIRMWARE_PATH);
     printf("  --help         Show this help\n");
     printf("\n");
     printf("This is an example MIPS device firmware that responds to\n");
@@ -360,6 +536,8 @@ int main(int argc, char *argv[])
             baudrate = atoi(argv[++i]);
         } else if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc) {
             tcp_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--firmware") == 0 && i + 1 < argc) {
+            firmware_path = argv[++i];
         } else if (strcmp(argv[i], "--help") == 0) {
             usage(argv[0]);
             return 0;
@@ -402,14 +580,53 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    /* Initialize parser */
+    /* Initialize parser, subscription and sampler state */
     devproto_frame_parser_init(&parser);
 
+    static const devproto_fw_sink_t firmware_sink = {
+        .begin = firmware_begin,
+        .write = firmware_write,
+        .finish = firmware_finish
+    };
+
+    subscriptions = devproto_sub_create();
+    sampler = devproto_sampler_create();
+    firmware = devproto_fw_receiver_create(&firmware_sink);
+    if (!subscriptions || !sampler || !firmware || setup_sampler() != 0) {
+        fprintf(stderr, "Failed to set up device state\n");
+        devproto_fw_receiver_destroy(firmware);
+        devproto_sampler_destroy(sampler);
+        devproto_sub_destroy(subscriptions);
+        devproto_transport_destroy(transport);
+        return 1;
+    }
+
+    pthread_t worker;
+    command_queue = devproto_frame_queue_create(COMMAND_QUEUE_SIZE,
+                                                DEVPROTO_FRAME_QUEUE_SPSC, NULL);
+    if (!command_queue || pthread_create(&worker, NULL, command_worker, NULL) != 0) {
+        fprintf(stderr, "Failed to start command worker\n");
+        devproto_frame_queue_destroy(command_queue);
+        devproto_fw_receiver_destroy(firmware);
+        devproto_sampler_destroy(sampler);
+        devproto_sub_destroy(subscriptions);
+        devproto_transport_destroy(transport);
+        return 1;
+    }
+
     /* Run main loop */
     main_loop();
 
     /* Cleanup */
     printf("\nShutting down...\n");
+    running = 0;
+    devproto_frame_queue_wake(command_queue);
+    pthread_join(worker, NULL);
+    devproto_frame_queue_destroy(command_queue);
+    devproto_fw_receiver_destroy(firmware);
+    if (firmware_fd >= 0) close(firmware_fd);
+    devproto_sampler_destroy(sampler);
+    devproto_sub_destroy(subscriptions);
     devproto_transport_close(transport);
     devproto_transport_destroy(transport);
 
@@ -45,6 +45,20 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
         offset += chunk;
     }
 
+    /* Test 4: Pooled parser with extended-length and compressed frames enabled */
+    static devproto_frame_pool_t *pool;
+    if (!pool) pool = devproto_frame_pool_create(0);
+    devproto_frame_pooled_parser_t *jumbo = devproto_frame_pooled_create(pool);
+    if (jumbo) {
+        devproto_frame_pooled_set_max_payload(jumbo, DEVPROTO_JUMBO_MAX_PAYLOAD);
+        devproto_frame_pooled_set_decompress(jumbo, 1);
+        for (offset = 0; offset < size; offset += 64) {
+            size_t chunk = (size - offset) > 64 ? 64 : (size - offset);
+            devproto_frame_pooled_parse(jumbo, data + offset, chunk, messages, 16);
+        }
+        devproto_frame_pooled_destroy(jumbo);
+    }
+
     return 0;
 }
 
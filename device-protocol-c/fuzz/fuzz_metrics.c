@@ -0,0 +1,79 @@
+/**
+ * @file fuzz_metrics.c
+ * @brief Fuzz testing for metrics payload decoders (legacy, SoA, compact)
+ *
+ * Build with:
+ *   clang -fsanitize=fuzzer,address -I../include -o fuzz_metrics ../src/*.c fuzz_metrics.c
+ *
+ * Run:
+ *   ./fuzz_metrics corpus/ -max_len=4096
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "devproto/metrics.h"
+
+/* libFuzzer entry point */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static devproto_metrics_decoder_t dec;
+    static devproto_metric_t metrics[256];
+    static uint8_t types[1024];
+    static float values[1024];
+
+    /* Test 1: Legacy and SoA decoders agree on entry count */
+    int aos = devproto_metrics_parse(data, size, metrics, 256);
+    int soa = devproto_metrics_parse_soa(data, size, types, values, 256);
+    if (size > 0 && aos != soa) __builtin_trap();
+
+    /* Test 2: Compact decoder, fresh and with state from a previous input */
+    devproto_metrics_parse_compact(&dec, data, size, metrics, 256);
+    devproto_metrics_decoder_ack(&dec);
+
+    /* Test 3: Request payloads */
+    uint8_t ack_id;
+    const uint8_t *req_types;
+    size_t num_types;
+    if (devproto_metrics_request_parse(data, size, &ack_id, &req_types, &num_types) >= 0 &&
+        num_types > 0 && (req_types < data || req_types + num_types > data + size)) {
+        __builtin_trap();
+    }
+
+    return 0;
+}
+
+#ifdef STANDALONE_MAIN
+/* For testing without fuzzer */
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror("fopen");
+        return 1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = malloc(fsize);
+    if (!data) {
+        fclose(f);
+        return 1;
+    }
+
+    fread(data, 1, fsize, f);
+    fclose(f);
+
+    int result = LLVMFuzzerTestOneInput(data, fsize);
+    free(data);
+    return result;
+}
+#endif
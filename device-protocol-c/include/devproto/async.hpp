@@ -0,0 +1,302 @@
+/**
+ * @file async.hpp
+ * @brief C++20 coroutine wrappers over async session requests
+ *
+ * A devproto::loop drives one reactor and the deadlines of the sessions
+ * registered with it; devproto::session::request() returns an awaitable
+ * built on devproto_session_request_async(). The awaiter lives in the
+ * coroutine frame and the request record is pooled by the session, so an
+ * awaited request performs no heap allocation in steady state:
+ *
+ *     devproto::task poll_site(devproto::session &site, int &done)
+ *     {
+ *         devproto_message_t ping;
+ *         devproto_create_ping(&ping, 0);
+ *         auto pong = co_await site.request(ping, std::chrono::milliseconds(500));
+ *
+ *         devproto_message_t status;
+ *         devproto_create_status_request(&status, 0);
+ *         auto st = co_await site.request(status, std::chrono::milliseconds(500));
+ *         if (pong && st) handle(st.payload, st.payload_len);
+ *         done++;
+ *     }
+ *
+ *     devproto::loop loop;
+ *     devproto::session site(loop, transport);
+ *     int done = 0;
+ *     poll_site(site, done);
+ *     loop.run_until([&] { return done == 1; });
+ *
+ * Coroutines resume on the loop thread, inside devproto::loop::run_once().
+ * Like the C API this is single-threaded; destroy sessions outside of
+ * resumed coroutines.
+ */
+
+#ifndef DEVPROTO_ASYNC_HPP
+#define DEVPROTO_ASYNC_HPP
+
+#if !defined(__cplusplus) || __cplusplus < 202002L
+#error "devproto/async.hpp requires C++20"
+#endif
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+
+#include "error.h"
+#include "reactor.h"
+#include "session.h"
+
+namespace devproto {
+
+/* Response payload kept by default (larger replies report DEVPROTO_ERR_OVERFLOW) */
+inline constexpr std::size_t default_response_capacity = 512;
+
+/**
+ * Result of an awaited request; the payload is copied out of the parser
+ */
+template <std::size_t Capacity = default_response_capacity>
+struct response {
+    int      status = DEVPROTO_ERR_CLOSED;  /* DEVPROTO_OK or a negative error */
+    uint8_t  msg_type = 0;
+    uint8_t  sequence = 0;
+    uint16_t payload_len = 0;               /* Full length, even on overflow */
+    uint8_t  payload[Capacity];
+
+    explicit operator bool() const noexcept { return status == DEVPROTO_OK; }
+};
+
+/**
+ * Awaitable for one request (returned by session::request())
+ */
+template <std::size_t Capacity>
+class request_op {
+public:
+    request_op(devproto_session_t *s, const devproto_message_t &msg,
+               int64_t deadline_ms) noexcept
+        : s_(s), msg_(msg), deadline_ms_(deadline_ms) {}
+
+    request_op(const request_op &) = delete;
+    request_op &operator=(const request_op &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    /* Returns false (resume at once) if the request was refused */
+    bool await_suspend(std::coroutine_handle<> waiter) noexcept
+    {
+        if (!s_) {
+            result_.status = DEVPROTO_ERR_CLOSED;
+            return false;
+        }
+
+        waiter_ = waiter;
+        int rc = devproto_session_request_async(s_, &msg_, deadline_ms_,
+                                                &request_op::complete, this);
+        if (rc < 0) {
+            result_.status = rc;
+            return false;
+        }
+        return true;
+    }
+
+    response<Capacity> await_resume() const noexcept { return result_; }
+
+private:
+    static void complete(devproto_session_t *, int status,
+                         const devproto_message_t *resp, void *user) noexcept
+    {
+        auto *op = static_cast<request_op *>(user);
+
+        op->result_.status = status;
+        if (resp) {
+            op->result_.msg_type = resp->msg_type;
+            op->result_.sequence = resp->sequence;
+            op->result_.payload_len = resp->payload_len;
+            if (resp->payload_len > Capacity) {
+                op->result_.status = DEVPROTO_ERR_OVERFLOW;
+            } else if (resp->payload_len > 0) {
+                std::memcpy(op->result_.payload, resp->payload, resp->payload_len);
+            }
+        }
+        op->waiter_.resume();
+    }
+
+    devproto_session_t *s_;
+    devproto_message_t msg_;
+    int64_t deadline_ms_;
+    std::coroutine_handle<> waiter_;
+    response<Capacity> result_;
+};
+
+/**
+ * Fire-and-forget coroutine: runs eagerly, frees its frame on return
+ */
+struct task {
+    struct promise_type {
+        task get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+class session;
+
+/**
+ * Reactor plus the deadlines of its sessions
+ */
+class loop {
+public:
+    /* Owns a new reactor (check with operator bool) */
+    loop() noexcept : r_(devproto_reactor_create()), owned_(true) {}
+
+    /* Drives an existing reactor (not owned) */
+    explicit loop(devproto_reactor_t *r) noexcept : r_(r), owned_(false) {}
+
+    ~loop()
+    {
+        if (owned_) devproto_reactor_destroy(r_);
+    }
+
+    loop(const loop &) = delete;
+    loop &operator=(const loop &) = delete;
+
+    explicit operator bool() const noexcept { return r_ != nullptr; }
+    devproto_reactor_t *reactor() const noexcept { return r_; }
+
+    /**
+     * Wait for I/O or the earliest request deadline, dispatch and expire
+     * @param timeout_ms  Maximum wait (-1 = until something happens)
+     * @return            Messages delivered, or -1 on reactor error
+     */
+    int run_once(int timeout_ms = -1) noexcept;
+
+    /* Run until done() is true; false on reactor error */
+    template <class Done>
+    bool run_until(Done done)
+    {
+        while (!done()) {
+            if (run_once() < 0) return false;
+        }
+        return true;
+    }
+
+private:
+    friend class session;
+
+    devproto_reactor_t *r_;
+    bool owned_;
+    session *sessions_ = nullptr;
+};
+
+/**
+ * Session on a transport registered with a loop's reactor
+ */
+class session {
+public:
+    /* Registers t with the loop (check with operator bool) */
+    session(loop &l, devproto_transport_t *t, std::size_t window = 16) noexcept
+        : loop_(l), t_(t), s_(devproto_session_create(t, window))
+    {
+        if (!s_) return;
+        if (devproto_reactor_add(loop_.r_, t_, &session::on_message,
+                                 &session::on_close, this) != 0) {
+            devproto_session_destroy(s_);
+            s_ = nullptr;
+            return;
+        }
+        next_ = loop_.sessions_;
+        loop_.sessions_ = this;
+    }
+
+    /* Unregisters the transport (not closed); pending requests get DEVPROTO_ERR_CLOSED */
+    ~session()
+    {
+        if (s_) {
+            devproto_reactor_remove(loop_.r_, t_);
+            shutdown();
+        }
+    }
+
+    session(const session &) = delete;
+    session &operator=(const session &) = delete;
+
+    /* False once the connection failed */
+    explicit operator bool() const noexcept { return s_ != nullptr; }
+    devproto_session_t *get() const noexcept { return s_; }
+    devproto_transport_t *transport() const noexcept { return t_; }
+
+    /**
+     * Awaitable request; the message payload only has to outlive the co_await
+     * @param msg      Request message
+     * @param timeout  Deadline relative to now, including time spent queued
+     */
+    template <std::size_t Capacity = default_response_capacity>
+    request_op<Capacity> request(const devproto_message_t &msg,
+                                 std::chrono::milliseconds timeout) noexcept
+    {
+        return {s_, msg, devproto_session_clock_ms() + timeout.count()};
+    }
+
+private:
+    friend class loop;
+
+    static void on_message(devproto_reactor_t *, devproto_transport_t *,
+                           const devproto_message_t *msg, void *user) noexcept
+    {
+        auto *self = static_cast<session *>(user);
+        if (self->s_) devproto_session_on_message(self->s_, msg);
+    }
+
+    static void on_close(devproto_reactor_t *, devproto_transport_t *,
+                         void *user) noexcept
+    {
+        static_cast<session *>(user)->shutdown();
+    }
+
+    /* Unlink and fail outstanding requests; resumed coroutines see a closed session */
+    void shutdown() noexcept
+    {
+        for (session **p = &loop_.sessions_; *p; p = &(*p)->next_) {
+            if (*p == this) {
+                *p = next_;
+                break;
+            }
+        }
+
+        devproto_session_t *s = s_;
+        s_ = nullptr;
+        devproto_session_destroy(s);
+    }
+
+    loop &loop_;
+    devproto_transport_t *t_;
+    devproto_session_t *s_;
+    session *next_ = nullptr;
+};
+
+inline int loop::run_once(int timeout_ms) noexcept
+{
+    int wait = timeout_ms;
+    for (session *s = sessions_; s; s = s->next_) {
+        int left = devproto_session_next_timeout(s->s_);
+        if (left >= 0 && (wait < 0 || left < wait)) wait = left;
+    }
+
+    int n = devproto_reactor_run_once(r_, wait);
+
+    for (session *s = sessions_; s;) {
+        session *next = s->next_;
+        devproto_session_expire(s->s_);
+        s = next;
+    }
+    return n;
+}
+
+} /* namespace devproto */
+
+#endif /* DEVPROTO_ASYNC_HPP */
@@ -0,0 +1,216 @@
+/**
+ * @file capture.h
+ * @brief Capture files of recorded link traffic, and reading them back
+ *
+ * A capture attached to a transport with devproto_transport_set_capture()
+ * records every chunk its send and receive calls move, stamped with the
+ * time of the call and the connection id given at attach time. One capture
+ * may serve many transports (each its own id) on several threads.
+ * Chunk boundaries are kept as the transport delivered them, so a replay
+ * tears frames exactly as the field link did.
+ *
+ * Readers map the file and hand out records in place, without copying. A
+ * capture that was never finished (process killed, disk full) stays
+ * readable up to its last whole record. devproto_transport_replay_create()
+ * feeds one connection of a capture back to a parser, session or reactor
+ * loop at the recorded pace, faster, or as fast as it can.
+ *
+ * File layout, all integers big-endian like the wire protocol:
+ *   Header (32 bytes):
+ *     [magic "DPCP"][version: u16][header size: u16]
+ *     [start time: u64, us since the epoch][index offset: u64][records: u64]
+ *   Record (16 bytes + data), one per transport call:
+ *     [time: u64, us since start][length: u32][conn: u16][dir: u8][flags: u8]
+ *   Index (written by devproto_capture_finish(), offset 0 until then):
+ *     [magic "DPIX"][conns: u32][seek entries: u32][seek interval: u32]
+ *     [records: u64][duration: u64, us]
+ *     conns x [conn: u16][0: u16][0: u32][records in: u64][records out: u64]
+ *             [bytes in: u64][bytes out: u64]
+ *     seek entries x [time: u64][record offset: u64], one every
+ *             seek interval records
+ */
+
+#ifndef DEVPROTO_CAPTURE_H
+#define DEVPROTO_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVPROTO_CAPTURE_VERSION        1
+#define DEVPROTO_CAPTURE_HEADER_SIZE    32
+#define DEVPROTO_CAPTURE_RECORD_HEADER  16
+
+/* Write buffer of a capture; larger records are written straight through */
+#define DEVPROTO_CAPTURE_BUFFER         (64 * 1024)
+
+/* Records between index seek entries */
+#define DEVPROTO_CAPTURE_SEEK_INTERVAL  1024
+
+/**
+ * Direction of a record, seen from the side that recorded it
+ */
+typedef enum {
+    DEVPROTO_CAPTURE_IN  = 0,           /* Returned by a receive */
+    DEVPROTO_CAPTURE_OUT = 1            /* Accepted by a send */
+} devproto_capture_dir_t;
+
+/* Opaque capture writer and reader handles */
+typedef struct devproto_capture devproto_capture_t;
+typedef struct devproto_capture_reader devproto_capture_reader_t;
+
+/**
+ * One record, pointing into the mapped file
+ */
+typedef struct {
+    uint64_t       time_us;             /* Microseconds since capture start */
+    uint32_t       len;                 /* Data bytes */
+    uint16_t       conn;                /* Connection id */
+    uint8_t        dir;                 /* devproto_capture_dir_t */
+    const uint8_t *data;                /* Valid until the reader is destroyed */
+} devproto_capture_entry_t;
+
+/**
+ * Totals of one connection
+ */
+typedef struct {
+    uint16_t conn;
+    uint64_t records_in;
+    uint64_t records_out;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} devproto_capture_conn_t;
+
+/**
+ * Summary of a capture file
+ */
+typedef struct {
+    uint64_t start_time_us;             /* Wall clock at capture start, us since the epoch */
+    uint64_t duration_us;               /* Time of the last record */
+    uint64_t records;                   /* Records in the file */
+    size_t   conn_count;                /* Connections, see devproto_capture_reader_conn() */
+    int      indexed;                   /* 0 if recovered by scanning an unfinished file */
+} devproto_capture_info_t;
+
+/* ---- Writing ---- */
+
+/**
+ * Create a capture file
+ * @param path  File to create (truncated if it exists)
+ * @return      Capture handle, or NULL on error
+ */
+devproto_capture_t *devproto_capture_create(const char *path);
+
+/**
+ * Append one record (thread-safe)
+ * @param cap   Capture handle
+ * @param conn  Connection id
+ * @param dir   DEVPROTO_CAPTURE_IN or DEVPROTO_CAPTURE_OUT
+ * @param data  Bytes moved
+ * @param len   Number of bytes
+ * @return      0 on success, -1 on error
+ *
+ * After a write error the capture drops every further record and
+ * devproto_capture_finish() reports the failure.
+ */
+int devproto_capture_record(devproto_capture_t *cap, uint16_t conn,
+                            devproto_capture_dir_t dir, const uint8_t *data, size_t len);
+
+/**
+ * Append the first len bytes of a buffer list as one record (thread-safe)
+ * @param cap     Capture handle
+ * @param conn    Connection id
+ * @param dir     DEVPROTO_CAPTURE_IN or DEVPROTO_CAPTURE_OUT
+ * @param iov     Buffers in order
+ * @param iovcnt  Number of buffers
+ * @param len     Bytes to take from them (what a sendv returned)
+ * @return        0 on success, -1 on error
+ */
+int devproto_capture_recordv(devproto_capture_t *cap, uint16_t conn, devproto_capture_dir_t dir,
+                             const struct iovec *iov, int iovcnt, size_t len);
+
+/**
+ * Write buffered records to the file, so a crash loses none of them
+ * @param cap  Capture handle
+ * @return     0 on success, -1 on error
+ */
+int devproto_capture_flush(devproto_capture_t *cap);
+
+/**
+ * Write the index and close the file
+ * @param cap  Capture handle
+ * @return     0 if every record reached the file, -1 on error
+ *
+ * Detach the capture from its transports first; records after this are
+ * dropped.
+ */
+int devproto_capture_finish(devproto_capture_t *cap);
+
+/**
+ * Destroy a capture, finishing it if that was not done
+ * @param cap  Capture handle
+ */
+void devproto_capture_destroy(devproto_capture_t *cap);
+
+/* ---- Reading ---- */
+
+/**
+ * Map a capture file
+ * @param path  Capture file
+ * @return      Reader handle, or NULL if the file is missing or not a capture
+ */
+devproto_capture_reader_t *devproto_capture_reader_open(const char *path);
+
+/**
+ * Unmap a capture file
+ * @param r  Reader handle
+ */
+void devproto_capture_reader_destroy(devproto_capture_reader_t *r);
+
+/**
+ * Get the summary of a capture
+ * @param r     Reader handle
+ * @param info  Output summary
+ */
+void devproto_capture_reader_info(const devproto_capture_reader_t *r,
+                                  devproto_capture_info_t *info);
+
+/**
+ * Get the totals of one connection
+ * @param r  Reader handle
+ * @param i  Index (< info.conn_count), in order of first appearance
+ * @return   Connection totals, or NULL if out of range
+ */
+const devproto_capture_conn_t *devproto_capture_reader_conn(const devproto_capture_reader_t *r,
+                                                            size_t i);
+
+/**
+ * Read the record at a cursor and advance it
+ * @param r       Reader handle (thread-safe, each thread with its own cursor)
+ * @param cursor  Position; 0 starts at the first record
+ * @param entry   Output record
+ * @return        1 for a record, 0 at the end, -1 if the file is damaged
+ */
+int devproto_capture_reader_next(const devproto_capture_reader_t *r, size_t *cursor,
+                                 devproto_capture_entry_t *entry);
+
+/**
+ * Find the first record at or after a time
+ * @param r        Reader handle
+ * @param time_us  Microseconds since capture start
+ * @return         Cursor for devproto_capture_reader_next()
+ *
+ * Uses the index seek entries, so the scan covers at most
+ * DEVPROTO_CAPTURE_SEEK_INTERVAL records of an indexed file.
+ */
+size_t devproto_capture_reader_seek(const devproto_capture_reader_t *r, uint64_t time_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_CAPTURE_H */
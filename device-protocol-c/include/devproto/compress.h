@@ -0,0 +1,147 @@
+/**
+ * @file compress.h
+ * @brief Optional per-frame payload compression
+ *
+ * Command results and logs are mostly text, and over a 115200 baud serial
+ * link they compress well. Once DEVPROTO_CAP_COMPRESSION has been
+ * negotiated, a sender may compress a payload above a size threshold and
+ * mark the frame with DEVPROTO_COMPRESS_FLAG in the first length byte,
+ * which legacy parsers reject as oversized. The compressed payload is:
+ *
+ *   [codec: 1][original length: u16 BE][compressed bytes]
+ *
+ * The length field and the CRC cover the compressed payload. Two codecs
+ * are built in:
+ *   - DEVPROTO_CODEC_LZ4: LZ4 block format, the codec DEVPROTO_CAP_COMPRESSION
+ *     promises. Its encoder uses an 8 KiB hash table on the stack. Both
+ *     directions are checked against reference liblz4 blocks in
+ *     tests/test_compress.c.
+ *   - DEVPROTO_CODEC_HEATSHRINK: heatshrink LZSS bitstream with an 8-bit
+ *     window and 4-bit lookahead (heatshrink -w8 -l4). The encoder uses no
+ *     memory beyond the input. Its vectors are derived from the bit layout,
+ *     not produced by the reference implementation, so the capability does
+ *     not cover it: select it only when both ends run this library.
+ * A payload that does not shrink is sent as is.
+ *
+ * Compression is set per link with devproto_transport_set_compression().
+ * The send helpers then compress into frame pool blocks, and parsers owned
+ * by sessions and reactors decompress into a pooled block. Steady traffic
+ * therefore recycles blocks and does not allocate.
+ */
+
+#ifndef DEVPROTO_COMPRESS_H
+#define DEVPROTO_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVPROTO_COMPRESS_FLAG          0x40    /* In the first length byte */
+#define DEVPROTO_COMPRESS_HEADER_SIZE   3       /* codec + original length */
+
+/* Payloads smaller than this are never compressed by default */
+#define DEVPROTO_COMPRESS_THRESHOLD_DEFAULT 256
+
+/**
+ * Payload codecs
+ */
+typedef enum {
+    DEVPROTO_CODEC_NONE       = 0,      /* Send uncompressed, still decode */
+    DEVPROTO_CODEC_HEATSHRINK = 1,
+    DEVPROTO_CODEC_LZ4        = 2
+} devproto_codec_t;
+
+/* Encoder used by devproto_compress_config_init() (what the capability promises) */
+#define DEVPROTO_CODEC_DEFAULT  DEVPROTO_CODEC_LZ4
+
+/**
+ * Link compression settings
+ */
+typedef struct devproto_compress_config {
+    devproto_codec_t codec;             /* Encoder for outgoing payloads */
+    size_t threshold;                   /* Smallest payload worth compressing */
+    devproto_frame_pool_t *pool;        /* Scratch blocks (shared, must outlive the link) */
+} devproto_compress_config_t;
+
+/**
+ * Initialize default settings
+ * @param cfg   Settings to fill
+ * @param pool  Frame pool for scratch blocks
+ */
+void devproto_compress_config_init(devproto_compress_config_t *cfg,
+                                   devproto_frame_pool_t *pool);
+
+/**
+ * Worst-case compressed size of len bytes
+ * @param codec  Codec
+ * @param len    Input length
+ * @return       Bytes the output buffer needs for any input
+ */
+size_t devproto_compress_bound(devproto_codec_t codec, size_t len);
+
+/**
+ * Compress a buffer
+ * @param codec  DEVPROTO_CODEC_HEATSHRINK or DEVPROTO_CODEC_LZ4
+ * @param src    Input
+ * @param len    Input length (at most 65535)
+ * @param dst    Output
+ * @param cap    Output capacity
+ * @return       Compressed length, or -1 if it does not fit cap or the
+ *               codec is unknown
+ */
+int devproto_compress(devproto_codec_t codec, const uint8_t *src, size_t len,
+                      uint8_t *dst, size_t cap);
+
+/**
+ * Decompress a buffer
+ * @param codec  Codec the data was compressed with
+ * @param src    Compressed data
+ * @param len    Compressed length
+ * @param dst    Output
+ * @param cap    Output capacity
+ * @return       Decompressed length, or -1 if the data is corrupt or does
+ *               not fit cap
+ */
+int devproto_decompress(devproto_codec_t codec, const uint8_t *src, size_t len,
+                        uint8_t *dst, size_t cap);
+
+/**
+ * Build a compressed payload (header + data)
+ * @param codec  Codec
+ * @param src    Original payload
+ * @param len    Original length (at most 65535)
+ * @param dst    Output
+ * @param cap    Output capacity
+ * @return       Compressed payload length, or -1 if it would not be
+ *               smaller than len (send uncompressed)
+ */
+int devproto_payload_compress(devproto_codec_t codec, const uint8_t *src, size_t len,
+                              uint8_t *dst, size_t cap);
+
+/**
+ * Original length recorded in a compressed payload
+ * @return  Length, or -1 if the header is truncated
+ */
+int devproto_payload_original_size(const uint8_t *src, size_t len);
+
+/**
+ * Expand a compressed payload
+ * @param src  Compressed payload (header + data)
+ * @param len  Its length
+ * @param dst  Output
+ * @param cap  Output capacity
+ * @return     Original length, or -1 if corrupt, of an unknown codec or
+ *             larger than cap
+ */
+int devproto_payload_decompress(const uint8_t *src, size_t len,
+                                uint8_t *dst, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_COMPRESS_H */
@@ -21,6 +21,36 @@ extern "C" {
 #define DEVPROTO_CRC_INITIAL    0xFFFF
 #define DEVPROTO_CRC_POLYNOMIAL 0x1021
 
+/*
+ * Compile-time CRC kernel selection (make CRC_IMPL=bitwise|table|slice8)
+ *   BITWISE - no lookup tables, smallest footprint
+ *   TABLE   - 256-entry table (512 bytes)
+ *   SLICE8  - 8x256-entry tables (4 KiB), 8 bytes per iteration
+ *
+ * Without DEVPROTO_CRC_IMPL this header falls back to TABLE. The Makefile
+ * picks SLICE8 on the host and TABLE for MIPS cross builds. On x86_64 and
+ * aarch64 the library also carries a carry-less multiply kernel, chosen at
+ * run time when the CPU has it; devproto_crc16_set_kernel() overrides that
+ * choice.
+ */
+#define DEVPROTO_CRC_IMPL_BITWISE 1
+#define DEVPROTO_CRC_IMPL_TABLE   2
+#define DEVPROTO_CRC_IMPL_SLICE8  3
+
+#ifndef DEVPROTO_CRC_IMPL
+#define DEVPROTO_CRC_IMPL DEVPROTO_CRC_IMPL_TABLE
+#endif
+
+/**
+ * CRC kernels (for benchmarking and explicit selection)
+ */
+typedef enum {
+    DEVPROTO_CRC16_KERNEL_BITWISE = 0,  /* Bit-at-a-time reference */
+    DEVPROTO_CRC16_KERNEL_TABLE   = 1,  /* 256-entry table */
+    DEVPROTO_CRC16_KERNEL_SLICE8  = 2,  /* Slice-by-8 tables */
+    DEVPROTO_CRC16_KERNEL_CLMUL   = 3   /* PCLMULQDQ (x86_64) / PMULL (aarch64) folding */
+} devproto_crc16_kernel_t;
+
 /**
  * Calculate CRC-16-CCITT checksum (byte-by-byte)
  * @param data  Input data
@@ -30,7 +60,10 @@ extern "C" {
 uint16_t devproto_crc16(const uint8_t *data, size_t len);
 
 /**
- * Calculate CRC-16-CCITT checksum (table-driven, faster)
+ * Calculate CRC-16-CCITT checksum (fastest available kernel)
+ *
+ * Uses the carry-less multiply kernel when the CPU supports it (detected
+ * on first call), otherwise the kernel selected by DEVPROTO_CRC_IMPL.
  * @param data  Input data
  * @param len   Data length
  * @return      16-bit CRC value
@@ -39,6 +72,8 @@ uint16_t devproto_crc16_fast(const uint8_t *data, size_t len);
 
 /**
  * Update CRC with additional data (for streaming)
+ *
+ * Uses the same kernel as devproto_crc16_fast().
  * @param crc   Current CRC value (start with DEVPROTO_CRC_INITIAL)
  * @param data  Additional data
  * @param len   Data length
@@ -46,6 +81,44 @@ uint16_t devproto_crc16_fast(const uint8_t *data, size_t len);
  */
 uint16_t devproto_crc16_update(uint16_t crc, const uint8_t *data, size_t len);
 
+/**
+ * Check if a kernel is compiled in and supported by the running CPU
+ * @param kernel  Kernel identifier
+ * @return        1 if available, 0 otherwise
+ */
+int devproto_crc16_kernel_available(devproto_crc16_kernel_t kernel);
+
+/**
+ * Update CRC using a specific kernel (results identical for all kernels)
+ * @param kernel  Kernel identifier (must be available)
+ * @param crc     Current CRC value
+ * @param data    Additional data
+ * @param len     Data length
+ * @return        Updated CRC value, or crc unchanged if kernel unavailable
+ */
+uint16_t devproto_crc16_kernel_update(devproto_crc16_kernel_t kernel, uint16_t crc,
+                                      const uint8_t *data, size_t len);
+
+/**
+ * Get the kernel used by devproto_crc16_fast() and devproto_crc16_update()
+ */
+devproto_crc16_kernel_t devproto_crc16_active_kernel(void);
+
+/**
+ * Choose the kernel used by devproto_crc16_fast() and devproto_crc16_update()
+ * @param kernel  Kernel identifier (must be available)
+ * @return        0 on success, -1 if the kernel is unavailable
+ *
+ * Builds without the carry-less multiply kernel dispatch at compile time
+ * and accept only the compiled kernel.
+ */
+int devproto_crc16_set_kernel(devproto_crc16_kernel_t kernel);
+
+/**
+ * Get kernel name (e.g. "slice8", "pclmulqdq")
+ */
+const char *devproto_crc16_kernel_name(devproto_crc16_kernel_t kernel);
+
 #ifdef __cplusplus
 }
 #endif
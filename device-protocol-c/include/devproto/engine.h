@@ -0,0 +1,165 @@
+/**
+ * @file engine.h
+ * @brief Sharded multi-threaded ingest engine over per-thread reactors
+ *
+ * The engine owns N shards, each a worker thread running its own reactor
+ * (epoll/kqueue set). A connection, with its frame parser, belongs to one
+ * shard at a time, so its bytes are parsed on one core with a warm cache
+ * and its callbacks never run concurrently.
+ *
+ * Work moves between shards in whole connections: every rebalance interval
+ * each shard publishes its load (messages handled in the last interval),
+ * and the least loaded shard steals a connection from the busiest one when
+ * they differ by more than the configured imbalance. The parser moves with
+ * the connection, so a frame split across the move is not lost. Parsing a
+ * single connection's stream is inherently sequential, so this is the
+ * finest unit that can be stolen without reordering its messages.
+ */
+
+#ifndef DEVPROTO_ENGINE_H
+#define DEVPROTO_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Upper bound on shards */
+#define DEVPROTO_ENGINE_MAX_SHARDS          64
+
+/* Default rebalance interval */
+#define DEVPROTO_ENGINE_REBALANCE_MS        1000
+
+/* Opaque engine handle */
+typedef struct devproto_engine devproto_engine_t;
+
+/**
+ * Message callback, run on the connection's shard thread;
+ * msg->payload is only valid during the call
+ */
+typedef void (*devproto_engine_message_fn)(devproto_engine_t *e,
+                                           devproto_transport_t *t,
+                                           const devproto_message_t *msg,
+                                           void *user);
+
+/**
+ * Close callback: the connection failed and has been removed from the
+ * engine; destroying the transport here is allowed
+ */
+typedef void (*devproto_engine_close_fn)(devproto_engine_t *e,
+                                         devproto_transport_t *t,
+                                         void *user);
+
+/**
+ * Engine configuration
+ */
+typedef struct {
+    size_t   shards;                    /* Worker threads (0 = one per online CPU) */
+    int      rebalance_ms;              /* Load sampling interval (0 = never rebalance) */
+    uint32_t imbalance_pct;             /* Steal when busiest exceeds idlest by this
+                                           share of the busiest load */
+    uint32_t min_load;                  /* Ignore differences below this many messages */
+    int      pin_threads;               /* Bind shard i to CPU i (Linux) */
+} devproto_engine_config_t;
+
+/**
+ * Per-shard statistics (published once per rebalance interval)
+ */
+typedef struct {
+    uint32_t connections;               /* Connections owned now */
+    uint64_t messages;                  /* Messages delivered */
+    uint64_t bytes;                     /* Payload bytes delivered */
+    uint32_t load;                      /* Messages in the last interval */
+    uint32_t stolen;                    /* Connections taken from other shards */
+    uint32_t given;                     /* Connections handed to other shards */
+} devproto_engine_shard_stats_t;
+
+/**
+ * Aggregate statistics
+ */
+typedef struct {
+    size_t   shards;
+    uint32_t connections;
+    uint64_t messages;
+    uint64_t bytes;
+    double   messages_per_s;            /* Over the last interval */
+    double   bytes_per_s;
+    uint32_t migrations;
+} devproto_engine_stats_t;
+
+/**
+ * Initialize default configuration
+ * @param cfg  Configuration to fill
+ */
+void devproto_engine_config_init(devproto_engine_config_t *cfg);
+
+/**
+ * Create an engine and start its shard threads
+ * @param cfg  Configuration (NULL = defaults)
+ * @return     Engine handle, or NULL on error
+ */
+devproto_engine_t *devproto_engine_create(const devproto_engine_config_t *cfg);
+
+/**
+ * Stop the shard threads and destroy the engine
+ * @param e  Engine handle (registered transports are not closed)
+ *
+ * Must not be called from a shard thread.
+ */
+void devproto_engine_destroy(devproto_engine_t *e);
+
+/**
+ * Hand an open transport to the engine (thread-safe)
+ * @param e           Engine handle
+ * @param t           Open transport with a valid fd
+ * @param on_message  Called for each complete message
+ * @param on_close    Called once when the connection fails (may be NULL)
+ * @param user        Passed to the callbacks
+ * @return            0 on success, -1 on error
+ *
+ * The connection goes to the shard with the fewest connections and is
+ * registered there asynchronously. Do not use the transport from other
+ * threads afterwards, except through devproto_engine_remove().
+ */
+int devproto_engine_add(devproto_engine_t *e, devproto_transport_t *t,
+                        devproto_engine_message_fn on_message,
+                        devproto_engine_close_fn on_close, void *user);
+
+/**
+ * Take a transport back from the engine
+ * @param e  Engine handle
+ * @param t  Transport handle
+ * @return   0 on success, -1 if not registered or called from a shard
+ *           thread for another shard's connection
+ *
+ * Returns once no shard uses the transport any more. From a callback, only
+ * the callback's own connection may be removed.
+ */
+int devproto_engine_remove(devproto_engine_t *e, devproto_transport_t *t);
+
+/**
+ * Get aggregate statistics (thread-safe)
+ * @param e      Engine handle
+ * @param stats  Output statistics
+ */
+void devproto_engine_get_stats(devproto_engine_t *e, devproto_engine_stats_t *stats);
+
+/**
+ * Get one shard's statistics (thread-safe)
+ * @param e      Engine handle
+ * @param shard  Shard index
+ * @param stats  Output statistics
+ * @return       0 on success, -1 if shard is out of range
+ */
+int devproto_engine_get_shard_stats(devproto_engine_t *e, size_t shard,
+                                    devproto_engine_shard_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_ENGINE_H */
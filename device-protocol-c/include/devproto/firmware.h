@@ -0,0 +1,219 @@
+/**
+ * @file firmware.h
+ * @brief Windowed firmware transfer over UPDATE_FIRMWARE / FIRMWARE_ACK
+ *
+ * The host streams an image in fixed-size chunks, keeping up to `window`
+ * chunks unacknowledged. Every chunk is its own session request, so a lost
+ * or damaged chunk is retransmitted alone when its ack reports an error or
+ * its deadline passes.
+ *
+ * Each chunk carries the running CRC-16 of the image before and after it.
+ * The device checks the chunk against its own pair and checks that the
+ * pairs chain from the first chunk onwards. When the chain reaches the end
+ * of the image, the whole image is verified without reading flash back.
+ * Chunks are written to flash as they arrive (out-of-order ones at their
+ * offset), so the device only holds one frame in RAM.
+ *
+ * UPDATE_FIRMWARE payload, first byte is the operation:
+ *   BEGIN: [op][flags][image size: u32 BE][image crc: u16 BE][chunk size: u16 BE]
+ *   DATA:  [op][offset: u32 BE][crc before: u16 BE][crc after: u16 BE][bytes]
+ *   END:   [op][image crc: u16 BE]
+ * FIRMWARE_ACK payload:
+ *   [op][status][offset: u32 BE][crc: u16 BE]
+ * For BEGIN, offset/crc give the verified prefix the device already has,
+ * which is where an interrupted transfer of the same image resumes. For
+ * DATA, offset echoes the chunk.
+ */
+
+#ifndef DEVPROTO_FIRMWARE_H
+#define DEVPROTO_FIRMWARE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+#include "session.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVPROTO_FW_OP_BEGIN        0x01
+#define DEVPROTO_FW_OP_DATA         0x02
+#define DEVPROTO_FW_OP_END          0x03
+
+#define DEVPROTO_FW_FLAG_RESTART    0x01    /* Discard a partial transfer */
+
+#define DEVPROTO_FW_STATUS_OK       0x00
+#define DEVPROTO_FW_STATUS_CRC      0x01    /* Chunk damaged: retransmit */
+#define DEVPROTO_FW_STATUS_WINDOW   0x02    /* Chunk too far ahead: retransmit */
+#define DEVPROTO_FW_STATUS_STATE    0x03    /* No transfer in progress */
+#define DEVPROTO_FW_STATUS_FLASH    0x04    /* Sink failed: abort */
+#define DEVPROTO_FW_STATUS_IMAGE    0x05    /* CRC chain broken or image incomplete */
+
+#define DEVPROTO_FW_BEGIN_SIZE      10
+#define DEVPROTO_FW_DATA_HEADER     9
+#define DEVPROTO_FW_END_SIZE        3
+#define DEVPROTO_FW_ACK_SIZE        8
+
+/* Largest chunk that fits one frame; chunks over DEVPROTO_FW_CHUNK_LEGACY
+ * need DEVPROTO_CAP_JUMBO_FRAMES on the link */
+#define DEVPROTO_FW_CHUNK_MAX       (DEVPROTO_JUMBO_MAX_PAYLOAD - DEVPROTO_FW_DATA_HEADER)
+#define DEVPROTO_FW_CHUNK_LEGACY    (DEVPROTO_MAX_PAYLOAD_SIZE - DEVPROTO_FW_DATA_HEADER)
+#define DEVPROTO_FW_CHUNK_DEFAULT   2048
+
+/* Chunks the device tracks beyond its verified prefix (and host window limit) */
+#define DEVPROTO_FW_MAX_WINDOW      32
+#define DEVPROTO_FW_WINDOW_DEFAULT  8
+
+/* ---- Host side ---- */
+
+/* Opaque sender handle */
+typedef struct devproto_fw_sender devproto_fw_sender_t;
+
+/**
+ * Sender configuration
+ */
+typedef struct {
+    uint16_t chunk_size;                /* Bytes per DATA frame (1..DEVPROTO_FW_CHUNK_MAX) */
+    uint8_t  window;                    /* Chunks in flight (1..DEVPROTO_FW_MAX_WINDOW) */
+    int      timeout_ms;                /* Ack deadline per frame */
+    int      max_retries;               /* Retransmissions per chunk before giving up */
+    int      resume;                    /* Continue a partial transfer of the same image */
+} devproto_fw_config_t;
+
+/**
+ * Sender statistics
+ */
+typedef struct {
+    uint32_t image_size;
+    uint32_t acked_bytes;               /* Bytes the device has acknowledged */
+    uint32_t resumed_from;              /* Offset the last start continued from */
+    uint32_t chunks_sent;               /* DATA frames, including retransmissions */
+    uint32_t retransmits;
+} devproto_fw_stats_t;
+
+/**
+ * Completion callback, called once per start when no frame is outstanding
+ * @param fw      Sender
+ * @param status  DEVPROTO_OK, or the error that stopped the transfer
+ *                (DEVPROTO_ERR_CLOSED when the session went away: start
+ *                again on a new session to resume)
+ * @param user    Value given to devproto_fw_sender_start()
+ */
+typedef void (*devproto_fw_done_fn)(devproto_fw_sender_t *fw, int status, void *user);
+
+/**
+ * Initialize default configuration
+ * @param cfg  Configuration to fill
+ */
+void devproto_fw_config_init(devproto_fw_config_t *cfg);
+
+/**
+ * Create a sender for an image file, which is mapped read-only
+ * @param path  Image file
+ * @param cfg   Configuration (NULL = defaults)
+ * @return      Sender handle, or NULL on error
+ */
+devproto_fw_sender_t *devproto_fw_sender_open(const char *path,
+                                              const devproto_fw_config_t *cfg);
+
+/**
+ * Create a sender for an image in memory
+ * @param image  Image bytes (not copied; must outlive the sender)
+ * @param size   Image size (> 0)
+ * @param cfg    Configuration (NULL = defaults)
+ * @return       Sender handle, or NULL on error
+ */
+devproto_fw_sender_t *devproto_fw_sender_create(const uint8_t *image, size_t size,
+                                                const devproto_fw_config_t *cfg);
+
+/**
+ * Destroy a sender (only while no transfer is outstanding)
+ * @param fw  Sender handle
+ */
+void devproto_fw_sender_destroy(devproto_fw_sender_t *fw);
+
+/**
+ * Start or resume the transfer on a session
+ * @param fw    Sender handle
+ * @param s     Session on the device link (window >= the sender's)
+ * @param fn    Completion callback (may be NULL)
+ * @param user  Passed to the callback
+ * @return      0 if BEGIN was sent, DEVPROTO_ERR_BUSY if a transfer is
+ *              outstanding, or another negative error
+ *
+ * The transfer then advances from the session's callbacks; keep feeding
+ * the session (devproto_session_process() or a reactor) until done.
+ */
+int devproto_fw_sender_start(devproto_fw_sender_t *fw, devproto_session_t *s,
+                             devproto_fw_done_fn fn, void *user);
+
+/**
+ * Run a whole transfer on a session, blocking
+ * @param fw  Sender handle
+ * @param s   Session on the device link
+ * @return    DEVPROTO_OK, or the error that stopped the transfer
+ */
+int devproto_fw_sender_run(devproto_fw_sender_t *fw, devproto_session_t *s);
+
+/**
+ * Get sender statistics
+ */
+void devproto_fw_sender_get_stats(const devproto_fw_sender_t *fw,
+                                  devproto_fw_stats_t *stats);
+
+/* ---- Device side ---- */
+
+/* Opaque receiver handle */
+typedef struct devproto_fw_receiver devproto_fw_receiver_t;
+
+/**
+ * Flash sink; each returns 0 on success
+ */
+typedef struct {
+    int  (*begin)(void *user, uint32_t image_size);   /* Prepare (erase) the target */
+    int  (*write)(void *user, uint32_t offset, const uint8_t *data, size_t len);
+    int  (*finish)(void *user, uint32_t image_size);  /* Image verified: activate */
+    void *user;
+} devproto_fw_sink_t;
+
+/**
+ * Create a receiver
+ * @param sink  Flash callbacks (copied)
+ * @return      Receiver handle, or NULL on error
+ */
+devproto_fw_receiver_t *devproto_fw_receiver_create(const devproto_fw_sink_t *sink);
+
+/**
+ * Destroy a receiver
+ */
+void devproto_fw_receiver_destroy(devproto_fw_receiver_t *rx);
+
+/**
+ * Apply an UPDATE_FIRMWARE request and prepare its FIRMWARE_ACK
+ * @param rx       Receiver
+ * @param request  Received UPDATE_FIRMWARE message
+ * @param ack      Out: acknowledgement to send
+ * @param ack_buf  Payload storage for ack (DEVPROTO_FW_ACK_SIZE bytes)
+ * @return         The DEVPROTO_FW_STATUS_* code sent, or DEVPROTO_ERR_INVALID
+ *                 if request is not a well-formed UPDATE_FIRMWARE
+ */
+int devproto_fw_receiver_handle(devproto_fw_receiver_t *rx,
+                                const devproto_message_t *request,
+                                devproto_message_t *ack, uint8_t *ack_buf);
+
+/**
+ * Get transfer progress
+ * @param rx          Receiver
+ * @param verified    Out: bytes verified from the start of the image (may be NULL)
+ * @param image_size  Out: size of the current image, 0 if none (may be NULL)
+ * @return            1 if the image was completed and finished, 0 otherwise
+ */
+int devproto_fw_receiver_progress(const devproto_fw_receiver_t *rx,
+                                  uint32_t *verified, uint32_t *image_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_FIRMWARE_H */
@@ -5,7 +5,7 @@
  * State machine based parser that handles:
  * - Frame synchronization (finding 0xAA55 header)
  * - Partial frame assembly
- * - CRC verification
+ * - CRC verification (incremental, as bytes arrive)
  * - Multiple messages in single buffer
  */
 
@@ -14,7 +14,10 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <sys/uio.h>
 #include "protocol.h"
+#include "frame_pool.h"
+#include "compress.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,6 +30,8 @@ typedef enum {
     DEVPROTO_FRAME_STATE_IDLE,          /* Waiting for header byte 0 */
     DEVPROTO_FRAME_STATE_HEADER_LO,     /* Got 0xAA, waiting for 0x55 */
     DEVPROTO_FRAME_STATE_LENGTH_HI,     /* Waiting for length MSB */
+    DEVPROTO_FRAME_STATE_LENGTH_X2,     /* Extended length: waiting for byte 2 */
+    DEVPROTO_FRAME_STATE_LENGTH_X1,     /* Extended length: waiting for byte 1 */
     DEVPROTO_FRAME_STATE_LENGTH_LO,     /* Waiting for length LSB */
     DEVPROTO_FRAME_STATE_TYPE,          /* Waiting for message type */
     DEVPROTO_FRAME_STATE_SEQUENCE,      /* Waiting for sequence number */
@@ -44,17 +49,27 @@ typedef enum {
     DEVPROTO_FRAME_OK = 0,
     DEVPROTO_FRAME_ERR_CRC = -1,        /* CRC mismatch */
     DEVPROTO_FRAME_ERR_OVERFLOW = -2,   /* Payload too large */
-    DEVPROTO_FRAME_ERR_INVALID = -3     /* Invalid input */
+    DEVPROTO_FRAME_ERR_INVALID = -3,    /* Invalid input */
+    DEVPROTO_FRAME_ERR_DECOMPRESS = -4  /* Compressed payload corrupt */
 } devproto_frame_error_t;
 
+/* Inline payload bytes of a pooled parser; larger payloads use the pool */
+#ifndef DEVPROTO_FRAME_COMPACT_PAYLOAD
+#define DEVPROTO_FRAME_COMPACT_PAYLOAD  128
+#endif
+
 /**
  * Frame parser context
+ *
+ * Payloads follow the header in `buffer` (6 bytes, or 8 for an
+ * extended-length frame); `payload` points at them there, at a block
+ * borrowed from `pool`, or at a caller slab.
  */
 typedef struct {
     devproto_frame_state_t state;       /* Current parser state */
     uint8_t  buffer[DEVPROTO_MAX_FRAME_SIZE];  /* Frame buffer */
     size_t   buffer_pos;                /* Current position in buffer */
-    uint16_t expected_length;           /* Expected payload length */
+    uint32_t expected_length;           /* Expected payload length */
     size_t   payload_received;          /* Bytes of payload received */
 
     /* Current frame being parsed */
@@ -66,14 +81,101 @@ typedef struct {
     uint32_t frames_parsed;
     uint32_t crc_errors;
     uint32_t sync_errors;
+
+    uint32_t max_payload;               /* Largest accepted payload */
+    uint8_t  *payload;                  /* Payload storage (buffer, pool block or slab) */
+    uint16_t crc_calc;                  /* Running CRC over header + payload */
+    uint32_t decompress_errors;
+
+    /* Payloads beyond the buffer (jumbo frames) borrow a pool block */
+    devproto_frame_pool_t *pool;        /* NULL unless given one */
+    uint8_t  *borrowed;                 /* Block held from pool, or NULL */
+    size_t   borrowed_size;             /* Size of borrowed block */
+
+    /* Compressed frames: flag of the current frame, expanded payload block */
+    uint8_t  decompress;                /* Accept compressed frames */
+    uint8_t  compressed;
+    uint8_t  *inflated;
+    size_t   inflated_size;
 } devproto_frame_parser_t;
 
+/**
+ * Pooled parser: a compact parser with DEVPROTO_HEADER_SIZE +
+ * DEVPROTO_FRAME_COMPACT_PAYLOAD bytes of buffer (~300 bytes instead of
+ * ~4.3 KiB) that borrows larger payload buffers from a shared pool. Opaque;
+ * use the devproto_frame_pooled_*() functions.
+ */
+typedef struct devproto_frame_pooled_parser devproto_frame_pooled_parser_t;
+
+/**
+ * Parser statistics
+ */
+typedef struct {
+    uint32_t frames_parsed;
+    uint32_t crc_errors;
+    uint32_t sync_errors;
+    uint32_t decompress_errors;
+} devproto_frame_stats_t;
+
+/**
+ * Caller-owned payload slab for devproto_frame_parse_slab()
+ *
+ * Payloads of completed frames are laid out back to back in `data` and stay
+ * valid until the caller resets the slab. No frame in progress refers to the
+ * slab between calls, so it may be reset, or shared by several parsers,
+ * whenever its messages are no longer needed.
+ */
+typedef struct {
+    uint8_t *data;                      /* Caller storage */
+    size_t   size;                      /* Storage size */
+    size_t   used;                      /* Bytes holding completed payloads */
+} devproto_frame_slab_t;
+
 /**
  * Initialize/reset frame parser
  * @param parser  Parser context
  */
 void devproto_frame_parser_init(devproto_frame_parser_t *parser);
 
+/**
+ * Return pool blocks a parser holds (before discarding or freeing it)
+ * @param parser  Parser context that was given a pool
+ */
+void devproto_frame_parser_release(devproto_frame_parser_t *parser);
+
+/**
+ * Set the largest accepted payload, enabling extended-length frames
+ * @param parser       Parser context (between frames)
+ * @param max_payload  DEVPROTO_MAX_PAYLOAD_SIZE (legacy frames only) up to
+ *                     DEVPROTO_JUMBO_MAX_PAYLOAD
+ * @param pool         Pool for payloads beyond the parser buffer; NULL keeps the
+ *                     parser's own (required for going over
+ *                     DEVPROTO_MAX_PAYLOAD_SIZE). Must outlive the parser.
+ * @return             0 on success, DEVPROTO_FRAME_ERR_INVALID if out of range
+ *                     or no pool is available
+ *
+ * Extended-length frames are accepted while max_payload is above
+ * DEVPROTO_MAX_PAYLOAD_SIZE. Payloads that do not fit the parser buffer are
+ * borrowed from the pool, so parser memory only grows while one is in use.
+ */
+int devproto_frame_parser_set_max_payload(devproto_frame_parser_t *parser,
+                                          size_t max_payload,
+                                          devproto_frame_pool_t *pool);
+
+/**
+ * Accept compressed frames (DEVPROTO_CAP_COMPRESSION)
+ * @param parser  Parser context (between frames)
+ * @param enable  Nonzero to expand compressed frames, 0 to reject them
+ * @param pool    Pool for expanded payloads; NULL keeps the parser's own.
+ *                Must outlive the parser.
+ * @return        0 on success, DEVPROTO_FRAME_ERR_INVALID if no pool is available
+ *
+ * Expanded payloads are handed out from a pool block that stays valid like
+ * any other payload of the same call (copied into the slab when it fits).
+ */
+int devproto_frame_parser_set_decompress(devproto_frame_parser_t *parser, int enable,
+                                         devproto_frame_pool_t *pool);
+
 /**
  * Reset parser to initial state (clear buffer and state)
  * @param parser  Parser context
@@ -89,14 +191,55 @@ void devproto_frame_parser_reset(devproto_frame_parser_t *parser);
  * @param max_messages  Maximum messages to return
  * @return              Number of complete messages, or negative on error
  *
- * Note: Caller is responsible for freeing payload buffers in out_messages
- * if they were dynamically allocated.
+ * Note: Payloads point into the parser buffer, which is reused by the next
+ * frame; with more than one message per call only the last payload is
+ * intact. Use devproto_frame_parse_slab() for stable payloads.
  */
 int devproto_frame_parse(devproto_frame_parser_t *parser,
                          const uint8_t *data, size_t len,
                          devproto_message_t *out_messages,
                          size_t max_messages);
 
+/**
+ * Initialize a payload slab over caller storage
+ * @param slab     Slab to initialize
+ * @param storage  Backing memory
+ * @param size     Backing memory size
+ */
+void devproto_frame_slab_init(devproto_frame_slab_t *slab,
+                              uint8_t *storage, size_t size);
+
+/**
+ * Release all payloads held by a slab (invalidates earlier messages)
+ * @param slab  Slab
+ */
+void devproto_frame_slab_reset(devproto_frame_slab_t *slab);
+
+/**
+ * Feed data to parser, assembling payloads directly into a slab
+ * @param parser        Parser context
+ * @param data          Input data
+ * @param len           Data length
+ * @param slab          Payload slab
+ * @param out_messages  Output array for complete messages
+ * @param max_messages  Maximum messages to return
+ * @param consumed      Out: input bytes consumed (may be NULL)
+ * @return              Number of complete messages, or negative on error
+ *
+ * Every returned payload points into the slab and stays valid until
+ * devproto_frame_slab_reset(). A frame contained in this chunk is assembled
+ * in place; one that started in an earlier call is copied in on completion.
+ * Parsing stops early when max_messages is reached or the next payload does
+ * not fit the slab; feed the remaining data + *consumed again after handling
+ * the messages and resetting the slab. A payload larger than an empty slab
+ * stays in parser storage and is returned as the last message of the call.
+ */
+int devproto_frame_parse_slab(devproto_frame_parser_t *parser,
+                              const uint8_t *data, size_t len,
+                              devproto_frame_slab_t *slab,
+                              devproto_message_t *out_messages,
+                              size_t max_messages, size_t *consumed);
+
 /**
  * Feed single byte to parser (for byte-by-byte processing)
  * @param parser  Parser context
@@ -114,6 +257,53 @@ int devproto_frame_parse_byte(devproto_frame_parser_t *parser, uint8_t byte);
 int devproto_frame_get_message(devproto_frame_parser_t *parser,
                                devproto_message_t *msg);
 
+/* Maximum iovec entries of a scatter-gather frame (header, payload, CRC) */
+#define DEVPROTO_FRAME_IOV_MAX  3
+
+/**
+ * Scatter-gather frame: header and CRC bytes are held here, the payload
+ * entry points at the caller's message data (which must stay valid until
+ * the frame has been sent).
+ */
+typedef struct {
+    uint8_t      header[DEVPROTO_JUMBO_HEADER_SIZE];
+    uint8_t      crc[DEVPROTO_CRC_SIZE];
+    struct iovec iov[DEVPROTO_FRAME_IOV_MAX];
+    int          iovcnt;                /* Entries used in iov (2 or 3) */
+} devproto_frame_iov_t;
+
+/**
+ * Build a scatter-gather frame without copying the payload
+ * @param msg    Message to serialize
+ * @param frame  Output frame (iov/iovcnt ready for devproto_transport_sendv)
+ * @return       Frame length on success, negative on error
+ */
+int devproto_frame_build_iov(const devproto_message_t *msg,
+                             devproto_frame_iov_t *frame);
+
+/**
+ * Build a scatter-gather frame, with an extended-length header if needed
+ * @param msg          Message to serialize
+ * @param frame        Output frame
+ * @param max_payload  Largest payload allowed (devproto_transport_max_payload())
+ * @return             Frame length on success, negative on error
+ *
+ * Payloads up to DEVPROTO_MAX_PAYLOAD_SIZE always use the legacy header, so
+ * only frames a legacy peer could not take anyway change format.
+ */
+int devproto_frame_build_iov_max(const devproto_message_t *msg,
+                                 devproto_frame_iov_t *frame, size_t max_payload);
+
+/**
+ * Build a scatter-gather frame for an already compressed payload
+ * @param msg          Message whose payload came from devproto_payload_compress()
+ * @param frame        Output frame
+ * @param max_payload  Largest payload allowed (devproto_transport_max_payload())
+ * @return             Frame length on success, negative on error
+ */
+int devproto_frame_build_iov_compressed(const devproto_message_t *msg,
+                                        devproto_frame_iov_t *frame, size_t max_payload);
+
 /**
  * Build a frame from message (serialize)
  * @param msg       Message to serialize
@@ -124,6 +314,15 @@ int devproto_frame_get_message(devproto_frame_parser_t *parser,
 int devproto_frame_build(const devproto_message_t *msg,
                          uint8_t *buffer, size_t buf_size);
 
+/**
+ * Bytes still needed to complete the frame being parsed
+ * @param parser  Parser context
+ * @return        Remaining bytes including CRC; a minimum frame while idle
+ *
+ * Before the length field arrives this is a lower bound.
+ */
+size_t devproto_frame_remaining(const devproto_frame_parser_t *parser);
+
 /**
  * Get parser statistics
  */
@@ -135,6 +334,82 @@ static inline uint32_t devproto_frame_get_crc_errors(const devproto_frame_parser
     return parser->crc_errors;
 }
 
+/* ---- Pooled parser ---- */
+
+/**
+ * Create a pooled parser
+ * @param pool  Shared pool (must outlive the parser)
+ * @return      Initialized parser, or NULL on error
+ *
+ * A borrowed block is kept while its payload may still be referenced, i.e.
+ * until the next frame or the next parse call.
+ */
+devproto_frame_pooled_parser_t *devproto_frame_pooled_create(devproto_frame_pool_t *pool);
+
+/**
+ * Destroy a pooled parser, returning its blocks to the pool
+ * @param parser  Pooled parser, or NULL
+ */
+void devproto_frame_pooled_destroy(devproto_frame_pooled_parser_t *parser);
+
+/**
+ * Reset a pooled parser to its initial state (as devproto_frame_parser_reset())
+ * @param parser  Pooled parser
+ */
+void devproto_frame_pooled_reset(devproto_frame_pooled_parser_t *parser);
+
+/**
+ * Set the largest accepted payload (as devproto_frame_parser_set_max_payload(),
+ * with the parser's own pool)
+ * @param parser       Pooled parser (between frames)
+ * @param max_payload  DEVPROTO_MAX_PAYLOAD_SIZE up to DEVPROTO_JUMBO_MAX_PAYLOAD
+ * @return             0 on success, DEVPROTO_FRAME_ERR_INVALID if out of range
+ */
+int devproto_frame_pooled_set_max_payload(devproto_frame_pooled_parser_t *parser,
+                                          size_t max_payload);
+
+/**
+ * Accept compressed frames (as devproto_frame_parser_set_decompress())
+ * @param parser  Pooled parser (between frames)
+ * @param enable  Nonzero to expand compressed frames, 0 to reject them
+ * @return        0 on success, DEVPROTO_FRAME_ERR_INVALID on error
+ */
+int devproto_frame_pooled_set_decompress(devproto_frame_pooled_parser_t *parser, int enable);
+
+/**
+ * Feed data to a pooled parser (as devproto_frame_parse())
+ * @return  Number of complete messages, or negative on error
+ */
+int devproto_frame_pooled_parse(devproto_frame_pooled_parser_t *parser,
+                                const uint8_t *data, size_t len,
+                                devproto_message_t *out_messages,
+                                size_t max_messages);
+
+/**
+ * Feed data to a pooled parser, with payloads in a slab (as
+ * devproto_frame_parse_slab())
+ * @return  Number of complete messages, or negative on error
+ */
+int devproto_frame_pooled_parse_slab(devproto_frame_pooled_parser_t *parser,
+                                     const uint8_t *data, size_t len,
+                                     devproto_frame_slab_t *slab,
+                                     devproto_message_t *out_messages,
+                                     size_t max_messages, size_t *consumed);
+
+/**
+ * Bytes still needed to complete the frame being parsed (as
+ * devproto_frame_remaining())
+ */
+size_t devproto_frame_pooled_remaining(const devproto_frame_pooled_parser_t *parser);
+
+/**
+ * Get pooled parser statistics
+ * @param parser  Pooled parser
+ * @param stats   Output counters
+ */
+void devproto_frame_pooled_get_stats(const devproto_frame_pooled_parser_t *parser,
+                                     devproto_frame_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
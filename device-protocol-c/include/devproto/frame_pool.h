@@ -0,0 +1,84 @@
+/**
+ * @file frame_pool.h
+ * @brief Shared size-classed pool of large payload buffers
+ *
+ * Pooled (compact) frame parsers keep headers and small payloads inline and
+ * borrow a block from here only while a large frame is being assembled.
+ * One pool is typically shared by every parser of a process; all calls are
+ * thread-safe.
+ */
+
+#ifndef DEVPROTO_FRAME_POOL_H
+#define DEVPROTO_FRAME_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque pool handle */
+typedef struct devproto_frame_pool devproto_frame_pool_t;
+
+/* Block size classes (bytes) */
+#define DEVPROTO_FRAME_POOL_MIN_BLOCK   512
+#define DEVPROTO_FRAME_POOL_CLASSES     8       /* 512 .. 64K (jumbo frames) */
+
+/* Free blocks kept per class when max_cached is 0 */
+#define DEVPROTO_FRAME_POOL_DEFAULT_CACHED  64
+
+/**
+ * Pool statistics
+ */
+typedef struct {
+    uint32_t blocks_out;                /* Blocks currently borrowed */
+    uint32_t blocks_cached;             /* Free blocks held for reuse */
+    uint32_t allocations;               /* Blocks ever obtained from malloc */
+} devproto_frame_pool_stats_t;
+
+/**
+ * Create a pool
+ * @param max_cached  Free blocks kept per size class (0 = default)
+ * @return            Pool handle, or NULL on error
+ */
+devproto_frame_pool_t *devproto_frame_pool_create(size_t max_cached);
+
+/**
+ * Destroy a pool and its cached blocks
+ * @param pool  Pool handle (all borrowed blocks must be released first)
+ */
+void devproto_frame_pool_destroy(devproto_frame_pool_t *pool);
+
+/**
+ * Borrow a block of at least len bytes
+ * @param pool        Pool handle
+ * @param len         Required size (at most the largest class)
+ * @param block_size  Out: actual block size
+ * @return            Block, or NULL if len is too large or memory is exhausted
+ */
+uint8_t *devproto_frame_pool_acquire(devproto_frame_pool_t *pool, size_t len,
+                                     size_t *block_size);
+
+/**
+ * Return a block to the pool
+ * @param pool        Pool handle
+ * @param block       Block from devproto_frame_pool_acquire()
+ * @param block_size  Size reported by devproto_frame_pool_acquire()
+ */
+void devproto_frame_pool_release(devproto_frame_pool_t *pool, uint8_t *block,
+                                 size_t block_size);
+
+/**
+ * Get pool statistics
+ * @param pool   Pool handle
+ * @param stats  Output statistics
+ */
+void devproto_frame_pool_get_stats(devproto_frame_pool_t *pool,
+                                   devproto_frame_pool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_FRAME_POOL_H */
@@ -0,0 +1,132 @@
+/**
+ * @file frame_queue.h
+ * @brief Bounded lock-free queue of parsed frames between threads
+ *
+ * Lets an I/O thread keep receiving and parsing while handlers run on a
+ * worker thread: the I/O thread pushes each parsed message, the worker pops
+ * and handles it. Payloads are copied on push, inline up to
+ * DEVPROTO_FRAME_COMPACT_PAYLOAD bytes and into a frame pool block beyond
+ * that, so the parser buffer can be reused at once.
+ *
+ * A SPSC queue has exactly one pushing and one popping thread. A MPSC
+ * queue accepts pushes from any number of threads (e.g. one I/O thread per
+ * transport) and still has a single consumer; use one queue per worker to
+ * fan out. Push never blocks: a full queue drops the frame and counts it.
+ * All shared state is 32-bit atomics, which stay lock-free on MIPS32.
+ */
+
+#ifndef DEVPROTO_FRAME_QUEUE_H
+#define DEVPROTO_FRAME_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+#include "frame_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque queue handle */
+typedef struct devproto_frame_queue devproto_frame_queue_t;
+
+/**
+ * Producer model
+ */
+typedef enum {
+    DEVPROTO_FRAME_QUEUE_SPSC = 0,      /* One producer thread */
+    DEVPROTO_FRAME_QUEUE_MPSC = 1       /* Any number of producer threads */
+} devproto_frame_queue_mode_t;
+
+/**
+ * Popped frame
+ *
+ * msg.payload points into this item (small payloads) or into a pool block
+ * it owns, so the item must not be copied; hand it back with
+ * devproto_frame_queue_release() once handled.
+ */
+typedef struct {
+    devproto_message_t msg;
+    uint8_t *block;                     /* Pool block, NULL if inline */
+    size_t   block_size;
+    uint8_t  data[DEVPROTO_FRAME_COMPACT_PAYLOAD];
+} devproto_frame_queue_item_t;
+
+/**
+ * Queue statistics (32-bit counters, wrap around)
+ */
+typedef struct {
+    uint32_t pushed;                    /* Frames accepted */
+    uint32_t popped;                    /* Frames handed to the consumer */
+    uint32_t dropped;                   /* Frames refused (full or no memory) */
+    uint32_t depth;                     /* Frames queued now */
+    uint32_t high_water;                /* Largest depth seen */
+    uint32_t capacity;
+} devproto_frame_queue_stats_t;
+
+/**
+ * Create a queue
+ * @param capacity  Frames held (rounded up to a power of two)
+ * @param mode      DEVPROTO_FRAME_QUEUE_SPSC or DEVPROTO_FRAME_QUEUE_MPSC
+ * @param pool      Pool for large payloads (NULL = the queue creates its own)
+ * @return          Queue handle, or NULL on error
+ */
+devproto_frame_queue_t *devproto_frame_queue_create(size_t capacity,
+                                                    devproto_frame_queue_mode_t mode,
+                                                    devproto_frame_pool_t *pool);
+
+/**
+ * Destroy a queue, releasing frames still queued
+ * @param q  Queue handle (no thread may still use it)
+ */
+void devproto_frame_queue_destroy(devproto_frame_queue_t *q);
+
+/**
+ * Queue a copy of a message (producer side, never blocks)
+ * @param q    Queue handle
+ * @param msg  Parsed message; its payload is copied
+ * @return     0 on success, DEVPROTO_ERR_OVERFLOW if the queue is full,
+ *             DEVPROTO_ERR_NOMEM if no payload block is available,
+ *             DEVPROTO_ERR_INVALID on bad arguments
+ */
+int devproto_frame_queue_push(devproto_frame_queue_t *q, const devproto_message_t *msg);
+
+/**
+ * Take the oldest frame (consumer side)
+ * @param q           Queue handle
+ * @param item        Out: frame, valid until devproto_frame_queue_release()
+ * @param timeout_ms  Time to wait for a frame (0 = don't wait, -1 = forever)
+ * @return            1 if a frame was taken, 0 on timeout, or negative error
+ *
+ * Waiting sleeps on a condition variable that producers only signal while
+ * the consumer is asleep; the queue itself takes no lock.
+ */
+int devproto_frame_queue_pop(devproto_frame_queue_t *q, devproto_frame_queue_item_t *item,
+                             int timeout_ms);
+
+/**
+ * Return a popped frame's payload block to the pool
+ * @param q     Queue handle
+ * @param item  Item filled by devproto_frame_queue_pop()
+ */
+void devproto_frame_queue_release(devproto_frame_queue_t *q, devproto_frame_queue_item_t *item);
+
+/**
+ * Wake a consumer blocked in devproto_frame_queue_pop() (e.g. on shutdown)
+ * @param q  Queue handle
+ */
+void devproto_frame_queue_wake(devproto_frame_queue_t *q);
+
+/**
+ * Get queue statistics (any thread)
+ * @param q      Queue handle
+ * @param stats  Output statistics
+ */
+void devproto_frame_queue_get_stats(devproto_frame_queue_t *q,
+                                    devproto_frame_queue_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_FRAME_QUEUE_H */
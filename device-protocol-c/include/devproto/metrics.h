@@ -150,6 +150,40 @@ typedef enum {
     DEVPROTO_METRIC_ALL              = 0xFF
 } devproto_metric_type_t;
 
+/**
+ * Metric categories (registry grouping, follows the type code ranges)
+ */
+typedef enum {
+    DEVPROTO_METRIC_CAT_UNKNOWN = 0,
+    DEVPROTO_METRIC_CAT_SYSTEM,
+    DEVPROTO_METRIC_CAT_RF,
+    DEVPROTO_METRIC_CAT_PERFORMANCE,
+    DEVPROTO_METRIC_CAT_DEVICE,
+    DEVPROTO_METRIC_CAT_NR700,
+    DEVPROTO_METRIC_CAT_NR3500,
+    DEVPROTO_METRIC_CAT_NR_RADIO,
+    DEVPROTO_METRIC_CAT_RF_QUALITY,
+    DEVPROTO_METRIC_CAT_CARRIER_AGG,
+    DEVPROTO_METRIC_CAT_POWER,
+    DEVPROTO_METRIC_CAT_ENVIRONMENT,
+    DEVPROTO_METRIC_CAT_BACKHAUL,
+    DEVPROTO_METRIC_CAT_ADVANCED_RADIO,
+    DEVPROTO_METRIC_CAT_SLICING,
+    DEVPROTO_METRIC_CAT_COUNT
+} devproto_metric_category_t;
+
+/**
+ * Metric registry entry
+ */
+typedef struct {
+    const char *name;           /* Name string (as devproto_metric_name) */
+    const char *unit;           /* Unit (ASCII, e.g. "dBm", "degC", "%") */
+    float min;                  /* Valid range, inclusive */
+    float max;                  /* (INFINITY for unbounded counters) */
+    float resolution;           /* Compact encoding quantum (0 = exact float) */
+    uint8_t category;           /* devproto_metric_category_t */
+} devproto_metric_info_t;
+
 /**
  * Metric entry structure (5 bytes on wire: type + float)
  */
@@ -207,6 +241,36 @@ float devproto_float_from_be(const uint8_t *bytes);
  */
 const char *devproto_metric_name(devproto_metric_type_t type);
 
+/**
+ * Look up a metric's registry entry (O(1) table lookup)
+ * @param type  Metric type
+ * @return      Static entry, or NULL if the type code is unassigned
+ */
+const devproto_metric_info_t *devproto_metric_info(devproto_metric_type_t type);
+
+/**
+ * Get category name string (e.g. "nr3500")
+ * @param category  Category
+ * @return          Static string, or "unknown" if invalid
+ */
+const char *devproto_metric_category_name(devproto_metric_category_t category);
+
+/**
+ * Range-check a decoded batch against the registry
+ *
+ * An entry is valid when its type is registered under a category and the
+ * value lies within [min, max]; NaN is never valid. Pairs with
+ * devproto_metrics_parse_soa() output.
+ *
+ * @param types   Metric types
+ * @param values  Values
+ * @param count   Number of entries
+ * @param valid   Optional output, 1 per valid entry and 0 otherwise (may be NULL)
+ * @return        Number of valid entries
+ */
+size_t devproto_metrics_validate(const uint8_t *types, const float *values,
+                                 size_t count, uint8_t *valid);
+
 /**
  * Parse multiple metrics from response payload
  * @param payload       Payload data
@@ -218,6 +282,54 @@ const char *devproto_metric_name(devproto_metric_type_t type);
 int devproto_metrics_parse(const uint8_t *payload, size_t payload_len,
                            devproto_metric_t *metrics, size_t max_metrics);
 
+/**
+ * Bulk decode kernels (for benchmarking and explicit selection)
+ */
+typedef enum {
+    DEVPROTO_METRICS_KERNEL_SCALAR = 0,     /* Portable byte-at-a-time decode */
+    DEVPROTO_METRICS_KERNEL_SIMD   = 1      /* SSSE3 (x86_64) or NEON (aarch64) shuffle */
+} devproto_metrics_kernel_t;
+
+/**
+ * Parse metrics into structure-of-arrays output
+ *
+ * Same entries as devproto_metrics_parse(), written as parallel arrays to
+ * avoid the padded devproto_metric_t layout. Uses the SIMD kernel when the
+ * CPU supports it (detected on first call); results are bit-identical to
+ * the scalar kernel, including NaN payloads.
+ *
+ * @param payload       Payload data (5-byte entries)
+ * @param payload_len   Payload length (a trailing partial entry is ignored)
+ * @param types         Output metric types
+ * @param values        Output values
+ * @param max_metrics   Capacity of types/values
+ * @return              Number of metrics parsed, or -1 on error
+ */
+int devproto_metrics_parse_soa(const uint8_t *payload, size_t payload_len,
+                               uint8_t *types, float *values, size_t max_metrics);
+
+/**
+ * Parse metrics into structure-of-arrays output with a specific kernel
+ * @param kernel  Kernel identifier (must be available)
+ * @return        Number of metrics parsed, or -1 on error or if unavailable
+ */
+int devproto_metrics_parse_soa_kernel(devproto_metrics_kernel_t kernel,
+                                      const uint8_t *payload, size_t payload_len,
+                                      uint8_t *types, float *values,
+                                      size_t max_metrics);
+
+/**
+ * Check if a decode kernel is compiled in and supported by the running CPU
+ * @param kernel  Kernel identifier
+ * @return        1 if available, 0 otherwise
+ */
+int devproto_metrics_kernel_available(devproto_metrics_kernel_t kernel);
+
+/**
+ * Get decode kernel name (e.g. "scalar", "ssse3", "neon")
+ */
+const char *devproto_metrics_kernel_name(devproto_metrics_kernel_t kernel);
+
 /**
  * Build metrics response payload
  * @param metrics       Array of metrics to encode
@@ -229,6 +341,144 @@ int devproto_metrics_parse(const uint8_t *payload, size_t payload_len,
 int devproto_metrics_build(const devproto_metric_t *metrics, size_t num_metrics,
                            uint8_t *buffer, size_t buf_size);
 
+/* ========================================================================
+ * Compact metrics format (negotiated with DEVPROTO_CAP_COMPACT_METRICS)
+ *
+ * Response payload:
+ *   [0x00 marker][flags][snapshot id][baseline id, if DELTA]
+ *   [bitmap length N][N-byte bitmap of types, bit t = type t][entries]
+ *
+ * A legacy payload never starts with 0x00 (not a metric type). Entries follow
+ * the bitmap in ascending type order, one varint each: bit 0 selects the
+ * kind and the rest is the zigzag difference of the quantized value
+ * (round(value / resolution) from the registry) or, for exact entries, the
+ * float bits XOR the baseline's. A keyframe is relative to an empty
+ * baseline. A delta carries only the types that changed since the baseline
+ * snapshot the host last acknowledged; all other baseline types carry over.
+ *
+ * The host acknowledges snapshots in its compact REQUEST_METRICS payload:
+ *   [0x00 marker][ack id][requested types...]
+ * ======================================================================== */
+
+#define DEVPROTO_METRICS_COMPACT_MARKER 0x00
+#define DEVPROTO_METRICS_COMPACT_DELTA  0x01    /* Flags: baseline id follows */
+
+/**
+ * Codec snapshot (quantized values as both ends reconstruct them)
+ */
+typedef struct {
+    uint8_t  id;                /* Snapshot id (0 = empty) */
+    uint8_t  present[32];       /* Bitmap of types held */
+    uint8_t  exact[32];         /* Bitmap of types held as float bits */
+    uint32_t value[256];        /* Quantized value or float bits, by type */
+} devproto_metrics_snapshot_t;
+
+/**
+ * Compact encoder state (device side)
+ */
+typedef struct {
+    devproto_metrics_snapshot_t base;       /* Last acknowledged snapshot */
+    devproto_metrics_snapshot_t pending;    /* Last snapshot sent */
+    uint8_t next_id;
+} devproto_metrics_encoder_t;
+
+/**
+ * Compact decoder state (host side)
+ */
+typedef struct {
+    devproto_metrics_snapshot_t base;       /* Baseline the encoder refers to */
+    devproto_metrics_snapshot_t acked;      /* Acknowledged, not yet referenced */
+    devproto_metrics_snapshot_t last;       /* Most recently decoded */
+} devproto_metrics_decoder_t;
+
+/**
+ * Check whether a METRICS_RESPONSE payload uses the compact format
+ */
+static inline int devproto_metrics_is_compact(const uint8_t *payload, size_t len) {
+    return payload && len > 0 && payload[0] == DEVPROTO_METRICS_COMPACT_MARKER;
+}
+
+/**
+ * Initialize encoder state (first payload will be a keyframe)
+ */
+void devproto_metrics_encoder_init(devproto_metrics_encoder_t *enc);
+
+/**
+ * Record the host's acknowledgement
+ * @param enc          Encoder
+ * @param snapshot_id  Acknowledged id; 0 requests a keyframe
+ */
+void devproto_metrics_encoder_ack(devproto_metrics_encoder_t *enc, uint8_t snapshot_id);
+
+/**
+ * Build a compact metrics response payload
+ * @param enc           Encoder
+ * @param metrics       Current values (each type at most once)
+ * @param num_metrics   Number of metrics
+ * @param buffer        Output buffer
+ * @param buf_size      Buffer size
+ * @return              Number of bytes written, or -1 on error
+ */
+int devproto_metrics_build_compact(devproto_metrics_encoder_t *enc,
+                                   const devproto_metric_t *metrics, size_t num_metrics,
+                                   uint8_t *buffer, size_t buf_size);
+
+/**
+ * Initialize decoder state
+ */
+void devproto_metrics_decoder_init(devproto_metrics_decoder_t *dec);
+
+/**
+ * Parse a compact metrics response payload
+ *
+ * Outputs the full reconstructed snapshot in ascending type order.
+ * Quantized values are exact to half the type's registry resolution.
+ * A delta against an unknown baseline fails; the next
+ * devproto_metrics_decoder_ack() then returns 0 to request a keyframe.
+ *
+ * @param dec           Decoder
+ * @param payload       Payload data
+ * @param payload_len   Payload length
+ * @param metrics       Output array of metrics
+ * @param max_metrics   Maximum metrics to output
+ * @return              Number of metrics parsed, or -1 on error
+ */
+int devproto_metrics_parse_compact(devproto_metrics_decoder_t *dec,
+                                   const uint8_t *payload, size_t payload_len,
+                                   devproto_metric_t *metrics, size_t max_metrics);
+
+/**
+ * Acknowledge the most recently decoded snapshot
+ * @param dec  Decoder
+ * @return     Snapshot id to send in the next request (0 = need keyframe)
+ */
+uint8_t devproto_metrics_decoder_ack(devproto_metrics_decoder_t *dec);
+
+/**
+ * Build a compact REQUEST_METRICS payload
+ * @param ack_id        Snapshot acknowledgement (devproto_metrics_decoder_ack())
+ * @param types         Requested types (NULL for all)
+ * @param num_types     Number of requested types
+ * @param buffer        Output buffer
+ * @param buf_size      Buffer size
+ * @return              Number of bytes written, or -1 on error
+ */
+int devproto_metrics_request_build(uint8_t ack_id, const uint8_t *types, size_t num_types,
+                                   uint8_t *buffer, size_t buf_size);
+
+/**
+ * Parse a REQUEST_METRICS payload in either format
+ * @param payload       Payload data
+ * @param payload_len   Payload length
+ * @param ack_id        Out: acknowledgement (0 for legacy requests)
+ * @param types         Out: requested types (points into payload)
+ * @param num_types     Out: number of requested types
+ * @return              1 if compact, 0 if legacy, -1 on error
+ */
+int devproto_metrics_request_parse(const uint8_t *payload, size_t payload_len,
+                                   uint8_t *ack_id, const uint8_t **types,
+                                   size_t *num_types);
+
 #ifdef __cplusplus
 }
 #endif
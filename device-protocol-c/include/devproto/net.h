@@ -0,0 +1,331 @@
+/**
+ * @file net.h
+ * @brief Connection management for socket transports
+ *
+ * The building blocks TCP and TLS transports use to (re)connect without
+ * overloading the resolver or the gateway after an outage:
+ *
+ * - A resolver cache shared by all links of the process. Answers are kept
+ *   for a TTL; concurrent lookups of one name wait for a single
+ *   getaddrinfo() call; failures are remembered briefly; and when the
+ *   resolver itself is down, the last good answer keeps being served.
+ *   Non-blocking opens hand a miss to a helper thread and wait for it on
+ *   a descriptor, so a reactor thread never sits in getaddrinfo().
+ * - A happy-eyeballs connector (RFC 8305): addresses of both families are
+ *   tried in interleaved order with non-blocking connects, each getting a
+ *   short head start before the next one starts, under one overall
+ *   timeout. The first to connect wins.
+ * - Keepalive and TCP_USER_TIMEOUT settings, so a dead peer is noticed
+ *   within seconds instead of when the kernel gives up retransmitting.
+ * - Jittered exponential backoff for reconnect loops, so links that
+ *   dropped together do not come back in lockstep. Sessions use it with
+ *   devproto_session_set_reconnect(); reactor users call
+ *   devproto_backoff_next() from their close callback and reconnect with
+ *   devproto_reactor_connect() when the delay has passed.
+ */
+
+#ifndef DEVPROTO_NET_H
+#define DEVPROTO_NET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Addresses kept per name */
+#define DEVPROTO_NET_MAX_ADDRS          8
+
+/* Head start of each connection attempt (RFC 8305 recommends 250 ms) */
+#define DEVPROTO_NET_ATTEMPT_DELAY_MS   250
+
+/* Resolver cache defaults */
+#define DEVPROTO_RESOLVER_TTL_MS        30000
+#define DEVPROTO_RESOLVER_NEGATIVE_MS   5000
+#define DEVPROTO_RESOLVER_STALE_MS      (10 * 60 * 1000)
+#define DEVPROTO_RESOLVER_MAX_ENTRIES   256
+
+/**
+ * Resolved addresses, in the order to try them
+ */
+typedef struct {
+    size_t count;
+    struct sockaddr_storage addrs[DEVPROTO_NET_MAX_ADDRS];
+    socklen_t lens[DEVPROTO_NET_MAX_ADDRS];
+} devproto_addr_list_t;
+
+/* ---- Resolver cache ---- */
+
+/* Opaque resolver handle */
+typedef struct devproto_resolver devproto_resolver_t;
+
+/**
+ * Resolver configuration
+ */
+typedef struct {
+    int    ttl_ms;                  /* Reuse an answer this long */
+    int    negative_ttl_ms;         /* Fail lookups of a bad name this long without asking again */
+    int    stale_ms;                /* Serve an expired answer this much longer while lookups fail */
+    size_t max_entries;             /* Names kept (least recently used go first) */
+} devproto_resolver_config_t;
+
+/**
+ * Resolver counters
+ */
+typedef struct {
+    uint64_t hits;                  /* Answered from the cache */
+    uint64_t misses;                /* getaddrinfo() calls */
+    uint64_t joined;                /* Lookups that waited for another thread's call */
+    uint64_t stale;                 /* Expired answers served because the lookup failed */
+    uint64_t failures;              /* Lookups that returned no address */
+} devproto_resolver_stats_t;
+
+/**
+ * Initialize default resolver configuration
+ * @param cfg  Configuration structure to initialize
+ */
+void devproto_resolver_config_init(devproto_resolver_config_t *cfg);
+
+/**
+ * Create a resolver cache
+ * @param cfg  Configuration (NULL for defaults)
+ * @return     Resolver handle, or NULL on error
+ */
+devproto_resolver_t *devproto_resolver_create(const devproto_resolver_config_t *cfg);
+
+/**
+ * Destroy a resolver cache (no blocking lookup may be in progress)
+ * @param r  Resolver handle
+ *
+ * Waits for the helper threads of non-blocking lookups, cancelled ones
+ * included.
+ */
+void devproto_resolver_destroy(devproto_resolver_t *r);
+
+/**
+ * Get the process-wide resolver cache (created on first use, never destroyed)
+ * @return  Resolver handle, or NULL if it could not be created
+ */
+devproto_resolver_t *devproto_resolver_default(void);
+
+/**
+ * Resolve a host (thread-safe)
+ * @param r       Resolver handle
+ * @param host    Host name or numeric address
+ * @param port    Port number
+ * @param family  AF_UNSPEC, AF_INET or AF_INET6
+ * @param out     Addresses, families interleaved starting with the
+ *                resolver's preferred one
+ * @return        0 on success, -1 if the name has no address (errno
+ *                EHOSTUNREACH) or on error
+ *
+ * Blocks in getaddrinfo() on a cache miss; reactor threads use
+ * devproto_resolver_start() instead.
+ */
+int devproto_resolver_lookup(devproto_resolver_t *r, const char *host, int port, int family,
+                             devproto_addr_list_t *out);
+
+/**
+ * Forget all cached answers
+ * @param r  Resolver handle
+ */
+void devproto_resolver_flush(devproto_resolver_t *r);
+
+/**
+ * Get resolver counters
+ * @param r      Resolver handle
+ * @param stats  Output counters
+ */
+void devproto_resolver_get_stats(devproto_resolver_t *r, devproto_resolver_stats_t *stats);
+
+/* Opaque handle of a lookup left running on a helper thread */
+typedef struct devproto_resolve devproto_resolve_t;
+
+/**
+ * Resolve a host without blocking
+ * @param r        Resolver handle
+ * @param host     Host name or numeric address
+ * @param port     Port number
+ * @param family   AF_UNSPEC, AF_INET or AF_INET6
+ * @param out      Addresses when 0 is returned (as devproto_resolver_lookup())
+ * @param pending  Out: the lookup in progress when 1 is returned
+ * @return         0 when the cache or a numeric host answers at once, 1 when
+ *                 a helper thread is asking getaddrinfo(), -1 on failure
+ *                 (errno set)
+ *
+ * On 1, wait for devproto_resolve_fd(*pending) to become readable and
+ * collect the answer with devproto_resolve_finish(), or abandon it with
+ * devproto_resolve_cancel(). The lookup goes through the cache like a
+ * blocking one, so concurrent lookups of a name still share one call.
+ */
+int devproto_resolver_start(devproto_resolver_t *r, const char *host, int port, int family,
+                            devproto_addr_list_t *out, devproto_resolve_t **pending);
+
+/**
+ * Descriptor that becomes readable when the lookup has finished
+ * @param q  Pending lookup
+ * @return   File descriptor (owned by the lookup)
+ */
+int devproto_resolve_fd(const devproto_resolve_t *q);
+
+/**
+ * Collect a lookup started by devproto_resolver_start()
+ * @param q    Pending lookup
+ * @param out  Addresses on success
+ * @return     0 on success, 1 while still running, -1 if the name has no
+ *             address (errno set); q is freed unless 1 is returned
+ */
+int devproto_resolve_finish(devproto_resolve_t *q, devproto_addr_list_t *out);
+
+/**
+ * Abandon a pending lookup (its helper thread finishes on its own)
+ * @param q  Pending lookup, or NULL
+ */
+void devproto_resolve_cancel(devproto_resolve_t *q);
+
+/* ---- Happy-eyeballs connector ---- */
+
+/**
+ * Connection attempt in progress (initialize with devproto_connector_start())
+ */
+typedef struct {
+    devproto_addr_list_t addrs;
+    size_t  next;                       /* Next address to start */
+    int     fds[DEVPROTO_NET_MAX_ADDRS]; /* Attempts in flight, newest last */
+    size_t  inflight;
+    int     attempt_delay_ms;
+    int64_t next_attempt_ms;            /* When the next address starts */
+    int64_t deadline_ms;                /* 0 = no overall timeout */
+    int     last_error;                 /* errno of the latest failed attempt */
+} devproto_connector_t;
+
+/**
+ * Start connecting
+ * @param c                 Connector
+ * @param addrs             Addresses in order (copied)
+ * @param attempt_delay_ms  Head start of each attempt (0 = default)
+ * @param timeout_ms        Overall timeout (-1 = none)
+ * @return                  0 on success, -1 if addrs is empty
+ */
+int devproto_connector_start(devproto_connector_t *c, const devproto_addr_list_t *addrs,
+                             int attempt_delay_ms, int timeout_ms);
+
+/**
+ * Advance the attempts without blocking
+ * @param c   Connector
+ * @param fd  Connected socket (non-blocking, owned by the caller) on success
+ * @return    0 once connected, 1 while in progress, -1 when every address
+ *            failed or the timeout passed (errno set)
+ *
+ * Call again when devproto_connector_fd() becomes writable or after
+ * devproto_connector_wait_ms().
+ */
+int devproto_connector_step(devproto_connector_t *c, int *fd);
+
+/**
+ * Socket of the newest attempt, to wait for writability (-1 if none)
+ */
+int devproto_connector_fd(const devproto_connector_t *c);
+
+/**
+ * Milliseconds until the next attempt starts or the timeout passes
+ * @return  Milliseconds, or -1 if only a connect completion can advance it
+ */
+int devproto_connector_wait_ms(const devproto_connector_t *c);
+
+/**
+ * Abandon all attempts
+ * @param c  Connector
+ */
+void devproto_connector_cancel(devproto_connector_t *c);
+
+/**
+ * Connect to the first address that answers, blocking
+ * @param addrs             Addresses in order
+ * @param attempt_delay_ms  Head start of each attempt (0 = default)
+ * @param timeout_ms        Overall timeout (-1 = none)
+ * @return                  Connected non-blocking socket, or -1 (errno set)
+ */
+int devproto_connect(const devproto_addr_list_t *addrs, int attempt_delay_ms, int timeout_ms);
+
+/* ---- Keepalive ---- */
+
+/**
+ * Dead-peer detection settings
+ */
+typedef struct devproto_keepalive {
+    int idle_ms;                    /* Idle time before the first probe (0 = keepalive off) */
+    int interval_ms;                /* Between unanswered probes */
+    int count;                      /* Unanswered probes before the link is dead */
+    int user_timeout_ms;            /* Unacknowledged data limit (TCP_USER_TIMEOUT, 0 = kernel default) */
+} devproto_keepalive_t;
+
+/* Keepalive defaults: a silent peer is dropped after ~25 s */
+#define DEVPROTO_KEEPALIVE_IDLE_MS      10000
+#define DEVPROTO_KEEPALIVE_INTERVAL_MS  5000
+#define DEVPROTO_KEEPALIVE_COUNT        3
+#define DEVPROTO_KEEPALIVE_USER_MS      25000
+
+/**
+ * Initialize default keepalive settings
+ * @param ka  Settings to initialize
+ */
+void devproto_keepalive_init(devproto_keepalive_t *ka);
+
+/**
+ * Apply keepalive settings to a TCP socket
+ * @param fd  Socket
+ * @param ka  Settings
+ * @return    0 on success, -1 on error
+ *
+ * Times are rounded up to whole seconds where the kernel counts in
+ * seconds. Options the platform lacks are skipped.
+ */
+int devproto_net_set_keepalive(int fd, const devproto_keepalive_t *ka);
+
+/* ---- Reconnect backoff ---- */
+
+/* Backoff defaults */
+#define DEVPROTO_BACKOFF_BASE_MS        500
+#define DEVPROTO_BACKOFF_MAX_MS         60000
+
+/**
+ * Reconnect delay state (initialize with devproto_backoff_init())
+ */
+typedef struct {
+    int      base_ms;
+    int      max_ms;
+    unsigned attempt;                   /* Delays handed out since the last reset */
+    uint32_t seed;
+} devproto_backoff_t;
+
+/**
+ * Initialize backoff
+ * @param b        Backoff state
+ * @param base_ms  First delay ceiling (0 = default)
+ * @param max_ms   Largest delay (0 = default)
+ *
+ * Seeded per state and process, so links created together still spread.
+ */
+void devproto_backoff_init(devproto_backoff_t *b, int base_ms, int max_ms);
+
+/**
+ * Get the next delay and advance
+ * @param b  Backoff state
+ * @return   Delay in milliseconds, uniform in [base/2, min(max, base * 2^attempt)]
+ */
+int devproto_backoff_next(devproto_backoff_t *b);
+
+/**
+ * Start over from the base delay (after a connection proved healthy)
+ * @param b  Backoff state
+ */
+void devproto_backoff_reset(devproto_backoff_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_NET_H */
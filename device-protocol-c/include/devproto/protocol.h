@@ -11,6 +11,17 @@
  * +--------+--------+--------+--------+-------------+--------+
  * | 2 bytes| 2 bytes| 1 byte | 1 byte | 0-4096 bytes| 2 bytes|
  *          (big-endian)                              (CRC-16-CCITT)
+ *
+ * Extended-length (jumbo) frames, used only once DEVPROTO_CAP_JUMBO_FRAMES
+ * has been negotiated, set the top bit of the first length byte and carry
+ * a 4-byte length; legacy parsers reject them as oversized:
+ * +--------+------------------+--------+--------+---------------+--------+
+ * | 0xAA55 | 0x80 | LENGTH    |  TYPE  |  SEQ   | PAYLOAD       |  CRC   |
+ * +--------+------------------+--------+--------+---------------+--------+
+ * | 2 bytes| 4 bytes          | 1 byte | 1 byte | 0-65535 bytes | 2 bytes|
+ *
+ * A compressed payload (DEVPROTO_CAP_COMPRESSION, see compress.h) sets 0x40
+ * in the first length byte of either format.
  */
 
 #ifndef DEVPROTO_PROTOCOL_H
@@ -28,13 +39,20 @@ extern "C" {
 #define DEVPROTO_HEADER_BYTE0       0xAA
 #define DEVPROTO_HEADER_BYTE1       0x55
 #define DEVPROTO_HEADER_MAGIC       0xAA55
-#define DEVPROTO_VERSION            0x01
+#define DEVPROTO_VERSION            0x02    /* 0x02: extended-length frames */
 #define DEVPROTO_MAX_PAYLOAD_SIZE   4096
 #define DEVPROTO_HEADER_SIZE        6       /* header(2) + length(2) + type(1) + seq(1) */
 #define DEVPROTO_CRC_SIZE           2
 #define DEVPROTO_MIN_FRAME_SIZE     8       /* header + crc, no payload */
 #define DEVPROTO_MAX_FRAME_SIZE     (DEVPROTO_HEADER_SIZE + DEVPROTO_MAX_PAYLOAD_SIZE + DEVPROTO_CRC_SIZE)
 
+/* Extended-length frames (payload_len is 16-bit, which caps the payload) */
+#define DEVPROTO_JUMBO_FLAG         0x80    /* In the first length byte */
+#define DEVPROTO_JUMBO_HEADER_SIZE  8       /* header(2) + length(4) + type(1) + seq(1) */
+#define DEVPROTO_JUMBO_MAX_PAYLOAD  65535
+#define DEVPROTO_JUMBO_MAX_FRAME_SIZE \
+    (DEVPROTO_JUMBO_HEADER_SIZE + DEVPROTO_JUMBO_MAX_PAYLOAD + DEVPROTO_CRC_SIZE)
+
 /**
  * Message types - compatible with Python MessageType enum
  */
@@ -47,6 +65,8 @@ typedef enum {
     DEVPROTO_MSG_GET_STATUS      = 0x05,
     DEVPROTO_MSG_REBOOT          = 0x06,
     DEVPROTO_MSG_UPDATE_FIRMWARE = 0x07,
+    DEVPROTO_MSG_HELLO           = 0x08,
+    DEVPROTO_MSG_SUBSCRIBE       = 0x09,
 
     /* Responses (Device -> PC) */
     DEVPROTO_MSG_PONG            = 0x81,
@@ -55,12 +75,16 @@ typedef enum {
     DEVPROTO_MSG_CONFIG_ACK      = 0x84,
     DEVPROTO_MSG_STATUS_RESPONSE = 0x85,
     DEVPROTO_MSG_REBOOT_ACK      = 0x86,
+    DEVPROTO_MSG_FIRMWARE_ACK    = 0x87,
+    DEVPROTO_MSG_HELLO_ACK       = 0x88,
+    DEVPROTO_MSG_SUBSCRIBE_ACK   = 0x89,
 
     /* Async Events (Device -> PC, unsolicited) */
     DEVPROTO_MSG_ALERT_EVENT        = 0xA1,
     DEVPROTO_MSG_THRESHOLD_EXCEEDED = 0xA2,
     DEVPROTO_MSG_HARDWARE_FAULT     = 0xA3,
-    DEVPROTO_MSG_CONNECTION_LOST    = 0xA4
+    DEVPROTO_MSG_CONNECTION_LOST    = 0xA4,
+    DEVPROTO_MSG_METRICS_EVENT      = 0xA5
 } devproto_msg_type_t;
 
 /**
@@ -102,6 +126,27 @@ typedef struct {
     uint8_t  *payload;      /* Pointer to payload data (can be NULL) */
 } devproto_message_t;
 
+/**
+ * Capability bits exchanged in HELLO / HELLO_ACK
+ *
+ * HELLO payload: [version][caps: 4 bytes big-endian]. The peer answers
+ * HELLO_ACK with its version and the intersection of both capability sets;
+ * features are used only once acknowledged. Peers that predate HELLO do
+ * not answer, which leaves the link on the legacy formats.
+ *
+ * DEVPROTO_CAP_JUMBO_FRAMES lifts the payload limit of the link to
+ * DEVPROTO_JUMBO_MAX_PAYLOAD with devproto_transport_set_max_payload(): the
+ * host when HELLO_ACK arrives, the device once it has sent HELLO_ACK. The
+ * device should then wait for the host's next request before sending a
+ * frame over DEVPROTO_MAX_PAYLOAD_SIZE. DEVPROTO_CAP_COMPRESSION is
+ * applied the same way with devproto_transport_set_compression().
+ */
+#define DEVPROTO_CAP_COMPACT_METRICS    (1u << 0)   /* Compact metrics payloads */
+#define DEVPROTO_CAP_JUMBO_FRAMES       (1u << 1)   /* Extended-length frames */
+#define DEVPROTO_CAP_COMPRESSION        (1u << 2)   /* LZ4-compressed payloads (compress.h) */
+
+#define DEVPROTO_HELLO_SIZE             5
+
 /**
  * Frame header structure (packed for wire format)
  */
@@ -183,6 +228,35 @@ void devproto_create_command(devproto_message_t *msg, uint8_t sequence,
                              devproto_cmd_type_t cmd_type,
                              const uint8_t *params, size_t params_len);
 
+/**
+ * Create a HELLO request
+ * @param msg       Message structure to fill
+ * @param sequence  Sequence number
+ * @param buffer    Payload storage (DEVPROTO_HELLO_SIZE bytes, must outlive msg)
+ * @param caps      Local capability bits (DEVPROTO_CAP_*)
+ */
+void devproto_create_hello(devproto_message_t *msg, uint8_t sequence,
+                           uint8_t *buffer, uint32_t caps);
+
+/**
+ * Create a HELLO_ACK response
+ * @param msg       Message structure to fill
+ * @param sequence  Sequence number (should match request)
+ * @param buffer    Payload storage (DEVPROTO_HELLO_SIZE bytes, must outlive msg)
+ * @param caps      Agreed capability bits (local & remote)
+ */
+void devproto_create_hello_ack(devproto_message_t *msg, uint8_t sequence,
+                               uint8_t *buffer, uint32_t caps);
+
+/**
+ * Parse a HELLO or HELLO_ACK payload
+ * @param msg       Received message
+ * @param version   Out: peer protocol version (may be NULL)
+ * @param caps      Out: capability bits
+ * @return          0 on success, -1 on error
+ */
+int devproto_parse_hello(const devproto_message_t *msg, uint8_t *version, uint32_t *caps);
+
 /**
  * Serialize a message to wire format
  * @param msg       Message to serialize
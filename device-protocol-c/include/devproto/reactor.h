@@ -0,0 +1,199 @@
+/**
+ * @file reactor.h
+ * @brief Event loop multiplexing many transports on one thread
+ *
+ * Registered transports are watched with epoll (Linux) or kqueue (BSD,
+ * macOS). Readable bytes are fed straight into each connection's frame
+ * parser and completed messages are delivered through a callback, so one
+ * thread can serve thousands of sites without FD_SETSIZE limits.
+ *
+ * A reactor is not thread-safe; call it from a single thread (only
+ * devproto_reactor_wake() may be called from others). Callbacks may send
+ * on, add, or remove transports (including their own).
+ */
+
+#ifndef DEVPROTO_REACTOR_H
+#define DEVPROTO_REACTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+#include "frame.h"
+#include "frame_pool.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest wait in run_once() while opens are pending */
+#define DEVPROTO_REACTOR_CONNECT_TICK_MS    100
+
+/* Opaque reactor handle */
+typedef struct devproto_reactor devproto_reactor_t;
+
+/**
+ * Message callback; msg->payload is only valid during the call
+ */
+typedef void (*devproto_reactor_message_fn)(devproto_reactor_t *r,
+                                            devproto_transport_t *t,
+                                            const devproto_message_t *msg,
+                                            void *user);
+
+/**
+ * Close callback: the transport failed or the peer hung up. It has already
+ * been removed from the reactor; destroying it here is allowed.
+ */
+typedef void (*devproto_reactor_close_fn)(devproto_reactor_t *r,
+                                          devproto_transport_t *t,
+                                          void *user);
+
+/**
+ * Open callback: a transport registered with devproto_reactor_connect()
+ * finished opening and is now delivering messages
+ */
+typedef void (*devproto_reactor_open_fn)(devproto_reactor_t *r,
+                                         devproto_transport_t *t,
+                                         void *user);
+
+/**
+ * Create a reactor
+ * @return  Reactor handle, or NULL on error
+ */
+devproto_reactor_t *devproto_reactor_create(void);
+
+/**
+ * Create a reactor whose parsers borrow from a pool shared with others
+ * @param pool  Frame pool (must outlive the reactor; NULL = private pool)
+ * @return      Reactor handle, or NULL on error
+ *
+ * Parsers detached from one such reactor can be attached to another.
+ */
+devproto_reactor_t *devproto_reactor_create_shared(devproto_frame_pool_t *pool);
+
+/**
+ * Destroy a reactor (registered transports are not closed)
+ * @param r  Reactor handle
+ */
+void devproto_reactor_destroy(devproto_reactor_t *r);
+
+/**
+ * Register an open transport
+ * @param r           Reactor handle
+ * @param t           Open transport with a valid fd
+ * @param on_message  Called for each complete message
+ * @param on_close    Called once when the connection fails (may be NULL)
+ * @param user        Passed to the callbacks
+ * @return            0 on success, -1 on error
+ *
+ * Each connection gets a pooled compact parser from the reactor's shared
+ * frame pool.
+ */
+int devproto_reactor_add(devproto_reactor_t *r, devproto_transport_t *t,
+                         devproto_reactor_message_fn on_message,
+                         devproto_reactor_close_fn on_close, void *user);
+
+/**
+ * Register an open transport with a parser taken from devproto_reactor_detach()
+ * @param r           Reactor handle
+ * @param t           Open transport with a valid fd
+ * @param parser      Pooled parser from the same frame pool (owned on success)
+ * @param on_message  Called for each complete message
+ * @param on_close    Called once when the connection fails (may be NULL)
+ * @param user        Passed to the callbacks
+ * @return            0 on success, -1 on error (parser stays with the caller)
+ *
+ * A frame split across the move is completed by the kept parser state.
+ */
+int devproto_reactor_attach(devproto_reactor_t *r, devproto_transport_t *t,
+                            devproto_frame_pooled_parser_t *parser,
+                            devproto_reactor_message_fn on_message,
+                            devproto_reactor_close_fn on_close, void *user);
+
+/**
+ * Open a transport without blocking and register it
+ * @param r           Reactor handle
+ * @param t           Closed transport (or one already stepping its open)
+ * @param on_open     Called once the open completes (may be NULL)
+ * @param on_message  Called for each complete message
+ * @param on_close    Called once if the open or the connection fails (may be NULL)
+ * @param user        Passed to the callbacks
+ * @return            0 on success (open may still be in progress), -1 on error
+ *
+ * The reactor drives devproto_transport_open_step() from fd readiness, so
+ * many TLS handshakes progress concurrently on the reactor thread while
+ * name lookups the resolver cache cannot answer run off it. While
+ * opens are pending, run_once() wakes at least every
+ * DEVPROTO_REACTOR_CONNECT_TICK_MS so handshake timeouts are enforced.
+ * If the open finishes during this call, on_open runs before it returns.
+ */
+int devproto_reactor_connect(devproto_reactor_t *r, devproto_transport_t *t,
+                             devproto_reactor_open_fn on_open,
+                             devproto_reactor_message_fn on_message,
+                             devproto_reactor_close_fn on_close, void *user);
+
+/**
+ * Unregister a transport (before closing it)
+ * @param r  Reactor handle
+ * @param t  Transport handle
+ * @return   0 on success, -1 if not registered
+ */
+int devproto_reactor_remove(devproto_reactor_t *r, devproto_transport_t *t);
+
+/**
+ * Unregister a transport but keep its parser (to move it to another reactor)
+ * @param r  Reactor handle
+ * @param t  Open transport handle
+ * @return   Parser, now owned by the caller, or NULL if not registered or
+ *           still opening
+ */
+devproto_frame_pooled_parser_t *devproto_reactor_detach(devproto_reactor_t *r,
+                                                        devproto_transport_t *t);
+
+/**
+ * Make a blocked devproto_reactor_run_once() return early
+ * @param r  Reactor handle
+ *
+ * Thread-safe; wakes that arrive while the reactor is busy are coalesced
+ * into one early return of the next wait.
+ */
+void devproto_reactor_wake(devproto_reactor_t *r);
+
+/**
+ * Ask to be woken for writability while the transport has queued output
+ * @param r  Reactor handle
+ * @param t  Transport handle
+ * @return   0 on success, -1 on error
+ *
+ * Call after a non-blocking send left data queued; the reactor drains the
+ * queue as the socket accepts it.
+ */
+int devproto_reactor_want_write(devproto_reactor_t *r, devproto_transport_t *t);
+
+/**
+ * Get the parser of a registered transport (statistics)
+ * @param r  Reactor handle
+ * @param t  Transport handle
+ * @return   Parser, or NULL if not registered
+ */
+devproto_frame_pooled_parser_t *devproto_reactor_parser(devproto_reactor_t *r,
+                                                        devproto_transport_t *t);
+
+/**
+ * Number of registered transports
+ */
+size_t devproto_reactor_count(const devproto_reactor_t *r);
+
+/**
+ * Wait for events and dispatch them
+ * @param r           Reactor handle
+ * @param timeout_ms  Maximum wait (-1 = forever, 0 = poll)
+ * @return            Number of messages delivered, or -1 on error
+ */
+int devproto_reactor_run_once(devproto_reactor_t *r, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_REACTOR_H */
@@ -0,0 +1,113 @@
+/**
+ * @file sampler.h
+ * @brief Device-side metric sampler with cached, independently refreshed readings
+ *
+ * Each metric has its own reader callback and refresh interval. Readings are
+ * collected off the response path, either lazily from the main loop
+ * (devproto_sampler_refresh) or by a background thread
+ * (devproto_sampler_start), and published to a double-buffered snapshot.
+ * Readers (devproto_sampler_snapshot / devproto_sampler_build) never block
+ * and never wait for a sensor: they copy the latest published snapshot.
+ *
+ * Register every metric before the first refresh; the table is fixed after
+ * that. Refresh is single-writer; snapshot readers may run on any thread.
+ */
+
+#ifndef DEVPROTO_SAMPLER_H
+#define DEVPROTO_SAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVPROTO_SAMPLER_MAX_METRICS    64
+
+/* Opaque sampler handle */
+typedef struct devproto_sampler devproto_sampler_t;
+
+/**
+ * Sensor reader
+ * @param type   Metric being read
+ * @param value  Out: reading
+ * @param user   Value given to devproto_sampler_add()
+ * @return       0 on success; on failure the previous reading is kept
+ */
+typedef int (*devproto_sampler_read_fn)(devproto_metric_type_t type, float *value,
+                                        void *user);
+
+/**
+ * Create a sampler
+ * @return  Sampler handle, or NULL on error
+ */
+devproto_sampler_t *devproto_sampler_create(void);
+
+/**
+ * Destroy a sampler (stops the background thread if running)
+ */
+void devproto_sampler_destroy(devproto_sampler_t *s);
+
+/**
+ * Register a metric
+ * @param s            Sampler
+ * @param type         Metric type (each at most once)
+ * @param interval_ms  Refresh interval (> 0)
+ * @param read         Reader callback
+ * @param user         Passed to the reader
+ * @return             0 on success, DEVPROTO_ERR_BUSY once sampling has
+ *                     started, or another negative error
+ */
+int devproto_sampler_add(devproto_sampler_t *s, devproto_metric_type_t type,
+                         uint32_t interval_ms, devproto_sampler_read_fn read, void *user);
+
+/**
+ * Read every metric whose interval has elapsed and publish a new snapshot
+ * @param s  Sampler
+ * @return   Number of readers called, or negative on error
+ */
+int devproto_sampler_refresh(devproto_sampler_t *s);
+
+/**
+ * Time until the next reading is due
+ * @return  Milliseconds (0 if due now), or -1 if no metrics are registered
+ */
+int devproto_sampler_next_timeout(const devproto_sampler_t *s);
+
+/**
+ * Refresh from a background thread until devproto_sampler_stop()
+ * @return  0 on success, or negative on error
+ */
+int devproto_sampler_start(devproto_sampler_t *s);
+
+/**
+ * Stop the background thread (no-op if not running)
+ */
+void devproto_sampler_stop(devproto_sampler_t *s);
+
+/**
+ * Copy the latest snapshot (metrics never successfully read are omitted)
+ * @param s            Sampler
+ * @param metrics      Output array
+ * @param max_metrics  Capacity
+ * @return             Number of metrics copied, or -1 on error
+ */
+int devproto_sampler_snapshot(const devproto_sampler_t *s, devproto_metric_t *metrics,
+                              size_t max_metrics);
+
+/**
+ * Serialize the latest snapshot as a METRICS_RESPONSE payload
+ * @param s         Sampler
+ * @param buffer    Output buffer (devproto_metrics_build() format)
+ * @param buf_size  Buffer size
+ * @return          Number of bytes written, or -1 on error
+ */
+int devproto_sampler_build(const devproto_sampler_t *s, uint8_t *buffer, size_t buf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_SAMPLER_H */
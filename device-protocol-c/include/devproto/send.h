@@ -0,0 +1,53 @@
+/**
+ * @file send.h
+ * @brief Message send helpers on top of frames and transports
+ *
+ * Frames are built scatter-gather (no payload copy) and written with
+ * devproto_transport_sendv(), so a batch of messages costs one syscall
+ * and, with TCP_NODELAY, typically one segment.
+ */
+
+#ifndef DEVPROTO_SEND_H
+#define DEVPROTO_SEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frames coalesced into one sendv call */
+#define DEVPROTO_SEND_BATCH_MAX  16
+
+/**
+ * Send one message
+ * @param t    Transport handle
+ * @param msg  Message to send
+ * @return     0 on success, -1 on error
+ */
+int devproto_send_message(devproto_transport_t *t, const devproto_message_t *msg);
+
+/**
+ * Send several messages with as few syscalls as possible
+ * @param t        Transport handle
+ * @param msgs     Messages to send, in order
+ * @param n        Number of messages
+ * @param results  Out: per-message 0 (sent) or -1 (invalid or not sent);
+ *                 may be NULL
+ * @return         Number of messages sent, or -1 on invalid arguments
+ *
+ * Up to DEVPROTO_SEND_BATCH_MAX frames go out per devproto_transport_sendv()
+ * call. On a transport error the remaining messages are reported as not
+ * sent; a frame cut short by the error is reported as not sent as well.
+ */
+int devproto_send_batch(devproto_transport_t *t, const devproto_message_t *msgs,
+                        size_t n, int *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_SEND_H */
@@ -0,0 +1,224 @@
+/**
+ * @file session.h
+ * @brief Request/response correlation with a pipelined in-flight window
+ *
+ * A session assigns sequence numbers, keeps up to `window` requests
+ * outstanding on one transport and matches each response by sequence and
+ * devproto_response_type(). Async events (devproto_is_event()) go to a
+ * separate handler. Every request has its own deadline; a sequence number
+ * whose request timed out is held back for one more timeout period so a late
+ * reply cannot be mistaken for the answer to a new request after the 8-bit
+ * counter wraps.
+ *
+ * Received messages can come from a reactor callback
+ * (devproto_session_on_message) or from devproto_session_process(), which
+ * reads the transport itself. Not thread-safe.
+ *
+ * devproto_session_request_async() takes an absolute deadline and never
+ * refuses for a full window: the request is copied into a pooled record and
+ * sent as earlier requests complete, so thousands can be outstanding per
+ * session without a thread each. When driving a session from a reactor,
+ * pass devproto_session_next_timeout() as the run_once() timeout and call
+ * devproto_session_expire() after it. include/devproto/async.hpp wraps this
+ * as C++20 awaitables.
+ */
+
+#ifndef DEVPROTO_SESSION_H
+#define DEVPROTO_SESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque session handle */
+typedef struct devproto_session devproto_session_t;
+
+/* Largest in-flight window (half the sequence space) */
+#define DEVPROTO_SESSION_MAX_WINDOW     128
+
+/* Async requests that may wait for the window per session */
+#define DEVPROTO_SESSION_QUEUE_MAX      4096
+
+/* Request records allocated at a time (kept for reuse) */
+#define DEVPROTO_SESSION_RECORD_CHUNK   32
+
+/**
+ * Response callback
+ * @param s         Session
+ * @param status    DEVPROTO_OK, DEVPROTO_ERR_TIMEOUT, DEVPROTO_ERR_CLOSED, or
+ *                  DEVPROTO_ERR_IO if a queued async request failed to send
+ *                  or the link dropped while it was in flight
+ * @param response  Matching response (NULL unless status is DEVPROTO_OK);
+ *                  payload valid only during the call
+ * @param user      Value given to devproto_session_request()
+ *
+ * Callbacks may issue new requests but must not destroy the session.
+ */
+typedef void (*devproto_session_response_fn)(devproto_session_t *s, int status,
+                                             const devproto_message_t *response,
+                                             void *user);
+
+/**
+ * Async event callback (payload valid only during the call)
+ */
+typedef void (*devproto_session_event_fn)(devproto_session_t *s,
+                                          const devproto_message_t *event,
+                                          void *user);
+
+/**
+ * Session statistics
+ */
+typedef struct {
+    uint32_t requests;                  /* Requests sent */
+    uint32_t responses;                 /* Responses matched */
+    uint32_t timeouts;                  /* Requests that hit their deadline */
+    uint32_t events;                    /* Async events delivered */
+    uint32_t unmatched;                 /* Responses with no pending request */
+    uint32_t deferred;                  /* Async requests that waited for the window */
+    uint32_t reconnects;                /* Links restored by devproto_session_process() */
+} devproto_session_stats_t;
+
+/**
+ * Create a session on an open transport
+ * @param t       Transport (not owned)
+ * @param window  Maximum outstanding requests (1..DEVPROTO_SESSION_MAX_WINDOW)
+ * @return        Session handle, or NULL on error
+ */
+devproto_session_t *devproto_session_create(devproto_transport_t *t, size_t window);
+
+/**
+ * Destroy a session; outstanding requests complete with DEVPROTO_ERR_CLOSED
+ * @param s  Session handle
+ */
+void devproto_session_destroy(devproto_session_t *s);
+
+/**
+ * Set the async event handler
+ * @param s     Session handle
+ * @param fn    Handler (NULL to drop events)
+ * @param user  Passed to the handler
+ */
+void devproto_session_set_event_handler(devproto_session_t *s,
+                                        devproto_session_event_fn fn, void *user);
+
+/**
+ * Restore the link automatically when it fails
+ * @param s        Session handle
+ * @param enable   Non-zero to reconnect from devproto_session_process()
+ * @param base_ms  First backoff delay ceiling (0 = DEVPROTO_BACKOFF_BASE_MS)
+ * @param max_ms   Largest backoff delay (0 = DEVPROTO_BACKOFF_MAX_MS)
+ * @return         DEVPROTO_OK, or DEVPROTO_ERR_INVALID
+ *
+ * When a receive or the send of a queued request fails, requests in flight
+ * complete with DEVPROTO_ERR_IO at once, the transport is closed and
+ * reopened with devproto_transport_open_step() after a jittered exponential
+ * backoff (see net.h), so a gateway outage does not bring every link back
+ * at the same moment. Async requests issued meanwhile stay queued against their own
+ * deadlines and go out once the link is back; the window, sequence
+ * numbers and statistics carry over. Receiving data resets the backoff.
+ * While the link is down devproto_session_process() waits for the next
+ * attempt, bounded by its timeout, and returns the number of requests
+ * completed instead of an error.
+ */
+int devproto_session_set_reconnect(devproto_session_t *s, int enable, int base_ms, int max_ms);
+
+/**
+ * Send a request
+ * @param s           Session handle
+ * @param request     Request to send; its sequence field is assigned here
+ * @param timeout_ms  Deadline relative to now (> 0)
+ * @param fn          Completion callback (exactly one call per request)
+ * @param user        Passed to the callback
+ * @return            Assigned sequence number (0-255), DEVPROTO_ERR_BUSY if
+ *                    the window is full, or another negative error
+ */
+int devproto_session_request(devproto_session_t *s, devproto_message_t *request,
+                             int timeout_ms, devproto_session_response_fn fn,
+                             void *user);
+
+/**
+ * Current time on the session clock, for async deadlines
+ * @return  Monotonic milliseconds
+ */
+int64_t devproto_session_clock_ms(void);
+
+/**
+ * Send an async request, queueing it while the window is full
+ * @param s            Session handle
+ * @param request      Request to send (copied if queued; sequence is assigned
+ *                     on send and not written back)
+ * @param deadline_ms  Absolute deadline on devproto_session_clock_ms(); time
+ *                     spent queued counts against it
+ * @param fn           Completion callback (exactly one call if accepted)
+ * @param user         Passed to the callback
+ * @return             0 if sent or queued, DEVPROTO_ERR_TIMEOUT if the deadline
+ *                     has passed, DEVPROTO_ERR_BUSY if DEVPROTO_SESSION_QUEUE_MAX
+ *                     requests are queued, or another negative error
+ *
+ * Queued requests go out in order as responses free the window, from
+ * devproto_session_on_message() and devproto_session_expire(). Request
+ * records and large-payload blocks are recycled, so steady operation does
+ * not allocate.
+ */
+int devproto_session_request_async(devproto_session_t *s,
+                                   const devproto_message_t *request,
+                                   int64_t deadline_ms,
+                                   devproto_session_response_fn fn, void *user);
+
+/**
+ * Feed one received message
+ * @param s    Session handle
+ * @param msg  Received message
+ * @return     1 if it completed a request, 0 otherwise (event or unmatched)
+ */
+int devproto_session_on_message(devproto_session_t *s, const devproto_message_t *msg);
+
+/**
+ * Fail requests whose deadline has passed and send queued ones that fit
+ * @param s  Session handle
+ * @return   Number of requests that timed out (or, if queued, failed to send)
+ */
+int devproto_session_expire(devproto_session_t *s);
+
+/**
+ * Time until the earliest deadline
+ * @param s  Session handle
+ * @return   Milliseconds (0 if already due), or -1 if nothing is pending
+ */
+int devproto_session_next_timeout(devproto_session_t *s);
+
+/**
+ * Read the transport, dispatch messages and expire deadlines
+ * @param s           Session handle
+ * @param timeout_ms  Maximum wait (capped at the next deadline)
+ * @return            Requests completed (matched or timed out), or negative
+ *                    on transport error (unless reconnecting is enabled)
+ */
+int devproto_session_process(devproto_session_t *s, int timeout_ms);
+
+/**
+ * Number of requests awaiting a response
+ */
+size_t devproto_session_inflight(const devproto_session_t *s);
+
+/**
+ * Number of async requests waiting for the window
+ */
+size_t devproto_session_queued(const devproto_session_t *s);
+
+/**
+ * Get session statistics
+ */
+void devproto_session_get_stats(const devproto_session_t *s,
+                                devproto_session_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_SESSION_H */
@@ -0,0 +1,209 @@
+/**
+ * @file stats.h
+ * @brief Per-connection protocol telemetry
+ *
+ * A stats object attached to a transport with devproto_transport_set_stats()
+ * collects 64-bit counters of bytes, frames and transport calls, and
+ * log-bucketed histograms of request round-trip time per message type and
+ * of parse + CRC cost per frame. The transport wrappers, the send helpers,
+ * sessions and reactors record into it; one thread drives a connection at
+ * a time, so recording takes no lock.
+ *
+ * Any thread may take a consistent copy with devproto_stats_snapshot(),
+ * which never blocks the recording thread, and render snapshots of many
+ * connections as Prometheus text or JSON for scraping.
+ *
+ * Histograms keep 4 sub-buckets per power of two (values within 25%), like
+ * an HDR histogram with 2 significant bits, over the full 32-bit range.
+ */
+
+#ifndef DEVPROTO_STATS_H
+#define DEVPROTO_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVPROTO_STATS_HIST_BUCKETS 124
+
+/* RTT histograms by request type; types from 0x10 on share slot 0 */
+#define DEVPROTO_STATS_RTT_TYPES    16
+
+/* Opaque stats handle */
+typedef struct devproto_stats devproto_stats_t;
+
+/**
+ * Histogram copy
+ */
+typedef struct {
+    uint64_t count;                     /* Samples */
+    uint64_t sum;                       /* Sum of sample values */
+    uint32_t min;                       /* Smallest sample (0 if none) */
+    uint32_t max;                       /* Largest sample */
+    uint64_t buckets[DEVPROTO_STATS_HIST_BUCKETS];
+} devproto_stats_hist_t;
+
+/**
+ * Consistent copy of one connection's telemetry
+ */
+typedef struct {
+    uint64_t bytes_in;                  /* Bytes returned by receives */
+    uint64_t bytes_out;                 /* Bytes accepted by sends (queued included) */
+    uint64_t frames_in;                 /* Frames parsed */
+    uint64_t frames_out;                /* Frames sent completely */
+    uint64_t recv_calls;                /* Transport receive calls */
+    uint64_t send_calls;                /* Transport send/sendv calls */
+    uint64_t rx_empty;                  /* Receives that returned no data */
+    uint64_t tx_eagain;                 /* Sends refused with EAGAIN */
+    uint64_t tx_partial;                /* Sends that took only part of the data */
+    uint64_t io_errors;                 /* Other failed transport calls */
+    uint64_t crc_errors;                /* Frames dropped on CRC mismatch */
+    uint64_t sync_errors;               /* Bytes skipped hunting for a header */
+    uint64_t timeouts;                  /* Requests that hit their deadline */
+    devproto_stats_hist_t parse_cycles; /* Parse + CRC cost per frame (devproto_stats_cycles() ticks) */
+    devproto_stats_hist_t rtt_us[DEVPROTO_STATS_RTT_TYPES]; /* Request RTT in microseconds */
+} devproto_stats_snapshot_t;
+
+/**
+ * Create a stats object
+ * @return  Stats handle, or NULL on error
+ */
+devproto_stats_t *devproto_stats_create(void);
+
+/**
+ * Destroy a stats object (detach it from its transport first)
+ * @param st  Stats handle
+ */
+void devproto_stats_destroy(devproto_stats_t *st);
+
+/**
+ * Copy the current values (thread-safe, lock-free)
+ * @param st    Stats handle
+ * @param snap  Output snapshot
+ */
+void devproto_stats_snapshot(const devproto_stats_t *st, devproto_stats_snapshot_t *snap);
+
+/* ---- Recording (the thread driving the connection) ---- */
+
+/**
+ * Record a transport send call
+ * @param st         Stats handle
+ * @param requested  Bytes offered
+ * @param result     Return value of the call (errno is inspected, not changed)
+ */
+void devproto_stats_record_send(devproto_stats_t *st, size_t requested, int result);
+
+/**
+ * Record a transport receive call
+ * @param st      Stats handle
+ * @param result  Return value of the call
+ */
+void devproto_stats_record_recv(devproto_stats_t *st, int result);
+
+/**
+ * Record frames sent completely
+ */
+void devproto_stats_record_frames_out(devproto_stats_t *st, uint32_t frames);
+
+/**
+ * Record one parse call
+ * @param st           Stats handle
+ * @param frames       Frames it returned
+ * @param cycles       Its cost in devproto_stats_cycles() ticks
+ * @param crc_errors   CRC errors it counted
+ * @param sync_errors  Sync errors it counted
+ *
+ * Adds frames samples of cycles / frames to the parse histogram.
+ */
+void devproto_stats_record_parse(devproto_stats_t *st, uint32_t frames, uint64_t cycles,
+                                 uint32_t crc_errors, uint32_t sync_errors);
+
+/**
+ * Record a request round trip
+ * @param st        Stats handle
+ * @param msg_type  Request type
+ * @param rtt_us    Round-trip time in microseconds
+ */
+void devproto_stats_record_rtt(devproto_stats_t *st, uint8_t msg_type, uint64_t rtt_us);
+
+/**
+ * Record a request that hit its deadline
+ */
+void devproto_stats_record_timeout(devproto_stats_t *st);
+
+/**
+ * Cheap timestamp for cost measurements
+ * @return  TSC ticks on x86, virtual counter ticks on arm64, nanoseconds
+ *          on the monotonic clock elsewhere
+ */
+uint64_t devproto_stats_cycles(void);
+
+/**
+ * Microseconds on the monotonic clock
+ */
+uint64_t devproto_stats_now_us(void);
+
+/* ---- Reading ---- */
+
+/**
+ * Histogram slot of a request type
+ */
+static inline size_t devproto_stats_rtt_slot(uint8_t msg_type) {
+    return msg_type < DEVPROTO_STATS_RTT_TYPES ? msg_type : 0;
+}
+
+/**
+ * Smallest value counted in a bucket
+ * @param bucket  Bucket index (< DEVPROTO_STATS_HIST_BUCKETS)
+ */
+uint32_t devproto_stats_bucket_lower(size_t bucket);
+
+/**
+ * Estimate a quantile
+ * @param h  Histogram
+ * @param q  Quantile (0.0 .. 1.0)
+ * @return   Upper bound of the bucket holding the quantile, capped at the
+ *           largest sample (0 if empty)
+ */
+uint32_t devproto_stats_hist_quantile(const devproto_stats_hist_t *h, double q);
+
+/**
+ * Render snapshots in the Prometheus text exposition format
+ * @param snaps  Snapshots, one per connection
+ * @param names  Connection names, used as the conn label
+ * @param n      Number of connections
+ * @param buf    Output buffer (NUL-terminated on success)
+ * @param cap    Buffer size
+ * @return       Length written, or -1 if buf is too small
+ *
+ * Histograms get buckets at powers of two (le = 2^k - 1, exact for integer
+ * samples) up to the largest sample; empty RTT histograms are left out.
+ */
+int devproto_stats_format_prometheus(const devproto_stats_snapshot_t *snaps,
+                                     const char *const *names, size_t n,
+                                     char *buf, size_t cap);
+
+/**
+ * Render snapshots as JSON
+ * @param snaps  Snapshots, one per connection
+ * @param names  Connection names
+ * @param n      Number of connections
+ * @param buf    Output buffer (NUL-terminated on success)
+ * @param cap    Buffer size
+ * @return       Length written, or -1 if buf is too small
+ *
+ * Histograms carry count, sum, min, max, p50/p90/p99 and their non-empty
+ * buckets as [lower bound, count] pairs.
+ */
+int devproto_stats_format_json(const devproto_stats_snapshot_t *snaps,
+                               const char *const *names, size_t n,
+                               char *buf, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_STATS_H */
@@ -0,0 +1,137 @@
+/**
+ * @file subscription.h
+ * @brief Metric subscriptions: device-pushed METRICS_EVENT streams
+ *
+ * Instead of polling with REQUEST_METRICS, the host sends SUBSCRIBE with a
+ * metric set, a period and a per-metric deadband. The device then pushes
+ * METRICS_EVENT frames (async event range, sequence 0):
+ *   - every period_ms, carrying every subscribed metric, and
+ *   - between periods, carrying only the metrics that moved more than their
+ *     deadband since last reported. Changes are coalesced: at most one such
+ *     frame per holdoff_ms.
+ *
+ * SUBSCRIBE payload:
+ *   [sub id][period_ms: u32 BE][holdoff_ms: u16 BE][type + deadband float BE]*
+ * An empty entry list cancels the subscription; period 0 pushes on change only.
+ * SUBSCRIBE_ACK payload: [status: 0 = accepted][sub id]
+ * METRICS_EVENT payload: [sub id][type + value float BE]*
+ *
+ * The device-side manager keeps subscription state and timers; the
+ * application feeds it fresh samples and calls devproto_sub_poll() from its
+ * main loop. Not thread-safe.
+ */
+
+#ifndef DEVPROTO_SUBSCRIPTION_H
+#define DEVPROTO_SUBSCRIPTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+#include "metrics.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVPROTO_SUB_MAX            8       /* Concurrent subscriptions */
+#define DEVPROTO_SUB_MAX_METRICS    64      /* Metrics per subscription */
+#define DEVPROTO_SUB_ACK_SIZE       2
+
+#define DEVPROTO_SUB_STATUS_OK      0x00
+#define DEVPROTO_SUB_STATUS_REJECT  0x01    /* Malformed or no free slot */
+
+/* Opaque device-side subscription manager */
+typedef struct devproto_sub_manager devproto_sub_manager_t;
+
+/* ---- Host side ---- */
+
+/**
+ * Build a SUBSCRIBE payload
+ * @param sub_id      Subscription id chosen by the host
+ * @param period_ms   Full report period (0 = on change only)
+ * @param holdoff_ms  Minimum spacing of change reports
+ * @param set         Metrics to subscribe; value is the deadband (>= 0)
+ * @param num         Number of metrics (0 cancels the subscription)
+ * @param buffer      Output buffer
+ * @param buf_size    Buffer size
+ * @return            Number of bytes written, or -1 on error
+ */
+int devproto_subscribe_build(uint8_t sub_id, uint32_t period_ms, uint16_t holdoff_ms,
+                             const devproto_metric_t *set, size_t num,
+                             uint8_t *buffer, size_t buf_size);
+
+/**
+ * Parse a METRICS_EVENT message
+ * @param msg          Received message
+ * @param sub_id       Out: subscription id
+ * @param metrics      Output array of metrics
+ * @param max_metrics  Maximum metrics to parse
+ * @return             Number of metrics parsed, or -1 on error
+ */
+int devproto_metrics_event_parse(const devproto_message_t *msg, uint8_t *sub_id,
+                                 devproto_metric_t *metrics, size_t max_metrics);
+
+/* ---- Device side ---- */
+
+/**
+ * Create a subscription manager
+ * @return  Manager handle, or NULL on allocation failure
+ */
+devproto_sub_manager_t *devproto_sub_create(void);
+
+/**
+ * Destroy a subscription manager
+ */
+void devproto_sub_destroy(devproto_sub_manager_t *mgr);
+
+/**
+ * Apply a SUBSCRIBE request and prepare its SUBSCRIBE_ACK
+ * @param mgr      Manager
+ * @param request  Received SUBSCRIBE message
+ * @param ack      Out: acknowledgement to send
+ * @param ack_buf  Payload storage for ack (DEVPROTO_SUB_ACK_SIZE bytes)
+ * @return         0 if accepted, -1 if rejected (ack still filled in), or
+ *                 DEVPROTO_ERR_INVALID if request is not a SUBSCRIBE
+ */
+int devproto_sub_handle(devproto_sub_manager_t *mgr, const devproto_message_t *request,
+                        devproto_message_t *ack, uint8_t *ack_buf);
+
+/**
+ * Feed current metric values
+ * @param mgr      Manager
+ * @param metrics  Latest samples (types not subscribed are ignored)
+ * @param num      Number of samples
+ */
+void devproto_sub_update(devproto_sub_manager_t *mgr, const devproto_metric_t *metrics,
+                         size_t num);
+
+/**
+ * Send due METRICS_EVENT frames (one sendv for all of them)
+ * @param mgr  Manager
+ * @param t    Transport
+ * @return     Frames sent, or -1 on transport error
+ */
+int devproto_sub_poll(devproto_sub_manager_t *mgr, devproto_transport_t *t);
+
+/**
+ * Time until devproto_sub_poll() has work
+ * @return  Milliseconds (0 if due now), or -1 if nothing is scheduled
+ */
+int devproto_sub_next_timeout(const devproto_sub_manager_t *mgr);
+
+/**
+ * Number of active subscriptions
+ */
+size_t devproto_sub_count(const devproto_sub_manager_t *mgr);
+
+/**
+ * Drop all subscriptions (e.g. when the host disconnects)
+ */
+void devproto_sub_clear(devproto_sub_manager_t *mgr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVPROTO_SUBSCRIPTION_H */
@@ -5,8 +5,10 @@
  * Provides TLS/SSL encrypted transport using mbedTLS.
  * Supports both client and server modes with mutual authentication.
  *
- * Build with DEVPROTO_TLS_ENABLE to enable TLS support.
- * Requires mbedTLS library (https://github.com/Mbed-TLS/mbedtls)
+ * Build with DEVPROTO_TLS_ENABLE (make TLS=1) to enable TLS support.
+ * Requires mbedTLS 2.28 LTS or 3.x (https://github.com/Mbed-TLS/mbedtls).
+ * TLS 1.3 needs mbedTLS 3.2 or later built with MBEDTLS_SSL_PROTO_TLS1_3;
+ * with other builds links negotiate TLS 1.2.
  *
  * Example usage:
  * @code
@@ -23,6 +25,26 @@
  *       // Use like any other transport
  *   }
  * @endcode
+ *
+ * Session resumption: after a successful handshake the transport keeps the
+ * negotiated session (session ID or ticket; TLS 1.3 tickets are taken as
+ * they arrive after the handshake) and offers it on the next
+ * devproto_transport_open(), so reconnects after a link flap skip
+ * certificate chain verification (and under TLS 1.2 the ECDHE exchange).
+ * Set session_save / session_load to persist the session across process
+ * restarts.
+ *
+ * Many links: parse certificates and seed the RNG once in a shared context,
+ * then create each transport from it. Reloading the context swaps the
+ * certificates for new handshakes; live connections are not interrupted.
+ * @code
+ *   devproto_tls_context_t *ctx = devproto_tls_context_create(&cfg, NULL);
+ *   for (int i = 0; i < n; i++) {
+ *       cfg.host = hosts[i];
+ *       links[i] = devproto_transport_tls_create_ctx(ctx, &cfg);
+ *   }
+ *   devproto_tls_context_unref(ctx);    // transports keep their own refs
+ * @endcode
  */
 
 #ifndef DEVPROTO_TLS_H
@@ -31,6 +53,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "transport.h"
+#include "net.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -124,12 +147,30 @@ typedef struct {
     /* Timeouts */
     int          handshake_timeout_ms;  /* Handshake timeout (default: 30000) */
     int          read_timeout_ms;       /* Read timeout (default: 5000) */
-    int          write_timeout_ms;      /* Write timeout (default: 5000) */
+    int          write_timeout_ms;      /* Send wait on a full socket (default: 5000, -1 = none) */
+
+    /* Connection management */
+    devproto_resolver_t *resolver;      /* Name cache (NULL = process-wide) */
+    devproto_keepalive_t keepalive;     /* Dead-peer detection (default: on) */
 
     /* Debug callback (optional) */
     void (*debug_callback)(int level, const char *file, int line, const char *msg);
+
+    /* Session resumption (enabled unless no_session_cache is set) */
+    int          no_session_cache;      /* Always do a full handshake */
+    uint32_t     session_lifetime_s;    /* Max age of a cached session (0 = no limit) */
+
+    /* Session persistence (optional); the blob is opaque and build-specific */
+    int  (*session_save)(const uint8_t *data, size_t len, void *user);
+    int  (*session_load)(uint8_t *data, size_t size, void *user);  /* Returns length, <= 0 if none */
+    void  *session_user;
 } devproto_tls_config_t;
 
+/**
+ * Shared TLS context (certificates, keys, RNG and ssl config), refcounted
+ */
+typedef struct devproto_tls_context devproto_tls_context_t;
+
 /**
  * TLS connection info (after successful handshake)
  */
@@ -159,6 +200,68 @@ void devproto_tls_config_init(devproto_tls_config_t *cfg);
  */
 devproto_transport_t *devproto_transport_tls_create(const devproto_tls_config_t *cfg);
 
+/**
+ * Create a shared TLS context
+ * @param cfg  Configuration; uses the certificate, key, version,
+ *             verify_server and debug_callback fields
+ * @param err  Out: error code on failure (optional)
+ * @return     Context with one reference, or NULL on error
+ */
+devproto_tls_context_t *devproto_tls_context_create(const devproto_tls_config_t *cfg,
+                                                    devproto_tls_error_t *err);
+
+/**
+ * Take a reference on a context
+ * @return  ctx
+ */
+devproto_tls_context_t *devproto_tls_context_ref(devproto_tls_context_t *ctx);
+
+/**
+ * Drop a reference; the context is freed when the last one goes
+ */
+void devproto_tls_context_unref(devproto_tls_context_t *ctx);
+
+/**
+ * Replace the context's certificates and keys (e.g. after rotation)
+ * @param ctx  Context
+ * @param cfg  Configuration (same fields as devproto_tls_context_create)
+ * @return     0 on success, error code on failure (old material stays active)
+ *
+ * Connections already established keep the material they handshook with;
+ * each transport switches on its next devproto_transport_open().
+ */
+int devproto_tls_context_reload(devproto_tls_context_t *ctx,
+                                const devproto_tls_config_t *cfg);
+
+/**
+ * Create TLS transport on a shared context
+ * @param ctx  Shared context (the transport takes its own reference)
+ * @param cfg  Per-connection settings: host, port, expected_cn, timeouts and
+ *             session fields; certificate fields are ignored
+ * @return     Transport handle, or NULL on error
+ */
+devproto_transport_t *devproto_transport_tls_create_ctx(devproto_tls_context_t *ctx,
+                                                        const devproto_tls_config_t *cfg);
+
+/**
+ * Advance a non-blocking connect + handshake
+ * @param t  Transport handle (closed, or with a handshake in progress)
+ * @return   DEVPROTO_TLS_OK once connected, DEVPROTO_TLS_ERR_WANT_READ or
+ *           DEVPROTO_TLS_ERR_WANT_WRITE to be called again when t->fd is
+ *           readable/writable, or another error code on failure
+ *
+ * The step never blocks: a name the resolver cache cannot answer is looked
+ * up on a helper thread, and t->fd is that lookup's descriptor (WANT_READ)
+ * until the TCP connect starts, so t->fd may change between calls.
+ * handshake_timeout_ms covers lookup, connect and handshake and is checked
+ * on each call; it fails with DEVPROTO_TLS_ERR_CONNECT before the TCP
+ * connection is up and DEVPROTO_TLS_ERR_HANDSHAKE after.
+ * devproto_transport_open() is the blocking equivalent;
+ * devproto_transport_open_step() and devproto_reactor_connect() use this
+ * for TLS transports.
+ */
+int devproto_tls_handshake_step(devproto_transport_t *t);
+
 /**
  * Get TLS connection info
  * @param t     Transport handle
@@ -195,6 +298,13 @@ const char *devproto_tls_strerror(devproto_tls_error_t err);
  */
 int devproto_tls_renegotiate(devproto_transport_t *t);
 
+/**
+ * Drop the cached session so the next open does a full handshake
+ * @param t  Transport handle
+ * @return   0 on success, error code on failure
+ */
+int devproto_tls_session_clear(devproto_transport_t *t);
+
 /**
  * Check if TLS support is available
  * @return  1 if TLS is available, 0 otherwise
@@ -216,6 +326,38 @@ static inline devproto_transport_t *devproto_transport_tls_create(
     return NULL;
 }
 
+static inline devproto_tls_context_t *devproto_tls_context_create(
+    const devproto_tls_config_t *cfg, devproto_tls_error_t *err) {
+    (void)cfg;
+    if (err) *err = DEVPROTO_TLS_ERR_NOT_SUPPORTED;
+    return NULL;
+}
+
+static inline devproto_tls_context_t *devproto_tls_context_ref(devproto_tls_context_t *ctx) {
+    return ctx;
+}
+
+static inline void devproto_tls_context_unref(devproto_tls_context_t *ctx) {
+    (void)ctx;
+}
+
+static inline int devproto_tls_context_reload(devproto_tls_context_t *ctx,
+                                              const devproto_tls_config_t *cfg) {
+    (void)ctx; (void)cfg;
+    return DEVPROTO_TLS_ERR_NOT_SUPPORTED;
+}
+
+static inline devproto_transport_t *devproto_transport_tls_create_ctx(
+    devproto_tls_context_t *ctx, const devproto_tls_config_t *cfg) {
+    (void)ctx; (void)cfg;
+    return NULL;
+}
+
+static inline int devproto_tls_handshake_step(devproto_transport_t *t) {
+    (void)t;
+    return DEVPROTO_TLS_ERR_NOT_SUPPORTED;
+}
+
 static inline int devproto_tls_get_info(devproto_transport_t *t,
                                          devproto_tls_info_t *info) {
     (void)t; (void)info;
@@ -242,6 +384,11 @@ static inline int devproto_tls_renegotiate(devproto_transport_t *t) {
     return DEVPROTO_TLS_ERR_NOT_SUPPORTED;
 }
 
+static inline int devproto_tls_session_clear(devproto_transport_t *t) {
+    (void)t;
+    return DEVPROTO_TLS_ERR_NOT_SUPPORTED;
+}
+
 static inline int devproto_tls_available(void) {
     return 0;
 }
@@ -5,6 +5,7 @@
  * Provides a common interface for different transport mechanisms:
  * - Serial/UART (termios)
  * - TCP sockets
+ * - Replay of a recorded capture file
  */
 
 #ifndef DEVPROTO_TRANSPORT_H
@@ -12,20 +13,29 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <sys/uio.h>
+#include "protocol.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Forward declaration */
+/* Forward declarations */
 typedef struct devproto_transport devproto_transport_t;
+typedef struct devproto_compress_config devproto_compress_config_t;
+typedef struct devproto_stats devproto_stats_t;
+typedef struct devproto_capture devproto_capture_t;
+typedef struct devproto_capture_reader devproto_capture_reader_t;
+typedef struct devproto_resolver devproto_resolver_t;
+typedef struct devproto_keepalive devproto_keepalive_t;
 
 /**
  * Transport type identifiers
  */
 typedef enum {
     DEVPROTO_TRANSPORT_SERIAL = 1,
-    DEVPROTO_TRANSPORT_TCP    = 2
+    DEVPROTO_TRANSPORT_TCP    = 2,
+    DEVPROTO_TRANSPORT_REPLAY = 4       /* 3 is DEVPROTO_TRANSPORT_TLS */
 } devproto_transport_type_t;
 
 /**
@@ -38,8 +48,17 @@ typedef struct {
     int  (*recv)(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms);
     int  (*available)(devproto_transport_t *t);
     int  (*flush)(devproto_transport_t *t);
+    int  (*sendv)(devproto_transport_t *t, const struct iovec *iov, int iovcnt); /* Optional */
+    int  (*pending)(devproto_transport_t *t);                   /* Optional */
+    int  (*drain)(devproto_transport_t *t, int timeout_ms);     /* Optional */
+    void (*destroy)(devproto_transport_t *t);   /* Optional: release priv (default free) */
+    int  (*open_step)(devproto_transport_t *t); /* Optional: non-blocking open */
 } devproto_transport_ops_t;
 
+/* Progress codes of devproto_transport_open_step() */
+#define DEVPROTO_TRANSPORT_WANT_READ    1
+#define DEVPROTO_TRANSPORT_WANT_WRITE   2
+
 /**
  * Transport base structure
  */
@@ -49,24 +68,229 @@ struct devproto_transport {
     void *priv;                         /* Transport-specific private data */
     int   fd;                           /* File descriptor (if applicable) */
     int   is_open;                      /* Connection state */
+    size_t max_payload;                 /* Negotiated payload limit (0 = legacy) */
+    devproto_compress_config_t *compress; /* Negotiated compression (NULL = off, owned) */
+    devproto_stats_t *stats;            /* Telemetry (NULL = off, not owned) */
+    devproto_capture_t *capture;        /* Recording tap (NULL = off, not owned) */
+    uint16_t capture_conn;              /* Connection id of recorded traffic */
 };
 
+/**
+ * Record a send for the link's stats and capture (used by the inline helpers)
+ * @param t     Transport handle
+ * @param data  Data passed to send
+ * @param len   Bytes requested
+ * @param n     Send result
+ */
+void devproto_transport_tap_send(devproto_transport_t *t, const uint8_t *data,
+                                 size_t len, int n);
+
+/**
+ * Record a receive for the link's stats and capture (inline helpers)
+ * @param t     Transport handle
+ * @param data  Receive buffer
+ * @param n     Receive result
+ */
+void devproto_transport_tap_recv(devproto_transport_t *t, const uint8_t *data, int n);
+
+/* Default serial read-ahead buffer (one maximum-size frame) */
+#define DEVPROTO_SERIAL_DEFAULT_RX_BUFFER  4096
+
+/* Default serial write timeout (a 4 KiB frame takes ~0.4 s at 115200) */
+#define DEVPROTO_SERIAL_WRITE_TIMEOUT_MS   5000
+
+/* Default limit of each serial outgoing priority queue */
+#define DEVPROTO_SERIAL_QUEUE_DEFAULT      (16 * 1024)
+
+/**
+ * Serial transport configuration
+ */
+typedef struct {
+    const char *device;            /* Device path (e.g., "/dev/ttyUSB0") */
+    int         baudrate;          /* Any rate; non-standard ones need Linux termios2 */
+    size_t      rx_buffer_size;    /* Read-ahead buffer (0 = read straight into caller buffer) */
+    int         low_latency;       /* Set ASYNC_LOW_LATENCY (Linux; ignored if unsupported) */
+    int         inter_byte_ms;     /* Gap that ends a VMIN read early (default: 100) */
+    int         write_timeout_ms;  /* Blocking send wait (-1 = forever) */
+    size_t      tx_queue_size;     /* Limit of each outgoing priority queue (0 = default) */
+} devproto_serial_config_t;
+
+/**
+ * Initialize default serial configuration
+ * @param cfg     Configuration structure to initialize
+ * @param device  Device path
+ */
+void devproto_serial_config_init(devproto_serial_config_t *cfg, const char *device);
+
 /**
  * Create serial transport
  * @param device    Device path (e.g., "/dev/ttyUSB0")
  * @param baudrate  Baud rate (default: 115200)
  * @return          Transport handle, or NULL on error
+ *
+ * Uses the defaults of devproto_serial_config_init().
  */
 devproto_transport_t *devproto_transport_serial_create(const char *device, int baudrate);
 
+/**
+ * Create serial transport from a configuration
+ * @param cfg  Serial configuration
+ * @return     Transport handle, or NULL on error
+ *
+ * Opening fails (errno EINVAL/ENOTSUP) if the baud rate cannot be set,
+ * instead of falling back to another rate.
+ */
+devproto_transport_t *devproto_transport_serial_create_ex(const devproto_serial_config_t *cfg);
+
+/**
+ * Tell a serial transport how many bytes the current frame still needs
+ * @param t          Serial transport handle
+ * @param remaining  Bytes still expected (devproto_frame_remaining()), 0 = unknown
+ * @return           0 on success, -1 on error
+ *
+ * Blocking receives then let the tty driver collect up to that many bytes
+ * (VMIN, at most 255) before waking the caller, so a large frame arrives in
+ * a few reads instead of one per FIFO interrupt. Receives with a zero
+ * timeout (reactor-driven) ignore the hint.
+ */
+int devproto_transport_serial_set_read_hint(devproto_transport_t *t, size_t remaining);
+
+/**
+ * Set how long a blocking serial send waits for the port to become writable
+ * @param t           Serial transport handle
+ * @param timeout_ms  Timeout in milliseconds (-1 to wait forever)
+ * @return            0 on success, -1 on error
+ *
+ * A send that times out before writing anything fails (errno ETIMEDOUT);
+ * one that times out part way queues the rest of its frame, which the next
+ * send or devproto_transport_drain() writes first, and reports success.
+ */
+int devproto_transport_serial_set_write_timeout(devproto_transport_t *t, int timeout_ms);
+
+/**
+ * Enable or disable non-blocking serial sends
+ * @param t          Serial transport handle
+ * @param enable     Non-zero to never wait in send
+ * @param max_queue  Limit of each outgoing priority queue in bytes (0 = default)
+ * @return           0 on success, -1 on error
+ *
+ * In non-blocking mode every send/sendv call is accepted whole (written
+ * and/or queued) or refused whole (-1, errno EAGAIN), so frames are never
+ * torn. Queued frames of type ALERT_EVENT, THRESHOLD_EXCEEDED and
+ * HARDWARE_FAULT are written before other queued frames, though never in
+ * the middle of one. Drain the queue with devproto_transport_drain() when
+ * the port becomes writable (the reactor does this).
+ */
+int devproto_transport_serial_set_nonblocking(devproto_transport_t *t, int enable,
+                                              size_t max_queue);
+
+/**
+ * TCP transport configuration
+ */
+typedef struct {
+    const char *host;              /* Host name or numeric address */
+    int         port;              /* Port number */
+    int         family;            /* AF_UNSPEC (default), AF_INET or AF_INET6 */
+    int         connect_timeout_ms; /* Whole connect, all addresses (-1 = none) */
+    int         attempt_delay_ms;  /* Head start of each address (0 = default) */
+    devproto_resolver_t *resolver; /* Name cache (NULL = process-wide) */
+    const devproto_keepalive_t *keepalive; /* Dead-peer detection (NULL = defaults) */
+} devproto_tcp_config_t;
+
+/* Default TCP connect timeout */
+#define DEVPROTO_TCP_CONNECT_TIMEOUT_MS 5000
+
+/**
+ * Initialize default TCP configuration (keepalive on)
+ * @param cfg   Configuration structure to initialize
+ * @param host  Host name or numeric address
+ * @param port  Port number
+ */
+void devproto_tcp_config_init(devproto_tcp_config_t *cfg, const char *host, int port);
+
 /**
  * Create TCP transport
  * @param host  Host address
  * @param port  Port number
  * @return      Transport handle, or NULL on error
+ *
+ * Same as devproto_transport_tcp_create_ex() with devproto_tcp_config_init()
+ * defaults.
  */
 devproto_transport_t *devproto_transport_tcp_create(const char *host, int port);
 
+/**
+ * Create TCP transport with explicit settings
+ * @param cfg  Configuration (host is copied)
+ * @return     Transport handle, or NULL on error
+ *
+ * Opening resolves through the resolver cache and connects happy-eyeballs
+ * style to the answer's IPv4 and IPv6 addresses (see net.h). A blocking
+ * open waits up to connect_timeout_ms; devproto_transport_open_step() (and
+ * so devproto_reactor_connect()) never blocks: a lookup the cache cannot
+ * answer runs on a resolver helper thread while t->fd is its descriptor.
+ */
+devproto_transport_t *devproto_transport_tcp_create_ex(const devproto_tcp_config_t *cfg);
+
+/* Default TCP write timeout (matches the TLS default) */
+#define DEVPROTO_TCP_WRITE_TIMEOUT_MS   5000
+
+/* Default outgoing queue limit for non-blocking TCP sends */
+#define DEVPROTO_TCP_QUEUE_DEFAULT      (64 * 1024)
+
+/**
+ * Set how long a blocking TCP send waits for the socket to become writable
+ * @param t           TCP transport handle
+ * @param timeout_ms  Timeout in milliseconds (-1 to wait forever)
+ * @return            0 on success, -1 on error
+ *
+ * On timeout the send returns the bytes written so far, or -1 (errno
+ * ETIMEDOUT) if none were.
+ */
+int devproto_transport_tcp_set_write_timeout(devproto_transport_t *t, int timeout_ms);
+
+/**
+ * Enable or disable non-blocking TCP sends
+ * @param t          TCP transport handle
+ * @param enable     Non-zero to never wait in send
+ * @param max_queue  Outgoing queue limit in bytes (0 = default)
+ * @return           0 on success, -1 on error
+ *
+ * In non-blocking mode send/sendv write what the socket takes right away and
+ * copy the rest into an outgoing queue; they return the bytes accepted, which
+ * is less than requested only when the queue is full (errno EAGAIN if
+ * nothing was accepted). Drain the queue with devproto_transport_drain()
+ * when the socket becomes writable.
+ */
+int devproto_transport_tcp_set_nonblocking(devproto_transport_t *t, int enable,
+                                           size_t max_queue);
+
+/**
+ * Replay transport configuration
+ */
+typedef struct {
+    uint16_t conn;                 /* Connection of the capture to replay */
+    uint8_t  dir;                  /* Records served by recv (default: DEVPROTO_CAPTURE_IN) */
+    double   speed;                /* 1.0 = recorded pace, 2.0 = twice as fast, 0 = no waits */
+} devproto_replay_config_t;
+
+/**
+ * Create a transport that replays one connection of a capture
+ * @param r    Mapped capture (not owned, must outlive the transport)
+ * @param cfg  Replay settings
+ * @return     Transport handle, or NULL on error
+ *
+ * Each receive returns (part of) the next record of cfg->conn in cfg->dir,
+ * so frames arrive torn as they were recorded, once its time has come:
+ * times count from the first such record and are divided by cfg->speed.
+ * A receive whose timeout ends first returns 0. After the last record
+ * receives fail like a closed TCP peer. Sends are accepted and dropped.
+ * Opening (again) starts over. There is no fd, so drive it with receive
+ * timeouts (sessions, blocking loops), not a reactor.
+ */
+devproto_transport_t *devproto_transport_replay_create(const devproto_capture_reader_t *r,
+                                                       const devproto_replay_config_t *cfg);
+
 /**
  * Destroy transport and free resources
  * @param t  Transport handle
@@ -83,6 +307,23 @@ static inline int devproto_transport_open(devproto_transport_t *t) {
     return t->ops->open(t);
 }
 
+/**
+ * Advance a non-blocking open
+ * @param t  Transport handle
+ * @return   0 once open, DEVPROTO_TRANSPORT_WANT_READ/WANT_WRITE to be called
+ *           again when t->fd is readable/writable, or -1 on error
+ *
+ * t->fd is valid from the first WANT_* return on, but may change between
+ * steps (TCP waits on the resolver first, then on the connect). Transports
+ * without a non-blocking open fall back to a blocking devproto_transport_open().
+ */
+static inline int devproto_transport_open_step(devproto_transport_t *t) {
+    if (!t || !t->ops) return -1;
+    if (t->ops->open_step) return t->ops->open_step(t);
+    if (!t->ops->open) return -1;
+    return t->ops->open(t);
+}
+
 /**
  * Close transport connection
  * @param t  Transport handle
@@ -103,7 +344,109 @@ static inline void devproto_transport_close(devproto_transport_t *t) {
 static inline int devproto_transport_send(devproto_transport_t *t,
                                           const uint8_t *data, size_t len) {
     if (!t || !t->ops || !t->ops->send) return -1;
-    return t->ops->send(t, data, len);
+    int n = t->ops->send(t, data, len);
+    if (t->stats || t->capture) devproto_transport_tap_send(t, data, len, n);
+    return n;
+}
+
+/**
+ * Send scatter-gather data over transport
+ * @param t       Transport handle
+ * @param iov     Buffers to send in order
+ * @param iovcnt  Number of buffers
+ * @return        Number of bytes sent, or -1 on error
+ *
+ * Uses the transport's sendv op (one writev/sendmsg) when present, otherwise
+ * packs consecutive buffers into frame-sized bounce-buffer sends (buffers
+ * larger than a frame are sent directly).
+ */
+int devproto_transport_sendv(devproto_transport_t *t,
+                             const struct iovec *iov, int iovcnt);
+
+/**
+ * Set the payload limit negotiated for this link
+ * @param t            Transport handle
+ * @param max_payload  DEVPROTO_MAX_PAYLOAD_SIZE (legacy frames only) up to
+ *                     DEVPROTO_JUMBO_MAX_PAYLOAD (DEVPROTO_CAP_JUMBO_FRAMES)
+ * @return             0 on success, -1 if out of range
+ *
+ * Send helpers emit extended-length frames for payloads above
+ * DEVPROTO_MAX_PAYLOAD_SIZE, and parsers owned by sessions and reactors
+ * accept them, only up to this limit.
+ */
+int devproto_transport_set_max_payload(devproto_transport_t *t, size_t max_payload);
+
+/**
+ * Enable payload compression negotiated for this link
+ * @param t    Transport handle
+ * @param cfg  Settings (copied); codec DEVPROTO_CODEC_NONE only accepts
+ *             compressed frames. NULL disables compression.
+ * @return     0 on success, -1 if cfg has no pool or an unknown codec (or
+ *             out of memory)
+ *
+ * Once enabled, send helpers compress payloads of at least cfg->threshold
+ * bytes that shrink, and parsers owned by sessions and reactors expand
+ * compressed frames.
+ */
+int devproto_transport_set_compression(devproto_transport_t *t,
+                                       const devproto_compress_config_t *cfg);
+
+/**
+ * Attach telemetry to this link
+ * @param t   Transport handle
+ * @param st  Stats object (not owned, must outlive the attachment), or
+ *            NULL to detach
+ * @return    0 on success, -1 on error
+ *
+ * Transport calls, the send helpers and the sessions and reactors driving
+ * this transport then record into st.
+ */
+int devproto_transport_set_stats(devproto_transport_t *t, devproto_stats_t *st);
+
+/**
+ * Record this link's traffic
+ * @param t     Transport handle
+ * @param cap   Capture (not owned, must outlive the attachment), or NULL
+ *              to detach
+ * @param conn  Connection id written with each record
+ * @return      0 on success, -1 on error
+ *
+ * Every chunk that send, sendv and receive calls move is then appended
+ * to cap as one record.
+ */
+int devproto_transport_set_capture(devproto_transport_t *t, devproto_capture_t *cap,
+                                   uint16_t conn);
+
+/**
+ * Get the payload limit of this link
+ * @param t  Transport handle
+ * @return   Largest payload that may be sent or received
+ */
+static inline size_t devproto_transport_max_payload(const devproto_transport_t *t) {
+    return t && t->max_payload ? t->max_payload : DEVPROTO_MAX_PAYLOAD_SIZE;
+}
+
+/**
+ * Get number of bytes queued for sending
+ * @param t  Transport handle
+ * @return   Queued bytes (0 for transports without a queue), or -1 on error
+ */
+static inline int devproto_transport_pending(devproto_transport_t *t) {
+    if (!t || !t->ops) return -1;
+    if (!t->ops->pending) return 0;
+    return t->ops->pending(t);
+}
+
+/**
+ * Write queued bytes
+ * @param t           Transport handle
+ * @param timeout_ms  Time to wait for writability (0 = don't wait, -1 = forever)
+ * @return            Bytes still queued, or -1 on error
+ */
+static inline int devproto_transport_drain(devproto_transport_t *t, int timeout_ms) {
+    if (!t || !t->ops) return -1;
+    if (!t->ops->drain) return 0;
+    return t->ops->drain(t, timeout_ms);
 }
 
 /**
@@ -118,7 +461,9 @@ static inline int devproto_transport_recv(devproto_transport_t *t,
                                           uint8_t *data, size_t len,
                                           int timeout_ms) {
     if (!t || !t->ops || !t->ops->recv) return -1;
-    return t->ops->recv(t, data, len, timeout_ms);
+    int n = t->ops->recv(t, data, len, timeout_ms);
+    if (t->stats || t->capture) devproto_transport_tap_recv(t, data, n);
+    return n;
 }
 
 /**
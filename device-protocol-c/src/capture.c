@@ -0,0 +1,616 @@
+/**
+ * @file capture.c
+ * @brief Capture file writer and mapped reader
+ *
+ * The writer appends records to a buffer under a mutex and writes it out
+ * when full, so a recording tap costs a memcpy per transport call. Per-
+ * connection totals and seek entries are kept in memory and written as the
+ * index when the capture is finished; the header's index offset stays 0
+ * until then, which tells a reader to recover by scanning.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "devproto/capture.h"
+
+#define CAPTURE_MAGIC       "DPCP"
+#define CAPTURE_INDEX_MAGIC "DPIX"
+#define CAPTURE_INDEX_SIZE  32
+#define CAPTURE_CONN_SIZE   40
+#define CAPTURE_SEEK_SIZE   16
+
+static void cap_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (v >> 8) & 0xFF;
+    p[1] = v & 0xFF;
+}
+
+static void cap_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+static void cap_put_u64(uint8_t *p, uint64_t v)
+{
+    cap_put_u32(p, (uint32_t)(v >> 32));
+    cap_put_u32(p + 4, (uint32_t)v);
+}
+
+static uint16_t cap_get_u16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t cap_get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t cap_get_u64(const uint8_t *p)
+{
+    return ((uint64_t)cap_get_u32(p) << 32) | cap_get_u32(p + 4);
+}
+
+static uint64_t cap_clock_us(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/**
+ * Find or add a connection in a totals table
+ */
+static devproto_capture_conn_t *cap_conn(devproto_capture_conn_t **conns, size_t *count,
+                                         size_t *cap, uint16_t conn)
+{
+    for (size_t i = 0; i < *count; i++) {
+        if ((*conns)[i].conn == conn) return &(*conns)[i];
+    }
+
+    if (*count == *cap) {
+        size_t n = *cap ? *cap * 2 : 8;
+        devproto_capture_conn_t *grown = realloc(*conns, n * sizeof(*grown));
+        if (!grown) return NULL;
+        *conns = grown;
+        *cap = n;
+    }
+
+    devproto_capture_conn_t *c = &(*conns)[(*count)++];
+    memset(c, 0, sizeof(*c));
+    c->conn = conn;
+    return c;
+}
+
+static void cap_conn_add(devproto_capture_conn_t *c, uint8_t dir, uint64_t len)
+{
+    if (dir == DEVPROTO_CAPTURE_OUT) {
+        c->records_out++;
+        c->bytes_out += len;
+    } else {
+        c->records_in++;
+        c->bytes_in += len;
+    }
+}
+
+/* ---- Writer ---- */
+
+typedef struct {
+    uint64_t time_us;
+    uint64_t offset;
+} cap_seek_t;
+
+struct devproto_capture {
+    pthread_mutex_t lock;
+    int      fd;                        /* -1 once finished */
+    int      error;                     /* errno of the first failed write */
+    uint64_t start_us;                  /* Monotonic clock at create */
+    uint64_t last_us;                   /* Time of the last record */
+    uint64_t written;                   /* File bytes before buf */
+    uint64_t records;
+
+    uint8_t  buf[DEVPROTO_CAPTURE_BUFFER];
+    size_t   buf_len;
+
+    devproto_capture_conn_t *conns;
+    size_t   conn_count;
+    size_t   conn_cap;
+
+    cap_seek_t *seeks;
+    size_t   seek_count;
+    size_t   seek_cap;
+};
+
+/**
+ * Write all bytes, recording the first failure
+ */
+static int cap_write(devproto_capture_t *cap, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(cap->fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            cap->error = n < 0 ? errno : EIO;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+        cap->written += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int cap_flush_locked(devproto_capture_t *cap)
+{
+    if (cap->error) return -1;
+    if (cap->buf_len == 0) return 0;
+
+    size_t len = cap->buf_len;
+    cap->buf_len = 0;
+    return cap_write(cap, cap->buf, len);
+}
+
+/**
+ * Add buffered bytes, writing the buffer out when it fills
+ */
+static int cap_append(devproto_capture_t *cap, const uint8_t *data, size_t len)
+{
+    if (cap->buf_len + len > sizeof(cap->buf)) {
+        if (cap_flush_locked(cap) != 0) return -1;
+        if (len > sizeof(cap->buf)) return cap_write(cap, data, len);
+    }
+    memcpy(cap->buf + cap->buf_len, data, len);
+    cap->buf_len += len;
+    return 0;
+}
+
+/**
+ * Create capture file
+ */
+devproto_capture_t *devproto_capture_create(const char *path)
+{
+    if (!path) return NULL;
+
+    devproto_capture_t *cap = calloc(1, sizeof(*cap));
+    if (!cap) return NULL;
+
+    cap->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (cap->fd < 0) {
+        free(cap);
+        return NULL;
+    }
+    pthread_mutex_init(&cap->lock, NULL);
+    cap->start_us = cap_clock_us(CLOCK_MONOTONIC);
+
+    uint8_t *h = cap->buf;
+    memcpy(h, CAPTURE_MAGIC, 4);
+    cap_put_u16(h + 4, DEVPROTO_CAPTURE_VERSION);
+    cap_put_u16(h + 6, DEVPROTO_CAPTURE_HEADER_SIZE);
+    cap_put_u64(h + 8, cap_clock_us(CLOCK_REALTIME));
+    memset(h + 16, 0, 16);              /* Index offset and records: see finish */
+    cap->buf_len = DEVPROTO_CAPTURE_HEADER_SIZE;
+
+    return cap;
+}
+
+/**
+ * Start a record: stamp it and add its header to the buffer
+ */
+static int cap_begin(devproto_capture_t *cap, uint16_t conn, devproto_capture_dir_t dir,
+                     size_t len)
+{
+    if (cap->fd < 0 || cap->error || len > UINT32_MAX) return -1;
+
+    /* Stamped under the lock, so times never go backwards in the file */
+    uint64_t now = cap_clock_us(CLOCK_MONOTONIC) - cap->start_us;
+    if (now < cap->last_us) now = cap->last_us;
+    cap->last_us = now;
+
+    devproto_capture_conn_t *c = cap_conn(&cap->conns, &cap->conn_count, &cap->conn_cap, conn);
+    if (!c) return -1;
+    cap_conn_add(c, (uint8_t)dir, len);
+
+    if (cap->records % DEVPROTO_CAPTURE_SEEK_INTERVAL == 0) {
+        if (cap->seek_count == cap->seek_cap) {
+            size_t n = cap->seek_cap ? cap->seek_cap * 2 : 64;
+            cap_seek_t *grown = realloc(cap->seeks, n * sizeof(*grown));
+            if (!grown) return -1;
+            cap->seeks = grown;
+            cap->seek_cap = n;
+        }
+        cap->seeks[cap->seek_count].time_us = now;
+        cap->seeks[cap->seek_count].offset = cap->written + cap->buf_len;
+        cap->seek_count++;
+    }
+    cap->records++;
+
+    uint8_t h[DEVPROTO_CAPTURE_RECORD_HEADER];
+    cap_put_u64(h, now);
+    cap_put_u32(h + 8, (uint32_t)len);
+    cap_put_u16(h + 12, conn);
+    h[14] = (uint8_t)dir;
+    h[15] = 0;
+    return cap_append(cap, h, sizeof(h));
+}
+
+/**
+ * Append one record
+ */
+int devproto_capture_record(devproto_capture_t *cap, uint16_t conn,
+                            devproto_capture_dir_t dir, const uint8_t *data, size_t len)
+{
+    if (!cap || (!data && len > 0)) return -1;
+
+    pthread_mutex_lock(&cap->lock);
+    int ret = cap_begin(cap, conn, dir, len);
+    if (ret == 0 && len > 0) ret = cap_append(cap, data, len);
+    pthread_mutex_unlock(&cap->lock);
+    return ret;
+}
+
+/**
+ * Append the first len bytes of a buffer list as one record
+ */
+int devproto_capture_recordv(devproto_capture_t *cap, uint16_t conn, devproto_capture_dir_t dir,
+                             const struct iovec *iov, int iovcnt, size_t len)
+{
+    if (!cap || (!iov && iovcnt > 0) || iovcnt < 0) return -1;
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) total += iov[i].iov_len;
+    if (len > total) return -1;
+
+    pthread_mutex_lock(&cap->lock);
+    int ret = cap_begin(cap, conn, dir, len);
+    for (int i = 0; ret == 0 && i < iovcnt && len > 0; i++) {
+        size_t n = iov[i].iov_len < len ? iov[i].iov_len : len;
+        ret = cap_append(cap, iov[i].iov_base, n);
+        len -= n;
+    }
+    pthread_mutex_unlock(&cap->lock);
+    return ret;
+}
+
+/**
+ * Write buffered records
+ */
+int devproto_capture_flush(devproto_capture_t *cap)
+{
+    if (!cap) return -1;
+
+    pthread_mutex_lock(&cap->lock);
+    int ret = cap->fd < 0 ? -1 : cap_flush_locked(cap);
+    pthread_mutex_unlock(&cap->lock);
+    return ret;
+}
+
+/**
+ * Write the index block after the records
+ */
+static int cap_write_index(devproto_capture_t *cap)
+{
+    uint8_t h[CAPTURE_INDEX_SIZE];
+    memcpy(h, CAPTURE_INDEX_MAGIC, 4);
+    cap_put_u32(h + 4, (uint32_t)cap->conn_count);
+    cap_put_u32(h + 8, (uint32_t)cap->seek_count);
+    cap_put_u32(h + 12, DEVPROTO_CAPTURE_SEEK_INTERVAL);
+    cap_put_u64(h + 16, cap->records);
+    cap_put_u64(h + 24, cap->last_us);
+    if (cap_append(cap, h, sizeof(h)) != 0) return -1;
+
+    for (size_t i = 0; i < cap->conn_count; i++) {
+        const devproto_capture_conn_t *c = &cap->conns[i];
+        uint8_t e[CAPTURE_CONN_SIZE];
+        cap_put_u16(e, c->conn);
+        memset(e + 2, 0, 6);
+        cap_put_u64(e + 8, c->records_in);
+        cap_put_u64(e + 16, c->records_out);
+        cap_put_u64(e + 24, c->bytes_in);
+        cap_put_u64(e + 32, c->bytes_out);
+        if (cap_append(cap, e, sizeof(e)) != 0) return -1;
+    }
+
+    for (size_t i = 0; i < cap->seek_count; i++) {
+        uint8_t e[CAPTURE_SEEK_SIZE];
+        cap_put_u64(e, cap->seeks[i].time_us);
+        cap_put_u64(e + 8, cap->seeks[i].offset);
+        if (cap_append(cap, e, sizeof(e)) != 0) return -1;
+    }
+
+    return cap_flush_locked(cap);
+}
+
+/**
+ * Write the index and close the file
+ */
+int devproto_capture_finish(devproto_capture_t *cap)
+{
+    if (!cap) return -1;
+
+    pthread_mutex_lock(&cap->lock);
+    if (cap->fd < 0) {
+        pthread_mutex_unlock(&cap->lock);
+        return cap->error ? -1 : 0;
+    }
+
+    uint64_t index_offset = cap->written + cap->buf_len;
+    int ret = cap_write_index(cap);
+    if (ret == 0) {
+        /* Publish the index last: a torn index is never pointed to */
+        uint8_t h[16];
+        cap_put_u64(h, index_offset);
+        cap_put_u64(h + 8, cap->records);
+        ssize_t n = pwrite(cap->fd, h, sizeof(h), 16);
+        if (n != (ssize_t)sizeof(h)) {
+            cap->error = n < 0 ? errno : EIO;
+            ret = -1;
+        }
+    }
+    if (close(cap->fd) != 0 && ret == 0) {
+        cap->error = errno;
+        ret = -1;
+    }
+    cap->fd = -1;
+    pthread_mutex_unlock(&cap->lock);
+    return ret;
+}
+
+/**
+ * Destroy capture
+ */
+void devproto_capture_destroy(devproto_capture_t *cap)
+{
+    if (!cap) return;
+
+    devproto_capture_finish(cap);
+    pthread_mutex_destroy(&cap->lock);
+    free(cap->conns);
+    free(cap->seeks);
+    free(cap);
+}
+
+/* ---- Reader ---- */
+
+struct devproto_capture_reader {
+    const uint8_t *map;
+    size_t   size;
+    size_t   end;                       /* End of the records */
+    uint64_t start_time_us;
+    uint64_t duration_us;
+    uint64_t records;
+    int      indexed;
+
+    devproto_capture_conn_t *conns;
+    size_t   conn_count;
+
+    const uint8_t *seeks;               /* Seek entries in the map, or NULL */
+    size_t   seek_count;
+};
+
+/**
+ * Load the index, or return -1 if it is missing or does not fit
+ */
+static int cap_load_index(devproto_capture_reader_t *r, uint64_t offset)
+{
+    if (offset < DEVPROTO_CAPTURE_HEADER_SIZE || offset > r->size ||
+        r->size - offset < CAPTURE_INDEX_SIZE) {
+        return -1;
+    }
+
+    const uint8_t *h = r->map + offset;
+    if (memcmp(h, CAPTURE_INDEX_MAGIC, 4) != 0) return -1;
+
+    uint64_t conns = cap_get_u32(h + 4);
+    uint64_t seeks = cap_get_u32(h + 8);
+    if (conns * CAPTURE_CONN_SIZE + seeks * CAPTURE_SEEK_SIZE >
+        r->size - offset - CAPTURE_INDEX_SIZE) {
+        return -1;
+    }
+
+    r->conns = calloc(conns ? conns : 1, sizeof(*r->conns));
+    if (!r->conns) return -1;
+
+    const uint8_t *e = h + CAPTURE_INDEX_SIZE;
+    for (size_t i = 0; i < conns; i++, e += CAPTURE_CONN_SIZE) {
+        r->conns[i].conn = cap_get_u16(e);
+        r->conns[i].records_in = cap_get_u64(e + 8);
+        r->conns[i].records_out = cap_get_u64(e + 16);
+        r->conns[i].bytes_in = cap_get_u64(e + 24);
+        r->conns[i].bytes_out = cap_get_u64(e + 32);
+    }
+
+    r->conn_count = conns;
+    r->seeks = seeks ? e : NULL;
+    r->seek_count = seeks;
+    r->records = cap_get_u64(h + 16);
+    r->duration_us = cap_get_u64(h + 24);
+    r->end = (size_t)offset;
+    r->indexed = 1;
+    return 0;
+}
+
+/**
+ * Rebuild the summary of an unfinished capture from its whole records
+ */
+static int cap_scan(devproto_capture_reader_t *r)
+{
+    size_t pos = DEVPROTO_CAPTURE_HEADER_SIZE;
+    size_t cap = 0;
+
+    while (r->size - pos >= DEVPROTO_CAPTURE_RECORD_HEADER) {
+        const uint8_t *h = r->map + pos;
+        uint32_t len = cap_get_u32(h + 8);
+        if (len > r->size - pos - DEVPROTO_CAPTURE_RECORD_HEADER) break;
+
+        /* A torn index after the records is not a record: its 15th byte is
+         * a bit of the seek interval */
+        if (h[14] > DEVPROTO_CAPTURE_OUT || h[15] != 0) break;
+
+        devproto_capture_conn_t *c = cap_conn(&r->conns, &r->conn_count, &cap,
+                                              cap_get_u16(h + 12));
+        if (!c) return -1;
+        cap_conn_add(c, h[14], len);
+
+        r->duration_us = cap_get_u64(h);
+        r->records++;
+        pos += DEVPROTO_CAPTURE_RECORD_HEADER + len;
+    }
+
+    r->end = pos;
+    return 0;
+}
+
+/**
+ * Map a capture file
+ */
+devproto_capture_reader_t *devproto_capture_reader_open(const char *path)
+{
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < DEVPROTO_CAPTURE_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    /* Replays read front to back */
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const uint8_t *h = map;
+    devproto_capture_reader_t *r = NULL;
+    if (memcmp(h, CAPTURE_MAGIC, 4) != 0 ||
+        cap_get_u16(h + 4) != DEVPROTO_CAPTURE_VERSION ||
+        cap_get_u16(h + 6) != DEVPROTO_CAPTURE_HEADER_SIZE ||
+        !(r = calloc(1, sizeof(*r)))) {
+        munmap(map, size);
+        return NULL;
+    }
+
+    r->map = map;
+    r->size = size;
+    r->start_time_us = cap_get_u64(h + 8);
+
+    if (cap_load_index(r, cap_get_u64(h + 16)) != 0 && cap_scan(r) != 0) {
+        devproto_capture_reader_destroy(r);
+        return NULL;
+    }
+    return r;
+}
+
+/**
+ * Unmap capture file
+ */
+void devproto_capture_reader_destroy(devproto_capture_reader_t *r)
+{
+    if (!r) return;
+
+    munmap((void *)r->map, r->size);
+    free(r->conns);
+    free(r);
+}
+
+/**
+ * Get capture summary
+ */
+void devproto_capture_reader_info(const devproto_capture_reader_t *r,
+                                  devproto_capture_info_t *info)
+{
+    if (!info) return;
+
+    memset(info, 0, sizeof(*info));
+    if (!r) return;
+
+    info->start_time_us = r->start_time_us;
+    info->duration_us = r->duration_us;
+    info->records = r->records;
+    info->conn_count = r->conn_count;
+    info->indexed = r->indexed;
+}
+
+/**
+ * Get connection totals
+ */
+const devproto_capture_conn_t *devproto_capture_reader_conn(const devproto_capture_reader_t *r,
+                                                            size_t i)
+{
+    if (!r || i >= r->conn_count) return NULL;
+    return &r->conns[i];
+}
+
+/**
+ * Read the record at a cursor
+ */
+int devproto_capture_reader_next(const devproto_capture_reader_t *r, size_t *cursor,
+                                 devproto_capture_entry_t *entry)
+{
+    if (!r || !cursor || !entry) return -1;
+
+    size_t pos = *cursor < DEVPROTO_CAPTURE_HEADER_SIZE ? DEVPROTO_CAPTURE_HEADER_SIZE : *cursor;
+    if (pos >= r->end) return 0;
+    if (r->end - pos < DEVPROTO_CAPTURE_RECORD_HEADER) return -1;
+
+    const uint8_t *h = r->map + pos;
+    uint32_t len = cap_get_u32(h + 8);
+    if (len > r->end - pos - DEVPROTO_CAPTURE_RECORD_HEADER) return -1;
+
+    entry->time_us = cap_get_u64(h);
+    entry->len = len;
+    entry->conn = cap_get_u16(h + 12);
+    entry->dir = h[14];
+    entry->data = h + DEVPROTO_CAPTURE_RECORD_HEADER;
+
+    *cursor = pos + DEVPROTO_CAPTURE_RECORD_HEADER + len;
+    return 1;
+}
+
+/**
+ * Find the first record at or after a time
+ */
+size_t devproto_capture_reader_seek(const devproto_capture_reader_t *r, uint64_t time_us)
+{
+    if (!r) return 0;
+
+    /* Last seek entry strictly before the time, then scan */
+    size_t cursor = DEVPROTO_CAPTURE_HEADER_SIZE;
+    size_t lo = 0, hi = r->seek_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const uint8_t *e = r->seeks + mid * CAPTURE_SEEK_SIZE;
+        if (cap_get_u64(e) < time_us) {
+            uint64_t offset = cap_get_u64(e + 8);
+            if (offset >= DEVPROTO_CAPTURE_HEADER_SIZE && offset <= r->end) {
+                cursor = (size_t)offset;
+            }
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (;;) {
+        size_t pos = cursor;
+        devproto_capture_entry_t e;
+        if (devproto_capture_reader_next(r, &cursor, &e) != 1 || e.time_us >= time_us) {
+            return pos;
+        }
+    }
+}
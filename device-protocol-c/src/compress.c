@@ -0,0 +1,413 @@
+/**
+ * @file compress.c
+ * @brief Built-in payload codecs (heatshrink LZSS, LZ4 block)
+ */
+
+#include <string.h>
+#include "devproto/compress.h"
+
+/* heatshrink parameters: 2^8 byte window, 2^4 byte lookahead */
+#define HS_WINDOW_BITS      8
+#define HS_LOOKAHEAD_BITS   4
+#define HS_WINDOW           (1u << HS_WINDOW_BITS)
+#define HS_LOOKAHEAD        (1u << HS_LOOKAHEAD_BITS)
+#define HS_MIN_MATCH        2       /* 13-bit backref beats two 9-bit literals */
+
+/* LZ4 block format limits */
+#define LZ4_MIN_MATCH       4
+#define LZ4_LAST_LITERALS   5       /* Block ends with at least this many literals */
+#define LZ4_MFLIMIT         12      /* Last match starts this far from the end */
+#define LZ4_MAX_OFFSET      65535
+#define LZ4_HASH_BITS       12
+
+/* Largest payload the 16-bit original length can describe */
+#define COMPRESS_MAX_INPUT  65535
+
+/**
+ * MSB-first bit writer
+ */
+typedef struct {
+    uint8_t *dst;
+    size_t   cap;
+    size_t   pos;
+    uint8_t  cur;
+    uint8_t  mask;
+    int      overflow;
+} hs_writer_t;
+
+/**
+ * MSB-first bit reader
+ */
+typedef struct {
+    const uint8_t *src;
+    size_t   bits;                      /* Input length in bits */
+    size_t   bit;                       /* Next bit to read */
+} hs_reader_t;
+
+/**
+ * Append the low `count` bits of value
+ */
+static void hs_put_bits(hs_writer_t *w, unsigned value, int count)
+{
+    for (int i = count - 1; i >= 0; i--) {
+        if ((value >> i) & 1) w->cur |= w->mask;
+        w->mask >>= 1;
+        if (!w->mask) {
+            if (w->pos < w->cap) w->dst[w->pos++] = w->cur;
+            else w->overflow = 1;
+            w->cur = 0;
+            w->mask = 0x80;
+        }
+    }
+}
+
+/**
+ * Read `count` bits, or -1 if the input ends first
+ */
+static int hs_get_bits(hs_reader_t *r, int count)
+{
+    if ((size_t)count > r->bits - r->bit) return -1;
+
+    int value = 0;
+    for (int i = 0; i < count; i++, r->bit++) {
+        value = (value << 1) | ((r->src[r->bit >> 3] >> (7 - (r->bit & 7))) & 1);
+    }
+    return value;
+}
+
+/**
+ * heatshrink encoder: greedy longest match within the window, searched
+ * directly in the input (no index, no state beyond the output)
+ */
+static int hs_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    hs_writer_t w = { .dst = dst, .cap = cap, .mask = 0x80 };
+    size_t i = 0;
+
+    while (i < len && !w.overflow) {
+        size_t max = len - i < HS_LOOKAHEAD ? len - i : HS_LOOKAHEAD;
+        size_t start = i > HS_WINDOW ? i - HS_WINDOW : 0;
+        size_t best_len = 0, best_dist = 0;
+
+        /* Nearest candidates first; a match may run into the lookahead */
+        for (size_t j = i; j-- > start;) {
+            if (src[j] != src[i]) continue;
+
+            size_t m = 1;
+            while (m < max && src[j + m] == src[i + m]) m++;
+            if (m > best_len) {
+                best_len = m;
+                best_dist = i - j;
+                if (m == max) break;
+            }
+        }
+
+        if (best_len >= HS_MIN_MATCH) {
+            hs_put_bits(&w, 0, 1);
+            hs_put_bits(&w, (unsigned)(best_dist - 1), HS_WINDOW_BITS);
+            hs_put_bits(&w, (unsigned)(best_len - 1), HS_LOOKAHEAD_BITS);
+            i += best_len;
+        } else {
+            hs_put_bits(&w, 1, 1);
+            hs_put_bits(&w, src[i], 8);
+            i++;
+        }
+    }
+
+    /* Pad the last byte; padding is shorter than any symbol */
+    if (w.mask != 0x80) {
+        if (w.pos < w.cap) w.dst[w.pos++] = w.cur;
+        else w.overflow = 1;
+    }
+    return w.overflow ? -1 : (int)w.pos;
+}
+
+/**
+ * heatshrink decoder; like the reference decoder the window starts out
+ * zero-filled
+ */
+static int hs_decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    hs_reader_t r = { .src = src, .bits = len * 8 };
+    size_t out = 0;
+
+    for (;;) {
+        int tag = hs_get_bits(&r, 1);
+        if (tag < 0) break;
+
+        if (tag) {
+            int byte = hs_get_bits(&r, 8);
+            if (byte < 0) break;
+            if (out >= cap) return -1;
+            dst[out++] = (uint8_t)byte;
+            continue;
+        }
+
+        int index = hs_get_bits(&r, HS_WINDOW_BITS);
+        if (index < 0) break;
+        int count = hs_get_bits(&r, HS_LOOKAHEAD_BITS);
+        if (count < 0) break;
+
+        size_t dist = (size_t)index + 1;
+        size_t n = (size_t)count + 1;
+        if (n > cap - out) return -1;
+        for (size_t k = 0; k < n; k++, out++) {
+            dst[out] = dist > out ? 0 : dst[out - dist];
+        }
+    }
+
+    return (int)out;
+}
+
+/**
+ * Unaligned 32-bit load
+ */
+static uint32_t lz4_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * Hash of the next four bytes
+ */
+static unsigned lz4_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+/**
+ * Write an extended length (the part beyond the token's 15)
+ */
+static void lz4_put_length(uint8_t *dst, size_t *pos, size_t n)
+{
+    while (n >= 255) {
+        dst[(*pos)++] = 255;
+        n -= 255;
+    }
+    dst[(*pos)++] = (uint8_t)n;
+}
+
+/**
+ * Emit one sequence: literals, then a match unless mlen is 0 (last sequence)
+ */
+static int lz4_emit(uint8_t *dst, size_t cap, size_t *pos,
+                    const uint8_t *lit, size_t litlen, size_t offset, size_t mlen)
+{
+    size_t ml = mlen ? mlen - LZ4_MIN_MATCH : 0;
+    size_t need = 1 + litlen + litlen / 255 + 1 + (mlen ? 2 + ml / 255 + 1 : 0);
+    if (need > cap - *pos) return -1;
+
+    uint8_t *token = &dst[(*pos)++];
+    *token = (uint8_t)(((litlen < 15 ? litlen : 15) << 4) | (ml < 15 ? ml : 15));
+    if (litlen >= 15) lz4_put_length(dst, pos, litlen - 15);
+
+    memcpy(dst + *pos, lit, litlen);
+    *pos += litlen;
+
+    if (mlen) {
+        dst[(*pos)++] = (uint8_t)(offset & 0xFF);
+        dst[(*pos)++] = (uint8_t)(offset >> 8);
+        if (ml >= 15) lz4_put_length(dst, pos, ml - 15);
+    }
+    return 0;
+}
+
+/**
+ * LZ4 block encoder: single-probe hash table of 16-bit positions (inputs
+ * are at most 64 KiB, so every position and offset fits)
+ */
+static int lz4_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    uint16_t table[1u << LZ4_HASH_BITS];
+    size_t ip = 0, anchor = 0, pos = 0;
+
+    memset(table, 0, sizeof(table));
+
+    if (len > LZ4_MFLIMIT) {
+        size_t limit = len - LZ4_MFLIMIT;
+        size_t match_limit = len - LZ4_LAST_LITERALS;
+
+        while (ip <= limit) {
+            uint32_t seq = lz4_read32(src + ip);
+            unsigned h = lz4_hash(seq);
+            size_t ref = table[h];
+            table[h] = (uint16_t)ip;
+
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || lz4_read32(src + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            size_t m = LZ4_MIN_MATCH;
+            while (ip + m < match_limit && src[ref + m] == src[ip + m]) m++;
+
+            if (lz4_emit(dst, cap, &pos, src + anchor, ip - anchor, ip - ref, m) != 0) {
+                return -1;
+            }
+            ip += m;
+            anchor = ip;
+        }
+    }
+
+    if (lz4_emit(dst, cap, &pos, src + anchor, len - anchor, 0, 0) != 0) return -1;
+    return (int)pos;
+}
+
+/**
+ * Read an extended length after a token nibble of 15
+ */
+static int lz4_get_length(const uint8_t *src, size_t len, size_t *ip, size_t *n)
+{
+    uint8_t b;
+    do {
+        if (*ip >= len) return -1;
+        b = src[(*ip)++];
+        *n += b;
+    } while (b == 255);
+    return 0;
+}
+
+/**
+ * LZ4 block decoder with full bounds checking
+ */
+static int lz4_decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    size_t ip = 0, op = 0;
+
+    while (ip < len) {
+        uint8_t token = src[ip++];
+
+        size_t lit = token >> 4;
+        if (lit == 15 && lz4_get_length(src, len, &ip, &lit) != 0) return -1;
+        if (lit > len - ip || lit > cap - op) return -1;
+        memcpy(dst + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+
+        if (ip == len) break;       /* Last sequence has no match */
+
+        if (len - ip < 2) return -1;
+        size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) return -1;
+
+        size_t ml = token & 0x0F;
+        if (ml == 15 && lz4_get_length(src, len, &ip, &ml) != 0) return -1;
+        ml += LZ4_MIN_MATCH;
+        if (ml > cap - op) return -1;
+
+        /* Byte copy: the match may overlap what it produces */
+        const uint8_t *from = dst + op - offset;
+        for (size_t k = 0; k < ml; k++) dst[op + k] = from[k];
+        op += ml;
+    }
+
+    return (int)op;
+}
+
+/**
+ * Initialize default settings
+ */
+void devproto_compress_config_init(devproto_compress_config_t *cfg,
+                                   devproto_frame_pool_t *pool)
+{
+    if (!cfg) return;
+
+    cfg->codec = DEVPROTO_CODEC_DEFAULT;
+    cfg->threshold = DEVPROTO_COMPRESS_THRESHOLD_DEFAULT;
+    cfg->pool = pool;
+}
+
+/**
+ * Worst-case output size
+ */
+size_t devproto_compress_bound(devproto_codec_t codec, size_t len)
+{
+    switch (codec) {
+    case DEVPROTO_CODEC_HEATSHRINK: return len + len / 8 + 1;
+    case DEVPROTO_CODEC_LZ4:        return len + len / 255 + 16;
+    default:                        return len;
+    }
+}
+
+/**
+ * Compress with a codec
+ */
+int devproto_compress(devproto_codec_t codec, const uint8_t *src, size_t len,
+                      uint8_t *dst, size_t cap)
+{
+    if ((!src && len > 0) || !dst || len > COMPRESS_MAX_INPUT) return -1;
+
+    switch (codec) {
+    case DEVPROTO_CODEC_HEATSHRINK: return hs_compress(src, len, dst, cap);
+    case DEVPROTO_CODEC_LZ4:        return lz4_compress(src, len, dst, cap);
+    default:                        return -1;
+    }
+}
+
+/**
+ * Decompress with a codec
+ */
+int devproto_decompress(devproto_codec_t codec, const uint8_t *src, size_t len,
+                        uint8_t *dst, size_t cap)
+{
+    if ((!src && len > 0) || (!dst && cap > 0)) return -1;
+
+    switch (codec) {
+    case DEVPROTO_CODEC_HEATSHRINK: return hs_decompress(src, len, dst, cap);
+    case DEVPROTO_CODEC_LZ4:        return lz4_decompress(src, len, dst, cap);
+    default:                        return -1;
+    }
+}
+
+/**
+ * Build a compressed payload, only if it is smaller
+ */
+int devproto_payload_compress(devproto_codec_t codec, const uint8_t *src, size_t len,
+                              uint8_t *dst, size_t cap)
+{
+    if (!dst || len > COMPRESS_MAX_INPUT) return -1;
+    if (len <= DEVPROTO_COMPRESS_HEADER_SIZE + 1 || cap <= DEVPROTO_COMPRESS_HEADER_SIZE) {
+        return -1;
+    }
+
+    /* Give the codec only as much room as would still save a byte */
+    size_t room = cap - DEVPROTO_COMPRESS_HEADER_SIZE;
+    if (room > len - DEVPROTO_COMPRESS_HEADER_SIZE - 1) {
+        room = len - DEVPROTO_COMPRESS_HEADER_SIZE - 1;
+    }
+
+    int n = devproto_compress(codec, src, len, dst + DEVPROTO_COMPRESS_HEADER_SIZE, room);
+    if (n < 0) return -1;
+
+    dst[0] = (uint8_t)codec;
+    dst[1] = (uint8_t)(len >> 8);
+    dst[2] = (uint8_t)(len & 0xFF);
+    return n + DEVPROTO_COMPRESS_HEADER_SIZE;
+}
+
+/**
+ * Original length from the payload header
+ */
+int devproto_payload_original_size(const uint8_t *src, size_t len)
+{
+    if (!src || len < DEVPROTO_COMPRESS_HEADER_SIZE) return -1;
+    return ((int)src[1] << 8) | src[2];
+}
+
+/**
+ * Expand a compressed payload
+ */
+int devproto_payload_decompress(const uint8_t *src, size_t len,
+                                uint8_t *dst, size_t cap)
+{
+    int size = devproto_payload_original_size(src, len);
+    if (size < 0 || (size_t)size > cap) return -1;
+
+    int n = devproto_decompress((devproto_codec_t)src[0],
+                                src + DEVPROTO_COMPRESS_HEADER_SIZE,
+                                len - DEVPROTO_COMPRESS_HEADER_SIZE, dst, (size_t)size);
+    return n == size ? n : -1;
+}
@@ -0,0 +1,784 @@
+/**
+ * @file engine.c
+ * @brief Sharded ingest engine: one reactor thread per shard
+ *
+ * Shards only touch their own reactor and connection list. Everything that
+ * crosses threads goes through a shard's command inbox (mutex + list,
+ * followed by devproto_reactor_wake()): adding a connection, handing one
+ * over to a thief, asking a victim for one, and removal. The engine lock
+ * guards which shard owns each connection; it is always taken before a
+ * shard lock, never while holding one.
+ *
+ * All shard reactors share one frame pool, so a parser detached from one
+ * reactor can be attached to another with its partial frame intact.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "devproto/engine.h"
+#include "devproto/reactor.h"
+#include "devproto/frame_pool.h"
+
+typedef struct engine_shard engine_shard_t;
+
+/**
+ * Connection owned by the engine
+ */
+typedef struct engine_conn {
+    devproto_transport_t *t;
+    devproto_engine_message_fn on_message;
+    devproto_engine_close_fn on_close;
+    void *user;
+
+    engine_shard_t *shard;              /* Owner (engine lock) */
+
+    /* Owner shard thread only */
+    int registered;                     /* In the owner's reactor */
+    int cancelled;                      /* Removed before registration */
+    uint32_t window;                    /* Messages this interval */
+    uint32_t last;                      /* Messages last interval */
+    struct engine_conn *prev, *next;    /* Owner's list */
+
+    struct engine_conn *all_prev, *all_next;  /* Engine list (engine lock) */
+} engine_conn_t;
+
+typedef enum {
+    ENGINE_CMD_ADD,                     /* Register conn */
+    ENGINE_CMD_ADOPT,                   /* Register conn with its parser */
+    ENGINE_CMD_STEAL,                   /* Hand a connection to thief */
+    ENGINE_CMD_REMOVE                   /* Unregister transport, then signal */
+} engine_cmd_type_t;
+
+typedef struct engine_cmd {
+    engine_cmd_type_t type;
+    engine_conn_t *conn;
+    devproto_transport_t *t;
+    devproto_frame_pooled_parser_t *parser;
+    engine_shard_t *thief;
+    uint32_t amount;                    /* STEAL: load the thief can take */
+    int *done;                          /* REMOVE: set under the engine lock */
+    struct engine_cmd *next;
+} engine_cmd_t;
+
+struct engine_shard {
+    devproto_engine_t *e;
+    size_t index;
+    devproto_reactor_t *r;
+    pthread_t thread;
+    int started;
+
+    /* Inbox and published statistics (shard lock) */
+    pthread_mutex_t lock;
+    engine_cmd_t *inbox;
+    engine_cmd_t *inbox_tail;
+    devproto_engine_shard_stats_t pub;
+    uint64_t pub_window_bytes;
+    int64_t pub_interval_ms;
+
+    /* Engine lock */
+    uint32_t assigned;                  /* Connections owned or on the way */
+    int steal_pending;                  /* A thief is waiting on this shard */
+
+    /* Shard thread only */
+    engine_conn_t *conns;
+    uint32_t nconns;
+    uint64_t messages;
+    uint64_t bytes;
+    uint32_t window;
+    uint64_t window_bytes;
+    uint32_t stolen;
+    uint32_t given;
+    int64_t last_tick_ms;
+};
+
+struct devproto_engine {
+    devproto_engine_config_t cfg;
+    engine_shard_t *shards;
+    size_t nshards;
+    devproto_frame_pool_t *pool;
+    atomic_int stop;
+
+    pthread_mutex_t lock;
+    pthread_cond_t done;                /* Signalled when a REMOVE completes */
+    engine_conn_t *all;
+    uint32_t migrations;
+};
+
+/* Shard whose thread this is (NULL elsewhere) */
+static _Thread_local engine_shard_t *engine_current;
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+static int64_t engine_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* ---- Bookkeeping ------------------------------------------------------ */
+
+/**
+ * Append a command to a shard's inbox and wake it
+ */
+static void engine_post(engine_shard_t *s, engine_cmd_t *cmd)
+{
+    cmd->next = NULL;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->inbox_tail) {
+        s->inbox_tail->next = cmd;
+    } else {
+        s->inbox = cmd;
+    }
+    s->inbox_tail = cmd;
+    pthread_mutex_unlock(&s->lock);
+
+    devproto_reactor_wake(s->r);
+}
+
+/**
+ * Find a connection by transport (engine lock held)
+ */
+static engine_conn_t *engine_find(devproto_engine_t *e, const devproto_transport_t *t)
+{
+    for (engine_conn_t *c = e->all; c; c = c->all_next) {
+        if (c->t == t) return c;
+    }
+    return NULL;
+}
+
+/**
+ * Drop a connection from the engine list and its shard's count
+ * (engine lock held)
+ */
+static void engine_forget_locked(devproto_engine_t *e, engine_conn_t *c)
+{
+    if (c->all_prev) {
+        c->all_prev->all_next = c->all_next;
+    } else {
+        e->all = c->all_next;
+    }
+    if (c->all_next) c->all_next->all_prev = c->all_prev;
+    c->all_prev = c->all_next = NULL;
+
+    c->shard->assigned--;
+}
+
+/**
+ * Link a registered connection into its shard's list (shard thread)
+ */
+static void shard_link(engine_shard_t *s, engine_conn_t *c)
+{
+    c->registered = 1;
+    c->prev = NULL;
+    c->next = s->conns;
+    if (s->conns) s->conns->prev = c;
+    s->conns = c;
+    s->nconns++;
+}
+
+/**
+ * Unlink a connection from its shard's list (shard thread)
+ */
+static void shard_unlink(engine_shard_t *s, engine_conn_t *c)
+{
+    if (!c->registered) return;
+
+    if (c->prev) {
+        c->prev->next = c->next;
+    } else {
+        s->conns = c->next;
+    }
+    if (c->next) c->next->prev = c->prev;
+    c->prev = c->next = NULL;
+    c->registered = 0;
+    s->nconns--;
+}
+
+/* ---- Reactor callbacks ------------------------------------------------ */
+
+static void engine_on_message(devproto_reactor_t *r, devproto_transport_t *t,
+                              const devproto_message_t *msg, void *user)
+{
+    (void)r;
+    engine_conn_t *c = user;
+    engine_shard_t *s = engine_current;
+
+    c->window++;
+    s->window++;
+    s->messages++;
+    s->bytes += msg->payload_len;
+    s->window_bytes += msg->payload_len;
+
+    /* May remove (and free) c */
+    c->on_message(s->e, t, msg, c->user);
+}
+
+static void engine_on_close(devproto_reactor_t *r, devproto_transport_t *t, void *user)
+{
+    (void)r;
+    engine_conn_t *c = user;
+    engine_shard_t *s = engine_current;
+    devproto_engine_t *e = s->e;
+    devproto_engine_close_fn on_close = c->on_close;
+    void *cb_user = c->user;
+
+    shard_unlink(s, c);
+    pthread_mutex_lock(&e->lock);
+    engine_forget_locked(e, c);
+    pthread_mutex_unlock(&e->lock);
+    free(c);
+
+    if (on_close) on_close(e, t, cb_user);
+}
+
+/* ---- Shard thread ----------------------------------------------------- */
+
+/**
+ * A connection could not be registered: drop it and report it closed
+ */
+static void shard_reject(engine_shard_t *s, engine_conn_t *c)
+{
+    devproto_engine_t *e = s->e;
+    devproto_engine_close_fn on_close = c->on_close;
+    devproto_transport_t *t = c->t;
+    void *cb_user = c->user;
+    int cancelled = c->cancelled;
+
+    if (!cancelled) {
+        pthread_mutex_lock(&e->lock);
+        engine_forget_locked(e, c);
+        pthread_mutex_unlock(&e->lock);
+    }
+    free(c);
+
+    if (!cancelled && on_close) on_close(e, t, cb_user);
+}
+
+/**
+ * Give the connection whose recent load best fits amount to thief
+ */
+static void shard_give(engine_shard_t *s, engine_shard_t *thief, uint32_t amount)
+{
+    devproto_engine_t *e = s->e;
+
+    /* Heaviest connection that does not overshoot; moving a hotter one
+     * would only move the imbalance */
+    engine_conn_t *best = NULL;
+    for (engine_conn_t *c = s->conns; c; c = c->next) {
+        if (c->last > 0 && c->last <= amount && (!best || c->last > best->last)) {
+            best = c;
+        }
+    }
+
+    engine_cmd_t *cmd = NULL;
+    if (best && s->nconns > 1) cmd = calloc(1, sizeof(*cmd));
+    if (cmd) {
+        cmd->parser = devproto_reactor_detach(s->r, best->t);
+        if (!cmd->parser) {
+            free(cmd);
+            cmd = NULL;
+        }
+    }
+
+    pthread_mutex_lock(&e->lock);
+    s->steal_pending = 0;
+    if (cmd) {
+        shard_unlink(s, best);
+        best->shard = thief;
+        s->assigned--;
+        thief->assigned++;
+        e->migrations++;
+        s->given++;
+
+        cmd->type = ENGINE_CMD_ADOPT;
+        cmd->conn = best;
+        /* Posted under the engine lock so a later REMOVE queues behind it */
+        engine_post(thief, cmd);
+    }
+    pthread_mutex_unlock(&e->lock);
+}
+
+/**
+ * Remove a transport on behalf of devproto_engine_remove()
+ */
+static void shard_remove(engine_shard_t *s, devproto_transport_t *t, int *done)
+{
+    devproto_engine_t *e = s->e;
+
+    pthread_mutex_lock(&e->lock);
+    engine_conn_t *c = engine_find(e, t);
+    if (c && c->shard != s) {
+        /* Moved away after the request was posted: follow it */
+        engine_cmd_t *cmd = calloc(1, sizeof(*cmd));
+        if (cmd) {
+            cmd->type = ENGINE_CMD_REMOVE;
+            cmd->t = t;
+            cmd->done = done;
+            engine_post(c->shard, cmd);
+            pthread_mutex_unlock(&e->lock);
+            return;
+        }
+        c = NULL;
+    }
+    if (c) engine_forget_locked(e, c);
+    pthread_mutex_unlock(&e->lock);
+
+    if (c) {
+        if (c->registered) devproto_reactor_remove(s->r, t);
+        shard_unlink(s, c);
+        free(c);
+    }
+
+    pthread_mutex_lock(&e->lock);
+    *done = 1;
+    pthread_cond_broadcast(&e->done);
+    pthread_mutex_unlock(&e->lock);
+}
+
+/**
+ * Run the commands posted to this shard
+ */
+static void shard_commands(engine_shard_t *s)
+{
+    pthread_mutex_lock(&s->lock);
+    engine_cmd_t *cmd = s->inbox;
+    s->inbox = s->inbox_tail = NULL;
+    pthread_mutex_unlock(&s->lock);
+
+    while (cmd) {
+        engine_cmd_t *next = cmd->next;
+        engine_conn_t *c = cmd->conn;
+
+        switch (cmd->type) {
+        case ENGINE_CMD_ADD:
+            if (!c->cancelled &&
+                devproto_reactor_add(s->r, c->t, engine_on_message, engine_on_close, c) == 0) {
+                shard_link(s, c);
+            } else {
+                shard_reject(s, c);
+            }
+            break;
+
+        case ENGINE_CMD_ADOPT:
+            if (!c->cancelled &&
+                devproto_reactor_attach(s->r, c->t, cmd->parser, engine_on_message,
+                                        engine_on_close, c) == 0) {
+                c->window = c->last = 0;
+                shard_link(s, c);
+                s->stolen++;
+            } else {
+                devproto_frame_pooled_destroy(cmd->parser);
+                shard_reject(s, c);
+            }
+            break;
+
+        case ENGINE_CMD_STEAL:
+            shard_give(s, cmd->thief, cmd->amount);
+            break;
+
+        case ENGINE_CMD_REMOVE:
+            shard_remove(s, cmd->t, cmd->done);
+            break;
+        }
+
+        free(cmd);
+        cmd = next;
+    }
+}
+
+/**
+ * If this shard is the idlest and far enough behind the busiest, ask the
+ * busiest for a connection
+ */
+static void shard_rebalance(engine_shard_t *s)
+{
+    devproto_engine_t *e = s->e;
+    engine_shard_t *idle = NULL, *busy = NULL;
+    uint32_t idle_load = 0, busy_load = 0;
+
+    pthread_mutex_lock(&e->lock);
+
+    for (size_t i = 0; i < e->nshards; i++) {
+        engine_shard_t *o = &e->shards[i];
+        pthread_mutex_lock(&o->lock);
+        uint32_t load = o->pub.load;
+        pthread_mutex_unlock(&o->lock);
+
+        if (!idle || load < idle_load) {
+            idle = o;
+            idle_load = load;
+        }
+        if (!busy || load > busy_load) {
+            busy = o;
+            busy_load = load;
+        }
+    }
+
+    uint32_t diff = busy_load - idle_load;
+    if (idle == s && busy != s && !busy->steal_pending && busy->assigned > 1 &&
+        diff > e->cfg.min_load &&
+        (uint64_t)diff * 100 > (uint64_t)busy_load * e->cfg.imbalance_pct) {
+        engine_cmd_t *cmd = calloc(1, sizeof(*cmd));
+        if (cmd) {
+            cmd->type = ENGINE_CMD_STEAL;
+            cmd->thief = s;
+            cmd->amount = diff / 2;
+            busy->steal_pending = 1;
+            engine_post(busy, cmd);
+        }
+    }
+
+    pthread_mutex_unlock(&e->lock);
+}
+
+/**
+ * Publish this interval's statistics, then maybe rebalance
+ */
+static void shard_tick(engine_shard_t *s, int64_t now)
+{
+    for (engine_conn_t *c = s->conns; c; c = c->next) {
+        c->last = c->window;
+        c->window = 0;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->pub.connections = s->nconns;
+    s->pub.messages = s->messages;
+    s->pub.bytes = s->bytes;
+    s->pub.load = s->window;
+    s->pub.stolen = s->stolen;
+    s->pub.given = s->given;
+    s->pub_window_bytes = s->window_bytes;
+    s->pub_interval_ms = now - s->last_tick_ms;
+    pthread_mutex_unlock(&s->lock);
+
+    s->window = 0;
+    s->window_bytes = 0;
+    s->last_tick_ms = now;
+
+    if (s->e->cfg.rebalance_ms > 0) shard_rebalance(s);
+}
+
+/**
+ * Bind the calling thread to one CPU (best effort)
+ */
+static void engine_pin(size_t cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+static void *shard_thread(void *arg)
+{
+    engine_shard_t *s = arg;
+    devproto_engine_t *e = s->e;
+    int tick_ms = e->cfg.rebalance_ms > 0 ? e->cfg.rebalance_ms : DEVPROTO_ENGINE_REBALANCE_MS;
+
+    engine_current = s;
+    if (e->cfg.pin_threads) engine_pin(s->index);
+    s->last_tick_ms = engine_now_ms();
+
+    while (!atomic_load(&e->stop)) {
+        shard_commands(s);
+
+        int64_t now = engine_now_ms();
+        int64_t left = s->last_tick_ms + tick_ms - now;
+        devproto_reactor_run_once(s->r, left > 0 ? (int)left : 0);
+
+        now = engine_now_ms();
+        if (now - s->last_tick_ms >= tick_ms) shard_tick(s, now);
+    }
+
+    engine_current = NULL;
+    return NULL;
+}
+
+/* ---- Public API ------------------------------------------------------- */
+
+/**
+ * Initialize default configuration
+ */
+void devproto_engine_config_init(devproto_engine_config_t *cfg)
+{
+    if (!cfg) return;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->rebalance_ms = DEVPROTO_ENGINE_REBALANCE_MS;
+    cfg->imbalance_pct = 25;
+    cfg->min_load = 100;
+}
+
+/**
+ * Create engine
+ */
+devproto_engine_t *devproto_engine_create(const devproto_engine_config_t *cfg)
+{
+    devproto_engine_t *e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+
+    if (cfg) {
+        e->cfg = *cfg;
+    } else {
+        devproto_engine_config_init(&e->cfg);
+    }
+
+    size_t n = e->cfg.shards;
+    if (n == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (n > DEVPROTO_ENGINE_MAX_SHARDS) n = DEVPROTO_ENGINE_MAX_SHARDS;
+
+    atomic_init(&e->stop, 0);
+    if (pthread_mutex_init(&e->lock, NULL) != 0) {
+        free(e);
+        return NULL;
+    }
+    if (pthread_cond_init(&e->done, NULL) != 0) {
+        pthread_mutex_destroy(&e->lock);
+        free(e);
+        return NULL;
+    }
+
+    e->pool = devproto_frame_pool_create(0);
+    e->shards = calloc(n, sizeof(*e->shards));
+    if (!e->pool || !e->shards) goto error;
+
+    for (size_t i = 0; i < n; i++) {
+        engine_shard_t *s = &e->shards[i];
+        s->e = e;
+        s->index = i;
+        s->r = devproto_reactor_create_shared(e->pool);
+        if (!s->r) goto error;
+        if (pthread_mutex_init(&s->lock, NULL) != 0) {
+            devproto_reactor_destroy(s->r);
+            s->r = NULL;
+            goto error;
+        }
+        e->nshards++;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        engine_shard_t *s = &e->shards[i];
+        if (pthread_create(&s->thread, NULL, shard_thread, s) != 0) goto error;
+        s->started = 1;
+    }
+
+    return e;
+
+error:
+    devproto_engine_destroy(e);
+    return NULL;
+}
+
+/**
+ * Destroy engine
+ */
+void devproto_engine_destroy(devproto_engine_t *e)
+{
+    if (!e) return;
+
+    atomic_store(&e->stop, 1);
+    for (size_t i = 0; i < e->nshards; i++) {
+        devproto_reactor_wake(e->shards[i].r);
+    }
+    for (size_t i = 0; i < e->nshards; i++) {
+        if (e->shards[i].started) pthread_join(e->shards[i].thread, NULL);
+    }
+
+    for (size_t i = 0; i < e->nshards; i++) {
+        engine_shard_t *s = &e->shards[i];
+
+        /* Commands nobody ran; their connections are freed with the list */
+        engine_cmd_t *cmd = s->inbox;
+        while (cmd) {
+            engine_cmd_t *next = cmd->next;
+            if (cmd->type == ENGINE_CMD_ADOPT) devproto_frame_pooled_destroy(cmd->parser);
+            if (cmd->type == ENGINE_CMD_ADD || cmd->type == ENGINE_CMD_ADOPT) {
+                if (cmd->conn->cancelled) free(cmd->conn);
+            }
+            free(cmd);
+            cmd = next;
+        }
+
+        devproto_reactor_destroy(s->r);
+        pthread_mutex_destroy(&s->lock);
+    }
+
+    while (e->all) {
+        engine_conn_t *c = e->all;
+        e->all = c->all_next;
+        free(c);
+    }
+
+    devproto_frame_pool_destroy(e->pool);
+    pthread_cond_destroy(&e->done);
+    pthread_mutex_destroy(&e->lock);
+    free(e->shards);
+    free(e);
+}
+
+/**
+ * Add transport
+ */
+int devproto_engine_add(devproto_engine_t *e, devproto_transport_t *t,
+                        devproto_engine_message_fn on_message,
+                        devproto_engine_close_fn on_close, void *user)
+{
+    if (!e || !t || !on_message || !devproto_transport_is_open(t) || t->fd < 0) return -1;
+
+    engine_conn_t *c = calloc(1, sizeof(*c));
+    engine_cmd_t *cmd = calloc(1, sizeof(*cmd));
+    if (!c || !cmd) {
+        free(c);
+        free(cmd);
+        return -1;
+    }
+
+    c->t = t;
+    c->on_message = on_message;
+    c->on_close = on_close;
+    c->user = user;
+    cmd->type = ENGINE_CMD_ADD;
+    cmd->conn = c;
+
+    pthread_mutex_lock(&e->lock);
+
+    if (engine_find(e, t)) {
+        pthread_mutex_unlock(&e->lock);
+        free(c);
+        free(cmd);
+        return -1;
+    }
+
+    engine_shard_t *target = &e->shards[0];
+    for (size_t i = 1; i < e->nshards; i++) {
+        if (e->shards[i].assigned < target->assigned) target = &e->shards[i];
+    }
+
+    c->shard = target;
+    target->assigned++;
+    c->all_next = e->all;
+    if (e->all) e->all->all_prev = c;
+    e->all = c;
+
+    engine_post(target, cmd);
+    pthread_mutex_unlock(&e->lock);
+    return 0;
+}
+
+/**
+ * Remove transport
+ */
+int devproto_engine_remove(devproto_engine_t *e, devproto_transport_t *t)
+{
+    if (!e || !t) return -1;
+
+    pthread_mutex_lock(&e->lock);
+
+    engine_conn_t *c = engine_find(e, t);
+    if (!c) {
+        pthread_mutex_unlock(&e->lock);
+        return -1;
+    }
+
+    engine_shard_t *s = c->shard;
+
+    if (engine_current == s) {
+        /* The owner's own thread: remove right away */
+        engine_forget_locked(e, c);
+        pthread_mutex_unlock(&e->lock);
+
+        if (c->registered) {
+            devproto_reactor_remove(s->r, t);
+            shard_unlink(s, c);
+            free(c);
+        } else {
+            /* Still in this shard's inbox; the command frees it */
+            c->cancelled = 1;
+        }
+        return 0;
+    }
+
+    if (engine_current) {
+        /* Waiting on another shard from a shard thread could deadlock */
+        pthread_mutex_unlock(&e->lock);
+        return -1;
+    }
+
+    engine_cmd_t *cmd = calloc(1, sizeof(*cmd));
+    if (!cmd) {
+        pthread_mutex_unlock(&e->lock);
+        return -1;
+    }
+
+    int done = 0;
+    cmd->type = ENGINE_CMD_REMOVE;
+    cmd->t = t;
+    cmd->done = &done;
+    engine_post(s, cmd);
+
+    while (!done) {
+        pthread_cond_wait(&e->done, &e->lock);
+    }
+    pthread_mutex_unlock(&e->lock);
+    return 0;
+}
+
+/**
+ * Aggregate statistics
+ */
+void devproto_engine_get_stats(devproto_engine_t *e, devproto_engine_stats_t *stats)
+{
+    if (!e || !stats) return;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->shards = e->nshards;
+
+    pthread_mutex_lock(&e->lock);
+    for (size_t i = 0; i < e->nshards; i++) {
+        engine_shard_t *s = &e->shards[i];
+        stats->connections += s->assigned;
+
+        pthread_mutex_lock(&s->lock);
+        stats->messages += s->pub.messages;
+        stats->bytes += s->pub.bytes;
+        if (s->pub_interval_ms > 0) {
+            stats->messages_per_s += s->pub.load * 1000.0 / (double)s->pub_interval_ms;
+            stats->bytes_per_s += (double)s->pub_window_bytes * 1000.0 /
+                                  (double)s->pub_interval_ms;
+        }
+        pthread_mutex_unlock(&s->lock);
+    }
+    stats->migrations = e->migrations;
+    pthread_mutex_unlock(&e->lock);
+}
+
+/**
+ * Shard statistics
+ */
+int devproto_engine_get_shard_stats(devproto_engine_t *e, size_t shard,
+                                    devproto_engine_shard_stats_t *stats)
+{
+    if (!e || !stats || shard >= e->nshards) return -1;
+
+    engine_shard_t *s = &e->shards[shard];
+    pthread_mutex_lock(&s->lock);
+    *stats = s->pub;
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
@@ -0,0 +1,738 @@
+/**
+ * @file firmware.c
+ * @brief Windowed firmware transfer: host sender and device receiver
+ *
+ * The sender keeps one slot per chunk in flight. A slot holds the built
+ * DATA payload (one copy out of the mapped image) until its ack arrives, so
+ * a retransmission resends the same bytes and CRC pair.
+ *
+ * The receiver verifies a prefix of the image: `base` is the first chunk
+ * not yet chained and `crc` the running CRC up to it. Chunks that arrive
+ * ahead of base are written at once and their CRC pairs parked in a ring
+ * of DEVPROTO_FW_MAX_WINDOW entries until the gap before them fills.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "devproto/firmware.h"
+#include "devproto/crc16.h"
+#include "devproto/error.h"
+
+static void fw_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (v >> 8) & 0xFF;
+    p[1] = v & 0xFF;
+}
+
+static void fw_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+static uint16_t fw_get_u16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t fw_get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* ---- Host side ---- */
+
+typedef struct {
+    struct devproto_fw_sender *fw;
+    int      busy;
+    uint32_t chunk;
+    int      retries;
+    uint16_t len;                       /* Payload bytes (header + data) */
+    uint8_t *payload;
+} fw_slot_t;
+
+struct devproto_fw_sender {
+    devproto_fw_config_t cfg;
+    const uint8_t *image;
+    size_t   size;
+    void    *map;                       /* Mapped file, or NULL */
+    uint16_t image_crc;
+    uint32_t chunks;
+
+    devproto_session_t *s;
+    devproto_fw_done_fn fn;
+    void    *user;
+    int      active;                    /* Started, completion not yet reported */
+    int      started;                   /* A transfer was started before */
+    int      status;                    /* First error of this start */
+    int      outstanding;               /* Requests awaiting their callback */
+    int      end_sent;
+    int      end_acked;
+    int      ctrl_retries;
+
+    uint32_t next_chunk;                /* First chunk never sent in this start */
+    uint16_t next_crc;                  /* Running CRC before next_chunk */
+    uint32_t remaining;                 /* Chunks not yet acknowledged */
+
+    uint8_t  ctrl[DEVPROTO_FW_BEGIN_SIZE];
+    fw_slot_t slots[DEVPROTO_FW_MAX_WINDOW];
+    uint8_t *buffers;
+
+    int      run_done;                  /* devproto_fw_sender_run() state */
+    int      run_status;
+
+    devproto_fw_stats_t stats;
+};
+
+static void fw_on_control(devproto_session_t *s, int status,
+                          const devproto_message_t *resp, void *user);
+static void fw_on_data(devproto_session_t *s, int status,
+                       const devproto_message_t *resp, void *user);
+
+/**
+ * Initialize default configuration
+ */
+void devproto_fw_config_init(devproto_fw_config_t *cfg)
+{
+    if (!cfg) return;
+
+    cfg->chunk_size = DEVPROTO_FW_CHUNK_DEFAULT;
+    cfg->window = DEVPROTO_FW_WINDOW_DEFAULT;
+    cfg->timeout_ms = 1000;
+    cfg->max_retries = 5;
+    cfg->resume = 1;
+}
+
+/**
+ * Create sender over an image in memory
+ */
+devproto_fw_sender_t *devproto_fw_sender_create(const uint8_t *image, size_t size,
+                                                const devproto_fw_config_t *cfg)
+{
+    devproto_fw_config_t defaults;
+    if (!cfg) {
+        devproto_fw_config_init(&defaults);
+        cfg = &defaults;
+    }
+    if (!image || size == 0 || size > UINT32_MAX ||
+        cfg->chunk_size == 0 || cfg->chunk_size > DEVPROTO_FW_CHUNK_MAX ||
+        cfg->window == 0 || cfg->window > DEVPROTO_FW_MAX_WINDOW ||
+        cfg->timeout_ms <= 0 || cfg->max_retries < 0) {
+        return NULL;
+    }
+
+    devproto_fw_sender_t *fw = calloc(1, sizeof(*fw));
+    if (!fw) return NULL;
+
+    size_t slot_size = DEVPROTO_FW_DATA_HEADER + cfg->chunk_size;
+    fw->buffers = malloc(slot_size * cfg->window);
+    if (!fw->buffers) {
+        free(fw);
+        return NULL;
+    }
+    for (int i = 0; i < cfg->window; i++) {
+        fw->slots[i].fw = fw;
+        fw->slots[i].payload = fw->buffers + (size_t)i * slot_size;
+    }
+
+    fw->cfg = *cfg;
+    fw->image = image;
+    fw->size = size;
+    fw->chunks = (uint32_t)((size + cfg->chunk_size - 1) / cfg->chunk_size);
+    fw->image_crc = devproto_crc16_update(DEVPROTO_CRC_INITIAL, image, size);
+    fw->stats.image_size = (uint32_t)size;
+    return fw;
+}
+
+/**
+ * Create sender over a mapped image file
+ */
+devproto_fw_sender_t *devproto_fw_sender_open(const char *path,
+                                              const devproto_fw_config_t *cfg)
+{
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    /* Chunks are read once, front to back */
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    devproto_fw_sender_t *fw = devproto_fw_sender_create(map, size, cfg);
+    if (!fw) {
+        munmap(map, size);
+        return NULL;
+    }
+    fw->map = map;
+    return fw;
+}
+
+/**
+ * Destroy sender
+ */
+void devproto_fw_sender_destroy(devproto_fw_sender_t *fw)
+{
+    if (!fw) return;
+
+    if (fw->map) munmap(fw->map, fw->size);
+    free(fw->buffers);
+    free(fw);
+}
+
+/**
+ * Device status byte to library error
+ */
+static int fw_status_error(uint8_t status)
+{
+    switch (status) {
+    case DEVPROTO_FW_STATUS_OK:     return DEVPROTO_OK;
+    case DEVPROTO_FW_STATUS_FLASH:  return DEVPROTO_ERR_IO;
+    case DEVPROTO_FW_STATUS_IMAGE:  return DEVPROTO_ERR_CRC;
+    default:                        return DEVPROTO_ERR_PROTOCOL;
+    }
+}
+
+/**
+ * Record the first error of this start
+ */
+static void fw_fail(devproto_fw_sender_t *fw, int status)
+{
+    if (fw->status == DEVPROTO_OK) fw->status = status;
+}
+
+/**
+ * Report completion once nothing is outstanding
+ */
+static void fw_check_done(devproto_fw_sender_t *fw)
+{
+    if (!fw->active || fw->outstanding > 0) return;
+    if (fw->status == DEVPROTO_OK && !fw->end_acked) return;
+
+    fw->active = 0;
+    if (fw->fn) fw->fn(fw, fw->status, fw->user);
+}
+
+/**
+ * Send one UPDATE_FIRMWARE request with a fresh deadline
+ */
+static int fw_request(devproto_fw_sender_t *fw, uint8_t *payload, uint16_t len,
+                      devproto_session_response_fn cb, void *user)
+{
+    devproto_message_t msg = {
+        .msg_type = DEVPROTO_MSG_UPDATE_FIRMWARE,
+        .payload_len = len,
+        .payload = payload
+    };
+
+    int rc = devproto_session_request_async(fw->s, &msg,
+                                            devproto_session_clock_ms() + fw->cfg.timeout_ms,
+                                            cb, user);
+    if (rc == 0) fw->outstanding++;
+    return rc;
+}
+
+/**
+ * Send BEGIN (flags) or END
+ */
+static int fw_send_control(devproto_fw_sender_t *fw, uint8_t op, uint8_t flags)
+{
+    uint16_t len;
+
+    fw->ctrl[0] = op;
+    if (op == DEVPROTO_FW_OP_BEGIN) {
+        fw->ctrl[1] = flags;
+        fw_put_u32(fw->ctrl + 2, (uint32_t)fw->size);
+        fw_put_u16(fw->ctrl + 6, fw->image_crc);
+        fw_put_u16(fw->ctrl + 8, fw->cfg.chunk_size);
+        len = DEVPROTO_FW_BEGIN_SIZE;
+    } else {
+        fw_put_u16(fw->ctrl + 1, fw->image_crc);
+        len = DEVPROTO_FW_END_SIZE;
+    }
+
+    return fw_request(fw, fw->ctrl, len, fw_on_control, fw);
+}
+
+/**
+ * Fill free slots with new chunks; send END once every chunk is acked
+ *
+ * New chunks stay within DEVPROTO_FW_MAX_WINDOW of the oldest unacked one:
+ * every chunk before it was acked, so the device's verified prefix reaches
+ * at least that far and the new chunk fits its ring.
+ */
+static void fw_pump(devproto_fw_sender_t *fw)
+{
+    uint32_t oldest = fw->next_chunk;
+    for (int i = 0; i < fw->cfg.window; i++) {
+        if (fw->slots[i].busy && fw->slots[i].chunk < oldest) oldest = fw->slots[i].chunk;
+    }
+
+    for (int i = 0; i < fw->cfg.window && fw->status == DEVPROTO_OK &&
+                    fw->next_chunk < fw->chunks &&
+                    fw->next_chunk < oldest + DEVPROTO_FW_MAX_WINDOW; i++) {
+        fw_slot_t *slot = &fw->slots[i];
+        if (slot->busy) continue;
+
+        uint32_t offset = fw->next_chunk * fw->cfg.chunk_size;
+        size_t len = fw->size - offset;
+        if (len > fw->cfg.chunk_size) len = fw->cfg.chunk_size;
+
+        const uint8_t *data = fw->image + offset;
+        uint16_t crc_after = devproto_crc16_update(fw->next_crc, data, len);
+
+        slot->payload[0] = DEVPROTO_FW_OP_DATA;
+        fw_put_u32(slot->payload + 1, offset);
+        fw_put_u16(slot->payload + 5, fw->next_crc);
+        fw_put_u16(slot->payload + 7, crc_after);
+        memcpy(slot->payload + DEVPROTO_FW_DATA_HEADER, data, len);
+        slot->len = (uint16_t)(DEVPROTO_FW_DATA_HEADER + len);
+        slot->chunk = fw->next_chunk;
+        slot->retries = 0;
+
+        int rc = fw_request(fw, slot->payload, slot->len, fw_on_data, slot);
+        if (rc != 0) {
+            fw_fail(fw, rc);
+            break;
+        }
+        slot->busy = 1;
+        fw->stats.chunks_sent++;
+        fw->next_chunk++;
+        fw->next_crc = crc_after;
+    }
+
+    if (fw->status == DEVPROTO_OK && fw->remaining == 0 && !fw->end_sent) {
+        int rc = fw_send_control(fw, DEVPROTO_FW_OP_END, 0);
+        if (rc != 0) fw_fail(fw, rc);
+        else fw->end_sent = 1;
+    }
+}
+
+/**
+ * Validate a FIRMWARE_ACK for op; returns its status byte or -1
+ */
+static int fw_parse_ack(const devproto_message_t *resp, uint8_t op,
+                        uint32_t *offset, uint16_t *crc)
+{
+    if (!resp || resp->payload_len < DEVPROTO_FW_ACK_SIZE || resp->payload[0] != op) {
+        return -1;
+    }
+
+    *offset = fw_get_u32(resp->payload + 2);
+    *crc = fw_get_u16(resp->payload + 6);
+    return resp->payload[1];
+}
+
+/**
+ * BEGIN / END completion
+ */
+static void fw_on_control(devproto_session_t *s, int status,
+                          const devproto_message_t *resp, void *user)
+{
+    (void)s;
+    devproto_fw_sender_t *fw = user;
+    uint8_t op = fw->ctrl[0];
+
+    fw->outstanding--;
+
+    if (status == DEVPROTO_ERR_TIMEOUT && fw->status == DEVPROTO_OK &&
+        fw->ctrl_retries++ < fw->cfg.max_retries) {
+        uint8_t flags = fw->ctrl[1];
+        int rc = fw_send_control(fw, op, op == DEVPROTO_FW_OP_BEGIN ? flags : 0);
+        if (rc == 0) return;
+        status = rc;
+    }
+
+    uint32_t offset = 0;
+    uint16_t crc = 0;
+    int ack = status == DEVPROTO_OK ? fw_parse_ack(resp, op, &offset, &crc) : -1;
+
+    if (status != DEVPROTO_OK) {
+        fw_fail(fw, status);
+    } else if (ack < 0) {
+        fw_fail(fw, DEVPROTO_ERR_PROTOCOL);
+    } else if (ack != DEVPROTO_FW_STATUS_OK) {
+        fw_fail(fw, fw_status_error((uint8_t)ack));
+    } else if (op == DEVPROTO_FW_OP_END) {
+        fw->end_acked = 1;
+    } else {
+        /* Resume point must be a chunk boundary whose CRC matches our image */
+        if (offset > fw->size || (offset % fw->cfg.chunk_size != 0 && offset != fw->size) ||
+            devproto_crc16_update(DEVPROTO_CRC_INITIAL, fw->image, offset) != crc) {
+            fw_fail(fw, DEVPROTO_ERR_PROTOCOL);
+        } else {
+            fw->next_chunk = (uint32_t)((offset + fw->cfg.chunk_size - 1) / fw->cfg.chunk_size);
+            fw->next_crc = crc;
+            fw->remaining = fw->chunks - fw->next_chunk;
+            fw->stats.resumed_from = offset;
+            fw->stats.acked_bytes = offset;
+            fw_pump(fw);
+        }
+    }
+
+    fw_check_done(fw);
+}
+
+/**
+ * DATA completion: free the slot, or retransmit it alone
+ */
+static void fw_on_data(devproto_session_t *s, int status,
+                       const devproto_message_t *resp, void *user)
+{
+    (void)s;
+    fw_slot_t *slot = user;
+    devproto_fw_sender_t *fw = slot->fw;
+
+    fw->outstanding--;
+
+    uint32_t offset = 0;
+    uint16_t crc = 0;
+    int ack = status == DEVPROTO_OK ? fw_parse_ack(resp, DEVPROTO_FW_OP_DATA, &offset, &crc) : -1;
+    int retry = status == DEVPROTO_ERR_TIMEOUT ||
+                ack == DEVPROTO_FW_STATUS_CRC || ack == DEVPROTO_FW_STATUS_WINDOW;
+
+    if (ack == DEVPROTO_FW_STATUS_OK) {
+        slot->busy = 0;
+        fw->remaining--;
+        fw->stats.acked_bytes += slot->len - DEVPROTO_FW_DATA_HEADER;
+    } else if (retry && fw->status == DEVPROTO_OK && slot->retries < fw->cfg.max_retries) {
+        slot->retries++;
+        int rc = fw_request(fw, slot->payload, slot->len, fw_on_data, slot);
+        if (rc == 0) {
+            fw->stats.chunks_sent++;
+            fw->stats.retransmits++;
+            return;
+        }
+        slot->busy = 0;
+        fw_fail(fw, rc);
+    } else {
+        slot->busy = 0;
+        if (status != DEVPROTO_OK) fw_fail(fw, status);
+        else if (retry) fw_fail(fw, DEVPROTO_ERR_TIMEOUT);
+        else fw_fail(fw, ack < 0 ? DEVPROTO_ERR_PROTOCOL : fw_status_error((uint8_t)ack));
+    }
+
+    fw_pump(fw);
+    fw_check_done(fw);
+}
+
+/**
+ * Start or resume transfer
+ */
+int devproto_fw_sender_start(devproto_fw_sender_t *fw, devproto_session_t *s,
+                             devproto_fw_done_fn fn, void *user)
+{
+    if (!fw || !s) return DEVPROTO_ERR_INVALID;
+    if (fw->active) return DEVPROTO_ERR_BUSY;
+
+    fw->s = s;
+    fw->fn = fn;
+    fw->user = user;
+    fw->status = DEVPROTO_OK;
+    fw->outstanding = 0;
+    fw->end_sent = 0;
+    fw->end_acked = 0;
+    fw->ctrl_retries = 0;
+    fw->next_chunk = fw->chunks;        /* Nothing is sent before BEGIN is acked */
+    fw->remaining = fw->chunks;
+    for (int i = 0; i < fw->cfg.window; i++) fw->slots[i].busy = 0;
+
+    /* Only the first start may discard a partial transfer */
+    uint8_t flags = (!fw->cfg.resume && !fw->started) ? DEVPROTO_FW_FLAG_RESTART : 0;
+    int rc = fw_send_control(fw, DEVPROTO_FW_OP_BEGIN, flags);
+    if (rc != 0) return rc;
+
+    fw->started = 1;
+    fw->active = 1;
+    return 0;
+}
+
+/**
+ * Completion hook for devproto_fw_sender_run()
+ */
+static void fw_run_done(devproto_fw_sender_t *fw, int status, void *user)
+{
+    (void)user;
+    fw->run_done = 1;
+    fw->run_status = status;
+}
+
+/**
+ * Blocking transfer
+ */
+int devproto_fw_sender_run(devproto_fw_sender_t *fw, devproto_session_t *s)
+{
+    if (!fw || !s) return DEVPROTO_ERR_INVALID;
+
+    fw->run_done = 0;
+    int rc = devproto_fw_sender_start(fw, s, fw_run_done, NULL);
+    if (rc != 0) return rc;
+
+    /* Every request has a deadline, so this ends once retries run out */
+    while (!fw->run_done) {
+        if (devproto_session_process(s, fw->cfg.timeout_ms) < 0) return DEVPROTO_ERR_IO;
+    }
+    return fw->run_status;
+}
+
+/**
+ * Get sender statistics
+ */
+void devproto_fw_sender_get_stats(const devproto_fw_sender_t *fw,
+                                  devproto_fw_stats_t *stats)
+{
+    if (!fw || !stats) return;
+
+    *stats = fw->stats;
+}
+
+/* ---- Device side ---- */
+
+struct devproto_fw_receiver {
+    devproto_fw_sink_t sink;
+    int      active;                    /* BEGIN accepted, not aborted */
+    int      finished;                  /* Image verified and handed to finish() */
+    uint32_t size;
+    uint16_t image_crc;
+    uint16_t chunk_size;
+    uint32_t chunks;
+
+    uint32_t base;                      /* First chunk not yet chained */
+    uint16_t crc;                       /* Running CRC before base */
+    uint32_t parked;                    /* Ring bits of chunks written ahead of base */
+    uint16_t parked_in[DEVPROTO_FW_MAX_WINDOW];
+    uint16_t parked_out[DEVPROTO_FW_MAX_WINDOW];
+};
+
+/**
+ * Create receiver
+ */
+devproto_fw_receiver_t *devproto_fw_receiver_create(const devproto_fw_sink_t *sink)
+{
+    if (!sink || !sink->write) return NULL;
+
+    devproto_fw_receiver_t *rx = calloc(1, sizeof(*rx));
+    if (!rx) return NULL;
+
+    rx->sink = *sink;
+    return rx;
+}
+
+/**
+ * Destroy receiver
+ */
+void devproto_fw_receiver_destroy(devproto_fw_receiver_t *rx)
+{
+    free(rx);
+}
+
+/**
+ * Bytes verified from the start of the image
+ */
+static uint32_t fw_verified(const devproto_fw_receiver_t *rx)
+{
+    uint64_t bytes = (uint64_t)rx->base * rx->chunk_size;
+    return bytes > rx->size ? rx->size : (uint32_t)bytes;
+}
+
+/**
+ * Chain parked chunks that now follow the verified prefix
+ * Returns -1 if a parked chunk does not continue the running CRC.
+ */
+static int fw_advance(devproto_fw_receiver_t *rx)
+{
+    for (;;) {
+        uint32_t bit = 1u << (rx->base % DEVPROTO_FW_MAX_WINDOW);
+        if (!(rx->parked & bit)) return 0;
+
+        int pos = rx->base % DEVPROTO_FW_MAX_WINDOW;
+        rx->parked &= ~bit;
+        if (rx->parked_in[pos] != rx->crc) return -1;
+        rx->crc = rx->parked_out[pos];
+        rx->base++;
+    }
+}
+
+/**
+ * Handle BEGIN; returns the status byte
+ */
+static uint8_t fw_handle_begin(devproto_fw_receiver_t *rx, const uint8_t *p, size_t len)
+{
+    if (len < DEVPROTO_FW_BEGIN_SIZE) return DEVPROTO_FW_STATUS_STATE;
+
+    uint8_t flags = p[1];
+    uint32_t size = fw_get_u32(p + 2);
+    uint16_t image_crc = fw_get_u16(p + 6);
+    uint16_t chunk = fw_get_u16(p + 8);
+
+    if (size == 0 || chunk == 0 || chunk > DEVPROTO_FW_CHUNK_MAX) return DEVPROTO_FW_STATUS_STATE;
+
+    /* Same image as the interrupted (or finished) transfer: keep going */
+    if (rx->active && !(flags & DEVPROTO_FW_FLAG_RESTART) && rx->size == size &&
+        rx->image_crc == image_crc && rx->chunk_size == chunk) {
+        return DEVPROTO_FW_STATUS_OK;
+    }
+
+    rx->active = 0;
+    rx->finished = 0;
+    if (rx->sink.begin && rx->sink.begin(rx->sink.user, size) != 0) return DEVPROTO_FW_STATUS_FLASH;
+
+    rx->active = 1;
+    rx->size = size;
+    rx->image_crc = image_crc;
+    rx->chunk_size = chunk;
+    rx->chunks = (uint32_t)(((uint64_t)size + chunk - 1) / chunk);
+    rx->base = 0;
+    rx->crc = DEVPROTO_CRC_INITIAL;
+    rx->parked = 0;
+    return DEVPROTO_FW_STATUS_OK;
+}
+
+/**
+ * Handle DATA; returns the status byte
+ */
+static uint8_t fw_handle_data(devproto_fw_receiver_t *rx, const uint8_t *p, size_t len)
+{
+    if (!rx->active) return DEVPROTO_FW_STATUS_STATE;
+    if (len < DEVPROTO_FW_DATA_HEADER) return DEVPROTO_FW_STATUS_CRC;
+
+    uint32_t offset = fw_get_u32(p + 1);
+    uint16_t crc_in = fw_get_u16(p + 5);
+    uint16_t crc_out = fw_get_u16(p + 7);
+    const uint8_t *data = p + DEVPROTO_FW_DATA_HEADER;
+    size_t n = len - DEVPROTO_FW_DATA_HEADER;
+
+    if (offset >= rx->size || offset % rx->chunk_size != 0) return DEVPROTO_FW_STATUS_IMAGE;
+    size_t expect = rx->size - offset;
+    if (expect > rx->chunk_size) expect = rx->chunk_size;
+    if (n != expect || devproto_crc16_update(crc_in, data, n) != crc_out) {
+        return DEVPROTO_FW_STATUS_CRC;
+    }
+
+    uint32_t chunk = offset / rx->chunk_size;
+    int pos = chunk % DEVPROTO_FW_MAX_WINDOW;
+
+    /* Retransmission of something already written */
+    if (chunk < rx->base) return DEVPROTO_FW_STATUS_OK;
+    if (chunk >= rx->base + DEVPROTO_FW_MAX_WINDOW) return DEVPROTO_FW_STATUS_WINDOW;
+    if (chunk > rx->base && (rx->parked & (1u << pos))) return DEVPROTO_FW_STATUS_OK;
+
+    if (chunk == rx->base && crc_in != rx->crc) {
+        rx->active = 0;
+        return DEVPROTO_FW_STATUS_IMAGE;
+    }
+
+    if (rx->sink.write(rx->sink.user, offset, data, n) != 0) {
+        rx->active = 0;
+        return DEVPROTO_FW_STATUS_FLASH;
+    }
+
+    rx->parked_in[pos] = crc_in;
+    rx->parked_out[pos] = crc_out;
+    rx->parked |= 1u << pos;
+    if (fw_advance(rx) != 0) {
+        rx->active = 0;
+        return DEVPROTO_FW_STATUS_IMAGE;
+    }
+    return DEVPROTO_FW_STATUS_OK;
+}
+
+/**
+ * Handle END; returns the status byte
+ */
+static uint8_t fw_handle_end(devproto_fw_receiver_t *rx, const uint8_t *p, size_t len)
+{
+    if (!rx->active) return DEVPROTO_FW_STATUS_STATE;
+    if (len < DEVPROTO_FW_END_SIZE) return DEVPROTO_FW_STATUS_IMAGE;
+    if (rx->finished) return DEVPROTO_FW_STATUS_OK;
+
+    if (fw_get_u16(p + 1) != rx->image_crc || rx->base != rx->chunks ||
+        rx->crc != rx->image_crc) {
+        return DEVPROTO_FW_STATUS_IMAGE;
+    }
+
+    if (rx->sink.finish && rx->sink.finish(rx->sink.user, rx->size) != 0) {
+        rx->active = 0;
+        return DEVPROTO_FW_STATUS_FLASH;
+    }
+
+    rx->finished = 1;
+    return DEVPROTO_FW_STATUS_OK;
+}
+
+/**
+ * Apply UPDATE_FIRMWARE and build FIRMWARE_ACK
+ */
+int devproto_fw_receiver_handle(devproto_fw_receiver_t *rx,
+                                const devproto_message_t *request,
+                                devproto_message_t *ack, uint8_t *ack_buf)
+{
+    if (!rx || !request || !ack || !ack_buf) return DEVPROTO_ERR_INVALID;
+    if (request->msg_type != DEVPROTO_MSG_UPDATE_FIRMWARE ||
+        request->payload_len < 1 || !request->payload) {
+        return DEVPROTO_ERR_INVALID;
+    }
+
+    const uint8_t *p = request->payload;
+    size_t len = request->payload_len;
+    uint8_t status;
+    uint32_t offset;
+
+    switch (p[0]) {
+    case DEVPROTO_FW_OP_BEGIN:
+        status = fw_handle_begin(rx, p, len);
+        offset = rx->active ? fw_verified(rx) : 0;
+        break;
+    case DEVPROTO_FW_OP_DATA:
+        status = fw_handle_data(rx, p, len);
+        offset = len >= 5 ? fw_get_u32(p + 1) : 0;
+        break;
+    case DEVPROTO_FW_OP_END:
+        status = fw_handle_end(rx, p, len);
+        offset = fw_verified(rx);
+        break;
+    default:
+        return DEVPROTO_ERR_INVALID;
+    }
+
+    ack_buf[0] = p[0];
+    ack_buf[1] = status;
+    fw_put_u32(ack_buf + 2, offset);
+    fw_put_u16(ack_buf + 6, rx->active ? rx->crc : DEVPROTO_CRC_INITIAL);
+
+    ack->msg_type = DEVPROTO_MSG_FIRMWARE_ACK;
+    ack->sequence = request->sequence;
+    ack->payload_len = DEVPROTO_FW_ACK_SIZE;
+    ack->payload = ack_buf;
+    return status;
+}
+
+/**
+ * Get progress
+ */
+int devproto_fw_receiver_progress(const devproto_fw_receiver_t *rx,
+                                  uint32_t *verified, uint32_t *image_size)
+{
+    if (!rx) return 0;
+
+    if (verified) *verified = rx->active ? fw_verified(rx) : 0;
+    if (image_size) *image_size = rx->active ? rx->size : 0;
+    return rx->finished;
+}
@@ -3,12 +3,65 @@
  * @brief Frame parser state machine implementation
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <limits.h>
 #include "devproto/frame.h"
 #include "devproto/crc16.h"
 
+/* Pooled parser: the full parser's fields around a compact buffer */
+struct devproto_frame_pooled_parser {
+    devproto_frame_state_t state;
+    uint8_t  buffer[DEVPROTO_HEADER_SIZE + DEVPROTO_FRAME_COMPACT_PAYLOAD];
+    size_t   buffer_pos;
+    uint32_t expected_length;
+    size_t   payload_received;
+
+    uint8_t  msg_type;
+    uint8_t  sequence;
+    uint16_t crc_received;
+
+    uint32_t frames_parsed;
+    uint32_t crc_errors;
+    uint32_t sync_errors;
+
+    uint32_t max_payload;
+    uint8_t  *payload;
+    uint16_t crc_calc;
+    uint32_t decompress_errors;
+
+    devproto_frame_pool_t *pool;
+    uint8_t  *borrowed;
+    size_t   borrowed_size;
+
+    uint8_t  decompress;
+    uint8_t  compressed;
+    uint8_t  *inflated;
+    size_t   inflated_size;
+};
+
+/**
+ * Check whether a pointer lies inside slab storage
+ */
+static int frame_slab_owns(const devproto_frame_slab_t *slab, const uint8_t *p)
+{
+    return p && p >= slab->data && p < slab->data + slab->size;
+}
+
+/* State machine for the full-size parser */
+#define FP_T         devproto_frame_parser_t
+#define FP_FN(name)  frame_full_##name
+#define FP_BUF_SIZE  sizeof(((devproto_frame_parser_t *)0)->buffer)
+#include "frame_parser_core.h"
+
+/* ... and for the pooled one */
+#define FP_T         devproto_frame_pooled_parser_t
+#define FP_FN(name)  frame_pooled_##name
+#define FP_BUF_SIZE  sizeof(((devproto_frame_pooled_parser_t *)0)->buffer)
+#include "frame_parser_core.h"
+
 /**
  * Initialize frame parser
  */
@@ -18,6 +71,41 @@ void devproto_frame_parser_init(devproto_frame_parser_t *parser)
 
     memset(parser, 0, sizeof(*parser));
     parser->state = DEVPROTO_FRAME_STATE_IDLE;
+    parser->max_payload = DEVPROTO_MAX_PAYLOAD_SIZE;
+}
+
+/**
+ * Return pool blocks held by a parser
+ */
+void devproto_frame_parser_release(devproto_frame_parser_t *parser)
+{
+    if (!parser) return;
+
+    frame_full_release_borrowed(parser);
+    frame_full_release_inflated(parser);
+}
+
+/**
+ * Set accepted payload limit
+ */
+int devproto_frame_parser_set_max_payload(devproto_frame_parser_t *parser,
+                                          size_t max_payload,
+                                          devproto_frame_pool_t *pool)
+{
+    if (!parser) return DEVPROTO_FRAME_ERR_INVALID;
+
+    return frame_full_set_max_payload(parser, max_payload, pool);
+}
+
+/**
+ * Accept or reject compressed frames
+ */
+int devproto_frame_parser_set_decompress(devproto_frame_parser_t *parser, int enable,
+                                         devproto_frame_pool_t *pool)
+{
+    if (!parser) return DEVPROTO_FRAME_ERR_INVALID;
+
+    return frame_full_set_decompress(parser, enable, pool);
 }
 
 /**
@@ -27,13 +115,17 @@ void devproto_frame_parser_reset(devproto_frame_parser_t *parser)
 {
     if (!parser) return;
 
-    parser->state = DEVPROTO_FRAME_STATE_IDLE;
-    parser->buffer_pos = 0;
-    parser->expected_length = 0;
-    parser->payload_received = 0;
-    parser->msg_type = 0;
-    parser->sequence = 0;
-    parser->crc_received = 0;
+    frame_full_reset(parser);
+}
+
+/**
+ * Bytes needed to finish the current frame
+ */
+size_t devproto_frame_remaining(const devproto_frame_parser_t *parser)
+{
+    if (!parser) return 0;
+
+    return frame_full_remaining(parser);
 }
 
 /**
@@ -43,126 +135,7 @@ int devproto_frame_parse_byte(devproto_frame_parser_t *parser, uint8_t byte)
 {
     if (!parser) return DEVPROTO_FRAME_ERR_INVALID;
 
-    switch (parser->state) {
-    case DEVPROTO_FRAME_STATE_IDLE:
-        if (byte == DEVPROTO_HEADER_BYTE0) {
-            parser->buffer[0] = byte;
-            parser->buffer_pos = 1;
-            parser->state = DEVPROTO_FRAME_STATE_HEADER_LO;
-        }
-        break;
-
-    case DEVPROTO_FRAME_STATE_HEADER_LO:
-        if (byte == DEVPROTO_HEADER_BYTE1) {
-            parser->buffer[1] = byte;
-            parser->buffer_pos = 2;
-            parser->state = DEVPROTO_FRAME_STATE_LENGTH_HI;
-        } else if (byte == DEVPROTO_HEADER_BYTE0) {
-            /* Might be start of new frame */
-            parser->buffer[0] = byte;
-            parser->buffer_pos = 1;
-        } else {
-            parser->sync_errors++;
-            devproto_frame_parser_reset(parser);
-        }
-        break;
-
-    case DEVPROTO_FRAME_STATE_LENGTH_HI:
-        parser->buffer[2] = byte;
-        parser->buffer_pos = 3;
-        parser->expected_length = (uint16_t)byte << 8;
-        parser->state = DEVPROTO_FRAME_STATE_LENGTH_LO;
-        break;
-
-    case DEVPROTO_FRAME_STATE_LENGTH_LO:
-        parser->buffer[3] = byte;
-        parser->buffer_pos = 4;
-        parser->expected_length |= byte;
-
-        /* Validate payload length */
-        if (parser->expected_length > DEVPROTO_MAX_PAYLOAD_SIZE) {
-            parser->sync_errors++;
-            devproto_frame_parser_reset(parser);
-            return DEVPROTO_FRAME_ERR_OVERFLOW;
-        }
-
-        parser->state = DEVPROTO_FRAME_STATE_TYPE;
-        break;
-
-    case DEVPROTO_FRAME_STATE_TYPE:
-        parser->buffer[4] = byte;
-        parser->buffer_pos = 5;
-        parser->msg_type = byte;
-        parser->state = DEVPROTO_FRAME_STATE_SEQUENCE;
-        break;
-
-    case DEVPROTO_FRAME_STATE_SEQUENCE:
-        parser->buffer[5] = byte;
-        parser->buffer_pos = 6;
-        parser->sequence = byte;
-        parser->payload_received = 0;
-
-        if (parser->expected_length == 0) {
-            /* No payload, go to CRC */
-            parser->state = DEVPROTO_FRAME_STATE_CRC_HI;
-        } else {
-            parser->state = DEVPROTO_FRAME_STATE_PAYLOAD;
-        }
-        break;
-
-    case DEVPROTO_FRAME_STATE_PAYLOAD:
-        if (parser->buffer_pos < DEVPROTO_MAX_FRAME_SIZE) {
-            parser->buffer[parser->buffer_pos++] = byte;
-            parser->payload_received++;
-
-            if (parser->payload_received >= parser->expected_length) {
-                parser->state = DEVPROTO_FRAME_STATE_CRC_HI;
-            }
-        } else {
-            parser->sync_errors++;
-            devproto_frame_parser_reset(parser);
-            return DEVPROTO_FRAME_ERR_OVERFLOW;
-        }
-        break;
-
-    case DEVPROTO_FRAME_STATE_CRC_HI:
-        parser->crc_received = (uint16_t)byte << 8;
-        parser->state = DEVPROTO_FRAME_STATE_CRC_LO;
-        break;
-
-    case DEVPROTO_FRAME_STATE_CRC_LO:
-        parser->crc_received |= byte;
-
-        /* Verify CRC (calculated over header + payload) */
-        {
-            size_t data_len = DEVPROTO_HEADER_SIZE + parser->expected_length;
-            uint16_t crc_calc = devproto_crc16(parser->buffer, data_len);
-
-            if (crc_calc == parser->crc_received) {
-                parser->state = DEVPROTO_FRAME_STATE_COMPLETE;
-                parser->frames_parsed++;
-                return 1; /* Frame complete */
-            } else {
-                parser->crc_errors++;
-                parser->state = DEVPROTO_FRAME_STATE_ERROR;
-                devproto_frame_parser_reset(parser);
-                return DEVPROTO_FRAME_ERR_CRC;
-            }
-        }
-
-    case DEVPROTO_FRAME_STATE_COMPLETE:
-    case DEVPROTO_FRAME_STATE_ERROR:
-        /* Should call reset before continuing */
-        devproto_frame_parser_reset(parser);
-        if (byte == DEVPROTO_HEADER_BYTE0) {
-            parser->buffer[0] = byte;
-            parser->buffer_pos = 1;
-            parser->state = DEVPROTO_FRAME_STATE_HEADER_LO;
-        }
-        break;
-    }
-
-    return 0; /* Need more data */
+    return frame_full_parse_byte(parser, byte);
 }
 
 /**
@@ -172,20 +145,8 @@ int devproto_frame_get_message(devproto_frame_parser_t *parser,
                                devproto_message_t *msg)
 {
     if (!parser || !msg) return -1;
-    if (parser->state != DEVPROTO_FRAME_STATE_COMPLETE) return -1;
-
-    msg->msg_type = parser->msg_type;
-    msg->sequence = parser->sequence;
-    msg->payload_len = parser->expected_length;
-
-    /* Payload starts at offset 6 in buffer */
-    if (parser->expected_length > 0) {
-        msg->payload = &parser->buffer[DEVPROTO_HEADER_SIZE];
-    } else {
-        msg->payload = NULL;
-    }
 
-    return 0;
+    return frame_full_get_message(parser, msg);
 }
 
 /**
@@ -200,34 +161,262 @@ int devproto_frame_parse(devproto_frame_parser_t *parser,
         return DEVPROTO_FRAME_ERR_INVALID;
     }
 
-    /* Limit max_messages to prevent return value truncation */
-    if (max_messages > (size_t)INT32_MAX) {
-        max_messages = (size_t)INT32_MAX;
+    /* Payloads point to parser buffer; caller must use before next frame */
+    return frame_full_parse_run(parser, data, len, NULL,
+                                out_messages, max_messages, NULL);
+}
+
+/**
+ * Initialize payload slab
+ */
+void devproto_frame_slab_init(devproto_frame_slab_t *slab,
+                              uint8_t *storage, size_t size)
+{
+    if (!slab) return;
+
+    slab->data = storage;
+    slab->size = storage ? size : 0;
+    slab->used = 0;
+}
+
+/**
+ * Release all slab payloads
+ */
+void devproto_frame_slab_reset(devproto_frame_slab_t *slab)
+{
+    if (!slab) return;
+
+    slab->used = 0;
+}
+
+/**
+ * Parse multiple bytes into slab-backed messages
+ */
+int devproto_frame_parse_slab(devproto_frame_parser_t *parser,
+                              const uint8_t *data, size_t len,
+                              devproto_frame_slab_t *slab,
+                              devproto_message_t *out_messages,
+                              size_t max_messages, size_t *consumed)
+{
+    if (consumed) *consumed = 0;
+
+    if (!parser || !data || !slab || !out_messages || max_messages == 0) {
+        return DEVPROTO_FRAME_ERR_INVALID;
     }
 
-    size_t msg_count = 0;
-
-    for (size_t i = 0; i < len && msg_count < max_messages; i++) {
-        int result = devproto_frame_parse_byte(parser, data[i]);
-
-        if (result == 1) {
-            /* Frame complete */
-            if (devproto_frame_get_message(parser, &out_messages[msg_count]) == 0) {
-                /* Copy payload to separate buffer so parser can be reset */
-                if (out_messages[msg_count].payload_len > 0) {
-                    /* Note: In production, you'd allocate and copy here.
-                     * For simplicity, we just point to parser buffer.
-                     * Caller must use before next parse. */
-                }
-                msg_count++;
-            }
-            devproto_frame_parser_reset(parser);
-        } else if (result < 0) {
-            /* Error - parser already reset, continue scanning */
-        }
+    return frame_full_parse_run(parser, data, len, slab,
+                                out_messages, max_messages, consumed);
+}
+
+/**
+ * Create pooled parser
+ */
+devproto_frame_pooled_parser_t *devproto_frame_pooled_create(devproto_frame_pool_t *pool)
+{
+    if (!pool) return NULL;
+
+    devproto_frame_pooled_parser_t *parser = calloc(1, sizeof(*parser));
+    if (!parser) return NULL;
+
+    parser->state = DEVPROTO_FRAME_STATE_IDLE;
+    parser->max_payload = DEVPROTO_MAX_PAYLOAD_SIZE;
+    parser->pool = pool;
+    return parser;
+}
+
+/**
+ * Destroy pooled parser
+ */
+void devproto_frame_pooled_destroy(devproto_frame_pooled_parser_t *parser)
+{
+    if (!parser) return;
+
+    frame_pooled_release_borrowed(parser);
+    frame_pooled_release_inflated(parser);
+    free(parser);
+}
+
+/**
+ * Reset pooled parser to initial state
+ */
+void devproto_frame_pooled_reset(devproto_frame_pooled_parser_t *parser)
+{
+    if (!parser) return;
+
+    frame_pooled_reset(parser);
+}
+
+/**
+ * Set accepted payload limit of a pooled parser
+ */
+int devproto_frame_pooled_set_max_payload(devproto_frame_pooled_parser_t *parser,
+                                          size_t max_payload)
+{
+    if (!parser) return DEVPROTO_FRAME_ERR_INVALID;
+
+    return frame_pooled_set_max_payload(parser, max_payload, NULL);
+}
+
+/**
+ * Accept or reject compressed frames on a pooled parser
+ */
+int devproto_frame_pooled_set_decompress(devproto_frame_pooled_parser_t *parser, int enable)
+{
+    if (!parser) return DEVPROTO_FRAME_ERR_INVALID;
+
+    return frame_pooled_set_decompress(parser, enable, NULL);
+}
+
+/**
+ * Parse multiple bytes with a pooled parser
+ */
+int devproto_frame_pooled_parse(devproto_frame_pooled_parser_t *parser,
+                                const uint8_t *data, size_t len,
+                                devproto_message_t *out_messages,
+                                size_t max_messages)
+{
+    if (!parser || !data || !out_messages || max_messages == 0) {
+        return DEVPROTO_FRAME_ERR_INVALID;
+    }
+
+    return frame_pooled_parse_run(parser, data, len, NULL,
+                                  out_messages, max_messages, NULL);
+}
+
+/**
+ * Parse multiple bytes with a pooled parser into slab-backed messages
+ */
+int devproto_frame_pooled_parse_slab(devproto_frame_pooled_parser_t *parser,
+                                     const uint8_t *data, size_t len,
+                                     devproto_frame_slab_t *slab,
+                                     devproto_message_t *out_messages,
+                                     size_t max_messages, size_t *consumed)
+{
+    if (consumed) *consumed = 0;
+
+    if (!parser || !data || !slab || !out_messages || max_messages == 0) {
+        return DEVPROTO_FRAME_ERR_INVALID;
+    }
+
+    return frame_pooled_parse_run(parser, data, len, slab,
+                                  out_messages, max_messages, consumed);
+}
+
+/**
+ * Bytes needed to finish the pooled parser's current frame
+ */
+size_t devproto_frame_pooled_remaining(const devproto_frame_pooled_parser_t *parser)
+{
+    if (!parser) return 0;
+
+    return frame_pooled_remaining(parser);
+}
+
+/**
+ * Get pooled parser statistics
+ */
+void devproto_frame_pooled_get_stats(const devproto_frame_pooled_parser_t *parser,
+                                     devproto_frame_stats_t *stats)
+{
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!parser) return;
+
+    stats->frames_parsed = parser->frames_parsed;
+    stats->crc_errors = parser->crc_errors;
+    stats->sync_errors = parser->sync_errors;
+    stats->decompress_errors = parser->decompress_errors;
+}
+
+/**
+ * Fill the frame header for msg: the fixed 6-byte one, or the 8-byte
+ * extended-length one for payloads beyond DEVPROTO_MAX_PAYLOAD_SIZE.
+ * Returns the header size.
+ */
+static size_t frame_write_header(const devproto_message_t *msg, uint8_t *header,
+                                 uint8_t flags)
+{
+    size_t pos = 0;
+
+    header[pos++] = DEVPROTO_HEADER_BYTE0;
+    header[pos++] = DEVPROTO_HEADER_BYTE1;
+
+    /* Length (big-endian), flags in the first byte */
+    if (msg->payload_len > DEVPROTO_MAX_PAYLOAD_SIZE) {
+        header[pos++] = DEVPROTO_JUMBO_FLAG | flags;
+        header[pos++] = 0;
+        flags = 0;
+    }
+    header[pos++] = ((msg->payload_len >> 8) & 0xFF) | flags;
+    header[pos++] = msg->payload_len & 0xFF;
+
+    /* Type and sequence */
+    header[pos++] = msg->msg_type;
+    header[pos++] = msg->sequence;
+    return pos;
+}
+
+/**
+ * Build scatter-gather frame from message
+ */
+int devproto_frame_build_iov(const devproto_message_t *msg,
+                             devproto_frame_iov_t *frame)
+{
+    return devproto_frame_build_iov_max(msg, frame, DEVPROTO_MAX_PAYLOAD_SIZE);
+}
+
+/**
+ * Shared scatter-gather builder; flags go into the first length byte
+ */
+static int frame_build_iov_flags(const devproto_message_t *msg,
+                                 devproto_frame_iov_t *frame, size_t max_payload,
+                                 uint8_t flags)
+{
+    if (!msg || !frame) return -1;
+    if (msg->payload_len > max_payload) return -1;
+    if (msg->payload_len > 0 && !msg->payload) return -1;
+
+    size_t header_len = frame_write_header(msg, frame->header, flags);
+
+    /* CRC streams over header then payload in place */
+    uint16_t crc = devproto_crc16_update(DEVPROTO_CRC_INITIAL,
+                                         frame->header, header_len);
+    crc = devproto_crc16_update(crc, msg->payload, msg->payload_len);
+    frame->crc[0] = (crc >> 8) & 0xFF;
+    frame->crc[1] = crc & 0xFF;
+
+    int n = 0;
+    frame->iov[n].iov_base = frame->header;
+    frame->iov[n++].iov_len = header_len;
+    if (msg->payload_len > 0) {
+        frame->iov[n].iov_base = msg->payload;
+        frame->iov[n++].iov_len = msg->payload_len;
     }
+    frame->iov[n].iov_base = frame->crc;
+    frame->iov[n++].iov_len = DEVPROTO_CRC_SIZE;
+    frame->iovcnt = n;
+
+    return (int)(header_len + msg->payload_len + DEVPROTO_CRC_SIZE);
+}
+
+/**
+ * Build scatter-gather frame, extended-length above the legacy limit
+ */
+int devproto_frame_build_iov_max(const devproto_message_t *msg,
+                                 devproto_frame_iov_t *frame, size_t max_payload)
+{
+    return frame_build_iov_flags(msg, frame, max_payload, 0);
+}
 
-    return (int)msg_count;
+/**
+ * Build scatter-gather frame marked as compressed
+ */
+int devproto_frame_build_iov_compressed(const devproto_message_t *msg,
+                                        devproto_frame_iov_t *frame, size_t max_payload)
+{
+    if (!msg || msg->payload_len < DEVPROTO_COMPRESS_HEADER_SIZE) return -1;
+    return frame_build_iov_flags(msg, frame, max_payload, DEVPROTO_COMPRESS_FLAG);
 }
 
 /**
@@ -249,16 +438,7 @@ int devproto_frame_build(const devproto_message_t *msg,
     if (frame_len > (size_t)INT32_MAX) return -1;
 
     /* Header */
-    buffer[0] = DEVPROTO_HEADER_BYTE0;
-    buffer[1] = DEVPROTO_HEADER_BYTE1;
-
-    /* Length (big-endian) */
-    buffer[2] = (msg->payload_len >> 8) & 0xFF;
-    buffer[3] = msg->payload_len & 0xFF;
-
-    /* Type and sequence */
-    buffer[4] = msg->msg_type;
-    buffer[5] = msg->sequence;
+    frame_write_header(msg, buffer, 0);
 
     /* Payload */
     if (msg->payload_len > 0 && msg->payload) {
@@ -267,7 +447,7 @@ int devproto_frame_build(const devproto_message_t *msg,
 
     /* CRC (calculated over header + payload) */
     size_t data_len = DEVPROTO_HEADER_SIZE + msg->payload_len;
-    uint16_t crc = devproto_crc16(buffer, data_len);
+    uint16_t crc = devproto_crc16_fast(buffer, data_len);
     buffer[data_len] = (crc >> 8) & 0xFF;
     buffer[data_len + 1] = crc & 0xFF;
 
@@ -0,0 +1,502 @@
+/**
+ * @file frame_parser_core.h
+ * @brief Frame parser state machine, instantiated per parser type (internal)
+ *
+ * Included by frame.c once for each parser layout. Before inclusion define:
+ *   FP_T         parser struct type (devproto_frame_parser_t field names)
+ *   FP_FN(name)  static function name for this instantiation
+ *   FP_BUF_SIZE  size of the parser's inline buffer
+ * frame_slab_owns() must already be defined. The macros are undefined at
+ * the end, so the next instantiation starts clean.
+ */
+
+/**
+ * Return any borrowed block to the pool
+ */
+static void FP_FN(release_borrowed)(FP_T *parser)
+{
+    if (parser->borrowed) {
+        devproto_frame_pool_release(parser->pool, parser->borrowed,
+                                    parser->borrowed_size);
+        parser->borrowed = NULL;
+        parser->borrowed_size = 0;
+    }
+}
+
+/**
+ * Return the block holding the last expanded payload, if any
+ */
+static void FP_FN(release_inflated)(FP_T *parser)
+{
+    if (parser->inflated) {
+        devproto_frame_pool_release(parser->pool, parser->inflated,
+                                    parser->inflated_size);
+        parser->inflated = NULL;
+        parser->inflated_size = 0;
+    }
+}
+
+/**
+ * Switch to another pool, giving back blocks held from the old one
+ */
+static void FP_FN(use_pool)(FP_T *parser, devproto_frame_pool_t *pool)
+{
+    if (pool && pool != parser->pool) {
+        FP_FN(release_borrowed)(parser);
+        FP_FN(release_inflated)(parser);
+        parser->pool = pool;
+    }
+}
+
+/**
+ * Set accepted payload limit
+ */
+static int FP_FN(set_max_payload)(FP_T *parser, size_t max_payload,
+                                  devproto_frame_pool_t *pool)
+{
+    if (max_payload < DEVPROTO_MAX_PAYLOAD_SIZE ||
+        max_payload > DEVPROTO_JUMBO_MAX_PAYLOAD) {
+        return DEVPROTO_FRAME_ERR_INVALID;
+    }
+
+    FP_FN(use_pool)(parser, pool);
+    if (max_payload > DEVPROTO_MAX_PAYLOAD_SIZE && !parser->pool) {
+        return DEVPROTO_FRAME_ERR_INVALID;
+    }
+
+    parser->max_payload = (uint32_t)max_payload;
+    return 0;
+}
+
+/**
+ * Accept or reject compressed frames
+ */
+static int FP_FN(set_decompress)(FP_T *parser, int enable,
+                                 devproto_frame_pool_t *pool)
+{
+    FP_FN(use_pool)(parser, pool);
+    if (enable && !parser->pool) return DEVPROTO_FRAME_ERR_INVALID;
+
+    parser->decompress = enable ? 1 : 0;
+    return 0;
+}
+
+/**
+ * Choose payload storage once the frame length is known: inline after the
+ * header if it fits, otherwise a pooled block (reusing the one already held
+ * if large enough). Returns 0 on success, -1 if no storage is available.
+ */
+static int FP_FN(select_storage)(FP_T *parser)
+{
+    size_t len = parser->expected_length;
+
+    if (len <= FP_BUF_SIZE - parser->buffer_pos) {
+        FP_FN(release_borrowed)(parser);
+        parser->payload = &parser->buffer[parser->buffer_pos];
+        return 0;
+    }
+
+    if (!parser->pool) return -1;
+
+    if (!parser->borrowed || parser->borrowed_size < len) {
+        FP_FN(release_borrowed)(parser);
+        parser->borrowed = devproto_frame_pool_acquire(parser->pool, len,
+                                                       &parser->borrowed_size);
+        if (!parser->borrowed) return -1;
+    }
+
+    parser->payload = parser->borrowed;
+    return 0;
+}
+
+/**
+ * Reset parser to initial state
+ */
+static void FP_FN(reset)(FP_T *parser)
+{
+    parser->state = DEVPROTO_FRAME_STATE_IDLE;
+    parser->buffer_pos = 0;
+    parser->expected_length = 0;
+    parser->payload_received = 0;
+    parser->payload = NULL;
+    parser->msg_type = 0;
+    parser->sequence = 0;
+    parser->crc_received = 0;
+    parser->crc_calc = 0;
+    parser->compressed = 0;
+}
+
+/**
+ * Bytes needed to finish the current frame
+ */
+static size_t FP_FN(remaining)(const FP_T *parser)
+{
+    size_t tail = (size_t)parser->expected_length + DEVPROTO_CRC_SIZE;
+
+    switch (parser->state) {
+    case DEVPROTO_FRAME_STATE_HEADER_LO: return DEVPROTO_MIN_FRAME_SIZE - 1;
+    case DEVPROTO_FRAME_STATE_LENGTH_HI: return DEVPROTO_MIN_FRAME_SIZE - 2;
+    case DEVPROTO_FRAME_STATE_LENGTH_X2: return DEVPROTO_MIN_FRAME_SIZE - 1;
+    case DEVPROTO_FRAME_STATE_LENGTH_X1: return DEVPROTO_MIN_FRAME_SIZE - 2;
+    case DEVPROTO_FRAME_STATE_LENGTH_LO: return DEVPROTO_MIN_FRAME_SIZE - 3;
+    case DEVPROTO_FRAME_STATE_TYPE:      return 2 + tail;
+    case DEVPROTO_FRAME_STATE_SEQUENCE:  return 1 + tail;
+    case DEVPROTO_FRAME_STATE_PAYLOAD:   return tail - parser->payload_received;
+    case DEVPROTO_FRAME_STATE_CRC_HI:    return 2;
+    case DEVPROTO_FRAME_STATE_CRC_LO:    return 1;
+    default:                             return DEVPROTO_MIN_FRAME_SIZE;
+    }
+}
+
+/**
+ * Process single byte through state machine
+ */
+static int FP_FN(parse_byte)(FP_T *parser, uint8_t byte)
+{
+    switch (parser->state) {
+    case DEVPROTO_FRAME_STATE_IDLE:
+        if (byte == DEVPROTO_HEADER_BYTE0) {
+            parser->buffer[0] = byte;
+            parser->buffer_pos = 1;
+            parser->state = DEVPROTO_FRAME_STATE_HEADER_LO;
+        }
+        break;
+
+    case DEVPROTO_FRAME_STATE_HEADER_LO:
+        if (byte == DEVPROTO_HEADER_BYTE1) {
+            parser->buffer[1] = byte;
+            parser->buffer_pos = 2;
+            parser->state = DEVPROTO_FRAME_STATE_LENGTH_HI;
+        } else if (byte == DEVPROTO_HEADER_BYTE0) {
+            /* Might be start of new frame */
+            parser->buffer[0] = byte;
+            parser->buffer_pos = 1;
+        } else {
+            parser->sync_errors++;
+            FP_FN(reset)(parser);
+        }
+        break;
+
+    case DEVPROTO_FRAME_STATE_LENGTH_HI:
+        parser->buffer[2] = byte;
+        parser->buffer_pos = 3;
+
+        /* Flag bits only when enabled; legacy parsers see an oversized
+         * length and reject the frame below */
+        if ((byte & DEVPROTO_COMPRESS_FLAG) && parser->decompress) {
+            parser->compressed = 1;
+            byte &= (uint8_t)~DEVPROTO_COMPRESS_FLAG;
+        }
+        if ((byte & DEVPROTO_JUMBO_FLAG) &&
+            parser->max_payload > DEVPROTO_MAX_PAYLOAD_SIZE) {
+            parser->expected_length = (uint32_t)(byte & ~DEVPROTO_JUMBO_FLAG) << 24;
+            parser->state = DEVPROTO_FRAME_STATE_LENGTH_X2;
+        } else {
+            parser->expected_length = (uint32_t)byte << 8;
+            parser->state = DEVPROTO_FRAME_STATE_LENGTH_LO;
+        }
+        break;
+
+    case DEVPROTO_FRAME_STATE_LENGTH_X2:
+        parser->buffer[parser->buffer_pos++] = byte;
+        parser->expected_length |= (uint32_t)byte << 16;
+        parser->state = DEVPROTO_FRAME_STATE_LENGTH_X1;
+        break;
+
+    case DEVPROTO_FRAME_STATE_LENGTH_X1:
+        parser->buffer[parser->buffer_pos++] = byte;
+        parser->expected_length |= (uint32_t)byte << 8;
+        parser->state = DEVPROTO_FRAME_STATE_LENGTH_LO;
+        break;
+
+    case DEVPROTO_FRAME_STATE_LENGTH_LO: {
+        parser->buffer[parser->buffer_pos++] = byte;
+        parser->expected_length |= byte;
+
+        /* Validate payload length against the header format in use
+         * (4 header bytes so far for a legacy frame, 6 for an extended one) */
+        uint32_t limit = parser->buffer_pos > 4 ? parser->max_payload
+                                                : DEVPROTO_MAX_PAYLOAD_SIZE;
+        if (parser->expected_length > limit) {
+            parser->sync_errors++;
+            FP_FN(reset)(parser);
+            return DEVPROTO_FRAME_ERR_OVERFLOW;
+        }
+
+        parser->state = DEVPROTO_FRAME_STATE_TYPE;
+        break;
+    }
+
+    case DEVPROTO_FRAME_STATE_TYPE:
+        parser->buffer[parser->buffer_pos++] = byte;
+        parser->msg_type = byte;
+        parser->state = DEVPROTO_FRAME_STATE_SEQUENCE;
+        break;
+
+    case DEVPROTO_FRAME_STATE_SEQUENCE:
+        parser->buffer[parser->buffer_pos++] = byte;
+        parser->sequence = byte;
+        parser->payload_received = 0;
+        parser->crc_calc = devproto_crc16_update(DEVPROTO_CRC_INITIAL,
+                                                 parser->buffer,
+                                                 parser->buffer_pos);
+
+        if (FP_FN(select_storage)(parser) != 0) {
+            parser->sync_errors++;
+            FP_FN(reset)(parser);
+            return DEVPROTO_FRAME_ERR_OVERFLOW;
+        }
+
+        if (parser->expected_length == 0) {
+            /* No payload, go to CRC */
+            parser->state = DEVPROTO_FRAME_STATE_CRC_HI;
+        } else {
+            parser->state = DEVPROTO_FRAME_STATE_PAYLOAD;
+        }
+        break;
+
+    case DEVPROTO_FRAME_STATE_PAYLOAD:
+        if (parser->payload_received < parser->expected_length) {
+            parser->payload[parser->payload_received++] = byte;
+            parser->buffer_pos++;
+            parser->crc_calc = devproto_crc16_update(parser->crc_calc, &byte, 1);
+
+            if (parser->payload_received >= parser->expected_length) {
+                parser->state = DEVPROTO_FRAME_STATE_CRC_HI;
+            }
+        } else {
+            parser->sync_errors++;
+            FP_FN(reset)(parser);
+            return DEVPROTO_FRAME_ERR_OVERFLOW;
+        }
+        break;
+
+    case DEVPROTO_FRAME_STATE_CRC_HI:
+        parser->crc_received = (uint16_t)byte << 8;
+        parser->state = DEVPROTO_FRAME_STATE_CRC_LO;
+        break;
+
+    case DEVPROTO_FRAME_STATE_CRC_LO:
+        parser->crc_received |= byte;
+
+        /* CRC over header + payload was accumulated as bytes arrived */
+        if (parser->crc_calc == parser->crc_received) {
+            parser->state = DEVPROTO_FRAME_STATE_COMPLETE;
+            parser->frames_parsed++;
+            return 1; /* Frame complete */
+        } else {
+            parser->crc_errors++;
+            parser->state = DEVPROTO_FRAME_STATE_ERROR;
+            FP_FN(reset)(parser);
+            return DEVPROTO_FRAME_ERR_CRC;
+        }
+
+    case DEVPROTO_FRAME_STATE_COMPLETE:
+    case DEVPROTO_FRAME_STATE_ERROR:
+        /* Should call reset before continuing */
+        FP_FN(reset)(parser);
+        if (byte == DEVPROTO_HEADER_BYTE0) {
+            parser->buffer[0] = byte;
+            parser->buffer_pos = 1;
+            parser->state = DEVPROTO_FRAME_STATE_HEADER_LO;
+        }
+        break;
+    }
+
+    return 0; /* Need more data */
+}
+
+/**
+ * Expand a compressed payload into the parser's inflated block.
+ * Returns 0, or -1 (counted as a decompress error) if it is corrupt, too
+ * large or no block is available.
+ */
+static int FP_FN(inflate)(FP_T *parser, devproto_message_t *msg)
+{
+    int size = devproto_payload_original_size(msg->payload, msg->payload_len);
+    if (size < 0 || (uint32_t)size > parser->max_payload) goto bad;
+
+    if (!parser->inflated || parser->inflated_size < (size_t)size) {
+        FP_FN(release_inflated)(parser);
+        parser->inflated = devproto_frame_pool_acquire(parser->pool, (size_t)size,
+                                                       &parser->inflated_size);
+        if (!parser->inflated) goto bad;
+    }
+
+    if (devproto_payload_decompress(msg->payload, msg->payload_len,
+                                    parser->inflated, (size_t)size) != size) {
+        goto bad;
+    }
+
+    msg->payload_len = (uint16_t)size;
+    msg->payload = size > 0 ? parser->inflated : NULL;
+    return 0;
+
+bad:
+    parser->decompress_errors++;
+    return -1;
+}
+
+/**
+ * Get completed message after parse_byte returns 1
+ */
+static int FP_FN(get_message)(FP_T *parser, devproto_message_t *msg)
+{
+    if (parser->state != DEVPROTO_FRAME_STATE_COMPLETE) return -1;
+
+    msg->msg_type = parser->msg_type;
+    msg->sequence = parser->sequence;
+    msg->payload_len = (uint16_t)parser->expected_length;
+
+    /* Payload lives in the parser buffer (after the header), a pooled
+     * block or a caller slab */
+    if (parser->expected_length > 0) {
+        msg->payload = parser->payload;
+    } else {
+        msg->payload = NULL;
+    }
+
+    if (parser->compressed) {
+        return FP_FN(inflate)(parser, msg);
+    }
+    return 0;
+}
+
+/**
+ * Bulk-consume input while the parser is in a state that does not need
+ * per-byte dispatch (hunting for sync, or copying payload).
+ * Returns number of bytes consumed; 0 means the next byte must go through
+ * the byte state machine.
+ */
+static size_t FP_FN(parse_bulk)(FP_T *parser, const uint8_t *data, size_t len)
+{
+    switch (parser->state) {
+    case DEVPROTO_FRAME_STATE_IDLE: {
+        /* Everything up to the next 0xAA is discarded by the state machine */
+        const uint8_t *sync = memchr(data, DEVPROTO_HEADER_BYTE0, len);
+        return sync ? (size_t)(sync - data) : len;
+    }
+
+    case DEVPROTO_FRAME_STATE_PAYLOAD: {
+        size_t remaining = parser->expected_length - parser->payload_received;
+        size_t n = len < remaining ? len : remaining;
+
+        memcpy(parser->payload + parser->payload_received, data, n);
+        parser->crc_calc = devproto_crc16_update(parser->crc_calc, data, n);
+        parser->buffer_pos += n;
+        parser->payload_received += n;
+
+        if (parser->payload_received >= parser->expected_length) {
+            parser->state = DEVPROTO_FRAME_STATE_CRC_HI;
+        }
+        return n;
+    }
+
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Point the parser's payload storage at free slab space.
+ * Returns 0 on success, -1 if the payload does not fit.
+ */
+static int FP_FN(slab_attach)(FP_T *parser, devproto_frame_slab_t *slab, size_t len)
+{
+    if (slab->size - slab->used < len) {
+        return -1;
+    }
+
+    parser->payload = slab->data + slab->used;
+    return 0;
+}
+
+/**
+ * Shared parse loop; slab may be NULL (payloads stay in parser buffer)
+ *
+ * Sync hunting and payload runs are handled in bulk (memchr/memcpy); only
+ * header and CRC bytes, which may straddle chunk boundaries, go through the
+ * byte state machine. Results and statistics match feeding every byte to
+ * the byte state machine.
+ */
+static int FP_FN(parse_run)(FP_T *parser, const uint8_t *data, size_t len,
+                            devproto_frame_slab_t *slab,
+                            devproto_message_t *out_messages,
+                            size_t max_messages, size_t *consumed)
+{
+    /* Limit max_messages to prevent return value truncation */
+    if (max_messages > (size_t)INT32_MAX) {
+        max_messages = (size_t)INT32_MAX;
+    }
+
+    /* Payloads from the previous call are dead; give back a pooled block */
+    if (parser->borrowed && parser->state != DEVPROTO_FRAME_STATE_PAYLOAD &&
+        parser->state != DEVPROTO_FRAME_STATE_CRC_HI &&
+        parser->state != DEVPROTO_FRAME_STATE_CRC_LO) {
+        FP_FN(release_borrowed)(parser);
+    }
+    FP_FN(release_inflated)(parser);
+
+    size_t msg_count = 0;
+    size_t i = 0;
+
+    while (i < len && msg_count < max_messages) {
+        /* Assemble straight into the slab when the whole rest of the frame
+         * is in this chunk; frames spanning calls stay in parser storage and
+         * are copied on completion, so the slab is never left referenced by
+         * a frame in progress */
+        if (slab && parser->state == DEVPROTO_FRAME_STATE_PAYLOAD &&
+            parser->payload_received == 0 &&
+            !frame_slab_owns(slab, parser->payload) &&
+            len - i >= (size_t)parser->expected_length + DEVPROTO_CRC_SIZE &&
+            FP_FN(slab_attach)(parser, slab, parser->expected_length) != 0 &&
+            slab->used > 0) {
+            break;  /* Slab full; caller drains and resets it */
+        }
+
+        size_t bulk = FP_FN(parse_bulk)(parser, data + i, len - i);
+        if (bulk > 0) {
+            i += bulk;
+            continue;
+        }
+
+        int result = FP_FN(parse_byte)(parser, data[i++]);
+
+        if (result == 1) {
+            /* Frame complete */
+            devproto_message_t *msg = &out_messages[msg_count];
+            int last = 0;
+
+            if (FP_FN(get_message)(parser, msg) == 0) {
+                if (slab && msg->payload_len > 0) {
+                    if (!frame_slab_owns(slab, msg->payload)) {
+                        /* Assembled outside the slab: copy in if possible */
+                        if (FP_FN(slab_attach)(parser, slab, msg->payload_len) == 0) {
+                            memcpy(parser->payload, msg->payload, msg->payload_len);
+                            msg->payload = parser->payload;
+                        } else {
+                            last = 1;  /* Aliases parser buffer */
+                        }
+                    }
+                    if (!last) {
+                        slab->used = (size_t)(msg->payload - slab->data) +
+                                     msg->payload_len;
+                    }
+                }
+                msg_count++;
+            }
+            FP_FN(reset)(parser);
+
+            if (last) break;
+        } else if (result < 0) {
+            /* Error - parser already reset, continue scanning */
+        }
+    }
+
+    if (consumed) *consumed = i;
+    return (int)msg_count;
+}
+
+#undef FP_T
+#undef FP_FN
+#undef FP_BUF_SIZE
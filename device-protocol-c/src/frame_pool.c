@@ -0,0 +1,152 @@
+/**
+ * @file frame_pool.c
+ * @brief Size-classed payload buffer pool
+ *
+ * Each class keeps an intrusive free list (the link lives in the first bytes
+ * of the free block) guarded by a single mutex; critical sections are a few
+ * pointer moves, so contention stays low even with many parsers.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "devproto/frame_pool.h"
+
+/* Free-list link stored inside an unused block */
+typedef struct frame_pool_block {
+    struct frame_pool_block *next;
+} frame_pool_block_t;
+
+struct devproto_frame_pool {
+    pthread_mutex_t     lock;
+    frame_pool_block_t *free_list[DEVPROTO_FRAME_POOL_CLASSES];
+    size_t              free_count[DEVPROTO_FRAME_POOL_CLASSES];
+    size_t              max_cached;
+    devproto_frame_pool_stats_t stats;
+};
+
+/**
+ * Map a length to its size class, or -1 if it exceeds the largest class
+ */
+static int frame_pool_class(size_t len)
+{
+    size_t size = DEVPROTO_FRAME_POOL_MIN_BLOCK;
+
+    for (int c = 0; c < DEVPROTO_FRAME_POOL_CLASSES; c++, size <<= 1) {
+        if (len <= size) return c;
+    }
+    return -1;
+}
+
+/**
+ * Create pool
+ */
+devproto_frame_pool_t *devproto_frame_pool_create(size_t max_cached)
+{
+    devproto_frame_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->max_cached = max_cached ? max_cached : DEVPROTO_FRAME_POOL_DEFAULT_CACHED;
+    return pool;
+}
+
+/**
+ * Destroy pool
+ */
+void devproto_frame_pool_destroy(devproto_frame_pool_t *pool)
+{
+    if (!pool) return;
+
+    for (int c = 0; c < DEVPROTO_FRAME_POOL_CLASSES; c++) {
+        frame_pool_block_t *b = pool->free_list[c];
+        while (b) {
+            frame_pool_block_t *next = b->next;
+            free(b);
+            b = next;
+        }
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+/**
+ * Borrow block
+ */
+uint8_t *devproto_frame_pool_acquire(devproto_frame_pool_t *pool, size_t len,
+                                     size_t *block_size)
+{
+    if (!pool) return NULL;
+
+    int c = frame_pool_class(len);
+    if (c < 0) return NULL;
+
+    size_t size = (size_t)DEVPROTO_FRAME_POOL_MIN_BLOCK << c;
+
+    pthread_mutex_lock(&pool->lock);
+    frame_pool_block_t *b = pool->free_list[c];
+    if (b) {
+        pool->free_list[c] = b->next;
+        pool->free_count[c]--;
+        pool->stats.blocks_cached--;
+    }
+    pool->stats.blocks_out++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!b) {
+        b = malloc(size);
+        pthread_mutex_lock(&pool->lock);
+        if (b) {
+            pool->stats.allocations++;
+        } else {
+            pool->stats.blocks_out--;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if (!b) return NULL;
+    }
+
+    if (block_size) *block_size = size;
+    return (uint8_t *)b;
+}
+
+/**
+ * Return block
+ */
+void devproto_frame_pool_release(devproto_frame_pool_t *pool, uint8_t *block,
+                                 size_t block_size)
+{
+    if (!pool || !block) return;
+
+    int c = frame_pool_class(block_size);
+    frame_pool_block_t *b = (frame_pool_block_t *)(void *)block;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stats.blocks_out--;
+    if (c >= 0 && pool->free_count[c] < pool->max_cached) {
+        b->next = pool->free_list[c];
+        pool->free_list[c] = b;
+        pool->free_count[c]++;
+        pool->stats.blocks_cached++;
+        b = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(b);
+}
+
+/**
+ * Get statistics
+ */
+void devproto_frame_pool_get_stats(devproto_frame_pool_t *pool,
+                                   devproto_frame_pool_stats_t *stats)
+{
+    if (!pool || !stats) return;
+
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+}
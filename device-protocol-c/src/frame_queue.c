@@ -0,0 +1,374 @@
+/**
+ * @file frame_queue.c
+ * @brief Bounded lock-free frame queue (SPSC and MPSC)
+ *
+ * Both variants are rings of power-of-two size indexed by free-running
+ * 32-bit counters. The SPSC ring publishes through the tail counter alone.
+ * The MPSC ring follows Vyukov's bounded queue: producers claim a position
+ * with a CAS on the tail and publish it through the slot's own sequence
+ * word, so a slow producer never exposes a half-written slot. Counters are
+ * 32-bit so no 64-bit atomics (libatomic on MIPS32) are needed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include "devproto/frame_queue.h"
+#include "devproto/error.h"
+
+_Static_assert(ATOMIC_INT_LOCK_FREE == 2, "frame queue needs lock-free 32-bit atomics");
+
+/* Largest ring; keeps counter differences meaningful */
+#define FRAME_QUEUE_MAX_CAPACITY    (1u << 30)
+
+typedef struct {
+    atomic_uint seq;                    /* MPSC: position this slot is ready for */
+    devproto_message_t msg;             /* payload not set; see block/data */
+    uint8_t *block;
+    size_t   block_size;
+    uint8_t  data[DEVPROTO_FRAME_COMPACT_PAYLOAD];
+} frame_queue_slot_t;
+
+struct devproto_frame_queue {
+    devproto_frame_queue_mode_t mode;
+    unsigned capacity;
+    unsigned mask;
+    frame_queue_slot_t *slots;
+    devproto_frame_pool_t *pool;
+    int own_pool;
+
+    /* Producer and consumer counters on separate cache lines */
+    _Alignas(64) atomic_uint tail;      /* Positions claimed by producers */
+    atomic_uint dropped;
+    atomic_uint high_water;
+    _Alignas(64) atomic_uint head;      /* Positions consumed */
+
+    /* Consumer sleep, only touched when the queue runs empty */
+    _Alignas(64) atomic_int sleeping;
+    atomic_int woken;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+};
+
+/**
+ * Create queue
+ */
+devproto_frame_queue_t *devproto_frame_queue_create(size_t capacity,
+                                                    devproto_frame_queue_mode_t mode,
+                                                    devproto_frame_pool_t *pool)
+{
+    if (capacity == 0 || capacity > FRAME_QUEUE_MAX_CAPACITY) return NULL;
+    if (mode != DEVPROTO_FRAME_QUEUE_SPSC && mode != DEVPROTO_FRAME_QUEUE_MPSC) return NULL;
+
+    devproto_frame_queue_t *q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+
+    unsigned cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    q->mode = mode;
+    q->capacity = cap;
+    q->mask = cap - 1;
+
+    q->slots = calloc(cap, sizeof(*q->slots));
+    if (!q->slots) goto error;
+
+    for (unsigned i = 0; i < cap; i++) {
+        atomic_init(&q->slots[i].seq, i);
+    }
+
+    if (pool) {
+        q->pool = pool;
+    } else {
+        q->pool = devproto_frame_pool_create(0);
+        if (!q->pool) goto error;
+        q->own_pool = 1;
+    }
+
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0) goto error;
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int ret = pthread_cond_init(&q->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (ret != 0) goto error;
+
+    if (pthread_mutex_init(&q->lock, NULL) != 0) {
+        pthread_cond_destroy(&q->cond);
+        goto error;
+    }
+
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+    atomic_init(&q->dropped, 0);
+    atomic_init(&q->high_water, 0);
+    atomic_init(&q->sleeping, 0);
+    atomic_init(&q->woken, 0);
+    return q;
+
+error:
+    if (q->own_pool) devproto_frame_pool_destroy(q->pool);
+    free(q->slots);
+    free(q);
+    return NULL;
+}
+
+/**
+ * Take the slot at the consumer position if it is published
+ * Returns 1 if a frame was taken, 0 if the queue is empty.
+ */
+static int frame_queue_try_pop(devproto_frame_queue_t *q, devproto_frame_queue_item_t *item)
+{
+    unsigned pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    frame_queue_slot_t *slot = &q->slots[pos & q->mask];
+
+    if (q->mode == DEVPROTO_FRAME_QUEUE_SPSC) {
+        if (atomic_load_explicit(&q->tail, memory_order_acquire) == pos) return 0;
+    } else if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1) {
+        return 0;
+    }
+
+    item->msg = slot->msg;
+    item->block = slot->block;
+    item->block_size = slot->block_size;
+    if (slot->block) {
+        item->msg.payload = slot->block;
+    } else if (slot->msg.payload_len > 0) {
+        memcpy(item->data, slot->data, slot->msg.payload_len);
+        item->msg.payload = item->data;
+    } else {
+        item->msg.payload = NULL;
+    }
+    slot->block = NULL;
+
+    /* Hand the slot back to producers */
+    if (q->mode == DEVPROTO_FRAME_QUEUE_MPSC) {
+        atomic_store_explicit(&slot->seq, pos + q->capacity, memory_order_release);
+    }
+    atomic_store_explicit(&q->head, pos + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * Destroy queue
+ */
+void devproto_frame_queue_destroy(devproto_frame_queue_t *q)
+{
+    if (!q) return;
+
+    devproto_frame_queue_item_t item;
+    while (frame_queue_try_pop(q, &item) == 1) {
+        devproto_frame_queue_release(q, &item);
+    }
+
+    if (q->own_pool) devproto_frame_pool_destroy(q->pool);
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->lock);
+    free(q->slots);
+    free(q);
+}
+
+/**
+ * Claim the next producer position
+ * Returns the slot, or NULL if the queue is full.
+ */
+static frame_queue_slot_t *frame_queue_claim(devproto_frame_queue_t *q, unsigned *pos_out)
+{
+    unsigned pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    if (q->mode == DEVPROTO_FRAME_QUEUE_SPSC) {
+        unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (pos - head >= q->capacity) return NULL;
+        *pos_out = pos;
+        return &q->slots[pos & q->mask];
+    }
+
+    for (;;) {
+        frame_queue_slot_t *slot = &q->slots[pos & q->mask];
+        unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int diff = (int)(seq - pos);
+
+        if (diff == 0) {
+            /* Slot free for this position: race other producers for it */
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                *pos_out = pos;
+                return slot;
+            }
+        } else if (diff < 0) {
+            /* Consumer has not freed it yet: full */
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Raise the high-water mark to depth
+ */
+static void frame_queue_note_depth(devproto_frame_queue_t *q, unsigned depth)
+{
+    unsigned seen = atomic_load_explicit(&q->high_water, memory_order_relaxed);
+
+    while (depth > seen &&
+           !atomic_compare_exchange_weak_explicit(&q->high_water, &seen, depth,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+/**
+ * Signal the consumer if it is asleep
+ */
+static void frame_queue_notify(devproto_frame_queue_t *q)
+{
+    /* Pairs with the fence in devproto_frame_queue_pop(): either we see the
+     * consumer asleep, or it sees the frame we just published */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&q->sleeping, memory_order_relaxed)) {
+        pthread_mutex_lock(&q->lock);
+        pthread_cond_signal(&q->cond);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+/**
+ * Push message
+ */
+int devproto_frame_queue_push(devproto_frame_queue_t *q, const devproto_message_t *msg)
+{
+    if (!q || !msg) return DEVPROTO_ERR_INVALID;
+    if (msg->payload_len > 0 && !msg->payload) return DEVPROTO_ERR_INVALID;
+
+    /* Borrow before claiming: a claimed MPSC slot must be published */
+    uint8_t *block = NULL;
+    size_t block_size = 0;
+    if (msg->payload_len > DEVPROTO_FRAME_COMPACT_PAYLOAD) {
+        block = devproto_frame_pool_acquire(q->pool, msg->payload_len, &block_size);
+        if (!block) {
+            atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+            return DEVPROTO_ERR_NOMEM;
+        }
+    }
+
+    unsigned pos;
+    frame_queue_slot_t *slot = frame_queue_claim(q, &pos);
+    if (!slot) {
+        if (block) devproto_frame_pool_release(q->pool, block, block_size);
+        atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+        return DEVPROTO_ERR_OVERFLOW;
+    }
+
+    slot->msg = *msg;
+    slot->msg.payload = NULL;
+    slot->block = block;
+    slot->block_size = block_size;
+    if (msg->payload_len > 0) {
+        memcpy(block ? block : slot->data, msg->payload, msg->payload_len);
+    }
+
+    /* Publish */
+    if (q->mode == DEVPROTO_FRAME_QUEUE_SPSC) {
+        atomic_store_explicit(&q->tail, pos + 1, memory_order_release);
+    } else {
+        atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    }
+
+    frame_queue_note_depth(q, pos + 1 - atomic_load_explicit(&q->head, memory_order_relaxed));
+    frame_queue_notify(q);
+    return 0;
+}
+
+/**
+ * Pop message, waiting up to timeout_ms
+ */
+int devproto_frame_queue_pop(devproto_frame_queue_t *q, devproto_frame_queue_item_t *item,
+                             int timeout_ms)
+{
+    if (!q || !item) return DEVPROTO_ERR_INVALID;
+
+    if (frame_queue_try_pop(q, item)) return 1;
+    if (timeout_ms == 0) return 0;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout_ms > 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    int got = 0;
+    pthread_mutex_lock(&q->lock);
+    atomic_store_explicit(&q->sleeping, 1, memory_order_relaxed);
+
+    for (;;) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if ((got = frame_queue_try_pop(q, item)) != 0) break;
+        if (atomic_exchange_explicit(&q->woken, 0, memory_order_relaxed)) break;
+
+        int ret = timeout_ms < 0 ? pthread_cond_wait(&q->cond, &q->lock)
+                                 : pthread_cond_timedwait(&q->cond, &q->lock, &deadline);
+        if (ret == ETIMEDOUT) {
+            got = frame_queue_try_pop(q, item);
+            break;
+        }
+    }
+
+    atomic_store_explicit(&q->sleeping, 0, memory_order_relaxed);
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+/**
+ * Release a popped frame
+ */
+void devproto_frame_queue_release(devproto_frame_queue_t *q, devproto_frame_queue_item_t *item)
+{
+    if (!q || !item) return;
+
+    if (item->block) {
+        devproto_frame_pool_release(q->pool, item->block, item->block_size);
+        item->block = NULL;
+    }
+    item->msg.payload = NULL;
+}
+
+/**
+ * Wake the consumer
+ */
+void devproto_frame_queue_wake(devproto_frame_queue_t *q)
+{
+    if (!q) return;
+
+    pthread_mutex_lock(&q->lock);
+    atomic_store_explicit(&q->woken, 1, memory_order_relaxed);
+    pthread_cond_signal(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ * Get statistics
+ */
+void devproto_frame_queue_get_stats(devproto_frame_queue_t *q,
+                                    devproto_frame_queue_stats_t *stats)
+{
+    if (!q || !stats) return;
+
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    stats->pushed = tail;
+    stats->popped = head;
+    stats->dropped = atomic_load_explicit(&q->dropped, memory_order_relaxed);
+    stats->depth = tail - head;
+    stats->high_water = atomic_load_explicit(&q->high_water, memory_order_relaxed);
+    stats->capacity = q->capacity;
+}
@@ -6,8 +6,11 @@
 #include <string.h>
 #include <stdint.h>
 #include <limits.h>
+#include <math.h>
 #include "devproto/metrics.h"
 
+#define METRIC_ENTRY_SIZE 5
+
 /**
  * Encode float to big-endian bytes
  */
@@ -28,9 +31,10 @@ void devproto_float_to_be(float value, uint8_t *bytes)
 }
 
 /**
- * Decode float from big-endian bytes
+ * Load a big-endian float (internal, always inlined; the exported wrapper
+ * below cannot be inlined across the -fPIC interposition boundary)
  */
-float devproto_float_from_be(const uint8_t *bytes)
+static inline float metrics_float_from_be(const uint8_t *bytes)
 {
     union {
         float f;
@@ -46,6 +50,14 @@ float devproto_float_from_be(const uint8_t *bytes)
     return conv.f;
 }
 
+/**
+ * Decode float from big-endian bytes
+ */
+float devproto_float_from_be(const uint8_t *bytes)
+{
+    return metrics_float_from_be(bytes);
+}
+
 /**
  * Encode a metric value
  */
@@ -75,139 +87,207 @@ int devproto_metric_decode(const devproto_metric_entry_t *entry,
     return 0;
 }
 
+#define METRIC_INFO(id, name, unit, min, max, res, cat) \
+    [DEVPROTO_METRIC_##id] = { name, unit, min, max, res, DEVPROTO_METRIC_CAT_##cat }
+
+/**
+ * Metric registry, indexed by type; unassigned codes are zero (name NULL)
+ */
+static const devproto_metric_info_t metric_registry[256] = {
+    /* System */
+    METRIC_INFO(CPU_USAGE,             "CPU_USAGE",               "%",     0.0f,     100.0f,    0.01f,  SYSTEM),
+    METRIC_INFO(MEMORY_USAGE,          "MEMORY_USAGE",            "%",     0.0f,     100.0f,    0.01f,  SYSTEM),
+    METRIC_INFO(TEMPERATURE,           "TEMPERATURE",             "degC",  -40.0f,   125.0f,    0.1f,   SYSTEM),
+    METRIC_INFO(HUMIDITY,              "HUMIDITY",                "%",     0.0f,     100.0f,    0.01f,  SYSTEM),
+    METRIC_INFO(FAN_SPEED,             "FAN_SPEED",               "rpm",   0.0f,     20000.0f,  1.0f,   SYSTEM),
+    METRIC_INFO(VOLTAGE,               "VOLTAGE",                 "V",     0.0f,     500.0f,    0.01f,  SYSTEM),
+    METRIC_INFO(CURRENT,               "CURRENT",                 "A",     0.0f,     200.0f,    0.01f,  SYSTEM),
+    METRIC_INFO(POWER,                 "POWER",                   "W",     0.0f,     20000.0f,  0.1f,   SYSTEM),
+
+    /* RF */
+    METRIC_INFO(SIGNAL_STRENGTH,       "SIGNAL_STRENGTH",         "dBm",   -150.0f,  0.0f,      0.1f,   RF),
+    METRIC_INFO(SIGNAL_QUALITY,        "SIGNAL_QUALITY",          "dB",    -30.0f,   50.0f,     0.1f,   RF),
+    METRIC_INFO(INTERFERENCE,          "INTERFERENCE",            "dBm",   -150.0f,  0.0f,      0.1f,   RF),
+    METRIC_INFO(BER,                   "BER",                     "ratio", 0.0f,     1.0f,      0.0f,   RF),
+    METRIC_INFO(VSWR,                  "VSWR",                    "ratio", 1.0f,     20.0f,     0.01f,  RF),
+    METRIC_INFO(ANTENNA_TILT,          "ANTENNA_TILT",            "deg",   -90.0f,   90.0f,     0.1f,   RF),
+
+    /* Performance */
+    METRIC_INFO(THROUGHPUT,            "THROUGHPUT",              "Mbps",  0.0f,     100000.0f, 0.01f,  PERFORMANCE),
+    METRIC_INFO(LATENCY,               "LATENCY",                 "ms",    0.0f,     10000.0f,  0.01f,  PERFORMANCE),
+    METRIC_INFO(PACKET_LOSS,           "PACKET_LOSS",             "%",     0.0f,     100.0f,    0.01f,  PERFORMANCE),
+    METRIC_INFO(JITTER,                "JITTER",                  "ms",    0.0f,     10000.0f,  0.01f,  PERFORMANCE),
+    METRIC_INFO(CONNECTION_COUNT,      "CONNECTION_COUNT",        "count", 0.0f,     1e7f,      1.0f,   PERFORMANCE),
+
+    /* Device */
+    METRIC_INFO(BATTERY_LEVEL,         "BATTERY_LEVEL",           "%",     0.0f,     100.0f,    0.01f,  DEVICE),
+    METRIC_INFO(UPTIME,                "UPTIME",                  "s",     0.0f,     INFINITY,  1.0f,   DEVICE),
+    METRIC_INFO(ERROR_COUNT,           "ERROR_COUNT",             "count", 0.0f,     INFINITY,  1.0f,   DEVICE),
+
+    /* 5G NR700 (n28 band) */
+    METRIC_INFO(DL_THROUGHPUT_NR700,   "DL_THROUGHPUT_NR700",     "Mbps",  0.0f,     10000.0f,  0.01f,  NR700),
+    METRIC_INFO(UL_THROUGHPUT_NR700,   "UL_THROUGHPUT_NR700",     "Mbps",  0.0f,     10000.0f,  0.01f,  NR700),
+    METRIC_INFO(RSRP_NR700,            "RSRP_NR700",              "dBm",   -156.0f,  -31.0f,    0.1f,   NR700),
+    METRIC_INFO(SINR_NR700,            "SINR_NR700",              "dB",    -23.0f,   40.0f,     0.1f,   NR700),
+
+    /* 5G NR3500 (n78 band) */
+    METRIC_INFO(DL_THROUGHPUT_NR3500,  "DL_THROUGHPUT_NR3500",    "Mbps",  0.0f,     10000.0f,  0.01f,  NR3500),
+    METRIC_INFO(UL_THROUGHPUT_NR3500,  "UL_THROUGHPUT_NR3500",    "Mbps",  0.0f,     10000.0f,  0.01f,  NR3500),
+    METRIC_INFO(RSRP_NR3500,           "RSRP_NR3500",             "dBm",   -156.0f,  -31.0f,    0.1f,   NR3500),
+    METRIC_INFO(SINR_NR3500,           "SINR_NR3500",             "dB",    -23.0f,   40.0f,     0.1f,   NR3500),
+
+    /* 5G Radio */
+    METRIC_INFO(PDCP_THROUGHPUT,       "PDCP_THROUGHPUT",         "Mbps",  0.0f,     10000.0f,  0.01f,  NR_RADIO),
+    METRIC_INFO(RLC_THROUGHPUT,        "RLC_THROUGHPUT",          "Mbps",  0.0f,     10000.0f,  0.01f,  NR_RADIO),
+    METRIC_INFO(INITIAL_BLER,          "INITIAL_BLER",            "%",     0.0f,     100.0f,    0.01f,  NR_RADIO),
+    METRIC_INFO(AVG_MCS,               "AVG_MCS",                 "index", 0.0f,     31.0f,     1.0f,   NR_RADIO),
+    METRIC_INFO(RB_PER_SLOT,           "RB_PER_SLOT",             "count", 0.0f,     275.0f,    1.0f,   NR_RADIO),
+    METRIC_INFO(RANK_INDICATOR,        "RANK_INDICATOR",          "layers", 1.0f,     8.0f,      1.0f,   NR_RADIO),
+
+    /* RF Quality */
+    METRIC_INFO(TX_IMBALANCE,          "TX_IMBALANCE",            "dB",    -30.0f,   30.0f,     0.1f,   RF_QUALITY),
+    METRIC_INFO(LATENCY_PING,          "LATENCY_PING",            "ms",    0.0f,     10000.0f,  0.01f,  RF_QUALITY),
+    METRIC_INFO(HANDOVER_SUCCESS,      "HANDOVER_SUCCESS_RATE",   "%",     0.0f,     100.0f,    0.01f,  RF_QUALITY),
+    METRIC_INFO(INTERFERENCE_LEVEL,    "INTERFERENCE_LEVEL",      "dBm",   -150.0f,  0.0f,      0.1f,   RF_QUALITY),
+
+    /* Carrier Aggregation */
+    METRIC_INFO(CA_DL_THROUGHPUT,      "CA_DL_THROUGHPUT",        "Mbps",  0.0f,     10000.0f,  0.01f,  CARRIER_AGG),
+    METRIC_INFO(CA_UL_THROUGHPUT,      "CA_UL_THROUGHPUT",        "Mbps",  0.0f,     10000.0f,  0.01f,  CARRIER_AGG),
+
+    /* Power & Energy */
+    METRIC_INFO(UTILITY_VOLTAGE_L1,    "UTILITY_VOLTAGE_L1",      "V",     0.0f,     500.0f,    0.01f,  POWER),
+    METRIC_INFO(UTILITY_VOLTAGE_L2,    "UTILITY_VOLTAGE_L2",      "V",     0.0f,     500.0f,    0.01f,  POWER),
+    METRIC_INFO(UTILITY_VOLTAGE_L3,    "UTILITY_VOLTAGE_L3",      "V",     0.0f,     500.0f,    0.01f,  POWER),
+    METRIC_INFO(POWER_FACTOR,          "POWER_FACTOR",            "ratio", 0.0f,     1.0f,      0.001f, POWER),
+    METRIC_INFO(GENERATOR_FUEL_LEVEL,  "GENERATOR_FUEL_LEVEL",    "%",     0.0f,     100.0f,    0.01f,  POWER),
+    METRIC_INFO(GENERATOR_RUNTIME,     "GENERATOR_RUNTIME",       "h",     0.0f,     INFINITY,  0.1f,   POWER),
+    METRIC_INFO(BATTERY_SOC,           "BATTERY_SOC",             "%",     0.0f,     100.0f,    0.01f,  POWER),
+    METRIC_INFO(BATTERY_DOD,           "BATTERY_DOD",             "%",     0.0f,     100.0f,    0.01f,  POWER),
+    METRIC_INFO(BATTERY_CELL_TEMP_MIN, "BATTERY_CELL_TEMP_MIN",   "degC",  -20.0f,   80.0f,     0.1f,   POWER),
+    METRIC_INFO(BATTERY_CELL_TEMP_MAX, "BATTERY_CELL_TEMP_MAX",   "degC",  -20.0f,   80.0f,     0.1f,   POWER),
+    METRIC_INFO(SOLAR_PANEL_VOLTAGE,   "SOLAR_PANEL_VOLTAGE",     "V",     0.0f,     100.0f,    0.01f,  POWER),
+    METRIC_INFO(SOLAR_CHARGE_CURRENT,  "SOLAR_CHARGE_CURRENT",    "A",     0.0f,     50.0f,     0.01f,  POWER),
+    METRIC_INFO(SITE_POWER_KWH,        "SITE_POWER_KWH",          "kWh",   0.0f,     INFINITY,  0.01f,  POWER),
+
+    /* Environmental & Safety */
+    METRIC_INFO(WIND_SPEED,            "WIND_SPEED",              "km/h",  0.0f,     200.0f,    0.1f,   ENVIRONMENT),
+    METRIC_INFO(WIND_DIRECTION,        "WIND_DIRECTION",          "deg",   0.0f,     360.0f,    0.1f,   ENVIRONMENT),
+    METRIC_INFO(PRECIPITATION,         "PRECIPITATION",           "mm/h",  0.0f,     500.0f,    0.1f,   ENVIRONMENT),
+    METRIC_INFO(LIGHTNING_DISTANCE,    "LIGHTNING_DISTANCE",      "km",    0.0f,     50.0f,     0.1f,   ENVIRONMENT),
+    METRIC_INFO(TILT_ANGLE,            "TILT_ANGLE",              "deg",   -10.0f,   10.0f,     0.1f,   ENVIRONMENT),
+    METRIC_INFO(VIBRATION_LEVEL,       "VIBRATION_LEVEL",         "mm/s",  0.0f,     100.0f,    0.01f,  ENVIRONMENT),
+    METRIC_INFO(WATER_LEVEL,           "WATER_LEVEL",             "mm",    0.0f,     1000.0f,   1.0f,   ENVIRONMENT),
+    METRIC_INFO(PM25_LEVEL,            "PM25_LEVEL",              "ug/m3", 0.0f,     500.0f,    0.1f,   ENVIRONMENT),
+    METRIC_INFO(SMOKE_DETECTED,        "SMOKE_DETECTED",          "bool",  0.0f,     1.0f,      1.0f,   ENVIRONMENT),
+    METRIC_INFO(CO_LEVEL,              "CO_LEVEL",                "ppm",   0.0f,     1000.0f,   0.1f,   ENVIRONMENT),
+    METRIC_INFO(DOOR_STATUS,           "DOOR_STATUS",             "bool",  0.0f,     1.0f,      1.0f,   ENVIRONMENT),
+    METRIC_INFO(MOTION_DETECTED,       "MOTION_DETECTED",         "bool",  0.0f,     1.0f,      1.0f,   ENVIRONMENT),
+
+    /* Transport/Backhaul */
+    METRIC_INFO(FIBER_RX_POWER,        "FIBER_RX_POWER",          "dBm",   -40.0f,   10.0f,     0.1f,   BACKHAUL),
+    METRIC_INFO(FIBER_TX_POWER,        "FIBER_TX_POWER",          "dBm",   -10.0f,   10.0f,     0.1f,   BACKHAUL),
+    METRIC_INFO(FIBER_BER,             "FIBER_BER",               "ratio", 0.0f,     1e-3f,     0.0f,   BACKHAUL),
+    METRIC_INFO(FIBER_OSNR,            "FIBER_OSNR",              "dB",    0.0f,     40.0f,     0.1f,   BACKHAUL),
+    METRIC_INFO(MW_RSL,                "MW_RSL",                  "dBm",   -80.0f,   0.0f,      0.1f,   BACKHAUL),
+    METRIC_INFO(MW_SNR,                "MW_SNR",                  "dB",    0.0f,     50.0f,     0.1f,   BACKHAUL),
+    METRIC_INFO(MW_MODULATION,         "MW_MODULATION",           "enum",  0.0f,     11.0f,     1.0f,   BACKHAUL),
+    METRIC_INFO(ETH_UTILIZATION,       "ETH_UTILIZATION",         "%",     0.0f,     100.0f,    0.01f,  BACKHAUL),
+    METRIC_INFO(ETH_ERRORS,            "ETH_ERRORS",              "count", 0.0f,     INFINITY,  1.0f,   BACKHAUL),
+    METRIC_INFO(ETH_LATENCY,           "ETH_LATENCY",             "ms",    0.0f,     1000.0f,   0.01f,  BACKHAUL),
+    METRIC_INFO(PTP_OFFSET,            "PTP_OFFSET",              "ns",    -1e6f,    1e6f,      1.0f,   BACKHAUL),
+    METRIC_INFO(GPS_SATELLITES,        "GPS_SATELLITES",          "count", 0.0f,     24.0f,     1.0f,   BACKHAUL),
+
+    /* Advanced Radio */
+    METRIC_INFO(BEAM_WEIGHT_MAG,       "BEAM_WEIGHT_MAG",         "ratio", 0.0f,     1.0f,      0.001f, ADVANCED_RADIO),
+    METRIC_INFO(BEAM_WEIGHT_PHASE,     "BEAM_WEIGHT_PHASE",       "deg",   -180.0f,  180.0f,    0.1f,   ADVANCED_RADIO),
+    METRIC_INFO(PRECODING_RANK,        "PRECODING_RANK",          "layers", 1.0f,     8.0f,      1.0f,   ADVANCED_RADIO),
+    METRIC_INFO(PIM_LEVEL,             "PIM_LEVEL",               "dBm",   -150.0f,  0.0f,      0.1f,   ADVANCED_RADIO),
+    METRIC_INFO(CO_CHANNEL_INTERF,     "CO_CHANNEL_INTERFERENCE", "dBm",   -120.0f,  0.0f,      0.1f,   ADVANCED_RADIO),
+    METRIC_INFO(OCCUPIED_BANDWIDTH,    "OCCUPIED_BANDWIDTH",      "MHz",   0.0f,     100.0f,    0.01f,  ADVANCED_RADIO),
+    METRIC_INFO(ACLR,                  "ACLR",                    "dB",    0.0f,     80.0f,     0.1f,   ADVANCED_RADIO),
+    METRIC_INFO(GTP_THROUGHPUT,        "GTP_THROUGHPUT",          "Mbps",  0.0f,     10000.0f,  0.01f,  ADVANCED_RADIO),
+    METRIC_INFO(PACKET_DELAY,          "PACKET_DELAY",            "ms",    0.0f,     1000.0f,   0.01f,  ADVANCED_RADIO),
+    METRIC_INFO(RRC_SETUP_SUCCESS,     "RRC_SETUP_SUCCESS",       "%",     0.0f,     100.0f,    0.01f,  ADVANCED_RADIO),
+    METRIC_INFO(PAGING_SUCCESS,        "PAGING_SUCCESS",          "%",     0.0f,     100.0f,    0.01f,  ADVANCED_RADIO),
+
+    /* Network Slicing */
+    METRIC_INFO(SLICE_THROUGHPUT,      "SLICE_THROUGHPUT",        "Mbps",  0.0f,     10000.0f,  0.01f,  SLICING),
+    METRIC_INFO(SLICE_LATENCY,         "SLICE_LATENCY",           "ms",    0.0f,     1000.0f,   0.01f,  SLICING),
+    METRIC_INFO(SLICE_PACKET_LOSS,     "SLICE_PACKET_LOSS",       "%",     0.0f,     100.0f,    0.01f,  SLICING),
+    METRIC_INFO(SLICE_PRB_UTIL,        "SLICE_PRB_UTIL",          "%",     0.0f,     100.0f,    0.01f,  SLICING),
+    METRIC_INFO(SLICE_SLA_COMPLIANCE,  "SLICE_SLA_COMPLIANCE",    "%",     0.0f,     100.0f,    0.01f,  SLICING),
+
+    /* Special */
+    METRIC_INFO(ALL,                   "ALL_METRICS",             "",      0.0f,     0.0f,      0.0f,   UNKNOWN)
+};
+
+static const char *const metric_category_names[DEVPROTO_METRIC_CAT_COUNT] = {
+    [DEVPROTO_METRIC_CAT_UNKNOWN]        = "unknown",
+    [DEVPROTO_METRIC_CAT_SYSTEM]         = "system",
+    [DEVPROTO_METRIC_CAT_RF]             = "rf",
+    [DEVPROTO_METRIC_CAT_PERFORMANCE]    = "performance",
+    [DEVPROTO_METRIC_CAT_DEVICE]         = "device",
+    [DEVPROTO_METRIC_CAT_NR700]          = "nr700",
+    [DEVPROTO_METRIC_CAT_NR3500]         = "nr3500",
+    [DEVPROTO_METRIC_CAT_NR_RADIO]       = "nr_radio",
+    [DEVPROTO_METRIC_CAT_RF_QUALITY]     = "rf_quality",
+    [DEVPROTO_METRIC_CAT_CARRIER_AGG]    = "carrier_aggregation",
+    [DEVPROTO_METRIC_CAT_POWER]          = "power",
+    [DEVPROTO_METRIC_CAT_ENVIRONMENT]    = "environment",
+    [DEVPROTO_METRIC_CAT_BACKHAUL]       = "backhaul",
+    [DEVPROTO_METRIC_CAT_ADVANCED_RADIO] = "advanced_radio",
+    [DEVPROTO_METRIC_CAT_SLICING]        = "slicing"
+};
+
+/**
+ * Get metric registry entry
+ */
+const devproto_metric_info_t *devproto_metric_info(devproto_metric_type_t type)
+{
+    if ((unsigned)type > 0xFF) return NULL;
+
+    const devproto_metric_info_t *info = &metric_registry[type];
+    return info->name ? info : NULL;
+}
+
 /**
  * Get metric name string
  */
 const char *devproto_metric_name(devproto_metric_type_t type)
 {
-    switch (type) {
-    /* System metrics */
-    case DEVPROTO_METRIC_CPU_USAGE:        return "CPU_USAGE";
-    case DEVPROTO_METRIC_MEMORY_USAGE:     return "MEMORY_USAGE";
-    case DEVPROTO_METRIC_TEMPERATURE:      return "TEMPERATURE";
-    case DEVPROTO_METRIC_HUMIDITY:         return "HUMIDITY";
-    case DEVPROTO_METRIC_FAN_SPEED:        return "FAN_SPEED";
-    case DEVPROTO_METRIC_VOLTAGE:          return "VOLTAGE";
-    case DEVPROTO_METRIC_CURRENT:          return "CURRENT";
-    case DEVPROTO_METRIC_POWER:            return "POWER";
-
-    /* RF metrics */
-    case DEVPROTO_METRIC_SIGNAL_STRENGTH:  return "SIGNAL_STRENGTH";
-    case DEVPROTO_METRIC_SIGNAL_QUALITY:   return "SIGNAL_QUALITY";
-    case DEVPROTO_METRIC_INTERFERENCE:     return "INTERFERENCE";
-    case DEVPROTO_METRIC_BER:              return "BER";
-    case DEVPROTO_METRIC_VSWR:             return "VSWR";
-    case DEVPROTO_METRIC_ANTENNA_TILT:     return "ANTENNA_TILT";
-
-    /* Performance metrics */
-    case DEVPROTO_METRIC_THROUGHPUT:       return "THROUGHPUT";
-    case DEVPROTO_METRIC_LATENCY:          return "LATENCY";
-    case DEVPROTO_METRIC_PACKET_LOSS:      return "PACKET_LOSS";
-    case DEVPROTO_METRIC_JITTER:           return "JITTER";
-    case DEVPROTO_METRIC_CONNECTION_COUNT: return "CONNECTION_COUNT";
-
-    /* Device metrics */
-    case DEVPROTO_METRIC_BATTERY_LEVEL:    return "BATTERY_LEVEL";
-    case DEVPROTO_METRIC_UPTIME:           return "UPTIME";
-    case DEVPROTO_METRIC_ERROR_COUNT:      return "ERROR_COUNT";
-
-    /* 5G NR700 (n28 band) metrics */
-    case DEVPROTO_METRIC_DL_THROUGHPUT_NR700: return "DL_THROUGHPUT_NR700";
-    case DEVPROTO_METRIC_UL_THROUGHPUT_NR700: return "UL_THROUGHPUT_NR700";
-    case DEVPROTO_METRIC_RSRP_NR700:          return "RSRP_NR700";
-    case DEVPROTO_METRIC_SINR_NR700:          return "SINR_NR700";
-
-    /* 5G NR3500 (n78 band) metrics */
-    case DEVPROTO_METRIC_DL_THROUGHPUT_NR3500: return "DL_THROUGHPUT_NR3500";
-    case DEVPROTO_METRIC_UL_THROUGHPUT_NR3500: return "UL_THROUGHPUT_NR3500";
-    case DEVPROTO_METRIC_RSRP_NR3500:          return "RSRP_NR3500";
-    case DEVPROTO_METRIC_SINR_NR3500:          return "SINR_NR3500";
-
-    /* 5G Radio metrics */
-    case DEVPROTO_METRIC_PDCP_THROUGHPUT:      return "PDCP_THROUGHPUT";
-    case DEVPROTO_METRIC_RLC_THROUGHPUT:       return "RLC_THROUGHPUT";
-    case DEVPROTO_METRIC_INITIAL_BLER:         return "INITIAL_BLER";
-    case DEVPROTO_METRIC_AVG_MCS:              return "AVG_MCS";
-    case DEVPROTO_METRIC_RB_PER_SLOT:          return "RB_PER_SLOT";
-    case DEVPROTO_METRIC_RANK_INDICATOR:       return "RANK_INDICATOR";
-
-    /* RF Quality metrics */
-    case DEVPROTO_METRIC_TX_IMBALANCE:         return "TX_IMBALANCE";
-    case DEVPROTO_METRIC_LATENCY_PING:         return "LATENCY_PING";
-    case DEVPROTO_METRIC_HANDOVER_SUCCESS:     return "HANDOVER_SUCCESS_RATE";
-    case DEVPROTO_METRIC_INTERFERENCE_LEVEL:   return "INTERFERENCE_LEVEL";
-
-    /* Carrier Aggregation metrics */
-    case DEVPROTO_METRIC_CA_DL_THROUGHPUT:     return "CA_DL_THROUGHPUT";
-    case DEVPROTO_METRIC_CA_UL_THROUGHPUT:     return "CA_UL_THROUGHPUT";
-
-    /* Power & Energy metrics (0x80-0x8F) */
-    case DEVPROTO_METRIC_UTILITY_VOLTAGE_L1:   return "UTILITY_VOLTAGE_L1";
-    case DEVPROTO_METRIC_UTILITY_VOLTAGE_L2:   return "UTILITY_VOLTAGE_L2";
-    case DEVPROTO_METRIC_UTILITY_VOLTAGE_L3:   return "UTILITY_VOLTAGE_L3";
-    case DEVPROTO_METRIC_POWER_FACTOR:         return "POWER_FACTOR";
-    case DEVPROTO_METRIC_GENERATOR_FUEL_LEVEL: return "GENERATOR_FUEL_LEVEL";
-    case DEVPROTO_METRIC_GENERATOR_RUNTIME:    return "GENERATOR_RUNTIME";
-    case DEVPROTO_METRIC_BATTERY_SOC:          return "BATTERY_SOC";
-    case DEVPROTO_METRIC_BATTERY_DOD:          return "BATTERY_DOD";
-    case DEVPROTO_METRIC_BATTERY_CELL_TEMP_MIN:return "BATTERY_CELL_TEMP_MIN";
-    case DEVPROTO_METRIC_BATTERY_CELL_TEMP_MAX:return "BATTERY_CELL_TEMP_MAX";
-    case DEVPROTO_METRIC_SOLAR_PANEL_VOLTAGE:  return "SOLAR_PANEL_VOLTAGE";
-    case DEVPROTO_METRIC_SOLAR_CHARGE_CURRENT: return "SOLAR_CHARGE_CURRENT";
-    case DEVPROTO_METRIC_SITE_POWER_KWH:       return "SITE_POWER_KWH";
-
-    /* Environmental & Safety metrics (0x90-0x9F) */
-    case DEVPROTO_METRIC_WIND_SPEED:           return "WIND_SPEED";
-    case DEVPROTO_METRIC_WIND_DIRECTION:       return "WIND_DIRECTION";
-    case DEVPROTO_METRIC_PRECIPITATION:        return "PRECIPITATION";
-    case DEVPROTO_METRIC_LIGHTNING_DISTANCE:   return "LIGHTNING_DISTANCE";
-    case DEVPROTO_METRIC_TILT_ANGLE:           return "TILT_ANGLE";
-    case DEVPROTO_METRIC_VIBRATION_LEVEL:      return "VIBRATION_LEVEL";
-    case DEVPROTO_METRIC_WATER_LEVEL:          return "WATER_LEVEL";
-    case DEVPROTO_METRIC_PM25_LEVEL:           return "PM25_LEVEL";
-    case DEVPROTO_METRIC_SMOKE_DETECTED:       return "SMOKE_DETECTED";
-    case DEVPROTO_METRIC_CO_LEVEL:             return "CO_LEVEL";
-    case DEVPROTO_METRIC_DOOR_STATUS:          return "DOOR_STATUS";
-    case DEVPROTO_METRIC_MOTION_DETECTED:      return "MOTION_DETECTED";
-
-    /* Transport/Backhaul metrics (0xA0-0xAF) */
-    case DEVPROTO_METRIC_FIBER_RX_POWER:       return "FIBER_RX_POWER";
-    case DEVPROTO_METRIC_FIBER_TX_POWER:       return "FIBER_TX_POWER";
-    case DEVPROTO_METRIC_FIBER_BER:            return "FIBER_BER";
-    case DEVPROTO_METRIC_FIBER_OSNR:           return "FIBER_OSNR";
-    case DEVPROTO_METRIC_MW_RSL:               return "MW_RSL";
-    case DEVPROTO_METRIC_MW_SNR:               return "MW_SNR";
-    case DEVPROTO_METRIC_MW_MODULATION:        return "MW_MODULATION";
-    case DEVPROTO_METRIC_ETH_UTILIZATION:      return "ETH_UTILIZATION";
-    case DEVPROTO_METRIC_ETH_ERRORS:           return "ETH_ERRORS";
-    case DEVPROTO_METRIC_ETH_LATENCY:          return "ETH_LATENCY";
-    case DEVPROTO_METRIC_PTP_OFFSET:           return "PTP_OFFSET";
-    case DEVPROTO_METRIC_GPS_SATELLITES:       return "GPS_SATELLITES";
-
-    /* Advanced Radio metrics (0xB0-0xBF) */
-    case DEVPROTO_METRIC_BEAM_WEIGHT_MAG:      return "BEAM_WEIGHT_MAG";
-    case DEVPROTO_METRIC_BEAM_WEIGHT_PHASE:    return "BEAM_WEIGHT_PHASE";
-    case DEVPROTO_METRIC_PRECODING_RANK:       return "PRECODING_RANK";
-    case DEVPROTO_METRIC_PIM_LEVEL:            return "PIM_LEVEL";
-    case DEVPROTO_METRIC_CO_CHANNEL_INTERF:    return "CO_CHANNEL_INTERFERENCE";
-    case DEVPROTO_METRIC_OCCUPIED_BANDWIDTH:   return "OCCUPIED_BANDWIDTH";
-    case DEVPROTO_METRIC_ACLR:                 return "ACLR";
-    case DEVPROTO_METRIC_GTP_THROUGHPUT:       return "GTP_THROUGHPUT";
-    case DEVPROTO_METRIC_PACKET_DELAY:         return "PACKET_DELAY";
-    case DEVPROTO_METRIC_RRC_SETUP_SUCCESS:    return "RRC_SETUP_SUCCESS";
-    case DEVPROTO_METRIC_PAGING_SUCCESS:       return "PAGING_SUCCESS";
-
-    /* Network Slicing metrics (0xC0-0xCF) */
-    case DEVPROTO_METRIC_SLICE_THROUGHPUT:     return "SLICE_THROUGHPUT";
-    case DEVPROTO_METRIC_SLICE_LATENCY:        return "SLICE_LATENCY";
-    case DEVPROTO_METRIC_SLICE_PACKET_LOSS:    return "SLICE_PACKET_LOSS";
-    case DEVPROTO_METRIC_SLICE_PRB_UTIL:       return "SLICE_PRB_UTIL";
-    case DEVPROTO_METRIC_SLICE_SLA_COMPLIANCE: return "SLICE_SLA_COMPLIANCE";
+    const devproto_metric_info_t *info = devproto_metric_info(type);
+    return info ? info->name : "UNKNOWN";
+}
 
-    /* Special */
-    case DEVPROTO_METRIC_ALL:              return "ALL_METRICS";
-    default:                               return "UNKNOWN";
+/**
+ * Get category name string
+ */
+const char *devproto_metric_category_name(devproto_metric_category_t category)
+{
+    if ((unsigned)category >= DEVPROTO_METRIC_CAT_COUNT) return "unknown";
+    return metric_category_names[category];
+}
+
+/**
+ * Range-check a decoded batch
+ */
+size_t devproto_metrics_validate(const uint8_t *types, const float *values,
+                                 size_t count, uint8_t *valid)
+{
+    if (!types || !values) return 0;
+
+    size_t ok_count = 0;
+
+    /* Branch-free so the loop vectorizes (NaN fails both compares) */
+    for (size_t i = 0; i < count; i++) {
+        const devproto_metric_info_t *info = &metric_registry[types[i]];
+        uint8_t ok = (uint8_t)((info->category != DEVPROTO_METRIC_CAT_UNKNOWN) &
+                               (values[i] >= info->min) & (values[i] <= info->max));
+        if (valid) valid[i] = ok;
+        ok_count += ok;
     }
+
+    return ok_count;
 }
 
 /**
@@ -228,13 +308,9 @@ int devproto_metrics_parse(const uint8_t *payload, size_t payload_len,
 
     /* Each metric entry is 5 bytes: 1 byte type + 4 bytes float */
     while (offset + 5 <= payload_len && count < max_metrics) {
-        devproto_metric_entry_t entry;
-        entry.type = payload[offset];
-        memcpy(entry.value_bytes, &payload[offset + 1], 4);
-
-        if (devproto_metric_decode(&entry, &metrics[count]) == 0) {
-            count++;
-        }
+        metrics[count].type = (devproto_metric_type_t)payload[offset];
+        metrics[count].value = metrics_float_from_be(&payload[offset + 1]);
+        count++;
         offset += 5;
     }
 
@@ -270,3 +346,599 @@ int devproto_metrics_build(const devproto_metric_t *metrics, size_t num_metrics,
 
     return (int)offset;
 }
+
+/* ========================================================================
+ * Bulk structure-of-arrays decode
+ *
+ * Four 5-byte entries span 20 bytes, covered by two overlapping 16-byte
+ * loads at +0 and +4. One byte shuffle per load gathers and byte-swaps the
+ * big-endian floats into four little-endian lanes; another gathers the type
+ * bytes. Only little-endian hosts take the SIMD path.
+ * ======================================================================== */
+
+/**
+ * Scalar kernel: decode count entries
+ */
+static void metrics_decode_scalar(const uint8_t *p, size_t count,
+                                  uint8_t *types, float *values)
+{
+    for (size_t i = 0; i < count; i++, p += METRIC_ENTRY_SIZE) {
+        types[i] = p[0];
+        values[i] = metrics_float_from_be(p + 1);
+    }
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define DEVPROTO_METRICS_HAVE_SIMD 1
+#endif
+
+#ifdef DEVPROTO_METRICS_HAVE_SIMD
+
+#include <stdatomic.h>
+
+#if defined(__x86_64__)
+
+#include <immintrin.h>
+
+#define METRICS_SIMD_TARGET __attribute__((target("ssse3")))
+
+METRICS_SIMD_TARGET
+static void metrics_decode_simd(const uint8_t *p, size_t count,
+                                uint8_t *types, float *values)
+{
+    const __m128i vals_a  = _mm_setr_epi8(4, 3, 2, 1, 9, 8, 7, 6, 14, 13, 12, 11,
+                                          -1, -1, -1, -1);
+    const __m128i vals_b  = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+                                          -1, -1, -1, -1, 15, 14, 13, 12);
+    const __m128i types_a = _mm_setr_epi8(0, 5, 10, -1, -1, -1, -1, -1,
+                                          -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i types_b = _mm_setr_epi8(-1, -1, -1, 11, -1, -1, -1, -1,
+                                          -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4, p += 4 * METRIC_ENTRY_SIZE) {
+        __m128i a = _mm_loadu_si128((const __m128i *)p);
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + 4));
+
+        __m128i v = _mm_or_si128(_mm_shuffle_epi8(a, vals_a), _mm_shuffle_epi8(b, vals_b));
+        _mm_storeu_ps(values + i, _mm_castsi128_ps(v));
+
+        __m128i t = _mm_or_si128(_mm_shuffle_epi8(a, types_a), _mm_shuffle_epi8(b, types_b));
+        uint32_t packed = (uint32_t)_mm_cvtsi128_si32(t);
+        memcpy(types + i, &packed, sizeof(packed));
+    }
+
+    metrics_decode_scalar(p, count - i, types + i, values + i);
+}
+
+static int metrics_simd_supported(void)
+{
+    return __builtin_cpu_supports("ssse3");
+}
+
+#else /* __aarch64__ */
+
+#include <arm_neon.h>
+
+static void metrics_decode_simd(const uint8_t *p, size_t count,
+                                uint8_t *types, float *values)
+{
+    static const uint8_t idx_vals_a[16]  = {4, 3, 2, 1, 9, 8, 7, 6, 14, 13, 12, 11,
+                                            0xFF, 0xFF, 0xFF, 0xFF};
+    static const uint8_t idx_vals_b[16]  = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                            0xFF, 0xFF, 0xFF, 0xFF, 15, 14, 13, 12};
+    static const uint8_t idx_types_a[16] = {0, 5, 10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    static const uint8_t idx_types_b[16] = {0xFF, 0xFF, 0xFF, 11, 0xFF, 0xFF, 0xFF, 0xFF,
+                                            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    const uint8x16_t vals_a  = vld1q_u8(idx_vals_a);
+    const uint8x16_t vals_b  = vld1q_u8(idx_vals_b);
+    const uint8x16_t types_a = vld1q_u8(idx_types_a);
+    const uint8x16_t types_b = vld1q_u8(idx_types_b);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4, p += 4 * METRIC_ENTRY_SIZE) {
+        uint8x16_t a = vld1q_u8(p);
+        uint8x16_t b = vld1q_u8(p + 4);
+
+        uint8x16_t v = vorrq_u8(vqtbl1q_u8(a, vals_a), vqtbl1q_u8(b, vals_b));
+        vst1q_f32(values + i, vreinterpretq_f32_u8(v));
+
+        uint8x16_t t = vorrq_u8(vqtbl1q_u8(a, types_a), vqtbl1q_u8(b, types_b));
+        uint32_t packed = vgetq_lane_u32(vreinterpretq_u32_u8(t), 0);
+        memcpy(types + i, &packed, sizeof(packed));
+    }
+
+    metrics_decode_scalar(p, count - i, types + i, values + i);
+}
+
+static int metrics_simd_supported(void)
+{
+    /* Advanced SIMD is mandatory on AArch64 */
+    return 1;
+}
+
+#endif /* __x86_64__ / __aarch64__ */
+
+typedef void (*metrics_decode_fn)(const uint8_t *p, size_t count,
+                                  uint8_t *types, float *values);
+
+static void metrics_decode_resolve(const uint8_t *p, size_t count,
+                                   uint8_t *types, float *values);
+
+/* Selected on first use; the race between threads resolving is benign */
+static _Atomic(metrics_decode_fn) metrics_decode_active = metrics_decode_resolve;
+
+static void metrics_decode_resolve(const uint8_t *p, size_t count,
+                                   uint8_t *types, float *values)
+{
+    metrics_decode_fn fn = metrics_simd_supported() ? metrics_decode_simd
+                                                    : metrics_decode_scalar;
+    atomic_store_explicit(&metrics_decode_active, fn, memory_order_relaxed);
+    fn(p, count, types, values);
+}
+
+#endif /* DEVPROTO_METRICS_HAVE_SIMD */
+
+/**
+ * Validate arguments and compute the number of entries to decode
+ * Returns -1 on invalid arguments.
+ */
+static int metrics_soa_count(const uint8_t *payload, size_t payload_len,
+                             const uint8_t *types, const float *values,
+                             size_t max_metrics, size_t *count)
+{
+    if (!payload || !types || !values || max_metrics == 0) return -1;
+
+    size_t n = payload_len / METRIC_ENTRY_SIZE;
+    if (n > max_metrics) n = max_metrics;
+    if (n > (size_t)INT32_MAX) n = (size_t)INT32_MAX;
+
+    *count = n;
+    return 0;
+}
+
+/**
+ * Parse metrics into structure-of-arrays output
+ */
+int devproto_metrics_parse_soa(const uint8_t *payload, size_t payload_len,
+                               uint8_t *types, float *values, size_t max_metrics)
+{
+    size_t count;
+    if (metrics_soa_count(payload, payload_len, types, values, max_metrics, &count) < 0) {
+        return -1;
+    }
+
+#ifdef DEVPROTO_METRICS_HAVE_SIMD
+    atomic_load_explicit(&metrics_decode_active, memory_order_relaxed)(payload, count,
+                                                                       types, values);
+#else
+    metrics_decode_scalar(payload, count, types, values);
+#endif
+
+    return (int)count;
+}
+
+/**
+ * Parse metrics into structure-of-arrays output with a specific kernel
+ */
+int devproto_metrics_parse_soa_kernel(devproto_metrics_kernel_t kernel,
+                                      const uint8_t *payload, size_t payload_len,
+                                      uint8_t *types, float *values,
+                                      size_t max_metrics)
+{
+    size_t count;
+    if (!devproto_metrics_kernel_available(kernel) ||
+        metrics_soa_count(payload, payload_len, types, values, max_metrics, &count) < 0) {
+        return -1;
+    }
+
+#ifdef DEVPROTO_METRICS_HAVE_SIMD
+    if (kernel == DEVPROTO_METRICS_KERNEL_SIMD) {
+        metrics_decode_simd(payload, count, types, values);
+        return (int)count;
+    }
+#endif
+
+    metrics_decode_scalar(payload, count, types, values);
+    return (int)count;
+}
+
+/**
+ * Check whether a decode kernel is usable
+ */
+int devproto_metrics_kernel_available(devproto_metrics_kernel_t kernel)
+{
+    switch (kernel) {
+    case DEVPROTO_METRICS_KERNEL_SCALAR:
+        return 1;
+    case DEVPROTO_METRICS_KERNEL_SIMD:
+#ifdef DEVPROTO_METRICS_HAVE_SIMD
+        return metrics_simd_supported();
+#else
+        return 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Get decode kernel name
+ */
+const char *devproto_metrics_kernel_name(devproto_metrics_kernel_t kernel)
+{
+    switch (kernel) {
+    case DEVPROTO_METRICS_KERNEL_SCALAR: return "scalar";
+#if defined(__aarch64__)
+    case DEVPROTO_METRICS_KERNEL_SIMD:   return "neon";
+#else
+    case DEVPROTO_METRICS_KERNEL_SIMD:   return "ssse3";
+#endif
+    default:                             return "unknown";
+    }
+}
+
+/* ========================================================================
+ * Compact delta/varint format
+ * ======================================================================== */
+
+#define MAP_TEST(map, t)    (((map)[(t) >> 3] >> ((t) & 7)) & 1u)
+#define MAP_SET(map, t)     ((map)[(t) >> 3] |= (uint8_t)(1u << ((t) & 7)))
+#define MAP_CLEAR(map, t)   ((map)[(t) >> 3] &= (uint8_t)~(1u << ((t) & 7)))
+
+/* Largest quantized magnitude (keeps deltas within 33 bits) */
+#define COMPACT_QUANT_LIMIT 1073741824.0f
+
+/* Varint of a 33-bit entry is at most 5 bytes */
+#define COMPACT_VARINT_MAX  5
+
+/**
+ * Quantize a value using the registry resolution
+ * Returns 1 with *q set, or 0 if the value must be sent as exact float bits.
+ */
+static int compact_quantize(uint8_t type, float value, uint32_t *q)
+{
+    float resolution = metric_registry[type].resolution;
+    if (!(resolution > 0.0f)) return 0;
+
+    float scaled = value / resolution;
+    if (!(scaled > -COMPACT_QUANT_LIMIT && scaled < COMPACT_QUANT_LIMIT)) return 0;
+
+    *q = (uint32_t)(int32_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+    return 1;
+}
+
+/**
+ * Reconstruct a snapshot value as a float
+ */
+static float compact_value(const devproto_metrics_snapshot_t *snap, uint8_t type)
+{
+    uint32_t v = snap->value[type];
+
+    if (MAP_TEST(snap->exact, type)) {
+        union {
+            float f;
+            uint32_t u;
+        } conv;
+        conv.u = v;
+        return conv.f;
+    }
+
+    return (float)((double)(int32_t)v * (double)metric_registry[type].resolution);
+}
+
+/**
+ * Reference value an entry is coded against (0 unless the baseline holds
+ * the same type in the same kind)
+ */
+static uint32_t compact_reference(const devproto_metrics_snapshot_t *base, uint8_t type,
+                                  unsigned exact)
+{
+    if (!base || !MAP_TEST(base->present, type) || MAP_TEST(base->exact, type) != exact) {
+        return 0;
+    }
+    return base->value[type];
+}
+
+/**
+ * Code one entry: bit 0 = exact, rest = zigzag delta or XOR of float bits
+ */
+static uint64_t compact_entry(const devproto_metrics_snapshot_t *cur,
+                              const devproto_metrics_snapshot_t *base, uint8_t type)
+{
+    unsigned exact = MAP_TEST(cur->exact, type);
+    uint32_t ref = compact_reference(base, type, exact);
+
+    if (exact) {
+        return ((uint64_t)(cur->value[type] ^ ref) << 1) | 1;
+    }
+
+    int64_t d = (int64_t)(int32_t)cur->value[type] - (int64_t)(int32_t)ref;
+    return (((uint64_t)d << 1) ^ (uint64_t)(d >> 63)) << 1;
+}
+
+static void compact_varint_put(uint8_t *buf, size_t *off, uint64_t v)
+{
+    do {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        buf[(*off)++] = b | (v ? 0x80 : 0);
+    } while (v);
+}
+
+static int compact_varint_get(const uint8_t *buf, size_t len, size_t *off, uint64_t *v)
+{
+    uint64_t result = 0;
+
+    for (int i = 0; i < COMPACT_VARINT_MAX; i++) {
+        if (*off >= len) return -1;
+        uint8_t b = buf[(*off)++];
+        result |= (uint64_t)(b & 0x7F) << (7 * i);
+        if (!(b & 0x80)) {
+            *v = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Initialize encoder
+ */
+void devproto_metrics_encoder_init(devproto_metrics_encoder_t *enc)
+{
+    if (!enc) return;
+
+    memset(enc, 0, sizeof(*enc));
+    enc->next_id = 1;
+}
+
+/**
+ * Record host acknowledgement
+ */
+void devproto_metrics_encoder_ack(devproto_metrics_encoder_t *enc, uint8_t snapshot_id)
+{
+    if (!enc) return;
+
+    if (snapshot_id == 0) {
+        /* Host lost sync: next payload is a keyframe */
+        memset(&enc->base, 0, sizeof(enc->base));
+    } else if (snapshot_id == enc->pending.id) {
+        enc->base = enc->pending;
+    }
+    /* Acks for older snapshots are ignored; the current baseline stays valid */
+}
+
+/**
+ * Build compact metrics payload
+ */
+int devproto_metrics_build_compact(devproto_metrics_encoder_t *enc,
+                                   const devproto_metric_t *metrics, size_t num_metrics,
+                                   uint8_t *buffer, size_t buf_size)
+{
+    if (!enc || !buffer || (!metrics && num_metrics > 0)) return -1;
+    if (num_metrics > 256) return -1;
+
+    devproto_metrics_snapshot_t *cur = &enc->pending;
+    const devproto_metrics_snapshot_t *base = enc->base.id ? &enc->base : NULL;
+
+    memset(cur, 0, sizeof(*cur));
+
+    for (size_t i = 0; i < num_metrics; i++) {
+        if ((unsigned)metrics[i].type > 0xFF) goto error;
+        uint8_t t = (uint8_t)metrics[i].type;
+        if (MAP_TEST(cur->present, t)) goto error;
+
+        MAP_SET(cur->present, t);
+        if (!compact_quantize(t, metrics[i].value, &cur->value[t])) {
+            memcpy(&cur->value[t], &metrics[i].value, sizeof(uint32_t));
+            MAP_SET(cur->exact, t);
+        }
+    }
+
+    /* A delta can only add or change types, not drop them */
+    for (size_t i = 0; base && i < sizeof(cur->present); i++) {
+        if (base->present[i] & (uint8_t)~cur->present[i]) base = NULL;
+    }
+
+    uint8_t map[32] = {0};
+    size_t map_len = 0;
+
+    for (unsigned t = 0; t < 256; t++) {
+        if (!MAP_TEST(cur->present, t)) continue;
+        if (base && MAP_TEST(base->present, t) &&
+            MAP_TEST(base->exact, t) == MAP_TEST(cur->exact, t) &&
+            base->value[t] == cur->value[t]) {
+            continue;
+        }
+        MAP_SET(map, t);
+        map_len = (t >> 3) + 1;
+    }
+
+    size_t off = 0;
+    if (buf_size < 5 + map_len) goto error;
+
+    buffer[off++] = DEVPROTO_METRICS_COMPACT_MARKER;
+    buffer[off++] = base ? DEVPROTO_METRICS_COMPACT_DELTA : 0;
+    buffer[off++] = enc->next_id;
+    if (base) buffer[off++] = base->id;
+    buffer[off++] = (uint8_t)map_len;
+    memcpy(buffer + off, map, map_len);
+    off += map_len;
+
+    for (unsigned t = 0; t < map_len * 8; t++) {
+        if (!MAP_TEST(map, t)) continue;
+
+        uint8_t entry[COMPACT_VARINT_MAX];
+        size_t n = 0;
+        compact_varint_put(entry, &n, compact_entry(cur, base, (uint8_t)t));
+
+        if (n > buf_size - off) goto error;
+        memcpy(buffer + off, entry, n);
+        off += n;
+    }
+
+    cur->id = enc->next_id;
+    enc->next_id = enc->next_id == 0xFF ? 1 : (uint8_t)(enc->next_id + 1);
+    return (int)off;
+
+error:
+    /* Nothing was sent, so nothing can be acknowledged */
+    memset(cur, 0, sizeof(*cur));
+    return -1;
+}
+
+/**
+ * Initialize decoder
+ */
+void devproto_metrics_decoder_init(devproto_metrics_decoder_t *dec)
+{
+    if (!dec) return;
+
+    memset(dec, 0, sizeof(*dec));
+}
+
+/**
+ * Parse compact metrics payload
+ */
+int devproto_metrics_parse_compact(devproto_metrics_decoder_t *dec,
+                                   const uint8_t *payload, size_t payload_len,
+                                   devproto_metric_t *metrics, size_t max_metrics)
+{
+    if (!dec || !payload || !metrics || max_metrics == 0) return -1;
+    if (payload_len < 4 || payload[0] != DEVPROTO_METRICS_COMPACT_MARKER) return -1;
+
+    size_t off = 1;
+    uint8_t flags = payload[off++];
+    uint8_t id = payload[off++];
+    const devproto_metrics_snapshot_t *base = NULL;
+    devproto_metrics_snapshot_t *cur = &dec->last;
+
+    if ((flags & (uint8_t)~DEVPROTO_METRICS_COMPACT_DELTA) || id == 0) return -1;
+
+    if (flags & DEVPROTO_METRICS_COMPACT_DELTA) {
+        uint8_t base_id = payload[off++];
+
+        /* First reference to the acknowledged snapshot makes it the baseline */
+        if (base_id != 0 && base_id == dec->acked.id) {
+            dec->base = dec->acked;
+        }
+        if (base_id == 0 || base_id != dec->base.id) goto error;
+        base = &dec->base;
+    }
+
+    if (off >= payload_len) goto error;
+    size_t map_len = payload[off++];
+    if (map_len > sizeof(cur->present) || map_len > payload_len - off) goto error;
+    const uint8_t *map = payload + off;
+    off += map_len;
+
+    if (base) {
+        *cur = *base;
+    } else {
+        memset(cur, 0, sizeof(*cur));
+    }
+
+    for (unsigned t = 0; t < map_len * 8; t++) {
+        if (!MAP_TEST(map, t)) continue;
+
+        uint64_t e;
+        if (compact_varint_get(payload, payload_len, &off, &e) < 0) goto error;
+
+        unsigned exact = (unsigned)(e & 1);
+        uint32_t ref = compact_reference(base, (uint8_t)t, exact);
+        e >>= 1;
+
+        if (exact) {
+            if (e > UINT32_MAX) goto error;
+            cur->value[t] = (uint32_t)e ^ ref;
+            MAP_SET(cur->exact, t);
+        } else {
+            int64_t q = (int64_t)(int32_t)ref + ((int64_t)(e >> 1) ^ -(int64_t)(e & 1));
+            if (q < INT32_MIN || q > INT32_MAX) goto error;
+            cur->value[t] = (uint32_t)(int32_t)q;
+            MAP_CLEAR(cur->exact, t);
+        }
+        MAP_SET(cur->present, t);
+    }
+
+    if (off != payload_len) goto error;
+    cur->id = id;
+
+    size_t count = 0;
+    for (unsigned t = 0; t < 256 && count < max_metrics; t++) {
+        if (!MAP_TEST(cur->present, t)) continue;
+        metrics[count].type = (devproto_metric_type_t)t;
+        metrics[count].value = compact_value(cur, (uint8_t)t);
+        count++;
+    }
+
+    return (int)count;
+
+error:
+    /* Out of sync: the next acknowledgement asks for a keyframe */
+    memset(cur, 0, sizeof(*cur));
+    return -1;
+}
+
+/**
+ * Acknowledge last decoded snapshot
+ */
+uint8_t devproto_metrics_decoder_ack(devproto_metrics_decoder_t *dec)
+{
+    if (!dec || dec->last.id == 0) return 0;
+
+    dec->acked = dec->last;
+    return dec->acked.id;
+}
+
+/**
+ * Build compact metrics request payload
+ */
+int devproto_metrics_request_build(uint8_t ack_id, const uint8_t *types, size_t num_types,
+                                   uint8_t *buffer, size_t buf_size)
+{
+    if (!buffer || (!types && num_types > 0)) return -1;
+
+    if (!types || num_types == 0) {
+        static const uint8_t all_metrics = DEVPROTO_METRIC_ALL;
+        types = &all_metrics;
+        num_types = 1;
+    }
+
+    if (num_types > (size_t)INT32_MAX - 2 || buf_size < num_types + 2) return -1;
+
+    buffer[0] = DEVPROTO_METRICS_COMPACT_MARKER;
+    buffer[1] = ack_id;
+    memcpy(buffer + 2, types, num_types);
+
+    return (int)(num_types + 2);
+}
+
+/**
+ * Parse metrics request payload
+ */
+int devproto_metrics_request_parse(const uint8_t *payload, size_t payload_len,
+                                   uint8_t *ack_id, const uint8_t **types,
+                                   size_t *num_types)
+{
+    if (!ack_id || !types || !num_types) return -1;
+    if (!payload && payload_len > 0) return -1;
+
+    if (!devproto_metrics_is_compact(payload, payload_len)) {
+        *ack_id = 0;
+        *types = payload;
+        *num_types = payload_len;
+        return 0;
+    }
+
+    if (payload_len < 2) return -1;
+
+    *ack_id = payload[1];
+    *types = payload + 2;
+    *num_types = payload_len - 2;
+    return 1;
+}
@@ -0,0 +1,835 @@
+/**
+ * @file net.c
+ * @brief Resolver cache, happy-eyeballs connector, keepalive and backoff
+ *
+ * The resolver keeps a fixed table of entries, so an entry being resolved
+ * never moves while its lookup runs unlocked; waiters sleep on one
+ * condition variable that every finished lookup broadcasts. Non-blocking
+ * lookups run the same blocking lookup on a detached helper thread, which
+ * writes a byte to the lookup's pipe when it is done.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "devproto/net.h"
+
+static int64_t net_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* ---- Resolver cache ---- */
+
+typedef struct {
+    char    *host;                      /* NULL = unused slot */
+    int      port;
+    int      family;
+    int      resolving;                 /* getaddrinfo() running for this entry */
+    int      negative;                  /* Fresh failure, no usable answer */
+    int64_t  expires_ms;                /* Answer or failure fresh until */
+    int64_t  stale_until_ms;            /* Last good answer usable until */
+    int64_t  used_ms;                   /* Last lookup, for eviction */
+    devproto_addr_list_t addrs;         /* Last good answer */
+} resolver_entry_t;
+
+struct devproto_resolver {
+    pthread_mutex_t lock;
+    pthread_cond_t  done;
+    devproto_resolver_config_t cfg;
+    resolver_entry_t *entries;
+    devproto_resolver_stats_t stats;
+    size_t helpers;                     /* Helper threads still running */
+};
+
+/* Non-blocking lookup, shared by its caller and its helper thread */
+struct devproto_resolve {
+    devproto_resolver_t *r;
+    char   *host;
+    int     port;
+    int     family;
+    int     fds[2];                     /* Readable end signals completion */
+    int     refs;                       /* Caller + helper, under r->lock */
+    int     running;
+    int     result;
+    int     error;
+    devproto_addr_list_t addrs;
+};
+
+/**
+ * Initialize default resolver configuration
+ */
+void devproto_resolver_config_init(devproto_resolver_config_t *cfg)
+{
+    if (!cfg) return;
+
+    cfg->ttl_ms = DEVPROTO_RESOLVER_TTL_MS;
+    cfg->negative_ttl_ms = DEVPROTO_RESOLVER_NEGATIVE_MS;
+    cfg->stale_ms = DEVPROTO_RESOLVER_STALE_MS;
+    cfg->max_entries = DEVPROTO_RESOLVER_MAX_ENTRIES;
+}
+
+/**
+ * Create resolver cache
+ */
+devproto_resolver_t *devproto_resolver_create(const devproto_resolver_config_t *cfg)
+{
+    devproto_resolver_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+
+    if (cfg) {
+        r->cfg = *cfg;
+    } else {
+        devproto_resolver_config_init(&r->cfg);
+    }
+    if (r->cfg.max_entries == 0) r->cfg.max_entries = DEVPROTO_RESOLVER_MAX_ENTRIES;
+
+    r->entries = calloc(r->cfg.max_entries, sizeof(*r->entries));
+    if (!r->entries) {
+        free(r);
+        return NULL;
+    }
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->done, NULL);
+    return r;
+}
+
+/**
+ * Destroy resolver cache
+ */
+void devproto_resolver_destroy(devproto_resolver_t *r)
+{
+    if (!r) return;
+
+    /* Cancelled lookups still use the table until their helpers return */
+    pthread_mutex_lock(&r->lock);
+    while (r->helpers > 0) pthread_cond_wait(&r->done, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+
+    for (size_t i = 0; i < r->cfg.max_entries; i++) free(r->entries[i].host);
+    free(r->entries);
+    pthread_cond_destroy(&r->done);
+    pthread_mutex_destroy(&r->lock);
+    free(r);
+}
+
+static devproto_resolver_t *resolver_default;
+static pthread_once_t resolver_default_once = PTHREAD_ONCE_INIT;
+
+static void resolver_default_init(void)
+{
+    resolver_default = devproto_resolver_create(NULL);
+}
+
+/**
+ * Get the process-wide resolver cache
+ */
+devproto_resolver_t *devproto_resolver_default(void)
+{
+    pthread_once(&resolver_default_once, resolver_default_init);
+    return resolver_default;
+}
+
+/**
+ * Run getaddrinfo() and order the answer for happy eyeballs: duplicates
+ * dropped, families alternating from the first one returned
+ */
+static int resolver_query(const char *host, int port, int family, int flags,
+                          devproto_addr_list_t *out)
+{
+    char port_str[16];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = flags;
+
+    if (getaddrinfo(host, port_str, &hints, &result) != 0) return -1;
+
+    const struct addrinfo *by_family[2][DEVPROTO_NET_MAX_ADDRS];
+    size_t counts[2] = { 0, 0 };
+    int first_family = 0;
+
+    for (const struct addrinfo *ai = result; ai; ai = ai->ai_next) {
+        if ((ai->ai_family != AF_INET && ai->ai_family != AF_INET6) ||
+            ai->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        if (!first_family) first_family = ai->ai_family;
+
+        size_t f = ai->ai_family == first_family ? 0 : 1;
+        int dup = 0;
+        for (size_t i = 0; i < counts[f] && !dup; i++) {
+            dup = by_family[f][i]->ai_addrlen == ai->ai_addrlen &&
+                  memcmp(by_family[f][i]->ai_addr, ai->ai_addr, ai->ai_addrlen) == 0;
+        }
+        if (!dup && counts[f] < DEVPROTO_NET_MAX_ADDRS) by_family[f][counts[f]++] = ai;
+    }
+
+    out->count = 0;
+    for (size_t i = 0; out->count < DEVPROTO_NET_MAX_ADDRS && (i < counts[0] || i < counts[1]); i++) {
+        for (size_t f = 0; f < 2 && out->count < DEVPROTO_NET_MAX_ADDRS; f++) {
+            if (i >= counts[f]) continue;
+            memcpy(&out->addrs[out->count], by_family[f][i]->ai_addr, by_family[f][i]->ai_addrlen);
+            out->lens[out->count] = (socklen_t)by_family[f][i]->ai_addrlen;
+            out->count++;
+        }
+    }
+
+    freeaddrinfo(result);
+    return out->count > 0 ? 0 : -1;
+}
+
+/**
+ * Find the entry of a name, or take a free or least recently used idle slot
+ * Returns NULL if every slot is being resolved.
+ */
+static resolver_entry_t *resolver_slot(devproto_resolver_t *r, const char *host, int port,
+                                       int family, int *found)
+{
+    resolver_entry_t *victim = NULL;
+
+    for (size_t i = 0; i < r->cfg.max_entries; i++) {
+        resolver_entry_t *e = &r->entries[i];
+        if (e->host && e->port == port && e->family == family && strcmp(e->host, host) == 0) {
+            *found = 1;
+            return e;
+        }
+        if (e->resolving) continue;
+        if (!victim || !e->host || (victim->host && e->used_ms < victim->used_ms)) victim = e;
+    }
+
+    *found = 0;
+    return victim;
+}
+
+/**
+ * Resolve a host through the cache
+ */
+int devproto_resolver_lookup(devproto_resolver_t *r, const char *host, int port, int family,
+                             devproto_addr_list_t *out)
+{
+    if (!r || !host || !out || port <= 0 || port > 65535 ||
+        (family != AF_UNSPEC && family != AF_INET && family != AF_INET6)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&r->lock);
+
+    resolver_entry_t *e;
+    int found, joined = 0;
+    for (;;) {
+        e = resolver_slot(r, host, port, family, &found);
+        if (!found || !e->resolving) break;
+
+        /* Someone is asking already: wait for their answer */
+        if (!joined) r->stats.joined++;
+        joined = 1;
+        pthread_cond_wait(&r->done, &r->lock);
+    }
+
+    int64_t now = net_now_ms();
+    if (found && now < e->expires_ms) {
+        e->used_ms = now;
+        int ret = 0;
+        if (e->negative) {
+            r->stats.failures++;
+            ret = -1;
+        } else {
+            if (!joined) r->stats.hits++;
+            *out = e->addrs;
+        }
+        pthread_mutex_unlock(&r->lock);
+        if (ret != 0) errno = EHOSTUNREACH;
+        return ret;
+    }
+
+    /* A full table of names in flight: resolve without caching */
+    if (!e) {
+        r->stats.misses++;
+        pthread_mutex_unlock(&r->lock);
+        int ret = resolver_query(host, port, family, 0, out);
+        if (ret != 0) errno = EHOSTUNREACH;
+        return ret;
+    }
+
+    if (!found) {
+        char *copy = strdup(host);
+        if (!copy) {
+            pthread_mutex_unlock(&r->lock);
+            errno = ENOMEM;
+            return -1;
+        }
+        free(e->host);
+        memset(e, 0, sizeof(*e));
+        e->host = copy;
+        e->port = port;
+        e->family = family;
+    }
+    e->resolving = 1;
+    e->used_ms = now;
+    r->stats.misses++;
+    pthread_mutex_unlock(&r->lock);
+
+    devproto_addr_list_t answer;
+    int ret = resolver_query(host, port, family, 0, &answer);
+
+    pthread_mutex_lock(&r->lock);
+    now = net_now_ms();
+    if (ret == 0) {
+        e->addrs = answer;
+        e->negative = 0;
+        e->expires_ms = now + r->cfg.ttl_ms;
+        e->stale_until_ms = e->expires_ms + r->cfg.stale_ms;
+        *out = answer;
+    } else if (e->addrs.count > 0 && now < e->stale_until_ms) {
+        /* Resolver trouble: keep serving the last good answer, ask again later */
+        e->negative = 0;
+        e->expires_ms = now + r->cfg.negative_ttl_ms;
+        r->stats.stale++;
+        *out = e->addrs;
+        ret = 0;
+    } else {
+        e->negative = 1;
+        e->addrs.count = 0;
+        e->expires_ms = now + r->cfg.negative_ttl_ms;
+        r->stats.failures++;
+    }
+    e->resolving = 0;
+    pthread_cond_broadcast(&r->done);
+    pthread_mutex_unlock(&r->lock);
+
+    if (ret != 0) errno = EHOSTUNREACH;
+    return ret;
+}
+
+/**
+ * Forget all cached answers
+ */
+void devproto_resolver_flush(devproto_resolver_t *r)
+{
+    if (!r) return;
+
+    pthread_mutex_lock(&r->lock);
+    for (size_t i = 0; i < r->cfg.max_entries; i++) {
+        resolver_entry_t *e = &r->entries[i];
+        e->expires_ms = 0;
+        e->stale_until_ms = 0;
+        e->negative = 0;
+        e->addrs.count = 0;
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+/**
+ * Get resolver counters
+ */
+void devproto_resolver_get_stats(devproto_resolver_t *r, devproto_resolver_stats_t *stats)
+{
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!r) return;
+
+    pthread_mutex_lock(&r->lock);
+    *stats = r->stats;
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void resolve_free(devproto_resolve_t *q)
+{
+    close(q->fds[0]);
+    close(q->fds[1]);
+    free(q->host);
+    free(q);
+}
+
+/**
+ * Drop one reference to a non-blocking lookup (called under r->lock)
+ * Returns 1 if that was the last one and q must be freed.
+ */
+static int resolve_unref(devproto_resolve_t *q)
+{
+    return --q->refs == 0;
+}
+
+/**
+ * Helper thread of a non-blocking lookup
+ */
+static void *resolve_thread(void *arg)
+{
+    devproto_resolve_t *q = arg;
+    devproto_resolver_t *r = q->r;
+
+    devproto_addr_list_t answer;
+    int ret = devproto_resolver_lookup(r, q->host, q->port, q->family, &answer);
+    int err = errno;
+
+    pthread_mutex_lock(&r->lock);
+    q->result = ret;
+    q->error = err;
+    if (ret == 0) q->addrs = answer;
+    q->running = 0;
+
+    const uint8_t one = 1;
+    ssize_t n = write(q->fds[1], &one, 1);
+    (void)n;
+
+    int last = resolve_unref(q);
+    r->helpers--;
+    pthread_cond_broadcast(&r->done);
+    pthread_mutex_unlock(&r->lock);
+
+    if (last) resolve_free(q);
+    return NULL;
+}
+
+/**
+ * Resolve a host without blocking
+ */
+int devproto_resolver_start(devproto_resolver_t *r, const char *host, int port, int family,
+                            devproto_addr_list_t *out, devproto_resolve_t **pending)
+{
+    if (!r || !host || !out || !pending || port <= 0 || port > 65535 ||
+        (family != AF_UNSPEC && family != AF_INET && family != AF_INET6)) {
+        errno = EINVAL;
+        return -1;
+    }
+    *pending = NULL;
+
+    /* A fresh answer or failure in the cache needs no thread */
+    pthread_mutex_lock(&r->lock);
+    int found;
+    resolver_entry_t *e = resolver_slot(r, host, port, family, &found);
+    int64_t now = net_now_ms();
+    if (found && !e->resolving && now < e->expires_ms) {
+        e->used_ms = now;
+        int ret = 0;
+        if (e->negative) {
+            r->stats.failures++;
+            ret = -1;
+        } else {
+            r->stats.hits++;
+            *out = e->addrs;
+        }
+        pthread_mutex_unlock(&r->lock);
+        if (ret != 0) errno = EHOSTUNREACH;
+        return ret;
+    }
+    pthread_mutex_unlock(&r->lock);
+
+    /* Numeric addresses never reach a name server */
+    if (resolver_query(host, port, family, AI_NUMERICHOST, out) == 0) return 0;
+
+    devproto_resolve_t *q = calloc(1, sizeof(*q));
+    if (!q) {
+        errno = ENOMEM;
+        return -1;
+    }
+    q->host = strdup(host);
+    if (!q->host) {
+        free(q);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (pipe(q->fds) != 0) {
+        free(q->host);
+        free(q);
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(q->fds[i], F_SETFL, fcntl(q->fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(q->fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    q->r = r;
+    q->port = port;
+    q->family = family;
+    q->refs = 2;
+    q->running = 1;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    pthread_mutex_lock(&r->lock);
+    r->helpers++;
+    pthread_t thread;
+    int rc = pthread_create(&thread, &attr, resolve_thread, q);
+    if (rc != 0) r->helpers--;
+    pthread_mutex_unlock(&r->lock);
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0) {
+        resolve_free(q);
+        errno = rc;
+        return -1;
+    }
+
+    *pending = q;
+    return 1;
+}
+
+/**
+ * Descriptor that becomes readable when the lookup has finished
+ */
+int devproto_resolve_fd(const devproto_resolve_t *q)
+{
+    return q ? q->fds[0] : -1;
+}
+
+/**
+ * Collect a non-blocking lookup
+ */
+int devproto_resolve_finish(devproto_resolve_t *q, devproto_addr_list_t *out)
+{
+    if (!q || !out) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    devproto_resolver_t *r = q->r;
+    pthread_mutex_lock(&r->lock);
+    if (q->running) {
+        pthread_mutex_unlock(&r->lock);
+        return 1;
+    }
+    int ret = q->result;
+    int err = q->error;
+    if (ret == 0) *out = q->addrs;
+    int last = resolve_unref(q);
+    pthread_mutex_unlock(&r->lock);
+
+    if (last) resolve_free(q);
+    if (ret != 0) errno = err;
+    return ret;
+}
+
+/**
+ * Abandon a non-blocking lookup
+ */
+void devproto_resolve_cancel(devproto_resolve_t *q)
+{
+    if (!q) return;
+
+    devproto_resolver_t *r = q->r;
+    pthread_mutex_lock(&r->lock);
+    int last = resolve_unref(q);
+    pthread_mutex_unlock(&r->lock);
+
+    if (last) resolve_free(q);
+}
+
+/* ---- Happy-eyeballs connector ---- */
+
+/**
+ * Start a non-blocking connect to address i
+ * Returns 1 in progress, 0 connected (*fd set), -1 failed.
+ */
+static int connector_begin(devproto_connector_t *c, size_t i, int *fd)
+{
+    const struct sockaddr *addr = (const struct sockaddr *)&c->addrs.addrs[i];
+
+    int s = socket(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    if (s < 0) {
+        c->last_error = errno;
+        return -1;
+    }
+
+    int flags = fcntl(s, F_GETFL, 0);
+    if (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) != 0 ||
+        fcntl(s, F_SETFD, FD_CLOEXEC) != 0) {
+        c->last_error = errno;
+        close(s);
+        return -1;
+    }
+
+    if (connect(s, addr, c->addrs.lens[i]) == 0) {
+        *fd = s;
+        return 0;
+    }
+    if (errno == EINPROGRESS) {
+        c->fds[c->inflight++] = s;
+        return 1;
+    }
+
+    c->last_error = errno;
+    close(s);
+    return -1;
+}
+
+/**
+ * Start connecting
+ */
+int devproto_connector_start(devproto_connector_t *c, const devproto_addr_list_t *addrs,
+                             int attempt_delay_ms, int timeout_ms)
+{
+    if (!c || !addrs || addrs->count == 0 || addrs->count > DEVPROTO_NET_MAX_ADDRS) return -1;
+
+    memset(c, 0, sizeof(*c));
+    c->addrs = *addrs;
+    c->attempt_delay_ms = attempt_delay_ms > 0 ? attempt_delay_ms : DEVPROTO_NET_ATTEMPT_DELAY_MS;
+    c->deadline_ms = timeout_ms >= 0 ? net_now_ms() + timeout_ms : 0;
+    return 0;
+}
+
+/**
+ * Keep attempt i as the winner and close the others
+ */
+static int connector_win(devproto_connector_t *c, size_t i, int *fd)
+{
+    *fd = c->fds[i];
+    for (size_t k = 0; k < c->inflight; k++) {
+        if (k != i) close(c->fds[k]);
+    }
+    c->inflight = 0;
+    c->next = c->addrs.count;
+    return 0;
+}
+
+/**
+ * Advance the attempts
+ */
+int devproto_connector_step(devproto_connector_t *c, int *fd)
+{
+    if (!c || !fd) return -1;
+
+    /* Collect finished attempts */
+    if (c->inflight > 0) {
+        struct pollfd pfds[DEVPROTO_NET_MAX_ADDRS];
+        for (size_t i = 0; i < c->inflight; i++) {
+            pfds[i].fd = c->fds[i];
+            pfds[i].events = POLLOUT;
+            pfds[i].revents = 0;
+        }
+
+        if (poll(pfds, (nfds_t)c->inflight, 0) > 0) {
+            for (size_t i = c->inflight; i-- > 0;) {
+                if (!pfds[i].revents) continue;
+
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (getsockopt(c->fds[i], SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+                if (err == 0 && !(pfds[i].revents & (POLLERR | POLLHUP | POLLNVAL))) {
+                    return connector_win(c, i, fd);
+                }
+
+                /* Failed: drop it and let the next address start now */
+                c->last_error = err ? err : ECONNREFUSED;
+                close(c->fds[i]);
+                memmove(&c->fds[i], &c->fds[i + 1], (c->inflight - i - 1) * sizeof(c->fds[0]));
+                c->inflight--;
+                c->next_attempt_ms = 0;
+            }
+        }
+    }
+
+    int64_t now = net_now_ms();
+    if (c->deadline_ms && now >= c->deadline_ms) {
+        devproto_connector_cancel(c);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    /* Start the next address when the newest attempt's head start is over */
+    while (c->next < c->addrs.count && (c->inflight == 0 || now >= c->next_attempt_ms)) {
+        int ret = connector_begin(c, c->next++, fd);
+        if (ret == 0) {
+            for (size_t k = 0; k < c->inflight; k++) close(c->fds[k]);
+            c->inflight = 0;
+            return 0;
+        }
+        if (ret > 0) c->next_attempt_ms = now + c->attempt_delay_ms;
+    }
+
+    if (c->inflight == 0) {
+        errno = c->last_error ? c->last_error : ECONNREFUSED;
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * Socket of the newest attempt
+ */
+int devproto_connector_fd(const devproto_connector_t *c)
+{
+    return c && c->inflight > 0 ? c->fds[c->inflight - 1] : -1;
+}
+
+/**
+ * Time until the connector has something to do without a completion
+ */
+int devproto_connector_wait_ms(const devproto_connector_t *c)
+{
+    if (!c) return -1;
+
+    int64_t now = net_now_ms();
+    int64_t wake = -1;
+    if (c->next < c->addrs.count) wake = c->inflight == 0 ? now : c->next_attempt_ms;
+    if (c->deadline_ms && (wake < 0 || c->deadline_ms < wake)) wake = c->deadline_ms;
+
+    if (wake < 0) return -1;
+    return wake > now ? (int)(wake - now) : 0;
+}
+
+/**
+ * Abandon all attempts
+ */
+void devproto_connector_cancel(devproto_connector_t *c)
+{
+    if (!c) return;
+
+    for (size_t i = 0; i < c->inflight; i++) close(c->fds[i]);
+    c->inflight = 0;
+    c->next = c->addrs.count;
+}
+
+/**
+ * Blocking happy-eyeballs connect
+ */
+int devproto_connect(const devproto_addr_list_t *addrs, int attempt_delay_ms, int timeout_ms)
+{
+    devproto_connector_t c;
+    if (devproto_connector_start(&c, addrs, attempt_delay_ms, timeout_ms) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (;;) {
+        int fd;
+        int ret = devproto_connector_step(&c, &fd);
+        if (ret == 0) return fd;
+        if (ret < 0) return -1;
+
+        /* Sleep until an attempt completes or the next one is due */
+        struct pollfd pfds[DEVPROTO_NET_MAX_ADDRS];
+        for (size_t i = 0; i < c.inflight; i++) {
+            pfds[i].fd = c.fds[i];
+            pfds[i].events = POLLOUT;
+        }
+        poll(pfds, (nfds_t)c.inflight, devproto_connector_wait_ms(&c));
+    }
+}
+
+/* ---- Keepalive ---- */
+
+/**
+ * Initialize default keepalive settings
+ */
+void devproto_keepalive_init(devproto_keepalive_t *ka)
+{
+    if (!ka) return;
+
+    ka->idle_ms = DEVPROTO_KEEPALIVE_IDLE_MS;
+    ka->interval_ms = DEVPROTO_KEEPALIVE_INTERVAL_MS;
+    ka->count = DEVPROTO_KEEPALIVE_COUNT;
+    ka->user_timeout_ms = DEVPROTO_KEEPALIVE_USER_MS;
+}
+
+/**
+ * Apply keepalive settings
+ */
+int devproto_net_set_keepalive(int fd, const devproto_keepalive_t *ka)
+{
+    if (fd < 0 || !ka) return -1;
+
+    int on = ka->idle_ms > 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) != 0) return -1;
+
+    int ret = 0;
+    if (on) {
+        int idle = (ka->idle_ms + 999) / 1000;
+        int interval = ka->interval_ms > 0 ? (ka->interval_ms + 999) / 1000 : 1;
+        int count = ka->count > 0 ? ka->count : 1;
+        (void)interval;
+        (void)count;
+#if defined(TCP_KEEPIDLE)
+        if (setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) != 0) ret = -1;
+#elif defined(TCP_KEEPALIVE)
+        if (setsockopt(fd, IPPROTO_TCP, TCP_KEEPALIVE, &idle, sizeof(idle)) != 0) ret = -1;
+#else
+        (void)idle;
+#endif
+#if defined(TCP_KEEPINTVL)
+        if (setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) != 0) ret = -1;
+#endif
+#if defined(TCP_KEEPCNT)
+        if (setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count)) != 0) ret = -1;
+#endif
+    }
+
+#if defined(TCP_USER_TIMEOUT)
+    if (ka->user_timeout_ms > 0) {
+        unsigned int user = (unsigned int)ka->user_timeout_ms;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &user, sizeof(user)) != 0) ret = -1;
+    }
+#endif
+
+    return ret;
+}
+
+/* ---- Reconnect backoff ---- */
+
+/**
+ * Initialize backoff
+ */
+void devproto_backoff_init(devproto_backoff_t *b, int base_ms, int max_ms)
+{
+    if (!b) return;
+
+    b->base_ms = base_ms > 0 ? base_ms : DEVPROTO_BACKOFF_BASE_MS;
+    b->max_ms = max_ms > 0 ? max_ms : DEVPROTO_BACKOFF_MAX_MS;
+    if (b->max_ms < b->base_ms) b->max_ms = b->base_ms;
+    b->attempt = 0;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    b->seed = (uint32_t)ts.tv_nsec ^ (uint32_t)(uintptr_t)b ^ ((uint32_t)getpid() << 16);
+    if (b->seed == 0) b->seed = 0x9E3779B9u;
+}
+
+/**
+ * Next jittered delay
+ */
+int devproto_backoff_next(devproto_backoff_t *b)
+{
+    if (!b) return DEVPROTO_BACKOFF_BASE_MS;
+
+    int64_t ceiling = b->base_ms;
+    for (unsigned i = 0; i < b->attempt && ceiling < b->max_ms; i++) ceiling *= 2;
+    if (ceiling > b->max_ms) ceiling = b->max_ms;
+    b->attempt++;
+
+    uint32_t x = b->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    b->seed = x;
+
+    int64_t floor = b->base_ms / 2;
+    return (int)(floor + (int64_t)(x % (uint32_t)(ceiling - floor + 1)));
+}
+
+/**
+ * Start over from the base delay
+ */
+void devproto_backoff_reset(devproto_backoff_t *b)
+{
+    if (b) b->attempt = 0;
+}
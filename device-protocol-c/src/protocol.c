@@ -102,6 +102,63 @@ void devproto_create_command(devproto_message_t *msg, uint8_t sequence,
     msg->payload_len = (uint16_t)params_len;
 }
 
+/**
+ * Fill a HELLO / HELLO_ACK message
+ */
+static void create_hello_common(devproto_message_t *msg, uint8_t msg_type, uint8_t sequence,
+                                uint8_t *buffer, uint32_t caps)
+{
+    if (!msg || !buffer) return;
+
+    buffer[0] = DEVPROTO_VERSION;
+    buffer[1] = (caps >> 24) & 0xFF;
+    buffer[2] = (caps >> 16) & 0xFF;
+    buffer[3] = (caps >> 8) & 0xFF;
+    buffer[4] = caps & 0xFF;
+
+    msg->msg_type = msg_type;
+    msg->sequence = sequence;
+    msg->payload = buffer;
+    msg->payload_len = DEVPROTO_HELLO_SIZE;
+}
+
+/**
+ * Create a HELLO request
+ */
+void devproto_create_hello(devproto_message_t *msg, uint8_t sequence,
+                           uint8_t *buffer, uint32_t caps)
+{
+    create_hello_common(msg, DEVPROTO_MSG_HELLO, sequence, buffer, caps);
+}
+
+/**
+ * Create a HELLO_ACK response
+ */
+void devproto_create_hello_ack(devproto_message_t *msg, uint8_t sequence,
+                               uint8_t *buffer, uint32_t caps)
+{
+    create_hello_common(msg, DEVPROTO_MSG_HELLO_ACK, sequence, buffer, caps);
+}
+
+/**
+ * Parse a HELLO / HELLO_ACK payload
+ */
+int devproto_parse_hello(const devproto_message_t *msg, uint8_t *version, uint32_t *caps)
+{
+    if (!msg || !caps) return -1;
+    if (msg->msg_type != DEVPROTO_MSG_HELLO && msg->msg_type != DEVPROTO_MSG_HELLO_ACK) return -1;
+
+    /* Longer payloads are accepted so later versions can append fields */
+    if (!msg->payload || msg->payload_len < DEVPROTO_HELLO_SIZE) return -1;
+
+    if (version) *version = msg->payload[0];
+    *caps = ((uint32_t)msg->payload[1] << 24) |
+            ((uint32_t)msg->payload[2] << 16) |
+            ((uint32_t)msg->payload[3] << 8) |
+            ((uint32_t)msg->payload[4]);
+    return 0;
+}
+
 /**
  * Serialize a message to wire format
  */
@@ -0,0 +1,853 @@
+/**
+ * @file reactor.c
+ * @brief epoll/kqueue event loop for many transports
+ *
+ * Connections are looked up by fd in a flat table. Removal during dispatch
+ * only marks the connection; it is freed once the current run_once() has
+ * finished with its event batch.
+ *
+ * Connections still opening (devproto_reactor_connect) are stepped on fd
+ * readiness instead of read, and swept on a coarse tick so a silent peer
+ * still hits the transport's handshake timeout.
+ *
+ * devproto_reactor_wake() writes to a self-pipe watched through a sentinel
+ * connection that is not in the table.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "devproto/reactor.h"
+#include "devproto/frame_pool.h"
+#include "devproto/tls.h"
+#include "devproto/stats.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define REACTOR_EPOLL 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \\
+      defined(__OpenBSD__) || defined(__DragonFly__)
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#define REACTOR_KQUEUE 1
+#else
+#error "devproto reactor needs epoll or kqueue"
+#endif
+
+/* Events taken from the kernel per wait */
+#define REACTOR_MAX_EVENTS      256
+
+/* recv() calls per connection per wakeup before yielding to others */
+#define REACTOR_READ_BUDGET     8
+
+/* Messages parsed per slab fill */
+#define REACTOR_BATCH           32
+
+/* Scratch slab shared by all connections (payloads live for one callback) */
+#define REACTOR_SLAB_SIZE       (64 * 1024)
+
+/**
+ * Per-transport registration
+ */
+typedef struct reactor_conn {
+    devproto_transport_t *t;
+    int fd;
+    devproto_frame_pooled_parser_t *parser;
+    devproto_reactor_message_fn on_message;
+    devproto_reactor_close_fn on_close;
+    devproto_reactor_open_fn on_open;
+    void *user;
+
+    int connecting;                     /* Open still in progress */
+    int want_write;                     /* Watching for writability */
+    int again;                          /* On the again list */
+    int removed;                        /* Unregistered, free after dispatch */
+    struct reactor_conn *next_again;    /* Again list link */
+    struct reactor_conn *next_dead;     /* Dead list link */
+    struct reactor_conn *next_connecting; /* Connecting list link */
+} reactor_conn_t;
+
+struct devproto_reactor {
+    int poll_fd;                        /* epoll or kqueue descriptor */
+
+    reactor_conn_t **by_fd;             /* Connection table indexed by fd */
+    size_t by_fd_cap;
+    size_t count;
+
+    reactor_conn_t *again;              /* Read budget exhausted, retry soon */
+    reactor_conn_t *dead;               /* Removed, awaiting free */
+    reactor_conn_t *connecting;         /* Opens in progress */
+    size_t connecting_count;
+    int64_t last_sweep_ms;
+
+    devproto_frame_pool_t *pool;        /* Large payloads of compact parsers */
+    int own_pool;
+
+    int wake_fd[2];                     /* Self-pipe of devproto_reactor_wake() */
+    atomic_int wake_pending;
+    reactor_conn_t wake_conn;           /* Sentinel watching wake_fd[0] */
+
+    devproto_frame_slab_t slab;
+    uint8_t rx[16384];
+    uint8_t slab_storage[REACTOR_SLAB_SIZE];
+};
+
+/* ---- Backend ---------------------------------------------------------- */
+
+#ifdef REACTOR_EPOLL
+
+static int backend_create(void)
+{
+    return epoll_create1(EPOLL_CLOEXEC);
+}
+
+static int backend_set(devproto_reactor_t *r, reactor_conn_t *c, int op)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP | (c->want_write ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    return epoll_ctl(r->poll_fd, op, c->fd, &ev);
+}
+
+static int backend_add(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    return backend_set(r, c, EPOLL_CTL_ADD);
+}
+
+static int backend_update(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    return backend_set(r, c, EPOLL_CTL_MOD);
+}
+
+static void backend_del(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    struct epoll_event ev;
+    epoll_ctl(r->poll_fd, EPOLL_CTL_DEL, c->fd, &ev);
+}
+
+typedef struct epoll_event backend_event_t;
+
+static int backend_wait(devproto_reactor_t *r, backend_event_t *events, int timeout_ms)
+{
+    int n;
+    do {
+        n = epoll_wait(r->poll_fd, events, REACTOR_MAX_EVENTS, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+static reactor_conn_t *backend_conn(const backend_event_t *ev)
+{
+    return ev->data.ptr;
+}
+
+static int backend_readable(const backend_event_t *ev)
+{
+    return (ev->events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+}
+
+static int backend_writable(const backend_event_t *ev)
+{
+    return (ev->events & EPOLLOUT) != 0;
+}
+
+#else /* REACTOR_KQUEUE */
+
+static int backend_create(void)
+{
+    return kqueue();
+}
+
+static int backend_add(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    struct kevent ev[2];
+    EV_SET(&ev[0], c->fd, EVFILT_READ, EV_ADD, 0, 0, c);
+    EV_SET(&ev[1], c->fd, EVFILT_WRITE, EV_ADD | (c->want_write ? 0 : EV_DISABLE), 0, 0, c);
+    return kevent(r->poll_fd, ev, 2, NULL, 0, NULL);
+}
+
+static int backend_update(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    struct kevent ev;
+    EV_SET(&ev, c->fd, EVFILT_WRITE, c->want_write ? EV_ENABLE : EV_DISABLE, 0, 0, c);
+    return kevent(r->poll_fd, &ev, 1, NULL, 0, NULL);
+}
+
+static void backend_del(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    struct kevent ev[2];
+    EV_SET(&ev[0], c->fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    EV_SET(&ev[1], c->fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(r->poll_fd, ev, 2, NULL, 0, NULL);
+}
+
+typedef struct kevent backend_event_t;
+
+static int backend_wait(devproto_reactor_t *r, backend_event_t *events, int timeout_ms)
+{
+    struct timespec ts, *tsp = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+
+    int n;
+    do {
+        n = kevent(r->poll_fd, NULL, 0, events, REACTOR_MAX_EVENTS, tsp);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+static reactor_conn_t *backend_conn(const backend_event_t *ev)
+{
+    return ev->udata;
+}
+
+static int backend_readable(const backend_event_t *ev)
+{
+    return ev->filter == EVFILT_READ;
+}
+
+static int backend_writable(const backend_event_t *ev)
+{
+    return ev->filter == EVFILT_WRITE;
+}
+
+#endif
+
+/* ---- Connection table ------------------------------------------------- */
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+static int64_t reactor_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Find registration of a transport
+ */
+static reactor_conn_t *reactor_find(const devproto_reactor_t *r,
+                                    const devproto_transport_t *t)
+{
+    if (t->fd >= 0 && (size_t)t->fd < r->by_fd_cap) {
+        reactor_conn_t *c = r->by_fd[t->fd];
+        if (c && c->t == t) return c;
+    }
+
+    /* fd already changed (closed transport): fall back to a scan */
+    for (size_t i = 0; i < r->by_fd_cap; i++) {
+        if (r->by_fd[i] && r->by_fd[i]->t == t) return r->by_fd[i];
+    }
+    return NULL;
+}
+
+/**
+ * Make room for fd in the connection table
+ */
+static int reactor_reserve(devproto_reactor_t *r, int fd)
+{
+    if ((size_t)fd < r->by_fd_cap) return 0;
+
+    size_t cap = r->by_fd_cap ? r->by_fd_cap : 64;
+    while (cap <= (size_t)fd) cap *= 2;
+
+    reactor_conn_t **table = realloc(r->by_fd, cap * sizeof(*table));
+    if (!table) return -1;
+
+    memset(table + r->by_fd_cap, 0, (cap - r->by_fd_cap) * sizeof(*table));
+    r->by_fd = table;
+    r->by_fd_cap = cap;
+    return 0;
+}
+
+/**
+ * Unregister; memory is released by reactor_reap()
+ */
+static void reactor_unlink(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    backend_del(r, c);
+    r->by_fd[c->fd] = NULL;
+    r->count--;
+    if (c->connecting) {
+        c->connecting = 0;
+        r->connecting_count--;
+    }
+
+    c->removed = 1;
+    c->next_dead = r->dead;
+    r->dead = c;
+}
+
+/**
+ * Free removed connections and drop them from the again/connecting lists
+ */
+static void reactor_reap(devproto_reactor_t *r)
+{
+    reactor_conn_t **link = &r->again;
+    while (*link) {
+        if ((*link)->removed) {
+            *link = (*link)->next_again;
+        } else {
+            link = &(*link)->next_again;
+        }
+    }
+
+    link = &r->connecting;
+    while (*link) {
+        if ((*link)->removed || !(*link)->connecting) {
+            *link = (*link)->next_connecting;
+        } else {
+            link = &(*link)->next_connecting;
+        }
+    }
+
+    while (r->dead) {
+        reactor_conn_t *c = r->dead;
+        r->dead = c->next_dead;
+        devproto_frame_pooled_destroy(c->parser);
+        free(c);
+    }
+}
+
+/* ---- Dispatch --------------------------------------------------------- */
+
+/**
+ * Report a failed connection and unregister it
+ */
+static void reactor_fail(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    devproto_transport_t *t = c->t;
+    devproto_reactor_close_fn on_close = c->on_close;
+    void *user = c->user;
+
+    reactor_unlink(r, c);
+    if (on_close) on_close(r, t, user);
+}
+
+/**
+ * Parse received bytes and deliver complete messages
+ */
+static int reactor_feed(devproto_reactor_t *r, reactor_conn_t *c,
+                        const uint8_t *data, size_t len)
+{
+    int delivered = 0;
+    size_t off = 0;
+
+    while (off < len && !c->removed) {
+        devproto_message_t msgs[REACTOR_BATCH];
+        size_t consumed = 0;
+
+        /* Follow the link's negotiated limit and compression */
+        devproto_frame_pooled_set_max_payload(c->parser,
+                                              devproto_transport_max_payload(c->t));
+        devproto_frame_pooled_set_decompress(c->parser, c->t->compress != NULL);
+
+        devproto_stats_t *st = c->t->stats;
+        devproto_frame_stats_t before;
+        devproto_frame_pooled_get_stats(c->parser, &before);
+        uint64_t start = st ? devproto_stats_cycles() : 0;
+
+        devproto_frame_slab_reset(&r->slab);
+        int n = devproto_frame_pooled_parse_slab(c->parser, data + off, len - off,
+                                                 &r->slab, msgs, REACTOR_BATCH, &consumed);
+        if (n < 0) break;
+        if (st) {
+            devproto_frame_stats_t after;
+            devproto_frame_pooled_get_stats(c->parser, &after);
+            devproto_stats_record_parse(st, (uint32_t)n, devproto_stats_cycles() - start,
+                                        after.crc_errors - before.crc_errors,
+                                        after.sync_errors - before.sync_errors);
+        }
+        off += consumed;
+
+        for (int i = 0; i < n && !c->removed; i++) {
+            c->on_message(r, c->t, &msgs[i], c->user);
+            delivered++;
+        }
+
+        if (n == 0 && consumed == 0) break;
+    }
+
+    return delivered;
+}
+
+/**
+ * Read what the transport has, within the per-wakeup budget
+ */
+static int reactor_read(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    int delivered = 0;
+
+    for (int round = 0; round < REACTOR_READ_BUDGET; round++) {
+        int n = devproto_transport_recv(c->t, r->rx, sizeof(r->rx), 0);
+        if (n < 0) {
+            reactor_fail(r, c);
+            return delivered;
+        }
+        if (n == 0) return delivered;
+
+        delivered += reactor_feed(r, c, r->rx, (size_t)n);
+        if (c->removed) return delivered;
+
+        /* Short read on a plain socket/tty means the kernel buffer is empty;
+         * TLS may still hold decrypted records, so keep reading */
+        if ((size_t)n < sizeof(r->rx) && c->t->type != DEVPROTO_TRANSPORT_TLS) {
+            return delivered;
+        }
+    }
+
+    /* More data likely pending: revisit without blocking next time */
+    if (!c->again) {
+        c->again = 1;
+        c->next_again = r->again;
+        r->again = c;
+    }
+    return delivered;
+}
+
+/**
+ * Drain queued output; stop watching writability once empty
+ */
+static void reactor_write(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    int left = devproto_transport_drain(c->t, 0);
+    if (left < 0) {
+        reactor_fail(r, c);
+        return;
+    }
+
+    if (left == 0 && c->want_write) {
+        c->want_write = 0;
+        backend_update(r, c);
+    }
+}
+
+/**
+ * Follow an fd change during open (next address tried after a failed connect)
+ */
+static int reactor_rebind(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    int fd = c->t->fd;
+    if (fd == c->fd) return 0;
+
+    backend_del(r, c);
+    r->by_fd[c->fd] = NULL;
+
+    if (fd < 0 || reactor_reserve(r, fd) != 0 || r->by_fd[fd]) return -1;
+    c->fd = fd;
+    r->by_fd[fd] = c;
+    return backend_add(r, c);
+}
+
+/**
+ * Advance an open in progress; switch to message delivery when it completes
+ */
+static void reactor_open_step(devproto_reactor_t *r, reactor_conn_t *c)
+{
+    int ret = devproto_transport_open_step(c->t);
+    if (ret < 0) {
+        reactor_fail(r, c);
+        return;
+    }
+
+    int want_write = (ret == DEVPROTO_TRANSPORT_WANT_WRITE);
+    if (ret == 0) want_write = devproto_transport_pending(c->t) > 0;
+
+    if (c->t->fd != c->fd) {
+        c->want_write = want_write;
+        if (reactor_rebind(r, c) != 0) {
+            /* Re-own a table slot so unlink can clear it */
+            r->by_fd[c->fd] = c;
+            reactor_fail(r, c);
+            return;
+        }
+    } else if (want_write != c->want_write) {
+        c->want_write = want_write;
+        backend_update(r, c);
+    }
+
+    if (ret > 0) return;
+
+    c->connecting = 0;
+    r->connecting_count--;
+    if (c->on_open) c->on_open(r, c->t, c->user);
+}
+
+/**
+ * Step every pending open (timeouts only advance when the transport is called)
+ */
+static void reactor_sweep(devproto_reactor_t *r)
+{
+    int64_t now = reactor_now_ms();
+    if (now - r->last_sweep_ms < DEVPROTO_REACTOR_CONNECT_TICK_MS) return;
+    r->last_sweep_ms = now;
+
+    for (reactor_conn_t *c = r->connecting; c; c = c->next_connecting) {
+        if (c->connecting && !c->removed) reactor_open_step(r, c);
+    }
+}
+
+/* ---- Public API ------------------------------------------------------- */
+
+/**
+ * Create a non-blocking, close-on-exec pipe
+ */
+static int reactor_pipe(int fds[2])
+{
+    if (pipe(fds) != 0) return -1;
+
+    for (int i = 0; i < 2; i++) {
+        int flags = fcntl(fds[i], F_GETFL, 0);
+        if (flags < 0 || fcntl(fds[i], F_SETFL, flags | O_NONBLOCK) != 0 ||
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC) != 0) {
+            close(fds[0]);
+            close(fds[1]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Create reactor with a shared pool
+ */
+devproto_reactor_t *devproto_reactor_create_shared(devproto_frame_pool_t *pool)
+{
+    devproto_reactor_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+
+    r->wake_fd[0] = r->wake_fd[1] = -1;
+    r->poll_fd = backend_create();
+    if (r->poll_fd < 0) goto error;
+
+    if (pool) {
+        r->pool = pool;
+    } else {
+        r->pool = devproto_frame_pool_create(0);
+        if (!r->pool) goto error;
+        r->own_pool = 1;
+    }
+
+    if (reactor_pipe(r->wake_fd) != 0) goto error;
+    r->wake_conn.fd = r->wake_fd[0];
+    if (backend_add(r, &r->wake_conn) != 0) goto error;
+    atomic_init(&r->wake_pending, 0);
+
+    devproto_frame_slab_init(&r->slab, r->slab_storage, sizeof(r->slab_storage));
+    return r;
+
+error:
+    if (r->wake_fd[0] >= 0) {
+        close(r->wake_fd[0]);
+        close(r->wake_fd[1]);
+    }
+    if (r->poll_fd >= 0) close(r->poll_fd);
+    if (r->own_pool) devproto_frame_pool_destroy(r->pool);
+    free(r);
+    return NULL;
+}
+
+/**
+ * Create reactor
+ */
+devproto_reactor_t *devproto_reactor_create(void)
+{
+    return devproto_reactor_create_shared(NULL);
+}
+
+/**
+ * Destroy reactor
+ */
+void devproto_reactor_destroy(devproto_reactor_t *r)
+{
+    if (!r) return;
+
+    for (size_t i = 0; i < r->by_fd_cap; i++) {
+        if (r->by_fd[i]) reactor_unlink(r, r->by_fd[i]);
+    }
+    reactor_reap(r);
+
+    close(r->poll_fd);
+    close(r->wake_fd[0]);
+    close(r->wake_fd[1]);
+    if (r->own_pool) devproto_frame_pool_destroy(r->pool);
+    free(r->by_fd);
+    free(r);
+}
+
+/**
+ * Allocate and register a connection for t->fd
+ */
+static reactor_conn_t *reactor_register(devproto_reactor_t *r, devproto_transport_t *t,
+                                        devproto_frame_pooled_parser_t *parser,
+                                        devproto_reactor_message_fn on_message,
+                                        devproto_reactor_close_fn on_close, void *user,
+                                        int want_write)
+{
+    if (reactor_reserve(r, t->fd) != 0 || r->by_fd[t->fd]) return NULL;
+
+    reactor_conn_t *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+
+    /* A caller-supplied parser is only owned once registration succeeds */
+    c->parser = parser ? parser : devproto_frame_pooled_create(r->pool);
+    if (!c->parser) {
+        free(c);
+        return NULL;
+    }
+
+    c->t = t;
+    c->fd = t->fd;
+    c->on_message = on_message;
+    c->on_close = on_close;
+    c->user = user;
+    c->want_write = want_write;
+
+    if (backend_add(r, c) != 0) {
+        if (!parser) devproto_frame_pooled_destroy(c->parser);
+        free(c);
+        return NULL;
+    }
+
+    r->by_fd[c->fd] = c;
+    r->count++;
+    return c;
+}
+
+/**
+ * Register transport
+ */
+int devproto_reactor_add(devproto_reactor_t *r, devproto_transport_t *t,
+                         devproto_reactor_message_fn on_message,
+                         devproto_reactor_close_fn on_close, void *user)
+{
+    if (!r || !t || !on_message || !devproto_transport_is_open(t) || t->fd < 0) {
+        return -1;
+    }
+
+    return reactor_register(r, t, NULL, on_message, on_close, user,
+                            devproto_transport_pending(t) > 0) ? 0 : -1;
+}
+
+/**
+ * Register transport with an existing parser
+ */
+int devproto_reactor_attach(devproto_reactor_t *r, devproto_transport_t *t,
+                            devproto_frame_pooled_parser_t *parser,
+                            devproto_reactor_message_fn on_message,
+                            devproto_reactor_close_fn on_close, void *user)
+{
+    if (!r || !t || !parser || !on_message || !devproto_transport_is_open(t) || t->fd < 0) {
+        return -1;
+    }
+
+    reactor_conn_t *c = reactor_register(r, t, parser, on_message, on_close, user,
+                                         devproto_transport_pending(t) > 0);
+    if (!c) return -1;
+
+    /* Bytes already buffered in the transport (TLS records) raise no event */
+    c->again = 1;
+    c->next_again = r->again;
+    r->again = c;
+    return 0;
+}
+
+/**
+ * Start a non-blocking open and register transport
+ */
+int devproto_reactor_connect(devproto_reactor_t *r, devproto_transport_t *t,
+                             devproto_reactor_open_fn on_open,
+                             devproto_reactor_message_fn on_message,
+                             devproto_reactor_close_fn on_close, void *user)
+{
+    if (!r || !t || !on_message) return -1;
+
+    int ret = devproto_transport_open_step(t);
+    if (ret < 0 || t->fd < 0) return -1;
+
+    if (ret == 0) {
+        if (reactor_register(r, t, NULL, on_message, on_close, user,
+                             devproto_transport_pending(t) > 0) == NULL) {
+            return -1;
+        }
+        if (on_open) on_open(r, t, user);
+        return 0;
+    }
+
+    reactor_conn_t *c = reactor_register(r, t, NULL, on_message, on_close, user,
+                                         ret == DEVPROTO_TRANSPORT_WANT_WRITE);
+    if (!c) return -1;
+
+    c->on_open = on_open;
+    c->connecting = 1;
+    c->next_connecting = r->connecting;
+    r->connecting = c;
+    if (r->connecting_count++ == 0) r->last_sweep_ms = reactor_now_ms();
+    return 0;
+}
+
+/**
+ * Unregister transport
+ */
+int devproto_reactor_remove(devproto_reactor_t *r, devproto_transport_t *t)
+{
+    if (!r || !t) return -1;
+
+    reactor_conn_t *c = reactor_find(r, t);
+    if (!c) return -1;
+
+    reactor_unlink(r, c);
+    return 0;
+}
+
+/**
+ * Unregister transport, keeping its parser
+ */
+devproto_frame_pooled_parser_t *devproto_reactor_detach(devproto_reactor_t *r,
+                                                        devproto_transport_t *t)
+{
+    if (!r || !t) return NULL;
+
+    reactor_conn_t *c = reactor_find(r, t);
+    if (!c || c->connecting) return NULL;
+
+    devproto_frame_pooled_parser_t *parser = c->parser;
+    c->parser = NULL;
+    reactor_unlink(r, c);
+    return parser;
+}
+
+/**
+ * Interrupt run_once() from another thread
+ */
+void devproto_reactor_wake(devproto_reactor_t *r)
+{
+    if (!r) return;
+
+    /* One byte in the pipe is enough however many wakes are pending */
+    if (atomic_exchange(&r->wake_pending, 1) == 0) {
+        ssize_t n = write(r->wake_fd[1], "", 1);
+        (void)n;
+    }
+}
+
+/**
+ * Consume a wake
+ */
+static void reactor_woken(devproto_reactor_t *r)
+{
+    uint8_t buf[64];
+
+    atomic_store(&r->wake_pending, 0);
+    while (read(r->wake_fd[0], buf, sizeof(buf)) > 0) {
+    }
+}
+
+/**
+ * Watch transport for writability until its queue is empty
+ */
+int devproto_reactor_want_write(devproto_reactor_t *r, devproto_transport_t *t)
+{
+    if (!r || !t) return -1;
+
+    reactor_conn_t *c = reactor_find(r, t);
+    if (!c) return -1;
+    if (c->want_write) return 0;
+
+    c->want_write = 1;
+    return backend_update(r, c);
+}
+
+/**
+ * Parser of registered transport
+ */
+devproto_frame_pooled_parser_t *devproto_reactor_parser(devproto_reactor_t *r,
+                                                        devproto_transport_t *t)
+{
+    if (!r || !t) return NULL;
+
+    reactor_conn_t *c = reactor_find(r, t);
+    return c ? c->parser : NULL;
+}
+
+/**
+ * Registered transport count
+ */
+size_t devproto_reactor_count(const devproto_reactor_t *r)
+{
+    return r ? r->count : 0;
+}
+
+/**
+ * Wait and dispatch one batch of events
+ */
+int devproto_reactor_run_once(devproto_reactor_t *r, int timeout_ms)
+{
+    if (!r) return -1;
+
+    /* Connections with unread data must not wait behind a timeout */
+    reactor_conn_t *again = r->again;
+    r->again = NULL;
+    if (again) timeout_ms = 0;
+
+    /* Pending opens need a periodic step to notice their timeouts */
+    if (r->connecting_count > 0 &&
+        (timeout_ms < 0 || timeout_ms > DEVPROTO_REACTOR_CONNECT_TICK_MS)) {
+        timeout_ms = DEVPROTO_REACTOR_CONNECT_TICK_MS;
+    }
+
+    backend_event_t events[REACTOR_MAX_EVENTS];
+    int n = backend_wait(r, events, timeout_ms);
+    if (n < 0) {
+        r->again = again;
+        return -1;
+    }
+
+    int delivered = 0;
+
+    for (int i = 0; i < n; i++) {
+        reactor_conn_t *c = backend_conn(&events[i]);
+        if (c == &r->wake_conn) {
+            reactor_woken(r);
+            continue;
+        }
+        if (c->removed) continue;
+
+        if (c->connecting) {
+            reactor_open_step(r, c);
+            continue;
+        }
+
+        if (backend_writable(&events[i])) {
+            reactor_write(r, c);
+        }
+        if (!c->removed && backend_readable(&events[i])) {
+            delivered += reactor_read(r, c);
+        }
+    }
+
+    while (again) {
+        reactor_conn_t *c = again;
+        again = c->next_again;
+        c->again = 0;
+        if (!c->removed) {
+            delivered += reactor_read(r, c);
+        }
+    }
+
+    if (r->connecting_count > 0) reactor_sweep(r);
+
+    reactor_reap(r);
+    return delivered;
+}
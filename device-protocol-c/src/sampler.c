@@ -0,0 +1,350 @@
+/**
+ * @file sampler.c
+ * @brief Cached metric sampler with a lock-free double-buffered snapshot
+ *
+ * The writer keeps the authoritative readings privately. On publish it
+ * fills the back buffer under that buffer's sequence counter (odd while
+ * writing), then flips the front index. Readers copy the front buffer and
+ * retry if its counter was odd or moved. The writer alternates buffers, so
+ * a reader is only retried if it is still copying after two publishes. All
+ * shared words are 32-bit atomics, which stay lock-free on MIPS32.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include "devproto/sampler.h"
+#include "devproto/error.h"
+
+typedef struct {
+    uint8_t  type;
+    uint32_t interval_ms;
+    devproto_sampler_read_fn read;
+    void    *user;
+    int64_t  next_ms;                   /* Next refresh due */
+    uint32_t bits;                      /* Last good reading (float bits) */
+    uint8_t  valid;
+} sampler_entry_t;
+
+typedef struct {
+    atomic_uint seq;
+    atomic_uint bits[DEVPROTO_SAMPLER_MAX_METRICS];
+    atomic_uint valid[DEVPROTO_SAMPLER_MAX_METRICS];
+} sampler_buffer_t;
+
+struct devproto_sampler {
+    /* Writer side */
+    sampler_entry_t entries[DEVPROTO_SAMPLER_MAX_METRICS];
+    size_t   count;
+    int      started;
+
+    /* Published snapshot */
+    sampler_buffer_t buffers[2];
+    atomic_uint front;
+
+    /* Background refresh thread */
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    int             running;
+    int             stop;
+};
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+static int64_t sampler_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Create sampler
+ */
+devproto_sampler_t *devproto_sampler_create(void)
+{
+    devproto_sampler_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0) {
+        free(s);
+        return NULL;
+    }
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    if (pthread_mutex_init(&s->lock, NULL) != 0) {
+        pthread_condattr_destroy(&attr);
+        free(s);
+        return NULL;
+    }
+    if (pthread_cond_init(&s->wake, &attr) != 0) {
+        pthread_mutex_destroy(&s->lock);
+        pthread_condattr_destroy(&attr);
+        free(s);
+        return NULL;
+    }
+    pthread_condattr_destroy(&attr);
+
+    return s;
+}
+
+/**
+ * Destroy sampler
+ */
+void devproto_sampler_destroy(devproto_sampler_t *s)
+{
+    if (!s) return;
+
+    devproto_sampler_stop(s);
+    pthread_cond_destroy(&s->wake);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+/**
+ * Register metric
+ */
+int devproto_sampler_add(devproto_sampler_t *s, devproto_metric_type_t type,
+                         uint32_t interval_ms, devproto_sampler_read_fn read, void *user)
+{
+    if (!s || !read || interval_ms == 0 || (unsigned)type > 0xFF) return DEVPROTO_ERR_INVALID;
+    if (s->started) return DEVPROTO_ERR_BUSY;
+    if (s->count >= DEVPROTO_SAMPLER_MAX_METRICS) return DEVPROTO_ERR_OVERFLOW;
+
+    for (size_t i = 0; i < s->count; i++) {
+        if (s->entries[i].type == (uint8_t)type) return DEVPROTO_ERR_INVALID;
+    }
+
+    sampler_entry_t *e = &s->entries[s->count];
+    memset(e, 0, sizeof(*e));
+    e->type = (uint8_t)type;
+    e->interval_ms = interval_ms;
+    e->read = read;
+    e->user = user;
+
+    /* Entry count is read by snapshot readers only after the first publish */
+    s->count++;
+    return 0;
+}
+
+/**
+ * Copy writer state into the back buffer and make it the front
+ */
+static void sampler_publish(devproto_sampler_t *s)
+{
+    unsigned back = atomic_load_explicit(&s->front, memory_order_relaxed) ^ 1u;
+    sampler_buffer_t *b = &s->buffers[back];
+
+    unsigned seq = atomic_load_explicit(&b->seq, memory_order_relaxed);
+    atomic_store_explicit(&b->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < s->count; i++) {
+        atomic_store_explicit(&b->bits[i], s->entries[i].bits, memory_order_relaxed);
+        atomic_store_explicit(&b->valid[i], s->entries[i].valid, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&b->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&s->front, back, memory_order_release);
+}
+
+/**
+ * Refresh due metrics
+ */
+int devproto_sampler_refresh(devproto_sampler_t *s)
+{
+    if (!s) return DEVPROTO_ERR_INVALID;
+
+    s->started = 1;
+
+    int64_t now = sampler_now_ms();
+    int called = 0;
+
+    for (size_t i = 0; i < s->count; i++) {
+        sampler_entry_t *e = &s->entries[i];
+        if (now < e->next_ms) continue;
+
+        float value;
+        if (e->read((devproto_metric_type_t)e->type, &value, e->user) == 0) {
+            memcpy(&e->bits, &value, sizeof(e->bits));
+            e->valid = 1;
+        }
+
+        /* Stay on the interval grid unless we fell behind a full interval */
+        e->next_ms += e->interval_ms;
+        if (e->next_ms <= now) e->next_ms = now + e->interval_ms;
+        called++;
+    }
+
+    if (called > 0) sampler_publish(s);
+    return called;
+}
+
+/**
+ * Time until next due reading
+ */
+int devproto_sampler_next_timeout(const devproto_sampler_t *s)
+{
+    if (!s || s->count == 0) return -1;
+
+    int64_t earliest = s->entries[0].next_ms;
+    for (size_t i = 1; i < s->count; i++) {
+        if (s->entries[i].next_ms < earliest) earliest = s->entries[i].next_ms;
+    }
+
+    int64_t left = earliest - sampler_now_ms();
+    if (left <= 0) return 0;
+    return left > INT32_MAX ? INT32_MAX : (int)left;
+}
+
+/**
+ * Background refresh loop
+ */
+static void *sampler_thread(void *arg)
+{
+    devproto_sampler_t *s = arg;
+
+    pthread_mutex_lock(&s->lock);
+    while (!s->stop) {
+        pthread_mutex_unlock(&s->lock);
+        devproto_sampler_refresh(s);
+        int wait = devproto_sampler_next_timeout(s);
+        pthread_mutex_lock(&s->lock);
+
+        if (s->stop || wait == 0) continue;
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += wait / 1000;
+        ts.tv_nsec += (long)(wait % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+
+        while (!s->stop && pthread_cond_timedwait(&s->wake, &s->lock, &ts) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+/**
+ * Start background thread
+ */
+int devproto_sampler_start(devproto_sampler_t *s)
+{
+    if (!s || s->count == 0) return DEVPROTO_ERR_INVALID;
+    if (s->running) return DEVPROTO_ERR_BUSY;
+
+    s->started = 1;
+    s->stop = 0;
+    if (pthread_create(&s->thread, NULL, sampler_thread, s) != 0) return DEVPROTO_ERR_NOMEM;
+
+    s->running = 1;
+    return 0;
+}
+
+/**
+ * Stop background thread
+ */
+void devproto_sampler_stop(devproto_sampler_t *s)
+{
+    if (!s || !s->running) return;
+
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+
+    pthread_join(s->thread, NULL);
+    s->running = 0;
+}
+
+/**
+ * Copy a consistent front buffer
+ * Returns the number of entries copied into bits/valid.
+ */
+static size_t sampler_read(const devproto_sampler_t *s, uint32_t *bits, uint8_t *valid)
+{
+    devproto_sampler_t *m = (devproto_sampler_t *)s;
+
+    for (;;) {
+        unsigned f = atomic_load_explicit(&m->front, memory_order_acquire);
+        sampler_buffer_t *b = &m->buffers[f];
+
+        unsigned seq = atomic_load_explicit(&b->seq, memory_order_acquire);
+        if (seq == 0) {
+            /* Nothing published yet, unless the writer flipped meanwhile */
+            if (atomic_load_explicit(&m->front, memory_order_acquire) == f) return 0;
+            continue;
+        }
+        if (seq & 1u) continue;
+
+        size_t n = s->count;
+        for (size_t i = 0; i < n; i++) {
+            bits[i] = atomic_load_explicit(&b->bits[i], memory_order_relaxed);
+            valid[i] = (uint8_t)atomic_load_explicit(&b->valid[i], memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&b->seq, memory_order_relaxed) == seq) return n;
+    }
+}
+
+/**
+ * Copy latest snapshot
+ */
+int devproto_sampler_snapshot(const devproto_sampler_t *s, devproto_metric_t *metrics,
+                              size_t max_metrics)
+{
+    if (!s || !metrics) return -1;
+
+    uint32_t bits[DEVPROTO_SAMPLER_MAX_METRICS];
+    uint8_t valid[DEVPROTO_SAMPLER_MAX_METRICS];
+    size_t n = sampler_read(s, bits, valid);
+    size_t count = 0;
+
+    for (size_t i = 0; i < n && count < max_metrics; i++) {
+        if (!valid[i]) continue;
+        metrics[count].type = (devproto_metric_type_t)s->entries[i].type;
+        memcpy(&metrics[count].value, &bits[i], sizeof(float));
+        count++;
+    }
+
+    return (int)count;
+}
+
+/**
+ * Serialize latest snapshot
+ */
+int devproto_sampler_build(const devproto_sampler_t *s, uint8_t *buffer, size_t buf_size)
+{
+    if (!s || !buffer) return -1;
+
+    uint32_t bits[DEVPROTO_SAMPLER_MAX_METRICS];
+    uint8_t valid[DEVPROTO_SAMPLER_MAX_METRICS];
+    size_t n = sampler_read(s, bits, valid);
+    size_t off = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (!valid[i]) continue;
+        if (buf_size - off < 5) return -1;
+
+        buffer[off] = s->entries[i].type;
+        buffer[off + 1] = (bits[i] >> 24) & 0xFF;
+        buffer[off + 2] = (bits[i] >> 16) & 0xFF;
+        buffer[off + 3] = (bits[i] >> 8) & 0xFF;
+        buffer[off + 4] = bits[i] & 0xFF;
+        off += 5;
+    }
+
+    return (int)off;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file send.c
+ * @brief Single and batched message send
+ */
+
+#include <string.h>
+#include <limits.h>
+#include "devproto/send.h"
+#include "devproto/frame.h"
+#include "devproto/stats.h"
+
+/**
+ * Send one message
+ */
+int devproto_send_message(devproto_transport_t *t, const devproto_message_t *msg)
+{
+    int result = -1;
+
+    if (!msg) return -1;
+    if (devproto_send_batch(t, msg, 1, &result) < 0) return -1;
+
+    return result;
+}
+
+/**
+ * Drop the first `skip` bytes of an iovec list in place.
+ * Returns the new start of the list and updates *iovcnt.
+ */
+static struct iovec *send_iov_advance(struct iovec *iov, int *iovcnt, size_t skip)
+{
+    while (*iovcnt > 0 && skip >= iov->iov_len) {
+        skip -= iov->iov_len;
+        iov++;
+        (*iovcnt)--;
+    }
+    if (*iovcnt > 0) {
+        iov->iov_base = (uint8_t *)iov->iov_base + skip;
+        iov->iov_len -= skip;
+    }
+    return iov;
+}
+
+/**
+ * Build the frame for msg, compressed into a pool block when the link has
+ * compression enabled and the payload shrinks. *block is set to the
+ * borrowed block (NULL if none), which must outlive the send.
+ */
+static int send_build(devproto_transport_t *t, const devproto_message_t *msg,
+                      devproto_frame_iov_t *frame, uint8_t **block, size_t *block_size)
+{
+    const devproto_compress_config_t *cfg = t->compress;
+    size_t max_payload = devproto_transport_max_payload(t);
+
+    *block = NULL;
+    if (cfg && cfg->codec != DEVPROTO_CODEC_NONE && msg->payload &&
+        msg->payload_len > 0 && msg->payload_len >= cfg->threshold &&
+        msg->payload_len <= max_payload) {
+        *block = devproto_frame_pool_acquire(cfg->pool, msg->payload_len, block_size);
+    }
+
+    if (*block) {
+        int n = devproto_payload_compress(cfg->codec, msg->payload, msg->payload_len,
+                                          *block, *block_size);
+        if (n > 0) {
+            devproto_message_t packed = *msg;
+            packed.payload = *block;
+            packed.payload_len = (uint16_t)n;
+            return devproto_frame_build_iov_compressed(&packed, frame, max_payload);
+        }
+
+        /* Did not shrink: send as is */
+        devproto_frame_pool_release(cfg->pool, *block, *block_size);
+        *block = NULL;
+    }
+
+    return devproto_frame_build_iov_max(msg, frame, max_payload);
+}
+
+/**
+ * Send up to DEVPROTO_SEND_BATCH_MAX messages in one go
+ * Returns 0, or -1 when the transport failed (results already filled in).
+ */
+static int send_chunk(devproto_transport_t *t, const devproto_message_t *msgs,
+                      size_t n, int *results)
+{
+    devproto_frame_iov_t frames[DEVPROTO_SEND_BATCH_MAX];
+    struct iovec iov[DEVPROTO_SEND_BATCH_MAX * DEVPROTO_FRAME_IOV_MAX];
+    size_t frame_len[DEVPROTO_SEND_BATCH_MAX];
+    uint8_t *blocks[DEVPROTO_SEND_BATCH_MAX];
+    size_t block_size[DEVPROTO_SEND_BATCH_MAX];
+    int iovcnt = 0;
+    size_t total = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        int len = send_build(t, &msgs[i], &frames[i], &blocks[i], &block_size[i]);
+        if (len < 0) {
+            results[i] = -1;  /* Invalid message, skip it */
+            frame_len[i] = 0;
+            continue;
+        }
+
+        memcpy(&iov[iovcnt], frames[i].iov, frames[i].iovcnt * sizeof(struct iovec));
+        iovcnt += frames[i].iovcnt;
+        frame_len[i] = (size_t)len;
+        total += (size_t)len;
+        results[i] = 1;  /* Pending */
+    }
+
+    /* Keep writing until everything is out or the transport gives up */
+    struct iovec *pos = iov;
+    size_t sent = 0;
+    int failed = 0;
+
+    while (sent < total) {
+        int n_sent = devproto_transport_sendv(t, pos, iovcnt);
+        if (n_sent <= 0) {
+            failed = 1;
+            break;
+        }
+
+        sent += (size_t)n_sent;
+        pos = send_iov_advance(pos, &iovcnt, (size_t)n_sent);
+    }
+
+    /* A frame counts as sent only if all of its bytes went out */
+    size_t offset = 0;
+    uint32_t frames_sent = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (results[i] != 1) continue;
+
+        offset += frame_len[i];
+        results[i] = offset <= sent ? 0 : -1;
+        if (results[i] == 0) frames_sent++;
+    }
+    if (t->stats) devproto_stats_record_frames_out(t->stats, frames_sent);
+
+    for (size_t i = 0; i < n; i++) {
+        if (blocks[i]) devproto_frame_pool_release(t->compress->pool, blocks[i], block_size[i]);
+    }
+
+    return failed ? -1 : 0;
+}
+
+/**
+ * Send batch of messages
+ */
+int devproto_send_batch(devproto_transport_t *t, const devproto_message_t *msgs,
+                        size_t n, int *results)
+{
+    if (!t || !msgs || n > INT_MAX) return -1;
+
+    int local[DEVPROTO_SEND_BATCH_MAX];
+    int sent = 0;
+
+    for (size_t base = 0; base < n; base += DEVPROTO_SEND_BATCH_MAX) {
+        size_t count = n - base;
+        if (count > DEVPROTO_SEND_BATCH_MAX) count = DEVPROTO_SEND_BATCH_MAX;
+
+        int failed = send_chunk(t, msgs + base, count, local);
+
+        for (size_t i = 0; i < count; i++) {
+            if (local[i] == 0) sent++;
+        }
+        if (results) {
+            memcpy(results + base, local, count * sizeof(int));
+        }
+
+        if (failed) {
+            /* Transport is broken: report the rest as not sent */
+            for (size_t i = base + count; results && i < n; i++) {
+                results[i] = -1;
+            }
+            break;
+        }
+    }
+
+    return sent;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file serial_baud.c
+ * @brief Arbitrary serial baud rates via termios2/BOTHER
+ *
+ * Must not include <termios.h>: it redefines struct termios and the speed
+ * flags that <asm/termbits.h> provides here.
+ */
+
+#include <errno.h>
+#include "serial_baud.h"
+
+#if defined(__linux__)
+
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#include <sys/ioctl.h>
+
+/**
+ * Set custom baud rate
+ */
+int devproto_serial_set_custom_baud(int fd, int baudrate)
+{
+    struct termios2 tio;
+
+    if (baudrate <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (ioctl(fd, TCGETS2, &tio) != 0) return -1;
+
+    tio.c_cflag &= ~(tcflag_t)CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ospeed = (speed_t)baudrate;
+#ifdef IBSHIFT
+    /* Input speed follows the output speed */
+    tio.c_cflag &= ~(tcflag_t)(CBAUD << IBSHIFT);
+    tio.c_cflag |= BOTHER << IBSHIFT;
+#endif
+    tio.c_ispeed = (speed_t)baudrate;
+
+    return ioctl(fd, TCSETS2, &tio);
+}
+
+#else
+
+/**
+ * Set custom baud rate (unsupported on this platform)
+ */
+int devproto_serial_set_custom_baud(int fd, int baudrate)
+{
+    (void)fd;
+    (void)baudrate;
+    errno = ENOTSUP;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * @file serial_baud.h
+ * @brief Arbitrary serial baud rates (internal)
+ *
+ * Kept out of transport_serial.c because the kernel termios2 headers
+ * conflict with <termios.h>.
+ */
+
+#ifndef DEVPROTO_SERIAL_BAUD_H
+#define DEVPROTO_SERIAL_BAUD_H
+
+/**
+ * Set a baud rate that has no Bxxx constant (Linux termios2/BOTHER)
+ * @param fd        Open tty
+ * @param baudrate  Rate in bit/s
+ * @return          0 on success, -1 on error (errno ENOTSUP off Linux)
+ */
+int devproto_serial_set_custom_baud(int fd, int baudrate);
+
+#endif /* DEVPROTO_SERIAL_BAUD_H */
@@ -0,0 +1,732 @@
+/**
+ * @file session.c
+ * @brief Pipelined request/response correlation
+ *
+ * One slot per sequence number. A slot is FREE, PENDING (awaiting reply) or
+ * QUARANTINED (timed out; a late reply is swallowed and the number is not
+ * reused until the quarantine ends).
+ *
+ * Async requests that do not fit the window wait in a FIFO of request
+ * records. Records are carved from chunks and recycled through a free list;
+ * payloads beyond the inline buffer borrow a frame pool block, so a steady
+ * request rate allocates nothing.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include "devproto/session.h"
+#include "devproto/send.h"
+#include "devproto/frame.h"
+#include "devproto/frame_pool.h"
+#include "devproto/error.h"
+#include "devproto/stats.h"
+#include "devproto/net.h"
+
+#define SESSION_SEQ_SPACE   256
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_PENDING,
+    SLOT_QUARANTINED
+} slot_state_t;
+
+typedef struct {
+    slot_state_t state;
+    uint8_t  expect_type;               /* Response type to match */
+    uint8_t  request_type;
+    uint64_t sent_us;                   /* Send time when the link has stats */
+    int64_t  deadline_ms;               /* Reply deadline / quarantine end */
+    int      timeout_ms;                /* Original timeout (quarantine length) */
+    devproto_session_response_fn fn;
+    void    *user;
+} session_slot_t;
+
+/**
+ * Queued async request (copy of the caller's message)
+ */
+typedef struct session_record {
+    struct session_record *next;
+    uint8_t  msg_type;
+    uint16_t payload_len;
+    uint8_t *block;                     /* Pool block for large payloads */
+    size_t   block_size;
+    int64_t  deadline_ms;
+    devproto_session_response_fn fn;
+    void    *user;
+    uint8_t  data[DEVPROTO_FRAME_COMPACT_PAYLOAD];
+} session_record_t;
+
+typedef struct session_chunk {
+    struct session_chunk *next;
+    session_record_t records[DEVPROTO_SESSION_RECORD_CHUNK];
+} session_chunk_t;
+
+struct devproto_session {
+    devproto_transport_t *t;
+    size_t   window;
+    size_t   inflight;
+    uint8_t  next_seq;
+    int      closing;                   /* Set while destroy fails requests */
+
+    devproto_session_event_fn event_fn;
+    void    *event_user;
+
+    devproto_session_stats_t stats;
+    session_slot_t slots[SESSION_SEQ_SPACE];
+
+    /* Async requests waiting for the window, and recycled records */
+    session_record_t *queue_head;
+    session_record_t *queue_tail;
+    size_t   queued;
+    session_record_t *free_records;
+    session_chunk_t *chunks;
+    devproto_frame_pool_t *pool;        /* Created on the first large payload */
+
+    /* Receive path for devproto_session_process(), allocated on first use */
+    devproto_frame_parser_t *parser;
+    devproto_frame_slab_t slab;
+    uint8_t *rx;
+
+    /* Link recovery (devproto_session_set_reconnect) */
+    int      reconnect;
+    devproto_backoff_t backoff;
+    int64_t  reopen_at_ms;              /* Next open attempt while the link is down */
+    int      reopening;                 /* Non-blocking open in progress */
+};
+
+#define SESSION_RX_SIZE     4096
+#define SESSION_SLAB_SIZE   (16 * 1024)
+
+/* Longest wait on an open in progress (its attempt timers need stepping) */
+#define SESSION_OPEN_TICK_MS    100
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+static int64_t session_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Complete a pending slot and invoke its callback
+ * The slot is released first so the callback may issue new requests.
+ */
+static void session_complete(devproto_session_t *s, session_slot_t *slot,
+                             int status, const devproto_message_t *response,
+                             slot_state_t next_state, int64_t next_deadline)
+{
+    devproto_session_response_fn fn = slot->fn;
+    void *user = slot->user;
+
+    slot->state = next_state;
+    slot->deadline_ms = next_deadline;
+    slot->fn = NULL;
+    slot->user = NULL;
+    s->inflight--;
+
+    if (fn) fn(s, status, response, user);
+}
+
+/**
+ * Take a request record from the free list, adding a chunk if it is empty
+ */
+static session_record_t *session_record_get(devproto_session_t *s)
+{
+    if (!s->free_records) {
+        session_chunk_t *chunk = malloc(sizeof(*chunk));
+        if (!chunk) return NULL;
+
+        chunk->next = s->chunks;
+        s->chunks = chunk;
+        for (int i = 0; i < DEVPROTO_SESSION_RECORD_CHUNK; i++) {
+            chunk->records[i].next = s->free_records;
+            s->free_records = &chunk->records[i];
+        }
+    }
+
+    session_record_t *r = s->free_records;
+    s->free_records = r->next;
+    r->next = NULL;
+    r->block = NULL;
+    return r;
+}
+
+/**
+ * Return a record (and its payload block) for reuse
+ */
+static void session_record_put(devproto_session_t *s, session_record_t *r)
+{
+    if (r->block) devproto_frame_pool_release(s->pool, r->block, r->block_size);
+    r->block = NULL;
+    r->fn = NULL;
+    r->user = NULL;
+    r->next = s->free_records;
+    s->free_records = r;
+}
+
+/**
+ * Unlink a queued record; prev is its predecessor (NULL for the head)
+ */
+static void session_unqueue(devproto_session_t *s, session_record_t *prev,
+                            session_record_t *r)
+{
+    if (prev) prev->next = r->next;
+    else s->queue_head = r->next;
+    if (s->queue_tail == r) s->queue_tail = prev;
+    s->queued--;
+}
+
+/**
+ * Recycle a record that left the queue without being sent and report status
+ * The record is recycled first so the callback may issue new requests.
+ */
+static void session_record_fail(devproto_session_t *s, session_record_t *r, int status)
+{
+    devproto_session_response_fn fn = r->fn;
+    void *user = r->user;
+
+    session_record_put(s, r);
+    if (fn) fn(s, status, NULL, user);
+}
+
+/**
+ * Create session
+ */
+devproto_session_t *devproto_session_create(devproto_transport_t *t, size_t window)
+{
+    if (!t || window == 0 || window > DEVPROTO_SESSION_MAX_WINDOW) return NULL;
+
+    devproto_session_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    s->t = t;
+    s->window = window;
+    return s;
+}
+
+/**
+ * Destroy session
+ */
+void devproto_session_destroy(devproto_session_t *s)
+{
+    if (!s) return;
+
+    s->closing = 1;
+    for (int i = 0; i < SESSION_SEQ_SPACE; i++) {
+        if (s->slots[i].state == SLOT_PENDING) {
+            session_complete(s, &s->slots[i], DEVPROTO_ERR_CLOSED, NULL, SLOT_FREE, 0);
+        }
+    }
+    while (s->queue_head) {
+        session_record_t *r = s->queue_head;
+        session_unqueue(s, NULL, r);
+        session_record_fail(s, r, DEVPROTO_ERR_CLOSED);
+    }
+
+    while (s->chunks) {
+        session_chunk_t *next = s->chunks->next;
+        free(s->chunks);
+        s->chunks = next;
+    }
+
+    /* The parser may hold a pool block, so it goes first */
+    if (s->parser) {
+        devproto_frame_parser_release(s->parser);
+        free(s->parser);
+        free(s->rx);
+    }
+    if (s->pool) devproto_frame_pool_destroy(s->pool);
+    free(s);
+}
+
+/**
+ * Set event handler
+ */
+void devproto_session_set_event_handler(devproto_session_t *s,
+                                        devproto_session_event_fn fn, void *user)
+{
+    if (!s) return;
+
+    s->event_fn = fn;
+    s->event_user = user;
+}
+
+/**
+ * Enable or disable link recovery
+ */
+int devproto_session_set_reconnect(devproto_session_t *s, int enable, int base_ms, int max_ms)
+{
+    if (!s || base_ms < 0 || max_ms < 0) return DEVPROTO_ERR_INVALID;
+
+    s->reconnect = enable ? 1 : 0;
+    devproto_backoff_init(&s->backoff, base_ms, max_ms);
+    s->reopen_at_ms = 0;
+    return DEVPROTO_OK;
+}
+
+/**
+ * Pick the next free sequence number (ending quarantines that are over)
+ * Returns the sequence, or -1 if none is available.
+ */
+static int session_alloc_seq(devproto_session_t *s, int64_t now)
+{
+    for (int n = 0; n < SESSION_SEQ_SPACE; n++) {
+        uint8_t seq = (uint8_t)(s->next_seq + n);
+        session_slot_t *slot = &s->slots[seq];
+
+        if (slot->state == SLOT_QUARANTINED && now >= slot->deadline_ms) {
+            slot->state = SLOT_FREE;
+        }
+        if (slot->state == SLOT_FREE) {
+            s->next_seq = (uint8_t)(seq + 1);
+            return seq;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Send on a free sequence number and make its slot pending
+ * Returns the sequence, DEVPROTO_ERR_BUSY (no number free) or DEVPROTO_ERR_IO.
+ */
+static int session_send(devproto_session_t *s, devproto_message_t *request,
+                        int64_t now, int64_t deadline_ms,
+                        devproto_session_response_fn fn, void *user)
+{
+    int seq = session_alloc_seq(s, now);
+    if (seq < 0) return DEVPROTO_ERR_BUSY;
+
+    request->sequence = (uint8_t)seq;
+    if (devproto_send_message(s->t, request) != 0) return DEVPROTO_ERR_IO;
+
+    int64_t timeout = deadline_ms - now;
+    session_slot_t *slot = &s->slots[seq];
+    slot->state = SLOT_PENDING;
+    slot->expect_type = devproto_response_type(request->msg_type);
+    slot->request_type = request->msg_type;
+    slot->sent_us = s->t->stats ? devproto_stats_now_us() : 0;
+    slot->deadline_ms = deadline_ms;
+    slot->timeout_ms = timeout > INT32_MAX ? INT32_MAX : (int)timeout;
+    slot->fn = fn;
+    slot->user = user;
+
+    s->inflight++;
+    s->stats.requests++;
+    return seq;
+}
+
+static int session_link_down(devproto_session_t *s);
+
+/**
+ * Send queued requests while the window has room
+ * Records whose deadline passed in the queue time out without being sent.
+ * A send failing on a reconnecting session takes the link down and keeps
+ * the record queued for the next connection.
+ * Returns the number of requests completed here (timed out or failed).
+ */
+static int session_pump(devproto_session_t *s, int64_t now)
+{
+    int completed = 0;
+
+    while (s->queue_head && s->inflight < s->window && !s->closing) {
+        session_record_t *r = s->queue_head;
+
+        /* Hold the queue while a dropped link is being restored */
+        if (s->reconnect && !s->t->is_open && now < r->deadline_ms) break;
+
+        if (now >= r->deadline_ms) {
+            session_unqueue(s, NULL, r);
+            s->stats.timeouts++;
+            if (s->t->stats) devproto_stats_record_timeout(s->t->stats);
+            completed++;
+            session_record_fail(s, r, DEVPROTO_ERR_TIMEOUT);
+            continue;
+        }
+
+        devproto_message_t msg = {
+            .msg_type = r->msg_type,
+            .payload_len = r->payload_len,
+            .payload = r->block ? r->block : r->data
+        };
+        int seq = session_send(s, &msg, now, r->deadline_ms, r->fn, r->user);
+        if (seq == DEVPROTO_ERR_BUSY) break;    /* Numbers held in quarantine */
+        if (seq == DEVPROTO_ERR_IO && s->reconnect) {
+            completed += session_link_down(s);
+            break;
+        }
+
+        session_unqueue(s, NULL, r);
+        if (seq < 0) {
+            completed++;
+            session_record_fail(s, r, DEVPROTO_ERR_IO);
+        } else {
+            session_record_put(s, r);
+        }
+    }
+
+    return completed;
+}
+
+/**
+ * Send request
+ */
+int devproto_session_request(devproto_session_t *s, devproto_message_t *request,
+                             int timeout_ms, devproto_session_response_fn fn,
+                             void *user)
+{
+    if (!s || !request || timeout_ms <= 0) return DEVPROTO_ERR_INVALID;
+    if (devproto_is_response(request->msg_type) || devproto_is_event(request->msg_type)) {
+        return DEVPROTO_ERR_INVALID;
+    }
+    if (s->closing) return DEVPROTO_ERR_CLOSED;
+    if (s->inflight >= s->window) return DEVPROTO_ERR_BUSY;
+
+    int64_t now = session_now_ms();
+    return session_send(s, request, now, now + timeout_ms, fn, user);
+}
+
+/**
+ * Session clock
+ */
+int64_t devproto_session_clock_ms(void)
+{
+    return session_now_ms();
+}
+
+/**
+ * Send or queue an async request
+ */
+int devproto_session_request_async(devproto_session_t *s,
+                                   const devproto_message_t *request,
+                                   int64_t deadline_ms,
+                                   devproto_session_response_fn fn, void *user)
+{
+    if (!s || !request) return DEVPROTO_ERR_INVALID;
+    if (request->payload_len > devproto_transport_max_payload(s->t) ||
+        (request->payload_len > 0 && !request->payload)) {
+        return DEVPROTO_ERR_INVALID;
+    }
+    if (devproto_is_response(request->msg_type) || devproto_is_event(request->msg_type)) {
+        return DEVPROTO_ERR_INVALID;
+    }
+    if (s->closing) return DEVPROTO_ERR_CLOSED;
+
+    int64_t now = session_now_ms();
+    if (deadline_ms <= now) return DEVPROTO_ERR_TIMEOUT;
+
+    /* Fast path: nothing queued ahead, room in the window and a link */
+    if (!s->queue_head && s->inflight < s->window && (!s->reconnect || s->t->is_open)) {
+        devproto_message_t msg = *request;
+        int seq = session_send(s, &msg, now, deadline_ms, fn, user);
+        if (seq >= 0) return 0;
+        if (seq != DEVPROTO_ERR_BUSY) return seq;
+    }
+
+    if (s->queued >= DEVPROTO_SESSION_QUEUE_MAX) return DEVPROTO_ERR_BUSY;
+
+    session_record_t *r = session_record_get(s);
+    if (!r) return DEVPROTO_ERR_NOMEM;
+
+    uint8_t *dst = r->data;
+    if (request->payload_len > sizeof(r->data)) {
+        if (!s->pool) s->pool = devproto_frame_pool_create(0);
+        if (s->pool) r->block = devproto_frame_pool_acquire(s->pool, request->payload_len,
+                                                            &r->block_size);
+        if (!r->block) {
+            session_record_put(s, r);
+            return DEVPROTO_ERR_NOMEM;
+        }
+        dst = r->block;
+    }
+    if (request->payload_len > 0) memcpy(dst, request->payload, request->payload_len);
+
+    r->msg_type = request->msg_type;
+    r->payload_len = request->payload_len;
+    r->deadline_ms = deadline_ms;
+    r->fn = fn;
+    r->user = user;
+
+    if (s->queue_tail) s->queue_tail->next = r;
+    else s->queue_head = r;
+    s->queue_tail = r;
+    s->queued++;
+    s->stats.deferred++;
+    return 0;
+}
+
+/**
+ * Route received message
+ */
+int devproto_session_on_message(devproto_session_t *s, const devproto_message_t *msg)
+{
+    if (!s || !msg) return 0;
+
+    if (devproto_is_event(msg->msg_type)) {
+        s->stats.events++;
+        if (s->event_fn) s->event_fn(s, msg, s->event_user);
+        return 0;
+    }
+
+    session_slot_t *slot = &s->slots[msg->sequence];
+
+    if (devproto_is_response(msg->msg_type) && slot->state == SLOT_PENDING &&
+        slot->expect_type == msg->msg_type) {
+        s->stats.responses++;
+        if (s->t->stats && slot->sent_us) {
+            devproto_stats_record_rtt(s->t->stats, slot->request_type,
+                                      devproto_stats_now_us() - slot->sent_us);
+        }
+        session_complete(s, slot, DEVPROTO_OK, msg, SLOT_FREE, 0);
+        if (s->queue_head) session_pump(s, session_now_ms());
+        return 1;
+    }
+
+    /* Late reply to a timed-out request, or nothing we asked for */
+    s->stats.unmatched++;
+    return 0;
+}
+
+/**
+ * Expire overdue requests
+ */
+int devproto_session_expire(devproto_session_t *s)
+{
+    if (!s || (s->inflight == 0 && !s->queue_head)) return 0;
+
+    int64_t now = session_now_ms();
+    int expired = 0;
+
+    for (int i = 0; i < SESSION_SEQ_SPACE && s->inflight > 0; i++) {
+        session_slot_t *slot = &s->slots[i];
+
+        if (slot->state == SLOT_PENDING && now >= slot->deadline_ms) {
+            /* Hold the number back as long as the request was allowed to take */
+            int64_t quarantine = now + slot->timeout_ms;
+            s->stats.timeouts++;
+            if (s->t->stats) devproto_stats_record_timeout(s->t->stats);
+            expired++;
+            session_complete(s, slot, DEVPROTO_ERR_TIMEOUT, NULL,
+                             SLOT_QUARANTINED, quarantine);
+        }
+    }
+
+    /* Queued requests keep their own deadlines */
+    session_record_t *prev = NULL;
+    session_record_t *r = s->queue_head;
+    while (r) {
+        session_record_t *next = r->next;
+        if (now >= r->deadline_ms) {
+            session_unqueue(s, prev, r);
+            s->stats.timeouts++;
+            if (s->t->stats) devproto_stats_record_timeout(s->t->stats);
+            expired++;
+            session_record_fail(s, r, DEVPROTO_ERR_TIMEOUT);
+        } else {
+            prev = r;
+        }
+        r = next;
+    }
+
+    expired += session_pump(s, now);
+    return expired;
+}
+
+/**
+ * Time until next deadline
+ */
+int devproto_session_next_timeout(devproto_session_t *s)
+{
+    if (!s || (s->inflight == 0 && !s->queue_head)) return -1;
+
+    int64_t earliest = -1;
+    for (int i = 0; i < SESSION_SEQ_SPACE && s->inflight > 0; i++) {
+        const session_slot_t *slot = &s->slots[i];
+        if (slot->state == SLOT_PENDING &&
+            (earliest < 0 || slot->deadline_ms < earliest)) {
+            earliest = slot->deadline_ms;
+        }
+    }
+    for (const session_record_t *r = s->queue_head; r; r = r->next) {
+        if (earliest < 0 || r->deadline_ms < earliest) earliest = r->deadline_ms;
+    }
+
+    int64_t left = earliest - session_now_ms();
+    if (left <= 0) return 0;
+    return left > INT32_MAX ? INT32_MAX : (int)left;
+}
+
+/**
+ * The link failed: fail what was sent on it, close it and schedule a reopen
+ * Returns the number of requests failed.
+ */
+static int session_link_down(devproto_session_t *s)
+{
+    int failed = 0;
+
+    for (int i = 0; i < SESSION_SEQ_SPACE && s->inflight > 0; i++) {
+        if (s->slots[i].state == SLOT_PENDING) {
+            /* Replies to these will never come on the next connection */
+            failed++;
+            session_complete(s, &s->slots[i], DEVPROTO_ERR_IO, NULL, SLOT_FREE, 0);
+        }
+    }
+
+    devproto_transport_close(s->t);
+    s->reopening = 0;
+    s->reopen_at_ms = session_now_ms() + devproto_backoff_next(&s->backoff);
+    return failed;
+}
+
+/**
+ * Work towards reopening the link, waiting at most wait_ms
+ * Returns requests completed meanwhile (queued ones that timed out).
+ */
+static int session_reopen(devproto_session_t *s, int wait_ms)
+{
+    int64_t now = session_now_ms();
+
+    if (!s->reopening && now < s->reopen_at_ms) {
+        int64_t left = s->reopen_at_ms - now;
+        if (wait_ms < 0 || left < wait_ms) wait_ms = (int)left;
+        if (wait_ms > 0) poll(NULL, 0, wait_ms);
+        return devproto_session_expire(s);
+    }
+
+    int ret = devproto_transport_open_step(s->t);
+    if (ret < 0) {
+        s->reopening = 0;
+        devproto_transport_close(s->t);
+        s->reopen_at_ms = session_now_ms() + devproto_backoff_next(&s->backoff);
+        return devproto_session_expire(s);
+    }
+
+    if (ret > 0) {
+        s->reopening = 1;
+        if (wait_ms < 0 || wait_ms > SESSION_OPEN_TICK_MS) wait_ms = SESSION_OPEN_TICK_MS;
+        struct pollfd pfd = {
+            .fd = s->t->fd,
+            .events = ret == DEVPROTO_TRANSPORT_WANT_READ ? POLLIN : POLLOUT
+        };
+        poll(&pfd, 1, wait_ms);
+        return devproto_session_expire(s);
+    }
+
+    /* Back up: bytes of a frame torn by the drop are worthless now, and
+     * requests held for the link go out at once */
+    s->reopening = 0;
+    s->stats.reconnects++;
+    devproto_frame_parser_reset(s->parser);
+    int completed = session_pump(s, session_now_ms());
+    return completed + devproto_session_expire(s);
+}
+
+/**
+ * Receive, dispatch and expire
+ */
+int devproto_session_process(devproto_session_t *s, int timeout_ms)
+{
+    if (!s) return DEVPROTO_ERR_INVALID;
+
+    if (!s->parser) {
+        s->parser = malloc(sizeof(*s->parser));
+        s->rx = malloc(SESSION_RX_SIZE + SESSION_SLAB_SIZE);
+        if (!s->parser || !s->rx) {
+            free(s->parser);
+            free(s->rx);
+            s->parser = NULL;
+            s->rx = NULL;
+            return DEVPROTO_ERR_NOMEM;
+        }
+        devproto_frame_parser_init(s->parser);
+        devproto_frame_slab_init(&s->slab, s->rx + SESSION_RX_SIZE, SESSION_SLAB_SIZE);
+    }
+
+    /* Follow the link's negotiated limit and compression; jumbo and
+     * expanded payloads come from the pool */
+    size_t max_payload = devproto_transport_max_payload(s->t);
+    uint8_t decompress = s->t->compress ? 1 : 0;
+    if (s->parser->max_payload != max_payload || s->parser->decompress != decompress) {
+        if (!s->pool) s->pool = devproto_frame_pool_create(0);
+        if (!s->pool) return DEVPROTO_ERR_NOMEM;
+        devproto_frame_parser_set_max_payload(s->parser, max_payload, s->pool);
+        devproto_frame_parser_set_decompress(s->parser, decompress, s->pool);
+    }
+
+    int wait = devproto_session_next_timeout(s);
+    if (wait < 0 || (timeout_ms >= 0 && timeout_ms < wait)) wait = timeout_ms;
+
+    if (s->reconnect && !s->t->is_open) return session_reopen(s, wait);
+
+    int completed = 0;
+    int n = devproto_transport_recv(s->t, s->rx, SESSION_RX_SIZE, wait);
+    if (n < 0) {
+        if (!s->reconnect) return DEVPROTO_ERR_IO;
+        completed = session_link_down(s);
+        return completed + devproto_session_expire(s);
+    }
+
+    /* Traffic proves the link healthy; the next drop starts from the base delay */
+    if (n > 0 && s->reconnect) devproto_backoff_reset(&s->backoff);
+
+    size_t off = 0;
+    while (off < (size_t)n) {
+        devproto_message_t msgs[16];
+        size_t consumed = 0;
+
+        uint32_t crc_errors = s->parser->crc_errors;
+        uint32_t sync_errors = s->parser->sync_errors;
+        uint64_t start = s->t->stats ? devproto_stats_cycles() : 0;
+
+        devproto_frame_slab_reset(&s->slab);
+        int count = devproto_frame_parse_slab(s->parser, s->rx + off, (size_t)n - off,
+                                              &s->slab, msgs, 16, &consumed);
+        if (count < 0) break;
+        if (s->t->stats) {
+            devproto_stats_record_parse(s->t->stats, (uint32_t)count,
+                                        devproto_stats_cycles() - start,
+                                        s->parser->crc_errors - crc_errors,
+                                        s->parser->sync_errors - sync_errors);
+        }
+        off += consumed;
+
+        for (int i = 0; i < count; i++) {
+            completed += devproto_session_on_message(s, &msgs[i]);
+        }
+        if (count == 0 && consumed == 0) break;
+    }
+
+    completed += devproto_session_expire(s);
+    return completed;
+}
+
+/**
+ * In-flight count
+ */
+size_t devproto_session_inflight(const devproto_session_t *s)
+{
+    return s ? s->inflight : 0;
+}
+
+/**
+ * Queued count
+ */
+size_t devproto_session_queued(const devproto_session_t *s)
+{
+    return s ? s->queued : 0;
+}
+
+/**
+ * Get statistics
+ */
+void devproto_session_get_stats(const devproto_session_t *s,
+                                devproto_session_stats_t *stats)
+{
+    if (!s || !stats) return;
+
+    *stats = s->stats;
+}
@@ -0,0 +1,647 @@
+/**
+ * @file stats.c
+ * @brief Per-connection telemetry with lock-free snapshots and exporters
+ *
+ * Every 64-bit value is kept as two 32-bit atomic halves, so MIPS32 needs
+ * neither 64-bit atomics nor libatomic. The recording thread wraps each
+ * update in a sequence counter (odd while writing); readers copy
+ * everything and retry if the counter was odd or moved. Updates are a few
+ * stores, so a reader rarely retries and the writer never waits.
+ *
+ * RTT histograms are allocated the first time their request type is seen
+ * and published with a release store of the pointer, so idle types cost
+ * nothing.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include "devproto/stats.h"
+
+typedef struct {
+    atomic_uint lo;
+    atomic_uint hi;
+} stats_u64_t;
+
+typedef struct {
+    stats_u64_t count;
+    stats_u64_t sum;
+    atomic_uint min;
+    atomic_uint max;
+    stats_u64_t buckets[DEVPROTO_STATS_HIST_BUCKETS];
+} stats_hist_t;
+
+/* Counter slots, in devproto_stats_snapshot_t order */
+enum {
+    STATS_BYTES_IN,
+    STATS_BYTES_OUT,
+    STATS_FRAMES_IN,
+    STATS_FRAMES_OUT,
+    STATS_RECV_CALLS,
+    STATS_SEND_CALLS,
+    STATS_RX_EMPTY,
+    STATS_TX_EAGAIN,
+    STATS_TX_PARTIAL,
+    STATS_IO_ERRORS,
+    STATS_CRC_ERRORS,
+    STATS_SYNC_ERRORS,
+    STATS_TIMEOUTS,
+    STATS_COUNTERS
+};
+
+struct devproto_stats {
+    atomic_uint seq;
+    stats_u64_t counters[STATS_COUNTERS];
+    stats_hist_t parse;
+    _Atomic(stats_hist_t *) rtt[DEVPROTO_STATS_RTT_TYPES];
+};
+
+/**
+ * Exported counters, in slot order; consecutive rows of one family differ
+ * by label
+ */
+#define STATS_FIELD(f) offsetof(devproto_stats_snapshot_t, f)
+
+static const struct {
+    const char *key;                    /* JSON key */
+    const char *family;                 /* Prometheus metric */
+    const char *label;                  /* Extra label, or NULL */
+    size_t      offset;                 /* Snapshot field */
+    const char *help;                   /* Set on the first row of a family */
+} stats_counters[STATS_COUNTERS] = {
+    { "bytes_in",    "devproto_bytes_total",       "dir=\"in\"",  STATS_FIELD(bytes_in),
+      "Bytes moved by the transport." },
+    { "bytes_out",   "devproto_bytes_total",       "dir=\"out\"", STATS_FIELD(bytes_out),
+      NULL },
+    { "frames_in",   "devproto_frames_total",      "dir=\"in\"",  STATS_FIELD(frames_in),
+      "Frames parsed or sent." },
+    { "frames_out",  "devproto_frames_total",      "dir=\"out\"", STATS_FIELD(frames_out),
+      NULL },
+    { "recv_calls",  "devproto_io_calls_total",    "op=\"recv\"", STATS_FIELD(recv_calls),
+      "Transport receive and send calls." },
+    { "send_calls",  "devproto_io_calls_total",    "op=\"send\"", STATS_FIELD(send_calls),
+      NULL },
+    { "rx_empty",    "devproto_rx_empty_total",    NULL,          STATS_FIELD(rx_empty),
+      "Receives that returned no data." },
+    { "tx_eagain",   "devproto_tx_eagain_total",   NULL,          STATS_FIELD(tx_eagain),
+      "Sends refused with EAGAIN." },
+    { "tx_partial",  "devproto_tx_partial_total",  NULL,          STATS_FIELD(tx_partial),
+      "Sends that took only part of the data." },
+    { "io_errors",   "devproto_io_errors_total",   NULL,          STATS_FIELD(io_errors),
+      "Failed transport calls." },
+    { "crc_errors",  "devproto_crc_errors_total",  NULL,          STATS_FIELD(crc_errors),
+      "Frames dropped on CRC mismatch." },
+    { "sync_errors", "devproto_sync_errors_total", NULL,          STATS_FIELD(sync_errors),
+      "Bytes skipped hunting for a frame header." },
+    { "timeouts",    "devproto_timeouts_total",    NULL,          STATS_FIELD(timeouts),
+      "Requests that hit their deadline." }
+};
+
+/* ---- Recording ---- */
+
+/**
+ * Enter an update (writer only)
+ */
+static void stats_begin(devproto_stats_t *st)
+{
+    unsigned seq = atomic_load_explicit(&st->seq, memory_order_relaxed);
+    atomic_store_explicit(&st->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * Leave an update (writer only)
+ */
+static void stats_end(devproto_stats_t *st)
+{
+    unsigned seq = atomic_load_explicit(&st->seq, memory_order_relaxed);
+    atomic_store_explicit(&st->seq, seq + 1, memory_order_release);
+}
+
+/**
+ * Add to a split 64-bit value (writer only, inside an update)
+ */
+static void stats_add(stats_u64_t *v, uint64_t n)
+{
+    uint32_t lo = atomic_load_explicit(&v->lo, memory_order_relaxed);
+    uint32_t sum = lo + (uint32_t)n;
+    uint32_t carry = (uint32_t)(n >> 32) + (sum < lo ? 1u : 0u);
+
+    atomic_store_explicit(&v->lo, sum, memory_order_relaxed);
+    if (carry) {
+        uint32_t hi = atomic_load_explicit(&v->hi, memory_order_relaxed);
+        atomic_store_explicit(&v->hi, hi + carry, memory_order_relaxed);
+    }
+}
+
+/**
+ * Read a split 64-bit value (consistent only inside a snapshot)
+ */
+static uint64_t stats_load(stats_u64_t *v)
+{
+    uint64_t hi = atomic_load_explicit(&v->hi, memory_order_relaxed);
+    return hi << 32 | atomic_load_explicit(&v->lo, memory_order_relaxed);
+}
+
+/**
+ * Bucket of a value: exact below 4, then 4 sub-buckets per power of two
+ */
+static size_t stats_bucket(uint32_t v)
+{
+    if (v < 4) return v;
+
+    unsigned e = 31u - (unsigned)__builtin_clz(v);
+    return (size_t)(e - 1) * 4 + ((v >> (e - 2)) & 3u);
+}
+
+/**
+ * Add weight samples of value v (writer only, inside an update)
+ */
+static void stats_hist_add(stats_hist_t *h, uint32_t v, uint32_t weight)
+{
+    int first = atomic_load_explicit(&h->count.lo, memory_order_relaxed) == 0 &&
+                atomic_load_explicit(&h->count.hi, memory_order_relaxed) == 0;
+
+    stats_add(&h->buckets[stats_bucket(v)], weight);
+    stats_add(&h->count, weight);
+    stats_add(&h->sum, (uint64_t)v * weight);
+
+    if (first || v < atomic_load_explicit(&h->min, memory_order_relaxed)) {
+        atomic_store_explicit(&h->min, v, memory_order_relaxed);
+    }
+    if (v > atomic_load_explicit(&h->max, memory_order_relaxed)) {
+        atomic_store_explicit(&h->max, v, memory_order_relaxed);
+    }
+}
+
+/**
+ * Create stats object
+ */
+devproto_stats_t *devproto_stats_create(void)
+{
+    return calloc(1, sizeof(devproto_stats_t));
+}
+
+/**
+ * Destroy stats object
+ */
+void devproto_stats_destroy(devproto_stats_t *st)
+{
+    if (!st) return;
+
+    for (size_t i = 0; i < DEVPROTO_STATS_RTT_TYPES; i++) {
+        free(atomic_load_explicit(&st->rtt[i], memory_order_relaxed));
+    }
+    free(st);
+}
+
+/**
+ * Record a send call
+ */
+void devproto_stats_record_send(devproto_stats_t *st, size_t requested, int result)
+{
+    if (!st) return;
+
+    int err = errno;
+    stats_begin(st);
+    stats_add(&st->counters[STATS_SEND_CALLS], 1);
+    if (result >= 0) {
+        stats_add(&st->counters[STATS_BYTES_OUT], (uint64_t)result);
+        if ((size_t)result < requested) stats_add(&st->counters[STATS_TX_PARTIAL], 1);
+    } else if (err == EAGAIN || err == EWOULDBLOCK) {
+        stats_add(&st->counters[STATS_TX_EAGAIN], 1);
+    } else {
+        stats_add(&st->counters[STATS_IO_ERRORS], 1);
+    }
+    stats_end(st);
+}
+
+/**
+ * Record a receive call
+ */
+void devproto_stats_record_recv(devproto_stats_t *st, int result)
+{
+    if (!st) return;
+
+    int err = errno;
+    stats_begin(st);
+    stats_add(&st->counters[STATS_RECV_CALLS], 1);
+    if (result > 0) {
+        stats_add(&st->counters[STATS_BYTES_IN], (uint64_t)result);
+    } else if (result == 0 || err == EAGAIN || err == EWOULDBLOCK) {
+        stats_add(&st->counters[STATS_RX_EMPTY], 1);
+    } else {
+        stats_add(&st->counters[STATS_IO_ERRORS], 1);
+    }
+    stats_end(st);
+}
+
+/**
+ * Record frames sent
+ */
+void devproto_stats_record_frames_out(devproto_stats_t *st, uint32_t frames)
+{
+    if (!st || frames == 0) return;
+
+    stats_begin(st);
+    stats_add(&st->counters[STATS_FRAMES_OUT], frames);
+    stats_end(st);
+}
+
+/**
+ * Record a parse call
+ */
+void devproto_stats_record_parse(devproto_stats_t *st, uint32_t frames, uint64_t cycles,
+                                 uint32_t crc_errors, uint32_t sync_errors)
+{
+    if (!st || (frames == 0 && crc_errors == 0 && sync_errors == 0)) return;
+
+    stats_begin(st);
+    if (frames > 0) {
+        uint64_t per_frame = cycles / frames;
+        stats_add(&st->counters[STATS_FRAMES_IN], frames);
+        stats_hist_add(&st->parse, per_frame > UINT32_MAX ? UINT32_MAX : (uint32_t)per_frame,
+                       frames);
+    }
+    if (crc_errors) stats_add(&st->counters[STATS_CRC_ERRORS], crc_errors);
+    if (sync_errors) stats_add(&st->counters[STATS_SYNC_ERRORS], sync_errors);
+    stats_end(st);
+}
+
+/**
+ * Record a request round trip
+ */
+void devproto_stats_record_rtt(devproto_stats_t *st, uint8_t msg_type, uint64_t rtt_us)
+{
+    if (!st) return;
+
+    size_t slot = devproto_stats_rtt_slot(msg_type);
+    stats_hist_t *h = atomic_load_explicit(&st->rtt[slot], memory_order_relaxed);
+    if (!h) {
+        h = calloc(1, sizeof(*h));
+        if (!h) return;
+        atomic_store_explicit(&st->rtt[slot], h, memory_order_release);
+    }
+
+    stats_begin(st);
+    stats_hist_add(h, rtt_us > UINT32_MAX ? UINT32_MAX : (uint32_t)rtt_us, 1);
+    stats_end(st);
+}
+
+/**
+ * Record a request timeout
+ */
+void devproto_stats_record_timeout(devproto_stats_t *st)
+{
+    if (!st) return;
+
+    stats_begin(st);
+    stats_add(&st->counters[STATS_TIMEOUTS], 1);
+    stats_end(st);
+}
+
+/**
+ * Cycle counter
+ */
+uint64_t devproto_stats_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Microseconds on the monotonic clock
+ */
+uint64_t devproto_stats_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* ---- Reading ---- */
+
+/**
+ * Copy a histogram (inside a snapshot)
+ */
+static void stats_hist_copy(stats_hist_t *h, devproto_stats_hist_t *out)
+{
+    out->count = stats_load(&h->count);
+    out->sum = stats_load(&h->sum);
+    out->min = atomic_load_explicit(&h->min, memory_order_relaxed);
+    out->max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    for (size_t i = 0; i < DEVPROTO_STATS_HIST_BUCKETS; i++) {
+        out->buckets[i] = stats_load(&h->buckets[i]);
+    }
+}
+
+/**
+ * Take a snapshot
+ */
+void devproto_stats_snapshot(const devproto_stats_t *st, devproto_stats_snapshot_t *snap)
+{
+    if (!snap) return;
+    memset(snap, 0, sizeof(*snap));
+    if (!st) return;
+
+    devproto_stats_t *m = (devproto_stats_t *)st;
+
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&m->seq, memory_order_acquire);
+        if (seq & 1u) continue;
+
+        for (size_t i = 0; i < STATS_COUNTERS; i++) {
+            *(uint64_t *)((char *)snap + stats_counters[i].offset) =
+                stats_load(&m->counters[i]);
+        }
+        stats_hist_copy(&m->parse, &snap->parse_cycles);
+        for (size_t i = 0; i < DEVPROTO_STATS_RTT_TYPES; i++) {
+            stats_hist_t *h = atomic_load_explicit(&m->rtt[i], memory_order_acquire);
+            if (h) stats_hist_copy(h, &snap->rtt_us[i]);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&m->seq, memory_order_relaxed) == seq) return;
+    }
+}
+
+/**
+ * Smallest value of a bucket
+ */
+uint32_t devproto_stats_bucket_lower(size_t bucket)
+{
+    if (bucket < 4) return (uint32_t)bucket;
+    if (bucket >= DEVPROTO_STATS_HIST_BUCKETS) return UINT32_MAX;
+
+    unsigned e = (unsigned)(bucket / 4) + 1;
+    return (uint32_t)(4 + bucket % 4) << (e - 2);
+}
+
+/**
+ * Largest value of a bucket
+ */
+static uint32_t stats_bucket_upper(size_t bucket)
+{
+    if (bucket + 1 >= DEVPROTO_STATS_HIST_BUCKETS) return UINT32_MAX;
+    return devproto_stats_bucket_lower(bucket + 1) - 1;
+}
+
+/**
+ * Estimate a quantile
+ */
+uint32_t devproto_stats_hist_quantile(const devproto_stats_hist_t *h, double q)
+{
+    if (!h || h->count == 0) return 0;
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+
+    uint64_t rank = (uint64_t)(q * (double)h->count + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > h->count) rank = h->count;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < DEVPROTO_STATS_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = stats_bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+/* ---- Exporters ---- */
+
+typedef struct {
+    char  *buf;
+    size_t cap;
+    size_t len;
+    int    overflow;
+} stats_out_t;
+
+/**
+ * Append formatted text
+ */
+static void stats_printf(stats_out_t *out, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void stats_printf(stats_out_t *out, const char *fmt, ...)
+{
+    if (out->overflow) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(out->buf + out->len, out->cap - out->len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= out->cap - out->len) {
+        out->overflow = 1;
+        return;
+    }
+    out->len += (size_t)n;
+}
+
+/**
+ * Append a string with Prometheus label or JSON string escaping
+ */
+static void stats_escape(stats_out_t *out, const char *s, int json)
+{
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            stats_printf(out, "\\%c", c);
+        } else if (c == '\n') {
+            stats_printf(out, "\\n");
+        } else if (json && c < 0x20) {
+            stats_printf(out, "\\u%04x", c);
+        } else {
+            stats_printf(out, "%c", c);
+        }
+    }
+}
+
+/**
+ * Finish output: length, or -1 if it did not fit
+ */
+static int stats_out_done(stats_out_t *out)
+{
+    if (out->overflow || out->len > (size_t)INT32_MAX) return -1;
+    return (int)out->len;
+}
+
+
+/**
+ * Value of a counter slot
+ */
+static uint64_t stats_counter(const devproto_stats_snapshot_t *snap, size_t c)
+{
+    return *(const uint64_t *)((const char *)snap + stats_counters[c].offset);
+}
+
+/**
+ * Prometheus label set {conn="...",extra}
+ */
+static void stats_prom_labels(stats_out_t *out, const char *conn, const char *extra)
+{
+    stats_printf(out, "{conn=\"");
+    stats_escape(out, conn, 0);
+    stats_printf(out, "\"%s%s", extra ? "," : "", extra ? extra : "");
+}
+
+/**
+ * One Prometheus histogram series, buckets at 2^k - 1
+ */
+static void stats_prom_hist(stats_out_t *out, const char *family, const char *conn,
+                            const char *extra, const devproto_stats_hist_t *h)
+{
+    uint64_t cumulative = 0;
+    size_t next = 0;
+
+    for (unsigned k = 1; k <= 32 && h->count > 0; k++) {
+        size_t end = k == 1 ? 2 : (size_t)(k - 1) * 4;
+        if (end > DEVPROTO_STATS_HIST_BUCKETS) end = DEVPROTO_STATS_HIST_BUCKETS;
+        while (next < end) cumulative += h->buckets[next++];
+
+        uint64_t le = ((uint64_t)1 << k) - 1;
+        stats_printf(out, "%s_bucket", family);
+        stats_prom_labels(out, conn, extra);
+        stats_printf(out, ",le=\"%" PRIu64 "\"} %" PRIu64 "\n", le, cumulative);
+        if (le >= h->max) break;
+    }
+
+    stats_printf(out, "%s_bucket", family);
+    stats_prom_labels(out, conn, extra);
+    stats_printf(out, ",le=\"+Inf\"} %" PRIu64 "\n", h->count);
+    stats_printf(out, "%s_sum", family);
+    stats_prom_labels(out, conn, extra);
+    stats_printf(out, "} %" PRIu64 "\n", h->sum);
+    stats_printf(out, "%s_count", family);
+    stats_prom_labels(out, conn, extra);
+    stats_printf(out, "} %" PRIu64 "\n", h->count);
+}
+
+/**
+ * Prometheus exporter
+ */
+int devproto_stats_format_prometheus(const devproto_stats_snapshot_t *snaps,
+                                     const char *const *names, size_t n,
+                                     char *buf, size_t cap)
+{
+    if ((!snaps && n > 0) || (!names && n > 0) || !buf || cap == 0) return -1;
+
+    stats_out_t out = { buf, cap, 0, 0 };
+    buf[0] = '\0';
+
+    for (size_t c = 0; c < STATS_COUNTERS; c++) {
+        if (stats_counters[c].help) {
+            stats_printf(&out, "# HELP %s %s\n# TYPE %s counter\n", stats_counters[c].family,
+                         stats_counters[c].help, stats_counters[c].family);
+        }
+        for (size_t i = 0; i < n; i++) {
+            stats_printf(&out, "%s", stats_counters[c].family);
+            stats_prom_labels(&out, names[i], stats_counters[c].label);
+            stats_printf(&out, "} %" PRIu64 "\n", stats_counter(&snaps[i], c));
+        }
+    }
+
+    stats_printf(&out, "# HELP devproto_parse_cycles Parse and CRC cost per frame in cycles.\n"
+                       "# TYPE devproto_parse_cycles histogram\n");
+    for (size_t i = 0; i < n; i++) {
+        stats_prom_hist(&out, "devproto_parse_cycles", names[i], NULL, &snaps[i].parse_cycles);
+    }
+
+    stats_printf(&out, "# HELP devproto_request_rtt_microseconds Request round-trip time.\n"
+                       "# TYPE devproto_request_rtt_microseconds histogram\n");
+    for (size_t i = 0; i < n; i++) {
+        for (size_t t = 0; t < DEVPROTO_STATS_RTT_TYPES; t++) {
+            if (snaps[i].rtt_us[t].count == 0) continue;
+
+            char type[24];
+            if (t == 0) snprintf(type, sizeof(type), "type=\"other\"");
+            else snprintf(type, sizeof(type), "type=\"0x%02x\"", (unsigned)t);
+            stats_prom_hist(&out, "devproto_request_rtt_microseconds", names[i], type,
+                            &snaps[i].rtt_us[t]);
+        }
+    }
+
+    return stats_out_done(&out);
+}
+
+/**
+ * One JSON histogram object
+ */
+static void stats_json_hist(stats_out_t *out, const devproto_stats_hist_t *h)
+{
+    stats_printf(out, "{\"count\":%" PRIu64 ",\"sum\":%" PRIu64 ",\"min\":%" PRIu32
+                      ",\"max\":%" PRIu32 ",\"p50\":%" PRIu32 ",\"p90\":%" PRIu32
+                      ",\"p99\":%" PRIu32 ",\"buckets\":[",
+                 h->count, h->sum, h->min, h->max,
+                 devproto_stats_hist_quantile(h, 0.50),
+                 devproto_stats_hist_quantile(h, 0.90),
+                 devproto_stats_hist_quantile(h, 0.99));
+
+    int first = 1;
+    for (size_t i = 0; i < DEVPROTO_STATS_HIST_BUCKETS; i++) {
+        if (h->buckets[i] == 0) continue;
+        stats_printf(out, "%s[%" PRIu32 ",%" PRIu64 "]", first ? "" : ",",
+                     devproto_stats_bucket_lower(i), h->buckets[i]);
+        first = 0;
+    }
+    stats_printf(out, "]}");
+}
+
+/**
+ * JSON exporter
+ */
+int devproto_stats_format_json(const devproto_stats_snapshot_t *snaps,
+                               const char *const *names, size_t n,
+                               char *buf, size_t cap)
+{
+    if ((!snaps && n > 0) || (!names && n > 0) || !buf || cap == 0) return -1;
+
+    stats_out_t out = { buf, cap, 0, 0 };
+    buf[0] = '\0';
+
+    stats_printf(&out, "{\"connections\":[");
+    for (size_t i = 0; i < n; i++) {
+        stats_printf(&out, "%s{\"conn\":\"", i ? "," : "");
+        stats_escape(&out, names[i], 1);
+        stats_printf(&out, "\"");
+        for (size_t c = 0; c < STATS_COUNTERS; c++) {
+            stats_printf(&out, ",\"%s\":%" PRIu64, stats_counters[c].key,
+                         stats_counter(&snaps[i], c));
+        }
+
+        stats_printf(&out, ",\"parse_cycles\":");
+        stats_json_hist(&out, &snaps[i].parse_cycles);
+
+        stats_printf(&out, ",\"rtt_us\":{");
+        int first = 1;
+        for (size_t t = 0; t < DEVPROTO_STATS_RTT_TYPES; t++) {
+            if (snaps[i].rtt_us[t].count == 0) continue;
+            if (t == 0) stats_printf(&out, "%s\"other\":", first ? "" : ",");
+            else stats_printf(&out, "%s\"0x%02x\":", first ? "" : ",", (unsigned)t);
+            stats_json_hist(&out, &snaps[i].rtt_us[t]);
+            first = 0;
+        }
+        stats_printf(&out, "}}");
+    }
+    stats_printf(&out, "]}\n");
+
+    return stats_out_done(&out);
+}
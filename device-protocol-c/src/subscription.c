@@ -0,0 +1,371 @@
+/**
+ * @file subscription.c
+ * @brief Device-side metric subscription state, timers and push
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "devproto/subscription.h"
+#include "devproto/send.h"
+#include "devproto/error.h"
+
+#define SUB_HEADER_SIZE     7       /* id + period + holdoff */
+#define SUB_ENTRY_SIZE      5       /* type + float */
+#define SUB_EVENT_MAX       (1 + DEVPROTO_SUB_MAX_METRICS * SUB_ENTRY_SIZE)
+
+typedef struct {
+    int      active;
+    uint8_t  id;
+    uint32_t period_ms;
+    uint16_t holdoff_ms;
+    size_t   count;
+    uint8_t  types[DEVPROTO_SUB_MAX_METRICS];
+    float    deadband[DEVPROTO_SUB_MAX_METRICS];
+    float    reported[DEVPROTO_SUB_MAX_METRICS];    /* Last value sent */
+    uint8_t  sent[DEVPROTO_SUB_MAX_METRICS];        /* reported[] is valid */
+    uint8_t  dirty[DEVPROTO_SUB_MAX_METRICS];       /* Beyond deadband */
+    size_t   num_dirty;
+    int64_t  next_period_ms;
+    int64_t  last_change_ms;                        /* Last change report */
+    uint8_t  payload[SUB_EVENT_MAX];
+} sub_entry_t;
+
+struct devproto_sub_manager {
+    sub_entry_t subs[DEVPROTO_SUB_MAX];
+    size_t   active;
+    float    current[256];
+    uint8_t  have[256];
+};
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+static int64_t sub_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Build SUBSCRIBE payload
+ */
+int devproto_subscribe_build(uint8_t sub_id, uint32_t period_ms, uint16_t holdoff_ms,
+                             const devproto_metric_t *set, size_t num,
+                             uint8_t *buffer, size_t buf_size)
+{
+    if (!buffer || (!set && num > 0) || num > DEVPROTO_SUB_MAX_METRICS) return -1;
+
+    size_t needed = SUB_HEADER_SIZE + num * SUB_ENTRY_SIZE;
+    if (buf_size < needed) return -1;
+
+    buffer[0] = sub_id;
+    buffer[1] = (period_ms >> 24) & 0xFF;
+    buffer[2] = (period_ms >> 16) & 0xFF;
+    buffer[3] = (period_ms >> 8) & 0xFF;
+    buffer[4] = period_ms & 0xFF;
+    buffer[5] = (holdoff_ms >> 8) & 0xFF;
+    buffer[6] = holdoff_ms & 0xFF;
+
+    if (num > 0 && devproto_metrics_build(set, num, buffer + SUB_HEADER_SIZE,
+                                          buf_size - SUB_HEADER_SIZE) < 0) {
+        return -1;
+    }
+
+    return (int)needed;
+}
+
+/**
+ * Parse METRICS_EVENT
+ */
+int devproto_metrics_event_parse(const devproto_message_t *msg, uint8_t *sub_id,
+                                 devproto_metric_t *metrics, size_t max_metrics)
+{
+    if (!msg || !sub_id || msg->msg_type != DEVPROTO_MSG_METRICS_EVENT) return -1;
+    if (!msg->payload || msg->payload_len < 1) return -1;
+
+    *sub_id = msg->payload[0];
+    if (msg->payload_len == 1) return 0;
+
+    return devproto_metrics_parse(msg->payload + 1, msg->payload_len - 1u,
+                                  metrics, max_metrics);
+}
+
+/**
+ * Create manager
+ */
+devproto_sub_manager_t *devproto_sub_create(void)
+{
+    return calloc(1, sizeof(devproto_sub_manager_t));
+}
+
+/**
+ * Destroy manager
+ */
+void devproto_sub_destroy(devproto_sub_manager_t *mgr)
+{
+    free(mgr);
+}
+
+/**
+ * Find a subscription by id, or a free slot when id is not present
+ */
+static sub_entry_t *sub_lookup(devproto_sub_manager_t *mgr, uint8_t id, int allocate)
+{
+    sub_entry_t *free_slot = NULL;
+
+    for (int i = 0; i < DEVPROTO_SUB_MAX; i++) {
+        sub_entry_t *sub = &mgr->subs[i];
+        if (sub->active && sub->id == id) return sub;
+        if (!sub->active && !free_slot) free_slot = sub;
+    }
+    return allocate ? free_slot : NULL;
+}
+
+/**
+ * Parse a SUBSCRIBE payload into a slot
+ * Returns 0 on success, -1 if malformed.
+ */
+static int sub_parse(sub_entry_t *sub, const uint8_t *p, size_t len)
+{
+    size_t entries = (len - SUB_HEADER_SIZE) / SUB_ENTRY_SIZE;
+    if ((len - SUB_HEADER_SIZE) % SUB_ENTRY_SIZE || entries > DEVPROTO_SUB_MAX_METRICS) {
+        return -1;
+    }
+
+    devproto_metric_t set[DEVPROTO_SUB_MAX_METRICS];
+    if (entries > 0 &&
+        devproto_metrics_parse(p + SUB_HEADER_SIZE, len - SUB_HEADER_SIZE, set,
+                               DEVPROTO_SUB_MAX_METRICS) != (int)entries) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < entries; i++) {
+        if (!(set[i].value >= 0.0f)) return -1;
+    }
+
+    memset(sub, 0, sizeof(*sub));
+    sub->id = p[0];
+    sub->period_ms = ((uint32_t)p[1] << 24) | ((uint32_t)p[2] << 16) |
+                     ((uint32_t)p[3] << 8) | (uint32_t)p[4];
+    sub->holdoff_ms = (uint16_t)(((uint16_t)p[5] << 8) | p[6]);
+    sub->count = entries;
+
+    for (size_t i = 0; i < entries; i++) {
+        sub->types[i] = (uint8_t)set[i].type;
+        sub->deadband[i] = set[i].value;
+    }
+    return 0;
+}
+
+/**
+ * Handle SUBSCRIBE
+ */
+int devproto_sub_handle(devproto_sub_manager_t *mgr, const devproto_message_t *request,
+                        devproto_message_t *ack, uint8_t *ack_buf)
+{
+    if (!mgr || !request || !ack || !ack_buf) return DEVPROTO_ERR_INVALID;
+    if (request->msg_type != DEVPROTO_MSG_SUBSCRIBE) return DEVPROTO_ERR_INVALID;
+
+    int status = DEVPROTO_SUB_STATUS_REJECT;
+    uint8_t id = 0;
+
+    if (request->payload && request->payload_len >= SUB_HEADER_SIZE) {
+        const uint8_t *p = request->payload;
+        size_t len = request->payload_len;
+        sub_entry_t parsed;
+
+        id = p[0];
+        if (sub_parse(&parsed, p, len) == 0) {
+            sub_entry_t *sub = sub_lookup(mgr, id, parsed.count > 0);
+
+            if (parsed.count == 0) {
+                /* Cancel (unknown ids are accepted as already cancelled) */
+                if (sub) {
+                    sub->active = 0;
+                    mgr->active--;
+                }
+                status = DEVPROTO_SUB_STATUS_OK;
+            } else if (sub) {
+                if (!sub->active) mgr->active++;
+                *sub = parsed;
+                sub->active = 1;
+
+                /* First report goes out on the next poll */
+                int64_t now = sub_now_ms();
+                sub->next_period_ms = now;
+                sub->last_change_ms = now - sub->holdoff_ms;
+                status = DEVPROTO_SUB_STATUS_OK;
+            }
+        }
+    }
+
+    ack_buf[0] = (uint8_t)status;
+    ack_buf[1] = id;
+    ack->msg_type = DEVPROTO_MSG_SUBSCRIBE_ACK;
+    ack->sequence = request->sequence;
+    ack->payload = ack_buf;
+    ack->payload_len = DEVPROTO_SUB_ACK_SIZE;
+
+    return status == DEVPROTO_SUB_STATUS_OK ? 0 : -1;
+}
+
+/**
+ * Feed samples
+ */
+void devproto_sub_update(devproto_sub_manager_t *mgr, const devproto_metric_t *metrics,
+                         size_t num)
+{
+    if (!mgr || (!metrics && num > 0)) return;
+
+    for (size_t i = 0; i < num; i++) {
+        if ((unsigned)metrics[i].type > 0xFF) continue;
+        mgr->current[metrics[i].type] = metrics[i].value;
+        mgr->have[metrics[i].type] = 1;
+    }
+
+    for (int s = 0; s < DEVPROTO_SUB_MAX; s++) {
+        sub_entry_t *sub = &mgr->subs[s];
+        if (!sub->active) continue;
+
+        for (size_t i = 0; i < sub->count; i++) {
+            uint8_t t = sub->types[i];
+            if (!mgr->have[t] || sub->dirty[i]) continue;
+
+            float v = mgr->current[t];
+            float r = sub->reported[i];
+            int changed = !sub->sent[i] ||
+                          (isnan(v) != isnan(r)) ||
+                          (!isnan(v) && fabsf(v - r) > sub->deadband[i]);
+            if (changed) {
+                sub->dirty[i] = 1;
+                sub->num_dirty++;
+            }
+        }
+    }
+}
+
+/**
+ * Encode an event payload for a subscription
+ * @param all  Include every sampled metric (periodic report) or only dirty ones
+ */
+static uint16_t sub_build_event(devproto_sub_manager_t *mgr, sub_entry_t *sub, int all)
+{
+    size_t off = 0;
+    sub->payload[off++] = sub->id;
+
+    for (size_t i = 0; i < sub->count; i++) {
+        uint8_t t = sub->types[i];
+        if (!mgr->have[t] || (!all && !sub->dirty[i])) continue;
+
+        float v = mgr->current[t];
+        sub->payload[off] = t;
+        devproto_float_to_be(v, &sub->payload[off + 1]);
+        off += SUB_ENTRY_SIZE;
+
+        sub->reported[i] = v;
+        sub->sent[i] = 1;
+        sub->dirty[i] = 0;
+    }
+
+    /* Only sampled metrics are ever dirty, so all of them went out */
+    sub->num_dirty = 0;
+    return (uint16_t)off;
+}
+
+/**
+ * Send due events
+ */
+int devproto_sub_poll(devproto_sub_manager_t *mgr, devproto_transport_t *t)
+{
+    if (!mgr || !t) return -1;
+    if (mgr->active == 0) return 0;
+
+    devproto_message_t events[DEVPROTO_SUB_MAX];
+    size_t n = 0;
+    int64_t now = sub_now_ms();
+
+    for (int s = 0; s < DEVPROTO_SUB_MAX; s++) {
+        sub_entry_t *sub = &mgr->subs[s];
+        if (!sub->active) continue;
+
+        int periodic = sub->period_ms > 0 && now >= sub->next_period_ms;
+        int change = !periodic && sub->num_dirty > 0 &&
+                     now - sub->last_change_ms >= sub->holdoff_ms;
+        if (!periodic && !change) continue;
+
+        uint16_t len = sub_build_event(mgr, sub, periodic);
+        if (periodic) {
+            /* Stay on the period grid unless we fell more than a period behind */
+            sub->next_period_ms += sub->period_ms;
+            if (sub->next_period_ms <= now) sub->next_period_ms = now + sub->period_ms;
+        } else {
+            sub->last_change_ms = now;
+        }
+        if (len <= 1) continue;
+
+        events[n].msg_type = DEVPROTO_MSG_METRICS_EVENT;
+        events[n].sequence = 0;
+        events[n].payload = sub->payload;
+        events[n].payload_len = len;
+        n++;
+    }
+
+    if (n == 0) return 0;
+
+    int sent = devproto_send_batch(t, events, n, NULL);
+    return sent < (int)n ? -1 : sent;
+}
+
+/**
+ * Time until next due event
+ */
+int devproto_sub_next_timeout(const devproto_sub_manager_t *mgr)
+{
+    if (!mgr || mgr->active == 0) return -1;
+
+    int64_t now = sub_now_ms();
+    int64_t earliest = -1;
+
+    for (int s = 0; s < DEVPROTO_SUB_MAX; s++) {
+        const sub_entry_t *sub = &mgr->subs[s];
+        if (!sub->active) continue;
+
+        if (sub->period_ms > 0 && (earliest < 0 || sub->next_period_ms < earliest)) {
+            earliest = sub->next_period_ms;
+        }
+        if (sub->num_dirty > 0) {
+            int64_t due = sub->last_change_ms + sub->holdoff_ms;
+            if (earliest < 0 || due < earliest) earliest = due;
+        }
+    }
+
+    if (earliest < 0) return -1;
+
+    int64_t left = earliest - now;
+    if (left <= 0) return 0;
+    return left > INT32_MAX ? INT32_MAX : (int)left;
+}
+
+/**
+ * Active subscriptions
+ */
+size_t devproto_sub_count(const devproto_sub_manager_t *mgr)
+{
+    return mgr ? mgr->active : 0;
+}
+
+/**
+ * Drop all subscriptions
+ */
+void devproto_sub_clear(devproto_sub_manager_t *mgr)
+{
+    if (!mgr) return;
+
+    for (int s = 0; s < DEVPROTO_SUB_MAX; s++) {
+        mgr->subs[s].active = 0;
+    }
+    mgr->active = 0;
+}
@@ -4,7 +4,12 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "devproto/transport.h"
+#include "devproto/protocol.h"
+#include "devproto/compress.h"
+#include "devproto/stats.h"
+#include "devproto/capture.h"
 
 /**
  * Destroy transport and free resources
@@ -13,16 +18,170 @@ void devproto_transport_destroy(devproto_transport_t *t)
 {
     if (!t) return;
 
-    /* Close if still open */
-    if (t->is_open && t->ops && t->ops->close) {
+    /* Close if still open (or half-closed by the peer, fd still held) */
+    if ((t->is_open || t->fd >= 0) && t->ops && t->ops->close) {
         t->ops->close(t);
     }
 
     /* Free private data if allocated */
-    if (t->priv) {
+    if (t->priv && t->ops && t->ops->destroy) {
+        t->ops->destroy(t);
+    } else if (t->priv) {
         free(t->priv);
         t->priv = NULL;
     }
 
+    free(t->compress);
     free(t);
 }
+
+/**
+ * Send scatter-gather data, falling back to send() for ops without sendv
+ */
+int devproto_transport_sendv(devproto_transport_t *t,
+                             const struct iovec *iov, int iovcnt)
+{
+    if (!t || !t->ops || !iov || iovcnt < 0) return -1;
+
+    if (t->ops->sendv) {
+        int n = t->ops->sendv(t, iov, iovcnt);
+        if (t->stats) {
+            size_t requested = 0;
+            for (int i = 0; i < iovcnt; i++) requested += iov[i].iov_len;
+            devproto_stats_record_send(t->stats, requested, n);
+        }
+        if (t->capture && n > 0) {
+            devproto_capture_recordv(t->capture, t->capture_conn, DEVPROTO_CAPTURE_OUT,
+                                     iov, iovcnt, (size_t)n);
+        }
+        return n;
+    }
+    if (!t->ops->send) return -1;
+
+    /* Pack consecutive buffers into frame-sized sends; oversized go direct */
+    uint8_t buffer[DEVPROTO_MAX_FRAME_SIZE];
+    size_t sent = 0;
+    int i = 0;
+
+    while (i < iovcnt) {
+        const uint8_t *data = iov[i].iov_base;
+        size_t len = iov[i].iov_len;
+
+        if (len <= sizeof(buffer)) {
+            len = 0;
+            while (i < iovcnt && len + iov[i].iov_len <= sizeof(buffer)) {
+                memcpy(buffer + len, iov[i].iov_base, iov[i].iov_len);
+                len += iov[i].iov_len;
+                i++;
+            }
+            data = buffer;
+        } else {
+            i++;
+        }
+
+        if (sent + len > (size_t)INT32_MAX) return -1;
+
+        int n = t->ops->send(t, data, len);
+        if (t->stats) devproto_stats_record_send(t->stats, len, n);
+        if (t->capture && n > 0) {
+            devproto_capture_record(t->capture, t->capture_conn, DEVPROTO_CAPTURE_OUT,
+                                    data, (size_t)n);
+        }
+        if (n < 0) return sent > 0 ? (int)sent : -1;
+
+        sent += (size_t)n;
+        if ((size_t)n < len) break;  /* Partial write */
+    }
+
+    return (int)sent;
+}
+
+/**
+ * Set negotiated payload limit
+ */
+int devproto_transport_set_max_payload(devproto_transport_t *t, size_t max_payload)
+{
+    if (!t) return -1;
+    if (max_payload < DEVPROTO_MAX_PAYLOAD_SIZE ||
+        max_payload > DEVPROTO_JUMBO_MAX_PAYLOAD) {
+        return -1;
+    }
+
+    t->max_payload = max_payload;
+    return 0;
+}
+
+/**
+ * Attach or detach telemetry
+ */
+int devproto_transport_set_stats(devproto_transport_t *t, devproto_stats_t *st)
+{
+    if (!t) return -1;
+
+    t->stats = st;
+    return 0;
+}
+
+/**
+ * Record a send with the attached telemetry and capture
+ */
+void devproto_transport_tap_send(devproto_transport_t *t, const uint8_t *data,
+                                 size_t len, int n)
+{
+    if (t->stats) devproto_stats_record_send(t->stats, len, n);
+    if (t->capture && n > 0) {
+        devproto_capture_record(t->capture, t->capture_conn, DEVPROTO_CAPTURE_OUT,
+                                data, (size_t)n);
+    }
+}
+
+/**
+ * Record a receive with the attached telemetry and capture
+ */
+void devproto_transport_tap_recv(devproto_transport_t *t, const uint8_t *data, int n)
+{
+    if (t->stats) devproto_stats_record_recv(t->stats, n);
+    if (t->capture && n > 0) {
+        devproto_capture_record(t->capture, t->capture_conn, DEVPROTO_CAPTURE_IN,
+                                data, (size_t)n);
+    }
+}
+
+/**
+ * Attach or detach a recording tap
+ */
+int devproto_transport_set_capture(devproto_transport_t *t, devproto_capture_t *cap,
+                                   uint16_t conn)
+{
+    if (!t) return -1;
+
+    t->capture = cap;
+    t->capture_conn = conn;
+    return 0;
+}
+
+/**
+ * Enable or disable negotiated compression
+ */
+int devproto_transport_set_compression(devproto_transport_t *t,
+                                       const devproto_compress_config_t *cfg)
+{
+    if (!t) return -1;
+
+    if (!cfg) {
+        free(t->compress);
+        t->compress = NULL;
+        return 0;
+    }
+
+    if (!cfg->pool || cfg->codec < DEVPROTO_CODEC_NONE || cfg->codec > DEVPROTO_CODEC_LZ4) {
+        return -1;
+    }
+
+    if (!t->compress) {
+        t->compress = malloc(sizeof(*t->compress));
+        if (!t->compress) return -1;
+    }
+    *t->compress = *cfg;
+    return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file transport_replay.c
+ * @brief Transport replaying one connection of a capture file
+ *
+ * Receives copy straight out of the mapped capture, one record (or the
+ * part of it that fits) per call, so the only copy is the one a socket
+ * read would make too.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+#include "devproto/transport.h"
+#include "devproto/capture.h"
+#include "devproto/stats.h"
+
+/**
+ * Replay transport private data
+ */
+typedef struct {
+    const devproto_capture_reader_t *reader;
+    devproto_replay_config_t cfg;
+
+    size_t   cursor;                    /* Next record to look at */
+    devproto_capture_entry_t cur;       /* Record being returned */
+    size_t   cur_off;                   /* Bytes of cur already returned */
+    int      has_cur;
+
+    uint64_t first_us;                  /* Capture time of the first record */
+    int      have_first;
+    uint64_t start_us;                  /* Monotonic time at open */
+} replay_priv_t;
+
+/**
+ * Load the next record of the replayed connection and direction
+ * Returns 1 for a record, 0 at the end, -1 if the capture is damaged.
+ */
+static int replay_load(replay_priv_t *p)
+{
+    for (;;) {
+        int ret = devproto_capture_reader_next(p->reader, &p->cursor, &p->cur);
+        if (ret <= 0) return ret;
+        if (p->cur.conn != p->cfg.conn || p->cur.dir != p->cfg.dir) continue;
+
+        if (!p->have_first) {
+            p->first_us = p->cur.time_us;
+            p->have_first = 1;
+        }
+        p->cur_off = 0;
+        p->has_cur = 1;
+        return 1;
+    }
+}
+
+/**
+ * Microseconds until the current record is due (0 = now)
+ */
+static uint64_t replay_wait_us(const replay_priv_t *p)
+{
+    if (p->cfg.speed <= 0) return 0;
+
+    uint64_t due = p->start_us +
+                   (uint64_t)((double)(p->cur.time_us - p->first_us) / p->cfg.speed);
+    uint64_t now = devproto_stats_now_us();
+    return now < due ? due - now : 0;
+}
+
+static void replay_sleep_us(uint64_t us)
+{
+    struct timespec ts = {
+        .tv_sec = (time_t)(us / 1000000u),
+        .tv_nsec = (long)(us % 1000000u) * 1000
+    };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+/**
+ * Start the replay over
+ */
+static int replay_open(devproto_transport_t *t)
+{
+    replay_priv_t *p = (replay_priv_t *)t->priv;
+
+    p->cursor = 0;
+    p->has_cur = 0;
+    p->have_first = 0;
+    p->start_us = devproto_stats_now_us();
+    t->is_open = 1;
+    return 0;
+}
+
+static void replay_close(devproto_transport_t *t)
+{
+    t->is_open = 0;
+}
+
+/**
+ * Accept and drop outgoing data
+ */
+static int replay_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+{
+    (void)data;
+    if (!t->is_open) return -1;
+    return len > INT_MAX ? INT_MAX : (int)len;
+}
+
+/**
+ * Return the next recorded chunk once it is due
+ */
+static int replay_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms)
+{
+    replay_priv_t *p = (replay_priv_t *)t->priv;
+    if (!t->is_open) return -1;
+
+    if (!p->has_cur) {
+        int ret = replay_load(p);
+        if (ret <= 0) {
+            /* End of the recording: the peer hung up */
+            if (ret < 0) errno = EIO;
+            t->is_open = 0;
+            return -1;
+        }
+    }
+
+    uint64_t wait = replay_wait_us(p);
+    if (wait > 0) {
+        if (timeout_ms >= 0 && wait > (uint64_t)timeout_ms * 1000u) {
+            if (timeout_ms > 0) replay_sleep_us((uint64_t)timeout_ms * 1000u);
+            return 0;
+        }
+        replay_sleep_us(wait);
+    }
+
+    size_t n = p->cur.len - p->cur_off;
+    if (n > len) n = len;
+    if (n > INT_MAX) n = INT_MAX;
+    memcpy(data, p->cur.data + p->cur_off, n);
+
+    p->cur_off += n;
+    if (p->cur_off == p->cur.len) p->has_cur = 0;
+    return (int)n;
+}
+
+/**
+ * Get bytes of the current record that are due
+ */
+static int replay_available(devproto_transport_t *t)
+{
+    replay_priv_t *p = (replay_priv_t *)t->priv;
+    if (!t->is_open) return -1;
+    if (!p->has_cur || replay_wait_us(p) > 0) return 0;
+
+    size_t n = p->cur.len - p->cur_off;
+    return n > INT_MAX ? INT_MAX : (int)n;
+}
+
+static int replay_flush(devproto_transport_t *t)
+{
+    (void)t;
+    return 0;
+}
+
+static const devproto_transport_ops_t replay_ops = {
+    .open      = replay_open,
+    .close     = replay_close,
+    .send      = replay_send,
+    .recv      = replay_recv,
+    .available = replay_available,
+    .flush     = replay_flush
+};
+
+/**
+ * Create replay transport
+ */
+devproto_transport_t *devproto_transport_replay_create(const devproto_capture_reader_t *r,
+                                                       const devproto_replay_config_t *cfg)
+{
+    if (!r || !cfg || cfg->dir > DEVPROTO_CAPTURE_OUT || !(cfg->speed >= 0)) return NULL;
+
+    devproto_transport_t *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+
+    replay_priv_t *priv = calloc(1, sizeof(*priv));
+    if (!priv) {
+        free(t);
+        return NULL;
+    }
+
+    priv->reader = r;
+    priv->cfg = *cfg;
+
+    t->type = DEVPROTO_TRANSPORT_REPLAY;
+    t->ops = &replay_ops;
+    t->priv = priv;
+    t->fd = -1;
+    t->is_open = 0;
+
+    return t;
+}
@@ -1,24 +1,72 @@
 /**
  * @file transport_serial.c
  * @brief Serial/UART transport implementation using termios
+ *
+ * Receives go through an optional read-ahead buffer: one read() pulls in
+ * everything the driver holds (up to the buffer size) and later receives
+ * are served from memory until it is empty. Blocking receives can also ask
+ * the driver to collect a whole frame first (VMIN from a read hint), which
+ * needs the fd in blocking mode. Receives with a timeout keep the fd
+ * blocking and zero-timeout (reactor) receives keep it non-blocking; the
+ * mode and VMIN are only rewritten when they change.
+ *
+ * Sends put the fd in non-blocking mode and wait with poll(), so a write
+ * never outlasts the write timeout. Whatever does not go out goes into an
+ * outgoing queue of two rings, one per priority class, holding
+ * length-prefixed units (one send call each); alerts and faults are written
+ * before queued bulk units, but never in the middle of one.
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <time.h>
 #include <termios.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 
+#if defined(__linux__)
+#include <linux/serial.h>
+#endif
+
+#include "devproto/protocol.h"
 #include "devproto/transport.h"
+#include "serial_baud.h"
 
 /* CRTSCTS is not defined on all systems (non-POSIX extension) */
 #ifndef CRTSCTS
 #define CRTSCTS 0
 #endif
 
+/* VMIN is a cc_t; the driver cannot wait for more than this */
+#define SERIAL_VMIN_MAX 255
+
+/* Largest iovec list accepted by serial_sendv() */
+#define SERIAL_IOV_MAX  64
+
+/* Outgoing priority classes, highest first */
+#define SERIAL_TX_HIGH      0           /* Alerts, threshold events, faults */
+#define SERIAL_TX_NORMAL    1           /* Everything else */
+#define SERIAL_TX_CLASSES   2
+
+/* Length prefix of a queued unit */
+#define SERIAL_UNIT_HDR     4
+
+/**
+ * Byte ring of one outgoing priority class
+ */
+typedef struct {
+    uint8_t *buf;                       /* Allocated on first use */
+    size_t   cap;
+    size_t   head;                      /* Offset of first queued byte */
+    size_t   len;                       /* Queued bytes, prefixes included */
+} serial_ring_t;
+
 /**
  * Serial transport private data
  */
@@ -27,26 +75,122 @@ typedef struct {
     int  baudrate;
     struct termios orig_termios;
     int  termios_saved;
+
+    int  low_latency;
+    int  inter_byte_ms;
+    struct termios tty;                 /* Settings currently applied */
+    int  blocking;                      /* O_NONBLOCK cleared */
+    size_t read_hint;                   /* Bytes the caller expects next */
+
+    /* Read-ahead buffer */
+    uint8_t *rx_buf;
+    size_t   rx_cap;
+    size_t   rx_head;                   /* Offset of first unread byte */
+    size_t   rx_len;                    /* Unread bytes */
+
+    /* Send behaviour */
+    int     write_timeout_ms;           /* Blocking send wait, -1 = forever */
+    int     nonblocking;                /* Queue instead of waiting */
+    size_t  queue_max;                  /* Limit of each priority ring */
+
+    /* Outgoing queue */
+    serial_ring_t txq[SERIAL_TX_CLASSES];
+    int     tx_class;                   /* Class of the unit in flight */
+    size_t  tx_left;                    /* Unwritten bytes of the unit in flight */
+    size_t  tx_queued;                  /* Unwritten bytes of all units */
 } serial_priv_t;
 
 /**
- * Convert baudrate to termios speed constant
+ * Convert baudrate to termios speed constant (B0 if there is none)
  */
 static speed_t baudrate_to_speed(int baudrate)
 {
     switch (baudrate) {
-    case 9600:   return B9600;
-    case 19200:  return B19200;
-    case 38400:  return B38400;
-    case 57600:  return B57600;
-    case 115200: return B115200;
-    case 230400: return B230400;
-    case 460800: return B460800;
-    case 921600: return B921600;
-    default:     return B115200;
+    case 1200:    return B1200;
+    case 2400:    return B2400;
+    case 4800:    return B4800;
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+#ifdef B460800
+    case 460800:  return B460800;
+#endif
+#ifdef B500000
+    case 500000:  return B500000;
+#endif
+#ifdef B921600
+    case 921600:  return B921600;
+#endif
+#ifdef B1000000
+    case 1000000: return B1000000;
+#endif
+#ifdef B1500000
+    case 1500000: return B1500000;
+#endif
+#ifdef B2000000
+    case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+    case 3000000: return B3000000;
+#endif
+    default:      return B0;
     }
 }
 
+/**
+ * Ask the driver to push received bytes to user space without delay
+ */
+static void serial_set_low_latency(int fd)
+{
+#if defined(__linux__) && defined(ASYNC_LOW_LATENCY)
+    struct serial_struct ss;
+
+    /* Not every driver (e.g. some USB adapters) implements this; best effort */
+    if (ioctl(fd, TIOCGSERIAL, &ss) == 0) {
+        ss.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &ss);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+/**
+ * Switch the fd between blocking (VMIN reads) and non-blocking mode
+ */
+static int serial_set_blocking(devproto_transport_t *t, int blocking)
+{
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+    if (priv->blocking == blocking) return 0;
+
+    int flags = fcntl(t->fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    if (fcntl(t->fd, F_SETFL, flags) != 0) return -1;
+
+    priv->blocking = blocking;
+    return 0;
+}
+
+/**
+ * Apply VMIN (VTIME stays the inter-byte gap); skipped if unchanged
+ */
+static int serial_set_vmin(devproto_transport_t *t, cc_t vmin)
+{
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+    if (priv->tty.c_cc[VMIN] == vmin) return 0;
+
+    struct termios tty = priv->tty;
+    tty.c_cc[VMIN] = vmin;
+    if (tcsetattr(t->fd, TCSANOW, &tty) != 0) return -1;
+
+    priv->tty = tty;
+    return 0;
+}
+
 /**
  * Open serial port
  */
@@ -71,15 +215,15 @@ static int serial_open(devproto_transport_t *t)
 
     /* Get current attributes */
     if (tcgetattr(t->fd, &tty) != 0) {
-        close(t->fd);
-        t->fd = -1;
-        return -1;
+        goto error;
     }
 
-    /* Set baud rate */
+    /* Set baud rate (non-standard rates are applied after tcsetattr) */
     speed_t speed = baudrate_to_speed(priv->baudrate);
-    cfsetispeed(&tty, speed);
-    cfsetospeed(&tty, speed);
+    if (speed != B0) {
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+    }
 
     /* 8N1 mode */
     tty.c_cflag &= ~PARENB;        /* No parity */
@@ -103,22 +247,448 @@ static int serial_open(devproto_transport_t *t)
     tty.c_iflag &= ~(IXON | IXOFF | IXANY);
     tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
 
-    /* Read timeout: VMIN=0, VTIME=1 = 100ms timeout */
+    /* VMIN=0 until a read hint arrives; VTIME is the inter-byte gap (0.1 s units) */
+    int vtime = (priv->inter_byte_ms + 99) / 100;
     tty.c_cc[VMIN] = 0;
-    tty.c_cc[VTIME] = 1;
+    tty.c_cc[VTIME] = (cc_t)(vtime < 1 ? 1 : vtime > 255 ? 255 : vtime);
 
     /* Apply settings */
     if (tcsetattr(t->fd, TCSANOW, &tty) != 0) {
-        close(t->fd);
-        t->fd = -1;
-        return -1;
+        goto error;
+    }
+    priv->tty = tty;
+
+    if (speed == B0 && devproto_serial_set_custom_baud(t->fd, priv->baudrate) != 0) {
+        goto error;
+    }
+
+    if (priv->low_latency) {
+        serial_set_low_latency(t->fd);
     }
 
     /* Flush buffers */
     tcflush(t->fd, TCIOFLUSH);
 
+    priv->blocking = 0;
+    priv->rx_head = priv->rx_len = 0;
     t->is_open = 1;
     return 0;
+
+error:
+    {
+        int saved = errno;
+        close(t->fd);
+        t->fd = -1;
+        errno = saved;
+    }
+    return -1;
+}
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+static int64_t serial_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Wait until the port is writable or the deadline passes (-1 = none)
+ * Returns 1 if writable, 0 on timeout, -1 on error.
+ */
+static int serial_wait_writable(int fd, int64_t deadline_ms)
+{
+    for (;;) {
+        int timeout = -1;
+        if (deadline_ms >= 0) {
+            int64_t left = deadline_ms - serial_now_ms();
+            timeout = left > 0 ? (int)left : 0;
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        int ret = poll(&pfd, 1, timeout);
+
+        if (ret > 0) {
+            return (pfd.revents & (POLLERR | POLLNVAL)) ? -1 : 1;
+        } else if (ret == 0) {
+            return 0;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * Write as much of an iovec list as the driver takes without blocking,
+ * advancing the list past what was written.
+ * Returns bytes written (0 if the output buffer is full), or -1 on error.
+ */
+static ssize_t serial_write_some(int fd, struct iovec **iov, int *iovcnt)
+{
+    size_t total = 0;
+
+    while (*iovcnt > 0) {
+        ssize_t n = writev(fd, *iov, *iovcnt);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+
+        total += (size_t)n;
+
+        /* Skip fully written entries, trim the partially written one */
+        size_t skip = (size_t)n;
+        while (*iovcnt > 0 && skip >= (*iov)->iov_len) {
+            skip -= (*iov)->iov_len;
+            (*iov)++;
+            (*iovcnt)--;
+        }
+        if (*iovcnt > 0) {
+            (*iov)->iov_base = (uint8_t *)(*iov)->iov_base + skip;
+            (*iov)->iov_len -= skip;
+        }
+    }
+
+    return (ssize_t)total;
+}
+
+/**
+ * Make room for need more bytes in a ring holding at most limit bytes.
+ * The ring is allocated (at the full limit) on first use.
+ * Returns 0 on success, -1 if the bytes do not fit.
+ */
+static int serial_ring_reserve(serial_ring_t *r, size_t need, size_t limit)
+{
+    if (r->len + need > limit) return -1;
+    if (r->cap - r->len >= need) return 0;
+
+    uint8_t *buf = malloc(limit);
+    if (!buf) return -1;
+
+    /* Unwrap the queued bytes into the new buffer */
+    size_t first = r->cap - r->head < r->len ? r->cap - r->head : r->len;
+    if (r->len > 0) {
+        memcpy(buf, r->buf + r->head, first);
+        memcpy(buf + first, r->buf, r->len - first);
+    }
+
+    free(r->buf);
+    r->buf = buf;
+    r->cap = limit;
+    r->head = 0;
+    return 0;
+}
+
+/**
+ * Append bytes to a ring (room must have been reserved)
+ */
+static void serial_ring_put(serial_ring_t *r, const uint8_t *src, size_t n)
+{
+    size_t tail = (r->head + r->len) % r->cap;
+    size_t first = r->cap - tail < n ? r->cap - tail : n;
+
+    memcpy(r->buf + tail, src, first);
+    memcpy(r->buf, src + first, n - first);
+    r->len += n;
+}
+
+/**
+ * Remove n bytes from the front of a ring, copying them to dst (may be NULL)
+ */
+static void serial_ring_take(serial_ring_t *r, uint8_t *dst, size_t n)
+{
+    if (dst) {
+        size_t first = r->cap - r->head < n ? r->cap - r->head : n;
+        memcpy(dst, r->buf + r->head, first);
+        memcpy(dst + first, r->buf, n - first);
+    }
+
+    r->head = (r->head + n) % r->cap;
+    r->len -= n;
+    if (r->len == 0) r->head = 0;
+}
+
+/**
+ * Priority class of a send: alerts and faults overtake bulk traffic
+ */
+static int serial_send_class(const struct iovec *iov, int iovcnt)
+{
+    uint8_t hdr[DEVPROTO_HEADER_SIZE];
+    size_t got = 0;
+
+    for (int i = 0; i < iovcnt && got < sizeof(hdr); i++) {
+        size_t n = iov[i].iov_len;
+        if (n > sizeof(hdr) - got) n = sizeof(hdr) - got;
+        memcpy(hdr + got, iov[i].iov_base, n);
+        got += n;
+    }
+
+    if (got < 5 || hdr[0] != DEVPROTO_HEADER_BYTE0 || hdr[1] != DEVPROTO_HEADER_BYTE1) {
+        return SERIAL_TX_NORMAL;
+    }
+
+    switch (hdr[4]) {
+    case DEVPROTO_MSG_ALERT_EVENT:
+    case DEVPROTO_MSG_THRESHOLD_EXCEEDED:
+    case DEVPROTO_MSG_HARDWARE_FAULT:
+        return SERIAL_TX_HIGH;
+    default:
+        return SERIAL_TX_NORMAL;
+    }
+}
+
+/**
+ * Queue a send: the unsent part of an iovec list becomes one unit of its
+ * class. A unit started on the wire (partial) is queued without a length
+ * prefix as the unit in flight, which must go out before anything else.
+ * Returns 0 on success, -1 if it does not fit.
+ */
+static int serial_queue_unit(serial_priv_t *priv, int cls, const struct iovec *iov,
+                             int iovcnt, size_t len, int in_flight)
+{
+    serial_ring_t *r = &priv->txq[cls];
+    size_t need = len + (in_flight ? 0 : SERIAL_UNIT_HDR);
+
+    /* The remainder of a started unit (queue idle) is accepted even if it
+     * exceeds the limit, otherwise the frame would be torn */
+    size_t limit = priv->queue_max;
+    if (in_flight && need > limit) limit = need;
+
+    if (serial_ring_reserve(r, need, limit) != 0) return -1;
+
+    if (in_flight) {
+        priv->tx_class = cls;
+        priv->tx_left = len;
+    } else {
+        uint8_t hdr[SERIAL_UNIT_HDR] = {
+            (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len
+        };
+        serial_ring_put(r, hdr, sizeof(hdr));
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        serial_ring_put(r, iov[i].iov_base, iov[i].iov_len);
+    }
+    priv->tx_queued += len;
+    return 0;
+}
+
+/**
+ * Pick the unit to write next: the one in flight, else the oldest
+ * high-priority unit, else the oldest normal one. Returns its class, or -1
+ * if the queue is empty.
+ */
+static int serial_queue_next(serial_priv_t *priv)
+{
+    if (priv->tx_left > 0) return priv->tx_class;
+
+    for (int cls = 0; cls < SERIAL_TX_CLASSES; cls++) {
+        serial_ring_t *r = &priv->txq[cls];
+        if (r->len == 0) continue;
+
+        uint8_t hdr[SERIAL_UNIT_HDR];
+        serial_ring_take(r, hdr, sizeof(hdr));
+        priv->tx_class = cls;
+        priv->tx_left = ((size_t)hdr[0] << 24) | ((size_t)hdr[1] << 16) |
+                        ((size_t)hdr[2] << 8) | hdr[3];
+        return cls;
+    }
+
+    return -1;
+}
+
+/**
+ * Flush the outgoing queue by priority, waiting until deadline_ms (-1 =
+ * forever, 0 = no wait). Returns bytes still queued, or -1 on error.
+ */
+static int serial_queue_flush(devproto_transport_t *t, int64_t deadline_ms)
+{
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+    int cls;
+
+    while ((cls = serial_queue_next(priv)) >= 0) {
+        serial_ring_t *r = &priv->txq[cls];
+
+        /* The unit may wrap around the end of the ring */
+        size_t first = r->cap - r->head < priv->tx_left ? r->cap - r->head : priv->tx_left;
+        struct iovec vec[2] = {
+            { .iov_base = r->buf + r->head, .iov_len = first },
+            { .iov_base = r->buf, .iov_len = priv->tx_left - first }
+        };
+        struct iovec *iov = vec;
+        int iovcnt = vec[1].iov_len > 0 ? 2 : 1;
+
+        ssize_t n = serial_write_some(t->fd, &iov, &iovcnt);
+        if (n < 0) return -1;
+
+        serial_ring_take(r, NULL, (size_t)n);
+        priv->tx_left -= (size_t)n;
+        priv->tx_queued -= (size_t)n;
+
+        if (priv->tx_left > 0) {
+            if (deadline_ms == 0) break;
+
+            int ready = serial_wait_writable(t->fd, deadline_ms);
+            if (ready < 0) return -1;
+            if (ready == 0) break;
+        }
+    }
+
+    return (int)priv->tx_queued;
+}
+
+/**
+ * Drop everything queued for sending
+ */
+static void serial_queue_reset(serial_priv_t *priv)
+{
+    for (int cls = 0; cls < SERIAL_TX_CLASSES; cls++) {
+        free(priv->txq[cls].buf);
+        memset(&priv->txq[cls], 0, sizeof(priv->txq[cls]));
+    }
+    priv->tx_left = 0;
+    priv->tx_queued = 0;
+}
+
+/**
+ * Send scatter-gather data over serial
+ *
+ * Each call is one unit that is never interleaved with another on the wire.
+ * Blocking mode writes the queue, then the unit, waiting for writability with
+ * poll() up to the write timeout; a unit cut short by the timeout is queued
+ * and finished first by the next send or drain. Non-blocking mode never
+ * waits: the unit is accepted whole into the queue (so an alert can overtake
+ * queued bulk units) or refused whole.
+ */
+static int serial_sendv(devproto_transport_t *t, const struct iovec *iov, int iovcnt)
+{
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+
+    if (!t->is_open || t->fd < 0) return -1;
+    if (iovcnt < 0 || iovcnt > SERIAL_IOV_MAX) return -1;
+
+    /* Local copy so partial writes can advance it */
+    struct iovec vec[SERIAL_IOV_MAX];
+    struct iovec *cur = vec;
+    int curcnt = iovcnt;
+    size_t len = 0;
+
+    for (int i = 0; i < iovcnt; i++) {
+        vec[i] = iov[i];
+        len += iov[i].iov_len;
+    }
+    if (len > (size_t)INT32_MAX) return -1;
+    if (len == 0) return 0;
+
+    /* Writes must never outlast the write timeout */
+    if (serial_set_blocking(t, 0) != 0) return -1;
+
+    int cls = serial_send_class(iov, iovcnt);
+
+    if (priv->nonblocking) {
+        if (priv->tx_queued > 0 && serial_queue_flush(t, 0) < 0) return -1;
+
+        if (priv->tx_queued > 0) {
+            if (serial_queue_unit(priv, cls, vec, iovcnt, len, 0) != 0) {
+                errno = EAGAIN;
+                return -1;
+            }
+            if (serial_queue_flush(t, 0) < 0) return -1;
+            return (int)len;
+        }
+
+        /* Idle: reserve the whole unit first so it is never torn */
+        if (serial_ring_reserve(&priv->txq[cls], len, priv->queue_max) != 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        ssize_t n = serial_write_some(t->fd, &cur, &curcnt);
+        if (n < 0) return -1;
+        if ((size_t)n < len) {
+            serial_queue_unit(priv, cls, cur, curcnt, len - (size_t)n, 1);
+        }
+        return (int)len;
+    }
+
+    int64_t deadline = -1;
+    if (priv->write_timeout_ms >= 0) {
+        deadline = serial_now_ms() + priv->write_timeout_ms;
+    }
+
+    /* Queued bytes go first to keep the stream in order */
+    if (priv->tx_queued > 0) {
+        int left = serial_queue_flush(t, deadline);
+        if (left < 0) return -1;
+        if (left > 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+
+    size_t total_sent = 0;
+
+    while (total_sent < len) {
+        ssize_t n = serial_write_some(t->fd, &cur, &curcnt);
+        if (n < 0) return -1;
+        total_sent += (size_t)n;
+
+        if (total_sent < len) {
+            /* Backpressure: sleep until writable rather than spinning */
+            int ready = serial_wait_writable(t->fd, deadline);
+            if (ready < 0) return -1;
+            if (ready == 0) {
+                if (total_sent == 0) {
+                    errno = ETIMEDOUT;
+                    return -1;
+                }
+                /* Finish the frame later rather than leave it torn */
+                if (serial_queue_unit(priv, cls, cur, curcnt, len - total_sent, 1) != 0) {
+                    return (int)total_sent;
+                }
+                return (int)len;
+            }
+        }
+    }
+
+    return (int)total_sent;
+}
+
+/**
+ * Send data over serial
+ */
+static int serial_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+{
+    struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+    return serial_sendv(t, &iov, 1);
+}
+
+/**
+ * Bytes waiting in the outgoing queue
+ */
+static int serial_pending(devproto_transport_t *t)
+{
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+    return (int)priv->tx_queued;
+}
+
+/**
+ * Write queued bytes by priority, waiting up to timeout_ms for writability
+ */
+static int serial_drain(devproto_transport_t *t, int timeout_ms)
+{
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+
+    if (priv->tx_queued == 0) return 0;
+    if (!t->is_open || t->fd < 0) return -1;
+    if (serial_set_blocking(t, 0) != 0) return -1;
+
+    int64_t deadline = timeout_ms < 0 ? -1 : serial_now_ms() + timeout_ms;
+    return serial_queue_flush(t, timeout_ms == 0 ? 0 : deadline);
 }
 
 /**
@@ -138,21 +708,65 @@ static void serial_close(devproto_transport_t *t)
         t->fd = -1;
     }
     t->is_open = 0;
+    priv->rx_head = priv->rx_len = 0;
+
+    /* A half-written unit is meaningless after reopening */
+    serial_queue_reset(priv);
 }
 
 /**
- * Send data over serial
+ * Wait for data and read it from the driver into buf
  */
-static int serial_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+static int serial_read(devproto_transport_t *t, uint8_t *buf, size_t len, int timeout_ms)
 {
-    if (!t->is_open || t->fd < 0) return -1;
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+
+    /* Use select for timeout; a zero timeout (reactor-driven reads) goes
+     * straight to the non-blocking fd */
+    if (timeout_ms != 0) {
+        fd_set readfds;
+        struct timeval tv;
+
+        FD_ZERO(&readfds);
+        FD_SET(t->fd, &readfds);
 
-    ssize_t written = write(t->fd, data, len);
-    if (written < 0) {
+        if (timeout_ms >= 0) {
+            tv.tv_sec = timeout_ms / 1000;
+            tv.tv_usec = (timeout_ms % 1000) * 1000;
+        }
+
+        int ret = select(t->fd + 1, &readfds, NULL, NULL,
+                         timeout_ms >= 0 ? &tv : NULL);
+
+        if (ret < 0) {
+            return -1;  /* Error */
+        } else if (ret == 0) {
+            return 0;   /* Timeout */
+        }
+    }
+
+    /* Data is waiting: with a hint, let the driver gather the rest of the
+     * frame (bounded by the inter-byte gap) before returning */
+    if (timeout_ms != 0) {
+        size_t want = priv->read_hint < len ? priv->read_hint : len;
+        if (want < 1) want = 1;
+        if (want > SERIAL_VMIN_MAX) want = SERIAL_VMIN_MAX;
+        if (serial_set_vmin(t, (cc_t)want) != 0 || serial_set_blocking(t, 1) != 0) {
+            return -1;
+        }
+    } else if (serial_set_blocking(t, 0) != 0) {
+        return -1;
+    }
+
+    ssize_t n = read(t->fd, buf, len);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
         return -1;
     }
 
-    return (int)written;
+    return (int)n;
 }
 
 /**
@@ -161,37 +775,26 @@ static int serial_send(devproto_transport_t *t, const uint8_t *data, size_t len)
 static int serial_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms)
 {
     if (!t->is_open || t->fd < 0) return -1;
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
 
-    /* Use select for timeout */
-    fd_set readfds;
-    struct timeval tv;
-
-    FD_ZERO(&readfds);
-    FD_SET(t->fd, &readfds);
-
-    if (timeout_ms >= 0) {
-        tv.tv_sec = timeout_ms / 1000;
-        tv.tv_usec = (timeout_ms % 1000) * 1000;
+    /* Serve buffered bytes first, without a syscall */
+    if (priv->rx_len == 0 && priv->rx_buf && len < priv->rx_cap) {
+        int n = serial_read(t, priv->rx_buf, priv->rx_cap, timeout_ms);
+        if (n <= 0) return n;
+        priv->rx_head = 0;
+        priv->rx_len = (size_t)n;
     }
 
-    int ret = select(t->fd + 1, &readfds, NULL, NULL,
-                     timeout_ms >= 0 ? &tv : NULL);
-
-    if (ret < 0) {
-        return -1;  /* Error */
-    } else if (ret == 0) {
-        return 0;   /* Timeout */
+    if (priv->rx_len > 0) {
+        size_t n = priv->rx_len < len ? priv->rx_len : len;
+        memcpy(data, priv->rx_buf + priv->rx_head, n);
+        priv->rx_head += n;
+        priv->rx_len -= n;
+        return (int)n;
     }
 
-    ssize_t n = read(t->fd, data, len);
-    if (n < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            return 0;
-        }
-        return -1;
-    }
-
-    return (int)n;
+    /* No read-ahead buffer, or the caller's buffer is at least as large */
+    return serial_read(t, data, len, timeout_ms);
 }
 
 /**
@@ -200,13 +803,14 @@ static int serial_recv(devproto_transport_t *t, uint8_t *data, size_t len, int t
 static int serial_available(devproto_transport_t *t)
 {
     if (!t->is_open || t->fd < 0) return -1;
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
 
     int bytes_available = 0;
     if (ioctl(t->fd, FIONREAD, &bytes_available) < 0) {
         return -1;
     }
 
-    return bytes_available;
+    return bytes_available + (int)priv->rx_len;
 }
 
 /**
@@ -215,12 +819,34 @@ static int serial_available(devproto_transport_t *t)
 static int serial_flush(devproto_transport_t *t)
 {
     if (!t->is_open || t->fd < 0) return -1;
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
 
-    /* Wait for output to drain */
+    /* Queued units first, then wait for the driver to drain */
+    if (priv->tx_queued > 0) {
+        int left = serial_drain(t, priv->write_timeout_ms);
+        if (left < 0) return -1;
+        if (left > 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
     tcdrain(t->fd);
     return 0;
 }
 
+/**
+ * Release private data
+ */
+static void serial_destroy(devproto_transport_t *t)
+{
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+
+    free(priv->rx_buf);
+    serial_queue_reset(priv);
+    free(priv);
+    t->priv = NULL;
+}
+
 /* Serial transport operations vtable */
 static const devproto_transport_ops_t serial_ops = {
     .open      = serial_open,
@@ -228,15 +854,36 @@ static const devproto_transport_ops_t serial_ops = {
     .send      = serial_send,
     .recv      = serial_recv,
     .available = serial_available,
-    .flush     = serial_flush
+    .flush     = serial_flush,
+    .sendv     = serial_sendv,
+    .pending   = serial_pending,
+    .drain     = serial_drain,
+    .destroy   = serial_destroy
 };
 
 /**
- * Create serial transport
+ * Initialize default serial configuration
  */
-devproto_transport_t *devproto_transport_serial_create(const char *device, int baudrate)
+void devproto_serial_config_init(devproto_serial_config_t *cfg, const char *device)
 {
-    if (!device) return NULL;
+    if (!cfg) return;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->device = device;
+    cfg->baudrate = 115200;
+    cfg->rx_buffer_size = DEVPROTO_SERIAL_DEFAULT_RX_BUFFER;
+    cfg->low_latency = 1;
+    cfg->inter_byte_ms = 100;
+    cfg->write_timeout_ms = DEVPROTO_SERIAL_WRITE_TIMEOUT_MS;
+    cfg->tx_queue_size = DEVPROTO_SERIAL_QUEUE_DEFAULT;
+}
+
+/**
+ * Create serial transport from configuration
+ */
+devproto_transport_t *devproto_transport_serial_create_ex(const devproto_serial_config_t *cfg)
+{
+    if (!cfg || !cfg->device) return NULL;
 
     devproto_transport_t *t = calloc(1, sizeof(*t));
     if (!t) return NULL;
@@ -247,10 +894,24 @@ devproto_transport_t *devproto_transport_serial_create(const char *device, int b
         return NULL;
     }
 
-    strncpy(priv->device, device, sizeof(priv->device) - 1);
+    if (cfg->rx_buffer_size > 0) {
+        priv->rx_buf = malloc(cfg->rx_buffer_size);
+        if (!priv->rx_buf) {
+            free(priv);
+            free(t);
+            return NULL;
+        }
+        priv->rx_cap = cfg->rx_buffer_size;
+    }
+
+    strncpy(priv->device, cfg->device, sizeof(priv->device) - 1);
     priv->device[sizeof(priv->device) - 1] = '\0';  /* Ensure null termination */
-    priv->baudrate = baudrate > 0 ? baudrate : 115200;
+    priv->baudrate = cfg->baudrate > 0 ? cfg->baudrate : 115200;
     priv->termios_saved = 0;
+    priv->low_latency = cfg->low_latency;
+    priv->inter_byte_ms = cfg->inter_byte_ms > 0 ? cfg->inter_byte_ms : 100;
+    priv->write_timeout_ms = cfg->write_timeout_ms;
+    priv->queue_max = cfg->tx_queue_size ? cfg->tx_queue_size : DEVPROTO_SERIAL_QUEUE_DEFAULT;
 
     t->type = DEVPROTO_TRANSPORT_SERIAL;
     t->ops = &serial_ops;
@@ -260,3 +921,54 @@ devproto_transport_t *devproto_transport_serial_create(const char *device, int b
 
     return t;
 }
+
+/**
+ * Create serial transport
+ */
+devproto_transport_t *devproto_transport_serial_create(const char *device, int baudrate)
+{
+    devproto_serial_config_t cfg;
+
+    devproto_serial_config_init(&cfg, device);
+    if (baudrate > 0) cfg.baudrate = baudrate;
+    return devproto_transport_serial_create_ex(&cfg);
+}
+
+/**
+ * Set read hint
+ */
+int devproto_transport_serial_set_read_hint(devproto_transport_t *t, size_t remaining)
+{
+    if (!t || !t->priv || t->type != DEVPROTO_TRANSPORT_SERIAL) return -1;
+
+    ((serial_priv_t *)t->priv)->read_hint = remaining;
+    return 0;
+}
+
+/**
+ * Set blocking send timeout
+ */
+int devproto_transport_serial_set_write_timeout(devproto_transport_t *t, int timeout_ms)
+{
+    if (!t || !t->priv || t->type != DEVPROTO_TRANSPORT_SERIAL) return -1;
+
+    ((serial_priv_t *)t->priv)->write_timeout_ms = timeout_ms < 0 ? -1 : timeout_ms;
+    return 0;
+}
+
+/**
+ * Toggle non-blocking sends
+ */
+int devproto_transport_serial_set_nonblocking(devproto_transport_t *t, int enable,
+                                              size_t max_queue)
+{
+    if (!t || !t->priv || t->type != DEVPROTO_TRANSPORT_SERIAL) return -1;
+
+    serial_priv_t *priv = (serial_priv_t *)t->priv;
+    size_t limit = max_queue ? max_queue : DEVPROTO_SERIAL_QUEUE_DEFAULT;
+    if (limit > (size_t)INT32_MAX) limit = (size_t)INT32_MAX;
+
+    priv->queue_max = limit;
+    priv->nonblocking = enable ? 1 : 0;
+    return 0;
+}
@@ -3,21 +3,25 @@
  * @brief TCP socket transport implementation
  */
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/uio.h>
 #include <sys/ioctl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
-#include <netdb.h>
 
 #include "devproto/transport.h"
+#include "devproto/net.h"
+
+/* Largest iovec list accepted by tcp_sendv() */
+#define DEVPROTO_TCP_IOV_MAX  64
 
 /**
  * TCP transport private data
@@ -25,134 +29,464 @@
 typedef struct {
     char host[256];
     int  port;
+
+    /* Connect behaviour */
+    int     family;
+    int     connect_timeout_ms;
+    int     attempt_delay_ms;
+    devproto_resolver_t *resolver;
+    devproto_keepalive_t keepalive;
+    devproto_resolve_t *resolve;        /* Lookup a non-blocking open waits for */
+    devproto_connector_t connector;     /* Non-blocking open state */
+    int     connecting;                 /* open_step in progress */
+
+    /* Send behaviour */
+    int     write_timeout_ms;           /* Blocking send wait, -1 = forever */
+    int     nonblocking;                /* Queue instead of waiting */
+    size_t  queue_max;                  /* Outgoing queue limit */
+
+    /* Outgoing queue (non-blocking mode), allocated on first use */
+    uint8_t *queue;
+    size_t   queue_head;                /* Offset of first unsent byte */
+    size_t   queue_len;                 /* Bytes queued after head */
+    size_t   queue_cap;                 /* Allocated size */
 } tcp_priv_t;
 
 /**
- * Open TCP connection
+ * Resolve the peer through the cache
  */
-static int tcp_open(devproto_transport_t *t)
+static int tcp_resolve(tcp_priv_t *priv, devproto_addr_list_t *addrs)
 {
-    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
-    struct addrinfo hints, *result, *rp;
-    char port_str[16];
-    int ret;
-
-    /* Convert port to string for getaddrinfo */
-    snprintf(port_str, sizeof(port_str), "%d", priv->port);
-
-    /* Setup hints for getaddrinfo (replaces deprecated gethostbyname) */
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;      /* IPv4 */
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-
-    /* Resolve hostname */
-    ret = getaddrinfo(priv->host, port_str, &hints, &result);
-    if (ret != 0) {
-        return -1;
-    }
-
-    /* Try each address until we connect successfully */
-    for (rp = result; rp != NULL; rp = rp->ai_next) {
-        t->fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-        if (t->fd < 0) {
-            continue;
-        }
+    devproto_resolver_t *resolver = priv->resolver ? priv->resolver : devproto_resolver_default();
+    return devproto_resolver_lookup(resolver, priv->host, priv->port, priv->family, addrs);
+}
 
-        if (connect(t->fd, rp->ai_addr, rp->ai_addrlen) == 0) {
-            break;  /* Success */
-        }
+/**
+ * Abandon the lookup and attempts of a non-blocking open
+ */
+static void tcp_open_cancel(devproto_transport_t *t)
+{
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
 
-        close(t->fd);
+    if (priv->resolve) {
+        devproto_resolve_cancel(priv->resolve);
+        priv->resolve = NULL;
         t->fd = -1;
     }
-
-    freeaddrinfo(result);
-
-    if (t->fd < 0) {
-        return -1;
+    if (priv->connecting) {
+        devproto_connector_cancel(&priv->connector);
+        priv->connecting = 0;
+        t->fd = -1;
     }
+}
+
+/**
+ * Take over a connected socket
+ */
+static int tcp_connected(devproto_transport_t *t, int fd)
+{
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
 
     /* Set TCP_NODELAY for low latency */
     int flag = 1;
-    setsockopt(t->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
 
-    /* Set non-blocking */
-    int flags = fcntl(t->fd, F_GETFL, 0);
-    fcntl(t->fd, F_SETFL, flags | O_NONBLOCK);
+    /* Notice a dead peer without waiting for the retransmit limit */
+    devproto_net_set_keepalive(fd, &priv->keepalive);
 
+    t->fd = fd;
     t->is_open = 1;
     return 0;
 }
 
+/**
+ * Open TCP connection
+ */
+static int tcp_open(devproto_transport_t *t)
+{
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+    devproto_addr_list_t addrs;
+
+    /* A blocking open supersedes a non-blocking one in progress */
+    tcp_open_cancel(t);
+    t->fd = -1;
+
+    if (tcp_resolve(priv, &addrs) != 0) return -1;
+
+    int fd = devproto_connect(&addrs, priv->attempt_delay_ms, priv->connect_timeout_ms);
+    if (fd < 0) return -1;
+
+    return tcp_connected(t, fd);
+}
+
+/**
+ * Advance a non-blocking open
+ */
+static int tcp_open_step(devproto_transport_t *t)
+{
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+
+    if (t->is_open) return 0;
+
+    if (!priv->connecting) {
+        devproto_addr_list_t addrs;
+        int ret;
+
+        if (priv->resolve) {
+            /* Waiting on the resolver's descriptor (t->fd) */
+            ret = devproto_resolve_finish(priv->resolve, &addrs);
+            if (ret > 0) return DEVPROTO_TRANSPORT_WANT_READ;
+            priv->resolve = NULL;
+            t->fd = -1;
+        } else {
+            devproto_resolver_t *resolver = priv->resolver ? priv->resolver
+                                                           : devproto_resolver_default();
+            ret = devproto_resolver_start(resolver, priv->host, priv->port, priv->family,
+                                          &addrs, &priv->resolve);
+            if (ret > 0) {
+                t->fd = devproto_resolve_fd(priv->resolve);
+                return DEVPROTO_TRANSPORT_WANT_READ;
+            }
+        }
+
+        if (ret != 0 ||
+            devproto_connector_start(&priv->connector, &addrs, priv->attempt_delay_ms,
+                                     priv->connect_timeout_ms) != 0) {
+            return -1;
+        }
+        priv->connecting = 1;
+    }
+
+    int fd;
+    int ret = devproto_connector_step(&priv->connector, &fd);
+    if (ret > 0) {
+        /* Newest attempt stands for all of them; older ones finish on the next step */
+        t->fd = devproto_connector_fd(&priv->connector);
+        return DEVPROTO_TRANSPORT_WANT_WRITE;
+    }
+
+    priv->connecting = 0;
+    if (ret < 0) {
+        t->fd = -1;
+        return -1;
+    }
+    return tcp_connected(t, fd);
+}
+
 /**
  * Close TCP connection
  */
 static void tcp_close(devproto_transport_t *t)
 {
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+
+    /* Abandon an open in progress (t->fd is its lookup's or one of its attempts) */
+    tcp_open_cancel(t);
+
     if (t->fd >= 0) {
         shutdown(t->fd, SHUT_RDWR);
         close(t->fd);
         t->fd = -1;
     }
     t->is_open = 0;
+
+    /* Unsent data is meaningless on a new connection */
+    free(priv->queue);
+    priv->queue = NULL;
+    priv->queue_head = priv->queue_len = priv->queue_cap = 0;
 }
 
 /**
- * Send data over TCP
+ * Milliseconds on the monotonic clock
  */
-static int tcp_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+static int64_t tcp_now_ms(void)
 {
-    if (!t->is_open || t->fd < 0) return -1;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-    size_t total_sent = 0;
+/**
+ * Wait until the socket is writable or the deadline passes (-1 = none)
+ * Returns 1 if writable, 0 on timeout, -1 on error.
+ */
+static int tcp_wait_writable(int fd, int64_t deadline_ms)
+{
+    for (;;) {
+        int timeout = -1;
+        if (deadline_ms >= 0) {
+            int64_t left = deadline_ms - tcp_now_ms();
+            timeout = left > 0 ? (int)left : 0;
+        }
 
-    while (total_sent < len) {
-        ssize_t sent = send(t->fd, data + total_sent, len - total_sent, MSG_NOSIGNAL);
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        int ret = poll(&pfd, 1, timeout);
+
+        if (ret > 0) {
+            return (pfd.revents & (POLLERR | POLLNVAL)) ? -1 : 1;
+        } else if (ret == 0) {
+            return 0;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * Write as much of an iovec list as the socket takes without blocking,
+ * advancing the list past what was written.
+ * Returns bytes written (0 if the socket is full), or -1 on error.
+ */
+static ssize_t tcp_write_some(int fd, struct msghdr *mh)
+{
+    size_t total = 0;
+
+    while (mh->msg_iovlen > 0) {
+        ssize_t sent = sendmsg(fd, mh, MSG_NOSIGNAL | MSG_DONTWAIT);
 
         if (sent < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                /* Would block, try again */
-                continue;
-            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
             return -1;
         } else if (sent == 0) {
             /* Connection closed */
             return -1;
         }
 
-        total_sent += sent;
+        total += (size_t)sent;
+
+        /* Skip fully written entries, trim the partially written one */
+        size_t skip = (size_t)sent;
+        while (mh->msg_iovlen > 0 && skip >= mh->msg_iov->iov_len) {
+            skip -= mh->msg_iov->iov_len;
+            mh->msg_iov++;
+            mh->msg_iovlen--;
+        }
+        if (mh->msg_iovlen > 0) {
+            mh->msg_iov->iov_base = (uint8_t *)mh->msg_iov->iov_base + skip;
+            mh->msg_iov->iov_len -= skip;
+        }
     }
 
-    return (int)total_sent;
+    return (ssize_t)total;
 }
 
 /**
- * Receive data from TCP
+ * Flush the outgoing queue, waiting until deadline_ms (-1 = forever,
+ * 0 = no wait). Returns bytes still queued, or -1 on error.
  */
-static int tcp_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms)
+static int tcp_queue_flush(devproto_transport_t *t, int64_t deadline_ms)
 {
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+
+    while (priv->queue_len > 0) {
+        struct iovec iov = {
+            .iov_base = priv->queue + priv->queue_head,
+            .iov_len = priv->queue_len
+        };
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+
+        ssize_t n = tcp_write_some(t->fd, &mh);
+        if (n < 0) return -1;
+
+        priv->queue_head += (size_t)n;
+        priv->queue_len -= (size_t)n;
+
+        if (priv->queue_len > 0) {
+            if (deadline_ms == 0) break;
+
+            int ready = tcp_wait_writable(t->fd, deadline_ms);
+            if (ready < 0) return -1;
+            if (ready == 0) break;
+        }
+    }
+
+    if (priv->queue_len == 0) {
+        priv->queue_head = 0;
+    }
+    return (int)priv->queue_len;
+}
+
+/**
+ * Append the remainder of an iovec list to the outgoing queue, as far as
+ * the queue limit allows. Returns bytes queued.
+ */
+static size_t tcp_queue_append(tcp_priv_t *priv, const struct iovec *iov, int iovcnt)
+{
+    size_t want = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        want += iov[i].iov_len;
+    }
+
+    size_t room = priv->queue_max > priv->queue_len ? priv->queue_max - priv->queue_len : 0;
+    if (want > room) want = room;
+    if (want == 0) return 0;
+
+    /* Compact, then grow geometrically up to the limit */
+    if (priv->queue_head > 0) {
+        memmove(priv->queue, priv->queue + priv->queue_head, priv->queue_len);
+        priv->queue_head = 0;
+    }
+    if (priv->queue_len + want > priv->queue_cap) {
+        size_t cap = priv->queue_cap ? priv->queue_cap : 4096;
+        while (cap < priv->queue_len + want) cap *= 2;
+        if (cap > priv->queue_max) cap = priv->queue_max;
+
+        uint8_t *grown = realloc(priv->queue, cap);
+        if (!grown) return 0;
+        priv->queue = grown;
+        priv->queue_cap = cap;
+    }
+
+    size_t copied = 0;
+    for (int i = 0; i < iovcnt && copied < want; i++) {
+        size_t n = iov[i].iov_len;
+        if (n > want - copied) n = want - copied;
+        memcpy(priv->queue + priv->queue_len + copied, iov[i].iov_base, n);
+        copied += n;
+    }
+
+    priv->queue_len += copied;
+    return copied;
+}
+
+/**
+ * Send scatter-gather data over TCP
+ *
+ * Blocking mode waits for writability with poll() (bounded by the write
+ * timeout) instead of retrying on EAGAIN. Non-blocking mode never waits:
+ * whatever the socket does not take goes into the outgoing queue.
+ */
+static int tcp_sendv(devproto_transport_t *t, const struct iovec *iov, int iovcnt)
+{
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+
     if (!t->is_open || t->fd < 0) return -1;
+    if (iovcnt < 0 || iovcnt > DEVPROTO_TCP_IOV_MAX) return -1;
 
-    /* Use select for timeout */
-    fd_set readfds;
-    struct timeval tv;
+    /* Local copy so partial writes can advance it */
+    struct iovec vec[DEVPROTO_TCP_IOV_MAX];
+    size_t len = 0;
 
-    FD_ZERO(&readfds);
-    FD_SET(t->fd, &readfds);
+    for (int i = 0; i < iovcnt; i++) {
+        vec[i] = iov[i];
+        len += iov[i].iov_len;
+    }
+    if (len > (size_t)INT32_MAX) return -1;
+
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = vec;
+    mh.msg_iovlen = iovcnt;
 
-    if (timeout_ms >= 0) {
-        tv.tv_sec = timeout_ms / 1000;
-        tv.tv_usec = (timeout_ms % 1000) * 1000;
+    int64_t deadline = -1;
+    if (!priv->nonblocking && priv->write_timeout_ms >= 0) {
+        deadline = tcp_now_ms() + priv->write_timeout_ms;
     }
 
-    int ret = select(t->fd + 1, &readfds, NULL, NULL,
-                     timeout_ms >= 0 ? &tv : NULL);
+    /* Queued bytes go first to keep the stream in order */
+    if (priv->queue_len > 0) {
+        int left = tcp_queue_flush(t, priv->nonblocking ? 0 : deadline);
+        if (left < 0) return -1;
+        if (left > 0 && !priv->nonblocking) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
 
-    if (ret < 0) {
-        return -1;  /* Error */
-    } else if (ret == 0) {
-        return 0;   /* Timeout */
+    size_t total_sent = 0;
+
+    if (priv->nonblocking) {
+        if (priv->queue_len == 0) {
+            ssize_t n = tcp_write_some(t->fd, &mh);
+            if (n < 0) return -1;
+            total_sent = (size_t)n;
+        }
+
+        if (total_sent < len) {
+            total_sent += tcp_queue_append(priv, mh.msg_iov, (int)mh.msg_iovlen);
+        }
+
+        if (total_sent == 0 && len > 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+        return (int)total_sent;
+    }
+
+    while (total_sent < len) {
+        ssize_t n = tcp_write_some(t->fd, &mh);
+        if (n < 0) return -1;
+        total_sent += (size_t)n;
+
+        if (total_sent < len) {
+            /* Backpressure: sleep until writable rather than spinning */
+            int ready = tcp_wait_writable(t->fd, deadline);
+            if (ready < 0) return -1;
+            if (ready == 0) {
+                if (total_sent > 0) break;
+                errno = ETIMEDOUT;
+                return -1;
+            }
+        }
+    }
+
+    return (int)total_sent;
+}
+
+/**
+ * Send data over TCP
+ */
+static int tcp_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+{
+    struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+    return tcp_sendv(t, &iov, 1);
+}
+
+/**
+ * Bytes waiting in the outgoing queue
+ */
+static int tcp_pending(devproto_transport_t *t)
+{
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+    return (int)priv->queue_len;
+}
+
+/**
+ * Write queued bytes, waiting up to timeout_ms for writability
+ */
+static int tcp_drain(devproto_transport_t *t, int timeout_ms)
+{
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+
+    if (priv->queue_len == 0) return 0;
+    if (!t->is_open || t->fd < 0) return -1;
+
+    int64_t deadline = timeout_ms < 0 ? -1 : tcp_now_ms() + timeout_ms;
+    return tcp_queue_flush(t, timeout_ms == 0 ? 0 : deadline);
+}
+
+/**
+ * Receive data from TCP
+ */
+static int tcp_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms)
+{
+    if (!t->is_open || t->fd < 0) return -1;
+
+    /* Use poll for timeout (select cannot take fds past FD_SETSIZE); a zero
+     * timeout (reactor-driven reads) goes straight to the non-blocking fd */
+    if (timeout_ms != 0) {
+        struct pollfd pfd = { .fd = t->fd, .events = POLLIN };
+        int ret = poll(&pfd, 1, timeout_ms >= 0 ? timeout_ms : -1);
+
+        if (ret < 0) {
+            return -1;  /* Error */
+        } else if (ret == 0) {
+            return 0;   /* Timeout */
+        }
     }
 
     ssize_t n = recv(t->fd, data, len, 0);
@@ -202,15 +536,76 @@ static const devproto_transport_ops_t tcp_ops = {
     .send      = tcp_send,
     .recv      = tcp_recv,
     .available = tcp_available,
-    .flush     = tcp_flush
+    .flush     = tcp_flush,
+    .sendv     = tcp_sendv,
+    .pending   = tcp_pending,
+    .drain     = tcp_drain,
+    .open_step = tcp_open_step
 };
 
+/**
+ * Set blocking write timeout
+ */
+int devproto_transport_tcp_set_write_timeout(devproto_transport_t *t, int timeout_ms)
+{
+    if (!t || t->type != DEVPROTO_TRANSPORT_TCP || !t->priv) return -1;
+
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+    priv->write_timeout_ms = timeout_ms < 0 ? -1 : timeout_ms;
+    return 0;
+}
+
+/**
+ * Toggle non-blocking sends with an outgoing queue
+ */
+int devproto_transport_tcp_set_nonblocking(devproto_transport_t *t, int enable,
+                                           size_t max_queue)
+{
+    if (!t || t->type != DEVPROTO_TRANSPORT_TCP || !t->priv) return -1;
+
+    tcp_priv_t *priv = (tcp_priv_t *)t->priv;
+    size_t limit = max_queue ? max_queue : DEVPROTO_TCP_QUEUE_DEFAULT;
+    if (limit > (size_t)INT32_MAX) limit = (size_t)INT32_MAX;
+
+    /* Never shrink below what is already queued */
+    priv->queue_max = limit > priv->queue_len ? limit : priv->queue_len;
+    priv->nonblocking = enable ? 1 : 0;
+    return 0;
+}
+
+/**
+ * Initialize default TCP configuration
+ */
+void devproto_tcp_config_init(devproto_tcp_config_t *cfg, const char *host, int port)
+{
+    if (!cfg) return;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->host = host;
+    cfg->port = port;
+    cfg->family = AF_UNSPEC;
+    cfg->connect_timeout_ms = DEVPROTO_TCP_CONNECT_TIMEOUT_MS;
+}
+
 /**
  * Create TCP transport
  */
 devproto_transport_t *devproto_transport_tcp_create(const char *host, int port)
 {
-    if (!host || port <= 0) return NULL;
+    devproto_tcp_config_t cfg;
+    devproto_tcp_config_init(&cfg, host, port);
+    return devproto_transport_tcp_create_ex(&cfg);
+}
+
+/**
+ * Create TCP transport with explicit settings
+ */
+devproto_transport_t *devproto_transport_tcp_create_ex(const devproto_tcp_config_t *cfg)
+{
+    if (!cfg || !cfg->host || cfg->port <= 0 || cfg->port > 65535) return NULL;
+    if (cfg->family != AF_UNSPEC && cfg->family != AF_INET && cfg->family != AF_INET6) {
+        return NULL;
+    }
 
     devproto_transport_t *t = calloc(1, sizeof(*t));
     if (!t) return NULL;
@@ -221,9 +616,20 @@ devproto_transport_t *devproto_transport_tcp_create(const char *host, int port)
         return NULL;
     }
 
-    strncpy(priv->host, host, sizeof(priv->host) - 1);
+    strncpy(priv->host, cfg->host, sizeof(priv->host) - 1);
     priv->host[sizeof(priv->host) - 1] = '\0';  /* Ensure null termination */
-    priv->port = port;
+    priv->port = cfg->port;
+    priv->family = cfg->family;
+    priv->connect_timeout_ms = cfg->connect_timeout_ms;
+    priv->attempt_delay_ms = cfg->attempt_delay_ms;
+    priv->resolver = cfg->resolver;
+    if (cfg->keepalive) {
+        priv->keepalive = *cfg->keepalive;
+    } else {
+        devproto_keepalive_init(&priv->keepalive);
+    }
+    priv->write_timeout_ms = DEVPROTO_TCP_WRITE_TIMEOUT_MS;
+    priv->queue_max = DEVPROTO_TCP_QUEUE_DEFAULT;
 
     t->type = DEVPROTO_TRANSPORT_TCP;
     t->ops = &tcp_ops;
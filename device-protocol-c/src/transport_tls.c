@@ -2,8 +2,8 @@
  * @file transport_tls.c
  * @brief TLS transport implementation using mbedTLS
  *
- * Build with DEVPROTO_TLS_ENABLE and link against mbedTLS to enable.
- * Without DEVPROTO_TLS_ENABLE, this file compiles to stubs.
+ * Build with DEVPROTO_TLS_ENABLE and link against mbedTLS (2.28 LTS or
+ * 3.x) to enable. Without DEVPROTO_TLS_ENABLE, this file compiles to stubs.
  */
 
 #include "devproto/tls.h"
@@ -23,6 +23,8 @@ void devproto_tls_config_init(devproto_tls_config_t *cfg) {
     cfg->handshake_timeout_ms = 30000;
     cfg->read_timeout_ms = 5000;
     cfg->write_timeout_ms = 5000;
+    cfg->session_lifetime_s = 86400;
+    devproto_keepalive_init(&cfg->keepalive);
 }
 
 #ifdef DEVPROTO_TLS_ENABLE
@@ -31,7 +33,8 @@ void devproto_tls_config_init(devproto_tls_config_t *cfg) {
  * Full TLS implementation requires mbedTLS
  *
  * Build requirements:
- *   - mbedTLS library (libmbedtls, libmbedcrypto, libmbedx509)
+ *   - mbedTLS 2.28 LTS or 3.x (libmbedtls, libmbedcrypto, libmbedx509);
+ *     TLS 1.3 needs 3.2 or later built with MBEDTLS_SSL_PROTO_TLS1_3
  *   - Compile with: -DDEVPROTO_TLS_ENABLE
  *   - Link with: -lmbedtls -lmbedcrypto -lmbedx509
  *
@@ -48,6 +51,56 @@ void devproto_tls_config_init(devproto_tls_config_t *cfg) {
 #include <mbedtls/error.h>
 #include <mbedtls/debug.h>
 #include <mbedtls/version.h>
+#include <mbedtls/platform_util.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#if !defined(MBEDTLS_VERSION_NUMBER) || MBEDTLS_VERSION_NUMBER < 0x021C0000
+#error "DEVPROTO_TLS_ENABLE needs mbedTLS 2.28 or 3.x"
+#endif
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+#include <psa/crypto.h>
+#define TLS_PSA_INIT 1
+#endif
+
+/* TLS 1.3 where the library implements it; otherwise links negotiate 1.2 */
+#if MBEDTLS_VERSION_NUMBER >= 0x03020000 && defined(MBEDTLS_SSL_PROTO_TLS1_3)
+#define TLS_HAVE_TLS13 1
+#endif
+
+/* Upper bound for a serialized session handed to session_load */
+#define TLS_SESSION_BLOB_MAX 4096
+
+/*
+ * Shared context
+ *
+ * Everything that is the same for every link to the same fleet of servers
+ * (parsed CA chain, client certificate and key, mbedtls_ssl_config, DRBG)
+ * lives in a devproto_tls_context_t. The certificate material is held in
+ * a refcounted generation: reload builds a new generation and swaps it in,
+ * live connections keep the one they handshook with until they reopen.
+ */
+typedef struct tls_generation {
+    atomic_int refs;
+    mbedtls_ssl_config ssl_conf;
+    mbedtls_x509_crt ca_cert;
+    mbedtls_x509_crt client_cert;
+    mbedtls_pk_context client_key;
+} tls_generation_t;
+
+struct devproto_tls_context {
+    atomic_int refs;
+    pthread_mutex_t lock;           /* Guards current and the DRBG */
+    tls_generation_t *current;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    void (*debug_callback)(int level, const char *file, int line, const char *msg);
+};
 
 /* TLS transport private data */
 typedef struct {
@@ -55,26 +108,39 @@ typedef struct {
     devproto_tls_state_t state;
     devproto_tls_error_t last_error;
 
+    devproto_tls_context_t *ctx;
+    tls_generation_t *gen;          /* Generation ssl_ctx is set up with */
+
     mbedtls_net_context net_ctx;
     mbedtls_ssl_context ssl_ctx;
-    mbedtls_ssl_config ssl_conf;
-    mbedtls_x509_crt ca_cert;
-    mbedtls_x509_crt client_cert;
-    mbedtls_pk_context client_key;
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
+    uint32_t io_timeout_ms;         /* Per-connection read timeout */
+
+    /* Non-blocking open state */
+    devproto_resolve_t *resolve;    /* Name lookup in progress */
+    devproto_connector_t connector; /* Happy-eyeballs TCP connect */
+    int connecting;                 /* TCP connect in progress */
+    int64_t deadline_ms;            /* Handshake deadline (0 = none) */
+    int full_handshake;             /* Server chain verified (session not resumed) */
 
     char server_cn[256];
     int verify_result;
+
+    /* Session resumption cache */
+    mbedtls_ssl_session session;
+    int have_session;
+    int session_loaded;             /* session_load already consulted */
+    time_t session_time;
 } tls_priv_t;
 
 /* Forward declarations */
 static int tls_open(devproto_transport_t *t);
+static int tls_open_step(devproto_transport_t *t);
 static void tls_close(devproto_transport_t *t);
 static int tls_send(devproto_transport_t *t, const uint8_t *data, size_t len);
 static int tls_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms);
 static int tls_available(devproto_transport_t *t);
 static int tls_flush(devproto_transport_t *t);
+static void tls_destroy(devproto_transport_t *t);
 
 static const devproto_transport_ops_t tls_ops = {
     .open = tls_open,
@@ -82,134 +148,371 @@ static const devproto_transport_ops_t tls_ops = {
     .send = tls_send,
     .recv = tls_recv,
     .available = tls_available,
-    .flush = tls_flush
+    .flush = tls_flush,
+    .destroy = tls_destroy,
+    .open_step = tls_open_step
 };
 
 /* Debug callback wrapper */
 static void tls_debug_callback(void *ctx, int level,
                                 const char *file, int line,
                                 const char *str) {
-    tls_priv_t *priv = (tls_priv_t *)ctx;
-    if (priv && priv->config.debug_callback) {
-        priv->config.debug_callback(level, file, line, str);
+    devproto_tls_context_t *tctx = (devproto_tls_context_t *)ctx;
+    if (tctx && tctx->debug_callback) {
+        tctx->debug_callback(level, file, line, str);
     }
 }
 
-devproto_transport_t *devproto_transport_tls_create(const devproto_tls_config_t *cfg) {
-    if (!cfg || !cfg->host || cfg->port <= 0) {
-        return NULL;
-    }
+/* DRBG wrapper: the shared generator is not thread-safe on its own */
+static int tls_random(void *p, unsigned char *out, size_t len) {
+    devproto_tls_context_t *ctx = (devproto_tls_context_t *)p;
 
-    devproto_transport_t *t = calloc(1, sizeof(*t));
-    if (!t) return NULL;
+    pthread_mutex_lock(&ctx->lock);
+    int ret = mbedtls_ctr_drbg_random(&ctx->ctr_drbg, out, len);
+    pthread_mutex_unlock(&ctx->lock);
 
-    tls_priv_t *priv = calloc(1, sizeof(*priv));
-    if (!priv) {
-        free(t);
-        return NULL;
-    }
+    return ret;
+}
 
-    /* Copy configuration */
-    memcpy(&priv->config, cfg, sizeof(*cfg));
-    priv->state = DEVPROTO_TLS_STATE_INIT;
-    priv->last_error = DEVPROTO_TLS_OK;
+static void tls_generation_unref(tls_generation_t *gen) {
+    if (!gen) return;
+    if (atomic_fetch_sub_explicit(&gen->refs, 1, memory_order_acq_rel) != 1) return;
 
-    /* Initialize mbedTLS structures */
-    mbedtls_net_init(&priv->net_ctx);
-    mbedtls_ssl_init(&priv->ssl_ctx);
-    mbedtls_ssl_config_init(&priv->ssl_conf);
-    mbedtls_x509_crt_init(&priv->ca_cert);
-    mbedtls_x509_crt_init(&priv->client_cert);
-    mbedtls_pk_init(&priv->client_key);
-    mbedtls_entropy_init(&priv->entropy);
-    mbedtls_ctr_drbg_init(&priv->ctr_drbg);
+    mbedtls_ssl_config_free(&gen->ssl_conf);
+    mbedtls_x509_crt_free(&gen->ca_cert);
+    mbedtls_x509_crt_free(&gen->client_cert);
+    mbedtls_pk_free(&gen->client_key);
+    free(gen);
+}
 
-    /* Seed the random number generator */
-    int ret = mbedtls_ctr_drbg_seed(&priv->ctr_drbg, mbedtls_entropy_func,
-                                     &priv->entropy, NULL, 0);
-    if (ret != 0) {
-        priv->last_error = DEVPROTO_TLS_ERR_MEMORY;
-        goto error;
+/* Take a reference on the current generation */
+static tls_generation_t *tls_generation_get(devproto_tls_context_t *ctx) {
+    pthread_mutex_lock(&ctx->lock);
+    tls_generation_t *gen = ctx->current;
+    atomic_fetch_add_explicit(&gen->refs, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&ctx->lock);
+
+    return gen;
+}
+
+/* Apply the configured version range; -1 if it needs TLS 1.3 and the
+ * library has none (a 1.3 maximum alone then just means 1.2) */
+static int tls_conf_versions(mbedtls_ssl_config *conf, const devproto_tls_config_t *cfg) {
+#if defined(TLS_HAVE_TLS13)
+    mbedtls_ssl_conf_min_tls_version(conf, cfg->min_version == DEVPROTO_TLS_VERSION_1_3 ?
+                                     MBEDTLS_SSL_VERSION_TLS1_3 : MBEDTLS_SSL_VERSION_TLS1_2);
+    mbedtls_ssl_conf_max_tls_version(conf, cfg->max_version == DEVPROTO_TLS_VERSION_1_3 ?
+                                     MBEDTLS_SSL_VERSION_TLS1_3 : MBEDTLS_SSL_VERSION_TLS1_2);
+#else
+    if (cfg->min_version == DEVPROTO_TLS_VERSION_1_3) return -1;
+#if MBEDTLS_VERSION_NUMBER >= 0x03020000
+    mbedtls_ssl_conf_min_tls_version(conf, MBEDTLS_SSL_VERSION_TLS1_2);
+    mbedtls_ssl_conf_max_tls_version(conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#else
+    mbedtls_ssl_conf_min_version(conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+    mbedtls_ssl_conf_max_version(conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+#endif
+#endif
+    return 0;
+}
+
+/* Parse certificates and build an ssl_config; sets *err on failure */
+static tls_generation_t *tls_generation_create(devproto_tls_context_t *ctx,
+                                               const devproto_tls_config_t *cfg,
+                                               devproto_tls_error_t *err) {
+    tls_generation_t *gen = calloc(1, sizeof(*gen));
+    if (!gen) {
+        *err = DEVPROTO_TLS_ERR_MEMORY;
+        return NULL;
     }
 
+    atomic_init(&gen->refs, 1);
+    mbedtls_ssl_config_init(&gen->ssl_conf);
+    mbedtls_x509_crt_init(&gen->ca_cert);
+    mbedtls_x509_crt_init(&gen->client_cert);
+    mbedtls_pk_init(&gen->client_key);
+
     /* Setup SSL defaults */
-    ret = mbedtls_ssl_config_defaults(&priv->ssl_conf,
-                                       MBEDTLS_SSL_IS_CLIENT,
-                                       MBEDTLS_SSL_TRANSPORT_STREAM,
-                                       MBEDTLS_SSL_PRESET_DEFAULT);
+    int ret = mbedtls_ssl_config_defaults(&gen->ssl_conf,
+                                           MBEDTLS_SSL_IS_CLIENT,
+                                           MBEDTLS_SSL_TRANSPORT_STREAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT);
     if (ret != 0) {
-        priv->last_error = DEVPROTO_TLS_ERR_INVALID_CONFIG;
+        *err = DEVPROTO_TLS_ERR_INVALID_CONFIG;
         goto error;
     }
 
     /* Set TLS version range */
-    mbedtls_ssl_conf_min_version(&priv->ssl_conf,
-        MBEDTLS_SSL_MAJOR_VERSION_3,
-        (cfg->min_version == DEVPROTO_TLS_VERSION_1_3) ?
-            MBEDTLS_SSL_MINOR_VERSION_4 : MBEDTLS_SSL_MINOR_VERSION_3);
-    mbedtls_ssl_conf_max_version(&priv->ssl_conf,
-        MBEDTLS_SSL_MAJOR_VERSION_3,
-        (cfg->max_version == DEVPROTO_TLS_VERSION_1_3) ?
-            MBEDTLS_SSL_MINOR_VERSION_4 : MBEDTLS_SSL_MINOR_VERSION_3);
+    if (tls_conf_versions(&gen->ssl_conf, cfg) != 0) {
+        *err = DEVPROTO_TLS_ERR_NOT_SUPPORTED;
+        goto error;
+    }
 
     /* Configure RNG */
-    mbedtls_ssl_conf_rng(&priv->ssl_conf, mbedtls_ctr_drbg_random, &priv->ctr_drbg);
+    mbedtls_ssl_conf_rng(&gen->ssl_conf, tls_random, ctx);
 
     /* Configure debug if callback provided */
-    if (cfg->debug_callback) {
-        mbedtls_ssl_conf_dbg(&priv->ssl_conf, tls_debug_callback, priv);
-        mbedtls_debug_set_threshold(4);
+    if (ctx->debug_callback) {
+        mbedtls_ssl_conf_dbg(&gen->ssl_conf, tls_debug_callback, ctx);
     }
 
     /* Load CA certificate */
     if (cfg->ca_cert_path) {
-        ret = mbedtls_x509_crt_parse_file(&priv->ca_cert, cfg->ca_cert_path);
+        ret = mbedtls_x509_crt_parse_file(&gen->ca_cert, cfg->ca_cert_path);
         if (ret != 0) {
-            priv->last_error = DEVPROTO_TLS_ERR_CA_LOAD;
+            *err = DEVPROTO_TLS_ERR_CA_LOAD;
             goto error;
         }
     } else if (cfg->ca_cert && cfg->ca_cert_len > 0) {
-        ret = mbedtls_x509_crt_parse(&priv->ca_cert, cfg->ca_cert, cfg->ca_cert_len);
+        ret = mbedtls_x509_crt_parse(&gen->ca_cert, cfg->ca_cert, cfg->ca_cert_len);
         if (ret != 0) {
-            priv->last_error = DEVPROTO_TLS_ERR_CA_LOAD;
+            *err = DEVPROTO_TLS_ERR_CA_LOAD;
             goto error;
         }
     }
 
     /* Load client certificate for mutual TLS */
     if (cfg->client_cert_path && cfg->client_key_path) {
-        ret = mbedtls_x509_crt_parse_file(&priv->client_cert, cfg->client_cert_path);
+        ret = mbedtls_x509_crt_parse_file(&gen->client_cert, cfg->client_cert_path);
         if (ret != 0) {
-            priv->last_error = DEVPROTO_TLS_ERR_CERT_LOAD;
+            *err = DEVPROTO_TLS_ERR_CERT_LOAD;
             goto error;
         }
 
-        ret = mbedtls_pk_parse_keyfile(&priv->client_key, cfg->client_key_path, NULL);
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        ret = mbedtls_pk_parse_keyfile(&gen->client_key, cfg->client_key_path, NULL,
+                                       tls_random, ctx);
+#else
+        ret = mbedtls_pk_parse_keyfile(&gen->client_key, cfg->client_key_path, NULL);
+#endif
         if (ret != 0) {
-            priv->last_error = DEVPROTO_TLS_ERR_KEY_LOAD;
+            *err = DEVPROTO_TLS_ERR_KEY_LOAD;
             goto error;
         }
 
-        mbedtls_ssl_conf_own_cert(&priv->ssl_conf, &priv->client_cert, &priv->client_key);
+        mbedtls_ssl_conf_own_cert(&gen->ssl_conf, &gen->client_cert, &gen->client_key);
+    } else if (cfg->client_cert && cfg->client_cert_len > 0 &&
+               cfg->client_key && cfg->client_key_len > 0) {
+        ret = mbedtls_x509_crt_parse(&gen->client_cert, cfg->client_cert,
+                                      cfg->client_cert_len);
+        if (ret != 0) {
+            *err = DEVPROTO_TLS_ERR_CERT_LOAD;
+            goto error;
+        }
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        ret = mbedtls_pk_parse_key(&gen->client_key, cfg->client_key,
+                                    cfg->client_key_len, NULL, 0, tls_random, ctx);
+#else
+        ret = mbedtls_pk_parse_key(&gen->client_key, cfg->client_key,
+                                    cfg->client_key_len, NULL, 0);
+#endif
+        if (ret != 0) {
+            *err = DEVPROTO_TLS_ERR_KEY_LOAD;
+            goto error;
+        }
+
+        mbedtls_ssl_conf_own_cert(&gen->ssl_conf, &gen->client_cert, &gen->client_key);
+    }
+
+    /* Configure certificate verification; without verify_server the chain
+     * is still walked (OPTIONAL, not enforced) so tls_verify_seen() can tell
+     * a full handshake from a resumed one */
+    mbedtls_ssl_conf_ca_chain(&gen->ssl_conf, &gen->ca_cert, NULL);
+    mbedtls_ssl_conf_authmode(&gen->ssl_conf,
+        cfg->verify_server ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_OPTIONAL);
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    /* Ask the server for tickets so resumption works with stateless servers
+     * (TLS 1.3 sessions are tickets only) */
+    mbedtls_ssl_conf_session_tickets(&gen->ssl_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#if defined(TLS_HAVE_TLS13) && MBEDTLS_VERSION_NUMBER >= 0x03060100
+    mbedtls_ssl_conf_tls13_enable_signal_new_session_tickets(&gen->ssl_conf,
+        MBEDTLS_SSL_TLS1_3_SIGNAL_NEW_SESSION_TICKETS_ENABLED);
+#endif
+#endif
+
+    return gen;
+
+error:
+    tls_generation_unref(gen);
+    return NULL;
+}
+
+devproto_tls_context_t *devproto_tls_context_create(const devproto_tls_config_t *cfg,
+                                                    devproto_tls_error_t *err) {
+    devproto_tls_error_t dummy;
+    if (!err) err = &dummy;
+    *err = DEVPROTO_TLS_OK;
+
+    if (!cfg) {
+        *err = DEVPROTO_TLS_ERR_INVALID_CONFIG;
+        return NULL;
+    }
+
+    devproto_tls_context_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) {
+        *err = DEVPROTO_TLS_ERR_MEMORY;
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&ctx->lock, NULL) != 0) {
+        free(ctx);
+        *err = DEVPROTO_TLS_ERR_MEMORY;
+        return NULL;
     }
 
-    /* Configure certificate verification */
-    mbedtls_ssl_conf_ca_chain(&priv->ssl_conf, &priv->ca_cert, NULL);
-    mbedtls_ssl_conf_authmode(&priv->ssl_conf,
-        cfg->verify_server ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_NONE);
+    atomic_init(&ctx->refs, 1);
+    ctx->debug_callback = cfg->debug_callback;
+    mbedtls_entropy_init(&ctx->entropy);
+    mbedtls_ctr_drbg_init(&ctx->ctr_drbg);
 
-    /* Setup SSL context */
-    ret = mbedtls_ssl_setup(&priv->ssl_ctx, &priv->ssl_conf);
+    int ret;
+#if defined(TLS_PSA_INIT)
+    /* TLS 1.3 and PSA-backed builds run on PSA crypto; repeated init is a no-op */
+    if (psa_crypto_init() != PSA_SUCCESS) {
+        *err = DEVPROTO_TLS_ERR_MEMORY;
+        goto error;
+    }
+#endif
+
+    /* Seed the random number generator */
+    ret = mbedtls_ctr_drbg_seed(&ctx->ctr_drbg, mbedtls_entropy_func,
+                                     &ctx->entropy, NULL, 0);
     if (ret != 0) {
-        priv->last_error = DEVPROTO_TLS_ERR_INVALID_CONFIG;
+        *err = DEVPROTO_TLS_ERR_MEMORY;
         goto error;
     }
 
+    if (cfg->debug_callback) {
+        mbedtls_debug_set_threshold(4);
+    }
+
+    ctx->current = tls_generation_create(ctx, cfg, err);
+    if (!ctx->current) goto error;
+
+    return ctx;
+
+error:
+    mbedtls_entropy_free(&ctx->entropy);
+    mbedtls_ctr_drbg_free(&ctx->ctr_drbg);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+    return NULL;
+}
+
+devproto_tls_context_t *devproto_tls_context_ref(devproto_tls_context_t *ctx) {
+    if (ctx) atomic_fetch_add_explicit(&ctx->refs, 1, memory_order_relaxed);
+    return ctx;
+}
+
+void devproto_tls_context_unref(devproto_tls_context_t *ctx) {
+    if (!ctx) return;
+    if (atomic_fetch_sub_explicit(&ctx->refs, 1, memory_order_acq_rel) != 1) return;
+
+    tls_generation_unref(ctx->current);
+    mbedtls_entropy_free(&ctx->entropy);
+    mbedtls_ctr_drbg_free(&ctx->ctr_drbg);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+}
+
+int devproto_tls_context_reload(devproto_tls_context_t *ctx,
+                                const devproto_tls_config_t *cfg) {
+    if (!ctx || !cfg) return DEVPROTO_TLS_ERR_INVALID_CONFIG;
+
+    /* Parse outside the lock; handshakes keep running on the old set */
+    devproto_tls_error_t err = DEVPROTO_TLS_OK;
+    tls_generation_t *gen = tls_generation_create(ctx, cfg, &err);
+    if (!gen) return err;
+
+    pthread_mutex_lock(&ctx->lock);
+    tls_generation_t *old = ctx->current;
+    ctx->current = gen;
+    pthread_mutex_unlock(&ctx->lock);
+
+    tls_generation_unref(old);
+    return DEVPROTO_TLS_OK;
+}
+
+/* Chain verification only runs when the server sends its certificate, i.e.
+ * in a full handshake; resumption (session ID, ticket or TLS 1.3 PSK) skips
+ * it. Verification flags are left to mbedTLS. */
+static int tls_verify_seen(void *p, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    (void)crt;
+    (void)depth;
+    (void)flags;
+    ((tls_priv_t *)p)->full_handshake = 1;
+    return 0;
+}
+
+/* Whether the link negotiated TLS 1.3 */
+static int tls_is_tls13(tls_priv_t *priv) {
+#if defined(TLS_HAVE_TLS13)
+    return mbedtls_ssl_get_version_number(&priv->ssl_ctx) == MBEDTLS_SSL_VERSION_TLS1_3;
+#else
+    (void)priv;
+    return 0;
+#endif
+}
+
+/* Bind the SSL context to a generation (fresh handshake state, same SNI) */
+static int tls_setup_ssl(tls_priv_t *priv, tls_generation_t *gen) {
+    mbedtls_ssl_free(&priv->ssl_ctx);
+    mbedtls_ssl_init(&priv->ssl_ctx);
+
+    tls_generation_unref(priv->gen);
+    priv->gen = gen;
+
+    if (mbedtls_ssl_setup(&priv->ssl_ctx, &gen->ssl_conf) != 0) {
+        return -1;
+    }
+    mbedtls_ssl_set_verify(&priv->ssl_ctx, tls_verify_seen, priv);
+
     /* Set hostname for SNI */
-    if (cfg->expected_cn) {
-        mbedtls_ssl_set_hostname(&priv->ssl_ctx, cfg->expected_cn);
+    if (priv->config.expected_cn) {
+        mbedtls_ssl_set_hostname(&priv->ssl_ctx, priv->config.expected_cn);
     } else {
-        mbedtls_ssl_set_hostname(&priv->ssl_ctx, cfg->host);
+        mbedtls_ssl_set_hostname(&priv->ssl_ctx, priv->config.host);
+    }
+
+    return 0;
+}
+
+devproto_transport_t *devproto_transport_tls_create_ctx(devproto_tls_context_t *ctx,
+                                                        const devproto_tls_config_t *cfg) {
+    if (!ctx || !cfg || !cfg->host || cfg->port <= 0) {
+        return NULL;
+    }
+
+    devproto_transport_t *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+
+    tls_priv_t *priv = calloc(1, sizeof(*priv));
+    if (!priv) {
+        free(t);
+        return NULL;
+    }
+
+    /* Copy configuration (certificate fields are taken from ctx instead) */
+    memcpy(&priv->config, cfg, sizeof(*cfg));
+    priv->state = DEVPROTO_TLS_STATE_INIT;
+    priv->last_error = DEVPROTO_TLS_OK;
+    priv->ctx = devproto_tls_context_ref(ctx);
+
+    /* Initialize mbedTLS structures */
+    mbedtls_net_init(&priv->net_ctx);
+    mbedtls_ssl_init(&priv->ssl_ctx);
+    mbedtls_ssl_session_init(&priv->session);
+
+    if (tls_setup_ssl(priv, tls_generation_get(ctx)) != 0) {
+        priv->last_error = DEVPROTO_TLS_ERR_INVALID_CONFIG;
+        mbedtls_ssl_free(&priv->ssl_ctx);
+        tls_generation_unref(priv->gen);
+        devproto_tls_context_unref(priv->ctx);
+        free(priv);
+        free(t);
+        return NULL;
     }
 
     t->type = DEVPROTO_TRANSPORT_TLS;
@@ -219,66 +522,235 @@ devproto_transport_t *devproto_transport_tls_create(const devproto_tls_config_t
     t->is_open = 0;
 
     return t;
+}
+
+devproto_transport_t *devproto_transport_tls_create(const devproto_tls_config_t *cfg) {
+    if (!cfg || !cfg->host || cfg->port <= 0) {
+        return NULL;
+    }
+
+    /* Private context; the transport holds the only reference */
+    devproto_tls_context_t *ctx = devproto_tls_context_create(cfg, NULL);
+    if (!ctx) return NULL;
+
+    devproto_transport_t *t = devproto_transport_tls_create_ctx(ctx, cfg);
+    devproto_tls_context_unref(ctx);
+    return t;
+}
 
-error:
-    mbedtls_net_free(&priv->net_ctx);
-    mbedtls_ssl_free(&priv->ssl_ctx);
-    mbedtls_ssl_config_free(&priv->ssl_conf);
-    mbedtls_x509_crt_free(&priv->ca_cert);
-    mbedtls_x509_crt_free(&priv->client_cert);
-    mbedtls_pk_free(&priv->client_key);
-    mbedtls_entropy_free(&priv->entropy);
-    mbedtls_ctr_drbg_free(&priv->ctr_drbg);
-    free(priv);
-    free(t);
-    return NULL;
+/* BIO callbacks: read timeout is per connection, not in the shared config */
+static int tls_bio_send(void *p, const unsigned char *buf, size_t len) {
+    return mbedtls_net_send(&((tls_priv_t *)p)->net_ctx, buf, len);
 }
 
-static int tls_open(devproto_transport_t *t) {
-    if (!t || !t->priv) return -1;
-    tls_priv_t *priv = (tls_priv_t *)t->priv;
+static int tls_bio_recv_timeout(void *p, unsigned char *buf, size_t len, uint32_t timeout) {
+    tls_priv_t *priv = (tls_priv_t *)p;
+    (void)timeout;
+    return mbedtls_net_recv_timeout(&priv->net_ctx, buf, len, priv->io_timeout_ms);
+}
 
-    if (t->is_open) return 0;
+/* When a session was established (its lifetime counts from the full
+ * handshake); 3.x keeps the start private, so there it counts from caching */
+static time_t tls_session_start(const mbedtls_ssl_session *session) {
+#if defined(MBEDTLS_HAVE_TIME) && MBEDTLS_VERSION_NUMBER < 0x03000000
+    if (session->start > 0) return (time_t)session->start;
+#else
+    (void)session;
+#endif
+    return time(NULL);
+}
 
-    priv->state = DEVPROTO_TLS_STATE_HANDSHAKE;
+/* Forget the cached session */
+static void tls_session_drop(tls_priv_t *priv) {
+    mbedtls_ssl_session_free(&priv->session);
+    mbedtls_ssl_session_init(&priv->session);
+    priv->have_session = 0;
+}
 
-    /* Connect TCP */
-    char port_str[16];
-    snprintf(port_str, sizeof(port_str), "%d", priv->config.port);
+/* Snapshot the live session into the cache and hand it to session_save */
+static void tls_session_store(tls_priv_t *priv) {
+    if (priv->config.no_session_cache) return;
 
-    int ret = mbedtls_net_connect(&priv->net_ctx, priv->config.host, port_str,
-                                   MBEDTLS_NET_PROTO_TCP);
-    if (ret != 0) {
-        priv->last_error = DEVPROTO_TLS_ERR_CONNECT;
-        priv->state = DEVPROTO_TLS_STATE_ERROR;
-        return -1;
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_get_session(&priv->ssl_ctx, &session) != 0) {
+        mbedtls_ssl_session_free(&session);
+        return;
+    }
+
+    mbedtls_ssl_session_free(&priv->session);
+    priv->session = session;
+    priv->have_session = 1;
+    /* Tickets on a resumed link keep the lifetime of the full handshake */
+    if (priv->full_handshake) priv->session_time = tls_session_start(&priv->session);
+
+    if (!priv->config.session_save) return;
+
+    /* First call only reports the required size */
+    size_t len = 0;
+    mbedtls_ssl_session_save(&priv->session, NULL, 0, &len);
+    if (len == 0 || len > TLS_SESSION_BLOB_MAX) return;
+
+    uint8_t *blob = malloc(len);
+    if (!blob) return;
+    if (mbedtls_ssl_session_save(&priv->session, blob, len, &len) == 0) {
+        priv->config.session_save(blob, len, priv->config.session_user);
+    }
+    mbedtls_platform_zeroize(blob, len);
+    free(blob);
+}
+
+/* Restore a persisted session on the first open */
+static void tls_session_restore(tls_priv_t *priv) {
+    if (priv->session_loaded || priv->have_session) return;
+    priv->session_loaded = 1;
+    if (!priv->config.session_load) return;
+
+    uint8_t *blob = malloc(TLS_SESSION_BLOB_MAX);
+    if (!blob) return;
+
+    int len = priv->config.session_load(blob, TLS_SESSION_BLOB_MAX, priv->config.session_user);
+    if (len > 0 && len <= TLS_SESSION_BLOB_MAX &&
+        mbedtls_ssl_session_load(&priv->session, blob, (size_t)len) == 0) {
+        priv->have_session = 1;
+        priv->session_time = tls_session_start(&priv->session);
+    } else {
+        tls_session_drop(priv);
+    }
+
+    mbedtls_platform_zeroize(blob, TLS_SESSION_BLOB_MAX);
+    free(blob);
+}
+
+/* Offer the cached session (if still fresh) for the coming handshake */
+static void tls_session_offer(tls_priv_t *priv) {
+    if (priv->config.no_session_cache) return;
+
+    tls_session_restore(priv);
+    if (!priv->have_session) return;
+
+    if (priv->config.session_lifetime_s > 0 &&
+        time(NULL) - priv->session_time > (time_t)priv->config.session_lifetime_s) {
+        tls_session_drop(priv);
+        return;
+    }
+
+    if (mbedtls_ssl_set_session(&priv->ssl_ctx, &priv->session) != 0) {
+        tls_session_drop(priv);
     }
+}
+
+/* Milliseconds on the monotonic clock */
+static int64_t tls_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-    /* Set timeout */
-    mbedtls_ssl_conf_read_timeout(&priv->ssl_conf, priv->config.handshake_timeout_ms);
+/* Check the in-progress connect: 0 connected, 1 still pending, -1 all addresses failed */
+static int tls_connect_poll(tls_priv_t *priv) {
+    int fd;
+    int ret = devproto_connector_step(&priv->connector, &fd);
+    if (ret != 0) return ret;
+
+    priv->net_ctx.fd = fd;
+    devproto_net_set_keepalive(fd, &priv->config.keepalive);
+    return 0;
+}
+
+/* Non-blocking handshake BIO (the socket stays non-blocking until connected) */
+static int tls_bio_recv(void *p, unsigned char *buf, size_t len) {
+    return mbedtls_net_recv(&((tls_priv_t *)p)->net_ctx, buf, len);
+}
+
+/* Abort an open attempt */
+static int tls_open_fail(devproto_transport_t *t, tls_priv_t *priv, devproto_tls_error_t err) {
+    devproto_resolve_cancel(priv->resolve);
+    priv->resolve = NULL;
+    devproto_connector_cancel(&priv->connector);
+    priv->connecting = 0;
+    mbedtls_net_free(&priv->net_ctx);
+    t->fd = -1;
+
+    priv->last_error = err;
+    priv->state = DEVPROTO_TLS_STATE_ERROR;
+    return err;
+}
+
+/* Start the TCP connect to resolved addresses and arm the handshake */
+static int tls_connect_begin(devproto_transport_t *t, tls_priv_t *priv,
+                             const devproto_addr_list_t *addrs) {
+    if (devproto_connector_start(&priv->connector, addrs, 0, -1) != 0) {
+        return tls_open_fail(t, priv, DEVPROTO_TLS_ERR_CONNECT);
+    }
+
+    int ret = tls_connect_poll(priv);
+    if (ret < 0) return tls_open_fail(t, priv, DEVPROTO_TLS_ERR_CONNECT);
+
+    priv->connecting = ret;
+    t->fd = ret ? devproto_connector_fd(&priv->connector) : priv->net_ctx.fd;
 
     /* Set I/O functions */
-    mbedtls_ssl_set_bio(&priv->ssl_ctx, &priv->net_ctx,
-                         mbedtls_net_send, mbedtls_net_recv, mbedtls_net_recv_timeout);
-
-    /* Perform TLS handshake */
-    while ((ret = mbedtls_ssl_handshake(&priv->ssl_ctx)) != 0) {
-        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-            priv->last_error = DEVPROTO_TLS_ERR_HANDSHAKE;
-            priv->state = DEVPROTO_TLS_STATE_ERROR;
-            mbedtls_net_free(&priv->net_ctx);
-            return -1;
+    mbedtls_ssl_set_bio(&priv->ssl_ctx, priv, tls_bio_send, tls_bio_recv, NULL);
+
+    /* Abbreviated handshake if we still hold a session for this server */
+    tls_session_offer(priv);
+
+    return DEVPROTO_TLS_OK;
+}
+
+/* Prepare a new connection attempt and start resolving the server */
+static int tls_open_begin(devproto_transport_t *t, tls_priv_t *priv) {
+    /* Pick up reloaded certificates; otherwise just clear per-connection state */
+    tls_generation_t *gen = tls_generation_get(priv->ctx);
+    int ret = 0;
+    if (gen != priv->gen) {
+        /* Sessions verified against the old trust store are not reused */
+        tls_session_drop(priv);
+        ret = tls_setup_ssl(priv, gen);
+    } else {
+        tls_generation_unref(gen);
+        if (priv->state != DEVPROTO_TLS_STATE_INIT) {
+            ret = mbedtls_ssl_session_reset(&priv->ssl_ctx);
         }
     }
+    if (ret != 0) return tls_open_fail(t, priv, DEVPROTO_TLS_ERR_MEMORY);
+
+    priv->state = DEVPROTO_TLS_STATE_HANDSHAKE;
+    priv->full_handshake = 0;
+    priv->deadline_ms = priv->config.handshake_timeout_ms > 0 ?
+        tls_now_ms() + priv->config.handshake_timeout_ms : 0;
+
+    /* Resolve through the shared cache; a miss goes to a helper thread and
+     * t->fd waits on it */
+    devproto_resolver_t *resolver = priv->config.resolver ? priv->config.resolver :
+                                                             devproto_resolver_default();
+    devproto_addr_list_t addrs;
+    ret = devproto_resolver_start(resolver, priv->config.host, priv->config.port,
+                                  AF_UNSPEC, &addrs, &priv->resolve);
+    if (ret < 0) return tls_open_fail(t, priv, DEVPROTO_TLS_ERR_CONNECT);
+    if (ret > 0) {
+        t->fd = devproto_resolve_fd(priv->resolve);
+        return DEVPROTO_TLS_OK;
+    }
 
+    return tls_connect_begin(t, priv, &addrs);
+}
+
+/* Handshake done: verify, cache the session, switch to blocking I/O */
+static int tls_open_finish(devproto_transport_t *t, tls_priv_t *priv) {
     /* Verify server certificate */
     priv->verify_result = mbedtls_ssl_get_verify_result(&priv->ssl_ctx);
     if (priv->config.verify_server && priv->verify_result != 0) {
-        priv->last_error = DEVPROTO_TLS_ERR_VERIFY;
-        priv->state = DEVPROTO_TLS_STATE_ERROR;
         mbedtls_ssl_close_notify(&priv->ssl_ctx);
-        mbedtls_net_free(&priv->net_ctx);
-        return -1;
+        tls_session_drop(priv);
+        return tls_open_fail(t, priv, DEVPROTO_TLS_ERR_VERIFY);
+    }
+
+    /* A resumed session is already cached, with its original start time;
+     * TLS 1.3 tickets arrive after the handshake and are cached by tls_recv */
+    if (priv->full_handshake && !tls_is_tls13(priv)) {
+        tls_session_store(priv);
     }
 
     /* Store server CN */
@@ -288,20 +760,117 @@ static int tls_open(devproto_transport_t *t) {
                               &peer_cert->subject);
     }
 
-    /* Set read timeout for normal operations */
-    mbedtls_ssl_conf_read_timeout(&priv->ssl_conf, priv->config.read_timeout_ms);
+    /* The socket stays non-blocking: reads wait in the per-call timeout and
+     * writes in tls_wait_writable(), so neither blocks past its timeout */
+    mbedtls_ssl_set_bio(&priv->ssl_ctx, priv, tls_bio_send, NULL, tls_bio_recv_timeout);
+    priv->io_timeout_ms = (uint32_t)priv->config.read_timeout_ms;
 
     t->fd = priv->net_ctx.fd;
     t->is_open = 1;
     priv->state = DEVPROTO_TLS_STATE_CONNECTED;
 
-    return 0;
+    return DEVPROTO_TLS_OK;
+}
+
+int devproto_tls_handshake_step(devproto_transport_t *t) {
+    if (!t || !t->priv) return DEVPROTO_TLS_ERR_INVALID_CONFIG;
+    if (t->type != DEVPROTO_TRANSPORT_TLS) return DEVPROTO_TLS_ERR_INVALID_CONFIG;
+    tls_priv_t *priv = (tls_priv_t *)t->priv;
+
+    if (t->is_open) return DEVPROTO_TLS_OK;
+
+    if (priv->state != DEVPROTO_TLS_STATE_HANDSHAKE) {
+        int ret = tls_open_begin(t, priv);
+        if (ret != DEVPROTO_TLS_OK) return ret;
+    }
+
+    if (priv->deadline_ms && tls_now_ms() >= priv->deadline_ms) {
+        tls_session_drop(priv);
+        return tls_open_fail(t, priv, priv->resolve || priv->connecting ?
+                                      DEVPROTO_TLS_ERR_CONNECT : DEVPROTO_TLS_ERR_HANDSHAKE);
+    }
+
+    /* Name lookup still running */
+    if (priv->resolve) {
+        devproto_addr_list_t addrs;
+        int ret = devproto_resolve_finish(priv->resolve, &addrs);
+        if (ret > 0) return DEVPROTO_TLS_ERR_WANT_READ;
+        priv->resolve = NULL;
+        if (ret < 0) return tls_open_fail(t, priv, DEVPROTO_TLS_ERR_CONNECT);
+
+        ret = tls_connect_begin(t, priv, &addrs);
+        if (ret != DEVPROTO_TLS_OK) return ret;
+    }
+
+    /* TCP connect still in flight */
+    if (priv->connecting) {
+        int ret = tls_connect_poll(priv);
+        if (ret < 0) return tls_open_fail(t, priv, DEVPROTO_TLS_ERR_CONNECT);
+        if (ret > 0) {
+            t->fd = devproto_connector_fd(&priv->connector);
+            return DEVPROTO_TLS_ERR_WANT_WRITE;
+        }
+        t->fd = priv->net_ctx.fd;
+        priv->connecting = 0;
+    }
+
+    /* Resumption shows in tls_verify_seen() not being called */
+    int ret = mbedtls_ssl_handshake(&priv->ssl_ctx);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ) return DEVPROTO_TLS_ERR_WANT_READ;
+    if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) return DEVPROTO_TLS_ERR_WANT_WRITE;
+    if (ret != 0) {
+        /* Don't keep offering a session that may be what broke it */
+        tls_session_drop(priv);
+        priv->verify_result = mbedtls_ssl_get_verify_result(&priv->ssl_ctx);
+        return tls_open_fail(t, priv, ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED ?
+                                      DEVPROTO_TLS_ERR_VERIFY : DEVPROTO_TLS_ERR_HANDSHAKE);
+    }
+
+    return tls_open_finish(t, priv);
+}
+
+/* Transport open_step op */
+static int tls_open_step(devproto_transport_t *t) {
+    int ret = devproto_tls_handshake_step(t);
+    if (ret == DEVPROTO_TLS_ERR_WANT_READ) return DEVPROTO_TRANSPORT_WANT_READ;
+    if (ret == DEVPROTO_TLS_ERR_WANT_WRITE) return DEVPROTO_TRANSPORT_WANT_WRITE;
+    return ret == DEVPROTO_TLS_OK ? 0 : -1;
+}
+
+/* Blocking open: drive the state machine, sleeping in poll() between steps */
+static int tls_open(devproto_transport_t *t) {
+    if (!t || !t->priv) return -1;
+    tls_priv_t *priv = (tls_priv_t *)t->priv;
+
+    for (;;) {
+        int ret = tls_open_step(t);
+        if (ret <= 0) return ret;
+
+        int wait = -1;
+        if (priv->deadline_ms) {
+            int64_t left = priv->deadline_ms - tls_now_ms();
+            wait = left > 0 ? (int)left : 0;
+        }
+
+        struct pollfd pfd = {
+            .fd = t->fd,
+            .events = (ret == DEVPROTO_TRANSPORT_WANT_READ) ? POLLIN : POLLOUT
+        };
+        poll(&pfd, 1, wait);
+    }
 }
 
 static void tls_close(devproto_transport_t *t) {
     if (!t || !t->priv) return;
     tls_priv_t *priv = (tls_priv_t *)t->priv;
 
+    /* Abandon a handshake in progress */
+    if (!t->is_open && priv->state == DEVPROTO_TLS_STATE_HANDSHAKE) {
+        tls_open_fail(t, priv, DEVPROTO_TLS_ERR_CLOSED);
+        priv->state = DEVPROTO_TLS_STATE_CLOSED;
+        return;
+    }
+
     if (!t->is_open) return;
 
     priv->state = DEVPROTO_TLS_STATE_CLOSING;
@@ -317,6 +886,28 @@ static void tls_close(devproto_transport_t *t) {
     priv->state = DEVPROTO_TLS_STATE_CLOSED;
 }
 
+/* Wait until the socket takes more data: 1 writable, 0 deadline passed, -1 error */
+static int tls_wait_writable(int fd, int64_t deadline_ms) {
+    for (;;) {
+        int timeout = -1;
+        if (deadline_ms >= 0) {
+            int64_t left = deadline_ms - tls_now_ms();
+            timeout = left > 0 ? (int)left : 0;
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        int ret = poll(&pfd, 1, timeout);
+
+        if (ret > 0) {
+            return (pfd.revents & (POLLERR | POLLNVAL)) ? -1 : 1;
+        } else if (ret == 0) {
+            return 0;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
 static int tls_send(devproto_transport_t *t, const uint8_t *data, size_t len) {
     if (!t || !t->priv || !data) return -1;
     tls_priv_t *priv = (tls_priv_t *)t->priv;
@@ -326,6 +917,11 @@ static int tls_send(devproto_transport_t *t, const uint8_t *data, size_t len) {
         return -1;
     }
 
+    int64_t deadline = -1;
+    if (priv->config.write_timeout_ms >= 0) {
+        deadline = tls_now_ms() + priv->config.write_timeout_ms;
+    }
+
     int ret;
     size_t written = 0;
 
@@ -334,7 +930,20 @@ static int tls_send(devproto_transport_t *t, const uint8_t *data, size_t len) {
         if (ret > 0) {
             written += ret;
         } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
-            continue;
+            /* Backpressure: sleep until writable rather than spinning. The
+             * record mbedTLS holds is finished by the next call with the
+             * same data, so what was written so far can be reported. */
+            int ready = tls_wait_writable(priv->net_ctx.fd, deadline);
+            if (ready < 0) {
+                priv->last_error = DEVPROTO_TLS_ERR_SEND;
+                return -1;
+            }
+            if (ready == 0) {
+                if (written > 0) break;
+                priv->last_error = DEVPROTO_TLS_ERR_SEND;
+                errno = ETIMEDOUT;
+                return -1;
+            }
         } else {
             priv->last_error = DEVPROTO_TLS_ERR_SEND;
             return -1;
@@ -353,12 +962,19 @@ static int tls_recv(devproto_transport_t *t, uint8_t *data, size_t len, int time
         return -1;
     }
 
-    /* Set timeout for this operation */
+    /* Set timeout for this operation (mbedTLS treats 0 as "wait forever") */
     if (timeout_ms >= 0) {
-        mbedtls_ssl_conf_read_timeout(&priv->ssl_conf, timeout_ms);
+        priv->io_timeout_ms = timeout_ms > 0 ? (uint32_t)timeout_ms : 1;
     }
 
     int ret = mbedtls_ssl_read(&priv->ssl_ctx, data, len);
+#if defined(MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET)
+    /* TLS 1.3 session tickets come after the handshake: cache the newest */
+    while (ret == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
+        tls_session_store(priv);
+        ret = mbedtls_ssl_read(&priv->ssl_ctx, data, len);
+    }
+#endif
 
     if (ret > 0) {
         return ret;
@@ -403,12 +1019,8 @@ int devproto_tls_get_info(devproto_transport_t *t, devproto_tls_info_t *info) {
     info->cipher_suite = mbedtls_ssl_get_ciphersuite(&priv->ssl_ctx);
     info->server_cn = priv->server_cn;
     info->verify_result = priv->verify_result;
-    info->session_resumed = mbedtls_ssl_session_resumed(&priv->ssl_ctx);
-
-    /* Get negotiated version */
-    int version = mbedtls_ssl_get_version_number(&priv->ssl_ctx);
-    info->version = (version == MBEDTLS_SSL_VERSION_TLS1_3) ?
-        DEVPROTO_TLS_VERSION_1_3 : DEVPROTO_TLS_VERSION_1_2;
+    info->session_resumed = !priv->full_handshake;
+    info->version = tls_is_tls13(priv) ? DEVPROTO_TLS_VERSION_1_3 : DEVPROTO_TLS_VERSION_1_2;
 
     return DEVPROTO_TLS_OK;
 }
@@ -461,6 +1073,14 @@ int devproto_tls_renegotiate(devproto_transport_t *t) {
     return DEVPROTO_TLS_OK;
 }
 
+int devproto_tls_session_clear(devproto_transport_t *t) {
+    if (!t || !t->priv) return DEVPROTO_TLS_ERR_INVALID_CONFIG;
+    if (t->type != DEVPROTO_TRANSPORT_TLS) return DEVPROTO_TLS_ERR_INVALID_CONFIG;
+
+    tls_session_drop((tls_priv_t *)t->priv);
+    return DEVPROTO_TLS_OK;
+}
+
 int devproto_tls_available(void) {
     return 1;
 }
@@ -469,27 +1089,31 @@ const char *devproto_tls_version(void) {
     return MBEDTLS_VERSION_STRING;
 }
 
-/* Cleanup function for transport destroy */
-void devproto_transport_tls_destroy(devproto_transport_t *t) {
-    if (!t || !t->priv) return;
-    if (t->type != DEVPROTO_TRANSPORT_TLS) return;
-
+/* Release connection state and the context reference (transport ops destroy) */
+static void tls_destroy(devproto_transport_t *t) {
     tls_priv_t *priv = (tls_priv_t *)t->priv;
 
-    tls_close(t);
-
+    devproto_resolve_cancel(priv->resolve);
+    devproto_connector_cancel(&priv->connector);
+    mbedtls_ssl_session_free(&priv->session);
     mbedtls_ssl_free(&priv->ssl_ctx);
-    mbedtls_ssl_config_free(&priv->ssl_conf);
-    mbedtls_x509_crt_free(&priv->ca_cert);
-    mbedtls_x509_crt_free(&priv->client_cert);
-    mbedtls_pk_free(&priv->client_key);
-    mbedtls_entropy_free(&priv->entropy);
-    mbedtls_ctr_drbg_free(&priv->ctr_drbg);
+    mbedtls_net_free(&priv->net_ctx);
+    tls_generation_unref(priv->gen);
+    devproto_tls_context_unref(priv->ctx);
 
     free(priv);
     t->priv = NULL;
 }
 
+/* Cleanup function for transport destroy */
+void devproto_transport_tls_destroy(devproto_transport_t *t) {
+    if (!t || !t->priv) return;
+    if (t->type != DEVPROTO_TRANSPORT_TLS) return;
+
+    tls_close(t);
+    tls_destroy(t);
+}
+
 #else /* !DEVPROTO_TLS_ENABLE */
 
 /* Stub implementation when TLS is disabled */
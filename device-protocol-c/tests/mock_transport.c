@@ -0,0 +1,143 @@
+/**
+ * @file mock_transport.c
+ * @brief Recording mock transport shared by the unit tests
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "mock_transport.h"
+
+uint8_t mock_wire[MOCK_WIRE_SIZE];
+size_t  mock_wire_len;
+int     mock_calls;
+uint8_t mock_seqs[MOCK_CALLS_MAX];
+size_t  mock_lens[MOCK_CALLS_MAX];
+size_t  mock_limit = MOCK_WIRE_SIZE;
+size_t  mock_chunk;
+
+uint8_t mock_rx[MOCK_RX_SIZE];
+size_t  mock_rx_len;
+size_t  mock_rx_chunk;
+
+void mock_reset(void)
+{
+    mock_wire_len = 0;
+    mock_calls = 0;
+    mock_limit = MOCK_WIRE_SIZE;
+    mock_chunk = 0;
+    mock_rx_len = 0;
+    mock_rx_chunk = 0;
+}
+
+/**
+ * Capture up to len bytes, as far as the limit allows
+ */
+static int mock_accept(const uint8_t *data, size_t len)
+{
+    size_t limit = mock_limit < MOCK_WIRE_SIZE ? mock_limit : MOCK_WIRE_SIZE;
+    if (mock_wire_len >= limit) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (len > limit - mock_wire_len) len = limit - mock_wire_len;
+    memcpy(mock_wire + mock_wire_len, data, len);
+    mock_wire_len += len;
+    return (int)len;
+}
+
+/**
+ * Note one send call; frames start with their sequence at byte 5
+ */
+static void mock_record(const uint8_t *first, size_t len)
+{
+    if (mock_calls < MOCK_CALLS_MAX) {
+        mock_seqs[mock_calls] = first && len >= DEVPROTO_HEADER_SIZE ? first[5] : 0;
+        mock_lens[mock_calls] = len;
+    }
+    mock_calls++;
+}
+
+static int mock_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+{
+    (void)t;
+    mock_record(data, len);
+    if (mock_chunk && len > mock_chunk) len = mock_chunk;
+    return mock_accept(data, len);
+}
+
+static int mock_sendv(devproto_transport_t *t, const struct iovec *iov, int iovcnt)
+{
+    (void)t;
+
+    size_t total_len = 0;
+    for (int i = 0; i < iovcnt; i++) total_len += iov[i].iov_len;
+    mock_record(iovcnt > 0 && iov[0].iov_len >= DEVPROTO_HEADER_SIZE ? iov[0].iov_base : NULL,
+                total_len);
+
+    size_t budget = mock_chunk ? mock_chunk : SIZE_MAX;
+    int total = 0;
+    for (int i = 0; i < iovcnt && budget > 0; i++) {
+        size_t len = iov[i].iov_len < budget ? iov[i].iov_len : budget;
+        int n = mock_accept(iov[i].iov_base, len);
+        if (n < 0) return total > 0 ? total : -1;
+        total += n;
+        budget -= (size_t)n;
+        if ((size_t)n < len) break;
+    }
+    return total;
+}
+
+int mock_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms)
+{
+    (void)t;
+    if (mock_rx_len == 0) {
+        if (timeout_ms > 0) {
+            struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+            nanosleep(&ts, NULL);
+        }
+        return 0;
+    }
+    if (mock_rx_chunk && len > mock_rx_chunk) len = mock_rx_chunk;
+    if (len > mock_rx_len) len = mock_rx_len;
+    memcpy(data, mock_rx, len);
+    memmove(mock_rx, mock_rx + len, mock_rx_len - len);
+    mock_rx_len -= len;
+    return (int)len;
+}
+
+const devproto_transport_ops_t mock_ops = {
+    .send = mock_send,
+    .recv = mock_recv
+};
+
+const devproto_transport_ops_t mock_ops_sendv = {
+    .send  = mock_send,
+    .sendv = mock_sendv,
+    .recv  = mock_recv
+};
+
+int mock_queue_message(const devproto_message_t *msg)
+{
+    int n = devproto_frame_build(msg, mock_rx + mock_rx_len, sizeof(mock_rx) - mock_rx_len);
+    if (n <= 0) return -1;
+    mock_rx_len += (size_t)n;
+    return 0;
+}
+
+void mock_queue(uint8_t type, uint8_t seq)
+{
+    devproto_message_t msg = { .msg_type = type, .sequence = seq };
+    mock_queue_message(&msg);
+}
+
+int mock_wire_frames(devproto_message_t *msgs, size_t max)
+{
+    static devproto_frame_parser_t parser;
+    static uint8_t storage[MOCK_WIRE_SIZE];
+    devproto_frame_slab_t slab;
+
+    devproto_frame_parser_init(&parser);
+    devproto_frame_slab_init(&slab, storage, sizeof(storage));
+    return devproto_frame_parse_slab(&parser, mock_wire, mock_wire_len, &slab, msgs, max, NULL);
+}
@@ -0,0 +1,71 @@
+/**
+ * @file mock_transport.h
+ * @brief Recording mock transport shared by the unit tests
+ *
+ * Sends are captured in mock_wire, receives are served from mock_rx. The
+ * state is global, so a test uses one mock link at a time:
+ *
+ *   devproto_transport_t t = MOCK_TRANSPORT(&mock_ops);
+ */
+
+#ifndef DEVPROTO_TESTS_MOCK_TRANSPORT_H
+#define DEVPROTO_TESTS_MOCK_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "devproto/transport.h"
+#include "devproto/frame.h"
+
+#define MOCK_WIRE_SIZE  16384
+#define MOCK_RX_SIZE    (64 * 1024)
+#define MOCK_CALLS_MAX  64
+
+/* Open mock transport over the given ops */
+#define MOCK_TRANSPORT(ops_ptr) { .ops = (ops_ptr), .fd = -1, .is_open = 1 }
+
+/* Sent bytes */
+extern uint8_t mock_wire[MOCK_WIRE_SIZE];
+extern size_t  mock_wire_len;
+extern int     mock_calls;                  /* send/sendv calls */
+extern uint8_t mock_seqs[MOCK_CALLS_MAX];   /* Sequence byte of each call */
+extern size_t  mock_lens[MOCK_CALLS_MAX];   /* Length of each call */
+extern size_t  mock_limit;                  /* Bytes accepted before refusing with EAGAIN */
+extern size_t  mock_chunk;                  /* Max bytes per send call (0 = all) */
+
+/* Bytes for recv */
+extern uint8_t mock_rx[MOCK_RX_SIZE];
+extern size_t  mock_rx_len;
+extern size_t  mock_rx_chunk;               /* Max bytes per recv call (0 = all) */
+
+/* send + recv, and send + sendv + recv */
+extern const devproto_transport_ops_t mock_ops;
+extern const devproto_transport_ops_t mock_ops_sendv;
+
+/**
+ * Clear both directions and restore the defaults (accept everything)
+ */
+void mock_reset(void);
+
+/**
+ * Receive op: serves mock_rx, sleeping for timeout_ms when it is empty
+ */
+int mock_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms);
+
+/**
+ * Queue a payload-less frame for mock_recv
+ */
+void mock_queue(uint8_t type, uint8_t seq);
+
+/**
+ * Queue a built message for mock_recv
+ * @return  0 on success, -1 if it does not fit
+ */
+int mock_queue_message(const devproto_message_t *msg);
+
+/**
+ * Parse the frames on the mock wire
+ * @return  Number of frames (payloads stay valid until the next call)
+ */
+int mock_wire_frames(devproto_message_t *msgs, size_t max);
+
+#endif /* DEVPROTO_TESTS_MOCK_TRANSPORT_H */
@@ -0,0 +1,477 @@
+/**
+ * @file test_capture.c
+ * @brief Capture file, recording tap and replay transport unit tests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "devproto/capture.h"
+#include "devproto/transport.h"
+#include "devproto/frame.h"
+#include "devproto/protocol.h"
+#include "devproto/stats.h"
+#include "mock_transport.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+/**
+ * Reserve a temporary file name
+ */
+static void temp_path(char *path)
+{
+    strcpy(path, "/tmp/devproto_cap_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd >= 0) close(fd);
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+void test_capture_roundtrip(void)
+{
+    TEST("write, finish and map a capture");
+
+    char path[32];
+    temp_path(path);
+    devproto_capture_t *cap = devproto_capture_create(path);
+
+    static uint8_t big[100000];
+    for (size_t i = 0; i < sizeof(big); i++) big[i] = (uint8_t)(i * 31);
+
+    const uint8_t a[] = { 1, 2, 3 };
+    const uint8_t b[] = { 9, 8, 7, 6, 5 };
+    devproto_capture_record(cap, 1, DEVPROTO_CAPTURE_OUT, a, sizeof(a));
+    devproto_capture_record(cap, 2, DEVPROTO_CAPTURE_IN, b, sizeof(b));
+    devproto_capture_record(cap, 1, DEVPROTO_CAPTURE_IN, big, sizeof(big));
+    devproto_capture_record(cap, 1, DEVPROTO_CAPTURE_IN, NULL, 0);
+
+    if (!cap || devproto_capture_finish(cap) != 0) {
+        FAIL("finish");
+        devproto_capture_destroy(cap);
+        unlink(path);
+        return;
+    }
+    /* Finished captures drop records */
+    if (devproto_capture_record(cap, 1, DEVPROTO_CAPTURE_IN, a, sizeof(a)) != -1) {
+        FAIL("record after finish");
+        return;
+    }
+    devproto_capture_destroy(cap);
+
+    devproto_capture_reader_t *r = devproto_capture_reader_open(path);
+    unlink(path);
+    if (!r) {
+        FAIL("open");
+        return;
+    }
+
+    devproto_capture_info_t info;
+    devproto_capture_reader_info(r, &info);
+    const devproto_capture_conn_t *c1 = devproto_capture_reader_conn(r, 0);
+    const devproto_capture_conn_t *c2 = devproto_capture_reader_conn(r, 1);
+    if (!info.indexed || info.records != 4 || info.conn_count != 2 || info.start_time_us == 0 ||
+        !c1 || c1->conn != 1 || c1->records_in != 2 || c1->records_out != 1 ||
+        c1->bytes_in != sizeof(big) || c1->bytes_out != 3 ||
+        !c2 || c2->conn != 2 || c2->bytes_in != 5 || devproto_capture_reader_conn(r, 2)) {
+        FAIL("summary");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    size_t cursor = 0;
+    devproto_capture_entry_t e[5];
+    int n = 0;
+    while (n < 5 && devproto_capture_reader_next(r, &cursor, &e[n]) == 1) n++;
+
+    if (n != 4 ||
+        e[0].conn != 1 || e[0].dir != DEVPROTO_CAPTURE_OUT || e[0].len != 3 ||
+        memcmp(e[0].data, a, 3) != 0 ||
+        e[1].conn != 2 || e[1].dir != DEVPROTO_CAPTURE_IN || memcmp(e[1].data, b, 5) != 0 ||
+        e[2].len != sizeof(big) || memcmp(e[2].data, big, sizeof(big)) != 0 ||
+        e[3].len != 0 ||
+        e[1].time_us < e[0].time_us || e[3].time_us < e[2].time_us ||
+        info.duration_us != e[3].time_us) {
+        FAIL("records");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    devproto_capture_reader_destroy(r);
+    PASS();
+}
+
+void test_capture_recovery(void)
+{
+    TEST("unfinished capture read up to its last whole record");
+
+    char path[32];
+    temp_path(path);
+    devproto_capture_t *cap = devproto_capture_create(path);
+
+    uint8_t data[50];
+    memset(data, 0x5A, sizeof(data));
+    for (int i = 0; i < 10; i++) {
+        devproto_capture_record(cap, (uint16_t)(i % 3), DEVPROTO_CAPTURE_IN, data, sizeof(data));
+    }
+    devproto_capture_finish(cap);
+    devproto_capture_destroy(cap);
+
+    /* Cut the file in the middle of record 8: index gone, header points past the end */
+    off_t cut = DEVPROTO_CAPTURE_HEADER_SIZE + 7 * (DEVPROTO_CAPTURE_RECORD_HEADER + 50) + 20;
+    if (truncate(path, cut) != 0) {
+        FAIL("truncate");
+        unlink(path);
+        return;
+    }
+
+    devproto_capture_reader_t *r = devproto_capture_reader_open(path);
+    unlink(path);
+
+    devproto_capture_info_t info;
+    devproto_capture_reader_info(r, &info);
+    const devproto_capture_conn_t *c0 = devproto_capture_reader_conn(r, 0);
+    if (!r || info.indexed || info.records != 7 || info.conn_count != 3 ||
+        !c0 || c0->records_in != 3 || c0->bytes_in != 150) {
+        FAIL("recovered summary");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    size_t cursor = 0;
+    devproto_capture_entry_t e;
+    int n = 0;
+    while (devproto_capture_reader_next(r, &cursor, &e) == 1) n++;
+    if (n != 7) {
+        FAIL("recovered records");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    devproto_capture_reader_destroy(r);
+
+    /* Not a capture at all */
+    temp_path(path);
+    FILE *f = fopen(path, "w");
+    fputs("this is not a capture file, just some text", f);
+    fclose(f);
+    r = devproto_capture_reader_open(path);
+    unlink(path);
+    if (r) {
+        FAIL("accepted garbage");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    PASS();
+}
+
+void test_capture_tap(void)
+{
+    TEST("recording tap on transport calls");
+
+    char path[32];
+    temp_path(path);
+    devproto_capture_t *cap = devproto_capture_create(path);
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops);
+    devproto_transport_set_capture(&t, cap, 42);
+
+    const uint8_t out[] = { 0xAA, 0x55, 1, 2 };
+    uint8_t rx[64];
+    struct iovec iov[2] = {
+        { (void *)out, 2 },
+        { (void *)(out + 2), 2 }
+    };
+
+    mock_reset();
+    memset(mock_rx, 0x33, 10);
+    mock_rx_len = 10;
+    mock_rx_chunk = 7;
+
+    devproto_transport_send(&t, out, sizeof(out));
+    devproto_transport_sendv(&t, iov, 2);              /* Fallback: one packed send */
+    devproto_transport_recv(&t, rx, sizeof(rx), 0);    /* 7 bytes */
+    devproto_transport_recv(&t, rx, sizeof(rx), 0);    /* 3 bytes */
+    devproto_transport_recv(&t, rx, sizeof(rx), 0);    /* Nothing: not recorded */
+
+    devproto_transport_set_capture(&t, NULL, 0);
+    devproto_transport_send(&t, out, sizeof(out));     /* Detached */
+    devproto_capture_destroy(cap);
+
+    devproto_capture_reader_t *r = devproto_capture_reader_open(path);
+    unlink(path);
+
+    size_t cursor = 0;
+    devproto_capture_entry_t e[5];
+    int n = 0;
+    while (r && n < 5 && devproto_capture_reader_next(r, &cursor, &e[n]) == 1) n++;
+
+    if (n != 4 ||
+        e[0].conn != 42 || e[0].dir != DEVPROTO_CAPTURE_OUT || e[0].len != 4 ||
+        e[1].dir != DEVPROTO_CAPTURE_OUT || e[1].len != 4 || memcmp(e[1].data, out, 4) != 0 ||
+        e[2].dir != DEVPROTO_CAPTURE_IN || e[2].len != 7 || e[2].data[6] != 0x33 ||
+        e[3].dir != DEVPROTO_CAPTURE_IN || e[3].len != 3) {
+        FAIL("tapped records");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    devproto_capture_reader_destroy(r);
+    PASS();
+}
+
+/**
+ * Record frames of one connection in torn chunks, with another
+ * connection's traffic interleaved
+ */
+static size_t record_frames(devproto_capture_t *cap, int count)
+{
+    static uint8_t stream[8192];
+    size_t len = 0;
+
+    for (int i = 0; i < count; i++) {
+        uint8_t payload[40];
+        memset(payload, i, sizeof(payload));
+        devproto_message_t msg = {
+            .msg_type = DEVPROTO_MSG_METRICS_RESPONSE,
+            .sequence = (uint8_t)i,
+            .payload_len = (uint16_t)(i % 2 ? sizeof(payload) : 0),
+            .payload = payload
+        };
+        int n = devproto_frame_build(&msg, stream + len, sizeof(stream) - len);
+        if (n > 0) len += (size_t)n;
+    }
+
+    const uint8_t other[] = { 0xAA, 0x55, 0xFF };
+    for (size_t off = 0, k = 0; off < len; k++) {
+        size_t chunk = 1 + (k * 5) % 13;
+        if (chunk > len - off) chunk = len - off;
+        devproto_capture_record(cap, 1, DEVPROTO_CAPTURE_IN, stream + off, chunk);
+        devproto_capture_record(cap, 2, DEVPROTO_CAPTURE_IN, other, sizeof(other));
+        devproto_capture_record(cap, 1, DEVPROTO_CAPTURE_OUT, other, sizeof(other));
+        off += chunk;
+    }
+    return len;
+}
+
+void test_capture_replay(void)
+{
+    TEST("replay transport feeds recorded frames");
+
+    char path[32];
+    temp_path(path);
+    devproto_capture_t *cap = devproto_capture_create(path);
+    size_t stream_len = record_frames(cap, 50);
+    devproto_capture_destroy(cap);
+
+    devproto_capture_reader_t *r = devproto_capture_reader_open(path);
+    unlink(path);
+
+    devproto_replay_config_t cfg = { .conn = 1, .dir = DEVPROTO_CAPTURE_IN, .speed = 0 };
+    devproto_transport_t *t = devproto_transport_replay_create(r, &cfg);
+    if (!t || devproto_transport_open(t) != 0) {
+        FAIL("create");
+        devproto_transport_destroy(t);
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    /* A 4-byte buffer splits records; every frame still comes out */
+    static devproto_frame_parser_t parser;
+    devproto_frame_parser_init(&parser);
+    devproto_message_t msgs[8];
+    uint8_t buf[4];
+    size_t bytes = 0;
+    int frames = 0, bad = 0, n;
+
+    while ((n = devproto_transport_recv(t, buf, sizeof(buf), 100)) > 0) {
+        bytes += (size_t)n;
+        int count = devproto_frame_parse(&parser, buf, (size_t)n, msgs, 8);
+        for (int i = 0; i < count; i++, frames++) {
+            if (msgs[i].sequence != (uint8_t)frames ||
+                msgs[i].payload_len != (frames % 2 ? 40 : 0)) {
+                bad++;
+            }
+        }
+    }
+
+    if (n != -1 || devproto_transport_is_open(t) || bytes != stream_len ||
+        frames != 50 || bad || devproto_transport_send(t, buf, 1) != -1) {
+        FAIL("replayed stream");
+        devproto_transport_destroy(t);
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    /* Reopening starts over; sends are dropped */
+    devproto_transport_open(t);
+    n = devproto_transport_recv(t, buf, sizeof(buf), 0);
+    if (n != 1 || buf[0] != DEVPROTO_HEADER_BYTE0 || devproto_transport_send(t, buf, 4) != 4) {
+        FAIL("reopen");
+        devproto_transport_destroy(t);
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+    devproto_transport_destroy(t);
+
+    /* The other direction of the same connection */
+    cfg.dir = DEVPROTO_CAPTURE_OUT;
+    t = devproto_transport_replay_create(r, &cfg);
+    devproto_transport_open(t);
+    bytes = 0;
+    while ((n = devproto_transport_recv(t, buf, sizeof(buf), 0)) > 0) bytes += (size_t)n;
+    if (bytes == 0 || bytes % 3 != 0) {
+        FAIL("outgoing direction");
+        devproto_transport_destroy(t);
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+    devproto_transport_destroy(t);
+
+    devproto_capture_reader_destroy(r);
+    PASS();
+}
+
+void test_capture_replay_pacing(void)
+{
+    TEST("replay at recorded pace and faster");
+
+    char path[32];
+    temp_path(path);
+    devproto_capture_t *cap = devproto_capture_create(path);
+    const uint8_t data[] = { 1 };
+    devproto_capture_record(cap, 0, DEVPROTO_CAPTURE_IN, data, 1);
+    sleep_ms(60);
+    devproto_capture_record(cap, 0, DEVPROTO_CAPTURE_IN, data, 1);
+    devproto_capture_destroy(cap);
+
+    devproto_capture_reader_t *r = devproto_capture_reader_open(path);
+    unlink(path);
+
+    devproto_replay_config_t cfg = { .conn = 0, .speed = 1.0 };
+    devproto_transport_t *t = devproto_transport_replay_create(r, &cfg);
+    devproto_transport_open(t);
+
+    uint8_t buf[4];
+    uint64_t t0 = devproto_stats_now_us();
+    int first = devproto_transport_recv(t, buf, sizeof(buf), 0);
+    int early = devproto_transport_recv(t, buf, sizeof(buf), 0);     /* Not due yet */
+    int avail = devproto_transport_available(t);
+    int second = devproto_transport_recv(t, buf, sizeof(buf), 1000);
+    uint64_t took = devproto_stats_now_us() - t0;
+
+    if (first != 1 || early != 0 || avail != 0 || second != 1 || took < 50000 || took > 500000) {
+        FAIL("recorded pace");
+        devproto_transport_destroy(t);
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+    devproto_transport_destroy(t);
+
+    /* Ten times faster */
+    cfg.speed = 10.0;
+    t = devproto_transport_replay_create(r, &cfg);
+    devproto_transport_open(t);
+    t0 = devproto_stats_now_us();
+    first = devproto_transport_recv(t, buf, sizeof(buf), 1000);
+    second = devproto_transport_recv(t, buf, sizeof(buf), 1000);
+    took = devproto_stats_now_us() - t0;
+    if (first != 1 || second != 1 || took < 5000 || took > 50000) {
+        FAIL("faster pace");
+        devproto_transport_destroy(t);
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+    devproto_transport_destroy(t);
+
+    cfg.speed = -1.0;
+    if (devproto_transport_replay_create(r, &cfg) || devproto_transport_replay_create(NULL, &cfg)) {
+        FAIL("bad config accepted");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    devproto_capture_reader_destroy(r);
+    PASS();
+}
+
+void test_capture_seek(void)
+{
+    TEST("seek by time through the index");
+
+    char path[32];
+    temp_path(path);
+    devproto_capture_t *cap = devproto_capture_create(path);
+
+    /* Several seek intervals, with a gap in the middle */
+    uint8_t data[8] = { 0 };
+    const int records = DEVPROTO_CAPTURE_SEEK_INTERVAL * 5 / 2;
+    for (int i = 0; i < records; i++) {
+        if (i == records / 2) sleep_ms(20);
+        devproto_capture_record(cap, 0, DEVPROTO_CAPTURE_IN, data, sizeof(data));
+    }
+    devproto_capture_destroy(cap);
+
+    devproto_capture_reader_t *r = devproto_capture_reader_open(path);
+    unlink(path);
+
+    devproto_capture_info_t info;
+    devproto_capture_reader_info(r, &info);
+
+    /* Check seek against a linear scan at a spread of times */
+    int bad = 0;
+    for (uint64_t target = 0; target <= info.duration_us + 1; target += info.duration_us / 16 + 1) {
+        size_t cursor = DEVPROTO_CAPTURE_HEADER_SIZE, expect, pos;
+        devproto_capture_entry_t e;
+        for (;;) {
+            pos = cursor;
+            if (devproto_capture_reader_next(r, &cursor, &e) != 1 || e.time_us >= target) break;
+        }
+        expect = pos;
+        if (devproto_capture_reader_seek(r, target) != expect) bad++;
+    }
+
+    /* Just past the gap lands on the record after it */
+    size_t cursor = devproto_capture_reader_seek(r, info.duration_us - 1000);
+    devproto_capture_entry_t e;
+    int n = 0;
+    while (devproto_capture_reader_next(r, &cursor, &e) == 1) n++;
+
+    if (!info.indexed || info.records != (uint64_t)records || bad ||
+        n == 0 || n > records / 2) {
+        FAIL("seek");
+        devproto_capture_reader_destroy(r);
+        return;
+    }
+
+    devproto_capture_reader_destroy(r);
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Capture Unit Tests ===\n");
+    printf("\n");
+
+    test_capture_roundtrip();
+    test_capture_recovery();
+    test_capture_tap();
+    test_capture_replay();
+    test_capture_replay_pacing();
+    test_capture_seek();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,451 @@
+/**
+ * @file test_compress.c
+ * @brief Payload compression unit tests
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "devproto/compress.h"
+#include "devproto/frame.h"
+#include "devproto/send.h"
+#include "devproto/transport.h"
+#include "mock_transport.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+/**
+ * Fill buf with log-like text
+ */
+static size_t make_log(uint8_t *buf, size_t cap)
+{
+    size_t len = 0;
+    for (int i = 0; len < cap; i++) {
+        char line[96];
+        int n = snprintf(line, sizeof(line),
+                         "[%05d] sensor=%d temp=%d.%d status=OK\n",
+                         i, i % 4, 20 + i % 7, i % 10);
+        for (int j = 0; j < n && len < cap; j++) buf[len++] = (uint8_t)line[j];
+    }
+    return len;
+}
+
+/**
+ * Cheap deterministic noise
+ */
+static void make_noise(uint8_t *buf, size_t len)
+{
+    uint32_t x = 0x12345678u;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (uint8_t)x;
+    }
+}
+
+void test_codec_roundtrip(void)
+{
+    TEST("codec round trips");
+
+    static uint8_t src[3000];
+    static uint8_t packed[4096];
+    static uint8_t out[3000];
+    static const devproto_codec_t codecs[] = {
+        DEVPROTO_CODEC_HEATSHRINK, DEVPROTO_CODEC_LZ4
+    };
+    static const size_t lens[] = { 0, 1, 2, 17, 300, 3000 };
+
+    for (size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) {
+        for (int kind = 0; kind < 2; kind++) {
+            if (kind == 0) make_log(src, sizeof(src));
+            else make_noise(src, sizeof(src));
+
+            for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+                size_t len = lens[l];
+                size_t bound = devproto_compress_bound(codecs[c], len);
+                int n = devproto_compress(codecs[c], src, len, packed, sizeof(packed));
+                if (n < 0 || (size_t)n > bound) {
+                    FAIL("compress failed or exceeded bound");
+                    return;
+                }
+
+                int m = devproto_decompress(codecs[c], packed, (size_t)n, out, sizeof(out));
+                if (m != (int)len || memcmp(out, src, len) != 0) {
+                    FAIL("round trip mismatch");
+                    return;
+                }
+            }
+        }
+    }
+
+    PASS();
+}
+
+void test_codec_ratio(void)
+{
+    TEST("log text shrinks");
+
+    static uint8_t src[2048];
+    static uint8_t packed[4096];
+    size_t len = make_log(src, sizeof(src));
+
+    int hs = devproto_compress(DEVPROTO_CODEC_HEATSHRINK, src, len, packed, sizeof(packed));
+    int lz = devproto_compress(DEVPROTO_CODEC_LZ4, src, len, packed, sizeof(packed));
+    if (hs <= 0 || lz <= 0 || (size_t)hs > len / 2 || (size_t)lz > len / 2) {
+        FAIL("log text compressed poorly");
+        return;
+    }
+
+    if (devproto_compress(DEVPROTO_CODEC_LZ4, src, len, packed, 8) != -1 ||
+        devproto_compress(DEVPROTO_CODEC_HEATSHRINK, src, len, packed, 8) != -1 ||
+        devproto_compress(DEVPROTO_CODEC_NONE, src, len, packed, sizeof(packed)) != -1) {
+        FAIL("small output or unknown codec accepted");
+        return;
+    }
+
+    PASS();
+}
+
+/*
+ * LZ4 blocks from the reference liblz4 1.9.4 (LZ4_compress_default). Our
+ * encoder produces the same bytes, which LZ4_decompress_safe was checked
+ * to accept when the vectors were captured.
+ */
+
+/* make_log(200 bytes) */
+static const uint8_t LZ4_LOG[] = {
+    0x20, 0x5b, 0x30, 0x01, 0x00, 0xf1, 0x10, 0x5d, 0x20, 0x73, 0x65, 0x6e,
+    0x73, 0x6f, 0x72, 0x3d, 0x30, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x3d, 0x32,
+    0x30, 0x2e, 0x30, 0x20, 0x73, 0x74, 0x61, 0x74, 0x75, 0x73, 0x3d, 0x4f,
+    0x4b, 0x0a, 0x25, 0x00, 0x15, 0x31, 0x25, 0x00, 0x13, 0x31, 0x25, 0x00,
+    0x3c, 0x31, 0x2e, 0x31, 0x25, 0x00, 0x15, 0x32, 0x25, 0x00, 0x13, 0x32,
+    0x25, 0x00, 0x3c, 0x32, 0x2e, 0x32, 0x25, 0x00, 0x15, 0x33, 0x25, 0x00,
+    0x13, 0x33, 0x25, 0x00, 0x3c, 0x33, 0x2e, 0x33, 0x25, 0x00, 0x15, 0x34,
+    0x25, 0x00, 0x04, 0x94, 0x00, 0x3c, 0x34, 0x2e, 0x34, 0x25, 0x00, 0xa0,
+    0x35, 0x5d, 0x20, 0x73, 0x65, 0x6e, 0x73, 0x6f, 0x72, 0x3d
+};
+
+/* "0123456789abcdefghij", 300 x 'A', "tail!": extended literal and match lengths */
+static const uint8_t LZ4_RUN[] = {
+    0xff, 0x06, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x41, 0x01,
+    0x00, 0xff, 0x19, 0x50, 0x74, 0x61, 0x69, 0x6c, 0x21
+};
+
+/* "hello, device": literals only */
+static const uint8_t LZ4_SHORT[] = {
+    0xd0, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2c, 0x20, 0x64, 0x65, 0x76, 0x69,
+    0x63, 0x65
+};
+
+/*
+ * heatshrink -w8 -l4 bitstream for "abcabcabcabc", derived by hand from
+ * the format (MSB first; 1 + byte is a literal, 0 + (distance - 1):8 +
+ * (count - 1):4 a backref; zero padding): a, b, c, then 9 bytes from 3 back.
+ * No reference encoder was available to produce it.
+ */
+static const uint8_t HS_ABC[] = { 0xb0, 0xd8, 0xac, 0x60, 0x28 };
+
+/**
+ * Check a codec decodes a golden vector to src and encodes src back to it
+ */
+static int golden_ok(devproto_codec_t codec, const uint8_t *vec, size_t vec_len,
+                     const uint8_t *src, size_t len)
+{
+    uint8_t out[512];
+    int m = devproto_decompress(codec, vec, vec_len, out, sizeof(out));
+    if (m != (int)len || memcmp(out, src, len) != 0) return 0;
+
+    int n = devproto_compress(codec, src, len, out, sizeof(out));
+    return n == (int)vec_len && memcmp(out, vec, vec_len) == 0;
+}
+
+void test_golden_lz4(void)
+{
+    TEST("LZ4 blocks match the reference");
+
+    static uint8_t log[200];
+    static uint8_t run[325];
+    make_log(log, sizeof(log));
+    memcpy(run, "0123456789abcdefghij", 20);
+    memset(run + 20, 'A', 300);
+    memcpy(run + 320, "tail!", 5);
+
+    if (!golden_ok(DEVPROTO_CODEC_LZ4, LZ4_LOG, sizeof(LZ4_LOG), log, sizeof(log)) ||
+        !golden_ok(DEVPROTO_CODEC_LZ4, LZ4_RUN, sizeof(LZ4_RUN), run, sizeof(run)) ||
+        !golden_ok(DEVPROTO_CODEC_LZ4, LZ4_SHORT, sizeof(LZ4_SHORT),
+                   (const uint8_t *)"hello, device", 13)) {
+        FAIL("block differs from liblz4");
+        return;
+    }
+    PASS();
+}
+
+void test_golden_heatshrink(void)
+{
+    TEST("heatshrink bit layout");
+
+    if (!golden_ok(DEVPROTO_CODEC_HEATSHRINK, HS_ABC, sizeof(HS_ABC),
+                   (const uint8_t *)"abcabcabcabc", 12)) {
+        FAIL("bitstream differs");
+        return;
+    }
+    PASS();
+}
+
+void test_payload_helpers(void)
+{
+    TEST("payload header and fallback");
+
+    static uint8_t src[1024];
+    static uint8_t packed[2048];
+    static uint8_t out[1024];
+
+    make_noise(src, sizeof(src));
+    if (devproto_payload_compress(DEVPROTO_CODEC_LZ4, src, sizeof(src),
+                                  packed, sizeof(packed)) != -1) {
+        FAIL("incompressible payload not refused");
+        return;
+    }
+
+    size_t len = make_log(src, sizeof(src));
+    int n = devproto_payload_compress(DEVPROTO_CODEC_HEATSHRINK, src, len,
+                                      packed, sizeof(packed));
+    if (n <= DEVPROTO_COMPRESS_HEADER_SIZE || (size_t)n >= len ||
+        packed[0] != DEVPROTO_CODEC_HEATSHRINK ||
+        devproto_payload_original_size(packed, (size_t)n) != (int)len ||
+        devproto_payload_original_size(packed, 2) != -1) {
+        FAIL("bad payload header");
+        return;
+    }
+
+    if (devproto_payload_decompress(packed, (size_t)n, out, sizeof(out)) != (int)len ||
+        memcmp(out, src, len) != 0) {
+        FAIL("payload round trip");
+        return;
+    }
+
+    if (devproto_payload_decompress(packed, (size_t)n, out, len - 1) != -1) {
+        FAIL("short output accepted");
+        return;
+    }
+
+    PASS();
+}
+
+void test_payload_corrupt(void)
+{
+    TEST("corrupt payloads are rejected");
+
+    static uint8_t src[1024];
+    static uint8_t packed[2048];
+    static uint8_t out[1024];
+    size_t len = make_log(src, sizeof(src));
+
+    int n = devproto_payload_compress(DEVPROTO_CODEC_LZ4, src, len, packed, sizeof(packed));
+    if (n < 0) {
+        FAIL("compress failed");
+        return;
+    }
+
+    /* Truncated stream */
+    if (devproto_payload_decompress(packed, (size_t)n - 4, out, sizeof(out)) != -1) {
+        FAIL("truncated payload accepted");
+        return;
+    }
+
+    /* Unknown codec */
+    packed[0] = 0x7F;
+    if (devproto_payload_decompress(packed, (size_t)n, out, sizeof(out)) != -1) {
+        FAIL("unknown codec accepted");
+        return;
+    }
+
+    /* Random garbage must never overrun or falsely succeed at full size */
+    packed[0] = DEVPROTO_CODEC_LZ4;
+    for (int round = 0; round < 64; round++) {
+        make_noise(packed + DEVPROTO_COMPRESS_HEADER_SIZE, 200);
+        packed[DEVPROTO_COMPRESS_HEADER_SIZE] ^= (uint8_t)round;
+        for (int codec = DEVPROTO_CODEC_HEATSHRINK; codec <= DEVPROTO_CODEC_LZ4; codec++) {
+            packed[0] = (uint8_t)codec;
+            int m = devproto_payload_decompress(packed, DEVPROTO_COMPRESS_HEADER_SIZE + 200,
+                                                out, sizeof(out));
+            if (m > (int)sizeof(out)) {
+                FAIL("decoder overran its output");
+                return;
+            }
+        }
+    }
+
+    PASS();
+}
+
+void test_compressed_frames(void)
+{
+    TEST("compressed frames over the send helpers");
+
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops);
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+    devproto_compress_config_t cfg;
+    devproto_compress_config_init(&cfg, pool);
+
+    if (devproto_transport_set_compression(&t, &cfg) != 0) {
+        FAIL("set compression");
+        return;
+    }
+
+    static uint8_t payload[2000];
+    size_t len = make_log(payload, sizeof(payload));
+    devproto_message_t msg = {
+        .msg_type = DEVPROTO_MSG_COMMAND_RESULT, .sequence = 9,
+        .payload_len = (uint16_t)len, .payload = payload
+    };
+
+    mock_reset();
+    if (devproto_send_message(&t, &msg) != 0 ||
+        mock_wire_len >= DEVPROTO_HEADER_SIZE + len / 2 ||
+        (mock_wire[2] & DEVPROTO_COMPRESS_FLAG) == 0) {
+        FAIL("payload not compressed on the wire");
+        return;
+    }
+
+    /* A parser that has not negotiated compression drops the frame */
+    devproto_frame_parser_t legacy;
+    devproto_frame_parser_init(&legacy);
+    devproto_message_t out;
+    if (devproto_frame_parse(&legacy, mock_wire, mock_wire_len, &out, 1) != 0) {
+        FAIL("legacy parser accepted a compressed frame");
+        return;
+    }
+
+    devproto_frame_pooled_parser_t *parser = devproto_frame_pooled_create(pool);
+    if (devproto_frame_pooled_set_decompress(parser, 1) != 0) {
+        FAIL("enable decompress");
+        return;
+    }
+
+    int count = devproto_frame_pooled_parse(parser, mock_wire, mock_wire_len, &out, 1);
+    if (count != 1 || out.msg_type != DEVPROTO_MSG_COMMAND_RESULT || out.sequence != 9 ||
+        out.payload_len != len || memcmp(out.payload, payload, len) != 0) {
+        FAIL("compressed frame not expanded");
+        return;
+    }
+
+    /* Corrupt the compressed data but keep the CRC valid */
+    static uint8_t bad[128];
+    bad[0] = DEVPROTO_CODEC_LZ4;
+    bad[1] = 0x01;
+    bad[2] = 0x00;
+    memset(bad + DEVPROTO_COMPRESS_HEADER_SIZE, 0xFF, sizeof(bad) - DEVPROTO_COMPRESS_HEADER_SIZE);
+    devproto_message_t corrupt = {
+        .msg_type = DEVPROTO_MSG_COMMAND_RESULT, .sequence = 10,
+        .payload_len = sizeof(bad), .payload = bad
+    };
+    devproto_frame_iov_t frame;
+    int flen = devproto_frame_build_iov_compressed(&corrupt, &frame, DEVPROTO_MAX_PAYLOAD_SIZE);
+    uint8_t wire[DEVPROTO_MAX_FRAME_SIZE];
+    size_t wire_len = 0;
+    for (int i = 0; i < frame.iovcnt; i++) {
+        memcpy(wire + wire_len, frame.iov[i].iov_base, frame.iov[i].iov_len);
+        wire_len += frame.iov[i].iov_len;
+    }
+
+    if (flen != (int)wire_len ||
+        devproto_frame_pooled_parse(parser, wire, wire_len, &out, 1) != 0) {
+        FAIL("corrupt compressed frame delivered");
+        return;
+    }
+    devproto_frame_stats_t stats;
+    devproto_frame_pooled_get_stats(parser, &stats);
+    if (stats.decompress_errors != 1) {
+        FAIL("corrupt compressed frame delivered");
+        return;
+    }
+
+    devproto_transport_set_compression(&t, NULL);
+    devproto_frame_pooled_destroy(parser);
+    devproto_frame_pool_destroy(pool);
+    PASS();
+}
+
+void test_compress_threshold(void)
+{
+    TEST("threshold and CODEC_NONE send uncompressed");
+
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops);
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+    devproto_compress_config_t cfg;
+    devproto_compress_config_init(&cfg, pool);
+
+    static uint8_t payload[1024];
+    size_t len = make_log(payload, sizeof(payload));
+    devproto_message_t msg = {
+        .msg_type = DEVPROTO_MSG_COMMAND_RESULT, .sequence = 1,
+        .payload_len = (uint16_t)len, .payload = payload
+    };
+
+    cfg.threshold = len + 1;
+    devproto_transport_set_compression(&t, &cfg);
+    mock_reset();
+    if (devproto_send_message(&t, &msg) != 0 ||
+        mock_wire_len != DEVPROTO_HEADER_SIZE + len + DEVPROTO_CRC_SIZE) {
+        FAIL("payload under threshold compressed");
+        return;
+    }
+
+    cfg.threshold = 0;
+    cfg.codec = DEVPROTO_CODEC_NONE;
+    devproto_transport_set_compression(&t, &cfg);
+    mock_reset();
+    if (devproto_send_message(&t, &msg) != 0 ||
+        mock_wire_len != DEVPROTO_HEADER_SIZE + len + DEVPROTO_CRC_SIZE) {
+        FAIL("CODEC_NONE compressed");
+        return;
+    }
+
+    /* An uncompressed frame still parses with decompress enabled */
+    devproto_frame_pooled_parser_t *parser = devproto_frame_pooled_create(pool);
+    devproto_frame_pooled_set_decompress(parser, 1);
+    devproto_message_t out;
+    if (devproto_frame_pooled_parse(parser, mock_wire, mock_wire_len, &out, 1) != 1 ||
+        out.payload_len != len || memcmp(out.payload, payload, len) != 0) {
+        FAIL("plain frame on a compressing link");
+        return;
+    }
+
+    cfg.pool = NULL;
+    if (devproto_transport_set_compression(&t, &cfg) != -1 ||
+        devproto_transport_set_compression(&t, NULL) != 0 || t.compress) {
+        FAIL("config validation");
+        return;
+    }
+
+    devproto_frame_pooled_destroy(parser);
+    devproto_frame_pool_destroy(pool);
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Compression Unit Tests ===\n");
+    printf("\n");
+
+    test_codec_roundtrip();
+    test_codec_ratio();
+    test_golden_lz4();
+    test_golden_heatshrink();
+    test_payload_helpers();
+    test_payload_corrupt();
+    test_compressed_frames();
+    test_compress_threshold();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 #include "devproto/crc16.h"
 #include "devproto/protocol.h"
 
@@ -119,6 +120,164 @@ void test_crc_fast_matches_slow(void)
     PASS();
 }
 
+/**
+ * Test compiled-in kernel against bitwise reference for all lengths/splits
+ */
+void test_crc_kernel_lengths(void)
+{
+    TEST("kernel matches reference across lengths");
+
+    uint8_t data[300];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        uint16_t expected = devproto_crc16(data, len);
+
+        if (devproto_crc16_fast(data, len) != expected) {
+            FAIL("fast CRC differs from reference");
+            return;
+        }
+
+        /* Split at an arbitrary point to exercise streaming tails */
+        size_t split = len / 3;
+        uint16_t crc = devproto_crc16_update(DEVPROTO_CRC_INITIAL, data, split);
+        crc = devproto_crc16_update(crc, data + split, len - split);
+        ASSERT_EQ(expected, crc);
+    }
+
+    PASS();
+}
+
+static const devproto_crc16_kernel_t all_kernels[] = {
+    DEVPROTO_CRC16_KERNEL_BITWISE,
+    DEVPROTO_CRC16_KERNEL_TABLE,
+    DEVPROTO_CRC16_KERNEL_SLICE8,
+    DEVPROTO_CRC16_KERNEL_CLMUL
+};
+
+#define NUM_KERNELS (sizeof(all_kernels) / sizeof(all_kernels[0]))
+
+/**
+ * Test every available kernel is bit-identical to the reference
+ */
+void test_crc_kernels_identical(void)
+{
+    TEST("all kernels bit-identical");
+
+    static uint8_t data[1100];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)((i * 131) ^ (i >> 3));
+    }
+
+    for (size_t k = 0; k < NUM_KERNELS; k++) {
+        if (!devproto_crc16_kernel_available(all_kernels[k])) continue;
+
+        /* Cover SIMD block boundaries, unaligned starts and seed values */
+        for (size_t len = 0; len <= 1024; len += (len < 160 ? 1 : 37)) {
+            for (size_t off = 0; off < 8; off += 3) {
+                uint16_t seed = (uint16_t)(0xFFFF - len * 17);
+                uint16_t expected = devproto_crc16_kernel_update(
+                    DEVPROTO_CRC16_KERNEL_BITWISE, seed, data + off, len);
+                uint16_t actual = devproto_crc16_kernel_update(
+                    all_kernels[k], seed, data + off, len);
+
+                if (expected != actual) {
+                    char msg[100];
+                    snprintf(msg, sizeof(msg), "%s differs at len %zu off %zu",
+                             devproto_crc16_kernel_name(all_kernels[k]), len, off);
+                    FAIL(msg);
+                    return;
+                }
+            }
+        }
+    }
+
+    /* Runtime-dispatched entry point must agree too */
+    ASSERT_EQ(devproto_crc16(data, sizeof(data)), devproto_crc16_fast(data, sizeof(data)));
+    PASS();
+}
+
+/**
+ * Test explicit kernel selection drives the dispatched entry points
+ */
+void test_crc_set_kernel(void)
+{
+    TEST("explicit kernel selection");
+
+    static const uint8_t data[] = "123456789";
+    devproto_crc16_kernel_t automatic = devproto_crc16_active_kernel();
+
+    for (size_t k = 0; k < NUM_KERNELS; k++) {
+        int ret = devproto_crc16_set_kernel(all_kernels[k]);
+        if (ret != 0) continue;
+
+        if (devproto_crc16_active_kernel() != all_kernels[k] ||
+            devproto_crc16_fast(data, 9) != 0x29B1) {
+            devproto_crc16_set_kernel(automatic);
+            FAIL("selected kernel not used");
+            return;
+        }
+    }
+
+    ASSERT_EQ(devproto_crc16_set_kernel(automatic), 0);
+    ASSERT_EQ(devproto_crc16_active_kernel(), automatic);
+    PASS();
+}
+
+/**
+ * Throughput comparison across kernels (informational)
+ */
+void test_crc_kernel_throughput(void)
+{
+    TEST("kernel throughput");
+    printf("(active: %s)\n",
+           devproto_crc16_kernel_name(devproto_crc16_active_kernel()));
+
+    static uint8_t data[64 * 1024];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 2654435761u >> 24);
+    }
+
+    uint16_t reference = devproto_crc16(data, sizeof(data));
+
+    for (size_t k = 0; k < NUM_KERNELS; k++) {
+        if (!devproto_crc16_kernel_available(all_kernels[k])) {
+            printf("    %-10s  n/a\n", devproto_crc16_kernel_name(all_kernels[k]));
+            continue;
+        }
+
+        int iterations = all_kernels[k] == DEVPROTO_CRC16_KERNEL_BITWISE ? 16 : 256;
+        uint16_t crc = 0;
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < iterations; i++) {
+            crc = devproto_crc16_kernel_update(all_kernels[k], DEVPROTO_CRC_INITIAL,
+                                               data, sizeof(data));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double secs = (double)(end.tv_sec - start.tv_sec) +
+                      (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        double bytes = (double)sizeof(data) * iterations;
+
+        printf("    %-10s  %8.1f MB/s  %6.3f ns/byte\n",
+               devproto_crc16_kernel_name(all_kernels[k]),
+               secs > 0 ? bytes / secs / 1e6 : 0.0,
+               bytes > 0 ? secs * 1e9 / bytes : 0.0);
+
+        if (crc != reference) {
+            FAIL("kernel result differs from reference");
+            return;
+        }
+    }
+
+    printf("   ");
+    PASS();
+}
+
 /**
  * Test CRC detects single bit errors
  */
@@ -197,8 +356,12 @@ int main(void)
     test_crc_known_vectors();
     test_crc_streaming();
     test_crc_fast_matches_slow();
+    test_crc_kernel_lengths();
+    test_crc_kernels_identical();
+    test_crc_set_kernel();
     test_crc_error_detection();
     test_frame_crc();
+    test_crc_kernel_throughput();
 
     printf("\n");
     printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
@@ -0,0 +1,357 @@
+/**
+ * @file test_engine.c
+ * @brief Sharded engine tests over loopback TCP
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "devproto/engine.h"
+#include "devproto/frame.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NUM_CONNS 16
+
+/**
+ * Per-connection test state (callback user pointer)
+ */
+typedef struct {
+    atomic_int messages;
+    atomic_int bad;                     /* Out of order or corrupt */
+    atomic_int closed;
+    int next_seq;                       /* Only touched by the owning shard */
+    pthread_t thread;
+    atomic_int threads;                 /* Distinct threads seen (1 unless moved) */
+} conn_state_t;
+
+static int listen_loopback(int *port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, NUM_CONNS) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void on_message(devproto_engine_t *e, devproto_transport_t *t,
+                       const devproto_message_t *msg, void *user)
+{
+    (void)e;
+    (void)t;
+    conn_state_t *st = user;
+
+    if (msg->sequence != (uint8_t)st->next_seq) atomic_fetch_add(&st->bad, 1);
+    for (size_t i = 0; i < msg->payload_len; i++) {
+        if (msg->payload[i] != msg->sequence) {
+            atomic_fetch_add(&st->bad, 1);
+            break;
+        }
+    }
+    st->next_seq = msg->sequence + 1;
+
+    if (atomic_load(&st->threads) == 0 || !pthread_equal(st->thread, pthread_self())) {
+        st->thread = pthread_self();
+        atomic_fetch_add(&st->threads, 1);
+    }
+    atomic_fetch_add(&st->messages, 1);
+}
+
+static void on_close(devproto_engine_t *e, devproto_transport_t *t, void *user)
+{
+    (void)e;
+    (void)t;
+    atomic_fetch_add(&((conn_state_t *)user)->closed, 1);
+}
+
+/**
+ * Write a frame whose payload is copies of seq, torn in two writes
+ */
+static int peer_send(int fd, uint8_t seq)
+{
+    uint8_t payload[64];
+    uint8_t frame[DEVPROTO_MIN_FRAME_SIZE + sizeof(payload)];
+
+    memset(payload, seq, sizeof(payload));
+    devproto_message_t msg = {
+        .msg_type = DEVPROTO_MSG_METRICS_RESPONSE,
+        .sequence = seq,
+        .payload_len = sizeof(payload),
+        .payload = payload
+    };
+    int n = devproto_frame_build(&msg, frame, sizeof(frame));
+
+    if (write(fd, frame, 5) != 5) return -1;
+    return write(fd, frame + 5, n - 5) == n - 5 ? 0 : -1;
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Connect n TCP transports to a loopback listener; peers[i] is the far end
+ */
+static int connect_all(devproto_transport_t **ts, int *peers, int n)
+{
+    int port;
+    int lfd = listen_loopback(&port);
+    if (lfd < 0) return -1;
+
+    for (int i = 0; i < n; i++) {
+        ts[i] = devproto_transport_tcp_create("127.0.0.1", port);
+        if (!ts[i] || devproto_transport_open(ts[i]) != 0) {
+            close(lfd);
+            return -1;
+        }
+        peers[i] = accept(lfd, NULL, NULL);
+        if (peers[i] < 0) {
+            close(lfd);
+            return -1;
+        }
+    }
+
+    close(lfd);
+    return 0;
+}
+
+static void release_all(devproto_transport_t **ts, int *peers, int n)
+{
+    for (int i = 0; i < n; i++) {
+        devproto_transport_destroy(ts[i]);
+        close(peers[i]);
+    }
+}
+
+/**
+ * Wait until every connection has seen `want` messages
+ */
+static int wait_messages(conn_state_t *st, int n, int want, int timeout_ms)
+{
+    for (int waited = 0; waited < timeout_ms; waited += 5) {
+        int done = 1;
+        for (int i = 0; i < n; i++) {
+            if (atomic_load(&st[i].messages) < want) done = 0;
+        }
+        if (done) return 1;
+        sleep_ms(5);
+    }
+    return 0;
+}
+
+void test_engine_spread(void)
+{
+    TEST("engine spreads connections over shards");
+
+    devproto_engine_config_t cfg;
+    devproto_engine_config_init(&cfg);
+    cfg.shards = 4;
+    cfg.rebalance_ms = 0;
+
+    devproto_transport_t *ts[NUM_CONNS];
+    int peers[NUM_CONNS];
+    static conn_state_t st[NUM_CONNS];
+    memset(st, 0, sizeof(st));
+
+    devproto_engine_t *e = devproto_engine_create(&cfg);
+    if (!e || connect_all(ts, peers, NUM_CONNS) != 0) {
+        FAIL("setup failed");
+        devproto_engine_destroy(e);
+        return;
+    }
+
+    int ok = 1;
+    for (int i = 0; i < NUM_CONNS; i++) {
+        if (devproto_engine_add(e, ts[i], on_message, on_close, &st[i]) != 0) ok = 0;
+    }
+    if (devproto_engine_add(e, ts[0], on_message, on_close, &st[0]) == 0) ok = 0;
+
+    for (int seq = 0; seq < 50; seq++) {
+        for (int i = 0; i < NUM_CONNS; i++) {
+            if (peer_send(peers[i], (uint8_t)seq) != 0) ok = 0;
+        }
+    }
+    if (!wait_messages(st, NUM_CONNS, 50, 3000)) ok = 0;
+
+    devproto_engine_stats_t stats;
+    devproto_engine_get_stats(e, &stats);
+    if (stats.shards != 4 || stats.connections != NUM_CONNS) ok = 0;
+
+    /* Delivered on more than one thread, each connection on one */
+    int distinct = 0;
+    for (int i = 0; i < NUM_CONNS; i++) {
+        if (atomic_load(&st[i].bad) || atomic_load(&st[i].threads) != 1) ok = 0;
+        int seen = 0;
+        for (int j = 0; j < i; j++) {
+            if (pthread_equal(st[i].thread, st[j].thread)) seen = 1;
+        }
+        if (!seen) distinct++;
+    }
+    if (distinct != 4) ok = 0;
+
+    /* Removed connections get no more messages and no close callback */
+    for (int i = 0; i < NUM_CONNS; i++) {
+        if (devproto_engine_remove(e, ts[i]) != 0) ok = 0;
+    }
+    if (devproto_engine_remove(e, ts[0]) == 0) ok = 0;
+    devproto_engine_get_stats(e, &stats);
+    if (stats.connections != 0) ok = 0;
+
+    devproto_engine_destroy(e);
+    for (int i = 0; i < NUM_CONNS; i++) {
+        if (atomic_load(&st[i].closed)) ok = 0;
+    }
+    release_all(ts, peers, NUM_CONNS);
+
+    if (!ok) {
+        printf("(threads %d, connections %u) ", distinct, stats.connections);
+        FAIL("wrong delivery or bookkeeping");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Streams frames to two peers of one shard at different rates
+ */
+typedef struct {
+    int fast;
+    int slow;
+    atomic_int stop;
+    int sent_fast;
+    int sent_slow;
+} hot_writer_t;
+
+static void *hot_writer(void *arg)
+{
+    hot_writer_t *w = arg;
+
+    while (!atomic_load(&w->stop)) {
+        for (int k = 0; k < 2; k++) {
+            if (peer_send(w->fast, (uint8_t)w->sent_fast) == 0) w->sent_fast++;
+        }
+        if (peer_send(w->slow, (uint8_t)w->sent_slow) == 0) w->sent_slow++;
+        usleep(200);
+    }
+    return NULL;
+}
+
+void test_engine_rebalance(void)
+{
+    TEST("idle shard steals a connection, stream intact");
+
+    devproto_engine_config_t cfg;
+    devproto_engine_config_init(&cfg);
+    cfg.shards = 2;
+    cfg.rebalance_ms = 50;
+    cfg.min_load = 10;
+
+    devproto_transport_t *ts[4];
+    int peers[4];
+    static conn_state_t st[4];
+    memset(st, 0, sizeof(st));
+
+    devproto_engine_t *e = devproto_engine_create(&cfg);
+    if (!e || connect_all(ts, peers, 4) != 0) {
+        FAIL("setup failed");
+        devproto_engine_destroy(e);
+        return;
+    }
+
+    /* Placement alternates: 0 and 2 on shard 0, 1 and 3 on shard 1 */
+    for (int i = 0; i < 4; i++) {
+        devproto_engine_add(e, ts[i], on_message, on_close, &st[i]);
+    }
+
+    hot_writer_t w = { .fast = peers[0], .slow = peers[2] };
+    atomic_init(&w.stop, 0);
+    pthread_t tid;
+    pthread_create(&tid, NULL, hot_writer, &w);
+
+    devproto_engine_stats_t stats;
+    int moved = 0;
+    for (int waited = 0; waited < 3000 && !moved; waited += 20) {
+        sleep_ms(20);
+        devproto_engine_get_stats(e, &stats);
+        moved = stats.migrations > 0;
+    }
+
+    /* Keep streaming across the move */
+    sleep_ms(200);
+    devproto_engine_get_stats(e, &stats);
+    int rate = stats.messages_per_s > 0;
+    atomic_store(&w.stop, 1);
+    pthread_join(tid, NULL);
+
+    int delivered = 0;
+    for (int tries = 0; tries < 300 && !delivered; tries++) {
+        delivered = atomic_load(&st[0].messages) == w.sent_fast &&
+                    atomic_load(&st[2].messages) == w.sent_slow;
+        if (!delivered) sleep_ms(10);
+    }
+
+    devproto_engine_get_stats(e, &stats);
+    int ok = moved && delivered && !atomic_load(&st[0].bad) && !atomic_load(&st[2].bad) &&
+             rate && stats.connections == 4;
+
+    /* The slower stream is the one that fits the gap */
+    ok = ok && atomic_load(&st[2].threads) == 2 && atomic_load(&st[0].threads) == 1;
+
+    devproto_engine_shard_stats_t s0, s1;
+    devproto_engine_get_shard_stats(e, 0, &s0);
+    devproto_engine_get_shard_stats(e, 1, &s1);
+    ok = ok && s0.given >= 1 && s1.stolen >= 1;
+
+    devproto_engine_destroy(e);
+    release_all(ts, peers, 4);
+
+    if (!ok) {
+        printf("(moved %d, delivered %d, threads %d/%d) ", moved, delivered,
+               atomic_load(&st[0].threads), atomic_load(&st[2].threads));
+        FAIL("no steal or stream damaged");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Engine Unit Tests ===\n");
+    printf("\n");
+
+    test_engine_spread();
+    test_engine_rebalance();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,391 @@
+/**
+ * @file test_firmware.c
+ * @brief Firmware transfer tests (sender and receiver over a lossy mock link)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "devproto/firmware.h"
+#include "devproto/crc16.h"
+#include "devproto/frame.h"
+#include "devproto/error.h"
+#include "mock_transport.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define IMAGE_SIZE      (45 * 1024 + 123)
+#define CHUNK           1024
+#define CHUNKS          ((IMAGE_SIZE + CHUNK - 1) / CHUNK)
+
+static uint8_t image[IMAGE_SIZE];
+
+/**
+ * RAM "flash" behind the receiver
+ */
+static struct {
+    uint8_t  mem[IMAGE_SIZE];
+    int      begins;
+    int      finished;
+    int      writes[CHUNKS];
+} flash;
+
+static int flash_begin(void *user, uint32_t size)
+{
+    (void)user;
+    if (size != IMAGE_SIZE) return -1;
+    memset(flash.mem, 0xFF, sizeof(flash.mem));
+    memset(flash.writes, 0, sizeof(flash.writes));
+    flash.begins++;
+    flash.finished = 0;
+    return 0;
+}
+
+static int flash_write(void *user, uint32_t offset, const uint8_t *data, size_t len)
+{
+    (void)user;
+    if (offset + len > IMAGE_SIZE) return -1;
+    memcpy(flash.mem + offset, data, len);
+    flash.writes[offset / CHUNK]++;
+    return 0;
+}
+
+static int flash_finish(void *user, uint32_t size)
+{
+    (void)user;
+    flash.finished = size == IMAGE_SIZE;
+    return 0;
+}
+
+/**
+ * Mock link: frames sent by the host go straight through the receiver and
+ * its acks are queued on the shared mock for recv; the fault plan drops or
+ * damages some
+ */
+static struct {
+    devproto_fw_receiver_t *rx;
+    devproto_frame_parser_t parser;
+    int      frames;                    /* Frames sent by the host */
+    int      drop_every;                /* Lose every n-th DATA frame */
+    int      corrupt_every;             /* Damage every n-th DATA chunk */
+    int      drop_ack_every;            /* Lose every n-th ack */
+    int      cut_after;                 /* Deliver nothing after this many frames */
+    int      acks;
+    int      data;
+} mock_link;
+
+static int link_send(devproto_transport_t *t, const uint8_t *data, size_t len)
+{
+    (void)t;
+    mock_link.frames++;
+    if (mock_link.cut_after && mock_link.frames > mock_link.cut_after) return (int)len;
+
+    devproto_message_t msg;
+    if (devproto_frame_parse(&mock_link.parser, data, len, &msg, 1) != 1) return (int)len;
+
+    if (msg.payload[0] == DEVPROTO_FW_OP_DATA) {
+        mock_link.data++;
+        if (mock_link.drop_every && mock_link.data % mock_link.drop_every == 0) return (int)len;
+        if (mock_link.corrupt_every && mock_link.data % mock_link.corrupt_every == 0) {
+            msg.payload[DEVPROTO_FW_DATA_HEADER] ^= 0x40;
+        }
+    }
+
+    devproto_message_t ack;
+    uint8_t ack_buf[DEVPROTO_FW_ACK_SIZE];
+    if (devproto_fw_receiver_handle(mock_link.rx, &msg, &ack, ack_buf) < 0) return (int)len;
+
+    mock_link.acks++;
+    if (mock_link.drop_ack_every && mock_link.acks % mock_link.drop_ack_every == 0) return (int)len;
+
+    mock_queue_message(&ack);
+    return (int)len;
+}
+
+static const devproto_transport_ops_t link_ops = {
+    .send = link_send,
+    .recv = mock_recv
+};
+
+static devproto_transport_t link_transport = MOCK_TRANSPORT(&link_ops);
+
+/**
+ * Fresh link and receiver with no faults
+ */
+static void link_reset(void)
+{
+    static const devproto_fw_sink_t sink = {
+        .begin = flash_begin,
+        .write = flash_write,
+        .finish = flash_finish
+    };
+
+    if (mock_link.rx) devproto_fw_receiver_destroy(mock_link.rx);
+    memset(&mock_link, 0, sizeof(mock_link));
+    memset(&flash, 0, sizeof(flash));
+    mock_reset();
+    devproto_frame_parser_init(&mock_link.parser);
+    mock_link.rx = devproto_fw_receiver_create(&sink);
+}
+
+static void fill_image(void)
+{
+    uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(image); i++) {
+        x = x * 1103515245u + 12345u;
+        image[i] = (uint8_t)(x >> 16);
+    }
+}
+
+static int flash_matches(void)
+{
+    return memcmp(flash.mem, image, sizeof(image)) == 0 && flash.finished;
+}
+
+static void config(devproto_fw_config_t *cfg)
+{
+    devproto_fw_config_init(cfg);
+    cfg->chunk_size = CHUNK;
+    cfg->window = 8;
+    cfg->timeout_ms = 20;
+}
+
+void test_fw_clean_transfer(void)
+{
+    TEST("windowed transfer from a mapped file");
+
+    char path[] = "/tmp/devproto_fw_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, image, sizeof(image)) != (ssize_t)sizeof(image)) {
+        FAIL("temp file");
+        if (fd >= 0) close(fd);
+        return;
+    }
+    close(fd);
+
+    link_reset();
+    devproto_fw_config_t cfg;
+    config(&cfg);
+    devproto_fw_sender_t *fw = devproto_fw_sender_open(path, &cfg);
+    unlink(path);
+    devproto_session_t *s = devproto_session_create(&link_transport, 8);
+
+    int rc = fw ? devproto_fw_sender_run(fw, s) : -1;
+
+    devproto_fw_stats_t st;
+    devproto_fw_sender_get_stats(fw, &st);
+    uint32_t verified = 0;
+    int done = devproto_fw_receiver_progress(mock_link.rx, &verified, NULL);
+
+    devproto_session_destroy(s);
+    devproto_fw_sender_destroy(fw);
+
+    if (rc != DEVPROTO_OK || !flash_matches() || !done || verified != IMAGE_SIZE ||
+        st.chunks_sent != CHUNKS || st.retransmits != 0 || st.acked_bytes != IMAGE_SIZE) {
+        printf("(rc %d, sent %u) ", rc, st.chunks_sent);
+        FAIL("image not transferred intact");
+        return;
+    }
+
+    PASS();
+}
+
+void test_fw_lossy_link(void)
+{
+    TEST("selective retransmission over a lossy link");
+
+    link_reset();
+    mock_link.drop_every = 7;
+    mock_link.corrupt_every = 11;
+    mock_link.drop_ack_every = 13;
+
+    devproto_fw_config_t cfg;
+    config(&cfg);
+    cfg.max_retries = 10;
+    devproto_fw_sender_t *fw = devproto_fw_sender_create(image, sizeof(image), &cfg);
+    devproto_session_t *s = devproto_session_create(&link_transport, 8);
+
+    int rc = devproto_fw_sender_run(fw, s);
+
+    devproto_fw_stats_t st;
+    devproto_fw_sender_get_stats(fw, &st);
+    devproto_session_destroy(s);
+    devproto_fw_sender_destroy(fw);
+
+    /* Every chunk reached flash exactly once despite retransmissions */
+    int once = 1;
+    for (int i = 0; i < CHUNKS; i++) {
+        if (flash.writes[i] != 1) once = 0;
+    }
+
+    if (rc != DEVPROTO_OK || !flash_matches() || !once || st.retransmits == 0 ||
+        st.chunks_sent != CHUNKS + st.retransmits) {
+        printf("(rc %d, retransmits %u) ", rc, st.retransmits);
+        FAIL("lost chunks not recovered");
+        return;
+    }
+
+    PASS();
+}
+
+static int done_calls;
+static int done_status;
+
+static void on_done(devproto_fw_sender_t *fw, int status, void *user)
+{
+    (void)fw;
+    (void)user;
+    done_calls++;
+    done_status = status;
+}
+
+void test_fw_resume(void)
+{
+    TEST("resume from the verified offset after a reconnect");
+
+    link_reset();
+    mock_link.cut_after = 20;
+
+    devproto_fw_config_t cfg;
+    config(&cfg);
+    cfg.max_retries = 100;
+    devproto_fw_sender_t *fw = devproto_fw_sender_create(image, sizeof(image), &cfg);
+    devproto_session_t *s = devproto_session_create(&link_transport, 8);
+
+    /* Link goes dead mid-transfer; dropping the session ends that attempt */
+    done_calls = 0;
+    devproto_fw_sender_start(fw, s, on_done, NULL);
+    for (int i = 0; i < 10; i++) devproto_session_process(s, 5);
+    devproto_session_destroy(s);
+
+    uint32_t verified = 0;
+    devproto_fw_receiver_progress(mock_link.rx, &verified, NULL);
+    int interrupted = done_calls == 1 && done_status == DEVPROTO_ERR_CLOSED &&
+                      verified > 0 && verified < IMAGE_SIZE;
+
+    /* New link: the device keeps its state, the sender continues */
+    mock_link.cut_after = 0;
+    mock_rx_len = 0;
+    devproto_frame_parser_init(&mock_link.parser);
+    s = devproto_session_create(&link_transport, 8);
+    int rc = devproto_fw_sender_run(fw, s);
+
+    devproto_fw_stats_t st;
+    devproto_fw_sender_get_stats(fw, &st);
+    devproto_session_destroy(s);
+    devproto_fw_sender_destroy(fw);
+
+    if (!interrupted || rc != DEVPROTO_OK || !flash_matches() || flash.begins != 1 ||
+        st.resumed_from != verified || st.resumed_from % CHUNK != 0) {
+        printf("(verified %u, resumed %u, rc %d) ", verified, st.resumed_from, rc);
+        FAIL("transfer did not resume");
+        return;
+    }
+
+    PASS();
+}
+
+void test_fw_receiver_rejects(void)
+{
+    TEST("receiver rejects broken chains and early END");
+
+    link_reset();
+    devproto_fw_receiver_t *rx = mock_link.rx;
+    uint8_t req[DEVPROTO_FW_DATA_HEADER + 16];
+    uint8_t ack_buf[DEVPROTO_FW_ACK_SIZE];
+    devproto_message_t ack;
+    devproto_message_t msg = { .msg_type = DEVPROTO_MSG_UPDATE_FIRMWARE, .payload = req };
+    int ok = 1;
+
+    /* DATA before BEGIN */
+    memset(req, 0, sizeof(req));
+    req[0] = DEVPROTO_FW_OP_DATA;
+    msg.payload_len = sizeof(req);
+    if (devproto_fw_receiver_handle(rx, &msg, &ack, ack_buf) != DEVPROTO_FW_STATUS_STATE) ok = 0;
+
+    /* BEGIN for a 32-byte image in 16-byte chunks */
+    uint8_t img[32];
+    memset(img, 0xA5, sizeof(img));
+    uint16_t crc_all = devproto_crc16_update(DEVPROTO_CRC_INITIAL, img, sizeof(img));
+    uint8_t begin[DEVPROTO_FW_BEGIN_SIZE] = {
+        DEVPROTO_FW_OP_BEGIN, 0, 0, 0, 0, 32,
+        (uint8_t)(crc_all >> 8), (uint8_t)crc_all, 0, 16
+    };
+    msg.payload = begin;
+    msg.payload_len = sizeof(begin);
+    /* The test sink only takes IMAGE_SIZE images */
+    if (devproto_fw_receiver_handle(rx, &msg, &ack, ack_buf) != DEVPROTO_FW_STATUS_FLASH) ok = 0;
+
+    static const devproto_fw_sink_t any = { .write = flash_write };
+    devproto_fw_receiver_t *rx2 = devproto_fw_receiver_create(&any);
+    if (devproto_fw_receiver_handle(rx2, &msg, &ack, ack_buf) != DEVPROTO_FW_STATUS_OK ||
+        ack.msg_type != DEVPROTO_MSG_FIRMWARE_ACK) {
+        ok = 0;
+    }
+
+    /* Second chunk claiming a chain that does not follow the first */
+    uint16_t mid = devproto_crc16_update(DEVPROTO_CRC_INITIAL, img, 16);
+    uint16_t bogus_in = (uint16_t)(mid ^ 1);
+    uint16_t bogus_out = devproto_crc16_update(bogus_in, img + 16, 16);
+    uint8_t d1[DEVPROTO_FW_DATA_HEADER + 16] = {
+        DEVPROTO_FW_OP_DATA, 0, 0, 0, 16,
+        (uint8_t)(bogus_in >> 8), (uint8_t)bogus_in,
+        (uint8_t)(bogus_out >> 8), (uint8_t)bogus_out
+    };
+    memcpy(d1 + DEVPROTO_FW_DATA_HEADER, img + 16, 16);
+    msg.payload = d1;
+    msg.payload_len = sizeof(d1);
+    if (devproto_fw_receiver_handle(rx2, &msg, &ack, ack_buf) != DEVPROTO_FW_STATUS_OK) ok = 0;
+
+    /* END before the image is complete */
+    uint8_t end[DEVPROTO_FW_END_SIZE] = {
+        DEVPROTO_FW_OP_END, (uint8_t)(crc_all >> 8), (uint8_t)crc_all
+    };
+    msg.payload = end;
+    msg.payload_len = sizeof(end);
+    if (devproto_fw_receiver_handle(rx2, &msg, &ack, ack_buf) != DEVPROTO_FW_STATUS_IMAGE) ok = 0;
+
+    /* First chunk arrives: the parked second one no longer chains */
+    uint8_t d0[DEVPROTO_FW_DATA_HEADER + 16] = {
+        DEVPROTO_FW_OP_DATA, 0, 0, 0, 0, 0xFF, 0xFF, (uint8_t)(mid >> 8), (uint8_t)mid
+    };
+    memcpy(d0 + DEVPROTO_FW_DATA_HEADER, img, 16);
+    msg.payload = d0;
+    msg.payload_len = sizeof(d0);
+    if (devproto_fw_receiver_handle(rx2, &msg, &ack, ack_buf) != DEVPROTO_FW_STATUS_IMAGE) ok = 0;
+    if (devproto_fw_receiver_progress(rx2, NULL, NULL) != 0) ok = 0;
+
+    devproto_fw_receiver_destroy(rx2);
+
+    if (!ok) {
+        FAIL("bad request accepted");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Firmware Unit Tests ===\n");
+    printf("\n");
+
+    fill_image();
+    test_fw_clean_transfer();
+    test_fw_lossy_link();
+    test_fw_resume();
+    test_fw_receiver_rejects();
+
+    devproto_fw_receiver_destroy(mock_link.rx);
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -355,6 +355,441 @@ void test_frame_build(void)
     PASS();
 }
 
+/**
+ * Test chunked parse matches byte-by-byte parse on a mixed stream
+ */
+void test_chunked_matches_bytewise(void)
+{
+    TEST("chunked parse matches byte-by-byte");
+
+    uint8_t stream[2048];
+    size_t stream_len = 0;
+    uint8_t payload[300];
+
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)(i * 7 + 0xAA);  /* Includes sync bytes */
+    }
+
+    /* Garbage, false sync, valid frames, a corrupted frame, an oversize length */
+    static const uint8_t garbage[] = {0x00, 0xAA, 0x00, 0x12, 0xAA, 0xAA, 0x34};
+    memcpy(stream + stream_len, garbage, sizeof(garbage));
+    stream_len += sizeof(garbage);
+
+    stream_len += build_test_frame(stream + stream_len, sizeof(stream) - stream_len,
+                                   DEVPROTO_MSG_PING, 0x01, NULL, 0);
+    stream_len += build_test_frame(stream + stream_len, sizeof(stream) - stream_len,
+                                   DEVPROTO_MSG_METRICS_RESPONSE, 0x02,
+                                   payload, sizeof(payload));
+
+    int bad_len = build_test_frame(stream + stream_len, sizeof(stream) - stream_len,
+                                   DEVPROTO_MSG_COMMAND_RESULT, 0x03, payload, 40);
+    stream[stream_len + 20] ^= 0x01;
+    stream_len += bad_len;
+
+    static const uint8_t oversize[] = {0xAA, 0x55, 0xFF, 0xFF};
+    memcpy(stream + stream_len, oversize, sizeof(oversize));
+    stream_len += sizeof(oversize);
+
+    stream_len += build_test_frame(stream + stream_len, sizeof(stream) - stream_len,
+                                   DEVPROTO_MSG_STATUS_RESPONSE, 0x04, payload, 9);
+
+    /* Reference: feed every byte through the state machine */
+    devproto_frame_parser_t ref;
+    devproto_frame_parser_init(&ref);
+    uint8_t ref_types[8];
+    uint16_t ref_lens[8];
+    int ref_count = 0;
+
+    for (size_t i = 0; i < stream_len; i++) {
+        if (devproto_frame_parse_byte(&ref, stream[i]) == 1) {
+            devproto_message_t msg;
+            devproto_frame_get_message(&ref, &msg);
+            ref_types[ref_count] = msg.msg_type;
+            ref_lens[ref_count] = msg.payload_len;
+            ref_count++;
+            devproto_frame_parser_reset(&ref);
+        }
+    }
+
+    if (ref_count != 3) {
+        FAIL("reference parse should find 3 frames");
+        return;
+    }
+
+    /* Chunked parse with a range of chunk sizes (tears headers and CRCs) */
+    static const size_t chunk_sizes[] = {1, 2, 3, 5, 7, 64, 257, 2048};
+
+    for (size_t c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); c++) {
+        devproto_frame_parser_t parser;
+        devproto_frame_parser_init(&parser);
+        int count = 0;
+
+        for (size_t off = 0; off < stream_len; off += chunk_sizes[c]) {
+            size_t n = stream_len - off;
+            if (n > chunk_sizes[c]) n = chunk_sizes[c];
+
+            devproto_message_t msgs[4];
+            int got = devproto_frame_parse(&parser, stream + off, n, msgs, 4);
+            for (int m = 0; m < got; m++, count++) {
+                if (count >= ref_count ||
+                    msgs[m].msg_type != ref_types[count] ||
+                    msgs[m].payload_len != ref_lens[count]) {
+                    FAIL("message mismatch");
+                    return;
+                }
+            }
+        }
+
+        if (count != ref_count ||
+            parser.frames_parsed != ref.frames_parsed ||
+            parser.crc_errors != ref.crc_errors ||
+            parser.sync_errors != ref.sync_errors) {
+            printf("(chunk %zu) ", chunk_sizes[c]);
+            FAIL("counters differ from byte-by-byte parse");
+            return;
+        }
+    }
+
+    PASS();
+}
+
+/**
+ * Test scatter-gather build matches contiguous build
+ */
+void test_frame_build_iov(void)
+{
+    TEST("scatter-gather frame build");
+
+    uint8_t payload[1000];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)(i ^ 0x3C);
+
+    static const uint16_t lens[] = {0, 1, 1000};
+
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        devproto_message_t msg = {
+            .msg_type = DEVPROTO_MSG_UPDATE_FIRMWARE,
+            .sequence = (uint8_t)l,
+            .payload_len = lens[l],
+            .payload = lens[l] ? payload : NULL
+        };
+
+        uint8_t flat[DEVPROTO_MAX_FRAME_SIZE];
+        int flat_len = devproto_frame_build(&msg, flat, sizeof(flat));
+
+        devproto_frame_iov_t frame;
+        int iov_len = devproto_frame_build_iov(&msg, &frame);
+
+        if (iov_len != flat_len || frame.iovcnt != (lens[l] ? 3 : 2)) {
+            FAIL("length or iov count mismatch");
+            return;
+        }
+
+        /* Payload entry must reference caller data, not a copy */
+        if (lens[l] && frame.iov[1].iov_base != payload) {
+            FAIL("payload was copied");
+            return;
+        }
+
+        uint8_t gathered[DEVPROTO_MAX_FRAME_SIZE];
+        size_t pos = 0;
+        for (int i = 0; i < frame.iovcnt; i++) {
+            memcpy(gathered + pos, frame.iov[i].iov_base, frame.iov[i].iov_len);
+            pos += frame.iov[i].iov_len;
+        }
+
+        if (pos != (size_t)flat_len || memcmp(gathered, flat, pos) != 0) {
+            FAIL("gathered bytes differ from devproto_frame_build");
+            return;
+        }
+    }
+
+    PASS();
+}
+
+/**
+ * Build a burst of frames with distinct payloads
+ */
+static size_t build_test_burst(uint8_t *stream, size_t size, int frames)
+{
+    size_t len = 0;
+
+    for (int f = 0; f < frames; f++) {
+        uint8_t payload[64];
+        size_t plen = 8 + (size_t)f * 5;
+        memset(payload, 0x10 + f, plen);
+        len += build_test_frame(stream + len, size - len,
+                                DEVPROTO_MSG_METRICS_RESPONSE, (uint8_t)f,
+                                payload, plen);
+    }
+
+    return len;
+}
+
+/**
+ * Test slab parse keeps every payload of a burst intact
+ */
+void test_parse_slab_stable(void)
+{
+    TEST("slab parse stable payloads");
+
+    uint8_t stream[1024];
+    size_t stream_len = build_test_burst(stream, sizeof(stream), 6);
+
+    uint8_t storage[512];
+    devproto_frame_slab_t slab;
+    devproto_frame_slab_init(&slab, storage, sizeof(storage));
+
+    devproto_frame_parser_t parser;
+    devproto_frame_parser_init(&parser);
+
+    /* Split mid-payload so a frame spans two calls */
+    devproto_message_t msgs[8];
+    size_t consumed = 0;
+    int count = devproto_frame_parse_slab(&parser, stream, 30, &slab,
+                                          msgs, 8, &consumed);
+    int more = devproto_frame_parse_slab(&parser, stream + 30, stream_len - 30,
+                                         &slab, msgs + count, 8 - count, &consumed);
+
+    if (count + more != 6 || consumed != stream_len - 30) {
+        FAIL("expected 6 messages");
+        return;
+    }
+
+    for (int f = 0; f < 6; f++) {
+        if (msgs[f].sequence != f || msgs[f].payload_len != 8 + f * 5 ||
+            msgs[f].payload < storage || msgs[f].payload >= storage + sizeof(storage)) {
+            FAIL("message not backed by slab");
+            return;
+        }
+        for (size_t b = 0; b < msgs[f].payload_len; b++) {
+            if (msgs[f].payload[b] != 0x10 + f) {
+                FAIL("payload overwritten");
+                return;
+            }
+        }
+    }
+
+    PASS();
+}
+
+/**
+ * Test slab parse stops when slab is full and resumes after reset
+ */
+void test_parse_slab_full(void)
+{
+    TEST("slab parse full slab resume");
+
+    uint8_t stream[1024];
+    size_t stream_len = build_test_burst(stream, sizeof(stream), 6);
+
+    /* Room for the first few payloads only (8 + 13 + 18 = 39) */
+    uint8_t storage[40];
+    devproto_frame_slab_t slab;
+    devproto_frame_slab_init(&slab, storage, sizeof(storage));
+
+    devproto_frame_parser_t parser;
+    devproto_frame_parser_init(&parser);
+
+    int total = 0;
+    size_t off = 0;
+    int rounds = 0;
+
+    while (off < stream_len && rounds++ < 16) {
+        devproto_message_t msgs[8];
+        size_t consumed = 0;
+        int count = devproto_frame_parse_slab(&parser, stream + off, stream_len - off,
+                                              &slab, msgs, 8, &consumed);
+        if (count < 0) {
+            FAIL("parse error");
+            return;
+        }
+
+        for (int m = 0; m < count; m++, total++) {
+            if (msgs[m].sequence != total || msgs[m].payload[0] != 0x10 + total ||
+                msgs[m].payload[msgs[m].payload_len - 1] != 0x10 + total) {
+                FAIL("wrong message after resume");
+                return;
+            }
+        }
+
+        off += consumed;
+        devproto_frame_slab_reset(&slab);
+    }
+
+    if (total != 6 || rounds < 3) {
+        printf("(got %d in %d rounds) ", total, rounds);
+        FAIL("expected 6 messages across several rounds");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test pooled parser borrows only for large payloads and gives blocks back
+ */
+void test_pooled_parser(void)
+{
+    TEST("pooled compact parser");
+
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+    devproto_frame_pooled_parser_t *parser = devproto_frame_pooled_create(pool);
+    if (!pool || !parser) {
+        FAIL("create failed");
+        return;
+    }
+
+    uint8_t small[DEVPROTO_FRAME_COMPACT_PAYLOAD], large[3000];
+    memset(small, 0x5A, sizeof(small));
+    for (size_t i = 0; i < sizeof(large); i++) large[i] = (uint8_t)i;
+
+    uint8_t stream[4096];
+    size_t len = 0;
+    len += build_test_frame(stream + len, sizeof(stream) - len,
+                            DEVPROTO_MSG_PONG, 1, small, sizeof(small));
+    size_t large_off = len;
+    len += build_test_frame(stream + len, sizeof(stream) - len,
+                            DEVPROTO_MSG_METRICS_RESPONSE, 2, large, sizeof(large));
+
+    devproto_frame_pool_stats_t stats;
+    devproto_message_t msg;
+
+    /* Small payload stays inline */
+    int count = devproto_frame_pooled_parse(parser, stream, large_off, &msg, 1);
+    devproto_frame_pool_get_stats(pool, &stats);
+    if (count != 1 || msg.payload_len != sizeof(small) ||
+        memcmp(msg.payload, small, sizeof(small)) != 0 || stats.allocations != 0) {
+        FAIL("small frame should not touch the pool");
+        return;
+    }
+
+    /* Large payload, torn across calls, lands in a borrowed block */
+    count = devproto_frame_pooled_parse(parser, stream + large_off, 1000, &msg, 1);
+    count += devproto_frame_pooled_parse(parser, stream + large_off + 1000,
+                                         len - large_off - 1000, &msg, 1);
+    devproto_frame_pool_get_stats(pool, &stats);
+    if (count != 1 || msg.payload_len != sizeof(large) ||
+        memcmp(msg.payload, large, sizeof(large)) != 0 || stats.blocks_out != 1) {
+        FAIL("large frame should borrow one block");
+        return;
+    }
+
+    /* Next frame returns the block, which is reused afterwards */
+    devproto_frame_pooled_parse(parser, stream, large_off, &msg, 1);
+    devproto_frame_pool_get_stats(pool, &stats);
+    if (stats.blocks_out != 0 || stats.blocks_cached != 1) {
+        FAIL("block not returned to pool");
+        return;
+    }
+
+    devproto_frame_pooled_parse(parser, stream + large_off, len - large_off, &msg, 1);
+    devproto_frame_pooled_destroy(parser);
+    devproto_frame_pool_get_stats(pool, &stats);
+    if (stats.allocations != 1 || stats.blocks_out != 0) {
+        FAIL("block not reused");
+        return;
+    }
+
+    devproto_frame_pool_destroy(pool);
+    PASS();
+}
+
+/**
+ * Test extended-length frames: legacy parsers reject them, enabled ones
+ * assemble them in a pool block, and small payloads keep the legacy header
+ */
+void test_jumbo_frames(void)
+{
+    TEST("extended-length frames");
+
+    static uint8_t payload[40000];
+    static uint8_t stream[sizeof(payload) + 64];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)(i * 7);
+
+    devproto_message_t msg = {
+        .msg_type = DEVPROTO_MSG_UPDATE_FIRMWARE, .sequence = 9,
+        .payload_len = sizeof(payload), .payload = payload
+    };
+    devproto_frame_iov_t frame;
+    if (devproto_frame_build_iov(&msg, &frame) != -1) {
+        FAIL("legacy builder accepted jumbo payload");
+        return;
+    }
+
+    int len = devproto_frame_build_iov_max(&msg, &frame, DEVPROTO_JUMBO_MAX_PAYLOAD);
+    if (len != (int)(DEVPROTO_JUMBO_HEADER_SIZE + sizeof(payload) + DEVPROTO_CRC_SIZE) ||
+        frame.iov[0].iov_len != DEVPROTO_JUMBO_HEADER_SIZE ||
+        frame.header[2] != DEVPROTO_JUMBO_FLAG) {
+        FAIL("bad extended header");
+        return;
+    }
+    size_t stream_len = 0;
+    for (int i = 0; i < frame.iovcnt; i++) {
+        memcpy(stream + stream_len, frame.iov[i].iov_base, frame.iov[i].iov_len);
+        stream_len += frame.iov[i].iov_len;
+    }
+    stream_len += build_test_frame(stream + stream_len, sizeof(stream) - stream_len,
+                                   DEVPROTO_MSG_PING, 10, NULL, 0);
+
+    /* A legacy parser drops the jumbo frame and resyncs on the PING */
+    devproto_frame_parser_t parser;
+    devproto_message_t out;
+    devproto_frame_parser_init(&parser);
+    int count = devproto_frame_parse(&parser, stream, stream_len, &out, 1);
+    if (count != 1 || out.msg_type != DEVPROTO_MSG_PING || parser.sync_errors == 0) {
+        FAIL("legacy parser did not reject jumbo frame");
+        return;
+    }
+
+    /* Full-size parsers need a pool for jumbo payloads */
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+    devproto_frame_parser_init(&parser);
+    if (devproto_frame_parser_set_max_payload(&parser, DEVPROTO_JUMBO_MAX_PAYLOAD, NULL) !=
+            DEVPROTO_FRAME_ERR_INVALID ||
+        devproto_frame_parser_set_max_payload(&parser, DEVPROTO_JUMBO_MAX_PAYLOAD + 1, pool) !=
+            DEVPROTO_FRAME_ERR_INVALID ||
+        devproto_frame_parser_set_max_payload(&parser, DEVPROTO_JUMBO_MAX_PAYLOAD, pool) != 0) {
+        FAIL("max payload validation");
+        return;
+    }
+
+    /* Torn across calls, fed byte by byte through the header */
+    count = 0;
+    size_t off = 0;
+    for (; off < 5; off++) count += devproto_frame_parse(&parser, stream + off, 1, &out, 1);
+    count += devproto_frame_parse(&parser, stream + off, 20000, &out, 1);
+    off += 20000;
+    count += devproto_frame_parse(&parser, stream + off, (size_t)len - off, &out, 1);
+    if (count != 1 || out.payload_len != sizeof(payload) || out.sequence != 9 ||
+        memcmp(out.payload, payload, sizeof(payload)) != 0) {
+        FAIL("jumbo frame not assembled");
+        return;
+    }
+
+    /* Legacy frames still parse; small payloads keep the 6-byte header */
+    uint8_t small[] = {1, 2, 3};
+    devproto_message_t small_msg = {
+        .msg_type = DEVPROTO_MSG_PONG, .sequence = 11,
+        .payload_len = sizeof(small), .payload = small
+    };
+    if (devproto_frame_build_iov_max(&small_msg, &frame, DEVPROTO_JUMBO_MAX_PAYLOAD) !=
+            (int)(DEVPROTO_HEADER_SIZE + sizeof(small) + DEVPROTO_CRC_SIZE)) {
+        FAIL("small payload used extended header");
+        return;
+    }
+    count = devproto_frame_parse(&parser, stream + len, stream_len - (size_t)len, &out, 1);
+    devproto_frame_pool_stats_t stats;
+    devproto_frame_pool_get_stats(pool, &stats);
+    if (count != 1 || out.msg_type != DEVPROTO_MSG_PING || stats.blocks_out != 0) {
+        FAIL("legacy frame after jumbo");
+        return;
+    }
+
+    devproto_frame_parser_release(&parser);
+    devproto_frame_pool_destroy(pool);
+    PASS();
+}
+
 int main(void)
 {
     printf("=== Frame Parser Unit Tests ===\n");
@@ -368,6 +803,12 @@ int main(void)
     test_sync_recovery();
     test_multiple_frames();
     test_frame_build();
+    test_frame_build_iov();
+    test_chunked_matches_bytewise();
+    test_parse_slab_stable();
+    test_parse_slab_full();
+    test_pooled_parser();
+    test_jumbo_frames();
 
     printf("\n");
     printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
@@ -0,0 +1,263 @@
+/**
+ * @file test_frame_queue.c
+ * @brief Lock-free frame queue unit tests
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include "devproto/frame_queue.h"
+#include "devproto/error.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define PRODUCERS       4
+#define FRAMES_EACH     20000
+
+/**
+ * Message whose payload encodes producer and counter; every eighth frame
+ * is large enough to need a pool block
+ */
+static void make_message(devproto_message_t *msg, uint8_t *buf, uint8_t producer,
+                         uint32_t n)
+{
+    uint16_t len = (n % 8 == 0) ? 600 : 16;
+
+    memset(buf, (uint8_t)n, len);
+    buf[0] = producer;
+    memcpy(buf + 1, &n, sizeof(n));
+
+    msg->msg_type = DEVPROTO_MSG_PING;
+    msg->sequence = (uint8_t)n;
+    msg->payload_len = len;
+    msg->payload = buf;
+}
+
+/**
+ * Check a popped payload against make_message(); returns its counter or -1
+ */
+static long check_message(const devproto_message_t *msg, uint8_t *producer)
+{
+    uint32_t n;
+
+    if (msg->payload_len < 5) return -1;
+    memcpy(&n, msg->payload + 1, sizeof(n));
+    if (msg->payload_len != ((n % 8 == 0) ? 600 : 16)) return -1;
+    if (msg->payload[msg->payload_len - 1] != (uint8_t)n) return -1;
+
+    *producer = msg->payload[0];
+    return (long)n;
+}
+
+void test_queue_basic(void)
+{
+    TEST("push/pop, full queue drops and high-water mark");
+
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+    devproto_frame_queue_t *q = devproto_frame_queue_create(3, DEVPROTO_FRAME_QUEUE_SPSC, pool);
+    if (!q) {
+        FAIL("create failed");
+        devproto_frame_pool_destroy(pool);
+        return;
+    }
+
+    uint8_t buf[600];
+    devproto_message_t msg;
+    int ok = 1;
+
+    /* Capacity rounds up to 4; the fifth push is dropped */
+    for (uint32_t i = 0; i < 4; i++) {
+        make_message(&msg, buf, 0, i);
+        if (devproto_frame_queue_push(q, &msg) != 0) ok = 0;
+    }
+    make_message(&msg, buf, 0, 4);
+    if (devproto_frame_queue_push(q, &msg) != DEVPROTO_ERR_OVERFLOW) ok = 0;
+
+    devproto_frame_queue_stats_t stats;
+    devproto_frame_queue_get_stats(q, &stats);
+    if (stats.capacity != 4 || stats.depth != 4 || stats.dropped != 1 ||
+        stats.high_water != 4) {
+        ok = 0;
+    }
+
+    /* Source buffer is reused: the queue must hold its own copies */
+    memset(buf, 0xEE, sizeof(buf));
+
+    for (uint32_t i = 0; i < 4; i++) {
+        devproto_frame_queue_item_t item;
+        uint8_t producer;
+        if (devproto_frame_queue_pop(q, &item, 0) != 1 ||
+            check_message(&item.msg, &producer) != (long)i) {
+            ok = 0;
+        }
+        devproto_frame_queue_release(q, &item);
+    }
+
+    devproto_frame_queue_item_t item;
+    if (devproto_frame_queue_pop(q, &item, 20) != 0) ok = 0;
+
+    devproto_frame_pool_stats_t pstats;
+    devproto_frame_pool_get_stats(pool, &pstats);
+    if (pstats.blocks_out != 0) ok = 0;
+
+    devproto_frame_queue_destroy(q);
+    devproto_frame_pool_destroy(pool);
+
+    if (!ok) {
+        FAIL("wrong contents or statistics");
+        return;
+    }
+
+    PASS();
+}
+
+typedef struct {
+    devproto_frame_queue_t *q;
+    uint8_t id;
+} producer_arg_t;
+
+static void *producer_thread(void *arg)
+{
+    producer_arg_t *p = arg;
+    uint8_t buf[600];
+    devproto_message_t msg;
+
+    for (uint32_t i = 0; i < FRAMES_EACH; i++) {
+        make_message(&msg, buf, p->id, i);
+        while (devproto_frame_queue_push(p->q, &msg) != 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Run nproducers threads against one consumer; every frame must arrive
+ * intact and in order per producer
+ */
+static int run_threaded(devproto_frame_queue_mode_t mode, int nproducers)
+{
+    devproto_frame_queue_t *q = devproto_frame_queue_create(64, mode, NULL);
+    if (!q) return 0;
+
+    pthread_t tids[PRODUCERS];
+    producer_arg_t args[PRODUCERS];
+    for (int i = 0; i < nproducers; i++) {
+        args[i].q = q;
+        args[i].id = (uint8_t)i;
+        pthread_create(&tids[i], NULL, producer_thread, &args[i]);
+    }
+
+    long next[PRODUCERS] = { 0 };
+    long total = 0;
+    int ok = 1;
+
+    while (ok && total < (long)nproducers * FRAMES_EACH) {
+        devproto_frame_queue_item_t item;
+        int ret = devproto_frame_queue_pop(q, &item, 1000);
+        if (ret != 1) {
+            ok = 0;
+            break;
+        }
+
+        uint8_t producer = 0;
+        long n = check_message(&item.msg, &producer);
+        if (n < 0 || producer >= nproducers || n != next[producer]) ok = 0;
+        else next[producer]++;
+        total++;
+
+        devproto_frame_queue_release(q, &item);
+    }
+
+    for (int i = 0; i < nproducers; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    devproto_frame_queue_stats_t stats;
+    devproto_frame_queue_get_stats(q, &stats);
+    if (stats.popped != (uint32_t)total || stats.depth != 0 || stats.high_water > 64) ok = 0;
+
+    devproto_frame_queue_destroy(q);
+    return ok;
+}
+
+void test_queue_spsc_threads(void)
+{
+    TEST("SPSC producer and consumer threads keep order");
+
+    if (!run_threaded(DEVPROTO_FRAME_QUEUE_SPSC, 1)) {
+        FAIL("lost, corrupt or reordered frames");
+        return;
+    }
+
+    PASS();
+}
+
+void test_queue_mpsc_threads(void)
+{
+    TEST("MPSC producers keep per-producer order");
+
+    if (!run_threaded(DEVPROTO_FRAME_QUEUE_MPSC, PRODUCERS)) {
+        FAIL("lost, corrupt or reordered frames");
+        return;
+    }
+
+    PASS();
+}
+
+static void *wake_thread(void *arg)
+{
+    struct timespec gap = { 0, 20 * 1000000L };
+    nanosleep(&gap, NULL);
+    devproto_frame_queue_wake(arg);
+    return NULL;
+}
+
+void test_queue_wake(void)
+{
+    TEST("wake releases a consumer waiting forever");
+
+    devproto_frame_queue_t *q = devproto_frame_queue_create(8, DEVPROTO_FRAME_QUEUE_MPSC, NULL);
+    if (!q) {
+        FAIL("create failed");
+        return;
+    }
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, wake_thread, q);
+
+    devproto_frame_queue_item_t item;
+    int ret = devproto_frame_queue_pop(q, &item, -1);
+    pthread_join(tid, NULL);
+    devproto_frame_queue_destroy(q);
+
+    if (ret != 0) {
+        FAIL("pop did not return on wake");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Frame Queue Unit Tests ===\n");
+    printf("\n");
+
+    test_queue_basic();
+    test_queue_spsc_threads();
+    test_queue_mpsc_threads();
+    test_queue_wake();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
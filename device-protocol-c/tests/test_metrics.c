@@ -0,0 +1,495 @@
+/**
+ * @file test_metrics.c
+ * @brief Metric encode/decode unit tests, including the bulk SoA kernels
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "devproto/metrics.h"
+#include "devproto/protocol.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static const devproto_metrics_kernel_t all_kernels[] = {
+    DEVPROTO_METRICS_KERNEL_SCALAR,
+    DEVPROTO_METRICS_KERNEL_SIMD
+};
+
+#define NUM_KERNELS (sizeof(all_kernels) / sizeof(all_kernels[0]))
+
+/**
+ * Fill a buffer with pseudo-random bytes (covers NaN/denormal patterns)
+ */
+static void fill_random(uint8_t *buf, size_t len, uint32_t seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+/**
+ * Test build/parse round trip
+ */
+void test_metrics_roundtrip(void)
+{
+    TEST("build/parse round trip");
+
+    devproto_metric_t in[3] = {
+        { DEVPROTO_METRIC_CPU_USAGE, 42.5f },
+        { DEVPROTO_METRIC_TEMPERATURE, -12.25f },
+        { DEVPROTO_METRIC_RSRP_NR3500, -98.0f }
+    };
+    uint8_t buf[15];
+    devproto_metric_t out[3];
+
+    if (devproto_metrics_build(in, 3, buf, sizeof(buf)) != 15 ||
+        devproto_metrics_parse(buf, sizeof(buf), out, 3) != 3 ||
+        out[1].type != DEVPROTO_METRIC_TEMPERATURE || out[1].value != -12.25f ||
+        out[2].value != -98.0f) {
+        FAIL("round trip mismatch");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test every kernel matches devproto_metrics_parse() bit for bit
+ */
+void test_metrics_soa_identical(void)
+{
+    TEST("SoA kernels bit-identical to AoS parse");
+
+    static uint8_t payload[5 * 300 + 4];
+    fill_random(payload, sizeof(payload), 0x5EED);
+
+    static devproto_metric_t aos[300];
+    static uint8_t types[300];
+    static float values[300];
+
+    /* Counts around the 4-entry block, plus a trailing partial entry */
+    for (size_t n = 0; n <= 300; n += (n < 20 ? 1 : 23)) {
+        size_t len = n * 5 + (n % 5);
+        int expected = devproto_metrics_parse(payload, len, aos, 300);
+
+        for (size_t k = 0; k < NUM_KERNELS; k++) {
+            if (!devproto_metrics_kernel_available(all_kernels[k])) continue;
+
+            memset(types, 0, sizeof(types));
+            memset(values, 0, sizeof(values));
+            int count = devproto_metrics_parse_soa_kernel(all_kernels[k], payload, len,
+                                                          types, values, 300);
+            if (count != expected || (size_t)count != n) {
+                FAIL("count differs");
+                return;
+            }
+
+            for (int i = 0; i < count; i++) {
+                if (types[i] != (uint8_t)aos[i].type ||
+                    memcmp(&values[i], &aos[i].value, sizeof(float)) != 0) {
+                    char msg[100];
+                    snprintf(msg, sizeof(msg), "%s differs at n %zu entry %d",
+                             devproto_metrics_kernel_name(all_kernels[k]), n, i);
+                    FAIL(msg);
+                    return;
+                }
+            }
+        }
+    }
+
+    /* Capacity limit and dispatched entry point */
+    if (devproto_metrics_parse_soa(payload, 5 * 10, types, values, 7) != 7 ||
+        devproto_metrics_parse_soa(NULL, 5, types, values, 7) != -1) {
+        FAIL("capacity/argument handling");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test registry lookups
+ */
+void test_metric_registry(void)
+{
+    TEST("registry names, units and categories");
+
+    const devproto_metric_info_t *rsrp = devproto_metric_info(DEVPROTO_METRIC_RSRP_NR3500);
+
+    if (!rsrp || strcmp(rsrp->unit, "dBm") != 0 || rsrp->category != DEVPROTO_METRIC_CAT_NR3500 ||
+        strcmp(devproto_metric_category_name(rsrp->category), "nr3500") != 0 ||
+        strcmp(devproto_metric_name(DEVPROTO_METRIC_CPU_USAGE), "CPU_USAGE") != 0 ||
+        strcmp(devproto_metric_name(DEVPROTO_METRIC_HANDOVER_SUCCESS), "HANDOVER_SUCCESS_RATE") != 0 ||
+        strcmp(devproto_metric_name(DEVPROTO_METRIC_ALL), "ALL_METRICS") != 0 ||
+        strcmp(devproto_metric_name((devproto_metric_type_t)0x0F), "UNKNOWN") != 0 ||
+        devproto_metric_info((devproto_metric_type_t)0x0F) != NULL) {
+        FAIL("registry lookup mismatch");
+        return;
+    }
+
+    /* Every named code has a category (except the ALL wildcard) and a sane range */
+    for (int t = 0; t < 256; t++) {
+        const devproto_metric_info_t *info = devproto_metric_info((devproto_metric_type_t)t);
+        if (!info || t == DEVPROTO_METRIC_ALL) continue;
+        if (info->category == DEVPROTO_METRIC_CAT_UNKNOWN || !info->unit || !(info->min < info->max)) {
+            FAIL("incomplete registry entry");
+            return;
+        }
+    }
+
+    PASS();
+}
+
+/**
+ * Test batch range validation
+ */
+void test_metrics_validate(void)
+{
+    TEST("batch range validation");
+
+    const uint8_t types[6] = {
+        DEVPROTO_METRIC_CPU_USAGE, DEVPROTO_METRIC_CPU_USAGE, DEVPROTO_METRIC_RSRP_NR700,
+        0x0F, DEVPROTO_METRIC_UPTIME, DEVPROTO_METRIC_TEMPERATURE
+    };
+    const float values[6] = { 55.0f, 101.0f, -95.0f, 1.0f, 1e9f, NAN };
+    const uint8_t expected[6] = { 1, 0, 1, 0, 1, 0 };
+    uint8_t valid[6];
+
+    if (devproto_metrics_validate(types, values, 6, valid) != 3 ||
+        memcmp(valid, expected, sizeof(valid)) != 0 ||
+        devproto_metrics_validate(types, values, 6, NULL) != 3) {
+        FAIL("validation mismatch");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Build a typical site poll: ~80 metrics, mostly small integers/booleans
+ */
+static size_t build_site_poll(devproto_metric_t *m, int tick)
+{
+    size_t n = 0;
+    for (int t = 0; t < 256 && n < 80; t++) {
+        const devproto_metric_info_t *info = devproto_metric_info((devproto_metric_type_t)t);
+        if (!info || info->category == DEVPROTO_METRIC_CAT_UNKNOWN) continue;
+
+        float span = isinf(info->max) ? 1000.0f : info->max - info->min;
+        m[n].type = (devproto_metric_type_t)t;
+        m[n].value = info->min + span * (float)((t * 37) % 100) / 100.0f;
+        if (strcmp(info->unit, "bool") == 0) m[n].value = (float)(t & 1);
+        if (t == DEVPROTO_METRIC_TEMPERATURE) m[n].value += (float)tick * 0.5f;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Check decoded values against the source within registry resolution
+ */
+static int compact_matches(const devproto_metric_t *src, size_t n,
+                           const devproto_metric_t *out, int count)
+{
+    if (count != (int)n) return 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const devproto_metric_info_t *info = devproto_metric_info(src[i].type);
+        float tol = info ? info->resolution * 0.5f * 1.001f : 0.0f;
+        if (out[i].type != src[i].type) return 0;
+        if (tol == 0.0f) {
+            if (memcmp(&out[i].value, &src[i].value, sizeof(float)) != 0) return 0;
+        } else if (fabsf(out[i].value - src[i].value) > tol + fabsf(src[i].value) * 1e-6f) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Test HELLO capability exchange helpers
+ */
+void test_hello_negotiation(void)
+{
+    TEST("HELLO capability exchange");
+
+    uint8_t hello_buf[DEVPROTO_HELLO_SIZE], ack_buf[DEVPROTO_HELLO_SIZE];
+    devproto_message_t hello, ack;
+    uint8_t version = 0;
+    uint32_t caps = 0;
+
+    devproto_create_hello(&hello, 7, hello_buf, DEVPROTO_CAP_COMPACT_METRICS | 0x80000000u);
+    if (devproto_parse_hello(&hello, &version, &caps) != 0 || version != DEVPROTO_VERSION ||
+        hello.msg_type != DEVPROTO_MSG_HELLO || caps != (DEVPROTO_CAP_COMPACT_METRICS | 0x80000000u)) {
+        FAIL("HELLO round trip");
+        return;
+    }
+
+    /* Device supports only compact metrics: agreed set is the intersection */
+    devproto_create_hello_ack(&ack, hello.sequence, ack_buf, caps & DEVPROTO_CAP_COMPACT_METRICS);
+    if (devproto_parse_hello(&ack, NULL, &caps) != 0 || caps != DEVPROTO_CAP_COMPACT_METRICS ||
+        devproto_response_type(DEVPROTO_MSG_HELLO) != DEVPROTO_MSG_HELLO_ACK) {
+        FAIL("HELLO_ACK round trip");
+        return;
+    }
+
+    devproto_message_t pong;
+    devproto_create_pong(&pong, 1);
+    if (devproto_parse_hello(&pong, NULL, &caps) != -1) {
+        FAIL("non-HELLO accepted");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test compact keyframe round trip including exact-float entries
+ */
+void test_metrics_compact_keyframe(void)
+{
+    TEST("compact keyframe round trip");
+
+    static devproto_metrics_encoder_t enc;
+    static devproto_metrics_decoder_t dec;
+    devproto_metrics_encoder_init(&enc);
+    devproto_metrics_decoder_init(&dec);
+
+    devproto_metric_t in[5] = {
+        { DEVPROTO_METRIC_RSRP_NR3500, -98.37f },
+        { DEVPROTO_METRIC_BER, 1.5e-7f },               /* ratio: exact */
+        { DEVPROTO_METRIC_DOOR_STATUS, 1.0f },
+        { DEVPROTO_METRIC_UPTIME, 3e12f },              /* beyond quantizer: exact */
+        { DEVPROTO_METRIC_CPU_USAGE, 42.5f }
+    };
+    /* Decoder outputs in ascending type order */
+    const devproto_metric_t sorted[5] = { in[4], in[1], in[3], in[0], in[2] };
+    devproto_metric_t out[8];
+    uint8_t buf[128];
+
+    int len = devproto_metrics_build_compact(&enc, in, 5, buf, sizeof(buf));
+    int count = devproto_metrics_parse_compact(&dec, buf, (size_t)len, out, 8);
+
+    if (len <= 0 || !devproto_metrics_is_compact(buf, (size_t)len) ||
+        !compact_matches(sorted, 5, out, count)) {
+        FAIL("keyframe mismatch");
+        return;
+    }
+
+    /* Duplicate types are rejected; so is a too-small buffer */
+    devproto_metric_t dup[2] = { in[0], in[0] };
+    if (devproto_metrics_build_compact(&enc, dup, 2, buf, sizeof(buf)) != -1 ||
+        devproto_metrics_build_compact(&enc, in, 5, buf, 8) != -1) {
+        FAIL("invalid input accepted");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test delta encoding across acknowledged polls
+ */
+void test_metrics_compact_delta(void)
+{
+    TEST("compact delta against acked snapshot");
+
+    static devproto_metrics_encoder_t enc;
+    static devproto_metrics_decoder_t dec;
+    devproto_metrics_encoder_init(&enc);
+    devproto_metrics_decoder_init(&dec);
+
+    devproto_metric_t in[80], out[100];
+    uint8_t buf[1024], legacy[1024];
+    int sizes[4];
+
+    for (int tick = 0; tick < 4; tick++) {
+        size_t n = build_site_poll(in, tick);
+
+        /* Host -> device acknowledgement travels in the request */
+        uint8_t req[8], ack_id = 0xEE;
+        const uint8_t *types;
+        size_t num_types;
+        int req_len = devproto_metrics_request_build(devproto_metrics_decoder_ack(&dec),
+                                                     NULL, 0, req, sizeof(req));
+        if (devproto_metrics_request_parse(req, (size_t)req_len, &ack_id, &types, &num_types) != 1 ||
+            num_types != 1 || types[0] != DEVPROTO_METRIC_ALL) {
+            FAIL("request ack round trip");
+            return;
+        }
+        devproto_metrics_encoder_ack(&enc, ack_id);
+
+        sizes[tick] = devproto_metrics_build_compact(&enc, in, n, buf, sizeof(buf));
+        int count = devproto_metrics_parse_compact(&dec, buf, (size_t)sizes[tick], out, 100);
+        if (sizes[tick] <= 0 || !compact_matches(in, n, out, count)) {
+            FAIL("delta reconstruction mismatch");
+            return;
+        }
+    }
+
+    int legacy_len = devproto_metrics_build(in, 80, legacy, sizeof(legacy));
+    printf("(legacy %d B, keyframe %d B, delta %d B) ", legacy_len, sizes[0], sizes[2]);
+
+    /* Only the temperature changes per tick: 1 entry + bitmap + header */
+    if (sizes[0] >= legacy_len * 2 / 3 || sizes[2] > 12) {
+        FAIL("compact payload not smaller");
+        return;
+    }
+
+    /* Legacy requests still parse */
+    uint8_t ack_id;
+    const uint8_t *types;
+    size_t num_types;
+    uint8_t legacy_req[2] = { DEVPROTO_METRIC_CPU_USAGE, DEVPROTO_METRIC_TEMPERATURE };
+    if (devproto_metrics_request_parse(legacy_req, 2, &ack_id, &types, &num_types) != 0 ||
+        num_types != 2 || ack_id != 0) {
+        FAIL("legacy request misparsed");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test recovery from lost acknowledgements and lost baselines
+ */
+void test_metrics_compact_resync(void)
+{
+    TEST("compact resync after lost state");
+
+    static devproto_metrics_encoder_t enc;
+    static devproto_metrics_decoder_t dec, fresh;
+    devproto_metrics_encoder_init(&enc);
+    devproto_metrics_decoder_init(&dec);
+    devproto_metrics_decoder_init(&fresh);
+
+    devproto_metric_t in[80], out[100];
+    uint8_t buf[1024];
+    size_t n = build_site_poll(in, 0);
+
+    int len = devproto_metrics_build_compact(&enc, in, n, buf, sizeof(buf));
+    devproto_metrics_parse_compact(&dec, buf, (size_t)len, out, 100);
+    uint8_t ack = devproto_metrics_decoder_ack(&dec);
+
+    /* Second poll is sent before the ack arrives: still a keyframe */
+    n = build_site_poll(in, 1);
+    len = devproto_metrics_build_compact(&enc, in, n, buf, sizeof(buf));
+    devproto_metrics_encoder_ack(&enc, ack);    /* Stale: ignored */
+    if (devproto_metrics_parse_compact(&dec, buf, (size_t)len, out, 100) != (int)n) {
+        FAIL("pipelined keyframe rejected");
+        return;
+    }
+    devproto_metrics_encoder_ack(&enc, devproto_metrics_decoder_ack(&dec));
+
+    /* A decoder that missed the baseline fails and asks for a keyframe */
+    n = build_site_poll(in, 2);
+    len = devproto_metrics_build_compact(&enc, in, n, buf, sizeof(buf));
+    if (devproto_metrics_parse_compact(&fresh, buf, (size_t)len, out, 100) != -1 ||
+        devproto_metrics_decoder_ack(&fresh) != 0) {
+        FAIL("unknown baseline accepted");
+        return;
+    }
+    if (!compact_matches(in, n, out, devproto_metrics_parse_compact(&dec, buf, (size_t)len,
+                                                                    out, 100))) {
+        FAIL("delta mismatch");
+        return;
+    }
+
+    devproto_metrics_encoder_ack(&enc, 0);
+    len = devproto_metrics_build_compact(&enc, in, n, buf, sizeof(buf));
+    if (!compact_matches(in, n, out, devproto_metrics_parse_compact(&fresh, buf, (size_t)len,
+                                                                    out, 100))) {
+        FAIL("keyframe after resync mismatch");
+        return;
+    }
+
+    /* Dropping a type forces a keyframe */
+    devproto_metrics_encoder_ack(&enc, devproto_metrics_decoder_ack(&fresh));
+    len = devproto_metrics_build_compact(&enc, in, n - 1, buf, sizeof(buf));
+    if (len < 2 || (buf[1] & DEVPROTO_METRICS_COMPACT_DELTA) ||
+        !compact_matches(in, n - 1, out, devproto_metrics_parse_compact(&fresh, buf, (size_t)len,
+                                                                        out, 100))) {
+        FAIL("shrinking set not sent as keyframe");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Decode throughput for AoS and each SoA kernel (informational)
+ */
+void test_metrics_soa_throughput(void)
+{
+    TEST("SoA decode throughput");
+    printf("\n");
+
+    enum { N = 80, ITER = 200000 };
+    static uint8_t payload[N * 5];
+    fill_random(payload, sizeof(payload), 7);
+
+    static devproto_metric_t aos[N];
+    static uint8_t types[N];
+    static float values[N];
+    struct timespec start, end;
+    volatile float sink = 0;
+
+    for (int k = -1; k < (int)NUM_KERNELS; k++) {
+        const char *name = k < 0 ? "aos" : devproto_metrics_kernel_name(all_kernels[k]);
+
+        if (k >= 0 && !devproto_metrics_kernel_available(all_kernels[k])) {
+            printf("    %-8s  n/a\n", name);
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < ITER; i++) {
+            if (k < 0) {
+                devproto_metrics_parse(payload, sizeof(payload), aos, N);
+                sink += aos[i % N].value;
+            } else {
+                devproto_metrics_parse_soa_kernel(all_kernels[k], payload, sizeof(payload),
+                                                  types, values, N);
+                sink += values[i % N];
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double secs = (double)(end.tv_sec - start.tv_sec) +
+                      (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("    %-8s  %6.2f ns/metric\n", name, secs * 1e9 / ((double)N * ITER));
+    }
+
+    (void)sink;
+    printf("   ");
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Metrics Unit Tests ===\n");
+    printf("\n");
+
+    test_metrics_roundtrip();
+    test_metrics_soa_identical();
+    test_metric_registry();
+    test_metrics_validate();
+    test_hello_negotiation();
+    test_metrics_compact_keyframe();
+    test_metrics_compact_delta();
+    test_metrics_compact_resync();
+    test_metrics_soa_throughput();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,630 @@
+/**
+ * @file test_net.c
+ * @brief Resolver cache, connector, keepalive, backoff and reconnect tests
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "devproto/net.h"
+#include "devproto/transport.h"
+#include "devproto/session.h"
+#include "devproto/frame.h"
+#include "devproto/error.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+/**
+ * Listen on an ephemeral loopback port
+ * Returns listening fd and sets *port, or -1.
+ */
+static int listen_loopback(int *port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 4) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/**
+ * Loopback port nobody listens on
+ */
+static int closed_port(void)
+{
+    int port;
+    int fd = listen_loopback(&port);
+    if (fd < 0) return -1;
+    close(fd);
+    return port;
+}
+
+/**
+ * Append 127.0.0.1:port to an address list
+ */
+static void add_loopback(devproto_addr_list_t *list, int port)
+{
+    struct sockaddr_in *a = (struct sockaddr_in *)&list->addrs[list->count];
+    memset(a, 0, sizeof(*a));
+    a->sin_family = AF_INET;
+    a->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    a->sin_port = htons((uint16_t)port);
+    list->lens[list->count++] = sizeof(*a);
+}
+
+static double elapsed_ms(const struct timespec *a, const struct timespec *b)
+{
+    return (double)(b->tv_sec - a->tv_sec) * 1e3 + (double)(b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+/**
+ * Test repeated lookups are served from the cache until the TTL ends
+ */
+static void test_resolver_cache(void)
+{
+    TEST("resolver cache and expiry");
+
+    devproto_resolver_config_t cfg;
+    devproto_resolver_config_init(&cfg);
+    cfg.ttl_ms = 50;
+    devproto_resolver_t *r = devproto_resolver_create(&cfg);
+
+    devproto_addr_list_t a, b;
+    int ok = r &&
+             devproto_resolver_lookup(r, "127.0.0.1", 7000, AF_UNSPEC, &a) == 0 &&
+             devproto_resolver_lookup(r, "127.0.0.1", 7000, AF_UNSPEC, &b) == 0;
+
+    devproto_resolver_stats_t st;
+    devproto_resolver_get_stats(r, &st);
+    const struct sockaddr_in *sin = (const struct sockaddr_in *)&a.addrs[0];
+    if (!ok || a.count != 1 || sin->sin_family != AF_INET || ntohs(sin->sin_port) != 7000 ||
+        memcmp(&a, &b, sizeof(a)) != 0 || st.misses != 1 || st.hits != 1) {
+        FAIL("second lookup not a hit");
+        devproto_resolver_destroy(r);
+        return;
+    }
+
+    /* Another port is another entry */
+    devproto_resolver_lookup(r, "127.0.0.1", 7001, AF_UNSPEC, &a);
+    usleep(60 * 1000);
+    devproto_resolver_lookup(r, "127.0.0.1", 7000, AF_UNSPEC, &a);
+    devproto_resolver_flush(r);
+    devproto_resolver_lookup(r, "127.0.0.1", 7000, AF_UNSPEC, &a);
+    devproto_resolver_get_stats(r, &st);
+
+    devproto_addr_list_t bad;
+    errno = 0;
+    int rejected = devproto_resolver_lookup(r, "127.0.0.1", 0, AF_UNSPEC, &bad) == -1 &&
+                   errno == EINVAL;
+
+    devproto_resolver_destroy(r);
+    if (st.misses != 4 || st.hits != 1 || !rejected) {
+        FAIL("expired or flushed entry served");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test non-blocking lookups: names go to a helper thread, numeric hosts
+ * and cached answers come back at once, cancelled lookups are reaped
+ */
+static void test_resolver_async(void)
+{
+    TEST("resolver non-blocking lookups");
+
+    devproto_resolver_t *r = devproto_resolver_create(NULL);
+    devproto_resolve_t *q = NULL;
+    devproto_addr_list_t a, b, c;
+    memset(&a, 0, sizeof(a));
+
+    int started = r ? devproto_resolver_start(r, "localhost", 7000, AF_INET, &a, &q) : -1;
+    int fd = devproto_resolve_fd(q);
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int ready = started == 1 && fd >= 0 && poll(&pfd, 1, 2000) == 1;
+    int finished = ready ? devproto_resolve_finish(q, &a) : -1;
+
+    /* Answered from the cache and from the address itself */
+    devproto_resolve_t *none = NULL;
+    int cached = r ? devproto_resolver_start(r, "localhost", 7000, AF_INET, &b, &none) : -1;
+    int numeric = r ? devproto_resolver_start(r, "127.0.0.1", 7001, AF_INET, &c, &none) : -1;
+
+    /* Abandoned right away; destroy waits for its helper */
+    devproto_resolver_flush(r);
+    devproto_resolve_t *dropped = NULL;
+    int again = r ? devproto_resolver_start(r, "localhost", 7000, AF_INET, &b, &dropped) : -1;
+    devproto_resolve_cancel(dropped);
+
+    devproto_resolver_stats_t st;
+    devproto_resolver_get_stats(r, &st);
+    devproto_resolver_destroy(r);
+
+    const struct sockaddr_in *sin = (const struct sockaddr_in *)&a.addrs[0];
+    if (started != 1 || finished != 0 || a.count < 1 || ntohs(sin->sin_port) != 7000 ||
+        cached != 0 || memcmp(&a, &b, sizeof(a)) != 0 || st.hits != 1 ||
+        numeric != 0 || c.count != 1 || none != NULL || again != 1) {
+        FAIL("lookup not asynchronous or not cached");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test answers alternate address families
+ */
+static void test_resolver_interleave(void)
+{
+    TEST("resolver family interleaving");
+
+    devproto_resolver_t *r = devproto_resolver_create(NULL);
+    devproto_addr_list_t a;
+    if (!r || devproto_resolver_lookup(r, "localhost", 7000, AF_UNSPEC, &a) != 0 ||
+        a.count == 0) {
+        printf("(no localhost) ");
+        devproto_resolver_destroy(r);
+        PASS();
+        return;
+    }
+
+    /* Families alternate until the smaller one runs out */
+    int v4 = 0, v6 = 0, bad = 0;
+    for (size_t i = 0; i < a.count; i++) {
+        int fam = ((const struct sockaddr *)&a.addrs[i])->sa_family;
+        if (fam == AF_INET) v4++;
+        else if (fam == AF_INET6) v6++;
+        else bad++;
+    }
+    size_t paired = 2 * (size_t)(v4 < v6 ? v4 : v6);
+    for (size_t i = 1; i < paired; i++) {
+        if (((const struct sockaddr *)&a.addrs[i])->sa_family ==
+            ((const struct sockaddr *)&a.addrs[i - 1])->sa_family) {
+            bad++;
+        }
+    }
+
+    devproto_resolver_destroy(r);
+    if (bad) {
+        FAIL("families not interleaved");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test a refused address falls through to the next one without waiting
+ */
+static void test_connect_fallback(void)
+{
+    TEST("connector falls back past refused address");
+
+    int port;
+    int lfd = listen_loopback(&port);
+    devproto_addr_list_t list = { 0 };
+    add_loopback(&list, closed_port());
+    add_loopback(&list, port);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int fd = devproto_connect(&list, 1000, 2000);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    struct sockaddr_in peer;
+    socklen_t len = sizeof(peer);
+    int ok = fd >= 0 && getpeername(fd, (struct sockaddr *)&peer, &len) == 0 &&
+             ntohs(peer.sin_port) == port && (fcntl(fd, F_GETFL) & O_NONBLOCK);
+
+    if (fd >= 0) close(fd);
+    close(lfd);
+
+    if (!ok || elapsed_ms(&t0, &t1) > 500) {
+        FAIL("did not reach second address promptly");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test every address refusing fails with the attempts' error
+ */
+static void test_connect_all_fail(void)
+{
+    TEST("connector reports failure of all addresses");
+
+    devproto_addr_list_t list = { 0 };
+    add_loopback(&list, closed_port());
+    add_loopback(&list, closed_port());
+
+    errno = 0;
+    int fd = devproto_connect(&list, 0, 2000);
+    int err = errno;
+
+    devproto_addr_list_t empty = { 0 };
+    devproto_connector_t c;
+    if (fd != -1 || err != ECONNREFUSED ||
+        devproto_connector_start(&c, &empty, 0, -1) != -1) {
+        if (fd >= 0) close(fd);
+        FAIL("unexpected result");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test open_step connects without blocking and applies keepalive
+ */
+static void test_tcp_open_step(void)
+{
+    TEST("TCP non-blocking open with keepalive");
+
+    int port;
+    int lfd = listen_loopback(&port);
+
+    devproto_tcp_config_t cfg;
+    devproto_tcp_config_init(&cfg, "127.0.0.1", port);
+    devproto_transport_t *t = devproto_transport_tcp_create_ex(&cfg);
+
+    int ret = -1;
+    for (int i = 0; t && i < 100; i++) {
+        ret = devproto_transport_open_step(t);
+        if (ret <= 0) break;
+        struct pollfd pfd = { .fd = t->fd, .events = POLLOUT };
+        poll(&pfd, 1, 10);
+    }
+
+    int ka = 0, idle = 0, cnt = 0;
+    socklen_t len = sizeof(int);
+    int ok = ret == 0 && t->is_open && t->fd >= 0 &&
+             getsockopt(t->fd, SOL_SOCKET, SO_KEEPALIVE, &ka, &len) == 0 && ka == 1;
+#ifdef TCP_KEEPIDLE
+    len = sizeof(int);
+    ok = ok && getsockopt(t->fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, &len) == 0 &&
+         idle == DEVPROTO_KEEPALIVE_IDLE_MS / 1000;
+#endif
+#ifdef TCP_KEEPCNT
+    len = sizeof(int);
+    ok = ok && getsockopt(t->fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, &len) == 0 &&
+         cnt == DEVPROTO_KEEPALIVE_COUNT;
+#endif
+#ifdef TCP_USER_TIMEOUT
+    unsigned int user = 0;
+    len = sizeof(user);
+    ok = ok && getsockopt(t->fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &user, &len) == 0 &&
+         user == DEVPROTO_KEEPALIVE_USER_MS;
+#endif
+    (void)idle;
+    (void)cnt;
+
+    devproto_transport_destroy(t);
+    close(lfd);
+
+    if (!ok) {
+        FAIL("not open or keepalive missing");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test a non-blocking open of a name waits on the resolver's descriptor
+ * first, and that closing mid-lookup abandons it
+ */
+static void test_tcp_open_step_resolve(void)
+{
+    TEST("TCP non-blocking open resolves off-thread");
+
+    int port;
+    int lfd = listen_loopback(&port);
+    devproto_resolver_t *r = devproto_resolver_create(NULL);
+
+    devproto_tcp_config_t cfg;
+    devproto_tcp_config_init(&cfg, "localhost", port);
+    cfg.family = AF_INET;
+    cfg.resolver = r;
+    devproto_transport_t *t = devproto_transport_tcp_create_ex(&cfg);
+
+    int first = t ? devproto_transport_open_step(t) : -1;
+    int lookup_fd = t ? t->fd : -1;
+    int ret = first;
+    for (int i = 0; t && i < 200 && ret > 0; i++) {
+        struct pollfd pfd = {
+            .fd = t->fd,
+            .events = ret == DEVPROTO_TRANSPORT_WANT_READ ? POLLIN : POLLOUT
+        };
+        poll(&pfd, 1, 10);
+        ret = devproto_transport_open_step(t);
+    }
+    /* The lookup's pipe may have been closed and its number reused */
+    int type = 0;
+    socklen_t len = sizeof(type);
+    int opened = ret == 0 && t->is_open &&
+                 getsockopt(t->fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0 && type == SOCK_STREAM;
+    devproto_transport_destroy(t);
+
+    /* Closed while the lookup runs */
+    devproto_resolver_flush(r);
+    t = devproto_transport_tcp_create_ex(&cfg);
+    int pending = t ? devproto_transport_open_step(t) : -1;
+    if (t) devproto_transport_close(t);
+    int reset = t && t->fd == -1 && !t->is_open;
+    devproto_transport_destroy(t);
+
+    devproto_resolver_destroy(r);
+    close(lfd);
+
+    if (first != DEVPROTO_TRANSPORT_WANT_READ || lookup_fd < 0 || !opened ||
+        pending != DEVPROTO_TRANSPORT_WANT_READ || !reset) {
+        FAIL("open blocked on the lookup or did not complete");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test backoff stays within its bounds, grows, resets and jitters
+ */
+static void test_backoff(void)
+{
+    TEST("backoff bounds and jitter");
+
+    devproto_backoff_t a, b;
+    devproto_backoff_init(&a, 100, 1000);
+    devproto_backoff_init(&b, 100, 1000);
+
+    int bad = 0, differ = 0, top = 0;
+    for (int i = 0; i < 50; i++) {
+        int ceiling = i < 4 ? 100 << i : 1000;
+        int da = devproto_backoff_next(&a);
+        int db = devproto_backoff_next(&b);
+        if (da < 50 || da > ceiling || db < 50 || db > ceiling) bad++;
+        if (da != db) differ++;
+        if (da > 500) top++;
+    }
+
+    devproto_backoff_reset(&a);
+    int first = devproto_backoff_next(&a);
+
+    if (bad || !differ || !top || first < 50 || first > 100) {
+        FAIL("delay out of range or not jittered");
+        return;
+    }
+    PASS();
+}
+
+/* ---- Session reconnect ---- */
+
+typedef struct {
+    int calls;
+    int status;
+} completion_t;
+
+static void on_response(devproto_session_t *s, int status,
+                        const devproto_message_t *resp, void *user)
+{
+    (void)s;
+    (void)resp;
+    completion_t *c = user;
+    c->calls++;
+    c->status = status;
+}
+
+/**
+ * Read one request on the peer side and answer it
+ */
+static int answer_request(int fd)
+{
+    devproto_frame_parser_t parser;
+    devproto_frame_parser_init(&parser);
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    for (int i = 0; i < 100 && poll(&pfd, 1, 20) >= 0; i++) {
+        if (!(pfd.revents & POLLIN)) continue;
+
+        uint8_t buf[256];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return -1;
+
+        devproto_message_t msgs[4];
+        if (devproto_frame_parse(&parser, buf, (size_t)n, msgs, 4) > 0) {
+            devproto_message_t resp = {
+                .msg_type = devproto_response_type(msgs[0].msg_type),
+                .sequence = msgs[0].sequence
+            };
+            uint8_t out[64];
+            int len = devproto_frame_build(&resp, out, sizeof(out));
+            return send(fd, out, (size_t)len, 0) == len ? 0 : -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Test a dropped link fails in-flight requests, comes back after the
+ * backoff and then carries queued requests
+ */
+static void test_session_reconnect(void)
+{
+    TEST("session reconnect with queued requests");
+
+    int port;
+    int lfd = listen_loopback(&port);
+    devproto_transport_t *t = devproto_transport_tcp_create("127.0.0.1", port);
+    if (!t || devproto_transport_open(t) != 0) {
+        FAIL("setup");
+        devproto_transport_destroy(t);
+        close(lfd);
+        return;
+    }
+    int peer = accept(lfd, NULL, NULL);
+
+    devproto_session_t *s = devproto_session_create(t, 4);
+    devproto_session_set_reconnect(s, 1, 20, 100);
+
+    /* In flight when the peer hangs up */
+    completion_t lost = { 0 }, queued = { 0 };
+    devproto_message_t ping = { .msg_type = DEVPROTO_MSG_PING };
+    int64_t deadline = devproto_session_clock_ms() + 3000;
+    devproto_session_request_async(s, &ping, deadline, on_response, &lost);
+    close(peer);
+
+    int failed = 0;
+    for (int i = 0; i < 50 && lost.calls == 0; i++) {
+        int n = devproto_session_process(s, 20);
+        if (n < 0) break;
+        failed += n;
+    }
+    int down = !t->is_open;
+
+    /* Issued while down: waits for the new connection */
+    devproto_session_request_async(s, &ping, deadline, on_response, &queued);
+    int held = devproto_session_queued(s) == 1;
+
+    int flags = fcntl(lfd, F_GETFL, 0);
+    fcntl(lfd, F_SETFL, flags | O_NONBLOCK);
+    peer = -1;
+    int pumped = -1;
+    for (int i = 0; i < 200 && queued.calls == 0; i++) {
+        if (devproto_session_process(s, 10) < 0) break;
+
+        /* The call that completes the open also sends what was held */
+        if (pumped < 0 && t->is_open) pumped = devproto_session_queued(s) == 0;
+        if (peer < 0) {
+            peer = accept(lfd, NULL, NULL);
+            continue;
+        }
+
+        struct pollfd pfd = { .fd = peer, .events = POLLIN };
+        if (poll(&pfd, 1, 0) > 0 && answer_request(peer) != 0) break;
+    }
+
+    devproto_session_stats_t st;
+    devproto_session_get_stats(s, &st);
+
+    devproto_session_destroy(s);
+    devproto_transport_destroy(t);
+    if (peer >= 0) close(peer);
+    close(lfd);
+
+    if (lost.calls != 1 || lost.status != DEVPROTO_ERR_IO || failed != 1 || !down ||
+        !held || pumped != 1 || queued.calls != 1 || queued.status != DEVPROTO_OK ||
+        st.reconnects != 1) {
+        FAIL("request lost or link not restored");
+        return;
+    }
+    PASS();
+}
+
+/**
+ * Test a queued request whose send fails takes the link down and goes out
+ * on the next connection instead of failing
+ */
+static void test_session_send_failure(void)
+{
+    TEST("session reconnect after a failed send");
+
+    int port;
+    int lfd = listen_loopback(&port);
+    devproto_transport_t *t = devproto_transport_tcp_create("127.0.0.1", port);
+    if (!t || devproto_transport_open(t) != 0) {
+        FAIL("setup");
+        devproto_transport_destroy(t);
+        close(lfd);
+        return;
+    }
+    int peer = accept(lfd, NULL, NULL);
+
+    devproto_session_t *s = devproto_session_create(t, 1);
+    devproto_session_set_reconnect(s, 1, 20, 100);
+
+    /* The second request waits for the window */
+    completion_t first = { 0 }, second = { 0 };
+    devproto_message_t ping = { .msg_type = DEVPROTO_MSG_PING };
+    int64_t deadline = devproto_session_clock_ms() + 3000;
+    devproto_session_request_async(s, &ping, deadline, on_response, &first);
+    devproto_session_request_async(s, &ping, deadline, on_response, &second);
+    int held = devproto_session_queued(s) == 1;
+
+    /* Replies still arrive, but nothing more can be sent */
+    shutdown(t->fd, SHUT_WR);
+    int answered = answer_request(peer) == 0;
+    for (int i = 0; i < 50 && first.calls == 0; i++) {
+        if (devproto_session_process(s, 20) < 0) break;
+    }
+    int down = !t->is_open && second.calls == 0 && devproto_session_queued(s) == 1;
+    close(peer);
+
+    int flags = fcntl(lfd, F_GETFL, 0);
+    fcntl(lfd, F_SETFL, flags | O_NONBLOCK);
+    peer = -1;
+    for (int i = 0; i < 200 && second.calls == 0; i++) {
+        if (devproto_session_process(s, 10) < 0) break;
+        if (peer < 0) {
+            peer = accept(lfd, NULL, NULL);
+            continue;
+        }
+        struct pollfd pfd = { .fd = peer, .events = POLLIN };
+        if (poll(&pfd, 1, 0) > 0 && answer_request(peer) != 0) break;
+    }
+
+    devproto_session_stats_t st;
+    devproto_session_get_stats(s, &st);
+
+    devproto_session_destroy(s);
+    devproto_transport_destroy(t);
+    if (peer >= 0) close(peer);
+    close(lfd);
+
+    if (!held || !answered || first.calls != 1 || first.status != DEVPROTO_OK || !down ||
+        second.calls != 1 || second.status != DEVPROTO_OK || st.reconnects != 1) {
+        FAIL("failed send not retried on a new link");
+        return;
+    }
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Net Unit Tests ===\n");
+    printf("\n");
+
+    test_resolver_cache();
+    test_resolver_async();
+    test_resolver_interleave();
+    test_connect_fallback();
+    test_connect_all_fail();
+    test_tcp_open_step();
+    test_tcp_open_step_resolve();
+    test_backoff();
+    test_session_reconnect();
+    test_session_send_failure();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+/**
+ * @file test_reactor.c
+ * @brief Reactor unit tests over loopback TCP
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "devproto/reactor.h"
+#include "devproto/frame.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define NUM_CONNS 64
+
+/**
+ * Per-connection test state (callback user pointer)
+ */
+typedef struct {
+    int messages;
+    int closed;
+    int bad_payload;
+    int opened;
+    int remove_after;                   /* Remove self after N messages (0 = never) */
+} conn_state_t;
+
+static int listen_loopback(int *port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, NUM_CONNS) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void on_message(devproto_reactor_t *r, devproto_transport_t *t,
+                       const devproto_message_t *msg, void *user)
+{
+    conn_state_t *st = user;
+
+    /* Payload bytes all equal the sequence number */
+    for (size_t i = 0; i < msg->payload_len; i++) {
+        if (msg->payload[i] != msg->sequence) st->bad_payload++;
+    }
+    st->messages++;
+
+    if (st->remove_after && st->messages == st->remove_after) {
+        devproto_reactor_remove(r, t);
+    }
+}
+
+static void on_close(devproto_reactor_t *r, devproto_transport_t *t, void *user)
+{
+    (void)r;
+    (void)t;
+    ((conn_state_t *)user)->closed++;
+}
+
+/**
+ * Write a frame with a payload of `len` copies of `seq` to a raw socket
+ */
+static void peer_send(int fd, uint8_t seq, size_t len)
+{
+    static uint8_t payload[DEVPROTO_MAX_PAYLOAD_SIZE];
+    uint8_t frame[DEVPROTO_MAX_FRAME_SIZE];
+
+    memset(payload, seq, len);
+    devproto_message_t msg = {
+        .msg_type = DEVPROTO_MSG_METRICS_RESPONSE,
+        .sequence = seq,
+        .payload_len = (uint16_t)len,
+        .payload = payload
+    };
+    int n = devproto_frame_build(&msg, frame, sizeof(frame));
+
+    /* Tear large frames so they span several reads */
+    if (n > 1000) {
+        if (write(fd, frame, 700) != 700) return;
+        usleep(1000);
+        if (write(fd, frame + 700, n - 700) != n - 700) return;
+    } else if (write(fd, frame, n) != n) {
+        return;
+    }
+}
+
+/**
+ * Test many connections dispatched from one loop, with closes and removals
+ */
+void test_reactor_many_connections(void)
+{
+    TEST("reactor multiplexes many connections");
+
+    int port;
+    int lfd = listen_loopback(&port);
+    devproto_reactor_t *r = devproto_reactor_create();
+    if (lfd < 0 || !r) {
+        FAIL("setup failed");
+        return;
+    }
+
+    devproto_transport_t *ts[NUM_CONNS];
+    int peers[NUM_CONNS];
+    conn_state_t st[NUM_CONNS];
+    memset(st, 0, sizeof(st));
+
+    for (int i = 0; i < NUM_CONNS; i++) {
+        ts[i] = devproto_transport_tcp_create("127.0.0.1", port);
+        if (!ts[i] || devproto_transport_open(ts[i]) != 0) {
+            FAIL("connect failed");
+            return;
+        }
+        peers[i] = accept(lfd, NULL, NULL);
+        if (i == 1) st[i].remove_after = 2;
+        devproto_reactor_add(r, ts[i], on_message, on_close, &st[i]);
+    }
+
+    if (devproto_reactor_count(r) != NUM_CONNS) {
+        FAIL("registration failed");
+        return;
+    }
+
+    /* Each peer sends small frames plus one large torn frame */
+    for (int i = 0; i < NUM_CONNS; i++) {
+        peer_send(peers[i], 1, 8);
+        peer_send(peers[i], 2, 40);
+        peer_send(peers[i], 3, 3000);
+        peer_send(peers[i], 4, 0);
+    }
+    /* Peer 0 hangs up */
+    close(peers[0]);
+    peers[0] = -1;
+
+    int total = 0;
+    for (int round = 0; round < 200 && total < 4 * (NUM_CONNS - 1) + 2; round++) {
+        int n = devproto_reactor_run_once(r, 20);
+        if (n < 0) break;
+        total += n;
+    }
+    for (int round = 0; round < 10 && !st[0].closed; round++) {
+        devproto_reactor_run_once(r, 20);
+    }
+
+    int ok = st[0].closed == 1 && st[0].messages == 4 && st[1].messages == 2 &&
+             devproto_reactor_count(r) == NUM_CONNS - 2;
+    for (int i = 2; i < NUM_CONNS; i++) {
+        if (st[i].messages != 4 || st[i].closed || st[i].bad_payload) ok = 0;
+    }
+    devproto_frame_stats_t fstats;
+    devproto_frame_pooled_get_stats(devproto_reactor_parser(r, ts[5]), &fstats);
+    if (devproto_reactor_parser(r, ts[5]) == NULL || fstats.frames_parsed != 4) {
+        ok = 0;
+    }
+
+    devproto_reactor_destroy(r);
+    for (int i = 0; i < NUM_CONNS; i++) {
+        devproto_transport_destroy(ts[i]);
+        if (peers[i] >= 0) close(peers[i]);
+    }
+    close(lfd);
+
+    if (!ok) {
+        printf("(closed %d, conn1 %d, conn2 %d) ", st[0].closed, st[1].messages, st[2].messages);
+        FAIL("wrong dispatch");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Mock transport with a multi-step open over a socketpair: WANT_WRITE, then
+ * WANT_READ until the peer sends 'H' (a stand-in for a handshake).
+ */
+typedef struct {
+    int fd;
+    int steps;
+    int64_t deadline_ms;
+} step_priv_t;
+
+static int64_t test_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int step_open_step(devproto_transport_t *t)
+{
+    step_priv_t *p = t->priv;
+
+    if (test_now_ms() >= p->deadline_ms) return -1;
+
+    t->fd = p->fd;
+    if (p->steps++ == 0) return DEVPROTO_TRANSPORT_WANT_WRITE;
+
+    uint8_t c;
+    if (recv(t->fd, &c, 1, MSG_DONTWAIT) == 1 && c == 'H') {
+        t->is_open = 1;
+        return 0;
+    }
+    return DEVPROTO_TRANSPORT_WANT_READ;
+}
+
+static int step_recv(devproto_transport_t *t, uint8_t *data, size_t len, int timeout_ms)
+{
+    (void)timeout_ms;
+    ssize_t n = recv(t->fd, data, len, MSG_DONTWAIT);
+    if (n > 0) return (int)n;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    return -1;
+}
+
+static void on_open(devproto_reactor_t *r, devproto_transport_t *t, void *user)
+{
+    (void)r;
+    (void)t;
+    ((conn_state_t *)user)->opened++;
+}
+
+/**
+ * Test opens driven by the reactor, including one that times out
+ */
+void test_reactor_connect(void)
+{
+    TEST("reactor drives non-blocking opens");
+
+    static const devproto_transport_ops_t step_ops = {
+        .open_step = step_open_step,
+        .recv = step_recv
+    };
+
+    int good[2], silent[2];
+    devproto_reactor_t *r = devproto_reactor_create();
+    if (!r || socketpair(AF_UNIX, SOCK_STREAM, 0, good) != 0 ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, silent) != 0) {
+        FAIL("setup failed");
+        return;
+    }
+
+    step_priv_t pg = { good[0], 0, test_now_ms() + 5000 };
+    step_priv_t ps = { silent[0], 0, test_now_ms() + 150 };
+    devproto_transport_t tg = { .ops = &step_ops, .priv = &pg, .fd = -1 };
+    devproto_transport_t tsl = { .ops = &step_ops, .priv = &ps, .fd = -1 };
+    conn_state_t sg, ss;
+    memset(&sg, 0, sizeof(sg));
+    memset(&ss, 0, sizeof(ss));
+
+    if (devproto_reactor_connect(r, &tg, on_open, on_message, on_close, &sg) != 0 ||
+        devproto_reactor_connect(r, &tsl, on_open, on_message, on_close, &ss) != 0 ||
+        devproto_reactor_count(r) != 2 || sg.opened || ss.opened) {
+        FAIL("connect registration failed");
+        devproto_reactor_destroy(r);
+        return;
+    }
+
+    /* Writability step, then the 'handshake' byte and a frame */
+    devproto_reactor_run_once(r, 50);
+    if (write(good[1], "H", 1) != 1) {
+        FAIL("peer write failed");
+        devproto_reactor_destroy(r);
+        return;
+    }
+    devproto_reactor_run_once(r, 50);
+    peer_send(good[1], 7, 16);
+
+    /* The silent peer never answers; the tick sweep must time it out */
+    int64_t start = test_now_ms();
+    while ((sg.messages < 1 || !ss.closed) && test_now_ms() - start < 2000) {
+        devproto_reactor_run_once(r, -1);
+    }
+
+    int ok = sg.opened == 1 && sg.messages == 1 && !sg.closed && !sg.bad_payload &&
+             ss.opened == 0 && ss.closed == 1 && devproto_reactor_count(r) == 1;
+
+    devproto_reactor_destroy(r);
+    close(good[0]);
+    close(good[1]);
+    close(silent[0]);
+    close(silent[1]);
+
+    if (!ok) {
+        printf("(opened %d/%d, msgs %d, closed %d/%d) ", sg.opened, ss.opened,
+               sg.messages, sg.closed, ss.closed);
+        FAIL("wrong open handling");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Reactor Unit Tests ===\n");
+    printf("\n");
+
+    test_reactor_many_connections();
+    test_reactor_connect();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
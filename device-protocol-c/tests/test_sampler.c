@@ -0,0 +1,257 @@
+/**
+ * @file test_sampler.c
+ * @brief Metric sampler unit tests
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "devproto/sampler.h"
+#include "devproto/error.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+/**
+ * Mock sensor: counts reads, returns its counter as the value
+ * A negative fail_after makes every read succeed.
+ */
+typedef struct {
+    int reads;
+    int fail_after;
+} mock_sensor_t;
+
+static int mock_read(devproto_metric_type_t type, float *value, void *user)
+{
+    (void)type;
+    mock_sensor_t *m = user;
+    m->reads++;
+    if (m->fail_after >= 0 && m->reads > m->fail_after) return -1;
+    *value = (float)m->reads;
+    return 0;
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Find a metric in a snapshot; returns its value or -1
+ */
+static float find_metric(const devproto_metric_t *m, int n, devproto_metric_type_t type)
+{
+    for (int i = 0; i < n; i++) {
+        if (m[i].type == type) return m[i].value;
+    }
+    return -1.0f;
+}
+
+void test_sampler_intervals(void)
+{
+    TEST("staggered intervals and cached reads");
+
+    devproto_sampler_t *s = devproto_sampler_create();
+    mock_sensor_t fast = { 0, -1 }, slow = { 0, -1 };
+
+    if (!s ||
+        devproto_sampler_add(s, DEVPROTO_METRIC_CPU_USAGE, 20, mock_read, &fast) != 0 ||
+        devproto_sampler_add(s, DEVPROTO_METRIC_TEMPERATURE, 10000, mock_read, &slow) != 0) {
+        FAIL("setup failed");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    if (devproto_sampler_add(s, DEVPROTO_METRIC_CPU_USAGE, 5, mock_read, &fast) == 0) {
+        FAIL("duplicate metric accepted");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    devproto_metric_t m[8];
+    if (devproto_sampler_snapshot(s, m, 8) != 0) {
+        FAIL("snapshot before refresh not empty");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    /* First refresh reads everything */
+    if (devproto_sampler_refresh(s) != 2 || devproto_sampler_refresh(s) != 0) {
+        FAIL("first refresh count wrong");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    if (devproto_sampler_add(s, DEVPROTO_METRIC_FAN_SPEED, 5, mock_read, &fast) !=
+        DEVPROTO_ERR_BUSY) {
+        FAIL("add after start not rejected");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    /* Snapshot reads never touch the sensors */
+    for (int i = 0; i < 100; i++) devproto_sampler_snapshot(s, m, 8);
+    if (fast.reads != 1 || slow.reads != 1) {
+        FAIL("snapshot triggered reads");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    int wait = devproto_sampler_next_timeout(s);
+    if (wait < 0 || wait > 20) {
+        FAIL("next timeout wrong");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    sleep_ms(30);
+    if (devproto_sampler_refresh(s) != 1 || fast.reads != 2 || slow.reads != 1) {
+        FAIL("only the fast sensor should refresh");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    int n = devproto_sampler_snapshot(s, m, 8);
+    if (n != 2 || find_metric(m, n, DEVPROTO_METRIC_CPU_USAGE) != 2.0f ||
+        find_metric(m, n, DEVPROTO_METRIC_TEMPERATURE) != 1.0f) {
+        FAIL("snapshot values wrong");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    devproto_sampler_destroy(s);
+    PASS();
+}
+
+void test_sampler_build(void)
+{
+    TEST("build payload and failed reads");
+
+    devproto_sampler_t *s = devproto_sampler_create();
+    mock_sensor_t good = { 0, 1 }, broken = { 0, 0 };
+
+    if (!s ||
+        devproto_sampler_add(s, DEVPROTO_METRIC_FAN_SPEED, 10, mock_read, &good) != 0 ||
+        devproto_sampler_add(s, DEVPROTO_METRIC_VOLTAGE, 10, mock_read, &broken) != 0 ||
+        devproto_sampler_refresh(s) != 2) {
+        FAIL("setup failed");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    /* Second read of the good sensor fails: the old value must survive */
+    sleep_ms(20);
+    devproto_sampler_refresh(s);
+
+    uint8_t payload[64];
+    int len = devproto_sampler_build(s, payload, sizeof(payload));
+    if (len != 5) {
+        FAIL("never-read metric not omitted");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    devproto_metric_t m[4];
+    int n = devproto_metrics_parse(payload, (size_t)len, m, 4);
+    if (n != 1 || m[0].type != DEVPROTO_METRIC_FAN_SPEED || m[0].value != 1.0f) {
+        FAIL("payload does not round-trip");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    if (devproto_sampler_build(s, payload, 4) != -1) {
+        FAIL("short buffer accepted");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    devproto_sampler_destroy(s);
+    PASS();
+}
+
+/**
+ * Reader thread for the background test: checks every snapshot is consistent
+ */
+typedef struct {
+    devproto_sampler_t *s;
+    atomic_int stop;
+    int torn;
+    int snapshots;
+} snapshot_reader_t;
+
+static void *snapshot_thread(void *arg)
+{
+    snapshot_reader_t *r = arg;
+    devproto_metric_t m[8];
+
+    while (!atomic_load(&r->stop)) {
+        int n = devproto_sampler_snapshot(r->s, m, 8);
+        /* Both sensors advance together, so they must match in a snapshot */
+        if (n == 2 && m[0].value != m[1].value) r->torn++;
+        r->snapshots++;
+    }
+    return NULL;
+}
+
+void test_sampler_background(void)
+{
+    TEST("background thread with concurrent readers");
+
+    devproto_sampler_t *s = devproto_sampler_create();
+    mock_sensor_t a = { 0, -1 }, b = { 0, -1 };
+
+    if (!s ||
+        devproto_sampler_add(s, DEVPROTO_METRIC_CPU_USAGE, 1, mock_read, &a) != 0 ||
+        devproto_sampler_add(s, DEVPROTO_METRIC_MEMORY_USAGE, 1, mock_read, &b) != 0 ||
+        devproto_sampler_start(s) != 0) {
+        FAIL("setup failed");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    snapshot_reader_t reader = { .s = s };
+    pthread_t tid;
+    pthread_create(&tid, NULL, snapshot_thread, &reader);
+
+    sleep_ms(100);
+    atomic_store(&reader.stop, 1);
+    pthread_join(tid, NULL);
+    devproto_sampler_stop(s);
+
+    if (a.reads < 10 || reader.snapshots == 0) {
+        FAIL("background thread not refreshing");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    if (reader.torn != 0) {
+        FAIL("torn snapshot observed");
+        devproto_sampler_destroy(s);
+        return;
+    }
+
+    devproto_sampler_destroy(s);
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Sampler Unit Tests ===\n");
+    printf("\n");
+
+    test_sampler_intervals();
+    test_sampler_build();
+    test_sampler_background();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file test_send.c
+ * @brief Single/batched send unit tests (mock transport)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "devproto/send.h"
+#include "devproto/frame.h"
+#include "devproto/transport.h"
+#include "mock_transport.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+/**
+ * Build a typical poll cycle: PING, REQUEST_METRICS, GET_STATUS
+ */
+static void build_poll_cycle(devproto_message_t *msgs)
+{
+    static const uint8_t types[] = {0x01, 0x03, 0x20};
+
+    devproto_create_ping(&msgs[0], 1);
+    devproto_create_metrics_request(&msgs[1], 2, types, sizeof(types));
+    devproto_create_status_request(&msgs[2], 3);
+}
+
+/**
+ * Test a poll cycle goes out in a single sendv call
+ */
+void test_batch_single_call(void)
+{
+    TEST("batch coalesces into one sendv");
+
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops_sendv);
+    devproto_message_t msgs[3];
+    build_poll_cycle(msgs);
+
+    mock_reset();
+    int results[3] = {-2, -2, -2};
+    int sent = devproto_send_batch(&t, msgs, 3, results);
+
+    devproto_message_t out[4];
+    if (sent != 3 || mock_calls != 1 || results[0] || results[1] || results[2] ||
+        mock_wire_frames(out, 4) != 3 || out[1].msg_type != DEVPROTO_MSG_REQUEST_METRICS) {
+        FAIL("expected 3 frames in one call");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test fallback without sendv packs frames into one send
+ */
+void test_batch_fallback_send(void)
+{
+    TEST("batch fallback packs into one send");
+
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops);
+    devproto_message_t msgs[3];
+    build_poll_cycle(msgs);
+
+    mock_reset();
+    int sent = devproto_send_batch(&t, msgs, 3, NULL);
+
+    devproto_message_t out[4];
+    if (sent != 3 || mock_calls != 1 || mock_wire_frames(out, 4) != 3) {
+        FAIL("expected 3 frames in one send");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test partial writes are resumed and invalid messages reported
+ */
+void test_batch_partial_and_invalid(void)
+{
+    TEST("batch resumes partial writes");
+
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops_sendv);
+    uint8_t payload[600];
+    memset(payload, 0x77, sizeof(payload));
+
+    devproto_message_t msgs[4];
+    build_poll_cycle(msgs);
+    msgs[3] = msgs[2];
+    msgs[2].msg_type = DEVPROTO_MSG_UPDATE_FIRMWARE;
+    msgs[2].payload = payload;
+    msgs[2].payload_len = sizeof(payload);
+    msgs[1].payload_len = DEVPROTO_MAX_PAYLOAD_SIZE + 1;   /* Invalid */
+
+    mock_reset();
+    mock_chunk = 100;
+    int results[4];
+    int sent = devproto_send_batch(&t, msgs, 4, results);
+
+    devproto_message_t out[4];
+    if (sent != 3 || results[0] != 0 || results[1] != -1 ||
+        results[2] != 0 || results[3] != 0 || mock_calls < 6 ||
+        mock_wire_frames(out, 4) != 3 || out[1].payload_len != sizeof(payload)) {
+        FAIL("partial writes not resumed");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test transport failure marks cut and unsent frames as failed
+ */
+void test_batch_transport_error(void)
+{
+    TEST("batch reports frames lost to error");
+
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops_sendv);
+    devproto_message_t msgs[20];
+    for (int i = 0; i < 20; i++) {
+        devproto_create_ping(&msgs[i], (uint8_t)i);
+    }
+
+    /* Two and a half PING frames (8 bytes each) fit before the link dies */
+    mock_reset();
+    mock_limit = 20;
+    int results[20];
+    int sent = devproto_send_batch(&t, msgs, 20, results);
+
+    if (sent != 2 || results[0] || results[1] || results[2] != -1 || results[19] != -1) {
+        FAIL("wrong per-message results");
+        return;
+    }
+
+    if (devproto_send_message(&t, &msgs[0]) != -1) {
+        FAIL("send on dead link should fail");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test jumbo payloads go out only once the link's limit is raised
+ */
+void test_send_jumbo(void)
+{
+    TEST("jumbo frames need a negotiated limit");
+
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops_sendv);
+    static uint8_t payload[12000];
+    memset(payload, 0x3C, sizeof(payload));
+
+    devproto_message_t msg = {
+        .msg_type = DEVPROTO_MSG_UPDATE_FIRMWARE, .sequence = 4,
+        .payload_len = sizeof(payload), .payload = payload
+    };
+
+    mock_reset();
+    if (devproto_send_message(&t, &msg) != -1 || mock_wire_len != 0 ||
+        devproto_transport_max_payload(&t) != DEVPROTO_MAX_PAYLOAD_SIZE) {
+        FAIL("jumbo sent on a legacy link");
+        return;
+    }
+
+    if (devproto_transport_set_max_payload(&t, DEVPROTO_MAX_PAYLOAD_SIZE - 1) != -1 ||
+        devproto_transport_set_max_payload(&t, DEVPROTO_JUMBO_MAX_PAYLOAD) != 0 ||
+        devproto_send_message(&t, &msg) != 0) {
+        FAIL("jumbo send after negotiation");
+        return;
+    }
+
+    devproto_frame_pool_t *pool = devproto_frame_pool_create(0);
+    devproto_frame_pooled_parser_t *parser = devproto_frame_pooled_create(pool);
+    devproto_frame_pooled_set_max_payload(parser, DEVPROTO_JUMBO_MAX_PAYLOAD);
+
+    devproto_message_t out;
+    int count = devproto_frame_pooled_parse(parser, mock_wire, mock_wire_len, &out, 1);
+    if (mock_wire_len != DEVPROTO_JUMBO_HEADER_SIZE + sizeof(payload) + DEVPROTO_CRC_SIZE ||
+        count != 1 || out.payload_len != sizeof(payload) ||
+        memcmp(out.payload, payload, sizeof(payload)) != 0) {
+        FAIL("jumbo frame not received");
+        return;
+    }
+
+    devproto_frame_pooled_destroy(parser);
+    devproto_frame_pool_destroy(pool);
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Send Unit Tests ===\n");
+    printf("\n");
+
+    test_batch_single_call();
+    test_batch_fallback_send();
+    test_batch_partial_and_invalid();
+    test_batch_transport_error();
+    test_send_jumbo();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
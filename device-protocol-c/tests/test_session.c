@@ -0,0 +1,305 @@
+/**
+ * @file test_session.c
+ * @brief Request/response correlation unit tests (mock transport)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "devproto/session.h"
+#include "devproto/frame.h"
+#include "devproto/error.h"
+#include "mock_transport.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static devproto_transport_t mock_transport = MOCK_TRANSPORT(&mock_ops);
+
+/**
+ * Completion recorder
+ */
+typedef struct {
+    int calls;
+    int status;
+    uint8_t type;
+    int order;
+} completion_t;
+
+static int completion_order;
+
+static void on_response(devproto_session_t *s, int status,
+                        const devproto_message_t *resp, void *user)
+{
+    (void)s;
+    completion_t *c = user;
+    c->calls++;
+    c->status = status;
+    c->type = resp ? resp->msg_type : 0;
+    c->order = completion_order++;
+}
+
+static int events_seen;
+
+static void on_event(devproto_session_t *s, const devproto_message_t *ev, void *user)
+{
+    (void)s;
+    (void)user;
+    if (ev->msg_type == DEVPROTO_MSG_ALERT_EVENT) events_seen++;
+}
+
+/**
+ * Test out-of-order responses and events interleaved with them
+ */
+void test_session_out_of_order(void)
+{
+    TEST("out-of-order matching and event routing");
+
+    devproto_session_t *s = devproto_session_create(&mock_transport, 8);
+    devproto_session_set_event_handler(s, on_event, NULL);
+    events_seen = 0;
+    completion_order = 0;
+
+    completion_t c[3] = {{0}};
+    devproto_message_t ping, status, metrics;
+    devproto_create_ping(&ping, 0);
+    devproto_create_status_request(&status, 0);
+    devproto_create_metrics_request(&metrics, 0, NULL, 0);
+
+    int s0 = devproto_session_request(s, &ping, 1000, on_response, &c[0]);
+    int s1 = devproto_session_request(s, &status, 1000, on_response, &c[1]);
+    int s2 = devproto_session_request(s, &metrics, 1000, on_response, &c[2]);
+
+    if (s0 < 0 || s1 < 0 || s2 < 0 || s0 == s1 || s1 == s2 ||
+        devproto_session_inflight(s) != 3 || mock_calls != 3) {
+        FAIL("requests not issued");
+        devproto_session_destroy(s);
+        return;
+    }
+
+    /* Wrong type for a live sequence must not complete it */
+    devproto_message_t bogus = { .msg_type = DEVPROTO_MSG_PONG, .sequence = (uint8_t)s1 };
+    if (devproto_session_on_message(s, &bogus) != 0) {
+        FAIL("mismatched type completed a request");
+        devproto_session_destroy(s);
+        return;
+    }
+
+    mock_queue(DEVPROTO_MSG_METRICS_RESPONSE, (uint8_t)s2);
+    mock_queue(DEVPROTO_MSG_ALERT_EVENT, 0);
+    mock_queue(DEVPROTO_MSG_PONG, (uint8_t)s0);
+    mock_queue(DEVPROTO_MSG_STATUS_RESPONSE, (uint8_t)s1);
+
+    int done = devproto_session_process(s, 100);
+
+    devproto_session_stats_t st;
+    devproto_session_get_stats(s, &st);
+
+    if (done != 3 || c[2].order != 0 || c[0].order != 1 || c[1].order != 2 ||
+        c[0].status != DEVPROTO_OK || c[1].type != DEVPROTO_MSG_STATUS_RESPONSE ||
+        events_seen != 1 || st.unmatched != 1 || devproto_session_inflight(s) != 0) {
+        FAIL("responses not matched to their requests");
+        devproto_session_destroy(s);
+        return;
+    }
+
+    devproto_session_destroy(s);
+    PASS();
+}
+
+/**
+ * Test window limit and ERR_CLOSED on destroy
+ */
+void test_session_window(void)
+{
+    TEST("window limit and close");
+
+    devproto_session_t *s = devproto_session_create(&mock_transport, 4);
+    completion_t c[5] = {{0}};
+    devproto_message_t ping;
+
+    for (int i = 0; i < 4; i++) {
+        devproto_create_ping(&ping, 0);
+        if (devproto_session_request(s, &ping, 1000, on_response, &c[i]) < 0) {
+            FAIL("request within window rejected");
+            devproto_session_destroy(s);
+            return;
+        }
+    }
+
+    devproto_create_ping(&ping, 0);
+    if (devproto_session_request(s, &ping, 1000, on_response, &c[4]) != DEVPROTO_ERR_BUSY) {
+        FAIL("request beyond window accepted");
+        devproto_session_destroy(s);
+        return;
+    }
+
+    devproto_session_destroy(s);
+
+    for (int i = 0; i < 4; i++) {
+        if (c[i].calls != 1 || c[i].status != DEVPROTO_ERR_CLOSED) {
+            FAIL("pending request not closed");
+            return;
+        }
+    }
+    if (c[4].calls != 0) {
+        FAIL("rejected request was completed");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test deadline expiry and quarantine of the timed-out sequence
+ */
+void test_session_timeout(void)
+{
+    TEST("deadline expiry and late reply quarantine");
+
+    devproto_session_t *s = devproto_session_create(&mock_transport, 4);
+    completion_t slow = {0};
+    devproto_message_t ping;
+    devproto_create_ping(&ping, 0);
+
+    int seq = devproto_session_request(s, &ping, 20, on_response, &slow);
+    int wait = devproto_session_next_timeout(s);
+    if (seq < 0 || wait < 0 || wait > 20) {
+        FAIL("deadline not reported");
+        devproto_session_destroy(s);
+        return;
+    }
+
+    /* process() waits no longer than the deadline */
+    int done = devproto_session_process(s, 1000);
+    if (done != 1 || slow.calls != 1 || slow.status != DEVPROTO_ERR_TIMEOUT ||
+        devproto_session_next_timeout(s) != -1) {
+        FAIL("request did not time out");
+        devproto_session_destroy(s);
+        return;
+    }
+
+    /* Run the counter all the way round: the quarantined number is skipped */
+    completion_t c = {0};
+    for (int i = 0; i < 300; i++) {
+        devproto_create_ping(&ping, 0);
+        int n = devproto_session_request(s, &ping, 1000, on_response, &c);
+        if (n == seq) {
+            FAIL("quarantined sequence reused");
+            devproto_session_destroy(s);
+            return;
+        }
+        devproto_message_t pong = { .msg_type = DEVPROTO_MSG_PONG, .sequence = (uint8_t)n };
+        devproto_session_on_message(s, &pong);
+    }
+
+    /* The late reply is swallowed, not delivered to anyone */
+    devproto_message_t late = { .msg_type = DEVPROTO_MSG_PONG, .sequence = (uint8_t)seq };
+    if (devproto_session_on_message(s, &late) != 0 || c.calls != 300 || slow.calls != 1) {
+        FAIL("late reply delivered");
+        devproto_session_destroy(s);
+        return;
+    }
+
+    devproto_session_destroy(s);
+    PASS();
+}
+
+/**
+ * Test async requests beyond the window: FIFO sending, queued deadlines, close
+ */
+void test_session_async_queue(void)
+{
+    TEST("async requests queue past the window");
+
+    devproto_session_t *s = devproto_session_create(&mock_transport, 2);
+    completion_order = 0;
+    mock_reset();
+
+    uint8_t big[200];
+    memset(big, 0x5A, sizeof(big));
+    completion_t c[9] = {{0}};
+    int64_t later = devproto_session_clock_ms() + 1000;
+    int ok = 1;
+
+    /* Six pings, the fourth with a payload too big for the inline record */
+    for (int i = 0; i < 6; i++) {
+        devproto_message_t ping = { .msg_type = DEVPROTO_MSG_PING };
+        if (i == 3) {
+            ping.payload = big;
+            ping.payload_len = sizeof(big);
+        }
+        if (devproto_session_request_async(s, &ping, later, on_response, &c[i]) != 0) ok = 0;
+    }
+
+    devproto_session_stats_t st;
+    devproto_session_get_stats(s, &st);
+    if (mock_calls != 2 || devproto_session_inflight(s) != 2 ||
+        devproto_session_queued(s) != 4 || st.deferred != 4) {
+        ok = 0;
+    }
+
+    /* Answer in send order: each reply releases the next queued request */
+    for (int i = 0; i < 6 && ok; i++) {
+        devproto_message_t pong = { .msg_type = DEVPROTO_MSG_PONG, .sequence = mock_seqs[i] };
+        if (devproto_session_on_message(s, &pong) != 1) ok = 0;
+    }
+    if (mock_calls != 6 || mock_lens[3] != DEVPROTO_MIN_FRAME_SIZE + sizeof(big)) ok = 0;
+    for (int i = 0; i < 6; i++) {
+        if (c[i].calls != 1 || c[i].status != DEVPROTO_OK || c[i].order != i) ok = 0;
+    }
+
+    /* A queued request times out on its own deadline without being sent */
+    devproto_message_t ping = { .msg_type = DEVPROTO_MSG_PING };
+    devproto_session_request_async(s, &ping, later, on_response, &c[6]);
+    devproto_session_request_async(s, &ping, later, on_response, &c[7]);
+    devproto_session_request_async(s, &ping, devproto_session_clock_ms() + 20,
+                                   on_response, &c[8]);
+    int wait = devproto_session_next_timeout(s);
+    if (wait < 0 || wait > 20) ok = 0;
+
+    struct timespec ts = { 0, 30 * 1000000L };
+    nanosleep(&ts, NULL);
+    if (devproto_session_expire(s) != 1 || c[8].status != DEVPROTO_ERR_TIMEOUT ||
+        mock_calls != 8 || devproto_session_queued(s) != 0) {
+        ok = 0;
+    }
+
+    if (devproto_session_request_async(s, &ping, devproto_session_clock_ms() - 1,
+                                       on_response, &c[8]) != DEVPROTO_ERR_TIMEOUT) {
+        ok = 0;
+    }
+
+    devproto_session_destroy(s);
+    if (c[6].status != DEVPROTO_ERR_CLOSED || c[7].status != DEVPROTO_ERR_CLOSED ||
+        c[8].calls != 1) {
+        ok = 0;
+    }
+
+    if (!ok) {
+        FAIL("queued requests not sent in order or not completed once");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Session Unit Tests ===\n");
+    printf("\n");
+
+    test_session_out_of_order();
+    test_session_window();
+    test_session_timeout();
+    test_session_async_queue();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
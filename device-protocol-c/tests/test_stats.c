@@ -0,0 +1,291 @@
+/**
+ * @file test_stats.c
+ * @brief Telemetry unit tests (mock transport)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "devproto/stats.h"
+#include "devproto/session.h"
+#include "devproto/send.h"
+#include "devproto/frame.h"
+#include "devproto/error.h"
+#include "mock_transport.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+void test_stats_buckets(void)
+{
+    TEST("histogram buckets and quantiles");
+
+    for (size_t i = 1; i < DEVPROTO_STATS_HIST_BUCKETS; i++) {
+        if (devproto_stats_bucket_lower(i) <= devproto_stats_bucket_lower(i - 1)) {
+            FAIL("bucket bounds not increasing");
+            return;
+        }
+    }
+    if (devproto_stats_bucket_lower(4) != 4 || devproto_stats_bucket_lower(8) != 8 ||
+        devproto_stats_bucket_lower(9) != 10 ||
+        devproto_stats_bucket_lower(DEVPROTO_STATS_HIST_BUCKETS - 1) != 0xE0000000u) {
+        FAIL("bucket bounds");
+        return;
+    }
+
+    /* 1..1000 us on one request type */
+    devproto_stats_t *st = devproto_stats_create();
+    for (uint32_t v = 1; v <= 1000; v++) {
+        devproto_stats_record_rtt(st, DEVPROTO_MSG_PING, v);
+    }
+    devproto_stats_record_rtt(st, 0x42, 5000000000ull);
+
+    static devproto_stats_snapshot_t snap;
+    devproto_stats_snapshot(st, &snap);
+    const devproto_stats_hist_t *h = &snap.rtt_us[DEVPROTO_MSG_PING];
+
+    uint32_t p50 = devproto_stats_hist_quantile(h, 0.5);
+    uint32_t p99 = devproto_stats_hist_quantile(h, 0.99);
+    if (h->count != 1000 || h->sum != 500500 || h->min != 1 || h->max != 1000 ||
+        p50 < 500 || p50 > 500 * 5 / 4 || p99 < 990 || p99 > 1000 ||
+        devproto_stats_hist_quantile(h, 0.0) != 1) {
+        FAIL("histogram values");
+        return;
+    }
+
+    /* Unknown types share slot 0; huge values clamp */
+    if (snap.rtt_us[0].count != 1 || snap.rtt_us[0].max != UINT32_MAX ||
+        snap.rtt_us[DEVPROTO_MSG_REBOOT].count != 0) {
+        FAIL("slot 0 / clamping");
+        return;
+    }
+
+    devproto_stats_destroy(st);
+    PASS();
+}
+
+void test_stats_transport(void)
+{
+    TEST("transport call counters");
+
+    devproto_stats_t *st = devproto_stats_create();
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops);
+    devproto_transport_set_stats(&t, st);
+
+    devproto_message_t ping;
+    devproto_create_ping(&ping, 1);
+
+    mock_reset();
+    devproto_send_message(&t, &ping);           /* Whole frame */
+    mock_chunk = 3;
+    devproto_send_message(&t, &ping);           /* Partial writes, retried */
+    mock_limit = 0;
+    devproto_send_message(&t, &ping);           /* EAGAIN */
+    mock_reset();
+
+    uint8_t buf[64];
+    mock_queue(DEVPROTO_MSG_PONG, 1);
+    int got = devproto_transport_recv(&t, buf, sizeof(buf), 0);
+    devproto_transport_recv(&t, buf, sizeof(buf), 0);
+
+    devproto_stats_snapshot_t snap;
+    devproto_stats_snapshot(st, &snap);
+    size_t frame = DEVPROTO_HEADER_SIZE + DEVPROTO_CRC_SIZE;
+    if (snap.send_calls != 1 + (frame + 2) / 3 + 1 || snap.frames_out != 2 ||
+        snap.tx_partial != (frame + 2) / 3 - 1 ||
+        snap.tx_eagain != 1 || snap.bytes_out != 2 * frame || snap.io_errors != 0) {
+        FAIL("send counters");
+        return;
+    }
+    if (snap.recv_calls != 2 || snap.rx_empty != 1 || snap.bytes_in != (uint64_t)got) {
+        FAIL("receive counters");
+        return;
+    }
+
+    devproto_transport_set_stats(&t, NULL);
+    devproto_send_message(&t, &ping);
+    devproto_stats_snapshot(st, &snap);
+    if (snap.frames_out != 2) {
+        FAIL("detached transport still recorded");
+        return;
+    }
+
+    devproto_stats_destroy(st);
+    PASS();
+}
+
+static void on_response(devproto_session_t *s, int status,
+                        const devproto_message_t *resp, void *user)
+{
+    (void)s;
+    (void)resp;
+    *(int *)user = status;
+}
+
+void test_stats_session(void)
+{
+    TEST("session RTT, parse cost and errors");
+
+    devproto_stats_t *st = devproto_stats_create();
+    devproto_transport_t t = MOCK_TRANSPORT(&mock_ops);
+    devproto_transport_set_stats(&t, st);
+    devproto_session_t *s = devproto_session_create(&t, 4);
+
+    int status = 1, late = 1;
+    devproto_message_t ping;
+    devproto_create_ping(&ping, 0);
+    int seq = devproto_session_request(s, &ping, 1000, on_response, &status);
+    devproto_create_ping(&ping, 0);
+    devproto_session_request(s, &ping, 1, on_response, &late);
+
+    /* Reply to the first, a damaged frame, and let the second expire */
+    mock_reset();
+    mock_queue(DEVPROTO_MSG_PONG, (uint8_t)seq);
+    mock_queue(DEVPROTO_MSG_PONG, 0x77);
+    mock_rx[mock_rx_len - 1] ^= 0xFF;
+
+    struct timespec ts = { 0, 5 * 1000000L };
+    nanosleep(&ts, NULL);
+    devproto_session_process(s, 0);
+
+    devproto_stats_snapshot_t snap;
+    devproto_stats_snapshot(st, &snap);
+    const devproto_stats_hist_t *rtt = &snap.rtt_us[DEVPROTO_MSG_PING];
+    if (status != DEVPROTO_OK || late != DEVPROTO_ERR_TIMEOUT ||
+        rtt->count != 1 || snap.timeouts != 1) {
+        FAIL("RTT or timeout not recorded");
+        return;
+    }
+    if (snap.frames_in != 1 || snap.crc_errors != 1 || snap.parse_cycles.count != 1) {
+        FAIL("parse counters");
+        return;
+    }
+
+    devproto_session_destroy(s);
+    devproto_stats_destroy(st);
+    PASS();
+}
+
+void test_stats_export(void)
+{
+    TEST("Prometheus and JSON export");
+
+    devproto_stats_t *st = devproto_stats_create();
+    devproto_stats_record_send(st, 10, 10);
+    devproto_stats_record_frames_out(st, 1);
+    devproto_stats_record_rtt(st, DEVPROTO_MSG_GET_STATUS, 1500);
+    devproto_stats_record_parse(st, 2, 900, 0, 3);
+
+    static devproto_stats_snapshot_t snaps[2];
+    devproto_stats_snapshot(st, &snaps[0]);
+    devproto_stats_snapshot(NULL, &snaps[1]);
+    const char *names[2] = { "edge-1", "tty\"2" };
+
+    static char buf[16384];
+    int n = devproto_stats_format_prometheus(snaps, names, 2, buf, sizeof(buf));
+    if (n <= 0 || (size_t)n != strlen(buf) ||
+        !strstr(buf, "# TYPE devproto_bytes_total counter\n") ||
+        !strstr(buf, "devproto_bytes_total{conn=\"edge-1\",dir=\"out\"} 10\n") ||
+        !strstr(buf, "devproto_frames_total{conn=\"tty\\\"2\",dir=\"out\"} 0\n") ||
+        !strstr(buf, "devproto_sync_errors_total{conn=\"edge-1\"} 3\n") ||
+        !strstr(buf, "devproto_request_rtt_microseconds_bucket{conn=\"edge-1\",type=\"0x05\",le=\"1023\"} 0\n") ||
+        !strstr(buf, "devproto_request_rtt_microseconds_bucket{conn=\"edge-1\",type=\"0x05\",le=\"2047\"} 1\n") ||
+        !strstr(buf, "devproto_request_rtt_microseconds_count{conn=\"edge-1\",type=\"0x05\"} 1\n") ||
+        !strstr(buf, "devproto_parse_cycles_count{conn=\"edge-1\"} 2\n") ||
+        !strstr(buf, "devproto_parse_cycles_bucket{conn=\"tty\\\"2\",le=\"+Inf\"} 0\n") ||
+        strstr(buf, "devproto_request_rtt_microseconds_count{conn=\"tty")) {
+        FAIL("Prometheus output");
+        printf("%s", buf);
+        return;
+    }
+
+    n = devproto_stats_format_json(snaps, names, 2, buf, sizeof(buf));
+    if (n <= 0 || buf[0] != '{' ||
+        !strstr(buf, "{\"conn\":\"edge-1\",\"bytes_in\":0,\"bytes_out\":10,") ||
+        !strstr(buf, "\"rtt_us\":{\"0x05\":{\"count\":1,\"sum\":1500,\"min\":1500,\"max\":1500") ||
+        !strstr(buf, "\"buckets\":[[1280,1]]") ||
+        !strstr(buf, "\"conn\":\"tty\\\"2\"") ||
+        !strstr(buf, "\"rtt_us\":{}}]}")) {
+        FAIL("JSON output");
+        printf("%s", buf);
+        return;
+    }
+
+    if (devproto_stats_format_prometheus(snaps, names, 2, buf, 64) != -1 ||
+        devproto_stats_format_json(snaps, names, 2, buf, 64) != -1) {
+        FAIL("small buffer accepted");
+        return;
+    }
+
+    devproto_stats_destroy(st);
+    PASS();
+}
+
+/**
+ * Writer thread for the snapshot consistency test
+ */
+static void *stats_writer(void *arg)
+{
+    devproto_stats_t *st = arg;
+    for (int i = 0; i < 200000; i++) {
+        devproto_stats_record_send(st, 0x10000000u, 0x10000000);
+        devproto_stats_record_rtt(st, DEVPROTO_MSG_PING, (uint32_t)i);
+    }
+    return NULL;
+}
+
+void test_stats_concurrent_snapshot(void)
+{
+    TEST("snapshots stay consistent during updates");
+
+    devproto_stats_t *st = devproto_stats_create();
+    pthread_t writer;
+    pthread_create(&writer, NULL, stats_writer, st);
+
+    static devproto_stats_snapshot_t snap;
+    int torn = 0;
+    for (int i = 0; i < 2000 && !torn; i++) {
+        devproto_stats_snapshot(st, &snap);
+
+        /* bytes_out crosses 2^32 every 16 sends, so the halves must agree */
+        const devproto_stats_hist_t *h = &snap.rtt_us[DEVPROTO_MSG_PING];
+        uint64_t buckets = 0;
+        for (size_t b = 0; b < DEVPROTO_STATS_HIST_BUCKETS; b++) buckets += h->buckets[b];
+        if (snap.bytes_out != snap.send_calls * 0x10000000u || buckets != h->count ||
+            h->count + 1 < snap.send_calls || h->count > snap.send_calls) {
+            torn = 1;
+        }
+    }
+
+    pthread_join(writer, NULL);
+    devproto_stats_snapshot(st, &snap);
+    if (torn || snap.send_calls != 200000 || snap.bytes_out != 200000ull * 0x10000000u) {
+        FAIL("torn snapshot");
+        return;
+    }
+
+    devproto_stats_destroy(st);
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Stats Unit Tests ===\n");
+    printf("\n");
+
+    test_stats_buckets();
+    test_stats_transport();
+    test_stats_session();
+    test_stats_export();
+    test_stats_concurrent_snapshot();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file test_subscription.c
+ * @brief Metric subscription unit tests (mock transport)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "devproto/subscription.h"
+#include "devproto/frame.h"
+#include "mock_transport.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static devproto_transport_t mock_transport = MOCK_TRANSPORT(&mock_ops);
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Subscribe helper; returns the ack status byte or -1
+ */
+static int subscribe(devproto_sub_manager_t *mgr, uint8_t id, uint32_t period,
+                     uint16_t holdoff, const devproto_metric_t *set, size_t n)
+{
+    uint8_t payload[512], ack_buf[DEVPROTO_SUB_ACK_SIZE];
+    int len = devproto_subscribe_build(id, period, holdoff, set, n, payload, sizeof(payload));
+    if (len < 0) return -1;
+
+    devproto_message_t req = {
+        .msg_type = DEVPROTO_MSG_SUBSCRIBE, .sequence = 9,
+        .payload = payload, .payload_len = (uint16_t)len
+    };
+    devproto_message_t ack;
+    devproto_sub_handle(mgr, &req, &ack, ack_buf);
+
+    if (ack.msg_type != DEVPROTO_MSG_SUBSCRIBE_ACK || ack.sequence != 9 ||
+        ack.payload_len != DEVPROTO_SUB_ACK_SIZE || ack.payload[1] != id) {
+        return -1;
+    }
+    return ack.payload[0];
+}
+
+/**
+ * Test periodic push carries every subscribed metric
+ */
+void test_sub_periodic(void)
+{
+    TEST("periodic push");
+
+    devproto_sub_manager_t *mgr = devproto_sub_create();
+    devproto_metric_t set[2] = {
+        { DEVPROTO_METRIC_TEMPERATURE, 0.5f },
+        { DEVPROTO_METRIC_CPU_USAGE, 5.0f }
+    };
+    devproto_metric_t sample[3] = {
+        { DEVPROTO_METRIC_TEMPERATURE, 55.0f },
+        { DEVPROTO_METRIC_CPU_USAGE, 20.0f },
+        { DEVPROTO_METRIC_FAN_SPEED, 3000.0f }      /* Not subscribed */
+    };
+
+    if (subscribe(mgr, 1, 30, 0, set, 2) != DEVPROTO_SUB_STATUS_OK ||
+        devproto_sub_count(mgr) != 1) {
+        FAIL("subscribe rejected");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    mock_reset();
+    devproto_sub_update(mgr, sample, 3);
+
+    /* First report is immediate, then nothing until the period elapses */
+    int first = devproto_sub_poll(mgr, &mock_transport);
+    int second = devproto_sub_poll(mgr, &mock_transport);
+    int wait = devproto_sub_next_timeout(mgr);
+
+    devproto_message_t msgs[4];
+    devproto_metric_t out[4];
+    uint8_t sub_id = 0;
+    int frames = mock_wire_frames(msgs, 4);
+    int count = frames == 1 ? devproto_metrics_event_parse(&msgs[0], &sub_id, out, 4) : -1;
+
+    if (first != 1 || second != 0 || wait <= 0 || wait > 30 || count != 2 || sub_id != 1 ||
+        msgs[0].msg_type != DEVPROTO_MSG_METRICS_EVENT || out[0].value != 55.0f) {
+        FAIL("first report wrong");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    sleep_ms(35);
+    mock_reset();
+    if (devproto_sub_poll(mgr, &mock_transport) != 1 || mock_wire_frames(msgs, 4) != 1 ||
+        devproto_metrics_event_parse(&msgs[0], &sub_id, out, 4) != 2) {
+        FAIL("periodic report missing");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    devproto_sub_destroy(mgr);
+    PASS();
+}
+
+/**
+ * Test deadband filtering and change coalescing
+ */
+void test_sub_deadband(void)
+{
+    TEST("deadband and coalescing");
+
+    devproto_sub_manager_t *mgr = devproto_sub_create();
+    devproto_metric_t set[2] = {
+        { DEVPROTO_METRIC_TEMPERATURE, 1.0f },
+        { DEVPROTO_METRIC_DOOR_STATUS, 0.0f }
+    };
+    devproto_metric_t s[2] = {
+        { DEVPROTO_METRIC_TEMPERATURE, 50.0f },
+        { DEVPROTO_METRIC_DOOR_STATUS, 0.0f }
+    };
+
+    /* Change-only subscription with a 40 ms holdoff */
+    subscribe(mgr, 2, 0, 40, set, 2);
+    devproto_sub_update(mgr, s, 2);
+    mock_reset();
+    int initial = devproto_sub_poll(mgr, &mock_transport);
+
+    /* Within deadband: nothing to do */
+    s[0].value = 50.8f;
+    devproto_sub_update(mgr, s, 2);
+    int quiet = devproto_sub_poll(mgr, &mock_transport);
+    int idle = devproto_sub_next_timeout(mgr);
+
+    /* Two changes inside the holdoff window coalesce into one frame */
+    s[0].value = 52.0f;
+    devproto_sub_update(mgr, s, 2);
+    s[1].value = 1.0f;
+    devproto_sub_update(mgr, s, 2);
+    int early = devproto_sub_poll(mgr, &mock_transport);
+
+    if (initial != 1 || quiet != 0 || idle != -1 || early != 0 ||
+        devproto_sub_next_timeout(mgr) <= 0) {
+        FAIL("deadband/holdoff not applied");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    sleep_ms(45);
+    mock_reset();
+    devproto_message_t msgs[4];
+    devproto_metric_t out[4];
+    uint8_t sub_id;
+    if (devproto_sub_poll(mgr, &mock_transport) != 1 || mock_wire_frames(msgs, 4) != 1 ||
+        devproto_metrics_event_parse(&msgs[0], &sub_id, out, 4) != 2 ||
+        out[0].value != 52.0f || out[1].value != 1.0f) {
+        FAIL("coalesced change report wrong");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    devproto_sub_destroy(mgr);
+    PASS();
+}
+
+/**
+ * Test several due subscriptions share one send, and cancel/reject paths
+ */
+void test_sub_batch_and_cancel(void)
+{
+    TEST("batched push, cancel and reject");
+
+    devproto_sub_manager_t *mgr = devproto_sub_create();
+    devproto_metric_t set[1] = { { DEVPROTO_METRIC_CPU_USAGE, 0.0f } };
+    devproto_metric_t sample[1] = { { DEVPROTO_METRIC_CPU_USAGE, 10.0f } };
+
+    for (uint8_t id = 0; id < DEVPROTO_SUB_MAX; id++) {
+        subscribe(mgr, id, 1000, 0, set, 1);
+    }
+    int full = subscribe(mgr, 0x55, 1000, 0, set, 1);
+
+    devproto_sub_update(mgr, sample, 1);
+    mock_reset();
+    int sent = devproto_sub_poll(mgr, &mock_transport);
+
+    devproto_message_t msgs[DEVPROTO_SUB_MAX + 1];
+    if (full != DEVPROTO_SUB_STATUS_REJECT || sent != DEVPROTO_SUB_MAX ||
+        mock_wire_frames(msgs, DEVPROTO_SUB_MAX + 1) != DEVPROTO_SUB_MAX || mock_calls != 1) {
+        FAIL("expected one send for all subscriptions");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    /* Empty set cancels; negative deadband is malformed */
+    devproto_metric_t bad[1] = { { DEVPROTO_METRIC_CPU_USAGE, -1.0f } };
+    if (subscribe(mgr, 3, 0, 0, NULL, 0) != DEVPROTO_SUB_STATUS_OK ||
+        devproto_sub_count(mgr) != DEVPROTO_SUB_MAX - 1 ||
+        subscribe(mgr, 3, 0, 0, bad, 1) != DEVPROTO_SUB_STATUS_REJECT) {
+        FAIL("cancel/validation wrong");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    devproto_sub_clear(mgr);
+    if (devproto_sub_count(mgr) != 0 || devproto_sub_next_timeout(mgr) != -1) {
+        FAIL("clear left subscriptions");
+        devproto_sub_destroy(mgr);
+        return;
+    }
+
+    devproto_sub_destroy(mgr);
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Subscription Unit Tests ===\n");
+    printf("\n");
+
+    test_sub_periodic();
+    test_sub_deadband();
+    test_sub_batch_and_cancel();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,517 @@
+/**
+ * @file test_transport.c
+ * @brief Transport send and receive path tests over loopback and pty
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "devproto/transport.h"
+#include "devproto/frame.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+/**
+ * Listen on an ephemeral loopback port
+ * Returns listening fd and sets *port, or -1.
+ */
+static int listen_loopback(int *port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 4) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/**
+ * Connect a TCP transport to a fresh listener
+ */
+static devproto_transport_t *connect_pair(int *listen_fd, int *peer_fd)
+{
+    int port;
+    *listen_fd = listen_loopback(&port);
+    if (*listen_fd < 0) return NULL;
+
+    devproto_transport_t *t = devproto_transport_tcp_create("127.0.0.1", port);
+    if (!t || devproto_transport_open(t) != 0) {
+        devproto_transport_destroy(t);
+        close(*listen_fd);
+        return NULL;
+    }
+
+    *peer_fd = accept(*listen_fd, NULL, NULL);
+    return t;
+}
+
+static double elapsed_s(const struct timespec *a, const struct timespec *b)
+{
+    return (double)(b->tv_sec - a->tv_sec) + (double)(b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+/**
+ * Test a stalled peer makes blocking send time out without spinning
+ */
+void test_tcp_write_timeout(void)
+{
+    TEST("blocking send times out on stalled peer");
+
+    int lfd, pfd;
+    devproto_transport_t *t = connect_pair(&lfd, &pfd);
+    if (!t) {
+        FAIL("loopback setup failed");
+        return;
+    }
+
+    devproto_transport_tcp_set_write_timeout(t, 200);
+
+    static uint8_t chunk[65536];
+    struct timespec wall0, wall1, cpu0, cpu1;
+    clock_gettime(CLOCK_MONOTONIC, &wall0);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu0);
+
+    /* Peer never reads: sends fill the socket buffers, then must wait */
+    int result = 0;
+    for (int i = 0; i < 256 && result >= 0; i++) {
+        result = devproto_transport_send(t, chunk, sizeof(chunk));
+        if (result >= 0 && result < (int)sizeof(chunk)) {
+            result = devproto_transport_send(t, chunk, sizeof(chunk));
+        }
+    }
+    int err = errno;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall1);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu1);
+
+    double wall = elapsed_s(&wall0, &wall1);
+    double cpu = elapsed_s(&cpu0, &cpu1);
+
+    devproto_transport_destroy(t);
+    close(pfd);
+    close(lfd);
+
+    if (result >= 0 || err != ETIMEDOUT) {
+        FAIL("expected ETIMEDOUT");
+        return;
+    }
+    if (wall < 0.19 || cpu > wall * 0.5) {
+        printf("(wall %.3fs cpu %.3fs) ", wall, cpu);
+        FAIL("send should sleep, not spin");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test non-blocking send queues the excess and drain delivers it in order
+ */
+void test_tcp_nonblocking_queue(void)
+{
+    TEST("non-blocking send queues and drains");
+
+    int lfd, pfd;
+    devproto_transport_t *t = connect_pair(&lfd, &pfd);
+    if (!t) {
+        FAIL("loopback setup failed");
+        return;
+    }
+
+    devproto_transport_tcp_set_nonblocking(t, 1, 8 * 1024 * 1024);
+
+    /* Larger than loopback socket buffers, so part of it must queue */
+    static uint8_t data[8 * 1024 * 1024];
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 7 + (i >> 11));
+
+    /* Two sends: the second must queue behind the first, not overtake it */
+    int a = devproto_transport_send(t, data, sizeof(data) / 2);
+    int b = devproto_transport_send(t, data + sizeof(data) / 2, sizeof(data) / 2);
+    int pending = devproto_transport_pending(t);
+
+    if (a != (int)sizeof(data) / 2 || b != (int)sizeof(data) / 2 || pending <= 0) {
+        devproto_transport_destroy(t);
+        close(pfd);
+        close(lfd);
+        FAIL("expected both sends accepted with data queued");
+        return;
+    }
+
+    static uint8_t rx[sizeof(data)];
+    size_t got = 0;
+    int rounds = 0;
+
+    while (got < sizeof(data) && rounds++ < 5000) {
+        if (devproto_transport_drain(t, 1) < 0) break;
+        ssize_t n = recv(pfd, rx + got, sizeof(rx) - got, MSG_DONTWAIT);
+        if (n > 0) got += (size_t)n;
+    }
+
+    int left = devproto_transport_pending(t);
+    devproto_transport_destroy(t);
+    close(pfd);
+    close(lfd);
+
+    if (got != sizeof(data) || left != 0 || memcmp(rx, data, sizeof(data)) != 0) {
+        printf("(got %zu left %d) ", got, left);
+        FAIL("queued data lost or reordered");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Test non-blocking send reports a full queue
+ */
+void test_tcp_nonblocking_full(void)
+{
+    TEST("non-blocking send with full queue");
+
+    int lfd, pfd;
+    devproto_transport_t *t = connect_pair(&lfd, &pfd);
+    if (!t) {
+        FAIL("loopback setup failed");
+        return;
+    }
+
+    devproto_transport_tcp_set_nonblocking(t, 1, 8192);
+
+    static uint8_t chunk[16384];
+    int result = (int)sizeof(chunk);
+    for (int i = 0; i < 1024 && result == (int)sizeof(chunk); i++) {
+        result = devproto_transport_send(t, chunk, sizeof(chunk));
+    }
+    if (result == (int)sizeof(chunk)) {
+        result = devproto_transport_send(t, chunk, sizeof(chunk));
+    }
+    int again = devproto_transport_send(t, chunk, sizeof(chunk));
+    int err = errno;
+    int pending = devproto_transport_pending(t);
+
+    devproto_transport_destroy(t);
+    close(pfd);
+    close(lfd);
+
+    if (result >= (int)sizeof(chunk) || again != -1 || err != EAGAIN || pending != 8192) {
+        printf("(result %d again %d pending %d) ", result, again, pending);
+        FAIL("expected short accept then EAGAIN");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Open a pseudo-terminal; returns the master fd and the slave path
+ */
+static int open_pty(char *path, size_t path_size)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+
+    const char *name = NULL;
+    if (grantpt(fd) != 0 || unlockpt(fd) != 0 || !(name = ptsname(fd))) {
+        close(fd);
+        return -1;
+    }
+
+    snprintf(path, path_size, "%s", name);
+    return fd;
+}
+
+void test_serial_read_ahead(void)
+{
+    TEST("serial read-ahead buffer and custom baud");
+
+    char path[128];
+    int master = open_pty(path, sizeof(path));
+    if (master < 0) {
+        printf("SKIP (no pty) ");
+        PASS();
+        return;
+    }
+
+    /* 250000 has no Bxxx constant: exercises termios2/BOTHER */
+    devproto_serial_config_t cfg;
+    devproto_serial_config_init(&cfg, path);
+    cfg.baudrate = 250000;
+    cfg.rx_buffer_size = 256;
+
+    devproto_transport_t *t = devproto_transport_serial_create_ex(&cfg);
+    if (!t || devproto_transport_open(t) != 0) {
+        FAIL("open failed");
+        devproto_transport_destroy(t);
+        close(master);
+        return;
+    }
+
+    uint8_t out[200];
+    for (size_t i = 0; i < sizeof(out); i++) out[i] = (uint8_t)i;
+    if (write(master, out, sizeof(out)) != (ssize_t)sizeof(out)) {
+        FAIL("pty write failed");
+        devproto_transport_destroy(t);
+        close(master);
+        return;
+    }
+
+    /* Small caller reads: first fills the buffer, the rest come from memory */
+    uint8_t in[sizeof(out)];
+    size_t got = 0;
+    int first = devproto_transport_recv(t, in, 10, 500);
+    if (first > 0) got = (size_t)first;
+    int avail = devproto_transport_available(t);
+
+    while (got < sizeof(in)) {
+        int n = devproto_transport_recv(t, in + got, 10, 500);
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+
+    int ok = first == 10 && avail >= (int)(sizeof(out) - 10) && got == sizeof(out) &&
+             memcmp(in, out, sizeof(out)) == 0;
+
+    devproto_transport_destroy(t);
+    close(master);
+
+    if (!ok) {
+        printf("(first %d, avail %d, got %zu) ", first, avail, got);
+        FAIL("read-ahead data wrong");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Writes a frame to the pty master in two bursts while the reader waits
+ */
+typedef struct {
+    int fd;
+    const uint8_t *data;
+    size_t len;
+} burst_writer_t;
+
+static void *burst_writer(void *arg)
+{
+    burst_writer_t *w = arg;
+    struct timespec gap = { 0, 30 * 1000000L };
+
+    nanosleep(&gap, NULL);
+    if (write(w->fd, w->data, 3) != 3) return NULL;
+    nanosleep(&gap, NULL);
+    if (write(w->fd, w->data + 3, w->len - 3) != (ssize_t)(w->len - 3)) return NULL;
+    return NULL;
+}
+
+void test_serial_read_hint(void)
+{
+    TEST("serial VMIN read hint gathers a frame");
+
+    char path[128];
+    int master = open_pty(path, sizeof(path));
+    if (master < 0) {
+        printf("SKIP (no pty) ");
+        PASS();
+        return;
+    }
+
+    devproto_serial_config_t cfg;
+    devproto_serial_config_init(&cfg, path);
+    cfg.rx_buffer_size = 0;
+
+    devproto_transport_t *t = devproto_transport_serial_create_ex(&cfg);
+    if (!t || devproto_transport_open(t) != 0) {
+        FAIL("open failed");
+        devproto_transport_destroy(t);
+        close(master);
+        return;
+    }
+
+    /* Frame arrives in two bursts; with the hint one recv returns all of it */
+    uint8_t frame[64];
+    devproto_message_t msg = { .msg_type = DEVPROTO_MSG_PING, .sequence = 1 };
+    int flen = devproto_frame_build(&msg, frame, sizeof(frame));
+
+    devproto_frame_parser_t parser;
+    devproto_frame_parser_init(&parser);
+    devproto_transport_serial_set_read_hint(t, devproto_frame_remaining(&parser));
+
+    burst_writer_t w = { master, frame, (size_t)flen };
+    pthread_t tid;
+    pthread_create(&tid, NULL, burst_writer, &w);
+
+    uint8_t in[64];
+    int n = devproto_transport_recv(t, in, sizeof(in), 500);
+    pthread_join(tid, NULL);
+
+    int ok = flen == DEVPROTO_MIN_FRAME_SIZE && n == flen &&
+             memcmp(in, frame, (size_t)flen) == 0;
+
+    devproto_transport_destroy(t);
+    close(master);
+
+    if (!ok) {
+        printf("(recv %d of %d) ", n, flen);
+        FAIL("hinted read split the frame");
+        return;
+    }
+
+    PASS();
+}
+
+/**
+ * Build a frame of the given type whose sequence number identifies it
+ */
+static int build_tagged_frame(uint8_t type, uint8_t seq, uint8_t *buf, size_t size)
+{
+    static uint8_t payload[1000];
+    memset(payload, seq, sizeof(payload));
+
+    devproto_message_t msg = {
+        .msg_type = type,
+        .sequence = seq,
+        .payload_len = sizeof(payload),
+        .payload = payload
+    };
+    return devproto_frame_build(&msg, buf, size);
+}
+
+void test_serial_priority_queue(void)
+{
+    TEST("serial async queue sends alerts first, frames whole");
+
+    char path[128];
+    int master = open_pty(path, sizeof(path));
+    if (master < 0) {
+        printf("SKIP (no pty) ");
+        PASS();
+        return;
+    }
+
+    devproto_transport_t *t = devproto_transport_serial_create(path, 115200);
+    if (!t || devproto_transport_open(t) != 0 ||
+        devproto_transport_serial_set_nonblocking(t, 1, 4096) != 0) {
+        FAIL("open failed");
+        devproto_transport_destroy(t);
+        close(master);
+        return;
+    }
+
+    uint8_t frame[1100];
+    int flen = 0;
+
+    /* Fill the pty until a frame is left half-written */
+    int in_flight = -1;
+    for (int seq = 0; seq < 100 && in_flight < 0; seq++) {
+        flen = build_tagged_frame(DEVPROTO_MSG_METRICS_EVENT, (uint8_t)seq, frame, sizeof(frame));
+        if (devproto_transport_send(t, frame, (size_t)flen) != flen) break;
+        if (devproto_transport_pending(t) > 0) in_flight = seq;
+    }
+
+    /* Three bulk frames fit the normal ring, a fourth is refused whole */
+    int queued = 0;
+    for (int seq = 100; seq < 103; seq++) {
+        flen = build_tagged_frame(DEVPROTO_MSG_METRICS_EVENT, (uint8_t)seq, frame, sizeof(frame));
+        if (devproto_transport_send(t, frame, (size_t)flen) == flen) queued++;
+    }
+    int before = devproto_transport_pending(t);
+    flen = build_tagged_frame(DEVPROTO_MSG_METRICS_EVENT, 103, frame, sizeof(frame));
+    int refused = devproto_transport_send(t, frame, (size_t)flen) < 0 && errno == EAGAIN &&
+                  devproto_transport_pending(t) == before;
+
+    flen = build_tagged_frame(DEVPROTO_MSG_ALERT_EVENT, 200, frame, sizeof(frame));
+    int alert = devproto_transport_send(t, frame, (size_t)flen) == flen;
+
+    /* Read everything back, draining as the pty empties */
+    devproto_frame_parser_t parser;
+    devproto_frame_parser_init(&parser);
+    int order[256];
+    int count = 0;
+    int bad = 0;
+
+    for (int i = 0; i < 1000; i++) {
+        int left = devproto_transport_drain(t, 0);
+        struct pollfd pfd = { .fd = master, .events = POLLIN };
+        if (poll(&pfd, 1, 50) <= 0) {
+            if (left == 0) break;
+            continue;
+        }
+
+        uint8_t buf[4096];
+        ssize_t n = read(master, buf, sizeof(buf));
+        if (n <= 0) break;
+
+        devproto_message_t msgs[8];
+        int got = devproto_frame_parse(&parser, buf, (size_t)n, msgs, 8);
+        if (got < 0) bad++;
+        for (int m = 0; m < got && count < 256; m++) {
+            order[count++] = msgs[m].sequence;
+        }
+    }
+
+    devproto_transport_destroy(t);
+    close(master);
+
+    /* in_flight completes, then the alert, then the queued bulk frames */
+    int ok = in_flight >= 0 && queued == 3 && refused && alert && !bad &&
+             count == in_flight + 5;
+    for (int i = 0; ok && i <= in_flight; i++) ok = order[i] == i;
+    if (ok) {
+        ok = order[in_flight + 1] == 200 && order[in_flight + 2] == 100 &&
+             order[in_flight + 3] == 101 && order[in_flight + 4] == 102;
+    }
+
+    if (!ok) {
+        printf("(in flight %d, queued %d, refused %d, alert %d, frames %d) ",
+               in_flight, queued, refused, alert, count);
+        FAIL("wrong order or torn frames");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void)
+{
+    printf("=== Transport Unit Tests ===\n");
+    printf("\n");
+
+    test_tcp_write_timeout();
+    test_tcp_nonblocking_queue();
+    test_tcp_nonblocking_full();
+    test_serial_read_ahead();
+    test_serial_read_hint();
+    test_serial_priority_queue();
+
+    printf("\n");
+    printf("=== Results: %d passed, %d failed ===\n", tests_passed, tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}